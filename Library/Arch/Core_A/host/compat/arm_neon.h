@@ -0,0 +1,972 @@
+/**************************************************************************//**
+ * @file     arm_neon.h
+ *
+ * @brief    Host stand-in for the AArch64 NEON intrinsics, lane by lane in
+ *           plain C, shared by the host builds of the NEON kernels.
+ *
+ * Only the intrinsics the kernels use are provided: Library/Blit,
+ * Library/AudioDSP, Library/BitStream and ThirdParty/LibMAD. Each one has
+ * the lane semantics of its instruction: integer arithmetic wraps,
+ * rounding shifts and halving adds are computed wide, saturating ops
+ * clamp, plain narrows keep the low half of the lane. The results are
+ * those of the target, the speed is not.
+ *
+ * A kernel that needs another intrinsic adds it here, in its section.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __HOST_ARM_NEON_H__
+#define __HOST_ARM_NEON_H__
+
+#include <stdint.h>
+
+typedef struct { uint8_t v[8]; } uint8x8_t;
+typedef struct { uint8_t v[16]; } uint8x16_t;
+typedef struct { uint16_t v[4]; } uint16x4_t;
+typedef struct { uint16_t v[8]; } uint16x8_t;
+typedef struct { int16_t v[4]; } int16x4_t;
+typedef struct { int16_t v[8]; } int16x8_t;
+typedef struct { int32_t v[4]; } int32x4_t;
+typedef struct { uint32_t v[4]; } uint32x4_t;
+typedef struct { int32_t v[2]; } int32x2_t;
+typedef struct { int64_t v[2]; } int64x2_t;
+typedef struct { uint8x8_t val[2]; } uint8x8x2_t;
+typedef struct { uint8x8_t val[3]; } uint8x8x3_t;
+typedef struct { uint8x8_t val[4]; } uint8x8x4_t;
+typedef struct { uint8x16_t val[2]; } uint8x16x2_t;
+typedef struct { uint8x16_t val[4]; } uint8x16x4_t;
+typedef struct { int16x8_t val[2]; } int16x8x2_t;
+typedef struct { int32x4_t val[2]; } int32x4x2_t;
+
+/* Lane arithmetic on 64 bits wraps like the instructions do */
+#define NEON_WRAP64(x)  ((int64_t)(uint64_t)(x))
+
+/* Saturation and shift helpers */
+
+static inline int32_t neon_sat32(int64_t x)
+{
+	return (x > INT32_MAX) ? INT32_MAX : (x < INT32_MIN) ? INT32_MIN : (int32_t)x;
+}
+
+static inline int16_t neon_sat16(int64_t x)
+{
+	return (x > INT16_MAX) ? INT16_MAX : (x < INT16_MIN) ? INT16_MIN : (int16_t)x;
+}
+
+/* SSHL/USHL: the count is the signed low byte of the lane, negative shifts right */
+static inline int32_t neon_shl_s32(int32_t a, int32_t n)
+{
+	n = (int8_t)n;
+	if (n >= 32)
+		return 0;
+	if (n >= 0)
+		return (int32_t)((uint32_t)a << n);
+	if (n <= -32)
+		return (a < 0) ? -1 : 0;
+	return a >> -n;
+}
+
+static inline uint32_t neon_shl_u32(uint32_t a, int32_t n)
+{
+	n = (int8_t)n;
+	if (n >= 32 || n <= -32)
+		return 0;
+	return (n >= 0) ? a << n : a >> -n;
+}
+
+/* Loads and stores */
+
+static inline uint8x16_t vld1q_u8(const uint8_t *p)
+{
+	uint8x16_t r;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		r.v[i] = p[i];
+	return r;
+}
+
+static inline uint16x8_t vld1q_u16(const uint16_t *p)
+{
+	uint16x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = p[i];
+	return r;
+}
+
+static inline void vst1q_u16(uint16_t *p, uint16x8_t a)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		p[i] = a.v[i];
+}
+
+static inline int16x8_t vld1q_s16(const int16_t *p)
+{
+	int16x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = p[i];
+	return r;
+}
+
+static inline void vst1q_s16(int16_t *p, int16x8_t a)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		p[i] = a.v[i];
+}
+
+static inline int32x2_t vld1_s32(const int32_t *p)
+{
+	int32x2_t r = {{ p[0], p[1] }};
+	return r;
+}
+
+static inline void vst1_s32(int32_t *p, int32x2_t a)
+{
+	p[0] = a.v[0];
+	p[1] = a.v[1];
+}
+
+static inline int32x4_t vld1q_s32(const int32_t *p)
+{
+	int32x4_t r = {{ p[0], p[1], p[2], p[3] }};
+	return r;
+}
+
+static inline void vst1q_s32(int32_t *p, int32x4_t a)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		p[i] = a.v[i];
+}
+
+static inline uint32x4_t vld1q_u32(const uint32_t *p)
+{
+	uint32x4_t r = {{ p[0], p[1], p[2], p[3] }};
+	return r;
+}
+
+static inline void vst1q_u32(uint32_t *p, uint32x4_t a)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		p[i] = a.v[i];
+}
+
+static inline int16x8x2_t vld2q_s16(const int16_t *p)
+{
+	int16x8x2_t r;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		r.val[0].v[i] = p[2 * i];
+		r.val[1].v[i] = p[2 * i + 1];
+	}
+	return r;
+}
+
+static inline void vst2q_s16(int16_t *p, int16x8x2_t a)
+{
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		p[2 * i] = a.val[0].v[i];
+		p[2 * i + 1] = a.val[1].v[i];
+	}
+}
+
+static inline int32x4x2_t vld2q_s32(const int32_t *p)
+{
+	int32x4x2_t r;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		r.val[0].v[i] = p[2 * i];
+		r.val[1].v[i] = p[2 * i + 1];
+	}
+	return r;
+}
+
+static inline uint8x8x4_t vld4_u8(const uint8_t *p)
+{
+	uint8x8x4_t r;
+	int i, k;
+
+	for (i = 0; i < 8; i++)
+		for (k = 0; k < 4; k++)
+			r.val[k].v[i] = p[4 * i + k];
+	return r;
+}
+
+static inline void vst4_u8(uint8_t *p, uint8x8x4_t a)
+{
+	int i, k;
+
+	for (i = 0; i < 8; i++)
+		for (k = 0; k < 4; k++)
+			p[4 * i + k] = a.val[k].v[i];
+}
+
+static inline uint8x16x4_t vld4q_u8(const uint8_t *p)
+{
+	uint8x16x4_t r;
+	int i, k;
+
+	for (i = 0; i < 16; i++)
+		for (k = 0; k < 4; k++)
+			r.val[k].v[i] = p[4 * i + k];
+	return r;
+}
+
+static inline void vst4q_u8(uint8_t *p, uint8x16x4_t a)
+{
+	int i, k;
+
+	for (i = 0; i < 16; i++)
+		for (k = 0; k < 4; k++)
+			p[4 * i + k] = a.val[k].v[i];
+}
+
+/* Duplicates */
+
+static inline uint8x8_t vdup_n_u8(uint8_t x)
+{
+	uint8x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = x;
+	return r;
+}
+
+static inline uint8x16_t vdupq_n_u8(uint8_t x)
+{
+	uint8x16_t r;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		r.v[i] = x;
+	return r;
+}
+
+static inline uint16x8_t vdupq_n_u16(uint16_t x)
+{
+	uint16x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = x;
+	return r;
+}
+
+static inline int16x4_t vdup_n_s16(int16_t x)
+{
+	int16x4_t r = {{ x, x, x, x }};
+	return r;
+}
+
+static inline int16x8_t vdupq_n_s16(int16_t x)
+{
+	int16x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = x;
+	return r;
+}
+
+static inline uint32x4_t vdupq_n_u32(uint32_t x)
+{
+	uint32x4_t r = {{ x, x, x, x }};
+	return r;
+}
+
+static inline int32x4_t vdupq_n_s32(int32_t x)
+{
+	int32x4_t r = {{ x, x, x, x }};
+	return r;
+}
+
+static inline int64x2_t vdupq_n_s64(int64_t x)
+{
+	int64x2_t r = {{ x, x }};
+	return r;
+}
+
+/* Halves and combines */
+
+static inline uint8x8_t vget_low_u8(uint8x16_t a)
+{
+	uint8x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = a.v[i];
+	return r;
+}
+
+static inline uint8x8_t vget_high_u8(uint8x16_t a)
+{
+	uint8x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = a.v[i + 8];
+	return r;
+}
+
+static inline int16x4_t vget_low_s16(int16x8_t a)
+{
+	int16x4_t r = {{ a.v[0], a.v[1], a.v[2], a.v[3] }};
+	return r;
+}
+
+static inline int16x4_t vget_high_s16(int16x8_t a)
+{
+	int16x4_t r = {{ a.v[4], a.v[5], a.v[6], a.v[7] }};
+	return r;
+}
+
+static inline int32x2_t vget_low_s32(int32x4_t a)
+{
+	int32x2_t r = {{ a.v[0], a.v[1] }};
+	return r;
+}
+
+static inline int32x2_t vget_high_s32(int32x4_t a)
+{
+	int32x2_t r = {{ a.v[2], a.v[3] }};
+	return r;
+}
+
+static inline uint8x16_t vcombine_u8(uint8x8_t lo, uint8x8_t hi)
+{
+	uint8x16_t r;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		r.v[i] = lo.v[i];
+		r.v[i + 8] = hi.v[i];
+	}
+	return r;
+}
+
+static inline uint16x8_t vcombine_u16(uint16x4_t lo, uint16x4_t hi)
+{
+	uint16x8_t r;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		r.v[i] = lo.v[i];
+		r.v[i + 4] = hi.v[i];
+	}
+	return r;
+}
+
+static inline int16x8_t vcombine_s16(int16x4_t lo, int16x4_t hi)
+{
+	int16x8_t r;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		r.v[i] = lo.v[i];
+		r.v[i + 4] = hi.v[i];
+	}
+	return r;
+}
+
+static inline int32x4_t vcombine_s32(int32x2_t lo, int32x2_t hi)
+{
+	int32x4_t r = {{ lo.v[0], lo.v[1], hi.v[0], hi.v[1] }};
+	return r;
+}
+
+static inline int16x8_t vreinterpretq_s16_u16(uint16x8_t a)
+{
+	int16x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = (int16_t)a.v[i];
+	return r;
+}
+
+static inline uint16x8_t vreinterpretq_u16_s16(int16x8_t a)
+{
+	uint16x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = (uint16_t)a.v[i];
+	return r;
+}
+
+static inline int32x4_t vreinterpretq_s32_u32(uint32x4_t a)
+{
+	int32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = (int32_t)a.v[i];
+	return r;
+}
+
+/* Permutes */
+
+static inline uint8x16x2_t vuzpq_u8(uint8x16_t a, uint8x16_t b)
+{
+	uint8x16x2_t r;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		r.val[0].v[i] = a.v[2 * i];
+		r.val[0].v[i + 8] = b.v[2 * i];
+		r.val[1].v[i] = a.v[2 * i + 1];
+		r.val[1].v[i + 8] = b.v[2 * i + 1];
+	}
+	return r;
+}
+
+static inline int16x8x2_t vuzpq_s16(int16x8_t a, int16x8_t b)
+{
+	int16x8x2_t r;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		r.val[0].v[i] = a.v[2 * i];
+		r.val[0].v[i + 4] = b.v[2 * i];
+		r.val[1].v[i] = a.v[2 * i + 1];
+		r.val[1].v[i + 4] = b.v[2 * i + 1];
+	}
+	return r;
+}
+
+static inline uint8x8x2_t vzip_u8(uint8x8_t a, uint8x8_t b)
+{
+	uint8x8x2_t r;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		r.val[0].v[2 * i] = a.v[i];
+		r.val[0].v[2 * i + 1] = b.v[i];
+		r.val[1].v[2 * i] = a.v[i + 4];
+		r.val[1].v[2 * i + 1] = b.v[i + 4];
+	}
+	return r;
+}
+
+static inline int32x4_t vrev64q_s32(int32x4_t a)
+{
+	int32x4_t r = {{ a.v[1], a.v[0], a.v[3], a.v[2] }};
+	return r;
+}
+
+static inline int32x4_t vextq_s32(int32x4_t a, int32x4_t b, int n)
+{
+	int32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = (i + n < 4) ? a.v[i + n] : b.v[i + n - 4];
+	return r;
+}
+
+/* Bitwise and compares */
+
+static inline uint8x8_t vmvn_u8(uint8x8_t a)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] = (uint8_t)~a.v[i];
+	return a;
+}
+
+static inline uint16x8_t vandq_u16(uint16x8_t a, uint16x8_t b)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] &= b.v[i];
+	return a;
+}
+
+static inline uint16x8_t vorrq_u16(uint16x8_t a, uint16x8_t b)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] |= b.v[i];
+	return a;
+}
+
+static inline uint8x16_t veorq_u8(uint8x16_t a, uint8x16_t b)
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+		a.v[i] ^= b.v[i];
+	return a;
+}
+
+static inline uint8x16_t vorrq_u8(uint8x16_t a, uint8x16_t b)
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+		a.v[i] |= b.v[i];
+	return a;
+}
+
+/* All ones where equal */
+static inline uint8x16_t vceqq_u8(uint8x16_t a, uint8x16_t b)
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+		a.v[i] = (a.v[i] == b.v[i]) ? 0xFF : 0;
+	return a;
+}
+
+/* Shifts */
+
+static inline uint8x8_t vshr_n_u8(uint8x8_t a, int n)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] = (uint8_t)(a.v[i] >> n);
+	return a;
+}
+
+static inline uint16x8_t vshrq_n_u16(uint16x8_t a, int n)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] = (uint16_t)(a.v[i] >> n);
+	return a;
+}
+
+static inline uint16x8_t vshlq_n_u16(uint16x8_t a, int n)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] = (uint16_t)(a.v[i] << n);
+	return a;
+}
+
+static inline int32x4_t vshrq_n_s32(int32x4_t a, int n)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		a.v[i] >>= n;
+	return a;
+}
+
+static inline int16x8_t vrshrq_n_s16(int16x8_t a, int n)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] = (int16_t)(((int32_t)a.v[i] + (1 << (n - 1))) >> n);
+	return a;
+}
+
+static inline uint8x8_t vrshrn_n_u16(uint16x8_t a, int n)
+{
+	uint8x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = (uint8_t)(((uint32_t)a.v[i] + (1u << (n - 1))) >> n);
+	return r;
+}
+
+static inline int32x4_t vshlq_s32(int32x4_t a, int32x4_t n)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		a.v[i] = neon_shl_s32(a.v[i], n.v[i]);
+	return a;
+}
+
+static inline uint32x4_t vshlq_u32(uint32x4_t a, int32x4_t n)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		a.v[i] = neon_shl_u32(a.v[i], n.v[i]);
+	return a;
+}
+
+/* SQSHL, left shifts saturate; right shifts as vshlq_s32() */
+static inline int32x4_t vqshlq_s32(int32x4_t a, int32x4_t n)
+{
+	int i, s;
+
+	for (i = 0; i < 4; i++) {
+		s = (int8_t)n.v[i];
+		if (s <= 0)
+			a.v[i] = neon_shl_s32(a.v[i], s);
+		else if (a.v[i])
+			a.v[i] = (s >= 32) ? ((a.v[i] < 0) ? INT32_MIN : INT32_MAX) :
+				 neon_sat32((int64_t)a.v[i] * ((int64_t)1 << s));
+	}
+	return a;
+}
+
+static inline int32x2_t vshrn_n_s64(int64x2_t a, int n)
+{
+	int32x2_t r = {{ (int32_t)(a.v[0] >> n), (int32_t)(a.v[1] >> n) }};
+	return r;
+}
+
+static inline int32x2_t vrshrn_n_s64(int64x2_t a, int n)
+{
+	int64_t h = (int64_t)1 << (n - 1);
+	int32x2_t r = {{ (int32_t)(NEON_WRAP64((uint64_t)a.v[0] + h) >> n),
+			 (int32_t)(NEON_WRAP64((uint64_t)a.v[1] + h) >> n) }};
+	return r;
+}
+
+/* Widening and narrowing */
+
+static inline uint16x8_t vmovl_u8(uint8x8_t a)
+{
+	uint16x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = a.v[i];
+	return r;
+}
+
+static inline int32x4_t vmovl_s16(int16x4_t a)
+{
+	int32x4_t r = {{ a.v[0], a.v[1], a.v[2], a.v[3] }};
+	return r;
+}
+
+static inline uint8x8_t vmovn_u16(uint16x8_t a)
+{
+	uint8x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = (uint8_t)a.v[i];
+	return r;
+}
+
+static inline uint8x8_t vqmovn_u16(uint16x8_t a)
+{
+	uint8x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = (a.v[i] > UINT8_MAX) ? UINT8_MAX : (uint8_t)a.v[i];
+	return r;
+}
+
+static inline uint16x4_t vqmovun_s32(int32x4_t a)
+{
+	uint16x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = (a.v[i] < 0) ? 0 : (a.v[i] > UINT16_MAX) ? UINT16_MAX : (uint16_t)a.v[i];
+	return r;
+}
+
+static inline int16x4_t vqmovn_s32(int32x4_t a)
+{
+	int16x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = neon_sat16(a.v[i]);
+	return r;
+}
+
+static inline int16x4_t neon_qrshrn_s32(int32x4_t a, int n)
+{
+	int16x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = neon_sat16(((int64_t)a.v[i] + ((int64_t)1 << (n - 1))) >> n);
+	return r;
+}
+
+#define vqrshrn_n_s32(a, n)     neon_qrshrn_s32((a), (n))
+
+/* Arithmetic */
+
+static inline uint8x8_t vadd_u8(uint8x8_t a, uint8x8_t b)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] = (uint8_t)(a.v[i] + b.v[i]);
+	return a;
+}
+
+static inline uint8x16_t vaddq_u8(uint8x16_t a, uint8x16_t b)
+{
+	int i;
+
+	for (i = 0; i < 16; i++)
+		a.v[i] = (uint8_t)(a.v[i] + b.v[i]);
+	return a;
+}
+
+static inline uint16x8_t vaddq_u16(uint16x8_t a, uint16x8_t b)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] = (uint16_t)(a.v[i] + b.v[i]);
+	return a;
+}
+
+static inline int16x8_t vaddq_s16(int16x8_t a, int16x8_t b)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] = (int16_t)(uint16_t)((uint16_t)a.v[i] + (uint16_t)b.v[i]);
+	return a;
+}
+
+static inline int16x8_t vrhaddq_s16(int16x8_t a, int16x8_t b)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] = (int16_t)(((int32_t)a.v[i] + b.v[i] + 1) >> 1);
+	return a;
+}
+
+static inline uint8x8_t vaddhn_u16(uint16x8_t a, uint16x8_t b)
+{
+	uint8x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = (uint8_t)((uint16_t)(a.v[i] + b.v[i]) >> 8);
+	return r;
+}
+
+static inline uint16x8_t vsubl_u8(uint8x8_t a, uint8x8_t b)
+{
+	uint16x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = (uint16_t)(a.v[i] - b.v[i]);
+	return r;
+}
+
+static inline int32x4_t vaddq_s32(int32x4_t a, int32x4_t b)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		a.v[i] = (int32_t)((uint32_t)a.v[i] + (uint32_t)b.v[i]);
+	return a;
+}
+
+static inline int32x4_t vsubq_s32(int32x4_t a, int32x4_t b)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		a.v[i] = (int32_t)((uint32_t)a.v[i] - (uint32_t)b.v[i]);
+	return a;
+}
+
+static inline int32x4_t vqaddq_s32(int32x4_t a, int32x4_t b)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		a.v[i] = neon_sat32((int64_t)a.v[i] + b.v[i]);
+	return a;
+}
+
+static inline int32x4_t vminq_s32(int32x4_t a, int32x4_t b)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		a.v[i] = (a.v[i] < b.v[i]) ? a.v[i] : b.v[i];
+	return a;
+}
+
+static inline int32x4_t vmaxq_s32(int32x4_t a, int32x4_t b)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		a.v[i] = (a.v[i] > b.v[i]) ? a.v[i] : b.v[i];
+	return a;
+}
+
+static inline int32x4_t vnegq_s32(int32x4_t a)
+{
+	int32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = (int32_t)(0u - (uint32_t)a.v[i]);
+	return r;
+}
+
+static inline uint16x8_t vmull_u8(uint8x8_t a, uint8x8_t b)
+{
+	uint16x8_t r;
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r.v[i] = (uint16_t)(a.v[i] * b.v[i]);
+	return r;
+}
+
+static inline uint16x8_t vmlal_u8(uint16x8_t a, uint8x8_t b, uint8x8_t c)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] = (uint16_t)(a.v[i] + b.v[i] * c.v[i]);
+	return a;
+}
+
+static inline int16x8_t vmulq_n_s16(int16x8_t a, int16_t b)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] = (int16_t)(uint16_t)((uint32_t)a.v[i] * (uint32_t)b);
+	return a;
+}
+
+static inline int16x8_t vmlaq_n_s16(int16x8_t a, int16x8_t b, int16_t c)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		a.v[i] = (int16_t)(uint16_t)((uint32_t)a.v[i] + (uint32_t)b.v[i] * (uint32_t)c);
+	return a;
+}
+
+static inline int32x4_t vmlaq_n_s32(int32x4_t a, int32x4_t b, int32_t c)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		a.v[i] = (int32_t)((uint32_t)a.v[i] + (uint32_t)b.v[i] * (uint32_t)c);
+	return a;
+}
+
+static inline uint32x4_t vmlaq_u32(uint32x4_t a, uint32x4_t b, uint32x4_t c)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		a.v[i] += b.v[i] * c.v[i];
+	return a;
+}
+
+static inline int32x4_t vmull_s16(int16x4_t a, int16x4_t b)
+{
+	int32x4_t r;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		r.v[i] = (int32_t)a.v[i] * b.v[i];
+	return r;
+}
+
+static inline int32x4_t vmlal_s16(int32x4_t acc, int16x4_t a, int16x4_t b)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		acc.v[i] = (int32_t)((uint32_t)acc.v[i] + (uint32_t)((int32_t)a.v[i] * b.v[i]));
+	return acc;
+}
+
+static inline int64x2_t vmlal_s32(int64x2_t acc, int32x2_t a, int32x2_t b)
+{
+	int i;
+
+	for (i = 0; i < 2; i++)
+		acc.v[i] = NEON_WRAP64((uint64_t)acc.v[i] + (uint64_t)((int64_t)a.v[i] * b.v[i]));
+	return acc;
+}
+
+static inline int64x2_t vmlsl_s32(int64x2_t acc, int32x2_t a, int32x2_t b)
+{
+	int i;
+
+	for (i = 0; i < 2; i++)
+		acc.v[i] = NEON_WRAP64((uint64_t)acc.v[i] - (uint64_t)((int64_t)a.v[i] * b.v[i]));
+	return acc;
+}
+
+static inline int64x2_t vmull_s32(int32x2_t a, int32x2_t b)
+{
+	return vmlal_s32(vdupq_n_s64(0), a, b);
+}
+
+static inline int64x2_t vmull_high_s32(int32x4_t a, int32x4_t b)
+{
+	return vmull_s32(vget_high_s32(a), vget_high_s32(b));
+}
+
+static inline int64x2_t vmlal_high_s32(int64x2_t acc, int32x4_t a, int32x4_t b)
+{
+	return vmlal_s32(acc, vget_high_s32(a), vget_high_s32(b));
+}
+
+static inline int64x2_t vmlsl_high_s32(int64x2_t acc, int32x4_t a, int32x4_t b)
+{
+	return vmlsl_s32(acc, vget_high_s32(a), vget_high_s32(b));
+}
+
+/* Reductions */
+
+static inline int32_t vaddvq_s32(int32x4_t a)
+{
+	return (int32_t)((uint32_t)a.v[0] + (uint32_t)a.v[1] + (uint32_t)a.v[2] + (uint32_t)a.v[3]);
+}
+
+static inline int64_t vaddvq_s64(int64x2_t a)
+{
+	return NEON_WRAP64((uint64_t)a.v[0] + (uint64_t)a.v[1]);
+}
+
+static inline uint8_t vmaxvq_u8(uint8x16_t a)
+{
+	uint8_t m = 0;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		m = (a.v[i] > m) ? a.v[i] : m;
+	return m;
+}
+
+#endif /* __HOST_ARM_NEON_H__ */
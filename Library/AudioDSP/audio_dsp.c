@@ -0,0 +1,250 @@
+/**************************************************************************//**
+ * @file     audio_dsp.c
+ *
+ * @brief    PCM sample format conversion, interleaving and mixing.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stddef.h>
+
+#include "audio_dsp.h"
+
+#if defined(AUDIO_DSP_NEON)
+#include <arm_neon.h>
+#endif
+
+#define DITHER_MUL      1664525u
+#define DITHER_ADD      1013904223u
+
+static int32_t sat32(int64_t x, int32_t i32Min, int32_t i32Max)
+{
+    if (x < i32Min)
+        return i32Min;
+    if (x > i32Max)
+        return i32Max;
+    return (int32_t)x;
+}
+
+/* One generator step of the dither, (-2^s, 2^s) */
+static int32_t dither_next(AUDIO_DITHER_T *psDither, int32_t s)
+{
+    uint32_t *pu32State = &psDither->au32State[psDither->u32Lane];
+    uint32_t r1, r2;
+
+    r1 = *pu32State = *pu32State * DITHER_MUL + DITHER_ADD;
+    r2 = *pu32State = *pu32State * DITHER_MUL + DITHER_ADD;
+    psDither->u32Lane = (psDither->u32Lane + 1) & 3;
+
+    return (int32_t)(r1 >> (32 - s)) - (int32_t)(r2 >> (32 - s));
+}
+
+/* Shift right by s with rounding or dither, or left by -s, and saturate to [i32Min, i32Max] */
+static int32_t quantize(int32_t x, int32_t s, AUDIO_DITHER_T *psDither, int32_t i32Min, int32_t i32Max)
+{
+    int64_t v = x;
+
+    if (s <= 0)
+        return sat32(v * ((int64_t)1 << -s), i32Min, i32Max);
+
+    v += (int32_t)1 << (s - 1);
+    if (psDither)
+        v += dither_next(psDither, s);
+
+    return sat32(v >> s, i32Min, i32Max);
+}
+
+#if defined(AUDIO_DSP_NEON)
+/*
+ * Four samples of quantize(). The bias of rounding and dither is added
+ * with saturation: where that saturates, the exact sum is beyond the
+ * destination range as well, for u32FracBits < 32.
+ */
+static int32x4_t quantize4(int32x4_t x, int32_t s, AUDIO_DITHER_T *psDither, uint32x4_t *pu32State)
+{
+    int32x4_t bias = vdupq_n_s32((s > 0) ? (int32_t)1 << (s - 1) : 0);
+    uint32x4_t r1, r2;
+
+    if (s <= 0)
+        return vqshlq_s32(x, vdupq_n_s32(-s));
+
+    if (psDither)
+    {
+        r1 = *pu32State = vmlaq_u32(vdupq_n_u32(DITHER_ADD), *pu32State, vdupq_n_u32(DITHER_MUL));
+        r2 = *pu32State = vmlaq_u32(vdupq_n_u32(DITHER_ADD), *pu32State, vdupq_n_u32(DITHER_MUL));
+        r1 = vshlq_u32(r1, vdupq_n_s32(s - 32));
+        r2 = vshlq_u32(r2, vdupq_n_s32(s - 32));
+        bias = vaddq_s32(bias, vsubq_s32(vreinterpretq_s32_u32(r1), vreinterpretq_s32_u32(r2)));
+    }
+
+    return vshlq_s32(vqaddq_s32(x, bias), vdupq_n_s32(-s));
+}
+#endif
+
+void audio_dsp_dither_init(AUDIO_DITHER_T *psDither, uint32_t u32Seed)
+{
+    uint32_t i;
+
+    for (i = 0; i < 4; i++)
+        psDither->au32State[i] = u32Seed * 2654435761u + i * 0x9E3779B9u;
+    psDither->u32Lane = 0;
+}
+
+void audio_dsp_fixed_to_s16(int16_t *pi16Dst, const int32_t *pi32Src, uint32_t u32Count,
+                            uint32_t u32FracBits, AUDIO_DITHER_T *psDither)
+{
+    int32_t s = (int32_t)u32FracBits + 1 - 16;
+    uint32_t i = 0;
+
+#if defined(AUDIO_DSP_NEON)
+    uint32x4_t u32State = vdupq_n_u32(0);
+
+    /* Scalar up to the first generator, then four generators at a time */
+    if (psDither)
+    {
+        for (; i < u32Count && psDither->u32Lane; i++)
+            pi16Dst[i] = (int16_t)quantize(pi32Src[i], s, psDither, INT16_MIN, INT16_MAX);
+        u32State = vld1q_u32(psDither->au32State);
+    }
+
+    for (; i + 8 <= u32Count; i += 8)
+    {
+        int32x4_t lo = quantize4(vld1q_s32(pi32Src + i), s, psDither, &u32State);
+        int32x4_t hi = quantize4(vld1q_s32(pi32Src + i + 4), s, psDither, &u32State);
+
+        vst1q_s16(pi16Dst + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+
+    if (psDither)
+        vst1q_u32(psDither->au32State, u32State);
+#endif
+
+    for (; i < u32Count; i++)
+        pi16Dst[i] = (int16_t)quantize(pi32Src[i], s, psDither, INT16_MIN, INT16_MAX);
+}
+
+void audio_dsp_fixed_to_s24(int32_t *pi32Dst, const int32_t *pi32Src, uint32_t u32Count,
+                            uint32_t u32FracBits, AUDIO_DITHER_T *psDither)
+{
+    int32_t s = (int32_t)u32FracBits + 1 - 24;
+    uint32_t i = 0;
+
+#if defined(AUDIO_DSP_NEON)
+    int32x4_t vmin = vdupq_n_s32(-(1 << 23)), vmax = vdupq_n_s32((1 << 23) - 1);
+    uint32x4_t u32State = vdupq_n_u32(0);
+
+    if (psDither)
+    {
+        for (; i < u32Count && psDither->u32Lane; i++)
+            pi32Dst[i] = quantize(pi32Src[i], s, psDither, -(1 << 23), (1 << 23) - 1);
+        u32State = vld1q_u32(psDither->au32State);
+    }
+
+    for (; i + 4 <= u32Count; i += 4)
+    {
+        int32x4_t v = quantize4(vld1q_s32(pi32Src + i), s, psDither, &u32State);
+
+        vst1q_s32(pi32Dst + i, vminq_s32(vmaxq_s32(v, vmin), vmax));
+    }
+
+    if (psDither)
+        vst1q_u32(psDither->au32State, u32State);
+#endif
+
+    for (; i < u32Count; i++)
+        pi32Dst[i] = quantize(pi32Src[i], s, psDither, -(1 << 23), (1 << 23) - 1);
+}
+
+void audio_dsp_fixed_to_s32(int32_t *pi32Dst, const int32_t *pi32Src, uint32_t u32Count,
+                            uint32_t u32FracBits)
+{
+    int32_t s = (int32_t)u32FracBits + 1 - 32;
+    uint32_t i = 0;
+
+#if defined(AUDIO_DSP_NEON)
+    for (; i + 4 <= u32Count; i += 4)
+        vst1q_s32(pi32Dst + i, quantize4(vld1q_s32(pi32Src + i), s, NULL, NULL));
+#endif
+
+    for (; i < u32Count; i++)
+        pi32Dst[i] = quantize(pi32Src[i], s, NULL, INT32_MIN, INT32_MAX);
+}
+
+void audio_dsp_interleave_s16(int16_t *pi16Dst, const int16_t *pi16Ch0, const int16_t *pi16Ch1,
+                              uint32_t u32Count)
+{
+    uint32_t i = 0;
+
+#if defined(AUDIO_DSP_NEON)
+    for (; i + 8 <= u32Count; i += 8)
+    {
+        int16x8x2_t v;
+
+        v.val[0] = vld1q_s16(pi16Ch0 + i);
+        v.val[1] = vld1q_s16(pi16Ch1 + i);
+        vst2q_s16(pi16Dst + 2 * i, v);
+    }
+#endif
+
+    for (; i < u32Count; i++)
+    {
+        pi16Dst[2 * i] = pi16Ch0[i];
+        pi16Dst[2 * i + 1] = pi16Ch1[i];
+    }
+}
+
+void audio_dsp_deinterleave_s16(int16_t *pi16Ch0, int16_t *pi16Ch1, const int16_t *pi16Src,
+                                uint32_t u32Count)
+{
+    uint32_t i = 0;
+
+#if defined(AUDIO_DSP_NEON)
+    for (; i + 8 <= u32Count; i += 8)
+    {
+        int16x8x2_t v = vld2q_s16(pi16Src + 2 * i);
+
+        vst1q_s16(pi16Ch0 + i, v.val[0]);
+        vst1q_s16(pi16Ch1 + i, v.val[1]);
+    }
+#endif
+
+    for (; i < u32Count; i++)
+    {
+        pi16Ch0[i] = pi16Src[2 * i];
+        pi16Ch1[i] = pi16Src[2 * i + 1];
+    }
+}
+
+void audio_dsp_mix_s16(int16_t *pi16Dst, const int16_t *const *ppi16Src, const int16_t *pi16Gain,
+                       uint32_t u32Srcs, uint32_t u32Count)
+{
+    uint32_t i = 0, k;
+
+#if defined(AUDIO_DSP_NEON)
+    for (; i + 8 <= u32Count; i += 8)
+    {
+        int32x4_t lo = vdupq_n_s32(0), hi = vdupq_n_s32(0);
+
+        for (k = 0; k < u32Srcs; k++)
+        {
+            int16x8_t x = vld1q_s16(ppi16Src[k] + i);
+            int16x4_t g = vdup_n_s16(pi16Gain[k]);
+
+            lo = vqaddq_s32(lo, vmull_s16(vget_low_s16(x), g));
+            hi = vqaddq_s32(hi, vmull_s16(vget_high_s16(x), g));
+        }
+
+        vst1q_s16(pi16Dst + i, vcombine_s16(vqrshrn_n_s32(lo, 14), vqrshrn_n_s32(hi, 14)));
+    }
+#endif
+
+    for (; i < u32Count; i++)
+    {
+        int32_t acc = 0;
+
+        for (k = 0; k < u32Srcs; k++)
+            acc = sat32((int64_t)acc + (int32_t)ppi16Src[k][i] * pi16Gain[k], INT32_MIN, INT32_MAX);
+
+        pi16Dst[i] = (int16_t)sat32(((int64_t)acc + (1 << 13)) >> 14, INT16_MIN, INT16_MAX);
+    }
+}
@@ -0,0 +1,139 @@
+/**************************************************************************//**
+ * @file     audio_dsp.h
+ *
+ * @brief    PCM sample format conversion, interleaving, mixing and sample
+ *           rate conversion shared by the I2S, UAC and MP3 paths.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __AUDIO_DSP_H__
+#define __AUDIO_DSP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Every kernel has a C version and, where the compiler targets NEON, a
+ * NEON version that produces the same bits; AUDIO_DSP_NO_NEON keeps the C
+ * versions only. Buffers need no alignment.
+ */
+#if defined(__ARM_NEON) && !defined(AUDIO_DSP_NO_NEON) && !defined(AUDIO_DSP_NEON)
+#define AUDIO_DSP_NEON
+#endif
+
+/*---------------------------------------------------------------------------*/
+/* Fixed point to integer PCM                                                */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Sources are 32-bit fixed point with u32FracBits fraction bits, 1.0 being
+ * 1 << u32FracBits (28 for LibMAD's mad_fixed_t). Samples are rounded to
+ * nearest, or dithered when a dither state is given, and saturated to the
+ * range of the destination format.
+ *
+ * The dither is triangular (TPDF), +/- 1 LSB of the destination, from four
+ * interleaved linear congruential generators: sample n of a stream uses
+ * generator n % 4, whatever the split of the stream into calls.
+ */
+typedef struct
+{
+    uint32_t au32State[4];
+    uint32_t u32Lane;           /* generator of the next sample */
+} AUDIO_DITHER_T;
+
+void audio_dsp_dither_init(AUDIO_DITHER_T *psDither, uint32_t u32Seed);
+
+/* To 16-bit samples */
+void audio_dsp_fixed_to_s16(int16_t *pi16Dst, const int32_t *pi32Src, uint32_t u32Count,
+                            uint32_t u32FracBits, AUDIO_DITHER_T *psDither);
+
+/* To 24-bit samples, right justified and sign extended in 32 bits */
+void audio_dsp_fixed_to_s24(int32_t *pi32Dst, const int32_t *pi32Src, uint32_t u32Count,
+                            uint32_t u32FracBits, AUDIO_DITHER_T *psDither);
+
+/* To 32-bit samples, 1.0 being 2^31; no rounding is needed for u32FracBits < 31 */
+void audio_dsp_fixed_to_s32(int32_t *pi32Dst, const int32_t *pi32Src, uint32_t u32Count,
+                            uint32_t u32FracBits);
+
+/*---------------------------------------------------------------------------*/
+/* Interleaving                                                              */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * pi16Dst[2n] = pi16Ch0[n], pi16Dst[2n + 1] = pi16Ch1[n]. Passing the same
+ * channel twice turns mono into stereo; the I2S word right | left << 16 of
+ * the MP3 player is pi16Ch0 = right, pi16Ch1 = left.
+ */
+void audio_dsp_interleave_s16(int16_t *pi16Dst, const int16_t *pi16Ch0, const int16_t *pi16Ch1,
+                              uint32_t u32Count);
+
+/* pi16Ch0[n] = pi16Src[2n], pi16Ch1[n] = pi16Src[2n + 1] */
+void audio_dsp_deinterleave_s16(int16_t *pi16Ch0, int16_t *pi16Ch1, const int16_t *pi16Src,
+                                uint32_t u32Count);
+
+/*---------------------------------------------------------------------------*/
+/* Mixing                                                                    */
+/*---------------------------------------------------------------------------*/
+
+/* Gains are Q14: AUDIO_DSP_GAIN_UNITY is 1.0, the range is [-2.0, 2.0) */
+#define AUDIO_DSP_GAIN_UNITY    0x4000
+#define AUDIO_DSP_GAIN_Q14(x)   ((int16_t)((x) * AUDIO_DSP_GAIN_UNITY))
+
+/*
+ * pi16Dst[n] = sum of ppi16Src[k][n] * pi16Gain[k] over u32Srcs sources,
+ * rounded and saturated to 16 bits. The sum is accumulated in 32 bits
+ * with saturation, source by source; that only differs from the exact
+ * sum when partial sums pass 65536 times full scale. Sources and
+ * destination are sample arrays of any layout, so interleaved buffers mix
+ * channel by channel. pi16Dst may be one of the sources.
+ */
+void audio_dsp_mix_s16(int16_t *pi16Dst, const int16_t *const *ppi16Src, const int16_t *pi16Gain,
+                       uint32_t u32Srcs, uint32_t u32Count);
+
+/*---------------------------------------------------------------------------*/
+/* Sample rate conversion                                                    */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Polyphase FIR resampler by the ratio of the two rates reduced to L / M:
+ * the input is up-sampled by L, low-pass filtered and down-sampled by M.
+ * The filter is a Kaiser windowed sinc of AUDIO_SRC_TAPS taps per phase,
+ * cut off at 0.45 times the lower of the two rates, in Q15. One object
+ * converts one channel.
+ */
+#define AUDIO_SRC_TAPS          32
+#define AUDIO_SRC_MAX_PHASES    320     /* L of 22050 -> 48000 */
+#define AUDIO_SRC_BLOCK         256     /* input samples filtered per pass */
+
+typedef struct
+{
+    uint32_t u32L;                      /* up-sampling factor, number of phases */
+    uint32_t u32M;                      /* down-sampling factor */
+    uint32_t u32Phase;                  /* phase of the next output */
+    uint32_t u32Pos;                    /* input of the next output, from the start of the block */
+    int16_t  ai16Coef[AUDIO_SRC_MAX_PHASES][AUDIO_SRC_TAPS];   /* taps of a phase, oldest input first */
+    int16_t  ai16Line[AUDIO_SRC_TAPS - 1 + AUDIO_SRC_BLOCK];    /* history, then the block */
+} AUDIO_SRC_T;
+
+/* Returns 0, or -1 when L exceeds AUDIO_SRC_MAX_PHASES */
+int audio_src_init(AUDIO_SRC_T *psSrc, uint32_t u32InRate, uint32_t u32OutRate);
+
+/* Forget the history, as at the start of a stream */
+void audio_src_reset(AUDIO_SRC_T *psSrc);
+
+/* Most outputs u32Count inputs can produce */
+uint32_t audio_src_max_out(const AUDIO_SRC_T *psSrc, uint32_t u32Count);
+
+/* Convert u32Count samples, returns the number of samples written to pi16Dst */
+uint32_t audio_src_process(AUDIO_SRC_T *psSrc, int16_t *pi16Dst, const int16_t *pi16Src,
+                           uint32_t u32Count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIO_DSP_H__ */
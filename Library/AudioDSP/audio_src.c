@@ -0,0 +1,233 @@
+/**************************************************************************//**
+ * @file     audio_src.c
+ *
+ * @brief    Polyphase FIR sample rate converter.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+
+#include "audio_dsp.h"
+
+#if defined(AUDIO_DSP_NEON)
+#include <arm_neon.h>
+#endif
+
+#define SRC_PI          3.14159265358979323846
+#define SRC_BETA        7.0     /* Kaiser window, about 70 dB of stop band */
+#define SRC_CUTOFF      0.45    /* of the lower rate */
+
+#if (AUDIO_SRC_TAPS % 8) != 0
+#error "AUDIO_SRC_TAPS must be a multiple of 8"
+#endif
+
+/*
+ * The filter is designed once per rate pair, without the C library's libm:
+ * sin() by its Taylor series after folding into [-pi/2, pi/2], and the
+ * Kaiser window's I0() by its power series.
+ */
+static double src_sin(double x)
+{
+    double term, sum;
+    int n;
+
+    x -= 2.0 * SRC_PI * (double)(long)(x / (2.0 * SRC_PI));
+    if (x > SRC_PI)
+        x -= 2.0 * SRC_PI;
+    else if (x < -SRC_PI)
+        x += 2.0 * SRC_PI;
+    if (x > SRC_PI / 2)
+        x = SRC_PI - x;
+    else if (x < -SRC_PI / 2)
+        x = -SRC_PI - x;
+
+    term = sum = x;
+    for (n = 1; n < 12; n++)
+    {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+static double src_i0(double x)
+{
+    double term = 1.0, sum = 1.0;
+    int n;
+
+    for (n = 1; n < 40; n++)
+    {
+        term *= (x / (2 * n)) * (x / (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+static double src_sqrt(double x)
+{
+    double r = (x > 1.0) ? x : 1.0;
+    int n;
+
+    if (x <= 0.0)
+        return 0.0;
+    for (n = 0; n < 60; n++)
+        r = 0.5 * (r + x / r);
+    return r;
+}
+
+static uint32_t src_gcd(uint32_t a, uint32_t b)
+{
+    while (b)
+    {
+        uint32_t t = a % b;
+
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/*
+ * Output of the phase whose taps are pi16Coef, newest input last in pi16X.
+ * The taps of a phase add up to 1.0 and their magnitudes to well under
+ * 2.0, so the sum of the products stays within 32 bits.
+ */
+static int16_t src_dot(const int16_t *pi16Coef, const int16_t *pi16X)
+{
+    int32_t acc = 0;
+    uint32_t j;
+
+#if defined(AUDIO_DSP_NEON)
+    int32x4_t v = vdupq_n_s32(0);
+
+    for (j = 0; j < AUDIO_SRC_TAPS; j += 8)
+    {
+        int16x8_t c = vld1q_s16(pi16Coef + j);
+        int16x8_t x = vld1q_s16(pi16X + j);
+
+        v = vmlal_s16(v, vget_low_s16(c), vget_low_s16(x));
+        v = vmlal_s16(v, vget_high_s16(c), vget_high_s16(x));
+    }
+    acc = vaddvq_s32(v);
+#else
+    for (j = 0; j < AUDIO_SRC_TAPS; j++)
+        acc += (int32_t)pi16Coef[j] * pi16X[j];
+#endif
+
+    acc = (acc + (1 << 14)) >> 15;
+    if (acc > INT16_MAX)
+        acc = INT16_MAX;
+    else if (acc < INT16_MIN)
+        acc = INT16_MIN;
+    return (int16_t)acc;
+}
+
+int audio_src_init(AUDIO_SRC_T *psSrc, uint32_t u32InRate, uint32_t u32OutRate)
+{
+    uint32_t g = src_gcd(u32InRate, u32OutRate);
+    uint32_t L = u32OutRate / g, M = u32InRate / g;
+    uint32_t p, j, N, n;
+    double fc, c, t, w, h[AUDIO_SRC_TAPS], sum;
+    int32_t i32Sum, i32Tap;
+
+    if (L > AUDIO_SRC_MAX_PHASES)
+        return -1;
+
+    psSrc->u32L = L;
+    psSrc->u32M = M;
+
+    /* Prototype of N taps at L times the input rate, cut off in cycles per up-sampled sample */
+    N = L * AUDIO_SRC_TAPS;
+    fc = SRC_CUTOFF * ((u32InRate < u32OutRate) ? u32InRate : u32OutRate) / ((double)u32InRate * L);
+
+    for (p = 0; p < L; p++)
+    {
+        sum = 0.0;
+        for (j = 0; j < AUDIO_SRC_TAPS; j++)
+        {
+            /* Tap j of the phase weighs input (TAPS - 1 - j) samples back */
+            n = p + (AUDIO_SRC_TAPS - 1 - j) * L;
+            t = (double)n - (N - 1) / 2.0;
+            if (L == 1 && M == 1)
+                h[j] = (n == (N - 1) / 2) ? 1.0 : 0.0;
+            else
+            {
+                c = (t == 0.0) ? 2.0 * fc : src_sin(2.0 * SRC_PI * fc * t) / (SRC_PI * t);
+                w = 2.0 * n / (N - 1) - 1.0;
+                h[j] = c * src_i0(SRC_BETA * src_sqrt(1.0 - w * w)) / src_i0(SRC_BETA);
+            }
+            sum += h[j];
+        }
+
+        /* Unity gain in every phase, the rounding error goes to the largest tap */
+        i32Sum = 0;
+        for (j = 0; j < AUDIO_SRC_TAPS; j++)
+        {
+            t = h[j] / sum * 32768.0;
+            i32Tap = (int32_t)(t + ((t < 0) ? -0.5 : 0.5));
+            psSrc->ai16Coef[p][j] = (int16_t)((i32Tap > INT16_MAX) ? INT16_MAX : i32Tap);
+            i32Sum += psSrc->ai16Coef[p][j];
+        }
+        for (j = n = 0; j < AUDIO_SRC_TAPS; j++)
+        {
+            if (psSrc->ai16Coef[p][j] > psSrc->ai16Coef[p][n])
+                n = j;
+        }
+        i32Tap = psSrc->ai16Coef[p][n] + 32768 - i32Sum;
+        psSrc->ai16Coef[p][n] = (int16_t)((i32Tap > INT16_MAX) ? INT16_MAX : i32Tap);
+    }
+
+    audio_src_reset(psSrc);
+    return 0;
+}
+
+void audio_src_reset(AUDIO_SRC_T *psSrc)
+{
+    psSrc->u32Phase = 0;
+    psSrc->u32Pos = 0;
+    memset(psSrc->ai16Line, 0, sizeof(psSrc->ai16Line));
+}
+
+uint32_t audio_src_max_out(const AUDIO_SRC_T *psSrc, uint32_t u32Count)
+{
+    return (uint32_t)(((uint64_t)u32Count * psSrc->u32L) / psSrc->u32M) + 2;
+}
+
+uint32_t audio_src_process(AUDIO_SRC_T *psSrc, int16_t *pi16Dst, const int16_t *pi16Src,
+                           uint32_t u32Count)
+{
+    uint32_t L = psSrc->u32L;
+    uint32_t u32Step = psSrc->u32M / L, u32Frac = psSrc->u32M % L;
+    uint32_t u32Phase = psSrc->u32Phase, u32Pos = psSrc->u32Pos;
+    uint32_t u32Out = 0, n;
+
+    while (u32Count)
+    {
+        n = (u32Count < AUDIO_SRC_BLOCK) ? u32Count : AUDIO_SRC_BLOCK;
+        memcpy(&psSrc->ai16Line[AUDIO_SRC_TAPS - 1], pi16Src, n * sizeof(int16_t));
+
+        /* Output at up-sampled time k * M: newest input (k * M) / L, phase (k * M) % L */
+        while (u32Pos < n)
+        {
+            pi16Dst[u32Out++] = src_dot(psSrc->ai16Coef[u32Phase], &psSrc->ai16Line[u32Pos]);
+
+            u32Pos += u32Step;
+            u32Phase += u32Frac;
+            if (u32Phase >= L)
+            {
+                u32Phase -= L;
+                u32Pos++;
+            }
+        }
+
+        u32Pos -= n;
+        memmove(psSrc->ai16Line, &psSrc->ai16Line[n], (AUDIO_SRC_TAPS - 1) * sizeof(int16_t));
+        pi16Src += n;
+        u32Count -= n;
+    }
+
+    psSrc->u32Phase = u32Phase;
+    psSrc->u32Pos = u32Pos;
+    return u32Out;
+}
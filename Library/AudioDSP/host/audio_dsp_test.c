@@ -0,0 +1,520 @@
+/**************************************************************************//**
+ * @file     audio_dsp_test.c
+ *
+ * @brief    Host unit test and benchmark of the AudioDSP kernels, the NEON
+ *           versions against the C versions and both against references.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "audio_dsp.h"
+
+/*
+ * The library is built twice (see Makefile), renamed with a prefix:
+ *
+ *   neon_  the NEON kernels, on the shared arm_neon.h stand-in unless the
+ *          host is AArch64
+ *   c_     AUDIO_DSP_NO_NEON
+ *
+ *   audio_dsp_test [-b] [-t ms] [-f MHz]
+ *
+ * Every kernel of neon_ must be bit-exact with c_ over random inputs,
+ * lengths and buffer offsets; c_ is checked against the references below
+ * and, for the sample rate converter, against a sine. -b adds samples per
+ * second of each kernel, measured for at least -t ms, and the cycles per
+ * sample that makes at a -f MHz core clock (the A35 of MA35D1 by default).
+ */
+
+#define DSP_DECLARE(p)  \
+	void p##audio_dsp_dither_init(AUDIO_DITHER_T *, uint32_t);  \
+	void p##audio_dsp_fixed_to_s16(int16_t *, const int32_t *, uint32_t, uint32_t, AUDIO_DITHER_T *);  \
+	void p##audio_dsp_fixed_to_s24(int32_t *, const int32_t *, uint32_t, uint32_t, AUDIO_DITHER_T *);  \
+	void p##audio_dsp_fixed_to_s32(int32_t *, const int32_t *, uint32_t, uint32_t);  \
+	void p##audio_dsp_interleave_s16(int16_t *, const int16_t *, const int16_t *, uint32_t);  \
+	void p##audio_dsp_deinterleave_s16(int16_t *, int16_t *, const int16_t *, uint32_t);  \
+	void p##audio_dsp_mix_s16(int16_t *, const int16_t *const *, const int16_t *, uint32_t, uint32_t);  \
+	int  p##audio_src_init(AUDIO_SRC_T *, uint32_t, uint32_t);  \
+	uint32_t p##audio_src_max_out(const AUDIO_SRC_T *, uint32_t);  \
+	uint32_t p##audio_src_process(AUDIO_SRC_T *, int16_t *, const int16_t *, uint32_t);
+
+#define DSP_VARIANT(p, desc)  \
+	{ #p, desc, p##audio_dsp_dither_init, p##audio_dsp_fixed_to_s16, p##audio_dsp_fixed_to_s24,  \
+	  p##audio_dsp_fixed_to_s32, p##audio_dsp_interleave_s16, p##audio_dsp_deinterleave_s16,  \
+	  p##audio_dsp_mix_s16, p##audio_src_init, p##audio_src_max_out, p##audio_src_process }
+
+DSP_DECLARE(neon_)
+DSP_DECLARE(c_)
+
+typedef struct {
+	const char *name;
+	const char *desc;
+	void (*dither_init)(AUDIO_DITHER_T *, uint32_t);
+	void (*to_s16)(int16_t *, const int32_t *, uint32_t, uint32_t, AUDIO_DITHER_T *);
+	void (*to_s24)(int32_t *, const int32_t *, uint32_t, uint32_t, AUDIO_DITHER_T *);
+	void (*to_s32)(int32_t *, const int32_t *, uint32_t, uint32_t);
+	void (*interleave)(int16_t *, const int16_t *, const int16_t *, uint32_t);
+	void (*deinterleave)(int16_t *, int16_t *, const int16_t *, uint32_t);
+	void (*mix)(int16_t *, const int16_t *const *, const int16_t *, uint32_t, uint32_t);
+	int  (*src_init)(AUDIO_SRC_T *, uint32_t, uint32_t);
+	uint32_t (*src_max_out)(const AUDIO_SRC_T *, uint32_t);
+	uint32_t (*src_process)(AUDIO_SRC_T *, int16_t *, const int16_t *, uint32_t);
+} variant_t;
+
+enum { V_NEON, V_C, V_NUM };
+
+static const variant_t s_var[V_NUM] = {
+	DSP_VARIANT(neon_, "NEON"),
+	DSP_VARIANT(c_,    "C"),
+};
+
+#define MAXN        4096
+#define FRACBITS    28          /* mad_fixed_t */
+
+static int s_fail;
+
+#define CHECK(cond, ...)  do { if (!(cond)) { printf("  FAIL: " __VA_ARGS__); printf("\n"); s_fail = 1; } } while (0)
+
+static uint32_t s_rnd = 1;
+
+static uint32_t rnd(void)
+{
+	/* xorshift32 */
+	s_rnd ^= s_rnd << 13;
+	s_rnd ^= s_rnd >> 17;
+	s_rnd ^= s_rnd << 5;
+	return s_rnd;
+}
+
+/* Mostly audio range fixed point, some full range and some extremes */
+static int32_t rnd_fixed(void)
+{
+	switch (rnd() & 7) {
+	case 0:  return (int32_t)rnd();
+	case 1:  return (rnd() & 1) ? INT32_MAX - (int32_t)(rnd() & 0xff) : INT32_MIN + (int32_t)(rnd() & 0xff);
+	case 2:  return (int32_t)((rnd() % 5) - 2) * (1 << FRACBITS);
+	default: return (int32_t)(rnd() % (2u << FRACBITS)) - (1 << FRACBITS) + (int32_t)(rnd() % 64) - 32;
+	}
+}
+
+/* MP3FixedToShort() of LibMAD's MP3Func.c, which audio_dsp_fixed_to_s16() replaces */
+static int16_t ref_mp3_fixed_to_short(int32_t sample)
+{
+	if (sample > INT32_MAX - (1 << (FRACBITS - 16)))
+		return INT16_MAX;
+	sample += (1 << (FRACBITS - 16));
+	if (sample >= (1 << FRACBITS))
+		sample = (1 << FRACBITS) - 1;
+	else if (sample < -(1 << FRACBITS))
+		sample = -(1 << FRACBITS);
+	return (int16_t)(sample >> (FRACBITS + 1 - 16));
+}
+
+static int64_t clamp64(int64_t x, int64_t lo, int64_t hi)
+{
+	return (x < lo) ? lo : (x > hi) ? hi : x;
+}
+
+static void test_convert(void)
+{
+	static int32_t src[MAXN + 8];
+	static int16_t d16[V_NUM][MAXN + 8];
+	static int32_t d32[V_NUM][MAXN + 8];
+	AUDIO_DITHER_T dith[V_NUM], whole;
+	uint32_t n, off, fb, i, v, part;
+	int trial, bad16 = 0, bad24 = 0, bad32 = 0, badref = 0, baddither = 0;
+	double err, sum = 0, sum2 = 0;
+	long cnt = 0;
+
+	printf("fixed point to s16/s24/s32\n");
+
+	for (trial = 0; trial < 3000; trial++) {
+		n = rnd() % 300;
+		off = rnd() % 4;
+		fb = (trial & 1) ? FRACBITS : 20 + rnd() % 11;
+		for (i = 0; i < n; i++)
+			src[off + i] = rnd_fixed();
+
+		/* rounding */
+		for (v = 0; v < V_NUM; v++)
+			s_var[v].to_s16(d16[v] + off, src + off, n, fb, NULL);
+		bad16 += memcmp(d16[V_NEON] + off, d16[V_C] + off, n * 2) != 0;
+		for (i = 0; i < n; i++) {
+			int s = fb + 1 - 16;
+			int64_t r = clamp64(((int64_t)src[off + i] + (1 << (s - 1))) >> s, INT16_MIN, INT16_MAX);
+
+			badref += d16[V_C][off + i] != r;
+			if (fb == FRACBITS)
+				badref += d16[V_C][off + i] != ref_mp3_fixed_to_short(src[off + i]);
+		}
+
+		for (v = 0; v < V_NUM; v++)
+			s_var[v].to_s24(d32[v] + off, src + off, n, fb, NULL);
+		bad24 += memcmp(d32[V_NEON] + off, d32[V_C] + off, n * 4) != 0;
+		for (i = 0; i < n; i++) {
+			int s = fb + 1 - 24;
+			int64_t r = (s > 0) ? ((int64_t)src[off + i] + (1 << (s - 1))) >> s : (int64_t)src[off + i] * ((int64_t)1 << -s);
+
+			badref += d32[V_C][off + i] != clamp64(r, -(1 << 23), (1 << 23) - 1);
+		}
+
+		for (v = 0; v < V_NUM; v++)
+			s_var[v].to_s32(d32[v] + off, src + off, n, fb);
+		bad32 += memcmp(d32[V_NEON] + off, d32[V_C] + off, n * 4) != 0;
+		for (i = 0; i < n; i++)
+			badref += d32[V_C][off + i] != clamp64((int64_t)src[off + i] * ((int64_t)1 << (31 - fb)), INT32_MIN, INT32_MAX);
+
+		/* dither, the neon_ stream in random parts, the c_ one whole */
+		for (v = 0; v < V_NUM; v++)
+			s_var[v].dither_init(&dith[v], trial);
+		for (i = 0; i < n; i += part) {
+			part = 1 + rnd() % 40;
+			if (part > n - i)
+				part = n - i;
+			s_var[V_NEON].to_s16(d16[V_NEON] + off + i, src + off + i, part, fb, &dith[V_NEON]);
+		}
+		s_var[V_C].to_s16(d16[V_C] + off, src + off, n, fb, &dith[V_C]);
+		baddither += memcmp(d16[V_NEON] + off, d16[V_C] + off, n * 2) != 0;
+		baddither += memcmp(&dith[V_NEON], &dith[V_C], sizeof(whole)) != 0;
+
+		s_var[V_NEON].to_s24(d32[V_NEON] + off, src + off, n, fb, &dith[V_NEON]);
+		s_var[V_C].to_s24(d32[V_C] + off, src + off, n, fb, &dith[V_C]);
+		baddither += memcmp(d32[V_NEON] + off, d32[V_C] + off, n * 4) != 0;
+
+		/* TPDF of +/- 1 LSB on top of rounding: within 1.5 LSB, zero mean */
+		for (i = 0; i < n; i++) {
+			double x = ldexp((double)src[off + i], 16 - 1 - (int)fb);
+
+			if (x <= INT16_MIN + 2 || x >= INT16_MAX - 2)
+				continue;
+			err = d16[V_C][off + i] - x;
+			baddither += fabs(err) > 1.5;
+			sum += err;
+			sum2 += err * err;
+			cnt++;
+		}
+	}
+
+	printf("  neon vs c: s16 %d, s24 %d, s32 %d, dithered %d calls differ\n", bad16, bad24, bad32, baddither);
+	printf("  reference: %d samples differ; dither error mean %.4f, rms %.3f LSB\n",
+	       badref, sum / cnt, sqrt(sum2 / cnt));
+	CHECK(!bad16 && !bad24 && !bad32, "NEON conversion is not bit-exact");
+	CHECK(!badref, "conversion off the reference");
+	CHECK(!baddither, "dither not bit-exact or out of range");
+	/* rounding alone is 0.29 LSB rms, TPDF adds 0.41 */
+	CHECK(fabs(sum / cnt) < 0.01 && sqrt(sum2 / cnt) > 0.45 && sqrt(sum2 / cnt) < 0.55, "dither statistics");
+}
+
+static void test_interleave(void)
+{
+	static int16_t a[MAXN + 8], b[MAXN + 8], il[V_NUM][2 * MAXN + 16], x[V_NUM][MAXN + 8], y[V_NUM][MAXN + 8];
+	uint32_t n, off, i, v;
+	int trial, bad = 0, badref = 0;
+
+	printf("interleave/deinterleave\n");
+
+	for (trial = 0; trial < 2000; trial++) {
+		n = rnd() % 200;
+		off = rnd() % 4;
+		for (i = 0; i < n; i++) {
+			a[off + i] = (int16_t)rnd();
+			b[off + i] = (int16_t)rnd();
+		}
+
+		for (v = 0; v < V_NUM; v++) {
+			s_var[v].interleave(il[v] + off, a + off, b + off, n);
+			s_var[v].deinterleave(x[v] + off, y[v] + off, il[v] + off, n);
+		}
+		bad += memcmp(il[V_NEON] + off, il[V_C] + off, n * 4) != 0;
+		for (i = 0; i < n; i++) {
+			badref += il[V_C][off + 2 * i] != a[off + i] || il[V_C][off + 2 * i + 1] != b[off + i];
+			for (v = 0; v < V_NUM; v++)
+				badref += x[v][off + i] != a[off + i] || y[v][off + i] != b[off + i];
+		}
+
+		/* mono to stereo */
+		for (v = 0; v < V_NUM; v++)
+			s_var[v].interleave(il[v] + off, a + off, a + off, n);
+		bad += memcmp(il[V_NEON] + off, il[V_C] + off, n * 4) != 0;
+	}
+
+	printf("  neon vs c: %d calls differ, reference: %d samples differ\n", bad, badref);
+	CHECK(!bad, "NEON interleaving is not bit-exact");
+	CHECK(!badref, "interleaving off the reference");
+}
+
+static void test_mix(void)
+{
+	static int16_t src[6][MAXN + 8], dst[V_NUM][MAXN + 8];
+	const int16_t *ps[6];
+	int16_t gain[6];
+	uint32_t n, off, k, ns, i, v;
+	int trial, bad = 0, badref = 0;
+
+	printf("mix\n");
+
+	for (trial = 0; trial < 2000; trial++) {
+		n = rnd() % 200;
+		off = rnd() % 4;
+		ns = 1 + rnd() % 6;
+		for (k = 0; k < ns; k++) {
+			/* quiet sources, full scale ones, unity and extreme gains */
+			int shift = (rnd() & 1) ? 0 : rnd() % 12;
+
+			for (i = 0; i < n; i++)
+				src[k][off + i] = (int16_t)((int16_t)rnd() >> shift);
+			gain[k] = (rnd() & 3) ? (int16_t)(rnd() % 0x8000 - 0x4000) :
+				  (rnd() & 1) ? AUDIO_DSP_GAIN_UNITY : (int16_t)rnd();
+			ps[k] = src[k] + off;
+		}
+
+		for (v = 0; v < V_NUM; v++)
+			s_var[v].mix(dst[v] + off, ps, gain, ns, n);
+		bad += memcmp(dst[V_NEON] + off, dst[V_C] + off, n * 2) != 0;
+
+		/* ns * 2^30 fits the 32-bit accumulator for two sources, so the exact sum applies */
+		for (i = 0; i < n && ns <= 2; i++) {
+			int64_t acc = 0;
+
+			for (k = 0; k < ns; k++)
+				acc += (int32_t)src[k][off + i] * gain[k];
+			badref += dst[V_C][off + i] != clamp64((acc + (1 << 13)) >> 14, INT16_MIN, INT16_MAX);
+		}
+	}
+
+	/* unity gain of one source is a copy, in place */
+	for (i = 0; i < MAXN; i++)
+		src[0][i] = (int16_t)rnd();
+	memcpy(dst[0], src[0], sizeof(src[0]));
+	gain[0] = AUDIO_DSP_GAIN_UNITY;
+	ps[0] = dst[0];
+	for (v = 0; v < V_NUM; v++) {
+		s_var[v].mix(dst[0], ps, gain, 1, MAXN);
+		badref += memcmp(dst[0], src[0], MAXN * 2) != 0;
+	}
+
+	printf("  neon vs c: %d calls differ, reference: %d samples differ\n", bad, badref);
+	CHECK(!bad, "NEON mixing is not bit-exact");
+	CHECK(!badref, "mixing off the reference");
+}
+
+/* Least squares fit of a sine of known frequency, returns the SNR of the residual in dB */
+static double sine_snr(const int16_t *x, uint32_t n, double f, double *amp)
+{
+	double s = 0, c = 0, ss = 0, cc = 0, sc = 0, a, b, det, e2 = 0, p2 = 0, r;
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		double si = sin(2 * M_PI * f * i), ci = cos(2 * M_PI * f * i);
+
+		s += x[i] * si;
+		c += x[i] * ci;
+		ss += si * si;
+		cc += ci * ci;
+		sc += si * ci;
+	}
+	det = ss * cc - sc * sc;
+	a = (s * cc - c * sc) / det;
+	b = (c * ss - s * sc) / det;
+	for (i = 0; i < n; i++) {
+		r = a * sin(2 * M_PI * f * i) + b * cos(2 * M_PI * f * i);
+		e2 += (x[i] - r) * (x[i] - r);
+		p2 += r * r;
+	}
+	*amp = sqrt(a * a + b * b);
+	return 10 * log10(p2 / e2);
+}
+
+static const struct {
+	uint32_t in, out;
+	double snr;             /* least SNR of a 997 Hz sine at -6 dBFS */
+} s_rates[] = {
+	{ 44100, 48000, 76 },
+	{ 48000, 44100, 76 },
+	{ 22050, 48000, 76 },
+	{ 32000, 48000, 76 },
+	{ 48000, 16000, 76 },
+	{ 16000, 48000, 76 },
+	{  8000, 48000, 76 },
+	{ 48000, 48000, 90 },
+};
+
+static void test_src(void)
+{
+	static AUDIO_SRC_T src[V_NUM], whole;
+	static int16_t in[48000], out[V_NUM][7 * 48000], ref[7 * 48000];
+	uint32_t r, i, v, n, no[V_NUM], nw, part, lo, hi;
+	double snr, amp, f, p;
+	int bad;
+
+	printf("sample rate conversion\n");
+
+	for (r = 0; r < sizeof(s_rates) / sizeof(s_rates[0]); r++) {
+		uint32_t fin = s_rates[r].in, fout = s_rates[r].out;
+
+		for (v = 0; v < V_NUM; v++)
+			CHECK(s_var[v].src_init(&src[v], fin, fout) == 0, "%u -> %u: init", fin, fout);
+		s_var[V_C].src_init(&whole, fin, fout);
+
+		/* one second of noise in random parts against the whole at once */
+		n = fin;
+		for (i = 0; i < n; i++)
+			in[i] = (int16_t)rnd();
+		no[V_NEON] = no[V_C] = 0;
+		for (i = 0; i < n; i += part) {
+			part = 1 + rnd() % 700;
+			if (part > n - i)
+				part = n - i;
+			for (v = 0; v < V_NUM; v++) {
+				uint32_t k = s_var[v].src_process(&src[v], out[v] + no[v], in + i, part);
+
+				CHECK(k <= s_var[v].src_max_out(&src[v], part), "%u -> %u: max_out", fin, fout);
+				no[v] += k;
+			}
+		}
+		nw = s_var[V_C].src_process(&whole, ref, in, n);
+		bad = no[V_NEON] != no[V_C] || memcmp(out[V_NEON], out[V_C], no[V_C] * 2) ||
+		      nw != no[V_C] || memcmp(ref, out[V_C], nw * 2);
+		CHECK(!bad, "%u -> %u: not bit-exact across variants or splits", fin, fout);
+		CHECK(no[V_C] == fout, "%u -> %u: %u outputs of one second", fin, fout, no[V_C]);
+
+		/* a sine, skipping the filter's start */
+		for (v = 0; v < V_NUM; v++)
+			s_var[v].src_init(&src[v], fin, fout);
+		for (i = 0; i < n; i++)
+			in[i] = (int16_t)lrint(16384 * sin(2 * M_PI * 997.0 * i / fin));
+		nw = s_var[V_C].src_process(&src[V_C], ref, in, n);
+		snr = sine_snr(ref + 2 * AUDIO_SRC_TAPS * fout / fin + 8, nw / 2, 997.0 / fout, &amp);
+		printf("  %5u -> %5u  L/M %3u/%-3u  997 Hz: SNR %5.1f dB, gain %+.3f dB",
+		       fin, fout, src[V_C].u32L, src[V_C].u32M, snr, 20 * log10(amp / 16384));
+		CHECK(snr >= s_rates[r].snr, "%u -> %u: SNR", fin, fout);
+		CHECK(fabs(20 * log10(amp / 16384)) < 0.05, "%u -> %u: pass band gain", fin, fout);
+
+		/*
+		 * down-sampling: a tone past the transition band of 32 taps, 0.75
+		 * of the new rate, must be gone; 48000 -> 44100 has none below 24 kHz
+		 */
+		f = 0.75 * fout;
+		if (fout < fin && f < 0.49 * fin) {
+			s_var[V_C].src_init(&src[V_C], fin, fout);
+			for (i = 0; i < n; i++)
+				in[i] = (int16_t)lrint(16384 * sin(2 * M_PI * f * i / fin));
+			nw = s_var[V_C].src_process(&src[V_C], ref, in, n);
+			lo = nw / 4;
+			hi = nw;
+			for (p = 0, i = lo; i < hi; i++)
+				p += (double)ref[i] * ref[i];
+			p = 10 * log10(p / (hi - lo) / (16384.0 * 16384.0 / 2) + 1e-20);
+			printf(", %.0f Hz alias %.1f dB", f, p);
+			CHECK(p < -60, "%u -> %u: alias", fin, fout);
+		}
+		printf("\n");
+	}
+
+	CHECK(s_var[V_C].src_init(&whole, 44100, 44099) != 0, "L over AUDIO_SRC_MAX_PHASES accepted");
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static volatile int16_t s_sink;
+
+static void bench(unsigned int ms, unsigned int mhz)
+{
+	static int32_t fx[MAXN];
+	static int16_t a[MAXN], b[MAXN], c[2 * MAXN], o[2 * MAXN], d16[MAXN];
+	static int32_t d32[MAXN];
+	static AUDIO_SRC_T src;
+	const int16_t *ps[4] = { a, b, a, b };
+	int16_t gain[4] = { 0x2000, 0x1000, 0x0800, 0x0400 };
+	AUDIO_DITHER_T dith;
+	uint64_t t0, t;
+	long samples;
+	uint32_t i;
+	int v, k;
+
+	static const char *kernel[] = {
+		"fixed -> s16", "fixed -> s16 dither", "fixed -> s24", "interleave", "deinterleave",
+		"mix 4 sources", "src 44100 -> 48000",
+	};
+
+	for (i = 0; i < MAXN; i++) {
+		fx[i] = rnd_fixed();
+		a[i] = (int16_t)rnd();
+		b[i] = (int16_t)rnd();
+	}
+	memcpy(c, a, sizeof(a));
+	memcpy(c + MAXN, b, sizeof(b));
+
+	printf("benchmark, cycles at %u MHz\n", mhz);
+	for (k = 0; k < (int)(sizeof(kernel) / sizeof(kernel[0])); k++) {
+		printf("  %-22s", kernel[k]);
+		for (v = 0; v < V_NUM; v++) {
+			const variant_t *p = &s_var[v];
+
+			p->dither_init(&dith, 1);
+			p->src_init(&src, 44100, 48000);
+			samples = 0;
+			t0 = now_ns();
+			do {
+				switch (k) {
+				case 0: p->to_s16(d16, fx, MAXN, FRACBITS, NULL); break;
+				case 1: p->to_s16(d16, fx, MAXN, FRACBITS, &dith); break;
+				case 2: p->to_s24(d32, fx, MAXN, FRACBITS, NULL); break;
+				case 3: p->interleave(o, a, b, MAXN); break;
+				case 4: p->deinterleave(a, b, c, MAXN); break;
+				case 5: p->mix(d16, ps, gain, 4, MAXN); break;
+				case 6: p->src_process(&src, o, a, MAXN); break;
+				}
+				s_sink = d16[0] + o[0];
+				samples += MAXN;
+				t = now_ns() - t0;
+			} while (t < (uint64_t)ms * 1000000u);
+
+			printf("  %s %8.1f Msamples/s %6.2f cycles", p->desc, samples * 1e3 / t,
+			       (double)t * mhz / 1e3 / samples);
+		}
+		printf("\n");
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int ms = 300, mhz = 800;
+	int opt, do_bench = 0;
+
+	while ((opt = getopt(argc, argv, "bt:f:")) != -1) {
+		switch (opt) {
+		case 'b': do_bench = 1; break;
+		case 't': ms = strtoul(optarg, NULL, 0); break;
+		case 'f': mhz = strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-b] [-t ms] [-f MHz]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	test_convert();
+	test_interleave();
+	test_mix();
+	test_src();
+
+	if (do_bench)
+		bench(ms, mhz);
+
+	printf(s_fail ? "FAIL\n" : "PASS\n");
+	return s_fail;
+}
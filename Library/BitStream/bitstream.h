@@ -0,0 +1,368 @@
+/**************************************************************************//**
+ * @file     bitstream.h
+ *
+ * @brief    H.264 Annex B and JPEG/MJPEG bit stream parsing: start code
+ *           scanning, SPS/PPS/slice header parsing, access unit and JPEG
+ *           frame boundaries, and a frame index for random access.
+ *
+ * Nothing here touches hardware, allocates memory or does file I/O: the
+ * caller feeds the stream in pieces of any size and stores the index
+ * where it likes, so the same code runs in the VC8000 samples, in the
+ * LVGL decoder and on a Linux host.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __BITSTREAM_H__
+#define __BITSTREAM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * The start code scanner has a C version and, where the compiler targets
+ * NEON, a NEON version with the same results; BS_NO_NEON keeps the C
+ * version only.
+ */
+#if defined(__ARM_NEON) && !defined(BS_NO_NEON) && !defined(BS_NEON)
+#define BS_NEON
+#endif
+
+#define BS_OK                   0
+#define BS_ERR_TRUNCATED        -1      /* the data ends inside a syntax element */
+#define BS_ERR_SYNTAX           -2      /* a value out of its range */
+#define BS_ERR_UNSUPPORTED      -3      /* valid, but not handled here */
+#define BS_ERR_MISSING          -4      /* refers to an SPS or PPS not seen */
+#define BS_ERR_FULL             -5      /* no room left in the index */
+
+/*---------------------------------------------------------------------------*/
+/* Start codes                                                               */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Offset of the first 0x01 byte at or after u32Pos that ends a start code,
+ * two or more zero bytes then 0x01, or u32Len if there is none.
+ *
+ * *pu32Zeros is the number of zero bytes right before pu8Data[u32Pos] on
+ * entry: 0 at the start of a stream, the value left by the call on the
+ * previous piece of a stream fed in pieces, 0 when continuing after a
+ * returned offset. On return it is the number of zero bytes before the
+ * returned offset, so the start code with its leading zeros begins
+ * *pu32Zeros bytes before it, possibly in an earlier piece.
+ */
+uint32_t bs_scan_start_code(const uint8_t *pu8Data, uint32_t u32Pos, uint32_t u32Len,
+                            uint32_t *pu32Zeros);
+
+/*---------------------------------------------------------------------------*/
+/* Bit reader                                                                */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Reads the RBSP of a NAL unit: emulation prevention bytes (0x03 after
+ * two zero bytes) are dropped as they are reached. Reading past the end
+ * returns zero bits and sets bOverrun.
+ */
+typedef struct
+{
+    const uint8_t *pu8Data;
+    uint32_t u32Len;
+    uint32_t u32Pos;            /* next byte to load */
+    uint32_t u32Zeros;          /* zero bytes loaded last */
+    uint32_t u32Bits;           /* bits in u64Cache */
+    uint64_t u64Cache;          /* bits not read yet, the next in bit 63 */
+    int      bOverrun;
+} BS_READER_T;
+
+void bs_reader_init(BS_READER_T *psReader, const uint8_t *pu8Data, uint32_t u32Len);
+
+/* u32Count bits, 0 to 32, the first one read as the most significant */
+uint32_t bs_read_bits(BS_READER_T *psReader, uint32_t u32Count);
+
+/* Exp-Golomb codes, ue(v) and se(v); values beyond 32 bits set bOverrun */
+uint32_t bs_read_ue(BS_READER_T *psReader);
+int32_t bs_read_se(BS_READER_T *psReader);
+
+/* Whether RBSP data is left before the stop bit, more_rbsp_data() */
+int bs_more_rbsp_data(const BS_READER_T *psReader);
+
+/*---------------------------------------------------------------------------*/
+/* H.264                                                                     */
+/*---------------------------------------------------------------------------*/
+
+#define BS_H264_NAL_SLICE       1
+#define BS_H264_NAL_IDR         5
+#define BS_H264_NAL_SEI         6
+#define BS_H264_NAL_SPS         7
+#define BS_H264_NAL_PPS         8
+#define BS_H264_NAL_AUD         9
+#define BS_H264_NAL_END_SEQ     10
+#define BS_H264_NAL_END_STREAM  11
+
+#define BS_H264_NAL_TYPE(b)     ((b) & 0x1F)
+#define BS_H264_NAL_REF_IDC(b)  (((b) >> 5) & 0x3)
+
+#define BS_H264_MAX_SPS         32
+#define BS_H264_MAX_PPS         256
+
+/* Slice types modulo 5 */
+#define BS_H264_SLICE_P         0
+#define BS_H264_SLICE_B         1
+#define BS_H264_SLICE_I         2
+#define BS_H264_SLICE_SP        3
+#define BS_H264_SLICE_SI        4
+
+typedef struct
+{
+    uint8_t  u8Valid;
+    uint8_t  u8ProfileIdc;
+    uint8_t  u8Constraints;             /* constraint_set0_flag in bit 7 */
+    uint8_t  u8LevelIdc;
+    uint8_t  u8SpsId;
+    uint8_t  u8ChromaFormatIdc;         /* 0 monochrome, 1 4:2:0, 2 4:2:2, 3 4:4:4 */
+    uint8_t  u8SeparateColourPlane;
+    uint8_t  u8BitDepthLuma;
+    uint8_t  u8BitDepthChroma;
+    uint8_t  u8ScalingMatrix;           /* seq_scaling_matrix_present_flag */
+    uint8_t  u8Log2MaxFrameNum;
+    uint8_t  u8PocType;
+    uint8_t  u8Log2MaxPocLsb;
+    uint8_t  u8DeltaPicOrderAlwaysZero;
+    uint8_t  u8MaxNumRefFrames;
+    uint8_t  u8FrameMbsOnly;
+    uint8_t  u8MbAdaptiveFrameField;
+    uint8_t  u8Direct8x8Inference;
+    uint16_t u16WidthMbs;               /* coded size in macroblocks */
+    uint16_t u16HeightMbs;              /* of a frame, both fields */
+    uint16_t u16CropLeft;               /* cropping in luma samples */
+    uint16_t u16CropRight;
+    uint16_t u16CropTop;
+    uint16_t u16CropBottom;
+    uint32_t u32Width;                  /* displayed size, after cropping */
+    uint32_t u32Height;
+    uint16_t u16SarWidth;               /* sample aspect ratio, 0 if not given */
+    uint16_t u16SarHeight;
+    uint8_t  u8FullRange;
+    uint8_t  u8FixedFrameRate;
+    uint32_t u32NumUnitsInTick;         /* VUI timing, 0 if not given */
+    uint32_t u32TimeScale;
+} BS_H264_SPS_T;
+
+typedef struct
+{
+    uint8_t  u8Valid;
+    uint8_t  u8PpsId;
+    uint8_t  u8SpsId;
+    uint8_t  u8EntropyCodingMode;       /* 1 for CABAC */
+    uint8_t  u8BottomFieldPicOrder;     /* bottom_field_pic_order_in_frame_present_flag */
+    uint8_t  u8NumSliceGroups;
+    uint8_t  u8NumRefIdxL0Default;
+    uint8_t  u8NumRefIdxL1Default;
+    uint8_t  u8WeightedPred;
+    uint8_t  u8WeightedBipredIdc;
+    int8_t   i8PicInitQp;
+    int8_t   i8ChromaQpOffset;
+    uint8_t  u8DeblockingControl;
+    uint8_t  u8ConstrainedIntraPred;
+    uint8_t  u8RedundantPicCnt;
+    uint8_t  u8Transform8x8;
+    int8_t   i8SecondChromaQpOffset;
+} BS_H264_PPS_T;
+
+/* The slice header up to the fields that tell pictures apart */
+typedef struct
+{
+    uint8_t  u8NalType;
+    uint8_t  u8NalRefIdc;
+    uint8_t  u8SliceType;               /* modulo 5, BS_H264_SLICE_x */
+    uint8_t  u8PpsId;
+    uint8_t  u8ColourPlane;
+    uint8_t  u8FieldPic;
+    uint8_t  u8BottomField;
+    uint32_t u32FirstMb;
+    uint32_t u32FrameNum;
+    uint32_t u32IdrPicId;
+    uint32_t u32PocLsb;
+    int32_t  i32DeltaPocBottom;
+    int32_t  ai32DeltaPoc[2];
+} BS_H264_SLICE_T;
+
+/* pu8Nal points to the NAL header byte, the start code excluded */
+int bs_h264_parse_sps(const uint8_t *pu8Nal, uint32_t u32Len, BS_H264_SPS_T *psSps);
+
+/* pasSps is indexed by SPS id; without the SPS, 4:2:0 is assumed */
+int bs_h264_parse_pps(const uint8_t *pu8Nal, uint32_t u32Len, const BS_H264_SPS_T *pasSps,
+                      BS_H264_PPS_T *psPps);
+
+int bs_h264_parse_slice(const uint8_t *pu8Nal, uint32_t u32Len, const BS_H264_SPS_T *pasSps,
+                        const BS_H264_PPS_T *pasPps, BS_H264_SLICE_T *psSlice);
+
+/* Whether psSlice starts a new picture after psPrev, H.264 7.4.1.2.4 */
+int bs_h264_new_picture(const BS_H264_SLICE_T *psPrev, const BS_H264_SLICE_T *psSlice,
+                        const BS_H264_SPS_T *psSps);
+
+/*---------------------------------------------------------------------------*/
+/* JPEG                                                                      */
+/*---------------------------------------------------------------------------*/
+
+typedef struct
+{
+    uint32_t u32Width;
+    uint32_t u32Height;
+    uint8_t  u8Sof;                     /* SOFn marker, 0xC0 baseline, 0xC2 progressive */
+    uint8_t  u8Precision;
+    uint8_t  u8Components;
+    uint8_t  au8Sampling[4];            /* H << 4 | V of each component */
+    uint8_t  u8Orientation;             /* EXIF orientation 1 to 8, 0 if none */
+    uint16_t u16RestartInterval;
+    uint32_t u32ScanOffset;             /* entropy coded data of the first scan, 0 if not reached */
+} BS_JPEG_INFO_T;
+
+/*
+ * Parse the markers from SOI to the first SOS. The data may end before
+ * the SOS, the file head is enough: BS_OK once the SOF has been read.
+ */
+int bs_jpeg_parse(const uint8_t *pu8Data, uint32_t u32Len, BS_JPEG_INFO_T *psInfo);
+
+/* Clockwise rotation in degrees that shows an image of EXIF orientation u8Orientation upright */
+uint32_t bs_jpeg_rotation(uint8_t u8Orientation);
+
+/*
+ * Frame boundaries of a JPEG stream fed in pieces, MJPEG being JPEG
+ * images back to back. Segments are skipped by their length, so the
+ * SOI/EOI of an EXIF thumbnail are not taken for those of a frame; bytes
+ * between frames are skipped.
+ */
+typedef struct
+{
+    uint32_t u32State;
+    uint32_t u32Marker;
+    uint32_t u32Skip;                   /* segment bytes left */
+    uint32_t u32SegLen;                 /* bytes in au8Seg */
+    uint8_t  au8Seg[8];                 /* start of the SOF segment */
+    uint64_t u64Pos;                    /* stream bytes fed */
+    uint64_t u64Start;                  /* offset of the SOI of the current frame */
+    uint64_t u64FrameOffset;            /* the last whole frame */
+    uint32_t u32FrameLen;
+    uint32_t u32Width;                  /* from the SOF of the current frame, 0 until it is read */
+    uint32_t u32Height;
+} BS_JPEG_SCAN_T;
+
+void bs_jpeg_scan_init(BS_JPEG_SCAN_T *psScan);
+
+/*
+ * Feed u32Len bytes. Stops after the EOI of a frame, returning 1 with the
+ * frame in u64FrameOffset, u32FrameLen, u32Width and u32Height, or at the
+ * end of the data, returning 0; *pu32Used is the number of bytes taken
+ * either way.
+ */
+int bs_jpeg_scan(BS_JPEG_SCAN_T *psScan, const uint8_t *pu8Data, uint32_t u32Len, uint32_t *pu32Used);
+
+/* Bytes of the JPEG image at pu8Data up to its EOI, 0 if it does not end within u32Len */
+uint32_t bs_jpeg_frame_len(const uint8_t *pu8Data, uint32_t u32Len);
+
+/*---------------------------------------------------------------------------*/
+/* Frame index                                                               */
+/*---------------------------------------------------------------------------*/
+
+#define BS_CODEC_H264           1
+#define BS_CODEC_MJPEG          2
+
+#define BS_INDEX_KEY            0x1     /* decoding can start here: IDR, JPEG */
+#define BS_INDEX_INTRA          0x2     /* the first slice is an I slice */
+
+typedef struct
+{
+    uint64_t u64Offset;                 /* first byte of the frame, its first start code */
+    uint32_t u32Flags;
+} BS_INDEX_ENTRY_T;
+
+/*
+ * One entry per frame, frame n being pasEntry[n]. The entries are the
+ * caller's; H.264 field pictures make an entry each.
+ */
+typedef struct
+{
+    BS_INDEX_ENTRY_T *pasEntry;
+    uint32_t u32Max;
+    uint32_t u32Count;
+    uint32_t u32Codec;
+    uint32_t u32Width;                  /* of the first frame, 0 if unknown */
+    uint32_t u32Height;
+    uint32_t u32RateNum;                /* frames per second as a fraction, 0 if unknown */
+    uint32_t u32RateDen;
+    uint64_t u64StreamLen;              /* set when the stream ends */
+    int      bOverflow;                 /* frames were dropped for lack of entries */
+} BS_INDEX_T;
+
+void bs_index_init(BS_INDEX_T *psIndex, uint32_t u32Codec, BS_INDEX_ENTRY_T *pasEntry, uint32_t u32Max);
+
+int bs_index_add(BS_INDEX_T *psIndex, uint64_t u64Offset, uint32_t u32Flags);
+
+/* The frame to start decoding at to show frame u32Frame: the last one at or before it with all of u32Flags, -1 if none */
+int32_t bs_index_seek(const BS_INDEX_T *psIndex, uint32_t u32Frame, uint32_t u32Flags);
+
+/* The frame holding stream offset u64Offset, -1 if before the first frame */
+int32_t bs_index_frame_at(const BS_INDEX_T *psIndex, uint64_t u64Offset);
+
+/* Bytes of frame u32Frame, to the next frame or the end of the stream */
+uint32_t bs_index_frame_len(const BS_INDEX_T *psIndex, uint32_t u32Frame);
+
+/*
+ * The index as a file: a 48 byte header, then 12 bytes per entry, little
+ * endian, each part with a CRC-32. The caller writes and reads the bytes.
+ */
+#define BS_INDEX_FILE_HEADER    48
+#define BS_INDEX_FILE_ENTRY     12
+#define BS_INDEX_FILE_SIZE(n)   (BS_INDEX_FILE_HEADER + (n) * BS_INDEX_FILE_ENTRY)
+
+/* Returns the bytes written, BS_ERR_FULL if u32Size is too small */
+int32_t bs_index_save(const BS_INDEX_T *psIndex, uint8_t *pu8Buf, uint32_t u32Size);
+
+/* Into the entries given to bs_index_init(); BS_ERR_FULL if there are too few, BS_ERR_SYNTAX if the file is damaged */
+int bs_index_load(BS_INDEX_T *psIndex, const uint8_t *pu8Buf, uint32_t u32Size);
+
+/*
+ * Index builders. Feed the whole stream from its start, in pieces of
+ * any size, then call the end function.
+ */
+#define BS_H264_HEAD_SIZE       1024    /* bytes of a NAL unit kept for parsing */
+
+typedef struct
+{
+    BS_INDEX_T      *psIndex;
+    BS_H264_SPS_T   asSps[BS_H264_MAX_SPS];
+    BS_H264_PPS_T   asPps[BS_H264_MAX_PPS];
+    BS_H264_SLICE_T sPrev;              /* first slice of the current picture */
+    uint64_t u64Pos;                    /* stream bytes fed */
+    uint64_t u64NalOffset;              /* start code of the NAL unit in au8Head */
+    uint64_t u64AuOffset;               /* start of the current access unit */
+    uint32_t u32Zeros;
+    uint32_t u32HeadLen;
+    int      bInNal;
+    int      bAuOpen;                   /* an access unit has started */
+    int      bVcl;                      /* and it has a slice */
+    uint8_t  au8Head[BS_H264_HEAD_SIZE];
+} BS_H264_INDEXER_T;
+
+void bs_h264_index_init(BS_H264_INDEXER_T *psIdx, BS_INDEX_T *psIndex);
+void bs_h264_index_feed(BS_H264_INDEXER_T *psIdx, const uint8_t *pu8Data, uint32_t u32Len);
+void bs_h264_index_end(BS_H264_INDEXER_T *psIdx);
+
+typedef struct
+{
+    BS_INDEX_T     *psIndex;
+    BS_JPEG_SCAN_T  sScan;
+} BS_JPEG_INDEXER_T;
+
+void bs_jpeg_index_init(BS_JPEG_INDEXER_T *psIdx, BS_INDEX_T *psIndex);
+void bs_jpeg_index_feed(BS_JPEG_INDEXER_T *psIdx, const uint8_t *pu8Data, uint32_t u32Len);
+void bs_jpeg_index_end(BS_JPEG_INDEXER_T *psIdx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BITSTREAM_H__ */
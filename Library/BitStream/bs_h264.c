@@ -0,0 +1,596 @@
+/**************************************************************************//**
+ * @file     bs_h264.c
+ *
+ * @brief    H.264 SPS, PPS and slice header parsing and the access unit
+ *           indexer.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+
+#include "bitstream.h"
+
+/* Profiles with chroma_format_idc and the rest of the high profile fields in the SPS */
+static int high_profile(uint8_t u8ProfileIdc)
+{
+    switch (u8ProfileIdc)
+    {
+    case 100: case 110: case 122: case 244: case 44: case 83:
+    case 86: case 118: case 128: case 138: case 139: case 134: case 135:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* scaling_list(), only skipped */
+static void skip_scaling_list(BS_READER_T *psReader, uint32_t u32Size)
+{
+    int32_t i32Last = 8, i32Next = 8;
+    uint32_t j;
+
+    for (j = 0; (j < u32Size) && !psReader->bOverrun; j++)
+    {
+        if (i32Next != 0)
+        {
+            i32Next = (int32_t)(((uint32_t)i32Last + (uint32_t)bs_read_se(psReader)) & 0xFF);
+            if (i32Next == 0 && j == 0)
+                break;      /* useDefaultScalingMatrixFlag */
+        }
+        i32Last = (i32Next == 0) ? i32Last : i32Next;
+    }
+}
+
+static void skip_scaling_matrix(BS_READER_T *psReader, uint32_t u32Lists)
+{
+    uint32_t i;
+
+    for (i = 0; i < u32Lists; i++)
+    {
+        if (bs_read_bits(psReader, 1))
+            skip_scaling_list(psReader, (i < 6) ? 16 : 64);
+    }
+}
+
+/* vui_parameters() up to the timing information */
+static void parse_vui(BS_READER_T *psReader, BS_H264_SPS_T *psSps)
+{
+    uint32_t u32Aspect;
+
+    if (bs_read_bits(psReader, 1))                  /* aspect_ratio_info_present_flag */
+    {
+        static const uint8_t au8Sar[17][2] =
+        {
+            { 0, 0 }, { 1, 1 }, { 12, 11 }, { 10, 11 }, { 16, 11 }, { 40, 33 }, { 24, 11 },
+            { 20, 11 }, { 32, 11 }, { 80, 33 }, { 18, 11 }, { 15, 11 }, { 64, 33 },
+            { 160, 99 }, { 4, 3 }, { 3, 2 }, { 2, 1 }
+        };
+
+        u32Aspect = bs_read_bits(psReader, 8);
+        if (u32Aspect == 255)
+        {
+            psSps->u16SarWidth = (uint16_t)bs_read_bits(psReader, 16);
+            psSps->u16SarHeight = (uint16_t)bs_read_bits(psReader, 16);
+        }
+        else if (u32Aspect < 17)
+        {
+            psSps->u16SarWidth = au8Sar[u32Aspect][0];
+            psSps->u16SarHeight = au8Sar[u32Aspect][1];
+        }
+    }
+
+    if (bs_read_bits(psReader, 1))                  /* overscan_info_present_flag */
+        bs_read_bits(psReader, 1);
+
+    if (bs_read_bits(psReader, 1))                  /* video_signal_type_present_flag */
+    {
+        bs_read_bits(psReader, 3);
+        psSps->u8FullRange = (uint8_t)bs_read_bits(psReader, 1);
+        if (bs_read_bits(psReader, 1))              /* colour_description_present_flag */
+            bs_read_bits(psReader, 24);
+    }
+
+    if (bs_read_bits(psReader, 1))                  /* chroma_loc_info_present_flag */
+    {
+        bs_read_ue(psReader);
+        bs_read_ue(psReader);
+    }
+
+    if (bs_read_bits(psReader, 1))                  /* timing_info_present_flag */
+    {
+        psSps->u32NumUnitsInTick = bs_read_bits(psReader, 32);
+        psSps->u32TimeScale = bs_read_bits(psReader, 32);
+        psSps->u8FixedFrameRate = (uint8_t)bs_read_bits(psReader, 1);
+    }
+}
+
+int bs_h264_parse_sps(const uint8_t *pu8Nal, uint32_t u32Len, BS_H264_SPS_T *psSps)
+{
+    BS_READER_T sReader, *r = &sReader;
+    uint32_t u32Val, u32CropX, u32CropY, u32SubW = 2, u32SubH = 2, u32Height;
+
+    memset(psSps, 0, sizeof(*psSps));
+    if ((u32Len < 1) || (BS_H264_NAL_TYPE(pu8Nal[0]) != BS_H264_NAL_SPS))
+        return BS_ERR_SYNTAX;
+
+    bs_reader_init(r, pu8Nal + 1, u32Len - 1);
+
+    psSps->u8ProfileIdc = (uint8_t)bs_read_bits(r, 8);
+    psSps->u8Constraints = (uint8_t)bs_read_bits(r, 8);
+    psSps->u8LevelIdc = (uint8_t)bs_read_bits(r, 8);
+    u32Val = bs_read_ue(r);
+    if (u32Val >= BS_H264_MAX_SPS)
+        return r->bOverrun ? BS_ERR_TRUNCATED : BS_ERR_SYNTAX;
+    psSps->u8SpsId = (uint8_t)u32Val;
+
+    psSps->u8ChromaFormatIdc = 1;
+    psSps->u8BitDepthLuma = 8;
+    psSps->u8BitDepthChroma = 8;
+    if (high_profile(psSps->u8ProfileIdc))
+    {
+        u32Val = bs_read_ue(r);
+        if (u32Val > 3)
+            return BS_ERR_SYNTAX;
+        psSps->u8ChromaFormatIdc = (uint8_t)u32Val;
+        if (u32Val == 3)
+            psSps->u8SeparateColourPlane = (uint8_t)bs_read_bits(r, 1);
+
+        u32Val = bs_read_ue(r);
+        if (u32Val > 6)
+            return BS_ERR_SYNTAX;
+        psSps->u8BitDepthLuma = (uint8_t)(u32Val + 8);
+        u32Val = bs_read_ue(r);
+        if (u32Val > 6)
+            return BS_ERR_SYNTAX;
+        psSps->u8BitDepthChroma = (uint8_t)(u32Val + 8);
+
+        bs_read_bits(r, 1);                         /* qpprime_y_zero_transform_bypass_flag */
+        psSps->u8ScalingMatrix = (uint8_t)bs_read_bits(r, 1);
+        if (psSps->u8ScalingMatrix)
+            skip_scaling_matrix(r, (psSps->u8ChromaFormatIdc != 3) ? 8 : 12);
+    }
+
+    u32Val = bs_read_ue(r);
+    if (u32Val > 12)
+        return BS_ERR_SYNTAX;
+    psSps->u8Log2MaxFrameNum = (uint8_t)(u32Val + 4);
+
+    u32Val = bs_read_ue(r);
+    if (u32Val > 2)
+        return BS_ERR_SYNTAX;
+    psSps->u8PocType = (uint8_t)u32Val;
+    if (psSps->u8PocType == 0)
+    {
+        u32Val = bs_read_ue(r);
+        if (u32Val > 12)
+            return BS_ERR_SYNTAX;
+        psSps->u8Log2MaxPocLsb = (uint8_t)(u32Val + 4);
+    }
+    else if (psSps->u8PocType == 1)
+    {
+        psSps->u8DeltaPicOrderAlwaysZero = (uint8_t)bs_read_bits(r, 1);
+        bs_read_se(r);                              /* offset_for_non_ref_pic */
+        bs_read_se(r);                              /* offset_for_top_to_bottom_field */
+        u32Val = bs_read_ue(r);
+        if (u32Val > 255)
+            return BS_ERR_SYNTAX;
+        while (u32Val-- && !r->bOverrun)
+            bs_read_se(r);                          /* offset_for_ref_frame[] */
+    }
+
+    u32Val = bs_read_ue(r);
+    if (u32Val > 16)
+        return BS_ERR_SYNTAX;
+    psSps->u8MaxNumRefFrames = (uint8_t)u32Val;
+    bs_read_bits(r, 1);                             /* gaps_in_frame_num_value_allowed_flag */
+
+    u32Val = bs_read_ue(r);
+    if (u32Val > 1023)
+        return BS_ERR_UNSUPPORTED;
+    psSps->u16WidthMbs = (uint16_t)(u32Val + 1);
+    u32Val = bs_read_ue(r);
+    if (u32Val > 1023)
+        return BS_ERR_UNSUPPORTED;
+    psSps->u8FrameMbsOnly = (uint8_t)bs_read_bits(r, 1);
+    psSps->u16HeightMbs = (uint16_t)((u32Val + 1) * (2 - psSps->u8FrameMbsOnly));
+    if (!psSps->u8FrameMbsOnly)
+        psSps->u8MbAdaptiveFrameField = (uint8_t)bs_read_bits(r, 1);
+    psSps->u8Direct8x8Inference = (uint8_t)bs_read_bits(r, 1);
+
+    /* Crop units of ChromaArrayType, 0 for monochrome and separate planes */
+    if (psSps->u8SeparateColourPlane || (psSps->u8ChromaFormatIdc == 0))
+        u32SubW = u32SubH = 1;
+    else if (psSps->u8ChromaFormatIdc == 2)
+        u32SubH = 1;
+    else if (psSps->u8ChromaFormatIdc == 3)
+        u32SubW = u32SubH = 1;
+    u32CropX = u32SubW;
+    u32CropY = u32SubH * (2 - psSps->u8FrameMbsOnly);
+
+    psSps->u32Width = psSps->u16WidthMbs * 16;
+    u32Height = psSps->u16HeightMbs * 16;
+    if (bs_read_bits(r, 1))                         /* frame_cropping_flag */
+    {
+        uint32_t au32Crop[4], i;
+
+        for (i = 0; i < 4; i++)
+        {
+            au32Crop[i] = bs_read_ue(r);
+            if (au32Crop[i] > 0x4000)
+                return BS_ERR_SYNTAX;
+        }
+        au32Crop[0] *= u32CropX;
+        au32Crop[1] *= u32CropX;
+        au32Crop[2] *= u32CropY;
+        au32Crop[3] *= u32CropY;
+        if ((au32Crop[0] + au32Crop[1] >= psSps->u32Width) || (au32Crop[2] + au32Crop[3] >= u32Height))
+            return BS_ERR_SYNTAX;
+
+        psSps->u16CropLeft = (uint16_t)au32Crop[0];
+        psSps->u16CropRight = (uint16_t)au32Crop[1];
+        psSps->u16CropTop = (uint16_t)au32Crop[2];
+        psSps->u16CropBottom = (uint16_t)au32Crop[3];
+        psSps->u32Width -= au32Crop[0] + au32Crop[1];
+        u32Height -= au32Crop[2] + au32Crop[3];
+    }
+    psSps->u32Height = u32Height;
+
+    if (bs_read_bits(r, 1))                         /* vui_parameters_present_flag */
+        parse_vui(r, psSps);
+
+    if (r->bOverrun)
+        return BS_ERR_TRUNCATED;
+
+    psSps->u8Valid = 1;
+    return BS_OK;
+}
+
+int bs_h264_parse_pps(const uint8_t *pu8Nal, uint32_t u32Len, const BS_H264_SPS_T *pasSps,
+                      BS_H264_PPS_T *psPps)
+{
+    BS_READER_T sReader, *r = &sReader;
+    const BS_H264_SPS_T *psSps;
+    uint32_t u32Val, u32Groups, i, u32Bits;
+    int32_t i32Val;
+
+    memset(psPps, 0, sizeof(*psPps));
+    if ((u32Len < 1) || (BS_H264_NAL_TYPE(pu8Nal[0]) != BS_H264_NAL_PPS))
+        return BS_ERR_SYNTAX;
+
+    bs_reader_init(r, pu8Nal + 1, u32Len - 1);
+
+    u32Val = bs_read_ue(r);
+    if (u32Val >= BS_H264_MAX_PPS)
+        return r->bOverrun ? BS_ERR_TRUNCATED : BS_ERR_SYNTAX;
+    psPps->u8PpsId = (uint8_t)u32Val;
+    u32Val = bs_read_ue(r);
+    if (u32Val >= BS_H264_MAX_SPS)
+        return r->bOverrun ? BS_ERR_TRUNCATED : BS_ERR_SYNTAX;
+    psPps->u8SpsId = (uint8_t)u32Val;
+    psSps = (pasSps && pasSps[u32Val].u8Valid) ? &pasSps[u32Val] : NULL;
+
+    psPps->u8EntropyCodingMode = (uint8_t)bs_read_bits(r, 1);
+    psPps->u8BottomFieldPicOrder = (uint8_t)bs_read_bits(r, 1);
+
+    u32Groups = bs_read_ue(r) + 1;
+    if (u32Groups > 8)
+        return BS_ERR_SYNTAX;
+    psPps->u8NumSliceGroups = (uint8_t)u32Groups;
+    if (u32Groups > 1)
+    {
+        u32Val = bs_read_ue(r);                     /* slice_group_map_type */
+        if (u32Val == 0)
+        {
+            for (i = 0; i < u32Groups; i++)
+                bs_read_ue(r);                      /* run_length_minus1[] */
+        }
+        else if (u32Val == 2)
+        {
+            for (i = 0; i < 2 * (u32Groups - 1); i++)
+                bs_read_ue(r);                      /* top_left[], bottom_right[] */
+        }
+        else if ((u32Val >= 3) && (u32Val <= 5))
+        {
+            bs_read_bits(r, 1);
+            bs_read_ue(r);
+        }
+        else if (u32Val == 6)
+        {
+            u32Val = bs_read_ue(r) + 1;             /* pic_size_in_map_units */
+            if (u32Val > 1024 * 1024)
+                return BS_ERR_SYNTAX;
+            for (u32Bits = 0; (1u << u32Bits) < u32Groups; u32Bits++)
+                ;
+            for (i = 0; (i < u32Val) && !r->bOverrun; i++)
+                bs_read_bits(r, u32Bits);
+        }
+        else if (u32Val > 6)
+        {
+            return BS_ERR_SYNTAX;
+        }
+    }
+
+    u32Val = bs_read_ue(r);
+    if (u32Val > 31)
+        return BS_ERR_SYNTAX;
+    psPps->u8NumRefIdxL0Default = (uint8_t)(u32Val + 1);
+    u32Val = bs_read_ue(r);
+    if (u32Val > 31)
+        return BS_ERR_SYNTAX;
+    psPps->u8NumRefIdxL1Default = (uint8_t)(u32Val + 1);
+    psPps->u8WeightedPred = (uint8_t)bs_read_bits(r, 1);
+    psPps->u8WeightedBipredIdc = (uint8_t)bs_read_bits(r, 2);
+
+    i32Val = bs_read_se(r);
+    if ((i32Val < -26 - 48) || (i32Val > 25))
+        return BS_ERR_SYNTAX;
+    psPps->i8PicInitQp = (int8_t)(i32Val + 26);
+    bs_read_se(r);                                  /* pic_init_qs_minus26 */
+    i32Val = bs_read_se(r);
+    if ((i32Val < -12) || (i32Val > 12))
+        return BS_ERR_SYNTAX;
+    psPps->i8ChromaQpOffset = (int8_t)i32Val;
+    psPps->i8SecondChromaQpOffset = (int8_t)i32Val;
+
+    psPps->u8DeblockingControl = (uint8_t)bs_read_bits(r, 1);
+    psPps->u8ConstrainedIntraPred = (uint8_t)bs_read_bits(r, 1);
+    psPps->u8RedundantPicCnt = (uint8_t)bs_read_bits(r, 1);
+
+    if (bs_more_rbsp_data(r))
+    {
+        psPps->u8Transform8x8 = (uint8_t)bs_read_bits(r, 1);
+        if (bs_read_bits(r, 1))                     /* pic_scaling_matrix_present_flag */
+        {
+            u32Val = (psSps && (psSps->u8ChromaFormatIdc == 3)) ? 6 : 2;
+            skip_scaling_matrix(r, 6 + u32Val * psPps->u8Transform8x8);
+        }
+        i32Val = bs_read_se(r);
+        if ((i32Val < -12) || (i32Val > 12))
+            return BS_ERR_SYNTAX;
+        psPps->i8SecondChromaQpOffset = (int8_t)i32Val;
+    }
+
+    if (r->bOverrun)
+        return BS_ERR_TRUNCATED;
+
+    psPps->u8Valid = 1;
+    return BS_OK;
+}
+
+int bs_h264_parse_slice(const uint8_t *pu8Nal, uint32_t u32Len, const BS_H264_SPS_T *pasSps,
+                        const BS_H264_PPS_T *pasPps, BS_H264_SLICE_T *psSlice)
+{
+    BS_READER_T sReader, *r = &sReader;
+    const BS_H264_SPS_T *psSps;
+    const BS_H264_PPS_T *psPps;
+    uint32_t u32Val;
+
+    memset(psSlice, 0, sizeof(*psSlice));
+    if (u32Len < 1)
+        return BS_ERR_TRUNCATED;
+
+    psSlice->u8NalType = BS_H264_NAL_TYPE(pu8Nal[0]);
+    psSlice->u8NalRefIdc = BS_H264_NAL_REF_IDC(pu8Nal[0]);
+    if ((psSlice->u8NalType != BS_H264_NAL_SLICE) && (psSlice->u8NalType != BS_H264_NAL_IDR))
+        return BS_ERR_SYNTAX;
+
+    bs_reader_init(r, pu8Nal + 1, u32Len - 1);
+
+    psSlice->u32FirstMb = bs_read_ue(r);
+    u32Val = bs_read_ue(r);
+    if (u32Val > 9)
+        return r->bOverrun ? BS_ERR_TRUNCATED : BS_ERR_SYNTAX;
+    psSlice->u8SliceType = (uint8_t)(u32Val % 5);
+    u32Val = bs_read_ue(r);
+    if (u32Val >= BS_H264_MAX_PPS)
+        return r->bOverrun ? BS_ERR_TRUNCATED : BS_ERR_SYNTAX;
+    psSlice->u8PpsId = (uint8_t)u32Val;
+    if (r->bOverrun)
+        return BS_ERR_TRUNCATED;
+
+    psPps = &pasPps[u32Val];
+    if (!psPps->u8Valid || !pasSps[psPps->u8SpsId].u8Valid)
+        return BS_ERR_MISSING;
+    psSps = &pasSps[psPps->u8SpsId];
+
+    if (psSps->u8SeparateColourPlane)
+        psSlice->u8ColourPlane = (uint8_t)bs_read_bits(r, 2);
+    psSlice->u32FrameNum = bs_read_bits(r, psSps->u8Log2MaxFrameNum);
+    if (!psSps->u8FrameMbsOnly)
+    {
+        psSlice->u8FieldPic = (uint8_t)bs_read_bits(r, 1);
+        if (psSlice->u8FieldPic)
+            psSlice->u8BottomField = (uint8_t)bs_read_bits(r, 1);
+    }
+    if (psSlice->u8NalType == BS_H264_NAL_IDR)
+        psSlice->u32IdrPicId = bs_read_ue(r);
+
+    if (psSps->u8PocType == 0)
+    {
+        psSlice->u32PocLsb = bs_read_bits(r, psSps->u8Log2MaxPocLsb);
+        if (psPps->u8BottomFieldPicOrder && !psSlice->u8FieldPic)
+            psSlice->i32DeltaPocBottom = bs_read_se(r);
+    }
+    else if ((psSps->u8PocType == 1) && !psSps->u8DeltaPicOrderAlwaysZero)
+    {
+        psSlice->ai32DeltaPoc[0] = bs_read_se(r);
+        if (psPps->u8BottomFieldPicOrder && !psSlice->u8FieldPic)
+            psSlice->ai32DeltaPoc[1] = bs_read_se(r);
+    }
+
+    if (r->bOverrun)
+        return BS_ERR_TRUNCATED;
+    if (psSlice->u32FirstMb >= (uint32_t)psSps->u16WidthMbs * psSps->u16HeightMbs)
+        return BS_ERR_SYNTAX;
+
+    return BS_OK;
+}
+
+int bs_h264_new_picture(const BS_H264_SLICE_T *psPrev, const BS_H264_SLICE_T *psSlice,
+                        const BS_H264_SPS_T *psSps)
+{
+    int bIdr = (psSlice->u8NalType == BS_H264_NAL_IDR);
+
+    if ((psSlice->u32FrameNum != psPrev->u32FrameNum) ||
+            (psSlice->u8PpsId != psPrev->u8PpsId) ||
+            (psSlice->u8FieldPic != psPrev->u8FieldPic) ||
+            (psSlice->u8BottomField != psPrev->u8BottomField) ||
+            ((psSlice->u8NalRefIdc == 0) != (psPrev->u8NalRefIdc == 0)) ||
+            (bIdr != (psPrev->u8NalType == BS_H264_NAL_IDR)) ||
+            (bIdr && (psSlice->u32IdrPicId != psPrev->u32IdrPicId)))
+        return 1;
+
+    if ((psSps->u8PocType == 0) &&
+            ((psSlice->u32PocLsb != psPrev->u32PocLsb) ||
+             (psSlice->i32DeltaPocBottom != psPrev->i32DeltaPocBottom)))
+        return 1;
+
+    if ((psSps->u8PocType == 1) &&
+            ((psSlice->ai32DeltaPoc[0] != psPrev->ai32DeltaPoc[0]) ||
+             (psSlice->ai32DeltaPoc[1] != psPrev->ai32DeltaPoc[1])))
+        return 1;
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Access unit indexer                                                       */
+/*---------------------------------------------------------------------------*/
+
+void bs_h264_index_init(BS_H264_INDEXER_T *psIdx, BS_INDEX_T *psIndex)
+{
+    memset(psIdx, 0, sizeof(*psIdx));
+    psIdx->psIndex = psIndex;
+}
+
+static void index_frame(BS_H264_INDEXER_T *psIdx, const BS_H264_SLICE_T *psSlice)
+{
+    const BS_H264_SPS_T *psSps = &psIdx->asSps[psIdx->asPps[psSlice->u8PpsId].u8SpsId];
+    BS_INDEX_T *psIndex = psIdx->psIndex;
+    uint32_t u32Flags = 0;
+
+    if (psSlice->u8NalType == BS_H264_NAL_IDR)
+        u32Flags |= BS_INDEX_KEY;
+    if ((psSlice->u8SliceType == BS_H264_SLICE_I) || (psSlice->u8SliceType == BS_H264_SLICE_SI))
+        u32Flags |= BS_INDEX_INTRA;
+
+    if (psIndex->u32Width == 0)
+    {
+        psIndex->u32Width = psSps->u32Width;
+        psIndex->u32Height = psSps->u32Height;
+        if (psSps->u32NumUnitsInTick && psSps->u32TimeScale)
+        {
+            /* a tick is a field */
+            psIndex->u32RateNum = psSps->u32TimeScale;
+            psIndex->u32RateDen = psSps->u32NumUnitsInTick * 2;
+        }
+    }
+
+    bs_index_add(psIndex, psIdx->u64AuOffset, u32Flags);
+}
+
+/* The NAL unit whose start code is at u64Offset, its first u32Len bytes in pu8Nal */
+static void index_nal(BS_H264_INDEXER_T *psIdx, uint64_t u64Offset, const uint8_t *pu8Nal, uint32_t u32Len)
+{
+    BS_H264_SLICE_T sSlice;
+    BS_H264_SPS_T sSps;
+    BS_H264_PPS_T sPps;
+    uint32_t u32Type;
+
+    if (u32Len < 1)
+        return;
+
+    u32Type = BS_H264_NAL_TYPE(pu8Nal[0]);
+    switch (u32Type)
+    {
+    case BS_H264_NAL_SLICE:
+    case BS_H264_NAL_IDR:
+        if (bs_h264_parse_slice(pu8Nal, u32Len, psIdx->asSps, psIdx->asPps, &sSlice) != BS_OK)
+            return;     /* part of whatever picture came before */
+
+        if (psIdx->bVcl)
+        {
+            if (!bs_h264_new_picture(&psIdx->sPrev, &sSlice, &psIdx->asSps[psIdx->asPps[sSlice.u8PpsId].u8SpsId]))
+                return;
+            psIdx->u64AuOffset = u64Offset;
+        }
+        else if (!psIdx->bAuOpen)
+        {
+            psIdx->u64AuOffset = u64Offset;
+        }
+        psIdx->sPrev = sSlice;
+        psIdx->bAuOpen = 1;
+        psIdx->bVcl = 1;
+        index_frame(psIdx, &sSlice);
+        return;
+
+    case BS_H264_NAL_SPS:
+        if (bs_h264_parse_sps(pu8Nal, u32Len, &sSps) == BS_OK)
+            psIdx->asSps[sSps.u8SpsId] = sSps;
+        break;
+
+    case BS_H264_NAL_PPS:
+        if (bs_h264_parse_pps(pu8Nal, u32Len, psIdx->asSps, &sPps) == BS_OK)
+            psIdx->asPps[sPps.u8PpsId] = sPps;
+        break;
+
+    case BS_H264_NAL_SEI:
+    case BS_H264_NAL_AUD:
+    case 15: case 16: case 17: case 18:
+        break;
+
+    default:
+        return;         /* does not start an access unit */
+    }
+
+    /* After the slices of a picture, these start the next access unit */
+    if (psIdx->bVcl || !psIdx->bAuOpen)
+    {
+        psIdx->u64AuOffset = u64Offset;
+        psIdx->bAuOpen = 1;
+        psIdx->bVcl = 0;
+    }
+}
+
+void bs_h264_index_feed(BS_H264_INDEXER_T *psIdx, const uint8_t *pu8Data, uint32_t u32Len)
+{
+    uint32_t u32Pos = 0, u32Next, u32Copy;
+
+    while (u32Pos < u32Len)
+    {
+        u32Next = bs_scan_start_code(pu8Data, u32Pos, u32Len, &psIdx->u32Zeros);
+
+        /* The head of the NAL unit in progress, its trailing zeros included */
+        if (psIdx->bInNal && (psIdx->u32HeadLen < BS_H264_HEAD_SIZE))
+        {
+            u32Copy = u32Next - u32Pos;
+            if (u32Copy > BS_H264_HEAD_SIZE - psIdx->u32HeadLen)
+                u32Copy = BS_H264_HEAD_SIZE - psIdx->u32HeadLen;
+            memcpy(psIdx->au8Head + psIdx->u32HeadLen, pu8Data + u32Pos, u32Copy);
+            psIdx->u32HeadLen += u32Copy;
+        }
+
+        if (u32Next == u32Len)
+            break;
+
+        if (psIdx->bInNal)
+            index_nal(psIdx, psIdx->u64NalOffset, psIdx->au8Head, psIdx->u32HeadLen);
+
+        psIdx->u64NalOffset = psIdx->u64Pos + u32Next - psIdx->u32Zeros;
+        psIdx->u32HeadLen = 0;
+        psIdx->bInNal = 1;
+        psIdx->u32Zeros = 0;
+        u32Pos = u32Next + 1;
+    }
+
+    psIdx->u64Pos += u32Len;
+}
+
+void bs_h264_index_end(BS_H264_INDEXER_T *psIdx)
+{
+    if (psIdx->bInNal)
+        index_nal(psIdx, psIdx->u64NalOffset, psIdx->au8Head, psIdx->u32HeadLen);
+    psIdx->bInNal = 0;
+    psIdx->psIndex->u64StreamLen = psIdx->u64Pos;
+}
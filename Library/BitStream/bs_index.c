@@ -0,0 +1,193 @@
+/**************************************************************************//**
+ * @file     bs_index.c
+ *
+ * @brief    Frame index: seeking and the index file.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+
+#include "bitstream.h"
+
+#define INDEX_MAGIC     0x58495342      /* "BSIX" */
+#define INDEX_VERSION   1
+
+void bs_index_init(BS_INDEX_T *psIndex, uint32_t u32Codec, BS_INDEX_ENTRY_T *pasEntry, uint32_t u32Max)
+{
+    memset(psIndex, 0, sizeof(*psIndex));
+    psIndex->u32Codec = u32Codec;
+    psIndex->pasEntry = pasEntry;
+    psIndex->u32Max = u32Max;
+}
+
+int bs_index_add(BS_INDEX_T *psIndex, uint64_t u64Offset, uint32_t u32Flags)
+{
+    if (psIndex->u32Count >= psIndex->u32Max)
+    {
+        psIndex->bOverflow = 1;
+        return BS_ERR_FULL;
+    }
+
+    psIndex->pasEntry[psIndex->u32Count].u64Offset = u64Offset;
+    psIndex->pasEntry[psIndex->u32Count].u32Flags = u32Flags;
+    psIndex->u32Count++;
+    return BS_OK;
+}
+
+int32_t bs_index_seek(const BS_INDEX_T *psIndex, uint32_t u32Frame, uint32_t u32Flags)
+{
+    int32_t i;
+
+    if (psIndex->u32Count == 0)
+        return -1;
+    if (u32Frame >= psIndex->u32Count)
+        u32Frame = psIndex->u32Count - 1;
+
+    for (i = (int32_t)u32Frame; i >= 0; i--)
+    {
+        if ((psIndex->pasEntry[i].u32Flags & u32Flags) == u32Flags)
+            return i;
+    }
+    return -1;
+}
+
+int32_t bs_index_frame_at(const BS_INDEX_T *psIndex, uint64_t u64Offset)
+{
+    uint32_t u32Lo = 0, u32Hi = psIndex->u32Count, u32Mid;
+
+    /* The first frame starting after u64Offset, then the one before it */
+    while (u32Lo < u32Hi)
+    {
+        u32Mid = u32Lo + (u32Hi - u32Lo) / 2;
+        if (psIndex->pasEntry[u32Mid].u64Offset <= u64Offset)
+            u32Lo = u32Mid + 1;
+        else
+            u32Hi = u32Mid;
+    }
+    return (int32_t)u32Lo - 1;
+}
+
+uint32_t bs_index_frame_len(const BS_INDEX_T *psIndex, uint32_t u32Frame)
+{
+    uint64_t u64End;
+
+    if (u32Frame >= psIndex->u32Count)
+        return 0;
+
+    u64End = (u32Frame + 1 < psIndex->u32Count) ? psIndex->pasEntry[u32Frame + 1].u64Offset : psIndex->u64StreamLen;
+    if (u64End < psIndex->pasEntry[u32Frame].u64Offset)
+        return 0;
+    return (uint32_t)(u64End - psIndex->pasEntry[u32Frame].u64Offset);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Index file                                                                */
+/*---------------------------------------------------------------------------*/
+
+/* CRC-32 (IEEE 802.3), four bits at a time */
+static uint32_t crc32(uint32_t u32Crc, const uint8_t *pu8Data, uint32_t u32Len)
+{
+    static const uint32_t au32Table[16] =
+    {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    u32Crc = ~u32Crc;
+    while (u32Len--)
+    {
+        u32Crc ^= *pu8Data++;
+        u32Crc = (u32Crc >> 4) ^ au32Table[u32Crc & 0xF];
+        u32Crc = (u32Crc >> 4) ^ au32Table[u32Crc & 0xF];
+    }
+    return ~u32Crc;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/*
+ * Header:
+ *   0  "BSIX"              24  frame rate numerator
+ *   4  version             28  frame rate denominator
+ *   8  codec               32  stream length, 64 bits
+ *  12  entries             40  CRC-32 of the entries
+ *  16  width               44  CRC-32 of bytes 0 to 43
+ *  20  height
+ * Entry: offset, 64 bits, then flags.
+ */
+int32_t bs_index_save(const BS_INDEX_T *psIndex, uint8_t *pu8Buf, uint32_t u32Size)
+{
+    uint8_t *p = pu8Buf + BS_INDEX_FILE_HEADER;
+    uint32_t i;
+
+    if ((psIndex->u32Count > (0x7FFFFFFF - BS_INDEX_FILE_HEADER) / BS_INDEX_FILE_ENTRY) ||
+            (u32Size < BS_INDEX_FILE_SIZE(psIndex->u32Count)))
+        return BS_ERR_FULL;
+
+    for (i = 0; i < psIndex->u32Count; i++, p += BS_INDEX_FILE_ENTRY)
+    {
+        put32(p, (uint32_t)psIndex->pasEntry[i].u64Offset);
+        put32(p + 4, (uint32_t)(psIndex->pasEntry[i].u64Offset >> 32));
+        put32(p + 8, psIndex->pasEntry[i].u32Flags);
+    }
+
+    put32(pu8Buf, INDEX_MAGIC);
+    put32(pu8Buf + 4, INDEX_VERSION);
+    put32(pu8Buf + 8, psIndex->u32Codec);
+    put32(pu8Buf + 12, psIndex->u32Count);
+    put32(pu8Buf + 16, psIndex->u32Width);
+    put32(pu8Buf + 20, psIndex->u32Height);
+    put32(pu8Buf + 24, psIndex->u32RateNum);
+    put32(pu8Buf + 28, psIndex->u32RateDen);
+    put32(pu8Buf + 32, (uint32_t)psIndex->u64StreamLen);
+    put32(pu8Buf + 36, (uint32_t)(psIndex->u64StreamLen >> 32));
+    put32(pu8Buf + 40, crc32(0, pu8Buf + BS_INDEX_FILE_HEADER, psIndex->u32Count * BS_INDEX_FILE_ENTRY));
+    put32(pu8Buf + 44, crc32(0, pu8Buf, 44));
+
+    return (int32_t)BS_INDEX_FILE_SIZE(psIndex->u32Count);
+}
+
+int bs_index_load(BS_INDEX_T *psIndex, const uint8_t *pu8Buf, uint32_t u32Size)
+{
+    const uint8_t *p = pu8Buf + BS_INDEX_FILE_HEADER;
+    uint32_t u32Count, i;
+
+    if ((u32Size < BS_INDEX_FILE_HEADER) || (get32(pu8Buf) != INDEX_MAGIC) ||
+            (get32(pu8Buf + 4) != INDEX_VERSION) || (get32(pu8Buf + 44) != crc32(0, pu8Buf, 44)))
+        return BS_ERR_SYNTAX;
+
+    u32Count = get32(pu8Buf + 12);
+    if ((u32Count > (u32Size - BS_INDEX_FILE_HEADER) / BS_INDEX_FILE_ENTRY) ||
+            (get32(pu8Buf + 40) != crc32(0, p, u32Count * BS_INDEX_FILE_ENTRY)))
+        return BS_ERR_SYNTAX;
+    if (u32Count > psIndex->u32Max)
+        return BS_ERR_FULL;
+
+    for (i = 0; i < u32Count; i++, p += BS_INDEX_FILE_ENTRY)
+    {
+        psIndex->pasEntry[i].u64Offset = get32(p) | (uint64_t)get32(p + 4) << 32;
+        psIndex->pasEntry[i].u32Flags = get32(p + 8);
+    }
+
+    psIndex->u32Count = u32Count;
+    psIndex->u32Codec = get32(pu8Buf + 8);
+    psIndex->u32Width = get32(pu8Buf + 16);
+    psIndex->u32Height = get32(pu8Buf + 20);
+    psIndex->u32RateNum = get32(pu8Buf + 24);
+    psIndex->u32RateDen = get32(pu8Buf + 28);
+    psIndex->u64StreamLen = get32(pu8Buf + 32) | (uint64_t)get32(pu8Buf + 36) << 32;
+    psIndex->bOverflow = 0;
+    return BS_OK;
+}
@@ -0,0 +1,370 @@
+/**************************************************************************//**
+ * @file     bs_jpeg.c
+ *
+ * @brief    JPEG header and EXIF orientation parsing, and JPEG/MJPEG frame
+ *           boundaries.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+
+#include "bitstream.h"
+
+#define M_SOI           0xD8
+#define M_EOI           0xD9
+#define M_SOS           0xDA
+#define M_DRI           0xDD
+#define M_APP1          0xE1
+
+#define EXIF_ORIENTATION    0x0112
+
+/* SOF0 to SOF15, which leave out DHT, JPG and DAC */
+#define IS_SOF(m)       (((m) >= 0xC0) && ((m) <= 0xCF) && ((m) != 0xC4) && ((m) != 0xC8) && ((m) != 0xCC))
+
+/* Markers without a segment */
+#define IS_STANDALONE(m) (((m) == 0x01) || (((m) >= 0xD0) && ((m) <= 0xD7)))
+
+static uint32_t get16(const uint8_t *p, int bBig)
+{
+    return bBig ? ((uint32_t)p[0] << 8 | p[1]) : ((uint32_t)p[1] << 8 | p[0]);
+}
+
+static uint32_t get32(const uint8_t *p, int bBig)
+{
+    return bBig ? (get16(p, 1) << 16 | get16(p + 2, 1)) : (get16(p + 2, 0) << 16 | get16(p, 0));
+}
+
+/* Orientation tag of IFD0 of the TIFF structure in an Exif APP1 segment, 0 if none */
+static uint8_t exif_orientation(const uint8_t *pu8Tiff, uint32_t u32Len)
+{
+    uint32_t u32Ifd, u32Count, i;
+    const uint8_t *pu8Entry;
+    int bBig;
+
+    if (u32Len < 8)
+        return 0;
+    if ((pu8Tiff[0] == 'I') && (pu8Tiff[1] == 'I'))
+        bBig = 0;
+    else if ((pu8Tiff[0] == 'M') && (pu8Tiff[1] == 'M'))
+        bBig = 1;
+    else
+        return 0;
+    if (get16(pu8Tiff + 2, bBig) != 42)
+        return 0;
+
+    u32Ifd = get32(pu8Tiff + 4, bBig);
+    if ((u32Ifd < 8) || (u32Ifd > u32Len - 2))
+        return 0;
+    u32Count = get16(pu8Tiff + u32Ifd, bBig);
+    if (u32Count > (u32Len - u32Ifd - 2) / 12)
+        return 0;
+
+    for (i = 0; i < u32Count; i++)
+    {
+        pu8Entry = pu8Tiff + u32Ifd + 2 + i * 12;
+        /* SHORT, one value, in the first two bytes of the value field */
+        if ((get16(pu8Entry, bBig) == EXIF_ORIENTATION) && (get16(pu8Entry + 2, bBig) == 3) &&
+                (get32(pu8Entry + 4, bBig) == 1))
+        {
+            u32Count = get16(pu8Entry + 8, bBig);
+            return ((u32Count >= 1) && (u32Count <= 8)) ? (uint8_t)u32Count : 0;
+        }
+    }
+    return 0;
+}
+
+int bs_jpeg_parse(const uint8_t *pu8Data, uint32_t u32Len, BS_JPEG_INFO_T *psInfo)
+{
+    uint32_t i = 2, u32SegLen, c;
+    const uint8_t *pu8Seg;
+    uint8_t m;
+
+    memset(psInfo, 0, sizeof(*psInfo));
+    if ((u32Len < 2) || (pu8Data[0] != 0xFF) || (pu8Data[1] != M_SOI))
+        return BS_ERR_SYNTAX;
+
+    while (i < u32Len)
+    {
+        if (pu8Data[i] != 0xFF)
+            return BS_ERR_SYNTAX;
+        while ((i < u32Len) && (pu8Data[i] == 0xFF))
+            i++;                                    /* fill bytes */
+        if (i >= u32Len)
+            break;
+
+        m = pu8Data[i++];
+        if (IS_STANDALONE(m))
+            continue;
+        if ((m == 0x00) || (m == M_SOI) || (m == M_EOI))
+            return BS_ERR_SYNTAX;
+
+        /* Whole segments only */
+        if (i + 2 > u32Len)
+            break;
+        u32SegLen = get16(pu8Data + i, 1);
+        if (u32SegLen < 2)
+            return BS_ERR_SYNTAX;
+        if (u32SegLen > u32Len - i)
+            break;
+        pu8Seg = pu8Data + i + 2;
+        u32SegLen -= 2;
+
+        if (IS_SOF(m) && (psInfo->u8Sof == 0))
+        {
+            if ((u32SegLen < 6) || (u32SegLen < 6 + 3 * (uint32_t)pu8Seg[5]))
+                return BS_ERR_SYNTAX;
+            psInfo->u8Sof = m;
+            psInfo->u8Precision = pu8Seg[0];
+            psInfo->u32Height = get16(pu8Seg + 1, 1);
+            psInfo->u32Width = get16(pu8Seg + 3, 1);
+            psInfo->u8Components = pu8Seg[5];
+            for (c = 0; (c < psInfo->u8Components) && (c < 4); c++)
+                psInfo->au8Sampling[c] = pu8Seg[6 + 3 * c + 1];
+        }
+        else if ((m == M_DRI) && (u32SegLen >= 2))
+        {
+            psInfo->u16RestartInterval = (uint16_t)get16(pu8Seg, 1);
+        }
+        else if ((m == M_APP1) && (u32SegLen >= 6) && (memcmp(pu8Seg, "Exif\0\0", 6) == 0) &&
+                 (psInfo->u8Orientation == 0))
+        {
+            psInfo->u8Orientation = exif_orientation(pu8Seg + 6, u32SegLen - 6);
+        }
+        else if (m == M_SOS)
+        {
+            if (psInfo->u8Sof == 0)
+                return BS_ERR_SYNTAX;
+            psInfo->u32ScanOffset = i + 2 + u32SegLen;
+            return BS_OK;
+        }
+
+        i += 2 + u32SegLen;
+    }
+
+    return psInfo->u8Sof ? BS_OK : BS_ERR_TRUNCATED;
+}
+
+uint32_t bs_jpeg_rotation(uint8_t u8Orientation)
+{
+    /* The mirrored orientations 2, 4, 5 and 7 by their rotation alone */
+    static const uint16_t au16Rotation[9] = { 0, 0, 0, 180, 180, 270, 90, 90, 270 };
+
+    return (u8Orientation <= 8) ? au16Rotation[u8Orientation] : 0;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Frame boundaries                                                          */
+/*---------------------------------------------------------------------------*/
+
+enum
+{
+    S_SOI0,             /* looking for the 0xFF of an SOI */
+    S_SOI1,             /* and its 0xD8 */
+    S_MARK0,            /* 0xFF of the next marker */
+    S_MARK1,            /* the marker */
+    S_LEN0,             /* segment length, high byte */
+    S_LEN1,
+    S_SEG,              /* segment bytes */
+    S_ECS,              /* entropy coded data */
+    S_ECS1              /* after an 0xFF in it */
+};
+
+void bs_jpeg_scan_init(BS_JPEG_SCAN_T *psScan)
+{
+    memset(psScan, 0, sizeof(*psScan));
+    psScan->u32State = S_SOI0;
+}
+
+static void frame_start(BS_JPEG_SCAN_T *psScan, uint64_t u64Offset)
+{
+    psScan->u64Start = u64Offset;
+    psScan->u32Width = 0;
+    psScan->u32Height = 0;
+    psScan->u32State = S_MARK0;
+}
+
+/* Marker byte m at stream offset u64At; 1 for the EOI that ends a frame */
+static int marker(BS_JPEG_SCAN_T *psScan, uint8_t m, uint64_t u64At)
+{
+    if (m == M_EOI)
+    {
+        psScan->u64FrameOffset = psScan->u64Start;
+        psScan->u32FrameLen = (uint32_t)(u64At + 1 - psScan->u64Start);
+        psScan->u32State = S_SOI0;
+        return 1;
+    }
+
+    if (m == M_SOI)
+        frame_start(psScan, u64At - 1);             /* the frame before never ended */
+    else if (m == 0xFF)
+        psScan->u32State = S_MARK1;                 /* fill byte */
+    else if (IS_STANDALONE(m))
+        psScan->u32State = S_MARK0;
+    else if (m == 0x00)
+        psScan->u32State = S_SOI0;                  /* out of step, wait for the next frame */
+    else
+    {
+        psScan->u32Marker = m;
+        psScan->u32State = S_LEN0;
+    }
+    return 0;
+}
+
+static void segment_end(BS_JPEG_SCAN_T *psScan)
+{
+    if (IS_SOF(psScan->u32Marker) && (psScan->u32SegLen >= 5) && (psScan->u32Width == 0))
+    {
+        psScan->u32Height = get16(psScan->au8Seg + 1, 1);
+        psScan->u32Width = get16(psScan->au8Seg + 3, 1);
+    }
+    psScan->u32State = (psScan->u32Marker == M_SOS) ? S_ECS : S_MARK0;
+}
+
+int bs_jpeg_scan(BS_JPEG_SCAN_T *psScan, const uint8_t *pu8Data, uint32_t u32Len, uint32_t *pu32Used)
+{
+    const uint8_t *q;
+    uint32_t i = 0, n;
+    int bEnd = 0;
+    uint8_t b;
+
+    while ((i < u32Len) && !bEnd)
+    {
+        switch (psScan->u32State)
+        {
+        case S_SOI0:
+        case S_ECS:
+            q = memchr(pu8Data + i, 0xFF, u32Len - i);
+            if (q == NULL)
+            {
+                i = u32Len;
+                break;
+            }
+            i = (uint32_t)(q - pu8Data) + 1;
+            psScan->u32State = (psScan->u32State == S_SOI0) ? S_SOI1 : S_ECS1;
+            break;
+
+        case S_SOI1:
+            b = pu8Data[i++];
+            if (b == M_SOI)
+                frame_start(psScan, psScan->u64Pos + i - 2);
+            else if (b != 0xFF)
+                psScan->u32State = S_SOI0;
+            break;
+
+        case S_MARK0:
+            psScan->u32State = (pu8Data[i++] == 0xFF) ? S_MARK1 : S_SOI0;
+            break;
+
+        case S_MARK1:
+            b = pu8Data[i++];
+            bEnd = marker(psScan, b, psScan->u64Pos + i - 1);
+            break;
+
+        case S_LEN0:
+            psScan->u32Skip = (uint32_t)pu8Data[i++] << 8;
+            psScan->u32State = S_LEN1;
+            break;
+
+        case S_LEN1:
+            psScan->u32Skip |= pu8Data[i++];
+            if (psScan->u32Skip < 2)
+            {
+                psScan->u32State = S_SOI0;
+                break;
+            }
+            psScan->u32Skip -= 2;
+            psScan->u32SegLen = 0;
+            psScan->u32State = S_SEG;
+            if (psScan->u32Skip == 0)
+                segment_end(psScan);
+            break;
+
+        case S_SEG:
+            n = u32Len - i;
+            if (n > psScan->u32Skip)
+                n = psScan->u32Skip;
+            if (IS_SOF(psScan->u32Marker) && (psScan->u32SegLen < sizeof(psScan->au8Seg)))
+            {
+                uint32_t u32Copy = sizeof(psScan->au8Seg) - psScan->u32SegLen;
+
+                if (u32Copy > n)
+                    u32Copy = n;
+                memcpy(psScan->au8Seg + psScan->u32SegLen, pu8Data + i, u32Copy);
+                psScan->u32SegLen += u32Copy;
+            }
+            i += n;
+            psScan->u32Skip -= n;
+            if (psScan->u32Skip == 0)
+                segment_end(psScan);
+            break;
+
+        case S_ECS1:
+            b = pu8Data[i++];
+            if ((b == 0x00) || ((b >= 0xD0) && (b <= 0xD7)))
+                psScan->u32State = S_ECS;           /* stuffed 0xFF, restart marker */
+            else if (b != 0xFF)
+                bEnd = marker(psScan, b, psScan->u64Pos + i - 1);
+            break;
+
+        default:
+            psScan->u32State = S_SOI0;
+            break;
+        }
+    }
+
+    psScan->u64Pos += i;
+    *pu32Used = i;
+    return bEnd;
+}
+
+uint32_t bs_jpeg_frame_len(const uint8_t *pu8Data, uint32_t u32Len)
+{
+    BS_JPEG_SCAN_T sScan;
+    uint32_t u32Used;
+
+    if ((u32Len < 2) || (pu8Data[0] != 0xFF) || (pu8Data[1] != M_SOI))
+        return 0;
+
+    bs_jpeg_scan_init(&sScan);
+    if (!bs_jpeg_scan(&sScan, pu8Data, u32Len, &u32Used) || (sScan.u64FrameOffset != 0))
+        return 0;
+
+    return sScan.u32FrameLen;
+}
+
+/*---------------------------------------------------------------------------*/
+/* MJPEG indexer                                                             */
+/*---------------------------------------------------------------------------*/
+
+void bs_jpeg_index_init(BS_JPEG_INDEXER_T *psIdx, BS_INDEX_T *psIndex)
+{
+    psIdx->psIndex = psIndex;
+    bs_jpeg_scan_init(&psIdx->sScan);
+}
+
+void bs_jpeg_index_feed(BS_JPEG_INDEXER_T *psIdx, const uint8_t *pu8Data, uint32_t u32Len)
+{
+    BS_INDEX_T *psIndex = psIdx->psIndex;
+    uint32_t u32Used;
+
+    while (u32Len)
+    {
+        if (bs_jpeg_scan(&psIdx->sScan, pu8Data, u32Len, &u32Used))
+        {
+            if (psIndex->u32Width == 0)
+            {
+                psIndex->u32Width = psIdx->sScan.u32Width;
+                psIndex->u32Height = psIdx->sScan.u32Height;
+            }
+            bs_index_add(psIndex, psIdx->sScan.u64FrameOffset, BS_INDEX_KEY | BS_INDEX_INTRA);
+        }
+        pu8Data += u32Used;
+        u32Len -= u32Used;
+    }
+}
+
+void bs_jpeg_index_end(BS_JPEG_INDEXER_T *psIdx)
+{
+    psIdx->psIndex->u64StreamLen = psIdx->sScan.u64Pos;
+}
@@ -0,0 +1,226 @@
+/**************************************************************************//**
+ * @file     bs_scan.c
+ *
+ * @brief    Start code scanner and RBSP bit reader.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+
+#include "bitstream.h"
+
+#if defined(BS_NEON)
+#include <arm_neon.h>
+#endif
+
+/* pu8Data[i] ends a start code, i >= 2 */
+#define IS_START_CODE(p, i)     (((p)[i] == 1) && ((p)[(i) - 1] == 0) && ((p)[(i) - 2] == 0))
+
+#if defined(BS_NEON)
+/*
+ * First i >= u32Pos ending a start code, u32Pos >= 2. Lane j of a block is
+ * zero in (p[j] ^ 1) | p[j - 1] | p[j - 2] exactly where p[j] ends one, so
+ * a block without such a lane is passed in a handful of instructions.
+ */
+static uint32_t find_start_code(const uint8_t *p, uint32_t i, uint32_t u32Len)
+{
+    const uint8x16_t one = vdupq_n_u8(1);
+    uint8x16_t t;
+    uint32_t k;
+
+    for (; i + 16 <= u32Len; i += 16)
+    {
+        t = vorrq_u8(veorq_u8(vld1q_u8(p + i), one), vorrq_u8(vld1q_u8(p + i - 1), vld1q_u8(p + i - 2)));
+        if (vmaxvq_u8(vceqq_u8(t, vdupq_n_u8(0))) == 0)
+            continue;
+        for (k = i; k < i + 16; k++)
+        {
+            if (IS_START_CODE(p, k))
+                return k;
+        }
+    }
+
+    for (; i < u32Len; i++)
+    {
+        if (IS_START_CODE(p, i))
+            return i;
+    }
+    return u32Len;
+}
+#else
+#define ONES    0x0101010101010101ull
+#define HIGHS   0x8080808080808080ull
+
+static uint64_t load64(const uint8_t *p)
+{
+    uint64_t x;
+
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+/* As the NEON version, eight lanes of a 64-bit word: a word has a zero byte iff (x - 0x01..) & ~x & 0x80.. */
+static uint32_t find_start_code(const uint8_t *p, uint32_t i, uint32_t u32Len)
+{
+    uint64_t t;
+    uint32_t k;
+
+    for (; i + 8 <= u32Len; i += 8)
+    {
+        t = (load64(p + i) ^ ONES) | load64(p + i - 1) | load64(p + i - 2);
+        if (((t - ONES) & ~t & HIGHS) == 0)
+            continue;
+        for (k = i; k < i + 8; k++)
+        {
+            if (IS_START_CODE(p, k))
+                return k;
+        }
+    }
+
+    for (; i < u32Len; i++)
+    {
+        if (IS_START_CODE(p, i))
+            return i;
+    }
+    return u32Len;
+}
+#endif
+
+/* Zero bytes before pu8Data[i], counting u32Zeros before pu8Data[u32Pos] */
+static uint32_t zeros_before(const uint8_t *pu8Data, uint32_t u32Pos, uint32_t i, uint32_t u32Zeros)
+{
+    uint32_t j = i;
+
+    while ((j > u32Pos) && (pu8Data[j - 1] == 0))
+        j--;
+
+    return (i - j) + ((j == u32Pos) ? u32Zeros : 0);
+}
+
+uint32_t bs_scan_start_code(const uint8_t *pu8Data, uint32_t u32Pos, uint32_t u32Len,
+                            uint32_t *pu32Zeros)
+{
+    uint32_t i, z = *pu32Zeros;
+
+    /* The first two bytes may end a start code begun before u32Pos */
+    for (i = u32Pos; (i < u32Len) && (i < u32Pos + 2); i++)
+    {
+        if ((pu8Data[i] == 1) && (z >= 2))
+        {
+            *pu32Zeros = z;
+            return i;
+        }
+        z = (pu8Data[i] == 0) ? z + 1 : 0;
+    }
+
+    if (i < u32Len)
+    {
+        i = find_start_code(pu8Data, i, u32Len);
+        if (i < u32Len)
+        {
+            *pu32Zeros = zeros_before(pu8Data, u32Pos, i, *pu32Zeros);
+            return i;
+        }
+    }
+
+    *pu32Zeros = zeros_before(pu8Data, u32Pos, u32Len, *pu32Zeros);
+    return u32Len;
+}
+
+void bs_reader_init(BS_READER_T *psReader, const uint8_t *pu8Data, uint32_t u32Len)
+{
+    memset(psReader, 0, sizeof(*psReader));
+    psReader->pu8Data = pu8Data;
+    psReader->u32Len = u32Len;
+}
+
+/* Load bytes until the cache holds more than 56 bits or the data ends */
+static void reader_fill(BS_READER_T *psReader)
+{
+    uint8_t b;
+
+    while ((psReader->u32Bits <= 56) && (psReader->u32Pos < psReader->u32Len))
+    {
+        b = psReader->pu8Data[psReader->u32Pos++];
+
+        if ((b == 3) && (psReader->u32Zeros >= 2))
+        {
+            psReader->u32Zeros = 0;
+            continue;
+        }
+        psReader->u32Zeros = (b == 0) ? psReader->u32Zeros + 1 : 0;
+        psReader->u64Cache |= (uint64_t)b << (56 - psReader->u32Bits);
+        psReader->u32Bits += 8;
+    }
+}
+
+uint32_t bs_read_bits(BS_READER_T *psReader, uint32_t u32Count)
+{
+    uint32_t v;
+
+    if (u32Count == 0)
+        return 0;
+
+    if (psReader->u32Bits < u32Count)
+    {
+        reader_fill(psReader);
+        if (psReader->u32Bits < u32Count)
+        {
+            /* what is left, then zeros */
+            v = (uint32_t)(psReader->u64Cache >> (64 - u32Count));
+            psReader->u64Cache = 0;
+            psReader->u32Bits = 0;
+            psReader->bOverrun = 1;
+            return v;
+        }
+    }
+
+    v = (uint32_t)(psReader->u64Cache >> (64 - u32Count));
+    psReader->u64Cache <<= u32Count;
+    psReader->u32Bits -= u32Count;
+    return v;
+}
+
+uint32_t bs_read_ue(BS_READER_T *psReader)
+{
+    uint32_t u32Lz = 0;
+
+    while (bs_read_bits(psReader, 1) == 0)
+    {
+        if (psReader->bOverrun || (++u32Lz > 31))
+        {
+            psReader->bOverrun = 1;
+            return 0;
+        }
+    }
+
+    if (u32Lz == 0)
+        return 0;
+
+    return ((1u << u32Lz) - 1) + bs_read_bits(psReader, u32Lz);
+}
+
+int32_t bs_read_se(BS_READER_T *psReader)
+{
+    uint32_t k = bs_read_ue(psReader);
+
+    return (k & 1) ? (int32_t)((k >> 1) + 1) : -(int32_t)(k >> 1);
+}
+
+int bs_more_rbsp_data(const BS_READER_T *psReader)
+{
+    BS_READER_T sReader = *psReader;
+
+    if (sReader.bOverrun)
+        return 0;
+
+    /* The stop bit is the last 1 bit: data follow if there is a 1 bit after the next bit */
+    bs_read_bits(&sReader, 1);
+    while (!sReader.bOverrun)
+    {
+        if (bs_read_bits(&sReader, 32) != 0)
+            return 1;
+    }
+    return 0;
+}
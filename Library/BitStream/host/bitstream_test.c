@@ -0,0 +1,1526 @@
+/**************************************************************************//**
+ * @file     bitstream_test.c
+ *
+ * @brief    Host unit test, fuzz test and benchmark of the BitStream
+ *           library, the NEON scanner against the C scanner and both
+ *           against streams of known layout.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bitstream.h"
+
+/*
+ * The library is built twice (see Makefile), renamed with a prefix:
+ *
+ *   neon_  the NEON scanner, on the shared arm_neon.h stand-in unless the
+ *          host is AArch64
+ *   c_     BS_NO_NEON
+ *
+ *   bitstream_test [-b] [-t ms] [-z iterations]
+ *
+ * The streams are written here by a bit writer from random parameters:
+ * SPS, PPS and slice headers must parse back to them, the indexers must
+ * find the access units and JPEG frames where they were put, whatever the
+ * split of the stream into pieces, and both scanners must agree with a
+ * byte by byte search. -z runs that many random and mutated streams
+ * through every entry point, for the sanitizers of `make fuzz`, and
+ * checks that the results still do not depend on the split or on the
+ * scanner. -b adds the throughput of each, measured for at least -t ms.
+ */
+
+#define BS_DECLARE(p)  \
+	uint32_t p##bs_scan_start_code(const uint8_t *, uint32_t, uint32_t, uint32_t *);  \
+	void p##bs_reader_init(BS_READER_T *, const uint8_t *, uint32_t);  \
+	uint32_t p##bs_read_bits(BS_READER_T *, uint32_t);  \
+	uint32_t p##bs_read_ue(BS_READER_T *);  \
+	int32_t p##bs_read_se(BS_READER_T *);  \
+	int p##bs_more_rbsp_data(const BS_READER_T *);  \
+	int p##bs_h264_new_picture(const BS_H264_SLICE_T *, const BS_H264_SLICE_T *, const BS_H264_SPS_T *);  \
+	int p##bs_h264_parse_sps(const uint8_t *, uint32_t, BS_H264_SPS_T *);  \
+	int p##bs_h264_parse_pps(const uint8_t *, uint32_t, const BS_H264_SPS_T *, BS_H264_PPS_T *);  \
+	int p##bs_h264_parse_slice(const uint8_t *, uint32_t, const BS_H264_SPS_T *, const BS_H264_PPS_T *,  \
+				   BS_H264_SLICE_T *);  \
+	int p##bs_jpeg_parse(const uint8_t *, uint32_t, BS_JPEG_INFO_T *);  \
+	uint32_t p##bs_jpeg_rotation(uint8_t);  \
+	uint32_t p##bs_jpeg_frame_len(const uint8_t *, uint32_t);  \
+	void p##bs_index_init(BS_INDEX_T *, uint32_t, BS_INDEX_ENTRY_T *, uint32_t);  \
+	int p##bs_index_add(BS_INDEX_T *, uint64_t, uint32_t);  \
+	int32_t p##bs_index_seek(const BS_INDEX_T *, uint32_t, uint32_t);  \
+	int32_t p##bs_index_frame_at(const BS_INDEX_T *, uint64_t);  \
+	uint32_t p##bs_index_frame_len(const BS_INDEX_T *, uint32_t);  \
+	int32_t p##bs_index_save(const BS_INDEX_T *, uint8_t *, uint32_t);  \
+	int p##bs_index_load(BS_INDEX_T *, const uint8_t *, uint32_t);  \
+	void p##bs_h264_index_init(BS_H264_INDEXER_T *, BS_INDEX_T *);  \
+	void p##bs_h264_index_feed(BS_H264_INDEXER_T *, const uint8_t *, uint32_t);  \
+	void p##bs_h264_index_end(BS_H264_INDEXER_T *);  \
+	void p##bs_jpeg_index_init(BS_JPEG_INDEXER_T *, BS_INDEX_T *);  \
+	void p##bs_jpeg_index_feed(BS_JPEG_INDEXER_T *, const uint8_t *, uint32_t);  \
+	void p##bs_jpeg_index_end(BS_JPEG_INDEXER_T *);
+
+#define BS_VARIANT(p, desc)  \
+	{ #p, desc, p##bs_scan_start_code, p##bs_h264_index_init, p##bs_h264_index_feed,  \
+	  p##bs_h264_index_end, p##bs_jpeg_index_init, p##bs_jpeg_index_feed, p##bs_jpeg_index_end }
+
+BS_DECLARE(neon_)
+BS_DECLARE(c_)
+
+typedef struct {
+	const char *name;
+	const char *desc;
+	uint32_t (*scan)(const uint8_t *, uint32_t, uint32_t, uint32_t *);
+	void (*h264_init)(BS_H264_INDEXER_T *, BS_INDEX_T *);
+	void (*h264_feed)(BS_H264_INDEXER_T *, const uint8_t *, uint32_t);
+	void (*h264_end)(BS_H264_INDEXER_T *);
+	void (*jpeg_init)(BS_JPEG_INDEXER_T *, BS_INDEX_T *);
+	void (*jpeg_feed)(BS_JPEG_INDEXER_T *, const uint8_t *, uint32_t);
+	void (*jpeg_end)(BS_JPEG_INDEXER_T *);
+} variant_t;
+
+enum { V_NEON, V_C, V_NUM };
+
+static const variant_t s_var[V_NUM] = {
+	BS_VARIANT(neon_, "NEON"),
+	BS_VARIANT(c_,    "C"),
+};
+
+#define MAXSTREAM   (4 << 20)
+#define MAXFRAMES   4096
+
+static int s_fail;
+
+#define CHECK(cond, ...)  do { if (!(cond)) { printf("  FAIL: " __VA_ARGS__); printf("\n"); s_fail = 1; } } while (0)
+
+static uint32_t s_rnd = 1;
+
+static uint32_t rnd(void)
+{
+	/* xorshift32 */
+	s_rnd ^= s_rnd << 13;
+	s_rnd ^= s_rnd >> 17;
+	s_rnd ^= s_rnd << 5;
+	return s_rnd;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Bit writer and NAL units                                                  */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+	uint8_t buf[8192];
+	uint32_t bits;
+} bw_t;
+
+static void put_bits(bw_t *w, uint32_t v, uint32_t n)
+{
+	while (n--) {
+		if ((w->bits & 7) == 0)
+			w->buf[w->bits >> 3] = 0;
+		if ((v >> n) & 1)
+			w->buf[w->bits >> 3] |= 0x80 >> (w->bits & 7);
+		w->bits++;
+	}
+}
+
+static void put_ue(bw_t *w, uint32_t v)
+{
+	uint64_t x = (uint64_t)v + 1;
+	uint32_t n = 0;
+
+	while ((x >> n) > 1)
+		n++;
+	put_bits(w, 0, n);
+	put_bits(w, 1, 1);
+	put_bits(w, (uint32_t)(x - ((uint64_t)1 << n)), n);
+}
+
+static void put_se(bw_t *w, int32_t v)
+{
+	put_ue(w, (v > 0) ? 2 * (uint32_t)v - 1 : 2 * (uint32_t)(-(int64_t)v));
+}
+
+static void put_trailing(bw_t *w)
+{
+	put_bits(w, 1, 1);
+	while (w->bits & 7)
+		put_bits(w, 0, 1);
+}
+
+/* NAL header byte and RBSP to a NAL unit with emulation prevention, returns its length */
+static uint32_t nal_pack(uint8_t *out, uint8_t hdr, const uint8_t *rbsp, uint32_t len)
+{
+	uint32_t i, n = 0, z = 0;
+
+	out[n++] = hdr;
+	for (i = 0; i < len; i++) {
+		if (z >= 2 && rbsp[i] <= 3) {
+			out[n++] = 3;
+			z = 0;
+		}
+		out[n++] = rbsp[i];
+		z = rbsp[i] ? 0 : z + 1;
+	}
+	return n;
+}
+
+/*---------------------------------------------------------------------------*/
+/* Random SPS, PPS and slices                                                */
+/*---------------------------------------------------------------------------*/
+
+static void put_scaling_list(bw_t *w, uint32_t size)
+{
+	int32_t last = 8, next = 8, d;
+	uint32_t j;
+
+	for (j = 0; j < size; j++) {
+		if (next != 0) {
+			d = (rnd() % 40 == 0) ? -last : (int32_t)(rnd() % 256) - 128;
+			put_se(w, d);
+			next = (last + d + 256) % 256;
+			if (next == 0 && j == 0)
+				break;
+		}
+		last = (next == 0) ? last : next;
+	}
+}
+
+static const uint16_t s_sar[17][2] = {
+	{ 0, 0 }, { 1, 1 }, { 12, 11 }, { 10, 11 }, { 16, 11 }, { 40, 33 }, { 24, 11 },
+	{ 20, 11 }, { 32, 11 }, { 80, 33 }, { 18, 11 }, { 15, 11 }, { 64, 33 },
+	{ 160, 99 }, { 4, 3 }, { 3, 2 }, { 2, 1 }
+};
+
+/* A random SPS into out, the values it must parse to in e */
+static uint32_t gen_sps(uint8_t *out, BS_H264_SPS_T *e, int timing)
+{
+	static const uint8_t profiles[] = { 66, 77, 88, 100, 110, 122, 244, 44 };
+	uint32_t i, n, subw = 2, subh = 2, cx, cy, crop[4], hmap;
+	bw_t w;
+
+	memset(e, 0, sizeof(*e));
+	w.bits = 0;
+	e->u8Valid = 1;
+	e->u8ProfileIdc = profiles[rnd() % sizeof(profiles)];
+	e->u8Constraints = rnd() & 0xFC;
+	e->u8LevelIdc = rnd() % 52;
+	e->u8SpsId = rnd() % 32;
+	put_bits(&w, e->u8ProfileIdc, 8);
+	put_bits(&w, e->u8Constraints, 8);
+	put_bits(&w, e->u8LevelIdc, 8);
+	put_ue(&w, e->u8SpsId);
+
+	e->u8ChromaFormatIdc = 1;
+	e->u8BitDepthLuma = e->u8BitDepthChroma = 8;
+	if (e->u8ProfileIdc >= 100 || e->u8ProfileIdc == 44) {
+		e->u8ChromaFormatIdc = rnd() % 4;
+		put_ue(&w, e->u8ChromaFormatIdc);
+		if (e->u8ChromaFormatIdc == 3) {
+			e->u8SeparateColourPlane = rnd() & 1;
+			put_bits(&w, e->u8SeparateColourPlane, 1);
+		}
+		e->u8BitDepthLuma = 8 + rnd() % 7;
+		e->u8BitDepthChroma = 8 + rnd() % 7;
+		put_ue(&w, e->u8BitDepthLuma - 8);
+		put_ue(&w, e->u8BitDepthChroma - 8);
+		put_bits(&w, rnd() & 1, 1);
+		e->u8ScalingMatrix = rnd() & 1;
+		put_bits(&w, e->u8ScalingMatrix, 1);
+		if (e->u8ScalingMatrix) {
+			n = (e->u8ChromaFormatIdc != 3) ? 8 : 12;
+			for (i = 0; i < n; i++) {
+				uint32_t f = rnd() & 1;
+
+				put_bits(&w, f, 1);
+				if (f)
+					put_scaling_list(&w, (i < 6) ? 16 : 64);
+			}
+		}
+	}
+
+	e->u8Log2MaxFrameNum = 4 + rnd() % 13;
+	put_ue(&w, e->u8Log2MaxFrameNum - 4);
+	e->u8PocType = rnd() % 3;
+	put_ue(&w, e->u8PocType);
+	if (e->u8PocType == 0) {
+		e->u8Log2MaxPocLsb = 4 + rnd() % 13;
+		put_ue(&w, e->u8Log2MaxPocLsb - 4);
+	} else if (e->u8PocType == 1) {
+		e->u8DeltaPicOrderAlwaysZero = rnd() & 1;
+		put_bits(&w, e->u8DeltaPicOrderAlwaysZero, 1);
+		put_se(&w, (int32_t)(rnd() % 100) - 50);
+		put_se(&w, (int32_t)(rnd() % 100) - 50);
+		n = rnd() % 6;
+		put_ue(&w, n);
+		while (n--)
+			put_se(&w, (int32_t)(rnd() % 100) - 50);
+	}
+
+	e->u8MaxNumRefFrames = rnd() % 17;
+	put_ue(&w, e->u8MaxNumRefFrames);
+	put_bits(&w, rnd() & 1, 1);
+	e->u16WidthMbs = 2 + rnd() % 119;
+	hmap = 2 + rnd() % 67;
+	put_ue(&w, e->u16WidthMbs - 1);
+	put_ue(&w, hmap - 1);
+	e->u8FrameMbsOnly = rnd() & 1;
+	put_bits(&w, e->u8FrameMbsOnly, 1);
+	e->u16HeightMbs = hmap * (2 - e->u8FrameMbsOnly);
+	if (!e->u8FrameMbsOnly) {
+		e->u8MbAdaptiveFrameField = rnd() & 1;
+		put_bits(&w, e->u8MbAdaptiveFrameField, 1);
+	}
+	e->u8Direct8x8Inference = rnd() & 1;
+	put_bits(&w, e->u8Direct8x8Inference, 1);
+
+	if (e->u8SeparateColourPlane || e->u8ChromaFormatIdc == 0 || e->u8ChromaFormatIdc == 3)
+		subw = subh = 1;
+	else if (e->u8ChromaFormatIdc == 2)
+		subh = 1;
+	cx = subw;
+	cy = subh * (2 - e->u8FrameMbsOnly);
+	e->u32Width = e->u16WidthMbs * 16;
+	e->u32Height = e->u16HeightMbs * 16;
+	if (rnd() & 1) {
+		put_bits(&w, 1, 1);
+		for (i = 0; i < 4; i++) {
+			crop[i] = rnd() % 4;
+			put_ue(&w, crop[i]);
+		}
+		e->u16CropLeft = crop[0] * cx;
+		e->u16CropRight = crop[1] * cx;
+		e->u16CropTop = crop[2] * cy;
+		e->u16CropBottom = crop[3] * cy;
+		e->u32Width -= e->u16CropLeft + e->u16CropRight;
+		e->u32Height -= e->u16CropTop + e->u16CropBottom;
+	} else {
+		put_bits(&w, 0, 1);
+	}
+
+	if (timing || (rnd() & 1)) {
+		put_bits(&w, 1, 1);
+		if (rnd() & 1) {
+			uint32_t idc = rnd() % 18;
+
+			put_bits(&w, 1, 1);
+			if (idc == 17) {
+				idc = 255;
+				e->u16SarWidth = 1 + rnd() % 1000;
+				e->u16SarHeight = 1 + rnd() % 1000;
+			} else {
+				e->u16SarWidth = s_sar[idc][0];
+				e->u16SarHeight = s_sar[idc][1];
+			}
+			put_bits(&w, idc, 8);
+			if (idc == 255) {
+				put_bits(&w, e->u16SarWidth, 16);
+				put_bits(&w, e->u16SarHeight, 16);
+			}
+		} else {
+			put_bits(&w, 0, 1);
+		}
+		n = rnd() & 1;
+		put_bits(&w, n, 1);
+		if (n)
+			put_bits(&w, rnd() & 1, 1);
+		n = rnd() & 1;
+		put_bits(&w, n, 1);
+		if (n) {
+			put_bits(&w, rnd() % 8, 3);
+			e->u8FullRange = rnd() & 1;
+			put_bits(&w, e->u8FullRange, 1);
+			n = rnd() & 1;
+			put_bits(&w, n, 1);
+			if (n)
+				put_bits(&w, rnd() & 0xFFFFFF, 24);
+		}
+		n = rnd() & 1;
+		put_bits(&w, n, 1);
+		if (n) {
+			put_ue(&w, rnd() % 6);
+			put_ue(&w, rnd() % 6);
+		}
+		if (timing || (rnd() & 1)) {
+			put_bits(&w, 1, 1);
+			e->u32NumUnitsInTick = 1 + rnd() % 100000;
+			e->u32TimeScale = 1 + rnd();
+			e->u8FixedFrameRate = rnd() & 1;
+			put_bits(&w, e->u32NumUnitsInTick, 32);
+			put_bits(&w, e->u32TimeScale, 32);
+			put_bits(&w, e->u8FixedFrameRate, 1);
+		} else {
+			put_bits(&w, 0, 1);
+		}
+		/* HRD and the rest, not parsed */
+		put_bits(&w, rnd(), rnd() % 30);
+	} else {
+		put_bits(&w, 0, 1);
+	}
+
+	put_trailing(&w);
+	return nal_pack(out, 0x67, w.buf, w.bits / 8);
+}
+
+static uint32_t gen_pps(uint8_t *out, BS_H264_PPS_T *e, const BS_H264_SPS_T *sps)
+{
+	uint32_t i, n, type, bits;
+	bw_t w;
+
+	memset(e, 0, sizeof(*e));
+	w.bits = 0;
+	e->u8Valid = 1;
+	e->u8PpsId = rnd() % 256;
+	e->u8SpsId = sps->u8SpsId;
+	put_ue(&w, e->u8PpsId);
+	put_ue(&w, e->u8SpsId);
+	e->u8EntropyCodingMode = rnd() & 1;
+	e->u8BottomFieldPicOrder = rnd() & 1;
+	put_bits(&w, e->u8EntropyCodingMode, 1);
+	put_bits(&w, e->u8BottomFieldPicOrder, 1);
+
+	e->u8NumSliceGroups = (rnd() % 4) ? 1 : 1 + rnd() % 8;
+	put_ue(&w, e->u8NumSliceGroups - 1);
+	if (e->u8NumSliceGroups > 1) {
+		type = rnd() % 7;
+		put_ue(&w, type);
+		if (type == 0) {
+			for (i = 0; i < e->u8NumSliceGroups; i++)
+				put_ue(&w, rnd() % 1000);
+		} else if (type == 2) {
+			for (i = 0; i < 2 * (e->u8NumSliceGroups - 1u); i++)
+				put_ue(&w, rnd() % 1000);
+		} else if (type >= 3 && type <= 5) {
+			put_bits(&w, rnd() & 1, 1);
+			put_ue(&w, rnd() % 1000);
+		} else if (type == 6) {
+			n = 1 + rnd() % 300;
+			put_ue(&w, n - 1);
+			for (bits = 0; (1u << bits) < e->u8NumSliceGroups; bits++)
+				;
+			for (i = 0; i < n; i++)
+				put_bits(&w, rnd() % e->u8NumSliceGroups, bits);
+		}
+	}
+
+	e->u8NumRefIdxL0Default = 1 + rnd() % 32;
+	e->u8NumRefIdxL1Default = 1 + rnd() % 32;
+	put_ue(&w, e->u8NumRefIdxL0Default - 1);
+	put_ue(&w, e->u8NumRefIdxL1Default - 1);
+	e->u8WeightedPred = rnd() & 1;
+	e->u8WeightedBipredIdc = rnd() % 3;
+	put_bits(&w, e->u8WeightedPred, 1);
+	put_bits(&w, e->u8WeightedBipredIdc, 2);
+	e->i8PicInitQp = (int8_t)(rnd() % 52);
+	put_se(&w, e->i8PicInitQp - 26);
+	put_se(&w, (int32_t)(rnd() % 52) - 26);
+	e->i8ChromaQpOffset = (int8_t)((int32_t)(rnd() % 25) - 12);
+	e->i8SecondChromaQpOffset = e->i8ChromaQpOffset;
+	put_se(&w, e->i8ChromaQpOffset);
+	e->u8DeblockingControl = rnd() & 1;
+	e->u8ConstrainedIntraPred = rnd() & 1;
+	e->u8RedundantPicCnt = rnd() & 1;
+	put_bits(&w, e->u8DeblockingControl, 1);
+	put_bits(&w, e->u8ConstrainedIntraPred, 1);
+	put_bits(&w, e->u8RedundantPicCnt, 1);
+
+	if (rnd() & 1) {
+		e->u8Transform8x8 = rnd() & 1;
+		put_bits(&w, e->u8Transform8x8, 1);
+		n = rnd() & 1;
+		put_bits(&w, n, 1);
+		if (n) {
+			n = 6 + ((sps->u8ChromaFormatIdc == 3) ? 6 : 2) * e->u8Transform8x8;
+			for (i = 0; i < n; i++) {
+				uint32_t f = rnd() & 1;
+
+				put_bits(&w, f, 1);
+				if (f)
+					put_scaling_list(&w, (i < 6) ? 16 : 64);
+			}
+		}
+		e->i8SecondChromaQpOffset = (int8_t)((int32_t)(rnd() % 25) - 12);
+		put_se(&w, e->i8SecondChromaQpOffset);
+	}
+
+	put_trailing(&w);
+	return nal_pack(out, 0x68, w.buf, w.bits / 8);
+}
+
+/* A slice of header s and u32Payload random payload bytes */
+static uint32_t gen_slice(uint8_t *out, const BS_H264_SLICE_T *s, const BS_H264_SPS_T *sps,
+			  const BS_H264_PPS_T *pps, uint32_t payload)
+{
+	static bw_t w;
+	uint32_t i;
+
+	w.bits = 0;
+	put_ue(&w, s->u32FirstMb);
+	put_ue(&w, s->u8SliceType + ((rnd() & 1) ? 5 : 0));
+	put_ue(&w, s->u8PpsId);
+	if (sps->u8SeparateColourPlane)
+		put_bits(&w, s->u8ColourPlane, 2);
+	put_bits(&w, s->u32FrameNum, sps->u8Log2MaxFrameNum);
+	if (!sps->u8FrameMbsOnly) {
+		put_bits(&w, s->u8FieldPic, 1);
+		if (s->u8FieldPic)
+			put_bits(&w, s->u8BottomField, 1);
+	}
+	if (s->u8NalType == BS_H264_NAL_IDR)
+		put_ue(&w, s->u32IdrPicId);
+	if (sps->u8PocType == 0) {
+		put_bits(&w, s->u32PocLsb, sps->u8Log2MaxPocLsb);
+		if (pps->u8BottomFieldPicOrder && !s->u8FieldPic)
+			put_se(&w, s->i32DeltaPocBottom);
+	} else if (sps->u8PocType == 1 && !sps->u8DeltaPicOrderAlwaysZero) {
+		put_se(&w, s->ai32DeltaPoc[0]);
+		if (pps->u8BottomFieldPicOrder && !s->u8FieldPic)
+			put_se(&w, s->ai32DeltaPoc[1]);
+	}
+	for (i = 0; i < payload && w.bits < 8 * (sizeof(w.buf) - 8); i++)
+		put_bits(&w, (rnd() % 5) ? rnd() & 0xFF : 0, 8);
+	put_trailing(&w);
+	return nal_pack(out, (uint8_t)(s->u8NalRefIdc << 5 | s->u8NalType), w.buf, w.bits / 8);
+}
+
+static void rnd_slice(BS_H264_SLICE_T *s, const BS_H264_SPS_T *sps, const BS_H264_PPS_T *pps, int idr)
+{
+	memset(s, 0, sizeof(*s));
+	s->u8NalType = idr ? BS_H264_NAL_IDR : BS_H264_NAL_SLICE;
+	s->u8NalRefIdc = idr ? 1 + rnd() % 3 : rnd() % 4;
+	s->u8SliceType = idr ? BS_H264_SLICE_I : rnd() % 5;
+	s->u8PpsId = pps->u8PpsId;
+	s->u8ColourPlane = sps->u8SeparateColourPlane ? rnd() % 3 : 0;
+	s->u32FirstMb = rnd() % (sps->u16WidthMbs * sps->u16HeightMbs);
+	s->u32FrameNum = idr ? 0 : rnd() & ((1u << sps->u8Log2MaxFrameNum) - 1);
+	if (!sps->u8FrameMbsOnly) {
+		s->u8FieldPic = rnd() & 1;
+		s->u8BottomField = s->u8FieldPic ? rnd() & 1 : 0;
+	}
+	s->u32IdrPicId = idr ? rnd() % 65536 : 0;
+	if (sps->u8PocType == 0) {
+		s->u32PocLsb = rnd() & ((1u << sps->u8Log2MaxPocLsb) - 1);
+		if (pps->u8BottomFieldPicOrder && !s->u8FieldPic)
+			s->i32DeltaPocBottom = (int32_t)(rnd() % 2001) - 1000;
+	} else if (sps->u8PocType == 1 && !sps->u8DeltaPicOrderAlwaysZero) {
+		s->ai32DeltaPoc[0] = (int32_t)(rnd() % 2001) - 1000;
+		if (pps->u8BottomFieldPicOrder && !s->u8FieldPic)
+			s->ai32DeltaPoc[1] = (int32_t)(rnd() % 2001) - 1000;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* Tests                                                                     */
+/*---------------------------------------------------------------------------*/
+
+static uint8_t s_stream[MAXSTREAM];
+static uint8_t s_work[MAXSTREAM];
+
+static void test_reader(void)
+{
+	static bw_t w;
+	static uint8_t nal[2 * sizeof(w.buf)];
+	static uint32_t val[1000], kind[1000], width[1000];
+	BS_READER_T r;
+	uint32_t iter, i, n, len, v;
+	int ok = 1;
+
+	printf("bit reader\n");
+	for (iter = 0; iter < 300 && ok; iter++) {
+		w.bits = 0;
+		n = 1 + rnd() % 1000;
+		for (i = 0; i < n; i++) {
+			kind[i] = rnd() % 3;
+			switch (kind[i]) {
+			case 0:
+				width[i] = rnd() % 33;
+				val[i] = (width[i] == 32) ? rnd() : rnd() & ((1u << width[i]) - 1);
+				if (rnd() % 3 == 0)
+					val[i] = 0;     /* runs of zero bytes, for emulation prevention */
+				put_bits(&w, val[i], width[i]);
+				break;
+			case 1:
+				val[i] = (rnd() % 8 == 0) ? rnd() % 0xFFFFFFFF : rnd() % 300;
+				put_ue(&w, val[i]);
+				break;
+			default:
+				val[i] = rnd() % 2000;
+				put_se(&w, (int32_t)val[i] - 1000);
+				break;
+			}
+		}
+		put_trailing(&w);
+		len = nal_pack(nal, 0x65, w.buf, w.bits / 8);
+
+		c_bs_reader_init(&r, nal + 1, len - 1);
+		for (i = 0; i < n && ok; i++) {
+			v = (kind[i] == 0) ? c_bs_read_bits(&r, width[i]) :
+			    (kind[i] == 1) ? c_bs_read_ue(&r) : (uint32_t)(c_bs_read_se(&r) + 1000);
+			if (v != val[i] || r.bOverrun) {
+				CHECK(0, "element %u of %u: %u, want %u", i, n, v, val[i]);
+				ok = 0;
+			}
+		}
+		CHECK(!c_bs_more_rbsp_data(&r), "more_rbsp_data() at the stop bit");
+		c_bs_read_bits(&r, 9);
+		CHECK(r.bOverrun, "no overrun past the end");
+	}
+}
+
+static void test_h264_headers(void)
+{
+	static uint8_t nal[16384];
+	static BS_H264_SPS_T sps[BS_H264_MAX_SPS];
+	static BS_H264_PPS_T pps[BS_H264_MAX_PPS];
+	BS_H264_SPS_T e;
+	BS_H264_PPS_T ep;
+	BS_H264_SLICE_T es, s;
+	uint32_t iter, len;
+	int ret;
+
+	printf("H.264 SPS, PPS and slice headers\n");
+	for (iter = 0; iter < 5000; iter++) {
+		memset(sps, 0, sizeof(sps));
+		memset(pps, 0, sizeof(pps));
+
+		len = gen_sps(nal, &e, 0);
+		memset(&sps[e.u8SpsId], 0x5A, sizeof(sps[0]));
+		ret = c_bs_h264_parse_sps(nal, len, &sps[e.u8SpsId]);
+		if (ret != BS_OK || memcmp(&sps[e.u8SpsId], &e, sizeof(e)) != 0) {
+			CHECK(0, "SPS %u: ret %d, %ux%u, want %ux%u", iter, ret, sps[e.u8SpsId].u32Width,
+			      sps[e.u8SpsId].u32Height, e.u32Width, e.u32Height);
+			break;
+		}
+
+		len = gen_pps(nal, &ep, &e);
+		ret = c_bs_h264_parse_pps(nal, len, sps, &pps[ep.u8PpsId]);
+		if (ret != BS_OK || memcmp(&pps[ep.u8PpsId], &ep, sizeof(ep)) != 0) {
+			CHECK(0, "PPS %u: ret %d", iter, ret);
+			break;
+		}
+
+		rnd_slice(&es, &e, &ep, rnd() & 1);
+		len = gen_slice(nal, &es, &e, &ep, rnd() % 64);
+		ret = c_bs_h264_parse_slice(nal, len, sps, pps, &s);
+		if (ret != BS_OK || memcmp(&s, &es, sizeof(s)) != 0) {
+			CHECK(0, "slice %u: ret %d", iter, ret);
+			break;
+		}
+		CHECK(!c_bs_h264_new_picture(&es, &s, &e), "a slice is a new picture after itself");
+		s.u32FrameNum ^= 1;
+		CHECK(c_bs_h264_new_picture(&es, &s, &e), "another frame_num is the same picture");
+
+		pps[ep.u8PpsId].u8Valid = 0;
+		CHECK(c_bs_h264_parse_slice(nal, len, sps, pps, &s) == BS_ERR_MISSING, "slice without its PPS");
+		CHECK(c_bs_h264_parse_sps(nal, len, &e) == BS_ERR_SYNTAX, "a slice taken for an SPS");
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* Streams of known layout                                                   */
+/*---------------------------------------------------------------------------*/
+
+static uint8_t s_stream[MAXSTREAM];
+static uint8_t s_work[MAXSTREAM];
+
+/* Expected frames of the last generated stream */
+static BS_INDEX_ENTRY_T s_expect[MAXFRAMES];
+static uint32_t s_nexpect;
+static uint32_t s_width, s_height, s_rate_num, s_rate_den;
+
+static uint32_t put_start_code(uint8_t *p)
+{
+	uint32_t n = 0, z = (rnd() % 3 == 0) ? 3 + rnd() % 4 : 2 + (rnd() & 1);
+
+	while (z--)
+		p[n++] = 0;
+	p[n++] = 1;
+	return n;
+}
+
+/*
+ * An Annex B stream of up to `frames` pictures with SPS, PPS, AUD and SEI
+ * where encoders put them, some pictures in several slices and some
+ * slices longer than BS_H264_HEAD_SIZE. frame_num and the picture order
+ * count go as H.264 has them, so that the first slice of each picture
+ * differs from the previous picture in the fields 7.4.1.2.4 compares.
+ */
+static uint32_t gen_h264(uint8_t *out, uint32_t max, uint32_t frames)
+{
+	static uint8_t sps_nal[4096], pps_nal[2][4096];
+	uint32_t sps_len, pps_len[2], len = 0, f, k, n, i, slices, prev_ref = 0, poc = 0, idr_id = 0;
+	BS_H264_SPS_T sps;
+	BS_H264_PPS_T pps[2];
+	BS_H264_SLICE_T s;
+	int idr, ref, pick;
+
+	sps_len = gen_sps(sps_nal, &sps, 1);
+	do {
+		for (k = 0; k < 2; k++)
+			pps_len[k] = gen_pps(pps_nal[k], &pps[k], &sps);
+	} while (pps[0].u8PpsId == pps[1].u8PpsId);
+
+	s_width = sps.u32Width;
+	s_height = sps.u32Height;
+	s_rate_num = sps.u32TimeScale;
+	s_rate_den = 2 * sps.u32NumUnitsInTick;
+
+	s_nexpect = 0;
+	for (f = 0; f < frames && s_nexpect < MAXFRAMES && len + 65536 < max; f++) {
+		idr = (f == 0) || (rnd() % 10 == 0);
+		ref = idr || (sps.u8PocType != 0) || (rnd() % 3 != 0);
+
+		s_expect[s_nexpect].u64Offset = len;
+		/* trailing_zero_8bits of the previous frame, indexed as leading zeros of this one */
+		if (f && rnd() % 16 == 0) {
+			n = 1 + rnd() % 8;
+			while (n--)
+				out[len++] = 0;
+		}
+		if (rnd() % 3 == 0) {
+			len += put_start_code(out + len);
+			out[len++] = BS_H264_NAL_AUD;
+			out[len++] = 0x10 | (rnd() & 0xE0);
+		}
+		if (idr || rnd() % 20 == 0) {
+			len += put_start_code(out + len);
+			memcpy(out + len, sps_nal, sps_len);
+			len += sps_len;
+			for (k = 0; k < 2; k++) {
+				len += put_start_code(out + len);
+				memcpy(out + len, pps_nal[k], pps_len[k]);
+				len += pps_len[k];
+			}
+		}
+		if (rnd() % 4 == 0) {
+			len += put_start_code(out + len);
+			out[len++] = BS_H264_NAL_SEI;
+			n = 1 + rnd() % 40;
+			for (i = 0; i < n; i++)
+				out[len++] = 0x20 + rnd() % 0x60;
+			out[len++] = 0x80;
+		}
+
+		pick = rnd() & 1;
+		rnd_slice(&s, &sps, &pps[pick], idr);
+		s.u8NalRefIdc = ref ? 1 + rnd() % 3 : 0;
+		s.u32FrameNum = idr ? 0 : (prev_ref + 1) & ((1u << sps.u8Log2MaxFrameNum) - 1);
+		if (ref)
+			prev_ref = s.u32FrameNum;
+		s.u32IdrPicId = idr ? idr_id++ & 0xFFFF : 0;
+		poc += 2;
+		s.u32PocLsb = (sps.u8PocType == 0) ? poc & ((1u << sps.u8Log2MaxPocLsb) - 1) : 0;
+		s.u8FieldPic = s.u8BottomField = 0;
+		s.i32DeltaPocBottom = 0;
+		s.ai32DeltaPoc[0] = s.ai32DeltaPoc[1] = 0;
+		s.u32FirstMb = 0;
+		s_expect[s_nexpect].u32Flags = (idr ? BS_INDEX_KEY : 0) |
+			(((s.u8SliceType == BS_H264_SLICE_I) || (s.u8SliceType == BS_H264_SLICE_SI)) ? BS_INDEX_INTRA : 0);
+		s_nexpect++;
+
+		slices = (rnd() % 3 == 0) ? 2 + rnd() % 3 : 1;
+		for (k = 0; k < slices; k++) {
+			if (k) {
+				s.u32FirstMb += 1 + rnd() % 4;
+				if (s.u32FirstMb >= (uint32_t)sps.u16WidthMbs * sps.u16HeightMbs)
+					break;
+				/* other slices of a picture may be of another type */
+				if (!idr)
+					s.u8SliceType = rnd() % 5;
+			}
+			len += put_start_code(out + len);
+			len += gen_slice(out + len, &s, &sps, &pps[pick], (rnd() % 8 == 0) ? 1000 + rnd() % 6000 : rnd() % 300);
+		}
+
+	}
+	return len;
+}
+
+/* Index `len` bytes of `data` with variant v, fed in pieces of random size up to `piece` bytes */
+static void index_h264(const variant_t *v, BS_INDEX_T *idx, BS_INDEX_ENTRY_T *ent, uint32_t max,
+		       const uint8_t *data, uint32_t len, uint32_t piece)
+{
+	static BS_H264_INDEXER_T ix;
+	uint32_t pos = 0, n;
+
+	c_bs_index_init(idx, BS_CODEC_H264, ent, max);
+	v->h264_init(&ix, idx);
+	while (pos < len) {
+		n = piece ? 1 + rnd() % piece : len - pos;
+		if (n > len - pos)
+			n = len - pos;
+		v->h264_feed(&ix, data + pos, n);
+		pos += n;
+	}
+	v->h264_end(&ix);
+}
+
+static int index_matches(const BS_INDEX_T *idx)
+{
+	uint32_t i;
+
+	if (idx->u32Count != s_nexpect)
+		return 0;
+	for (i = 0; i < s_nexpect; i++) {
+		if (idx->pasEntry[i].u64Offset != s_expect[i].u64Offset ||
+		    idx->pasEntry[i].u32Flags != s_expect[i].u32Flags) {
+			printf("  frame %u at %llu flags %x, want %llu flags %x\n", i,
+			       (unsigned long long)idx->pasEntry[i].u64Offset, idx->pasEntry[i].u32Flags,
+			       (unsigned long long)s_expect[i].u64Offset, s_expect[i].u32Flags);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void test_scan(void)
+{
+	static uint32_t ref_pos[MAXSTREAM / 3], ref_zeros[MAXSTREAM / 3];
+	uint32_t iter, len, i, nref, pos, end, z, got, n, piece, v, bad;
+	uint32_t zz;
+
+	printf("start code scanner\n");
+	for (iter = 0; iter < 400; iter++) {
+		/* bytes dense in 0x00, 0x01 and 0x03, or a real stream */
+		if (iter % 4 == 3) {
+			len = gen_h264(s_stream, 1 << 20, 30);
+		} else {
+			len = rnd() % 20000;
+			for (i = 0; i < len; i++) {
+				switch (rnd() % (2 + iter % 8)) {
+				case 0:  s_stream[i] = 0; break;
+				case 1:  s_stream[i] = 1; break;
+				case 2:  s_stream[i] = 0; break;
+				case 3:  s_stream[i] = 3; break;
+				default: s_stream[i] = rnd(); break;
+				}
+			}
+		}
+
+		/* byte by byte reference */
+		for (i = 0, nref = 0, z = 0; i < len; i++) {
+			if (s_stream[i] == 1 && z >= 2) {
+				ref_pos[nref] = i;
+				ref_zeros[nref++] = z;
+			}
+			z = s_stream[i] ? 0 : z + 1;
+		}
+
+		for (v = 0; v < V_NUM; v++) {
+			/* in pieces, carrying the zeros across */
+			for (piece = 0; piece < 3; piece++) {
+				pos = 0;
+				n = 0;
+				zz = 0;
+				bad = 0;
+				while (pos < len && !bad) {
+					end = pos + ((piece == 0) ? len : (piece == 1) ? 1 + rnd() % 64 : 1 + rnd() % 4096);
+					if (end > len)
+						end = len;
+					/* the piece is s_stream[pos..end), seen at offset 0 of a copy */
+					memcpy(s_work, s_stream + pos, end - pos);
+					i = 0;
+					for (;;) {
+						got = s_var[v].scan(s_work, i, end - pos, &zz);
+						if (got == end - pos)
+							break;
+						if (n >= nref || pos + got != ref_pos[n] || zz != ref_zeros[n]) {
+							bad = 1;
+							break;
+						}
+						n++;
+						zz = 0;
+						i = got + 1;
+					}
+					pos = end;
+				}
+				if (bad || n != nref) {
+					CHECK(0, "%s, stream %u, piece mode %u: %u of %u start codes", s_var[v].desc, iter,
+					      piece, n, nref);
+					return;
+				}
+				/* the zeros left at the end */
+				for (i = len, z = 0; i > 0 && s_stream[i - 1] == 0; i--)
+					z++;
+				CHECK(zz == z, "%s: %u trailing zeros, want %u", s_var[v].desc, zz, z);
+			}
+		}
+	}
+}
+
+static void test_h264_index(void)
+{
+	static BS_INDEX_ENTRY_T ent[V_NUM][MAXFRAMES];
+	BS_INDEX_T idx[V_NUM];
+	uint32_t iter, len, v, mode, piece;
+
+	printf("H.264 access unit index\n");
+	for (iter = 0; iter < 60; iter++) {
+		len = gen_h264(s_stream, MAXSTREAM, 20 + rnd() % 300);
+		for (mode = 0; mode < 4; mode++) {
+			piece = (mode == 0) ? 0 : (mode == 1) ? 7 : (mode == 2) ? 1500 : 100000;
+			for (v = 0; v < V_NUM; v++) {
+				index_h264(&s_var[v], &idx[v], ent[v], MAXFRAMES, s_stream, len, piece);
+				if (!index_matches(&idx[v])) {
+					CHECK(0, "%s, stream %u, pieces up to %u: %u frames, want %u", s_var[v].desc, iter,
+					      piece, idx[v].u32Count, s_nexpect);
+					return;
+				}
+			}
+		}
+		CHECK(idx[V_C].u32Width == s_width && idx[V_C].u32Height == s_height, "size %ux%u, want %ux%u",
+		      idx[V_C].u32Width, idx[V_C].u32Height, s_width, s_height);
+		CHECK(idx[V_C].u32RateNum == s_rate_num && idx[V_C].u32RateDen == s_rate_den, "frame rate");
+		CHECK(idx[V_C].u64StreamLen == len, "stream length");
+	}
+
+	/* too few entries: the first ones are kept */
+	len = gen_h264(s_stream, MAXSTREAM, 100);
+	index_h264(&s_var[V_C], &idx[V_C], ent[V_C], 10, s_stream, len, 0);
+	CHECK(idx[V_C].u32Count == 10 && idx[V_C].bOverflow && ent[V_C][9].u64Offset == s_expect[9].u64Offset,
+	      "index overflow");
+}
+
+/* Bit by bit CRC-32 of IEEE 802.3 */
+static uint32_t ref_crc32(const uint8_t *p, uint32_t n)
+{
+	uint32_t crc = 0xFFFFFFFF, k;
+
+	while (n--) {
+		crc ^= *p++;
+		for (k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+	}
+	return ~crc;
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void test_index(void)
+{
+	static BS_INDEX_ENTRY_T ent[MAXFRAMES], ent2[MAXFRAMES];
+	static uint8_t file[BS_INDEX_FILE_SIZE(MAXFRAMES)];
+	BS_INDEX_T idx, idx2;
+	uint32_t iter, i, j, n, size;
+	uint64_t off;
+	int32_t r, want;
+
+	printf("index, seek and index file\n");
+	for (iter = 0; iter < 200; iter++) {
+		n = rnd() % 300;
+		c_bs_index_init(&idx, BS_CODEC_H264, ent, MAXFRAMES);
+		for (i = 0, off = rnd() % 100; i < n; i++) {
+			c_bs_index_add(&idx, off, (rnd() % 8 == 0) ? BS_INDEX_KEY | BS_INDEX_INTRA : (rnd() % 2) * BS_INDEX_INTRA);
+			off += 1 + ((rnd() % 50 == 0) ? (uint64_t)rnd() << 8 : rnd() % 100000);
+		}
+		idx.u64StreamLen = off;
+		idx.u32Width = rnd() % 4096;
+		idx.u32Height = rnd() % 4096;
+		idx.u32RateNum = rnd();
+		idx.u32RateDen = rnd();
+
+		for (j = 0; j < 50; j++) {
+			i = rnd() % (n + 2);
+			for (want = (i < n) ? (int32_t)i : (int32_t)n - 1; want >= 0 && !(ent[want].u32Flags & BS_INDEX_KEY); want--)
+				;
+			r = c_bs_index_seek(&idx, i, BS_INDEX_KEY);
+			CHECK(r == want, "seek to %u: %d, want %d", i, r, want);
+
+			off = n ? ent[rnd() % n].u64Offset + rnd() % 3 - 1 : rnd();
+			for (want = -1, i = 0; i < n && ent[i].u64Offset <= off; i++)
+				want = i;
+			r = c_bs_index_frame_at(&idx, off);
+			CHECK(r == want, "frame at %llu: %d, want %d", (unsigned long long)off, r, want);
+		}
+		for (i = 0; i < n; i++) {
+			off = (i + 1 < n) ? ent[i + 1].u64Offset : idx.u64StreamLen;
+			if (c_bs_index_frame_len(&idx, i) != (uint32_t)(off - ent[i].u64Offset)) {
+				CHECK(0, "frame %u length", i);
+				break;
+			}
+		}
+
+		size = (uint32_t)c_bs_index_save(&idx, file, sizeof(file));
+		CHECK(size == BS_INDEX_FILE_SIZE(n), "saved %u bytes", size);
+		CHECK(c_bs_index_save(&idx, file, size - 1) == BS_ERR_FULL, "saved into too small a buffer");
+
+		c_bs_index_init(&idx2, 0, ent2, MAXFRAMES);
+		CHECK(c_bs_index_load(&idx2, file, size) == BS_OK &&
+		      idx2.u32Count == n && idx2.u64StreamLen == idx.u64StreamLen && idx2.u32Codec == idx.u32Codec &&
+		      idx2.u32Width == idx.u32Width && idx2.u32RateDen == idx.u32RateDen &&
+		      memcmp(ent, ent2, n * sizeof(ent[0])) == 0, "load after save");
+
+		i = rnd() % size;
+		file[i] ^= 1 << (rnd() % 8);
+		CHECK(c_bs_index_load(&idx2, file, size) == BS_ERR_SYNTAX, "a damaged index file (byte %u) loaded", i);
+		c_bs_index_save(&idx, file, sizeof(file));
+
+		if (n > 0) {
+			c_bs_index_init(&idx2, 0, ent2, n - 1);
+			CHECK(c_bs_index_load(&idx2, file, size) == BS_ERR_FULL, "loaded into too few entries");
+		}
+		CHECK(get32(file + 44) == ref_crc32((const uint8_t *)file, 44) &&
+		      get32(file + 40) == ref_crc32(file + BS_INDEX_FILE_HEADER, n * BS_INDEX_FILE_ENTRY),
+		      "index file CRC-32");
+	}
+
+	CHECK(ref_crc32((const uint8_t *)"123456789", 9) == 0xCBF43926, "reference CRC-32");
+	memcpy(file, "123456789", 9);
+	c_bs_index_init(&idx2, 0, ent2, MAXFRAMES);
+	CHECK(c_bs_index_load(&idx2, file, size) == BS_ERR_SYNTAX, "a foreign file loaded");
+}
+
+/*---------------------------------------------------------------------------*/
+/* JPEG                                                                      */
+/*---------------------------------------------------------------------------*/
+
+typedef struct {
+	uint32_t width, height;
+	uint8_t orientation;        /* 0 for no orientation tag */
+	int big;                    /* Motorola byte order in the TIFF structure */
+	int progressive;
+	uint16_t restart;
+	uint32_t scan_offset;
+	uint32_t sof_end;           /* bytes up to the end of the SOF segment */
+} jpeg_param_t;
+
+static uint32_t put16be(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)(v >> 8);
+	p[1] = (uint8_t)v;
+	return 2;
+}
+
+static void put16(uint8_t *p, uint32_t v, int big)
+{
+	p[big ? 0 : 1] = (uint8_t)(v >> 8);
+	p[big ? 1 : 0] = (uint8_t)v;
+}
+
+static void put32(uint8_t *p, uint32_t v, int big)
+{
+	put16(p + (big ? 0 : 2), v >> 16, big);
+	put16(p + (big ? 2 : 0), v & 0xFFFF, big);
+}
+
+/* Segment of `len` body bytes with marker m, random body unless given */
+static uint32_t put_segment(uint8_t *out, uint8_t m, const uint8_t *body, uint32_t len)
+{
+	uint32_t n = 0, i;
+
+	while (rnd() % 8 == 0)
+		out[n++] = 0xFF;        /* fill bytes */
+	out[n++] = 0xFF;
+	out[n++] = m;
+	n += put16be(out + n, len + 2);
+	for (i = 0; i < len; i++)
+		out[n + i] = body ? body[i] : (uint8_t)rnd();
+	return n + len;
+}
+
+/* Entropy coded data with 0xFF stuffed and restart markers */
+static uint32_t put_ecs(uint8_t *out, uint32_t len)
+{
+	uint32_t n = 0, i, rst = 0;
+
+	for (i = 0; i < len; i++) {
+		out[n++] = (rnd() % 16 == 0) ? 0xFF : (uint8_t)rnd();
+		if (out[n - 1] == 0xFF)
+			out[n++] = 0x00;
+		if (rnd() % 500 == 0) {
+			out[n++] = 0xFF;
+			out[n++] = 0xD0 + (rst++ & 7);
+		}
+	}
+	return n;
+}
+
+static uint32_t gen_jpeg(uint8_t *out, jpeg_param_t *p)
+{
+	static const uint8_t jfif[14] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+	static uint8_t body[4096];
+	uint8_t sos[10] = { 3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0 };
+	uint32_t n = 0, k, i, tags, ifd, len, scans;
+
+	p->width = 8 + rnd() % 4000;
+	p->height = 8 + rnd() % 4000;
+	p->orientation = (rnd() % 3) ? rnd() % 9 : 0;
+	p->big = rnd() & 1;
+	p->progressive = rnd() & 1;
+	p->restart = (rnd() & 1) ? rnd() % 65536 : 0;
+
+	out[n++] = 0xFF;
+	out[n++] = 0xD8;
+	n += put_segment(out + n, 0xE0, jfif, sizeof(jfif));
+
+	/* Exif: IFD0 with a few tags, the orientation among them, then a thumbnail JPEG */
+	if (p->orientation || (rnd() & 1)) {
+		memcpy(body, "Exif\0\0", 6);
+		body[6] = body[7] = p->big ? 'M' : 'I';
+		put16(body + 8, 42, p->big);
+		put32(body + 10, 8, p->big);
+		ifd = 6 + 8;
+		tags = 1 + rnd() % 6;
+		put16(body + ifd, tags + (p->orientation ? 1 : 0), p->big);
+		len = ifd + 2;
+		k = p->orientation ? rnd() % (tags + 1) : tags + 1;
+		for (i = 0; i <= tags; i++) {
+			if (i == k) {
+				put16(body + len, 0x0112, p->big);
+				put16(body + len + 2, 3, p->big);
+				put32(body + len + 4, 1, p->big);
+				put32(body + len + 8, 0, p->big);
+				put16(body + len + 8, p->orientation, p->big);
+				len += 12;
+			}
+			if (i == tags)
+				break;
+			put16(body + len, 0x010F + i, p->big);      /* Make, Model, ... */
+			put16(body + len + 2, 2, p->big);
+			put32(body + len + 4, 4, p->big);
+			memcpy(body + len + 8, "abc", 4);
+			len += 12;
+		}
+		put32(body + len, 0, p->big);
+		len += 4;
+		/* a thumbnail: SOI, EOI and SOS inside the segment */
+		body[len++] = 0xFF;
+		body[len++] = 0xD8;
+		for (i = 0, k = 100 + rnd() % 1500; i < k; i++)
+			body[len++] = (rnd() % 8 == 0) ? 0xFF : (uint8_t)rnd();
+		body[len++] = 0xFF;
+		body[len++] = 0xDA;
+		body[len++] = 0xFF;
+		body[len++] = 0xD9;
+		n += put_segment(out + n, 0xE1, body, len);
+	}
+
+	n += put_segment(out + n, 0xDB, NULL, 65);
+	if (rnd() & 1)
+		n += put_segment(out + n, 0xFE, NULL, rnd() % 200);          /* COM */
+
+	body[0] = 8;
+	put16be(body + 1, p->height);
+	put16be(body + 3, p->width);
+	body[5] = 3;
+	body[6] = 1; body[7] = 0x22; body[8] = 0;
+	body[9] = 2; body[10] = 0x11; body[11] = 1;
+	body[12] = 3; body[13] = 0x11; body[14] = 1;
+	n += put_segment(out + n, p->progressive ? 0xC2 : 0xC0, body, 15);
+	p->sof_end = n;
+
+	n += put_segment(out + n, 0xC4, NULL, 20 + rnd() % 400);
+	if (p->restart) {
+		put16be(body, p->restart);
+		n += put_segment(out + n, 0xDD, body, 2);
+	}
+
+	scans = p->progressive ? 1 + rnd() % 4 : 1;
+	for (k = 0; k < scans; k++) {
+		if (k)
+			n += put_segment(out + n, 0xC4, NULL, 20 + rnd() % 100);
+		n += put_segment(out + n, 0xDA, sos, sizeof(sos));
+		if (k == 0)
+			p->scan_offset = n;
+		n += put_ecs(out + n, (rnd() % 8 == 0) ? rnd() % 100000 : rnd() % 5000);
+	}
+
+	out[n++] = 0xFF;
+	out[n++] = 0xD9;
+	return n;
+}
+
+/* An MJPEG stream of up to `frames` JPEGs, some with bytes between them; the frames in s_expect */
+static uint32_t gen_mjpeg(uint8_t *out, uint32_t max, uint32_t frames)
+{
+	jpeg_param_t p;
+	uint32_t len = 0, f, n;
+
+	s_nexpect = 0;
+	for (f = 0; f < frames && s_nexpect < MAXFRAMES && len + 200000 < max; f++) {
+		if (rnd() % 4 == 0) {
+			/* padding, no 0xFF */
+			for (n = rnd() % 600; n; n--)
+				out[len++] = (uint8_t)(rnd() % 0xFF);
+		}
+		s_expect[s_nexpect].u64Offset = len;
+		s_expect[s_nexpect++].u32Flags = BS_INDEX_KEY | BS_INDEX_INTRA;
+		len += gen_jpeg(out + len, &p);
+		if (f == 0) {
+			s_width = p.width;
+			s_height = p.height;
+		}
+	}
+	return len;
+}
+
+static void index_jpeg(const variant_t *v, BS_INDEX_T *idx, BS_INDEX_ENTRY_T *ent, uint32_t max,
+		       const uint8_t *data, uint32_t len, uint32_t piece)
+{
+	BS_JPEG_INDEXER_T ix;
+	uint32_t pos = 0, n;
+
+	c_bs_index_init(idx, BS_CODEC_MJPEG, ent, max);
+	v->jpeg_init(&ix, idx);
+	while (pos < len) {
+		n = piece ? 1 + rnd() % piece : len - pos;
+		if (n > len - pos)
+			n = len - pos;
+		v->jpeg_feed(&ix, data + pos, n);
+		pos += n;
+	}
+	v->jpeg_end(&ix);
+}
+
+static void test_jpeg(void)
+{
+	static const uint32_t rot[9] = { 0, 0, 0, 180, 180, 270, 90, 90, 270 };
+	static BS_INDEX_ENTRY_T ent[MAXFRAMES];
+	BS_JPEG_INFO_T info;
+	BS_INDEX_T idx;
+	jpeg_param_t p;
+	uint32_t iter, len, v, mode;
+	int ret;
+
+	printf("JPEG headers and MJPEG frames\n");
+	for (iter = 0; iter < 2000; iter++) {
+		len = gen_jpeg(s_stream, &p);
+		ret = c_bs_jpeg_parse(s_stream, len, &info);
+		if (ret != BS_OK || info.u32Width != p.width || info.u32Height != p.height ||
+		    info.u8Sof != (p.progressive ? 0xC2 : 0xC0) || info.u8Components != 3 ||
+		    info.au8Sampling[0] != 0x22 || info.au8Sampling[1] != 0x11 ||
+		    info.u8Orientation != p.orientation || info.u16RestartInterval != p.restart ||
+		    info.u32ScanOffset != p.scan_offset) {
+			CHECK(0, "JPEG %u: ret %d, %ux%u orientation %u scan at %u, want %ux%u %u %u", iter, ret,
+			      info.u32Width, info.u32Height, info.u8Orientation, info.u32ScanOffset, p.width, p.height,
+			      p.orientation, p.scan_offset);
+			return;
+		}
+		CHECK(c_bs_jpeg_rotation(p.orientation) == rot[p.orientation], "rotation of %u", p.orientation);
+
+		/* the head of the file is enough */
+		ret = c_bs_jpeg_parse(s_stream, p.sof_end + rnd() % 4, &info);
+		CHECK(ret == BS_OK && info.u32Width == p.width && info.u32ScanOffset == 0, "JPEG head: %d", ret);
+		CHECK(c_bs_jpeg_parse(s_stream, p.sof_end - 1 - rnd() % 20, &info) == BS_ERR_TRUNCATED,
+		      "JPEG cut before its SOF");
+
+		CHECK(c_bs_jpeg_frame_len(s_stream, len + rnd() % 100) == len, "JPEG %u length", iter);
+		CHECK(c_bs_jpeg_frame_len(s_stream, len - 1) == 0, "JPEG %u without its EOI", iter);
+	}
+
+	for (iter = 0; iter < 40; iter++) {
+		len = gen_mjpeg(s_stream, MAXSTREAM, 1 + rnd() % 60);
+		for (mode = 0; mode < 3; mode++) {
+			for (v = 0; v < V_NUM; v++) {
+				index_jpeg(&s_var[v], &idx, ent, MAXFRAMES, s_stream, len,
+					   (mode == 0) ? 0 : (mode == 1) ? 5 : 3000);
+				if (!index_matches(&idx) || idx.u32Width != s_width || idx.u32Height != s_height ||
+				    idx.u64StreamLen != len) {
+					CHECK(0, "%s, MJPEG %u: %u frames, want %u", s_var[v].desc, iter, idx.u32Count,
+					      s_nexpect);
+					return;
+				}
+			}
+		}
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* Fuzzing                                                                   */
+/*---------------------------------------------------------------------------*/
+
+static void mutate(uint8_t *p, uint32_t *plen, uint32_t max)
+{
+	static const uint8_t special[] = { 0x00, 0x01, 0x03, 0xFF, 0xD8, 0xD9, 0xDA, 0xC0, 0x67, 0x68, 0x65 };
+	uint32_t len = *plen, k, a, n;
+
+	for (k = rnd() % 16; k; k--) {
+		if (len == 0)
+			break;
+		a = rnd() % len;
+		switch (rnd() % 6) {
+		case 0:
+			p[a] ^= 1 << (rnd() % 8);
+			break;
+		case 1:
+			p[a] = special[rnd() % sizeof(special)];
+			break;
+		case 2:
+			/* delete */
+			n = rnd() % (len - a);
+			memmove(p + a, p + a + n, len - a - n);
+			len -= n;
+			break;
+		case 3:
+			/* repeat a piece */
+			n = rnd() % (len - a);
+			if (n > 4096)
+				n = 4096;
+			if (len + n <= max) {
+				memmove(p + a + n, p + a, len - a);
+				len += n;
+			}
+			break;
+		case 4:
+			len = a;
+			break;
+		default:
+			for (n = rnd() % 16; n && a < len; n--)
+				p[a++] = (uint8_t)rnd();
+			break;
+		}
+	}
+	*plen = len;
+}
+
+static void fuzz(uint32_t iterations)
+{
+	static BS_INDEX_ENTRY_T ent[2][MAXFRAMES];
+	static BS_H264_SPS_T sps[BS_H264_MAX_SPS];
+	static BS_H264_PPS_T pps[BS_H264_MAX_PPS];
+	BS_INDEX_T idx[2];
+	BS_H264_SLICE_T slice;
+	BS_H264_SPS_T s1;
+	BS_H264_PPS_T p1;
+	BS_JPEG_INFO_T info;
+	BS_READER_T r;
+	uint32_t iter, len, i, z[2], pos[2], nal, k;
+	uint8_t *data;
+
+	printf("fuzz, %u streams\n", iterations);
+	for (iter = 0; iter < iterations; iter++) {
+		switch (iter % 4) {
+		case 0:
+			len = gen_h264(s_work, 1 << 20, 1 + rnd() % 20);
+			break;
+		case 1:
+			len = gen_mjpeg(s_work, 1 << 20, 1 + rnd() % 4);
+			break;
+		case 2:
+			len = rnd() % 4096;
+			for (i = 0; i < len; i++)
+				s_work[i] = (uint8_t)rnd();
+			break;
+		default:
+			len = rnd() % 4096;
+			for (i = 0; i < len; i++)
+				s_work[i] = (rnd() & 1) ? 0 : (uint8_t)"\x01\x03\xFF\xD8\xD9\x67\x68\x65\x41\x09"[rnd() % 10];
+			break;
+		}
+		mutate(s_work, &len, 1 << 20);
+
+		/* exactly len bytes, for the sanitizer to see any read past them */
+		data = malloc(len ? len : 1);
+		memcpy(data, s_work, len);
+
+		/* the scanners agree, and parse what they find */
+		z[0] = z[1] = 0;
+		pos[0] = pos[1] = 0;
+		memset(sps, 0, sizeof(sps));
+		memset(pps, 0, sizeof(pps));
+		for (nal = 0;; nal++) {
+			for (k = 0; k < V_NUM; k++)
+				pos[k] = s_var[k].scan(data, pos[k], len, &z[k]);
+			if (pos[0] != pos[1] || z[0] != z[1]) {
+				CHECK(0, "fuzz %u: scanners differ, %u/%u and %u/%u", iter, pos[0], z[0], pos[1], z[1]);
+				break;
+			}
+			if (pos[0] == len)
+				break;
+			pos[0] = pos[1] = pos[0] + 1;
+			z[0] = z[1] = 0;
+			if (pos[0] == len || nal > 256)
+				continue;
+
+			if (c_bs_h264_parse_sps(data + pos[0], len - pos[0], &s1) == BS_OK)
+				sps[s1.u8SpsId] = s1;
+			if (c_bs_h264_parse_pps(data + pos[0], len - pos[0], sps, &p1) == BS_OK)
+				pps[p1.u8PpsId] = p1;
+			c_bs_h264_parse_slice(data + pos[0], len - pos[0], sps, pps, &slice);
+		}
+
+		/* the indexers give the same frames whole and in pieces */
+		index_h264(&s_var[V_NEON], &idx[0], ent[0], MAXFRAMES, data, len, 0);
+		index_h264(&s_var[V_C], &idx[1], ent[1], MAXFRAMES, data, len, 1 + rnd() % 2000);
+		CHECK(idx[0].u32Count == idx[1].u32Count &&
+		      memcmp(ent[0], ent[1], idx[0].u32Count * sizeof(ent[0][0])) == 0 &&
+		      idx[0].u32Width == idx[1].u32Width, "fuzz %u: H.264 index depends on the pieces", iter);
+
+		index_jpeg(&s_var[V_NEON], &idx[0], ent[0], MAXFRAMES, data, len, 0);
+		index_jpeg(&s_var[V_C], &idx[1], ent[1], MAXFRAMES, data, len, 1 + rnd() % 2000);
+		CHECK(idx[0].u32Count == idx[1].u32Count &&
+		      memcmp(ent[0], ent[1], idx[0].u32Count * sizeof(ent[0][0])) == 0 &&
+		      idx[0].u32Width == idx[1].u32Width, "fuzz %u: MJPEG index depends on the pieces", iter);
+
+		for (k = 0; k < 8 && len; k++) {
+			i = (k == 0) ? 0 : rnd() % len;
+			c_bs_jpeg_parse(data + i, len - i, &info);
+			c_bs_jpeg_frame_len(data + i, len - i);
+		}
+
+		c_bs_reader_init(&r, data, len);
+		for (k = 0; k < 64 && !r.bOverrun; k++) {
+			switch (rnd() % 4) {
+			case 0:  c_bs_read_bits(&r, rnd() % 33); break;
+			case 1:  c_bs_read_ue(&r); break;
+			case 2:  c_bs_read_se(&r); break;
+			default: c_bs_more_rbsp_data(&r); break;
+			}
+		}
+
+		free(data);
+		if (s_fail)
+			break;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+/* Benchmark                                                                 */
+/*---------------------------------------------------------------------------*/
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static volatile uint32_t s_sink;
+
+/* Byte by byte, as h264_pipe.c had it */
+static uint32_t scan_bytewise(const uint8_t *p, uint32_t len)
+{
+	uint32_t i, z = 0, n = 0;
+
+	for (i = 0; i < len; i++) {
+		if (p[i] == 0) {
+			z++;
+			continue;
+		}
+		if (p[i] == 1 && z >= 2)
+			n++;
+		z = 0;
+	}
+	return n;
+}
+
+static uint32_t scan_all(const variant_t *v, const uint8_t *p, uint32_t len)
+{
+	uint32_t i = 0, z = 0, n = 0;
+
+	while ((i = v->scan(p, i, len, &z)) < len) {
+		n++;
+		i++;
+		z = 0;
+	}
+	return n;
+}
+
+static void bench(unsigned int ms)
+{
+	static BS_INDEX_ENTRY_T ent[MAXFRAMES];
+	static uint8_t h264[MAXSTREAM], mjpeg[MAXSTREAM];
+	BS_JPEG_INFO_T info;
+	BS_INDEX_T idx;
+	uint32_t h264_len, mjpeg_len, jpeg_len, len = 0;
+	const uint8_t *data = NULL;
+	uint64_t t0, t, bytes;
+	int k, v;
+
+	static const char *kernel[] = {
+		"scan, H.264 stream", "scan, random bytes", "H.264 index", "MJPEG index", "JPEG header",
+	};
+
+	h264_len = gen_h264(h264, MAXSTREAM, MAXFRAMES);
+	mjpeg_len = gen_mjpeg(mjpeg, MAXSTREAM, MAXFRAMES);
+	jpeg_len = (uint32_t)s_expect[1].u64Offset;
+	for (len = 0; len < MAXSTREAM; len++)
+		s_work[len] = (uint8_t)rnd();
+
+	printf("benchmark, MB/s (JPEG header: headers/s)\n");
+	for (k = 0; k < (int)(sizeof(kernel) / sizeof(kernel[0])); k++) {
+		printf("  %-20s", kernel[k]);
+		for (v = (k < 2) ? -1 : 0; v < V_NUM; v++) {
+			const variant_t *p = &s_var[(v < 0) ? V_C : v];
+
+			bytes = 0;
+			t0 = now_ns();
+			do {
+				switch (k) {
+				case 0:
+				case 1:
+					data = (k == 0) ? h264 : s_work;
+					len = (k == 0) ? h264_len : MAXSTREAM;
+					s_sink = (v < 0) ? scan_bytewise(data, len) : scan_all(p, data, len);
+					break;
+				case 2:
+					len = h264_len;
+					index_h264(p, &idx, ent, MAXFRAMES, h264, len, 0);
+					break;
+				case 3:
+					len = mjpeg_len;
+					index_jpeg(p, &idx, ent, MAXFRAMES, mjpeg, len, 0);
+					break;
+				case 4:
+					len = 1;
+					c_bs_jpeg_parse(mjpeg, jpeg_len, &info);
+					s_sink = info.u32Width;
+					break;
+				}
+				bytes += len;
+				t = now_ns() - t0;
+			} while (t < (uint64_t)ms * 1000000u);
+
+			if (k == 4)
+				printf("  %10.0f", bytes * 1e9 / t);
+			else
+				printf("  %s %8.1f", (v < 0) ? "bytewise" : p->desc, bytes * 1e3 / t);
+			if (k == 4)
+				break;
+		}
+		printf("\n");
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int ms = 300, iterations = 0;
+	int opt, do_bench = 0;
+
+	while ((opt = getopt(argc, argv, "bt:z:")) != -1) {
+		switch (opt) {
+		case 'b': do_bench = 1; break;
+		case 't': ms = strtoul(optarg, NULL, 0); break;
+		case 'z': iterations = strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-b] [-t ms] [-z iterations]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	test_reader();
+	test_h264_headers();
+	test_scan();
+	test_h264_index();
+	test_index();
+	test_jpeg();
+
+	if (iterations)
+		fuzz(iterations);
+
+	if (do_bench)
+		bench(ms);
+
+	printf(s_fail ? "FAIL\n" : "PASS\n");
+	return s_fail;
+}
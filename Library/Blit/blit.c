@@ -0,0 +1,498 @@
+/**************************************************************************//**
+ * @file     blit.c
+ *
+ * @brief    Command lists, clipping, engine selection and the CPU engine.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stddef.h>
+#include <string.h>
+
+#include "blit.h"
+
+#define CACHE_LINE      64          /* engines clean and invalidate whole lines */
+#define CHUNK           64          /* pixels converted at a time, even */
+#define ENGINE_CPU      (-1)
+
+typedef struct
+{
+    uintptr_t uStart;
+    uintptr_t uEnd;
+} RANGE_T;
+
+static BLIT_ENGINE_T s_asEngine[BLIT_ENGINE_MAX];
+static uint32_t s_u32Engines;
+
+uint32_t blit_fmt_bpp(uint32_t u32Format)
+{
+    switch (u32Format)
+    {
+    case BLIT_FMT_RGB565:
+    case BLIT_FMT_YUY2:
+    case BLIT_FMT_UYVY:
+        return 2;
+    case BLIT_FMT_ARGB8888:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static int is_yuv422(uint32_t u32Format)
+{
+    return (u32Format == BLIT_FMT_YUY2) || (u32Format == BLIT_FMT_UYVY);
+}
+
+uint32_t blit_fmt_color(uint32_t u32Argb, uint32_t u32Format)
+{
+    uint32_t u32Pattern = u32Argb;
+    uint32_t au32Pair[2] = { u32Argb, u32Argb };
+
+    if (u32Format == BLIT_FMT_RGB565)
+    {
+        uint16_t u16Pixel;
+
+        blit_row_argb8888_to_rgb565(&u16Pixel, &u32Argb, 1);
+        u32Pattern = u16Pixel;
+    }
+    else if (is_yuv422(u32Format))
+    {
+        blit_row_argb8888_to_yuv422((uint8_t *)&u32Pattern, au32Pair, 2, u32Format);
+    }
+    return u32Pattern;
+}
+
+static int check_surface(const BLIT_SURFACE_T *psSurf)
+{
+    uint32_t u32Bpp = blit_fmt_bpp(psSurf->u32Format);
+    uint32_t u32Align = is_yuv422(psSurf->u32Format) ? 4 : u32Bpp;
+
+    if (u32Bpp == 0)
+        return BLIT_ERR_FORMAT;
+    if ((psSurf->pvBuf == NULL) || (psSurf->u32Pitch < psSurf->u32Width * u32Bpp))
+        return BLIT_ERR_PARAM;
+    if ((((uintptr_t)psSurf->pvBuf | psSurf->u32Pitch) & (u32Align - 1)) != 0)
+        return BLIT_ERR_ALIGN;
+    return BLIT_OK;
+}
+
+/*
+ * Clip a rectangle at (*pi64X, *pi64Y) to [0, u32W) x [0, u32H), moving
+ * the other corner (*pi64OtherX, *pi64OtherY) along. Returns 0 when
+ * nothing is left.
+ */
+static int clip(int64_t *pi64X, int64_t *pi64Y, int64_t *pi64OtherX, int64_t *pi64OtherY,
+                int64_t *pi64W, int64_t *pi64H, uint32_t u32W, uint32_t u32H)
+{
+    if (*pi64X < 0)
+    {
+        *pi64W += *pi64X;
+        *pi64OtherX -= *pi64X;
+        *pi64X = 0;
+    }
+    if (*pi64Y < 0)
+    {
+        *pi64H += *pi64Y;
+        *pi64OtherY -= *pi64Y;
+        *pi64Y = 0;
+    }
+    if (*pi64W > (int64_t)u32W - *pi64X)
+        *pi64W = (int64_t)u32W - *pi64X;
+    if (*pi64H > (int64_t)u32H - *pi64Y)
+        *pi64H = (int64_t)u32H - *pi64Y;
+
+    return (*pi64W > 0) && (*pi64H > 0);
+}
+
+/* Memory a rectangle of a surface touches, out to whole cache lines */
+static RANGE_T surface_range(const BLIT_SURFACE_T *psSurf, uint32_t u32X, uint32_t u32Y,
+                             uint32_t u32W, uint32_t u32H)
+{
+    uint32_t u32Bpp = blit_fmt_bpp(psSurf->u32Format);
+    uintptr_t uBase = (uintptr_t)psSurf->pvBuf;
+    RANGE_T sRange;
+
+    sRange.uStart = uBase + (uintptr_t)u32Y * psSurf->u32Pitch + (uintptr_t)u32X * u32Bpp;
+    sRange.uEnd = uBase + (uintptr_t)(u32Y + u32H - 1) * psSurf->u32Pitch + (uintptr_t)(u32X + u32W) * u32Bpp;
+    sRange.uStart &= ~(uintptr_t)(CACHE_LINE - 1);
+    sRange.uEnd = (sRange.uEnd + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1);
+    return sRange;
+}
+
+static int ranges_overlap(RANGE_T sA, RANGE_T sB)
+{
+    return (sA.uStart < sB.uEnd) && (sB.uStart < sA.uEnd);
+}
+
+static RANGE_T cmd_dst_range(const BLIT_CMD_T *psCmd)
+{
+    return surface_range(&psCmd->sDst, psCmd->u32DstX, psCmd->u32DstY, psCmd->u32Width, psCmd->u32Height);
+}
+
+static RANGE_T cmd_src_range(const BLIT_CMD_T *psCmd)
+{
+    return surface_range(&psCmd->sSrc, psCmd->u32SrcX, psCmd->u32SrcY, psCmd->u32Width, psCmd->u32Height);
+}
+
+/* Whether psCmd has to wait for psBusy: one writes what the other touches */
+static int cmd_depends(const BLIT_CMD_T *psCmd, const BLIT_CMD_T *psBusy)
+{
+    RANGE_T sDst = cmd_dst_range(psCmd), sBusyDst = cmd_dst_range(psBusy);
+
+    if (ranges_overlap(sDst, sBusyDst))
+        return 1;
+    if ((psBusy->u32Op != BLIT_OP_FILL) && ranges_overlap(sDst, cmd_src_range(psBusy)))
+        return 1;
+    if ((psCmd->u32Op != BLIT_OP_FILL) && ranges_overlap(cmd_src_range(psCmd), sBusyDst))
+        return 1;
+    return 0;
+}
+
+/* Validate, clip and queue a command */
+static int list_add(BLIT_LIST_T *psList, uint32_t u32Op, const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+                    const BLIT_SURFACE_T *psSrc, int32_t i32SrcX, int32_t i32SrcY,
+                    uint32_t u32Width, uint32_t u32Height, uint32_t u32Color)
+{
+    int64_t x = i32X, y = i32Y, sx = i32SrcX, sy = i32SrcY, w = u32Width, h = u32Height;
+    BLIT_CMD_T *psCmd;
+    int ret;
+
+    if ((ret = check_surface(psDst)) != BLIT_OK)
+        return ret;
+    if (psSrc && ((ret = check_surface(psSrc)) != BLIT_OK))
+        return ret;
+
+    if (!clip(&x, &y, &sx, &sy, &w, &h, psDst->u32Width, psDst->u32Height))
+        return BLIT_OK;
+    if (psSrc && !clip(&sx, &sy, &x, &y, &w, &h, psSrc->u32Width, psSrc->u32Height))
+        return BLIT_OK;
+
+    if ((is_yuv422(psDst->u32Format) && ((x | w) & 1)) ||
+            (psSrc && is_yuv422(psSrc->u32Format) && ((sx | w) & 1)))
+        return BLIT_ERR_ALIGN;
+
+    if (psList->u32Count >= psList->u32Max)
+        return BLIT_ERR_FULL;
+
+    psCmd = &psList->pasCmd[psList->u32Count];
+    memset(psCmd, 0, sizeof(*psCmd));
+    psCmd->u32Op = u32Op;
+    psCmd->sDst = *psDst;
+    psCmd->u32DstX = (uint32_t)x;
+    psCmd->u32DstY = (uint32_t)y;
+    if (psSrc)
+    {
+        psCmd->sSrc = *psSrc;
+        psCmd->u32SrcX = (uint32_t)sx;
+        psCmd->u32SrcY = (uint32_t)sy;
+    }
+    psCmd->u32Width = (uint32_t)w;
+    psCmd->u32Height = (uint32_t)h;
+    psCmd->u32Color = u32Color;
+
+    /* Only a copy between like formats and pitches runs rows in an order that allows overlap */
+    if (psSrc && !((u32Op == BLIT_OP_COPY) && (psSrc->u32Format == psDst->u32Format) &&
+                   (psSrc->u32Pitch == psDst->u32Pitch)) &&
+            ranges_overlap(cmd_dst_range(psCmd), cmd_src_range(psCmd)))
+        return BLIT_ERR_PARAM;
+
+    psList->u32Count++;
+    return BLIT_OK;
+}
+
+/*---------------------------------------------------------------------------*/
+/* CPU engine                                                                */
+/*---------------------------------------------------------------------------*/
+
+static uint8_t *pixel_addr(const BLIT_SURFACE_T *psSurf, uint32_t u32X, uint32_t u32Y)
+{
+    return (uint8_t *)psSurf->pvBuf + (uintptr_t)u32Y * psSurf->u32Pitch + (uintptr_t)u32X * blit_fmt_bpp(psSurf->u32Format);
+}
+
+static void to_argb(uint32_t *pu32Dst, const uint8_t *pu8Src, uint32_t u32Format, uint32_t u32Count)
+{
+    if (u32Format == BLIT_FMT_RGB565)
+        blit_row_rgb565_to_argb8888(pu32Dst, (const uint16_t *)pu8Src, u32Count);
+    else if (is_yuv422(u32Format))
+        blit_row_yuv422_to_argb8888(pu32Dst, pu8Src, u32Count, u32Format);
+    else
+        memcpy(pu32Dst, pu8Src, u32Count * 4);
+}
+
+static void from_argb(uint8_t *pu8Dst, const uint32_t *pu32Src, uint32_t u32Format, uint32_t u32Count)
+{
+    if (u32Format == BLIT_FMT_RGB565)
+        blit_row_argb8888_to_rgb565((uint16_t *)pu8Dst, pu32Src, u32Count);
+    else if (is_yuv422(u32Format))
+        blit_row_argb8888_to_yuv422(pu8Dst, pu32Src, u32Count, u32Format);
+    else
+        memcpy(pu8Dst, pu32Src, u32Count * 4);
+}
+
+static void cpu_fill(const BLIT_CMD_T *psCmd)
+{
+    uint32_t u32Format = psCmd->sDst.u32Format;
+    uint32_t u32Value = blit_fmt_color(psCmd->u32Color, u32Format);
+    uint32_t y;
+
+    for (y = 0; y < psCmd->u32Height; y++)
+    {
+        uint8_t *pu8Dst = pixel_addr(&psCmd->sDst, psCmd->u32DstX, psCmd->u32DstY + y);
+
+        if (u32Format == BLIT_FMT_RGB565)
+            blit_row_fill16((uint16_t *)pu8Dst, (uint16_t)u32Value, psCmd->u32Width);
+        else if (u32Format == BLIT_FMT_ARGB8888)
+            blit_row_fill32((uint32_t *)pu8Dst, u32Value, psCmd->u32Width);
+        else
+            blit_row_fill32((uint32_t *)pu8Dst, u32Value, psCmd->u32Width / 2);
+    }
+}
+
+static void cpu_copy(const BLIT_CMD_T *psCmd)
+{
+    uint32_t u32SrcFmt = psCmd->sSrc.u32Format, u32DstFmt = psCmd->sDst.u32Format;
+    uint32_t u32SrcBpp = blit_fmt_bpp(u32SrcFmt), u32DstBpp = blit_fmt_bpp(u32DstFmt);
+    uint32_t au32Tmp[CHUNK];
+    uint32_t i, n, r, y;
+
+    for (r = 0; r < psCmd->u32Height; r++)
+    {
+        const uint8_t *pu8Src;
+        uint8_t *pu8Dst;
+
+        /* Bottom up when the destination is further on, rows may overlap */
+        y = (pixel_addr(&psCmd->sDst, psCmd->u32DstX, psCmd->u32DstY) >
+             pixel_addr(&psCmd->sSrc, psCmd->u32SrcX, psCmd->u32SrcY)) ? psCmd->u32Height - 1 - r : r;
+        pu8Src = pixel_addr(&psCmd->sSrc, psCmd->u32SrcX, psCmd->u32SrcY + y);
+        pu8Dst = pixel_addr(&psCmd->sDst, psCmd->u32DstX, psCmd->u32DstY + y);
+
+        if (u32SrcFmt == u32DstFmt)
+            memmove(pu8Dst, pu8Src, psCmd->u32Width * u32DstBpp);
+        else if (u32DstFmt == BLIT_FMT_ARGB8888)
+            to_argb((uint32_t *)pu8Dst, pu8Src, u32SrcFmt, psCmd->u32Width);
+        else if (u32SrcFmt == BLIT_FMT_ARGB8888)
+            from_argb(pu8Dst, (const uint32_t *)pu8Src, u32DstFmt, psCmd->u32Width);
+        else
+        {
+            for (i = 0; i < psCmd->u32Width; i += n)
+            {
+                n = (psCmd->u32Width - i < CHUNK) ? psCmd->u32Width - i : CHUNK;
+                to_argb(au32Tmp, pu8Src + i * u32SrcBpp, u32SrcFmt, n);
+                from_argb(pu8Dst + i * u32DstBpp, au32Tmp, u32DstFmt, n);
+            }
+        }
+    }
+}
+
+static void cpu_blend(const BLIT_CMD_T *psCmd)
+{
+    uint32_t u32SrcFmt = psCmd->sSrc.u32Format, u32DstFmt = psCmd->sDst.u32Format;
+    uint32_t u32SrcBpp = blit_fmt_bpp(u32SrcFmt), u32DstBpp = blit_fmt_bpp(u32DstFmt);
+    uint32_t au32Src[CHUNK], au32Dst[CHUNK];
+    uint32_t i, n, y;
+
+    for (y = 0; y < psCmd->u32Height; y++)
+    {
+        const uint8_t *pu8Src = pixel_addr(&psCmd->sSrc, psCmd->u32SrcX, psCmd->u32SrcY + y);
+        uint8_t *pu8Dst = pixel_addr(&psCmd->sDst, psCmd->u32DstX, psCmd->u32DstY + y);
+
+        for (i = 0; i < psCmd->u32Width; i += n)
+        {
+            const uint32_t *pu32Src = (const uint32_t *)(pu8Src + i * u32SrcBpp);
+            uint32_t *pu32Dst = (uint32_t *)(pu8Dst + i * u32DstBpp);
+
+            n = (psCmd->u32Width - i < CHUNK) ? psCmd->u32Width - i : CHUNK;
+
+            if (u32SrcFmt != BLIT_FMT_ARGB8888)
+            {
+                to_argb(au32Src, pu8Src + i * u32SrcBpp, u32SrcFmt, n);
+                pu32Src = au32Src;
+            }
+
+            if (u32DstFmt == BLIT_FMT_ARGB8888)
+            {
+                blit_row_blend_argb8888(pu32Dst, pu32Src, n, psCmd->u32Color);
+            }
+            else
+            {
+                to_argb(au32Dst, pu8Dst + i * u32DstBpp, u32DstFmt, n);
+                blit_row_blend_argb8888(au32Dst, pu32Src, n, psCmd->u32Color);
+                from_argb(pu8Dst + i * u32DstBpp, au32Dst, u32DstFmt, n);
+            }
+        }
+    }
+}
+
+static void cpu_run(const BLIT_CMD_T *psCmd)
+{
+    switch (psCmd->u32Op)
+    {
+    case BLIT_OP_FILL:
+        cpu_fill(psCmd);
+        break;
+    case BLIT_OP_COPY:
+        cpu_copy(psCmd);
+        break;
+    case BLIT_OP_BLEND:
+        cpu_blend(psCmd);
+        break;
+    default:
+        break;
+    }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Engines and submission                                                    */
+/*---------------------------------------------------------------------------*/
+
+int blit_engine_add(const BLIT_ENGINE_T *psEngine)
+{
+    if (s_u32Engines >= BLIT_ENGINE_MAX)
+        return BLIT_ERR_FULL;
+
+    s_asEngine[s_u32Engines++] = *psEngine;
+    return BLIT_OK;
+}
+
+void blit_engine_reset(void)
+{
+    s_u32Engines = 0;
+}
+
+/* Wait for the command engine k runs, redone on the CPU if the engine fails */
+static int engine_finish(const BLIT_CMD_T **ppsBusy, uint32_t k)
+{
+    int ret = BLIT_OK;
+
+    if (ppsBusy[k] == NULL)
+        return BLIT_OK;
+
+    if (s_asEngine[k].pfnWait(s_asEngine[k].pvCtx) != BLIT_OK)
+    {
+        cpu_run(ppsBusy[k]);
+        ret = BLIT_ERR_ENGINE;
+    }
+    ppsBusy[k] = NULL;
+    return ret;
+}
+
+void blit_list_init(BLIT_LIST_T *psList, BLIT_CMD_T *pasCmd, uint32_t u32Max)
+{
+    psList->pasCmd = pasCmd;
+    psList->u32Max = u32Max;
+    psList->u32Count = 0;
+}
+
+int blit_list_fill(BLIT_LIST_T *psList, const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+                   uint32_t u32Width, uint32_t u32Height, uint32_t u32Argb)
+{
+    return list_add(psList, BLIT_OP_FILL, psDst, i32X, i32Y, NULL, 0, 0, u32Width, u32Height, u32Argb);
+}
+
+int blit_list_copy(BLIT_LIST_T *psList, const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+                   const BLIT_SURFACE_T *psSrc, int32_t i32SrcX, int32_t i32SrcY,
+                   uint32_t u32Width, uint32_t u32Height)
+{
+    return list_add(psList, BLIT_OP_COPY, psDst, i32X, i32Y, psSrc, i32SrcX, i32SrcY, u32Width, u32Height, 0);
+}
+
+int blit_list_blend(BLIT_LIST_T *psList, const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+                    const BLIT_SURFACE_T *psSrc, int32_t i32SrcX, int32_t i32SrcY,
+                    uint32_t u32Width, uint32_t u32Height, uint32_t u32Alpha)
+{
+    if (u32Alpha > 255)
+        return BLIT_ERR_PARAM;
+
+    return list_add(psList, BLIT_OP_BLEND, psDst, i32X, i32Y, psSrc, i32SrcX, i32SrcY, u32Width, u32Height, u32Alpha);
+}
+
+int blit_list_submit(BLIT_LIST_T *psList)
+{
+    const BLIT_CMD_T *apsBusy[BLIT_ENGINE_MAX] = { NULL };
+    int ret = BLIT_OK;
+    uint32_t i, k;
+
+    for (i = 0; i < psList->u32Count; i++)
+    {
+        const BLIT_CMD_T *psCmd = &psList->pasCmd[i];
+        int32_t i32Engine = ENGINE_CPU;
+
+        for (k = 0; k < s_u32Engines; k++)
+        {
+            if (s_asEngine[k].pfnAccept(s_asEngine[k].pvCtx, psCmd))
+            {
+                i32Engine = (int32_t)k;
+                break;
+            }
+        }
+
+        /* Commands run in list order wherever they share memory */
+        for (k = 0; k < s_u32Engines; k++)
+        {
+            if (apsBusy[k] && (((int32_t)k == i32Engine) || cmd_depends(psCmd, apsBusy[k])))
+            {
+                if (engine_finish(apsBusy, k) != BLIT_OK)
+                    ret = BLIT_ERR_ENGINE;
+            }
+        }
+
+        if ((i32Engine != ENGINE_CPU) &&
+                (s_asEngine[i32Engine].pfnStart(s_asEngine[i32Engine].pvCtx, psCmd) == BLIT_OK))
+            apsBusy[i32Engine] = psCmd;
+        else
+            cpu_run(psCmd);
+    }
+
+    for (k = 0; k < s_u32Engines; k++)
+    {
+        if (engine_finish(apsBusy, k) != BLIT_OK)
+            ret = BLIT_ERR_ENGINE;
+    }
+
+    psList->u32Count = 0;
+    return ret;
+}
+
+/*---------------------------------------------------------------------------*/
+/* One command lists                                                         */
+/*---------------------------------------------------------------------------*/
+
+static int run_one(BLIT_LIST_T *psList, int ret)
+{
+    if (ret != BLIT_OK)
+        return ret;
+    return blit_list_submit(psList);
+}
+
+int blit_fill(const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+              uint32_t u32Width, uint32_t u32Height, uint32_t u32Argb)
+{
+    BLIT_CMD_T sCmd;
+    BLIT_LIST_T sList;
+
+    blit_list_init(&sList, &sCmd, 1);
+    return run_one(&sList, blit_list_fill(&sList, psDst, i32X, i32Y, u32Width, u32Height, u32Argb));
+}
+
+int blit_copy(const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+              const BLIT_SURFACE_T *psSrc, int32_t i32SrcX, int32_t i32SrcY,
+              uint32_t u32Width, uint32_t u32Height)
+{
+    BLIT_CMD_T sCmd;
+    BLIT_LIST_T sList;
+
+    blit_list_init(&sList, &sCmd, 1);
+    return run_one(&sList, blit_list_copy(&sList, psDst, i32X, i32Y, psSrc, i32SrcX, i32SrcY, u32Width, u32Height));
+}
+
+int blit_blend(const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+               const BLIT_SURFACE_T *psSrc, int32_t i32SrcX, int32_t i32SrcY,
+               uint32_t u32Width, uint32_t u32Height, uint32_t u32Alpha)
+{
+    BLIT_CMD_T sCmd;
+    BLIT_LIST_T sList;
+
+    blit_list_init(&sList, &sCmd, 1);
+    return run_one(&sList, blit_list_blend(&sList, psDst, i32X, i32Y, psSrc, i32SrcX, i32SrcY, u32Width, u32Height, u32Alpha));
+}
@@ -0,0 +1,220 @@
+/**************************************************************************//**
+ * @file     blit.h
+ *
+ * @brief    2D pixel operations on memory surfaces: rectangle fill, copy
+ *           with format conversion and alpha blend, run in batches on the
+ *           engine that takes each one, PDMA or the CPU.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __BLIT_H__
+#define __BLIT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * Every CPU row kernel has a C version and, where the compiler targets
+ * NEON, a NEON version that produces the same pixels; BLIT_NO_NEON keeps
+ * the C versions only.
+ */
+#if defined(__ARM_NEON) && !defined(BLIT_NO_NEON) && !defined(BLIT_NEON)
+#define BLIT_NEON
+#endif
+
+#define BLIT_OK             0
+#define BLIT_ERR_PARAM      -1      /* bad surface or overlapping operands */
+#define BLIT_ERR_FORMAT     -2      /* unknown pixel format */
+#define BLIT_ERR_ALIGN      -3      /* buffer, pitch or 4:2:2 rectangle not aligned */
+#define BLIT_ERR_FULL       -4      /* command list full */
+#define BLIT_ERR_ENGINE     -5      /* engine failure, the command was run on the CPU instead */
+
+/*---------------------------------------------------------------------------*/
+/* Surfaces                                                                  */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * Pixel formats, as the display controller and the capture engine lay
+ * them out in little endian memory. The 4:2:2 formats share U and V
+ * between the two pixels of an even x and the next, so rectangles on
+ * them start at an even x and are an even number of pixels wide.
+ * Conversions use BT.601 limited range, the CCAP sensor output.
+ */
+#define BLIT_FMT_RGB565     0       /* 16 bits, R in 15:11, G in 10:5, B in 4:0 */
+#define BLIT_FMT_ARGB8888   1       /* 32 bits, A in 31:24, R in 23:16, G in 15:8, B in 7:0 */
+#define BLIT_FMT_YUY2       2       /* 4:2:2, bytes Y0 U Y1 V */
+#define BLIT_FMT_UYVY       3       /* 4:2:2, bytes U Y0 V Y1 */
+#define BLIT_FMT_NUM        4
+
+/*
+ * A buffer of u32Height rows of u32Pitch bytes. The buffer and the pitch
+ * are aligned to the pixel size, to 4 bytes for the 4:2:2 formats.
+ */
+typedef struct
+{
+    void *pvBuf;                    /* pixel (0, 0) */
+    uint32_t u32Width;
+    uint32_t u32Height;
+    uint32_t u32Pitch;              /* bytes from a row to the next */
+    uint32_t u32Format;             /* BLIT_FMT_* */
+} BLIT_SURFACE_T;
+
+/* Bytes per pixel, 0 for an unknown format */
+uint32_t blit_fmt_bpp(uint32_t u32Format);
+
+/*
+ * The ARGB8888 colour u32Argb in u32Format: a pixel in the low 16 or 32
+ * bits, for 4:2:2 the 32 bits of a pair of that colour
+ */
+uint32_t blit_fmt_color(uint32_t u32Argb, uint32_t u32Format);
+
+/*---------------------------------------------------------------------------*/
+/* Command lists                                                             */
+/*---------------------------------------------------------------------------*/
+
+#define BLIT_OP_FILL        0
+#define BLIT_OP_COPY        1
+#define BLIT_OP_BLEND       2
+
+/*
+ * One operation, clipped to its surfaces when it is added to a list.
+ * Engines read these; only the library writes them.
+ */
+typedef struct
+{
+    uint32_t u32Op;                 /* BLIT_OP_* */
+    BLIT_SURFACE_T sDst;
+    BLIT_SURFACE_T sSrc;            /* not used by fills */
+    uint32_t u32DstX, u32DstY;
+    uint32_t u32SrcX, u32SrcY;
+    uint32_t u32Width, u32Height;   /* never 0 */
+    uint32_t u32Color;              /* fill: ARGB8888; blend: global alpha, 0 to 255 */
+} BLIT_CMD_T;
+
+/*
+ * Commands are queued, then run in order by blit_list_submit(). A
+ * command on an engine that works in the background overlaps the
+ * commands after it, up to the first one that touches the same memory.
+ */
+typedef struct
+{
+    BLIT_CMD_T *pasCmd;
+    uint32_t u32Max;
+    uint32_t u32Count;
+} BLIT_LIST_T;
+
+void blit_list_init(BLIT_LIST_T *psList, BLIT_CMD_T *pasCmd, uint32_t u32Max);
+
+/* Fill a rectangle of psDst with the ARGB8888 colour u32Argb, converted to the format of psDst */
+int blit_list_fill(BLIT_LIST_T *psList, const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+                   uint32_t u32Width, uint32_t u32Height, uint32_t u32Argb);
+
+/*
+ * Copy a rectangle of psSrc at (i32SrcX, i32SrcY) to psDst at (i32X, i32Y),
+ * converting the pixel format. Source and destination may overlap when
+ * their formats and pitches are the same, never otherwise.
+ */
+int blit_list_copy(BLIT_LIST_T *psList, const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+                   const BLIT_SURFACE_T *psSrc, int32_t i32SrcX, int32_t i32SrcY,
+                   uint32_t u32Width, uint32_t u32Height);
+
+/*
+ * Draw a rectangle of psSrc over psDst: with a = source alpha * u32Alpha / 255,
+ * dst = (src * a + dst * (255 - a)) / 255 per colour and, on ARGB8888,
+ * dst alpha = a + dst alpha * (255 - a) / 255, every division rounded.
+ * Sources other than ARGB8888 are opaque. A destination in another format
+ * is blended as its ARGB8888 conversion and converted back. Source and
+ * destination do not overlap.
+ */
+int blit_list_blend(BLIT_LIST_T *psList, const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+                    const BLIT_SURFACE_T *psSrc, int32_t i32SrcX, int32_t i32SrcY,
+                    uint32_t u32Width, uint32_t u32Height, uint32_t u32Alpha);
+
+/*
+ * Run the commands of the list and empty it. Returns BLIT_OK, or
+ * BLIT_ERR_ENGINE when an engine failed a command; its pixels are right
+ * either way.
+ */
+int blit_list_submit(BLIT_LIST_T *psList);
+
+/* One command lists, run before returning */
+int blit_fill(const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+              uint32_t u32Width, uint32_t u32Height, uint32_t u32Argb);
+int blit_copy(const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+              const BLIT_SURFACE_T *psSrc, int32_t i32SrcX, int32_t i32SrcY,
+              uint32_t u32Width, uint32_t u32Height);
+int blit_blend(const BLIT_SURFACE_T *psDst, int32_t i32X, int32_t i32Y,
+               const BLIT_SURFACE_T *psSrc, int32_t i32SrcX, int32_t i32SrcY,
+               uint32_t u32Width, uint32_t u32Height, uint32_t u32Alpha);
+
+/*---------------------------------------------------------------------------*/
+/* Engines                                                                   */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * A hardware engine. blit_list_submit() offers every command to the
+ * engines in the order they were added and runs it on the first that
+ * accepts it, else on the CPU. An engine runs one command at a time:
+ * pfnStart() starts it, pfnWait() returns when it is done, BLIT_OK or
+ * an error after which the CPU runs the command again. Engines keep the
+ * data cache coherent with what they read and write.
+ */
+typedef struct
+{
+    const char *pcName;
+    void *pvCtx;                    /* first argument of the callbacks */
+    int (*pfnAccept)(void *pvCtx, const BLIT_CMD_T *psCmd);    /* nonzero to take the command */
+    int (*pfnStart)(void *pvCtx, const BLIT_CMD_T *psCmd);
+    int (*pfnWait)(void *pvCtx);
+} BLIT_ENGINE_T;
+
+#define BLIT_ENGINE_MAX     4
+
+/* Returns BLIT_OK, or BLIT_ERR_FULL past BLIT_ENGINE_MAX engines */
+int blit_engine_add(const BLIT_ENGINE_T *psEngine);
+
+/* Back to the CPU alone */
+void blit_engine_reset(void);
+
+/*---------------------------------------------------------------------------*/
+/* Row kernels                                                               */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * The CPU engine, one row of u32Count pixels at a time, exposed for code
+ * with its own loops. Buffers are aligned to their pixel size and do
+ * not overlap.
+ */
+void blit_row_fill16(uint16_t *pu16Dst, uint16_t u16Value, uint32_t u32Count);
+void blit_row_fill32(uint32_t *pu32Dst, uint32_t u32Value, uint32_t u32Count);
+
+/* R, G and B widened by repeating their high bits, opaque */
+void blit_row_rgb565_to_argb8888(uint32_t *pu32Dst, const uint16_t *pu16Src, uint32_t u32Count);
+
+/* R, G and B truncated, alpha dropped */
+void blit_row_argb8888_to_rgb565(uint16_t *pu16Dst, const uint32_t *pu32Src, uint32_t u32Count);
+
+/*
+ * u32Count is even. Y, U and V of every pixel are rounded; U and V of a
+ * pair are the rounded mean of those of its two pixels.
+ */
+void blit_row_argb8888_to_yuv422(uint8_t *pu8Dst, const uint32_t *pu32Src, uint32_t u32Count,
+                                 uint32_t u32Format);
+
+/* u32Count is even. R, G and B are rounded and saturated, opaque */
+void blit_row_yuv422_to_argb8888(uint32_t *pu32Dst, const uint8_t *pu8Src, uint32_t u32Count,
+                                 uint32_t u32Format);
+
+/* pu32Dst = pu32Src over pu32Dst, as blit_list_blend() */
+void blit_row_blend_argb8888(uint32_t *pu32Dst, const uint32_t *pu32Src, uint32_t u32Count,
+                             uint32_t u32Alpha);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLIT_H__ */
@@ -0,0 +1,198 @@
+/**************************************************************************//**
+ * @file     blit_pdma.c
+ *
+ * @brief    PDMA engine of the blit library: fills and same format copies
+ *           as stride transfers.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+
+#include "blit_pdma.h"
+
+#define STRIDE_CH_MAX   (sizeof(((PDMA_T *)0)->STRIDE) / sizeof(STRIDE_T))
+#define TXCNT_MAX       ((PDMA_DSCT_CTL_TXCNT_Msk >> PDMA_DSCT_CTL_TXCNT_Pos) + 1)
+#define STRIDE_GAP_MAX  0xFFFF
+
+static uint8_t *pixel_addr(const BLIT_SURFACE_T *psSurf, uint32_t u32X, uint32_t u32Y)
+{
+    return (uint8_t *)psSurf->pvBuf + (uintptr_t)u32Y * psSurf->u32Pitch + (uintptr_t)u32X * blit_fmt_bpp(psSurf->u32Format);
+}
+
+/* Bytes from the first pixel of a rectangle to past its last */
+static uint32_t rect_span(const BLIT_SURFACE_T *psSurf, const BLIT_CMD_T *psCmd)
+{
+    return (psCmd->u32Height - 1) * psSurf->u32Pitch + psCmd->u32Width * blit_fmt_bpp(psSurf->u32Format);
+}
+
+/* The widest transfer every row start and length is aligned to, 0 for none */
+static uint32_t transfer_unit(const BLIT_CMD_T *psCmd)
+{
+    uint32_t u32Bits = ptr_to_u32(pixel_addr(&psCmd->sDst, psCmd->u32DstX, psCmd->u32DstY)) |
+                       psCmd->sDst.u32Pitch | (psCmd->u32Width * blit_fmt_bpp(psCmd->sDst.u32Format));
+
+    if (psCmd->u32Op == BLIT_OP_COPY)
+        u32Bits |= ptr_to_u32(pixel_addr(&psCmd->sSrc, psCmd->u32SrcX, psCmd->u32SrcY)) | psCmd->sSrc.u32Pitch;
+
+    if ((u32Bits & 3) == 0)
+        return 4;
+    if ((u32Bits & 1) == 0)
+        return 2;
+    return 0;
+}
+
+static int pdma_accept(void *pvCtx, const BLIT_CMD_T *psCmd)
+{
+    BLIT_PDMA_T *psPdma = (BLIT_PDMA_T *)pvCtx;
+    uint32_t u32Bpp = blit_fmt_bpp(psCmd->sDst.u32Format);
+    uint32_t u32RowBytes = psCmd->u32Width * u32Bpp;
+    uint32_t u32Unit = transfer_unit(psCmd);
+
+    if (psCmd->u32Op == BLIT_OP_COPY)
+    {
+        uint8_t *pu8Src = pixel_addr(&psCmd->sSrc, psCmd->u32SrcX, psCmd->u32SrcY);
+        uint8_t *pu8Dst = pixel_addr(&psCmd->sDst, psCmd->u32DstX, psCmd->u32DstY);
+
+        /* No conversion, and no overlap: the channel only runs forward */
+        if (psCmd->sSrc.u32Format != psCmd->sDst.u32Format)
+            return 0;
+        if ((pu8Src < pu8Dst + rect_span(&psCmd->sDst, psCmd)) && (pu8Dst < pu8Src + rect_span(&psCmd->sSrc, psCmd)))
+            return 0;
+        if ((psCmd->sSrc.u32Pitch - u32RowBytes) / u32Unit > STRIDE_GAP_MAX)
+            return 0;
+    }
+    else if (psCmd->u32Op != BLIT_OP_FILL)
+    {
+        return 0;
+    }
+
+    if ((u32Unit == 0) || (u32RowBytes / u32Unit > TXCNT_MAX) ||
+            ((psCmd->sDst.u32Pitch - u32RowBytes) / u32Unit > STRIDE_GAP_MAX))
+        return 0;
+
+    return (u32RowBytes * psCmd->u32Height >= psPdma->u32MinBytes);
+}
+
+/* Start a pass of as many whole rows as one transfer count holds */
+static void pdma_pass(BLIT_PDMA_T *psPdma)
+{
+    PDMA_T *pdma = psPdma->pdma;
+    uint32_t u32Ch = psPdma->u32Ch;
+    int bFill = (psPdma->psCmd->u32Op == BLIT_OP_FILL);
+
+    psPdma->u32Rows = TXCNT_MAX / psPdma->u32RowUnits;
+    if (psPdma->u32Rows > psPdma->u32RowsLeft)
+        psPdma->u32Rows = psPdma->u32RowsLeft;
+
+    PDMA_SetTransferCnt(pdma, u32Ch, psPdma->u32TxWidth, psPdma->u32Rows * psPdma->u32RowUnits);
+    PDMA_SetTransferAddr(pdma, u32Ch,
+                         bFill ? ptr_to_u32(&psPdma->u32Pattern) : psPdma->u32Src, bFill ? PDMA_SAR_FIX : PDMA_SAR_INC,
+                         psPdma->u32Dst, PDMA_DAR_INC);
+    /* The driver takes the gaps plus one */
+    PDMA_SetStride(pdma, u32Ch, psPdma->u32DstGap + 1, psPdma->u32SrcGap + 1, psPdma->u32RowUnits);
+    PDMA_SetTransferMode(pdma, u32Ch, PDMA_MEM, FALSE, 0);
+    /* Memory to memory bursts need an incrementing source */
+    PDMA_SetBurstType(pdma, u32Ch, bFill ? PDMA_REQ_SINGLE : PDMA_REQ_BURST, PDMA_BURST_32);
+
+    PDMA_CLR_TD_FLAG(pdma, 1 << u32Ch);
+    PDMA_Trigger(pdma, u32Ch);
+}
+
+static int pdma_start(void *pvCtx, const BLIT_CMD_T *psCmd)
+{
+    BLIT_PDMA_T *psPdma = (BLIT_PDMA_T *)pvCtx;
+    uint8_t *pu8Dst = pixel_addr(&psCmd->sDst, psCmd->u32DstX, psCmd->u32DstY);
+    uint32_t u32RowBytes = psCmd->u32Width * blit_fmt_bpp(psCmd->sDst.u32Format);
+
+    psPdma->psCmd = psCmd;
+    psPdma->u32Unit = transfer_unit(psCmd);
+    psPdma->u32TxWidth = (psPdma->u32Unit == 4) ? PDMA_WIDTH_32 : PDMA_WIDTH_16;
+    psPdma->u32RowUnits = u32RowBytes / psPdma->u32Unit;
+    psPdma->u32DstGap = (psCmd->sDst.u32Pitch - u32RowBytes) / psPdma->u32Unit;
+    psPdma->u32RowsLeft = psCmd->u32Height;
+    psPdma->u32Dst = ptr_to_u32(pu8Dst);
+
+    if (psCmd->u32Op == BLIT_OP_FILL)
+    {
+        psPdma->u32Pattern = blit_fmt_color(psCmd->u32Color, psCmd->sDst.u32Format);
+        if ((psCmd->sDst.u32Format == BLIT_FMT_RGB565) && (psPdma->u32Unit == 4))
+            psPdma->u32Pattern |= psPdma->u32Pattern << 16;
+        psPdma->u32SrcGap = 0;
+        dcache_clean_by_mva(&psPdma->u32Pattern, sizeof(psPdma->u32Pattern));
+    }
+    else
+    {
+        uint8_t *pu8Src = pixel_addr(&psCmd->sSrc, psCmd->u32SrcX, psCmd->u32SrcY);
+
+        psPdma->u32Src = ptr_to_u32(pu8Src);
+        psPdma->u32SrcGap = (psCmd->sSrc.u32Pitch - u32RowBytes) / psPdma->u32Unit;
+        dcache_clean_by_mva(pu8Src, rect_span(&psCmd->sSrc, psCmd));
+    }
+
+    /* Nothing of the CPU may be written back over the transfer */
+    dcache_clean_invalidate_by_mva(pu8Dst, rect_span(&psCmd->sDst, psCmd));
+
+    pdma_pass(psPdma);
+    return BLIT_OK;
+}
+
+static int pdma_wait(void *pvCtx)
+{
+    BLIT_PDMA_T *psPdma = (BLIT_PDMA_T *)pvCtx;
+    const BLIT_CMD_T *psCmd = psPdma->psCmd;
+    uint32_t u32Mask = 1 << psPdma->u32Ch;
+    int ret = BLIT_OK;
+
+    while (1)
+    {
+        while ((PDMA_GET_TD_STS(psPdma->pdma) & u32Mask) == 0)
+        {
+            if (PDMA_GET_ABORT_STS(psPdma->pdma) & u32Mask)
+            {
+                PDMA_CLR_ABORT_FLAG(psPdma->pdma, u32Mask);
+                ret = BLIT_ERR_ENGINE;
+                goto exit_pdma_wait;
+            }
+        }
+        PDMA_CLR_TD_FLAG(psPdma->pdma, u32Mask);
+
+        psPdma->u32RowsLeft -= psPdma->u32Rows;
+        if (psPdma->u32RowsLeft == 0)
+            break;
+
+        psPdma->u32Dst += psPdma->u32Rows * psCmd->sDst.u32Pitch;
+        if (psCmd->u32Op == BLIT_OP_COPY)
+            psPdma->u32Src += psPdma->u32Rows * psCmd->sSrc.u32Pitch;
+        pdma_pass(psPdma);
+    }
+
+exit_pdma_wait:
+
+    /* Lines the CPU may have fetched meanwhile */
+    dcache_invalidate_by_mva(pixel_addr(&psCmd->sDst, psCmd->u32DstX, psCmd->u32DstY), rect_span(&psCmd->sDst, psCmd));
+    psPdma->psCmd = NULL;
+
+    return ret;
+}
+
+int blit_pdma_init(BLIT_PDMA_T *psPdma, BLIT_ENGINE_T *psEngine, PDMA_T *pdma, uint32_t u32Ch)
+{
+    if (u32Ch >= STRIDE_CH_MAX)
+        return BLIT_ERR_PARAM;
+
+    memset(psPdma, 0, sizeof(*psPdma));
+    psPdma->pdma = pdma;
+    psPdma->u32Ch = u32Ch;
+    psPdma->u32MinBytes = BLIT_PDMA_MIN_BYTES;
+
+    PDMA_Open(pdma, 1 << u32Ch);
+
+    psEngine->pcName = "PDMA";
+    psEngine->pvCtx = psPdma;
+    psEngine->pfnAccept = pdma_accept;
+    psEngine->pfnStart = pdma_start;
+    psEngine->pfnWait = pdma_wait;
+
+    return BLIT_OK;
+}
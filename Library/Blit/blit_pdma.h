@@ -0,0 +1,55 @@
+/**************************************************************************//**
+ * @file     blit_pdma.h
+ *
+ * @brief    PDMA engine of the blit library: fills and same format copies
+ *           as stride transfers.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __BLIT_PDMA_H__
+#define __BLIT_PDMA_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "NuMicro.h"
+#include "blit.h"
+
+#define BLIT_PDMA_MIN_BYTES     8192    /* default size below which the CPU is faster */
+
+/* The state of one channel, owned by the engine once added */
+typedef struct
+{
+    PDMA_T *pdma;
+    uint32_t u32Ch;
+    uint32_t u32MinBytes;           /* smaller commands are left to the CPU */
+    uint32_t u32Pattern;            /* fill source */
+
+    /* The command in flight, in passes of whole rows */
+    const BLIT_CMD_T *psCmd;
+    uint32_t u32TxWidth;            /* PDMA_WIDTH_* */
+    uint32_t u32Unit;               /* bytes per transfer */
+    uint32_t u32RowUnits;
+    uint32_t u32SrcGap;             /* transfers skipped from a row to the next */
+    uint32_t u32DstGap;
+    uint32_t u32RowsLeft;
+    uint32_t u32Rows;               /* rows of the pass running */
+    uint32_t u32Src;
+    uint32_t u32Dst;
+} BLIT_PDMA_T;
+
+/*
+ * Open channel u32Ch of pdma, one of the first six that have stride
+ * mode, and fill psEngine for blit_engine_add(). The PDMA clock is
+ * enabled by the caller, the channel is not shared while the engine is
+ * in use. Returns BLIT_OK or BLIT_ERR_PARAM.
+ */
+int blit_pdma_init(BLIT_PDMA_T *psPdma, BLIT_ENGINE_T *psEngine, PDMA_T *pdma, uint32_t u32Ch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BLIT_PDMA_H__ */
@@ -0,0 +1,328 @@
+/**************************************************************************//**
+ * @file     blit_row.c
+ *
+ * @brief    Row kernels of the CPU engine: fill, pixel format conversion
+ *           and alpha blend.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stddef.h>
+
+#include "blit.h"
+
+#if defined(BLIT_NEON)
+#include <arm_neon.h>
+#endif
+
+/* x / 255 rounded to nearest, for x up to 255 * 255 */
+static uint32_t div255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static uint32_t clamp8(int32_t x)
+{
+    return (x < 0) ? 0 : (x > 255) ? 255 : (uint32_t)x;
+}
+
+/*
+ * BT.601 limited range in Q8. U and V are returned without their 128
+ * offset, the mean of a pair is taken on those.
+ */
+static void rgb_to_yuv(uint32_t u32Argb, int32_t *pi32Y, int32_t *pi32U, int32_t *pi32V)
+{
+    int32_t r = (u32Argb >> 16) & 0xFF, g = (u32Argb >> 8) & 0xFF, b = u32Argb & 0xFF;
+
+    *pi32Y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+    *pi32U = (-38 * r - 74 * g + 112 * b + 128) >> 8;
+    *pi32V = (112 * r - 94 * g - 18 * b + 128) >> 8;
+}
+
+/* i32D and i32E are U and V less 128 */
+static uint32_t yuv_to_rgb(int32_t i32Y, int32_t i32D, int32_t i32E)
+{
+    int32_t c = 298 * (i32Y - 16) + 128;
+
+    return 0xFF000000 |
+           clamp8((c + 409 * i32E) >> 8) << 16 |
+           clamp8((c - 100 * i32D - 208 * i32E) >> 8) << 8 |
+           clamp8((c + 516 * i32D) >> 8);
+}
+
+#if defined(BLIT_NEON)
+/* div255() of eight lanes, narrowed */
+static uint8x8_t div255_8(uint16x8_t x)
+{
+    x = vaddq_u16(x, vdupq_n_u16(128));
+    return vaddhn_u16(x, vshrq_n_u16(x, 8));
+}
+
+/* U or V of eight pixels, without the offset: (cr * r + cg * g + cb * b + 128) >> 8 */
+static int16x8_t chroma8(uint8x8_t r, uint8x8_t g, uint8x8_t b, int16_t cr, int16_t cg, int16_t cb)
+{
+    int16x8_t x = vmulq_n_s16(vreinterpretq_s16_u16(vmovl_u8(r)), cr);
+
+    x = vmlaq_n_s16(x, vreinterpretq_s16_u16(vmovl_u8(g)), cg);
+    x = vmlaq_n_s16(x, vreinterpretq_s16_u16(vmovl_u8(b)), cb);
+    return vrshrq_n_s16(x, 8);
+}
+
+/* Mean of the pairs of 16 chroma values, with the offset, as bytes */
+static uint8x8_t chroma_pair(int16x8_t lo, int16x8_t hi)
+{
+    int16x8x2_t v = vuzpq_s16(lo, hi);
+
+    return vmovn_u16(vreinterpretq_u16_s16(vaddq_s16(vrhaddq_s16(v.val[0], v.val[1]), vdupq_n_s16(128))));
+}
+
+/* One colour of eight pixels from c = 298 * (Y - 16) + 128, as yuv_to_rgb() */
+static uint8x8_t yuv_channel(int32x4_t clo, int32x4_t chi, int16x8_t d, int16_t cd, int16x8_t e, int16_t ce)
+{
+    clo = vmlaq_n_s32(clo, vmovl_s16(vget_low_s16(d)), cd);
+    clo = vmlaq_n_s32(clo, vmovl_s16(vget_low_s16(e)), ce);
+    chi = vmlaq_n_s32(chi, vmovl_s16(vget_high_s16(d)), cd);
+    chi = vmlaq_n_s32(chi, vmovl_s16(vget_high_s16(e)), ce);
+
+    return vqmovn_u16(vcombine_u16(vqmovun_s32(vshrq_n_s32(clo, 8)), vqmovun_s32(vshrq_n_s32(chi, 8))));
+}
+
+/* R, G and B, in that order, of eight pixels with their own d and e */
+static uint8x8x3_t yuv_to_rgb8(uint8x8_t y, int16x8_t d, int16x8_t e)
+{
+    int16x8_t c = vreinterpretq_s16_u16(vsubl_u8(y, vdup_n_u8(16)));
+    int32x4_t clo = vmlaq_n_s32(vdupq_n_s32(128), vmovl_s16(vget_low_s16(c)), 298);
+    int32x4_t chi = vmlaq_n_s32(vdupq_n_s32(128), vmovl_s16(vget_high_s16(c)), 298);
+    uint8x8x3_t v;
+
+    v.val[0] = yuv_channel(clo, chi, d, 0, e, 409);
+    v.val[1] = yuv_channel(clo, chi, d, -100, e, -208);
+    v.val[2] = yuv_channel(clo, chi, d, 516, e, 0);
+    return v;
+}
+#endif
+
+void blit_row_fill16(uint16_t *pu16Dst, uint16_t u16Value, uint32_t u32Count)
+{
+    uint32_t i = 0;
+
+#if defined(BLIT_NEON)
+    uint16x8_t v = vdupq_n_u16(u16Value);
+
+    for (; i + 8 <= u32Count; i += 8)
+        vst1q_u16(pu16Dst + i, v);
+#endif
+
+    for (; i < u32Count; i++)
+        pu16Dst[i] = u16Value;
+}
+
+void blit_row_fill32(uint32_t *pu32Dst, uint32_t u32Value, uint32_t u32Count)
+{
+    uint32_t i = 0;
+
+#if defined(BLIT_NEON)
+    uint32x4_t v = vdupq_n_u32(u32Value);
+
+    for (; i + 4 <= u32Count; i += 4)
+        vst1q_u32(pu32Dst + i, v);
+#endif
+
+    for (; i < u32Count; i++)
+        pu32Dst[i] = u32Value;
+}
+
+void blit_row_rgb565_to_argb8888(uint32_t *pu32Dst, const uint16_t *pu16Src, uint32_t u32Count)
+{
+    uint32_t i = 0;
+
+#if defined(BLIT_NEON)
+    for (; i + 8 <= u32Count; i += 8)
+    {
+        uint16x8_t p = vld1q_u16(pu16Src + i);
+        uint16x8_t r = vshrq_n_u16(p, 11);
+        uint16x8_t g = vandq_u16(vshrq_n_u16(p, 5), vdupq_n_u16(0x3F));
+        uint16x8_t b = vandq_u16(p, vdupq_n_u16(0x1F));
+        uint8x8x4_t v;
+
+        /* Bytes B, G, R, A in memory */
+        v.val[0] = vmovn_u16(vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2)));
+        v.val[1] = vmovn_u16(vorrq_u16(vshlq_n_u16(g, 2), vshrq_n_u16(g, 4)));
+        v.val[2] = vmovn_u16(vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2)));
+        v.val[3] = vdup_n_u8(0xFF);
+        vst4_u8((uint8_t *)(pu32Dst + i), v);
+    }
+#endif
+
+    for (; i < u32Count; i++)
+    {
+        uint32_t p = pu16Src[i];
+        uint32_t r = p >> 11, g = (p >> 5) & 0x3F, b = p & 0x1F;
+
+        pu32Dst[i] = 0xFF000000 | ((r << 3) | (r >> 2)) << 16 | ((g << 2) | (g >> 4)) << 8 | ((b << 3) | (b >> 2));
+    }
+}
+
+void blit_row_argb8888_to_rgb565(uint16_t *pu16Dst, const uint32_t *pu32Src, uint32_t u32Count)
+{
+    uint32_t i = 0;
+
+#if defined(BLIT_NEON)
+    for (; i + 8 <= u32Count; i += 8)
+    {
+        uint8x8x4_t v = vld4_u8((const uint8_t *)(pu32Src + i));
+        uint16x8_t r = vshlq_n_u16(vmovl_u8(vshr_n_u8(v.val[2], 3)), 11);
+        uint16x8_t g = vshlq_n_u16(vmovl_u8(vshr_n_u8(v.val[1], 2)), 5);
+        uint16x8_t b = vmovl_u8(vshr_n_u8(v.val[0], 3));
+
+        vst1q_u16(pu16Dst + i, vorrq_u16(vorrq_u16(r, g), b));
+    }
+#endif
+
+    for (; i < u32Count; i++)
+    {
+        uint32_t p = pu32Src[i];
+
+        pu16Dst[i] = (uint16_t)(((p >> 8) & 0xF800) | ((p >> 5) & 0x07E0) | ((p >> 3) & 0x001F));
+    }
+}
+
+void blit_row_argb8888_to_yuv422(uint8_t *pu8Dst, const uint32_t *pu32Src, uint32_t u32Count,
+                                 uint32_t u32Format)
+{
+    /* Byte of Y0, U, Y1 and V in a pair */
+    uint32_t y0 = (u32Format == BLIT_FMT_UYVY) ? 1 : 0;
+    uint32_t i = 0;
+
+#if defined(BLIT_NEON)
+    for (; i + 16 <= u32Count; i += 16)
+    {
+        uint8x16x4_t p = vld4q_u8((const uint8_t *)(pu32Src + i));
+        uint16x8_t ylo, yhi;
+        uint8x16x2_t y;
+        uint8x8x4_t v;
+        uint8x8_t u8U, u8V;
+
+        ylo = vmull_u8(vget_low_u8(p.val[2]), vdup_n_u8(66));
+        ylo = vmlal_u8(ylo, vget_low_u8(p.val[1]), vdup_n_u8(129));
+        ylo = vmlal_u8(ylo, vget_low_u8(p.val[0]), vdup_n_u8(25));
+        yhi = vmull_u8(vget_high_u8(p.val[2]), vdup_n_u8(66));
+        yhi = vmlal_u8(yhi, vget_high_u8(p.val[1]), vdup_n_u8(129));
+        yhi = vmlal_u8(yhi, vget_high_u8(p.val[0]), vdup_n_u8(25));
+        y.val[0] = vaddq_u8(vcombine_u8(vrshrn_n_u16(ylo, 8), vrshrn_n_u16(yhi, 8)), vdupq_n_u8(16));
+        y = vuzpq_u8(y.val[0], y.val[0]);
+
+        u8U = chroma_pair(chroma8(vget_low_u8(p.val[2]), vget_low_u8(p.val[1]), vget_low_u8(p.val[0]), -38, -74, 112),
+                          chroma8(vget_high_u8(p.val[2]), vget_high_u8(p.val[1]), vget_high_u8(p.val[0]), -38, -74, 112));
+        u8V = chroma_pair(chroma8(vget_low_u8(p.val[2]), vget_low_u8(p.val[1]), vget_low_u8(p.val[0]), 112, -94, -18),
+                          chroma8(vget_high_u8(p.val[2]), vget_high_u8(p.val[1]), vget_high_u8(p.val[0]), 112, -94, -18));
+
+        if (y0)
+        {
+            v.val[0] = u8U;
+            v.val[1] = vget_low_u8(y.val[0]);
+            v.val[2] = u8V;
+            v.val[3] = vget_low_u8(y.val[1]);
+        }
+        else
+        {
+            v.val[0] = vget_low_u8(y.val[0]);
+            v.val[1] = u8U;
+            v.val[2] = vget_low_u8(y.val[1]);
+            v.val[3] = u8V;
+        }
+        vst4_u8(pu8Dst + 2 * i, v);
+    }
+#endif
+
+    for (; i + 2 <= u32Count; i += 2)
+    {
+        int32_t ya, ua, va, yb, ub, vb;
+        uint8_t *p = pu8Dst + 2 * i;
+
+        rgb_to_yuv(pu32Src[i], &ya, &ua, &va);
+        rgb_to_yuv(pu32Src[i + 1], &yb, &ub, &vb);
+
+        p[y0] = (uint8_t)ya;
+        p[y0 ^ 1] = (uint8_t)(((ua + ub + 1) >> 1) + 128);
+        p[y0 + 2] = (uint8_t)yb;
+        p[(y0 ^ 1) + 2] = (uint8_t)(((va + vb + 1) >> 1) + 128);
+    }
+}
+
+void blit_row_yuv422_to_argb8888(uint32_t *pu32Dst, const uint8_t *pu8Src, uint32_t u32Count,
+                                 uint32_t u32Format)
+{
+    uint32_t y0 = (u32Format == BLIT_FMT_UYVY) ? 1 : 0;
+    uint32_t i = 0;
+
+#if defined(BLIT_NEON)
+    for (; i + 16 <= u32Count; i += 16)
+    {
+        uint8x8x4_t p = vld4_u8(pu8Src + 2 * i);
+        uint8x8_t ya = y0 ? p.val[1] : p.val[0];
+        uint8x8_t yb = y0 ? p.val[3] : p.val[2];
+        int16x8_t d = vreinterpretq_s16_u16(vsubl_u8(y0 ? p.val[0] : p.val[1], vdup_n_u8(128)));
+        int16x8_t e = vreinterpretq_s16_u16(vsubl_u8(y0 ? p.val[2] : p.val[3], vdup_n_u8(128)));
+        uint8x8x3_t even = yuv_to_rgb8(ya, d, e);
+        uint8x8x3_t odd = yuv_to_rgb8(yb, d, e);
+        uint8x8x2_t z;
+        uint8x16x4_t v;
+
+        /* Pixels back in order, bytes B, G, R, A */
+        z = vzip_u8(even.val[2], odd.val[2]);
+        v.val[0] = vcombine_u8(z.val[0], z.val[1]);
+        z = vzip_u8(even.val[1], odd.val[1]);
+        v.val[1] = vcombine_u8(z.val[0], z.val[1]);
+        z = vzip_u8(even.val[0], odd.val[0]);
+        v.val[2] = vcombine_u8(z.val[0], z.val[1]);
+        v.val[3] = vdupq_n_u8(0xFF);
+        vst4q_u8((uint8_t *)(pu32Dst + i), v);
+    }
+#endif
+
+    for (; i + 2 <= u32Count; i += 2)
+    {
+        const uint8_t *p = pu8Src + 2 * i;
+        int32_t d = (int32_t)p[y0 ^ 1] - 128, e = (int32_t)p[(y0 ^ 1) + 2] - 128;
+
+        pu32Dst[i] = yuv_to_rgb(p[y0], d, e);
+        pu32Dst[i + 1] = yuv_to_rgb(p[y0 + 2], d, e);
+    }
+}
+
+void blit_row_blend_argb8888(uint32_t *pu32Dst, const uint32_t *pu32Src, uint32_t u32Count,
+                             uint32_t u32Alpha)
+{
+    uint32_t i = 0;
+
+#if defined(BLIT_NEON)
+    uint8x8_t ga = vdup_n_u8((uint8_t)u32Alpha);
+
+    for (; i + 8 <= u32Count; i += 8)
+    {
+        uint8x8x4_t s = vld4_u8((const uint8_t *)(pu32Src + i));
+        uint8x8x4_t d = vld4_u8((const uint8_t *)(pu32Dst + i));
+        uint8x8_t a = div255_8(vmull_u8(s.val[3], ga));
+        uint8x8_t ia = vmvn_u8(a);
+
+        d.val[0] = div255_8(vmlal_u8(vmull_u8(s.val[0], a), d.val[0], ia));
+        d.val[1] = div255_8(vmlal_u8(vmull_u8(s.val[1], a), d.val[1], ia));
+        d.val[2] = div255_8(vmlal_u8(vmull_u8(s.val[2], a), d.val[2], ia));
+        d.val[3] = vadd_u8(a, div255_8(vmull_u8(d.val[3], ia)));
+        vst4_u8((uint8_t *)(pu32Dst + i), d);
+    }
+#endif
+
+    for (; i < u32Count; i++)
+    {
+        uint32_t s = pu32Src[i], d = pu32Dst[i];
+        uint32_t a = div255((s >> 24) * u32Alpha), ia = 255 - a;
+        uint32_t r = div255(((s >> 16) & 0xFF) * a + ((d >> 16) & 0xFF) * ia);
+        uint32_t g = div255(((s >> 8) & 0xFF) * a + ((d >> 8) & 0xFF) * ia);
+        uint32_t b = div255((s & 0xFF) * a + (d & 0xFF) * ia);
+
+        pu32Dst[i] = (a + div255((d >> 24) * ia)) << 24 | r << 16 | g << 8 | b;
+    }
+}
@@ -0,0 +1,896 @@
+/**************************************************************************//**
+ * @file     blit_test.c
+ *
+ * @brief    Host unit test and benchmark of the blit library: the NEON row
+ *           kernels against the C versions, both against references, and
+ *           the surface operations and command lists against a per pixel
+ *           model, with and without engines.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "blit.h"
+
+/*
+ * The library is built twice (see Makefile), renamed with a prefix:
+ *
+ *   neon_  the NEON kernels, on the shared arm_neon.h stand-in unless the
+ *          host is AArch64
+ *   c_     BLIT_NO_NEON
+ *
+ *   blit_test [-b] [-t ms] [-f MHz]
+ *
+ * Every row kernel of neon_ must be bit-exact with c_ over random inputs,
+ * lengths and buffer offsets, and c_ with the references below. The
+ * surface operations of both copies are checked pixel by pixel against a
+ * model that clips and converts on its own, over the whole buffer so
+ * that nothing outside a rectangle is touched; command lists run with
+ * engines that finish their work late, or fail it, must leave the same
+ * pixels as the model running the commands one by one. -b adds pixels
+ * per second of each row kernel, measured for at least -t ms, and the
+ * cycles per pixel that makes at a -f MHz core clock (the A35 of MA35D1
+ * by default).
+ */
+
+#define BLIT_DECLARE(p)  \
+	void p##blit_row_fill16(uint16_t *, uint16_t, uint32_t);  \
+	void p##blit_row_fill32(uint32_t *, uint32_t, uint32_t);  \
+	void p##blit_row_rgb565_to_argb8888(uint32_t *, const uint16_t *, uint32_t);  \
+	void p##blit_row_argb8888_to_rgb565(uint16_t *, const uint32_t *, uint32_t);  \
+	void p##blit_row_argb8888_to_yuv422(uint8_t *, const uint32_t *, uint32_t, uint32_t);  \
+	void p##blit_row_yuv422_to_argb8888(uint32_t *, const uint8_t *, uint32_t, uint32_t);  \
+	void p##blit_row_blend_argb8888(uint32_t *, const uint32_t *, uint32_t, uint32_t);  \
+	uint32_t p##blit_fmt_color(uint32_t, uint32_t);  \
+	void p##blit_list_init(BLIT_LIST_T *, BLIT_CMD_T *, uint32_t);  \
+	int p##blit_list_fill(BLIT_LIST_T *, const BLIT_SURFACE_T *, int32_t, int32_t, uint32_t, uint32_t, uint32_t);  \
+	int p##blit_list_copy(BLIT_LIST_T *, const BLIT_SURFACE_T *, int32_t, int32_t,  \
+			      const BLIT_SURFACE_T *, int32_t, int32_t, uint32_t, uint32_t);  \
+	int p##blit_list_blend(BLIT_LIST_T *, const BLIT_SURFACE_T *, int32_t, int32_t,  \
+			       const BLIT_SURFACE_T *, int32_t, int32_t, uint32_t, uint32_t, uint32_t);  \
+	int p##blit_list_submit(BLIT_LIST_T *);  \
+	int p##blit_fill(const BLIT_SURFACE_T *, int32_t, int32_t, uint32_t, uint32_t, uint32_t);  \
+	int p##blit_engine_add(const BLIT_ENGINE_T *);  \
+	void p##blit_engine_reset(void);
+
+#define BLIT_VARIANT(p, desc)  \
+	{ #p, desc, p##blit_row_fill16, p##blit_row_fill32, p##blit_row_rgb565_to_argb8888,  \
+	  p##blit_row_argb8888_to_rgb565, p##blit_row_argb8888_to_yuv422, p##blit_row_yuv422_to_argb8888,  \
+	  p##blit_row_blend_argb8888, p##blit_fmt_color, p##blit_list_init, p##blit_list_fill,  \
+	  p##blit_list_copy, p##blit_list_blend, p##blit_list_submit, p##blit_fill,  \
+	  p##blit_engine_add, p##blit_engine_reset }
+
+BLIT_DECLARE(neon_)
+BLIT_DECLARE(c_)
+
+typedef struct {
+	const char *name;
+	const char *desc;
+	void (*fill16)(uint16_t *, uint16_t, uint32_t);
+	void (*fill32)(uint32_t *, uint32_t, uint32_t);
+	void (*rgb565_to_argb)(uint32_t *, const uint16_t *, uint32_t);
+	void (*argb_to_rgb565)(uint16_t *, const uint32_t *, uint32_t);
+	void (*argb_to_yuv)(uint8_t *, const uint32_t *, uint32_t, uint32_t);
+	void (*yuv_to_argb)(uint32_t *, const uint8_t *, uint32_t, uint32_t);
+	void (*blend)(uint32_t *, const uint32_t *, uint32_t, uint32_t);
+	uint32_t (*fmt_color)(uint32_t, uint32_t);
+	void (*list_init)(BLIT_LIST_T *, BLIT_CMD_T *, uint32_t);
+	int (*list_fill)(BLIT_LIST_T *, const BLIT_SURFACE_T *, int32_t, int32_t, uint32_t, uint32_t, uint32_t);
+	int (*list_copy)(BLIT_LIST_T *, const BLIT_SURFACE_T *, int32_t, int32_t,
+			 const BLIT_SURFACE_T *, int32_t, int32_t, uint32_t, uint32_t);
+	int (*list_blend)(BLIT_LIST_T *, const BLIT_SURFACE_T *, int32_t, int32_t,
+			  const BLIT_SURFACE_T *, int32_t, int32_t, uint32_t, uint32_t, uint32_t);
+	int (*list_submit)(BLIT_LIST_T *);
+	int (*fill)(const BLIT_SURFACE_T *, int32_t, int32_t, uint32_t, uint32_t, uint32_t);
+	int (*engine_add)(const BLIT_ENGINE_T *);
+	void (*engine_reset)(void);
+} variant_t;
+
+enum { V_NEON, V_C, V_NUM };
+
+static const variant_t s_var[V_NUM] = {
+	BLIT_VARIANT(neon_, "NEON"),
+	BLIT_VARIANT(c_,    "C"),
+};
+
+#define MAXN        1024        /* pixels of a row kernel test */
+#define GUARD       16
+#define ARENA       65536       /* bytes holding the surfaces */
+#define MAXCMD      32
+
+static const char *s_fmt_name[BLIT_FMT_NUM] = { "RGB565", "ARGB8888", "YUY2", "UYVY" };
+
+static int s_fail;
+
+#define CHECK(cond, ...)  do { if (!(cond)) { printf("  FAIL: " __VA_ARGS__); printf("\n"); s_fail = 1; } } while (0)
+
+static uint32_t s_rnd = 1;
+
+static uint32_t rnd(void)
+{
+	/* xorshift32 */
+	s_rnd ^= s_rnd << 13;
+	s_rnd ^= s_rnd >> 17;
+	s_rnd ^= s_rnd << 5;
+	return s_rnd;
+}
+
+/* Random pixels, with some of the alpha and colour extremes */
+static uint32_t rnd_argb(void)
+{
+	static const uint32_t edge[] = { 0x00000000, 0xffffffff, 0xff000000, 0x00ffffff, 0x80ff0000, 0x7f00ff00 };
+
+	switch (rnd() & 7) {
+	case 0:  return edge[rnd() % (sizeof(edge) / sizeof(edge[0]))];
+	case 1:  return (rnd() & 0x00ffffff) | ((rnd() & 1) ? 0xff000000 : 0);
+	default: return rnd();
+	}
+}
+
+static void rnd_fill(void *p, size_t n)
+{
+	uint8_t *pu8 = p;
+
+	while (n--)
+		*pu8++ = (uint8_t)rnd();
+}
+
+/*---------------------------------------------------------------------------*/
+/* References                                                                */
+/*---------------------------------------------------------------------------*/
+
+static int is_yuv(uint32_t fmt)
+{
+	return fmt == BLIT_FMT_YUY2 || fmt == BLIT_FMT_UYVY;
+}
+
+static uint32_t fmt_bpp(uint32_t fmt)
+{
+	return fmt == BLIT_FMT_ARGB8888 ? 4 : 2;
+}
+
+/* n / d rounded half up */
+static int32_t round_div(int32_t n, int32_t d)
+{
+	return (int32_t)floor((double)n / d + 0.5);
+}
+
+static uint8_t clamp8(int32_t v)
+{
+	return v < 0 ? 0 : v > 255 ? 255 : (uint8_t)v;
+}
+
+static uint32_t ref_565_to_argb(uint16_t p)
+{
+	uint32_t r = p >> 11, g = (p >> 5) & 0x3f, b = p & 0x1f;
+
+	return 0xff000000 | ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+}
+
+static uint16_t ref_argb_to_565(uint32_t p)
+{
+	return (uint16_t)((((p >> 16) & 0xff) >> 3) << 11 | (((p >> 8) & 0xff) >> 2) << 5 | (p & 0xff) >> 3);
+}
+
+/* BT.601 limited range, a pair sharing the mean of its chroma */
+static void ref_argb_to_yuv(uint8_t *out, uint32_t p0, uint32_t p1, uint32_t fmt)
+{
+	int32_t y[2], u = 0, v = 0;
+	uint32_t p[2] = { p0, p1 };
+	int k;
+
+	for (k = 0; k < 2; k++) {
+		int32_t r = (p[k] >> 16) & 0xff, g = (p[k] >> 8) & 0xff, b = p[k] & 0xff;
+
+		y[k] = round_div(66 * r + 129 * g + 25 * b, 256) + 16;
+		u += round_div(-38 * r - 74 * g + 112 * b, 256);
+		v += round_div(112 * r - 94 * g - 18 * b, 256);
+	}
+	u = round_div(u, 2) + 128;
+	v = round_div(v, 2) + 128;
+
+	if (fmt == BLIT_FMT_YUY2) {
+		out[0] = (uint8_t)y[0]; out[1] = (uint8_t)u; out[2] = (uint8_t)y[1]; out[3] = (uint8_t)v;
+	} else {
+		out[0] = (uint8_t)u; out[1] = (uint8_t)y[0]; out[2] = (uint8_t)v; out[3] = (uint8_t)y[1];
+	}
+}
+
+static uint32_t ref_yuv_to_argb(int32_t y, int32_t u, int32_t v)
+{
+	int32_t c = 298 * (y - 16), d = u - 128, e = v - 128;
+
+	return 0xff000000 | (uint32_t)clamp8(round_div(c + 409 * e, 256)) << 16 |
+	       (uint32_t)clamp8(round_div(c - 100 * d - 208 * e, 256)) << 8 | clamp8(round_div(c + 516 * d, 256));
+}
+
+static uint32_t ref_blend(uint32_t s, uint32_t d, uint32_t ga)
+{
+	int32_t a = round_div((int32_t)(s >> 24) * (int32_t)ga, 255), ia = 255 - a;
+	uint32_t r = (uint32_t)(a + round_div((int32_t)(d >> 24) * ia, 255)) << 24;
+	int sh;
+
+	for (sh = 0; sh < 24; sh += 8)
+		r |= (uint32_t)round_div((int32_t)((s >> sh) & 0xff) * a + (int32_t)((d >> sh) & 0xff) * ia, 255) << sh;
+	return r;
+}
+
+static uint8_t *ref_addr(const BLIT_SURFACE_T *s, int32_t x, int32_t y)
+{
+	return (uint8_t *)s->pvBuf + (size_t)y * s->u32Pitch + (size_t)x * fmt_bpp(s->u32Format);
+}
+
+static uint32_t ref_get(const BLIT_SURFACE_T *s, int32_t x, int32_t y)
+{
+	const uint8_t *p = ref_addr(s, x, y);
+	uint16_t u16;
+	uint32_t u32;
+
+	switch (s->u32Format) {
+	case BLIT_FMT_RGB565:
+		memcpy(&u16, p, 2);
+		return ref_565_to_argb(u16);
+	case BLIT_FMT_ARGB8888:
+		memcpy(&u32, p, 4);
+		return u32;
+	case BLIT_FMT_YUY2:
+		p = ref_addr(s, x & ~1, y);
+		return ref_yuv_to_argb(p[(x & 1) * 2], p[1], p[3]);
+	default:
+		p = ref_addr(s, x & ~1, y);
+		return ref_yuv_to_argb(p[1 + (x & 1) * 2], p[0], p[2]);
+	}
+}
+
+/* One pixel at x, for the 4:2:2 formats the pair at an even x */
+static void ref_put(const BLIT_SURFACE_T *s, int32_t x, int32_t y, const uint32_t *argb)
+{
+	uint8_t *p = ref_addr(s, x, y);
+	uint16_t u16;
+
+	switch (s->u32Format) {
+	case BLIT_FMT_RGB565:
+		u16 = ref_argb_to_565(argb[0]);
+		memcpy(p, &u16, 2);
+		break;
+	case BLIT_FMT_ARGB8888:
+		memcpy(p, argb, 4);
+		break;
+	default:
+		ref_argb_to_yuv(p, argb[0], argb[1], s->u32Format);
+		break;
+	}
+}
+
+static uint8_t s_arena[ARENA] __attribute__((aligned(64)));
+static uint8_t s_model[ARENA] __attribute__((aligned(64)));
+static uint8_t s_snap[ARENA] __attribute__((aligned(64)));
+
+/* A surface of s_arena moved to the same place in another buffer */
+static BLIT_SURFACE_T moved(const BLIT_SURFACE_T *s, uint8_t *arena)
+{
+	BLIT_SURFACE_T r = *s;
+
+	r.pvBuf = arena + ((uint8_t *)s->pvBuf - s_arena);
+	return r;
+}
+
+static int inside(const BLIT_SURFACE_T *s, int64_t x, int64_t y)
+{
+	return x >= 0 && y >= 0 && x < s->u32Width && y < s->u32Height;
+}
+
+/*
+ * The model of an operation on surfaces of s_arena, run on the same place
+ * of arena: unclipped, the pixels outside either surface are skipped, and
+ * the source is read as it was before the operation.
+ */
+static void model_op(uint8_t *arena, uint32_t op, const BLIT_SURFACE_T *dst, int64_t x, int64_t y,
+		     const BLIT_SURFACE_T *src, int64_t sx, int64_t sy, uint32_t w, uint32_t h, uint32_t color)
+{
+	BLIT_SURFACE_T d = moved(dst, arena), s;
+	uint32_t step = is_yuv(d.u32Format) ? 2 : 1;
+	uint32_t i, j, k, out[2];
+
+	memcpy(s_snap, arena, ARENA);
+	if (op != BLIT_OP_FILL)
+		s = moved(src, s_snap);
+
+	for (j = 0; j < h; j++) {
+		for (i = 0; i < w; i += step) {
+			int ok = 1;
+
+			for (k = 0; k < step; k++) {
+				ok &= inside(&d, x + i + k, y + j);
+				if (op != BLIT_OP_FILL)
+					ok &= inside(&s, sx + i + k, sy + j);
+			}
+			if (!ok)
+				continue;
+
+			if (op == BLIT_OP_COPY && s.u32Format == d.u32Format) {
+				memcpy(ref_addr(&d, x + i, y + j), ref_addr(&s, sx + i, sy + j), step * fmt_bpp(d.u32Format));
+				continue;
+			}
+			for (k = 0; k < step; k++) {
+				switch (op) {
+				case BLIT_OP_FILL:
+					out[k] = color;
+					break;
+				case BLIT_OP_COPY:
+					out[k] = ref_get(&s, sx + i + k, sy + j);
+					break;
+				default:
+					out[k] = ref_blend(ref_get(&s, sx + i + k, sy + j), ref_get(&d, x + i + k, y + j), color);
+					break;
+				}
+			}
+			ref_put(&d, x + i, y + j, out);
+		}
+	}
+}
+
+static void model_cmd(uint8_t *arena, const BLIT_CMD_T *c)
+{
+	model_op(arena, c->u32Op, &c->sDst, c->u32DstX, c->u32DstY, &c->sSrc, c->u32SrcX, c->u32SrcY,
+		 c->u32Width, c->u32Height, c->u32Color);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Row kernels                                                               */
+/*---------------------------------------------------------------------------*/
+
+static void test_known(void)
+{
+	uint8_t yuv[4];
+	int v;
+
+	printf("known values\n");
+	for (v = 0; v < V_NUM; v++) {
+		const variant_t *p = &s_var[v];
+		uint32_t white[2] = { 0xffffffff, 0xffffffff }, black[2] = { 0xff000000, 0xff000000 }, argb[2];
+		static const uint8_t yuv_white[4] = { 235, 128, 235, 128 }, yuv_black[4] = { 16, 128, 16, 128 };
+
+		p->argb_to_yuv(yuv, white, 2, BLIT_FMT_YUY2);
+		CHECK(!memcmp(yuv, yuv_white, 4), "%s white -> YUY2 %u %u %u %u", p->desc, yuv[0], yuv[1], yuv[2], yuv[3]);
+		p->argb_to_yuv(yuv, black, 2, BLIT_FMT_YUY2);
+		CHECK(!memcmp(yuv, yuv_black, 4), "%s black -> YUY2 %u %u %u %u", p->desc, yuv[0], yuv[1], yuv[2], yuv[3]);
+		p->yuv_to_argb(argb, yuv_white, 2, BLIT_FMT_YUY2);
+		CHECK(argb[0] == 0xffffffff && argb[1] == 0xffffffff, "%s YUY2 white -> %08x", p->desc, argb[0]);
+		p->yuv_to_argb(argb, yuv_black, 2, BLIT_FMT_YUY2);
+		CHECK(argb[0] == 0xff000000 && argb[1] == 0xff000000, "%s YUY2 black -> %08x", p->desc, argb[0]);
+		CHECK(p->fmt_color(0xffffffff, BLIT_FMT_RGB565) == 0xffff, "%s white 565", p->desc);
+		CHECK(p->fmt_color(0x12345678, BLIT_FMT_ARGB8888) == 0x12345678, "%s ARGB colour", p->desc);
+		CHECK(p->fmt_color(0xffffffff, BLIT_FMT_UYVY) == 0xeb80eb80, "%s UYVY white %08x", p->desc,
+		      p->fmt_color(0xffffffff, BLIT_FMT_UYVY));
+
+		argb[0] = 0xff000000;
+		argb[1] = 0x80ffffff;
+		p->blend(argb, &argb[1], 1, 255);
+		CHECK(argb[0] == 0xff808080, "%s half white over black %08x", p->desc, argb[0]);
+		argb[0] = 0x12345678;
+		p->blend(argb, &white[0], 1, 0);
+		CHECK(argb[0] == 0x12345678, "%s alpha 0 changed %08x", p->desc, argb[0]);
+	}
+}
+
+/* Every kernel of both copies on the same random row, c_ against the references */
+static void test_rows(void)
+{
+	static uint32_t src32[MAXN + GUARD], orig32[MAXN + 2 * GUARD], dst32[V_NUM][MAXN + 2 * GUARD];
+	static uint16_t src16[MAXN + GUARD], orig16[MAXN + 2 * GUARD], dst16[V_NUM][MAXN + 2 * GUARD];
+	static uint8_t src8[2 * (MAXN + GUARD)], orig8[2 * (MAXN + 2 * GUARD)], dst8[V_NUM][2 * (MAXN + 2 * GUARD)];
+	int iter, v, k, fails[7] = { 0 };
+
+	static const char *kernel[] = {
+		"fill16", "fill32", "565 -> ARGB", "ARGB -> 565", "ARGB -> 4:2:2", "4:2:2 -> ARGB", "blend",
+	};
+
+	printf("row kernels\n");
+	for (iter = 0; iter < 7 * 600; iter++) {
+		uint32_t n = (iter < 7 * 40) ? (uint32_t)iter / 7 : rnd() % (MAXN + 1);
+		uint32_t so = rnd() % GUARD, doff = GUARD + rnd() % GUARD, i, j;
+		uint32_t fmt = (rnd() & 1) ? BLIT_FMT_YUY2 : BLIT_FMT_UYVY;
+		uint32_t alpha = (rnd() & 3) ? rnd() % 256 : (rnd() & 1) * 255;
+		uint32_t value = rnd();
+		uint8_t *out, *orig;
+		size_t size, lo, hi;
+
+		k = iter % 7;
+		if (k == 4 || k == 5) {
+			n &= ~1u;
+			so &= ~1u;
+			doff &= ~1u;
+		}
+		for (i = 0; i < MAXN + GUARD; i++) {
+			src32[i] = rnd_argb();
+			src16[i] = (uint16_t)rnd();
+		}
+		rnd_fill(src8, sizeof(src8));
+		for (i = 0; i < MAXN + 2 * GUARD; i++)
+			orig32[i] = rnd_argb();
+		rnd_fill(orig16, sizeof(orig16));
+		rnd_fill(orig8, sizeof(orig8));
+
+		for (v = 0; v < V_NUM; v++) {
+			const variant_t *p = &s_var[v];
+
+			memcpy(dst32[v], orig32, sizeof(orig32));
+			memcpy(dst16[v], orig16, sizeof(orig16));
+			memcpy(dst8[v], orig8, sizeof(orig8));
+
+			switch (k) {
+			case 0: p->fill16(dst16[v] + doff, (uint16_t)value, n); break;
+			case 1: p->fill32(dst32[v] + doff, value, n); break;
+			case 2: p->rgb565_to_argb(dst32[v] + doff, src16 + so, n); break;
+			case 3: p->argb_to_rgb565(dst16[v] + doff, src32 + so, n); break;
+			case 4: p->argb_to_yuv(dst8[v] + 2 * doff, src32 + so, n, fmt); break;
+			case 5: p->yuv_to_argb(dst32[v] + doff, src8 + 2 * so, n, fmt); break;
+			case 6: p->blend(dst32[v] + doff, src32 + so, n, alpha); break;
+			}
+		}
+
+		if (memcmp(dst32[V_NEON], dst32[V_C], sizeof(orig32)) ||
+		    memcmp(dst16[V_NEON], dst16[V_C], sizeof(orig16)) ||
+		    memcmp(dst8[V_NEON], dst8[V_C], sizeof(orig8))) {
+			if (!fails[k]++)
+				CHECK(0, "%s: NEON differs from C, n %u", kernel[k], n);
+		}
+
+		/* Nothing written around the row */
+		if (k == 0 || k == 3) {
+			out = (uint8_t *)dst16[V_C], orig = (uint8_t *)orig16, size = sizeof(orig16), lo = 2 * doff;
+		} else if (k == 4) {
+			out = dst8[V_C], orig = orig8, size = sizeof(orig8), lo = 2 * doff;
+		} else {
+			out = (uint8_t *)dst32[V_C], orig = (uint8_t *)orig32, size = sizeof(orig32), lo = 4 * doff;
+		}
+		hi = lo + n * ((k == 0 || k == 3 || k == 4) ? 2 : 4);
+		if ((memcmp(out, orig, lo) || memcmp(out + hi, orig + hi, size - hi)) && !fails[k]++)
+			CHECK(0, "%s: written outside the row, n %u", kernel[k], n);
+
+		/* c_ against the references */
+		for (j = 0; j < n; j++) {
+			uint32_t got = 0, ref = 0;
+
+			switch (k) {
+			case 0: got = dst16[V_C][doff + j]; ref = (uint16_t)value; break;
+			case 1: got = dst32[V_C][doff + j]; ref = value; break;
+			case 2: got = dst32[V_C][doff + j]; ref = ref_565_to_argb(src16[so + j]); break;
+			case 3: got = dst16[V_C][doff + j]; ref = ref_argb_to_565(src32[so + j]); break;
+			case 4:
+				if (j & 1)
+					continue;
+				ref_argb_to_yuv((uint8_t *)&ref, src32[so + j], src32[so + j + 1], fmt);
+				memcpy(&got, dst8[V_C] + 2 * (doff + j), 4);
+				break;
+			case 5: {
+				BLIT_SURFACE_T s = { src8 + 2 * so, n, 1, 2 * n, fmt };
+
+				got = dst32[V_C][doff + j];
+				ref = ref_get(&s, (int32_t)j, 0);
+				break;
+			}
+			case 6: got = dst32[V_C][doff + j]; ref = ref_blend(src32[so + j], orig32[doff + j], alpha); break;
+			}
+			if (got != ref) {
+				if (!fails[k]++)
+					CHECK(0, "%s: pixel %u of %u is %08x, not %08x", kernel[k], j, n, got, ref);
+				break;
+			}
+		}
+	}
+
+	for (k = 0; k < 7; k++)
+		printf("  %-14s %s\n", kernel[k], fails[k] ? "FAIL" : "ok");
+}
+
+/*---------------------------------------------------------------------------*/
+/* Surfaces and lists                                                        */
+/*---------------------------------------------------------------------------*/
+
+/*
+ * A random surface of s_arena within [lo, lo + span), even wide when it
+ * meets 4:2:2 surfaces: clipped to an odd width their rectangles are
+ * refused
+ */
+static BLIT_SURFACE_T rnd_surface(uint32_t fmt, int even, uint32_t lo, uint32_t span)
+{
+	BLIT_SURFACE_T s;
+	uint32_t bpp = fmt_bpp(fmt), align = is_yuv(fmt) ? 4 : bpp, size;
+
+	s.u32Format = fmt;
+	do {
+		s.u32Width = 1 + rnd() % 96;
+		if (even)
+			s.u32Width = (s.u32Width + 1) & ~1u;
+		s.u32Height = 1 + rnd() % 48;
+		s.u32Pitch = (s.u32Width * bpp + (rnd() % 3) * (rnd() % 64) + align - 1) & ~(align - 1);
+		size = s.u32Pitch * s.u32Height;
+	} while (size > span);
+	s.pvBuf = s_arena + lo + ((rnd() % (span - size + 1)) & ~(align - 1));
+	return s;
+}
+
+/* Coordinates around and across a surface, even on 4:2:2 */
+static int32_t rnd_coord(uint32_t extent, int even)
+{
+	int32_t c = (int32_t)(rnd() % (extent + 32)) - 16;
+
+	return even ? c & ~1 : c;
+}
+
+/* One operation of each kind through the one command list path, clipping included */
+static void test_ops(const variant_t *p)
+{
+	int iter, fails = 0, ret;
+
+	for (iter = 0; iter < 3000; iter++) {
+		uint32_t op = iter % 3, dfmt = rnd() % BLIT_FMT_NUM, sfmt = rnd() % BLIT_FMT_NUM;
+		BLIT_SURFACE_T d, s;
+		BLIT_CMD_T cmd;
+		BLIT_LIST_T list;
+		int32_t x, y, sx, sy;
+		uint32_t w, h, color;
+		int even;
+
+		if (op == BLIT_OP_COPY && (rnd() & 3) == 0) {
+			/* overlapping, within one surface */
+			sfmt = dfmt;
+			d = rnd_surface(dfmt, is_yuv(dfmt), 0, ARENA);
+			s = d;
+		} else {
+			if (op == BLIT_OP_FILL)
+				sfmt = dfmt;
+			even = is_yuv(dfmt) || is_yuv(sfmt);
+			d = rnd_surface(dfmt, even, 0, ARENA / 2);
+			s = rnd_surface(sfmt, even, ARENA / 2, ARENA / 2);
+		}
+		even = is_yuv(d.u32Format) || is_yuv(s.u32Format);
+		x = rnd_coord(d.u32Width, even);
+		y = rnd_coord(d.u32Height, 0);
+		sx = rnd_coord(s.u32Width, even);
+		sy = rnd_coord(s.u32Height, 0);
+		w = (rnd() % (d.u32Width + 16)) & (even ? ~1u : ~0u);
+		h = rnd() % (d.u32Height + 8);
+		color = (op == BLIT_OP_BLEND) ? ((rnd() & 1) ? 255 : rnd() % 256) : rnd_argb();
+
+		rnd_fill(s_arena, ARENA);
+		memcpy(s_model, s_arena, ARENA);
+
+		p->list_init(&list, &cmd, 1);
+		switch (op) {
+		case BLIT_OP_FILL:  ret = p->list_fill(&list, &d, x, y, w, h, color); break;
+		case BLIT_OP_COPY:  ret = p->list_copy(&list, &d, x, y, &s, sx, sy, w, h); break;
+		default:            ret = p->list_blend(&list, &d, x, y, &s, sx, sy, w, h, color); break;
+		}
+		if (ret == BLIT_OK)
+			ret = p->list_submit(&list);
+
+		CHECK(ret == BLIT_OK, "%s %s %s <- %s returned %d", p->desc, op == 0 ? "fill" : op == 1 ? "copy" : "blend",
+		      s_fmt_name[dfmt], s_fmt_name[sfmt], ret);
+		model_op(s_model, op, &d, x, y, &s, sx, sy, w, h, color);
+		if (memcmp(s_arena, s_model, ARENA) && !fails++)
+			CHECK(0, "%s %s %s (%d,%d %ux%u of %ux%u) <- %s (%d,%d of %ux%u): pixels differ from the model",
+			      p->desc, op == 0 ? "fill" : op == 1 ? "copy" : "blend", s_fmt_name[d.u32Format], x, y, w, h,
+			      d.u32Width, d.u32Height, s_fmt_name[s.u32Format], sx, sy, s.u32Width, s.u32Height);
+	}
+}
+
+static void test_errors(const variant_t *p)
+{
+	BLIT_SURFACE_T d = { s_arena, 16, 16, 64, BLIT_FMT_ARGB8888 }, s, bad;
+	BLIT_CMD_T cmd[2];
+	BLIT_LIST_T list;
+
+	p->list_init(&list, cmd, 2);
+
+	bad = d;
+	bad.u32Format = BLIT_FMT_NUM;
+	CHECK(p->list_fill(&list, &bad, 0, 0, 4, 4, 0) == BLIT_ERR_FORMAT, "%s unknown format", p->desc);
+	bad = d;
+	bad.pvBuf = NULL;
+	CHECK(p->list_fill(&list, &bad, 0, 0, 4, 4, 0) == BLIT_ERR_PARAM, "%s NULL buffer", p->desc);
+	bad = d;
+	bad.u32Pitch = 60;
+	CHECK(p->list_fill(&list, &bad, 0, 0, 4, 4, 0) == BLIT_ERR_PARAM, "%s pitch under the width", p->desc);
+	bad = d;
+	bad.u32Pitch = 66;
+	CHECK(p->list_fill(&list, &bad, 0, 0, 4, 4, 0) == BLIT_ERR_ALIGN, "%s unaligned pitch", p->desc);
+	bad = d;
+	bad.pvBuf = s_arena + 2;
+	CHECK(p->list_fill(&list, &bad, 0, 0, 4, 4, 0) == BLIT_ERR_ALIGN, "%s unaligned buffer", p->desc);
+
+	bad = d;
+	bad.u32Format = BLIT_FMT_YUY2;
+	bad.u32Pitch = 32;
+	CHECK(p->list_fill(&list, &bad, 1, 0, 4, 4, 0) == BLIT_ERR_ALIGN, "%s odd 4:2:2 x", p->desc);
+	CHECK(p->list_fill(&list, &bad, 0, 0, 3, 4, 0) == BLIT_ERR_ALIGN, "%s odd 4:2:2 width", p->desc);
+	CHECK(p->list_fill(&list, &bad, -1, 0, 4, 4, 0) == BLIT_ERR_ALIGN, "%s odd 4:2:2 clipped width", p->desc);
+
+	s = d;
+	s.pvBuf = s_arena + 4096;
+	CHECK(p->list_blend(&list, &d, 0, 0, &s, 0, 0, 4, 4, 256) == BLIT_ERR_PARAM, "%s alpha over 255", p->desc);
+	CHECK(p->list_blend(&list, &d, 0, 0, &d, 1, 0, 4, 4, 255) == BLIT_ERR_PARAM, "%s overlapping blend", p->desc);
+	s = d;
+	s.u32Format = BLIT_FMT_RGB565;
+	CHECK(p->list_copy(&list, &d, 0, 0, &s, 0, 0, 4, 4) == BLIT_ERR_PARAM, "%s overlapping conversion", p->desc);
+	s = d;
+	s.u32Pitch = 128;
+	CHECK(p->list_copy(&list, &d, 0, 0, &s, 0, 1, 4, 4) == BLIT_ERR_PARAM, "%s overlap across pitches", p->desc);
+	CHECK(list.u32Count == 0, "%s %u rejected commands queued", p->desc, list.u32Count);
+
+	CHECK(p->list_fill(&list, &d, 16, 0, 4, 4, 0) == BLIT_OK && list.u32Count == 0, "%s clipped away", p->desc);
+	CHECK(p->list_fill(&list, &d, 0, -4, 4, 4, 0) == BLIT_OK && list.u32Count == 0, "%s clipped away above", p->desc);
+	CHECK(p->list_fill(&list, &d, 0, 0, 0, 4, 0) == BLIT_OK && list.u32Count == 0, "%s empty", p->desc);
+	CHECK(p->list_fill(&list, &d, 0, 0, 4, 4, 0) == BLIT_OK, "%s first", p->desc);
+	CHECK(p->list_fill(&list, &d, 0, 0, 4, 4, 0) == BLIT_OK, "%s second", p->desc);
+	CHECK(p->list_fill(&list, &d, 0, 0, 4, 4, 0) == BLIT_ERR_FULL, "%s full list", p->desc);
+	CHECK(p->list_submit(&list) == BLIT_OK && list.u32Count == 0, "%s submit", p->desc);
+}
+
+/*
+ * Test engines: each takes the operations of its mask and does them only
+ * when waited for, from the memory as it is then; a failing one does
+ * nothing and reports an error, or refuses to start.
+ */
+typedef struct {
+	uint32_t ops;               /* 1 << BLIT_OP_* taken */
+	int fail_wait;
+	int fail_start;
+	const BLIT_CMD_T *busy;
+	uint32_t started;
+	uint32_t overlapped;        /* started while another engine was busy */
+} test_engine_t;
+
+static test_engine_t s_eng[2];
+
+static int eng_accept(void *ctx, const BLIT_CMD_T *cmd)
+{
+	test_engine_t *e = ctx;
+
+	return (e->ops >> cmd->u32Op) & 1;
+}
+
+static int eng_start(void *ctx, const BLIT_CMD_T *cmd)
+{
+	test_engine_t *e = ctx;
+
+	CHECK(e->busy == NULL, "engine started while busy");
+	if (e->fail_start)
+		return BLIT_ERR_ENGINE;
+	e->busy = cmd;
+	e->started++;
+	if (s_eng[0].busy && s_eng[1].busy)
+		e->overlapped++;
+	return BLIT_OK;
+}
+
+static int eng_wait(void *ctx)
+{
+	test_engine_t *e = ctx;
+	const BLIT_CMD_T *cmd = e->busy;
+
+	CHECK(cmd != NULL, "engine waited for while idle");
+	e->busy = NULL;
+	if (cmd == NULL || e->fail_wait)
+		return BLIT_ERR_ENGINE;
+	model_cmd(s_arena, cmd);
+	return BLIT_OK;
+}
+
+/*
+ * Random lists over surfaces that share memory: with late or failing
+ * engines the pixels must be those of the commands run one by one.
+ */
+static void test_lists(const variant_t *p)
+{
+	static const struct {
+		const char *desc;
+		uint32_t ops[2];
+		int fail_wait, fail_start;
+	} setup[] = {
+		{ "CPU",                 { 0, 0 }, 0, 0 },
+		{ "late engines",        { 1 << BLIT_OP_FILL, 1 << BLIT_OP_COPY | 1 << BLIT_OP_BLEND }, 0, 0 },
+		{ "one late engine",     { 7, 0 }, 0, 0 },
+		{ "failing engines",     { 1 << BLIT_OP_FILL, 1 << BLIT_OP_COPY | 1 << BLIT_OP_BLEND }, 1, 0 },
+		{ "engines not started", { 7, 7 }, 0, 1 },
+	};
+	BLIT_CMD_T cmd[MAXCMD], saved[MAXCMD];
+	BLIT_LIST_T list;
+	uint32_t n;
+	int t, iter, k, ret;
+
+	for (t = 0; t < (int)(sizeof(setup) / sizeof(setup[0])); t++) {
+		int fails = 0, neng = 0;
+		uint32_t started = 0, overlapped = 0;
+
+		p->engine_reset();
+		for (k = 0; k < 2; k++) {
+			memset(&s_eng[k], 0, sizeof(s_eng[k]));
+			s_eng[k].ops = setup[t].ops[k];
+			s_eng[k].fail_wait = setup[t].fail_wait;
+			s_eng[k].fail_start = setup[t].fail_start;
+			if (s_eng[k].ops) {
+				BLIT_ENGINE_T eng = { "test", &s_eng[k], eng_accept, eng_start, eng_wait };
+
+				CHECK(p->engine_add(&eng) == BLIT_OK, "%s engine_add", p->desc);
+				neng++;
+			}
+		}
+
+		for (iter = 0; iter < 300; iter++) {
+			BLIT_SURFACE_T surf[4];
+			int expect_err = 0;
+
+			/* in a quarter of the arena, overlapping often */
+			for (k = 0; k < 4; k++)
+				surf[k] = rnd_surface(rnd() % BLIT_FMT_NUM, 1, 0, ARENA / 4);
+			rnd_fill(s_arena, ARENA / 4);
+			memcpy(s_model, s_arena, ARENA);
+
+			p->list_init(&list, cmd, MAXCMD);
+			for (n = 0; n < MAXCMD; n++) {
+				const BLIT_SURFACE_T *d = &surf[rnd() % 4], *s = &surf[rnd() % 4];
+				int even = is_yuv(d->u32Format) || is_yuv(s->u32Format);
+				int32_t x = rnd_coord(d->u32Width, even), y = rnd_coord(d->u32Height, 0);
+				int32_t sx = rnd_coord(s->u32Width, even), sy = rnd_coord(s->u32Height, 0);
+				uint32_t w = (rnd() % (d->u32Width + 8)) & (even ? ~1u : ~0u), h = rnd() % (d->u32Height + 4);
+
+				switch (rnd() % 3) {
+				case 0:  p->list_fill(&list, d, x, y, w, h, rnd_argb()); break;
+				case 1:  p->list_copy(&list, d, x, y, s, sx, sy, w, h); break;
+				default: p->list_blend(&list, d, x, y, s, sx, sy, w, h, rnd() % 256); break;
+				}
+			}
+			n = list.u32Count;
+			memcpy(saved, cmd, n * sizeof(cmd[0]));
+			for (k = 0; k < (int)n; k++) {
+				if (setup[t].fail_wait && eng_accept(&s_eng[0], &saved[k]) | eng_accept(&s_eng[1], &saved[k]))
+					expect_err = 1;
+			}
+
+			ret = p->list_submit(&list);
+			CHECK(ret == (expect_err ? BLIT_ERR_ENGINE : BLIT_OK), "%s %s: submit returned %d", p->desc,
+			      setup[t].desc, ret);
+			CHECK(list.u32Count == 0, "%s %s: list not emptied", p->desc, setup[t].desc);
+			CHECK(!s_eng[0].busy && !s_eng[1].busy, "%s %s: engine left busy", p->desc, setup[t].desc);
+
+			for (k = 0; k < (int)n; k++)
+				model_cmd(s_model, &saved[k]);
+			if (memcmp(s_arena, s_model, ARENA) && !fails++)
+				CHECK(0, "%s %s: pixels of a list of %u differ from the model", p->desc, setup[t].desc, n);
+		}
+
+		for (k = 0; k < 2; k++) {
+			started += s_eng[k].started;
+			overlapped += s_eng[k].overlapped;
+		}
+		if (neng && !setup[t].fail_start)
+			CHECK(started > 0, "%s %s: engines never used", p->desc, setup[t].desc);
+		if (neng == 2 && !setup[t].fail_wait && !setup[t].fail_start)
+			CHECK(overlapped > 0, "%s %s: engines never ran together", p->desc, setup[t].desc);
+		printf("  %s %-20s %5u on engines, %4u overlapped %s\n", p->desc, setup[t].desc, started, overlapped,
+		       fails ? "FAIL" : "ok");
+	}
+	p->engine_reset();
+}
+
+static void test_surfaces(void)
+{
+	int v;
+
+	printf("surfaces\n");
+	for (v = 0; v < V_NUM; v++) {
+		int fail = s_fail;
+
+		s_fail = 0;
+		test_errors(&s_var[v]);
+		test_ops(&s_var[v]);
+		printf("  %s operations %s\n", s_var[v].desc, s_fail ? "FAIL" : "ok");
+		s_fail |= fail;
+	}
+	printf("command lists\n");
+	for (v = 0; v < V_NUM; v++)
+		test_lists(&s_var[v]);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Benchmark                                                                 */
+/*---------------------------------------------------------------------------*/
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static volatile uint32_t s_sink;
+
+static void bench(unsigned int ms, unsigned int mhz)
+{
+	static uint32_t a32[MAXN], b32[MAXN];
+	static uint16_t a16[MAXN];
+	static uint8_t a8[2 * MAXN];
+	uint64_t t0, t;
+	long pixels;
+	uint32_t i;
+	int v, k;
+
+	static const char *kernel[] = {
+		"fill16", "fill32", "565 -> ARGB", "ARGB -> 565", "ARGB -> YUY2", "YUY2 -> ARGB", "blend",
+	};
+
+	for (i = 0; i < MAXN; i++) {
+		a32[i] = rnd_argb();
+		b32[i] = rnd_argb();
+		a16[i] = (uint16_t)rnd();
+	}
+	rnd_fill(a8, sizeof(a8));
+
+	printf("benchmark, cycles at %u MHz\n", mhz);
+	for (k = 0; k < (int)(sizeof(kernel) / sizeof(kernel[0])); k++) {
+		printf("  %-14s", kernel[k]);
+		for (v = 0; v < V_NUM; v++) {
+			const variant_t *p = &s_var[v];
+
+			pixels = 0;
+			t0 = now_ns();
+			do {
+				switch (k) {
+				case 0: p->fill16(a16, 0x1234, MAXN); break;
+				case 1: p->fill32(b32, 0x12345678, MAXN); break;
+				case 2: p->rgb565_to_argb(b32, a16, MAXN); break;
+				case 3: p->argb_to_rgb565(a16, a32, MAXN); break;
+				case 4: p->argb_to_yuv(a8, a32, MAXN, BLIT_FMT_YUY2); break;
+				case 5: p->yuv_to_argb(b32, a8, MAXN, BLIT_FMT_YUY2); break;
+				case 6: p->blend(b32, a32, MAXN, 200); break;
+				}
+				s_sink = b32[0] + a16[0] + a8[0];
+				pixels += MAXN;
+				t = now_ns() - t0;
+			} while (t < (uint64_t)ms * 1000000u);
+
+			printf("  %s %8.1f Mpixels/s %6.2f cycles", p->desc, pixels * 1e3 / t,
+			       (double)t * mhz / 1e3 / pixels);
+		}
+		printf("\n");
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int ms = 300, mhz = 800;
+	int opt, do_bench = 0;
+
+	while ((opt = getopt(argc, argv, "bt:f:")) != -1) {
+		switch (opt) {
+		case 'b': do_bench = 1; break;
+		case 't': ms = strtoul(optarg, NULL, 0); break;
+		case 'f': mhz = strtoul(optarg, NULL, 0); break;
+		default:
+			fprintf(stderr, "usage: %s [-b] [-t ms] [-f MHz]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	test_known();
+	test_rows();
+	test_surfaces();
+
+	if (do_bench)
+		bench(ms, mhz);
+
+	printf(s_fail ? "FAIL\n" : "PASS\n");
+	return s_fail;
+}
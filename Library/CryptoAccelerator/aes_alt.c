@@ -51,32 +51,61 @@
 
 #define AES_BLOCK_SIZE  (16)
 
+/* AES DMA compatible bounce buffers
+ *
+ * Caller buffers may sit on the stack or be unaligned, so data is staged
+ * through these buffers and accessed by CPU through the non-cacheable alias.
+ * Long inputs are carried through the buffers in MAX_DMA_CHAIN_SIZE pieces,
+ * one TSI_AES_Run per piece.
+ *
+ * MAX_DMA_CHAIN_SIZE must be a multiple of 16-byte block size. Its value is
+ * estimated to trade memory footprint off against the number of TSI commands.
+ */
+#define MAX_DMA_CHAIN_SIZE (AES_BLOCK_SIZE*256)
 
+__ALIGNED(64) static uint8_t s_u8in[MAX_DMA_CHAIN_SIZE];
+__ALIGNED(64) static uint8_t s_u8out[MAX_DMA_CHAIN_SIZE];
+__ALIGNED(64) static uint32_t s_u32key[8];
+__ALIGNED(64) static uint32_t s_u32iv[4];
 
-__ALIGNED(4) static uint8_t s_u8in[AES_BLOCK_SIZE];
-__ALIGNED(4) static uint8_t s_u8out[AES_BLOCK_SIZE];
-
-#if defined(MBEDTLS_CIPHER_MODE_CBC)
-__STATIC_INLINE uint32_t nu_get32_le(const uint8_t* pos)
-{
-	uint32_t val;
+/* AEAD (GCM/CCM) DMA buffers
+ *
+ * The TSI takes the formatted IV/AAD header and the payload as one stream.
+ * The header must fit into the first run together with the first payload
+ * piece; AEAD_DMA_CHAIN_SIZE holds a full TLS record (16 KB plaintext), so
+ * a record is a single TSI_AES_GCM_Run.
+ */
+#define AEAD_DMA_CHAIN_SIZE (16*1024)
 
-	val = *pos++;
-	val += (*pos++ << 8);
-	val += (*pos++ << 16);
-	val += (*pos++ << 24);
+__ALIGNED(64) static uint8_t s_u8AeadIn[NU_AES_AEAD_INFO_MAX + AEAD_DMA_CHAIN_SIZE];
+__ALIGNED(64) static uint8_t s_u8AeadOut[AEAD_DMA_CHAIN_SIZE + AES_BLOCK_SIZE];
+__ALIGNED(64) static uint32_t s_u32AeadParam[8];
 
-	return val;
-}
+/* TSI AES session cache
+ *
+ * A TSI AES session keeps the key and mode registers loaded, so a context
+ * keeps its session open from the first operation until mbedtls_aes_free()
+ * and later calls only send Set_IV and Run. The slot is found by context
+ * address and confirmed with ctx->sessTag, so a stale context at a reused
+ * address never picks up another key. When all slots or TSI sessions are
+ * in use, the least recently used session is closed.
+ */
+#define AES_SESSION_NUM    4
 
-__STATIC_INLINE void nu_set32_le(uint8_t* pos, uint32_t val)
+typedef struct
 {
-	*pos++ = val & 0xFF;
-	*pos++ = (val >> 8) & 0xFF;
-	*pos++ = (val >> 16) & 0xFF;
-	*pos = (val >> 24) & 0xFF;
-}
-#endif
+	const mbedtls_aes_context *owner;   /* NULL: slot is free */
+	uint32_t tag;                       /* copy of owner->sessTag */
+	int      sid;                       /* TSI session ID */
+	int      keyLoaded;                 /* key sent with TSI_AES_Set_Key */
+	int      opMode;                    /* AES_MODE_xxx of Set_Mode, -1: none */
+	int      encDec;                    /* 0: decrypt, 1: encrypt */
+	uint32_t lastUse;
+} nu_aes_session_t;
+
+static nu_aes_session_t s_aes_sess[AES_SESSION_NUM];
+static uint32_t s_aes_sess_tag;
+static uint32_t s_aes_sess_clock;
 
 
 /* Implementation that should never be optimized out by the compiler */
@@ -86,17 +115,252 @@ static void mbedtls_zeroize(void *v, size_t n)
 	while(n--) *p++ = 0;
 }
 
-/* AES DMA compatible backup buffer if user buffer doesn't meet requirements
- *
- * AES DMA buffer location requires to be:
- * (1) Word-aligned
- * (2) Located in 0x2xxxxxxx region. Check linker files to ensure global variables are placed in this region.
+static void nu_aes_sess_close(nu_aes_session_t *s)
+{
+	TSI_Close_Session(C_CODE_AES, s->sid);
+	memset(s, 0, sizeof(*s));
+}
+
+static nu_aes_session_t *nu_aes_sess_find(const mbedtls_aes_context *ctx)
+{
+	int i;
+
+	if (ctx->sessTag == 0)
+		return NULL;
+
+	for (i = 0; i < AES_SESSION_NUM; i++)
+	{
+		if ((s_aes_sess[i].owner == ctx) && (s_aes_sess[i].tag == ctx->sessTag))
+			return &s_aes_sess[i];
+	}
+	return NULL;
+}
+
+static nu_aes_session_t *nu_aes_sess_lru(void)
+{
+	nu_aes_session_t *lru = NULL;
+	int i;
+
+	for (i = 0; i < AES_SESSION_NUM; i++)
+	{
+		if (s_aes_sess[i].owner == NULL)
+			continue;
+		if ((lru == NULL) || ((int32_t)(s_aes_sess[i].lastUse - lru->lastUse) < 0))
+			lru = &s_aes_sess[i];
+	}
+	return lru;
+}
+
+static int nu_aes_sess_get(mbedtls_aes_context *ctx, nu_aes_session_t **ps)
+{
+	nu_aes_session_t *s, *lru;
+	int  i, ret, sid;
+
+	s = nu_aes_sess_find(ctx);
+	if (s == NULL)
+	{
+		for (i = 0; i < AES_SESSION_NUM; i++)
+		{
+			if (s_aes_sess[i].owner == NULL)
+			{
+				s = &s_aes_sess[i];
+				break;
+			}
+		}
+		if (s == NULL)
+		{
+			s = nu_aes_sess_lru();
+			nu_aes_sess_close(s);
+		}
+
+		/* TSI sessions are shared with SHA and other users, give back our own on shortage */
+		while ((ret = TSI_Open_Session(C_CODE_AES, &sid)) == ST_NO_AVAIL_SESSION)
+		{
+			lru = nu_aes_sess_lru();
+			if (lru == NULL)
+				break;
+			nu_aes_sess_close(lru);
+		}
+		if (ret != 0)
+			return ret;
+
+		if (++s_aes_sess_tag == 0)
+			s_aes_sess_tag = 1;
+		ctx->sessTag = s_aes_sess_tag;
+		s->owner = ctx;
+		s->tag = ctx->sessTag;
+		s->sid = sid;
+		s->keyLoaded = 0;
+		s->opMode = -1;
+	}
+
+	s->lastUse = ++s_aes_sess_clock;
+	*ps = s;
+	return 0;
+}
+
+static void nu_aes_sess_drop(const mbedtls_aes_context *ctx)
+{
+	nu_aes_session_t *s = nu_aes_sess_find(ctx);
+
+	if (s != NULL)
+		nu_aes_sess_close(s);
+}
+
+static void nu_aes_error(nu_aes_session_t *s, int ret)
+{
+	sysprintf("TSI AES ERROR!!! 0x%x\n", ret);
+	TSI_Print_Error(ret);
+
+	/* Session state is unknown after a failed command */
+	if (s != NULL)
+		nu_aes_sess_close(s);
+}
+
+/* Get the context's session with key and mode loaded */
+static int nu_aes_begin(mbedtls_aes_context *ctx, int opMode, int encDec,
+						nu_aes_session_t **ps)
+{
+	nu_aes_session_t *s = NULL;
+	int  ret;
+
+	ret = nu_aes_sess_get(ctx, &s);
+	if (ret != 0)
+		goto err_out;
+
+	if (!s->keyLoaded)
+	{
+		memcpy(nc_ptr(s_u32key), ctx->keys, ctx->keySize);
+		ret = TSI_AES_Set_Key(s->sid, ctx->keySizeOp, ptr_to_u32(s_u32key));
+		if (ret != 0)
+			goto err_out;
+		s->keyLoaded = 1;
+	}
+
+	if ((s->opMode != opMode) || (s->encDec != encDec))
+	{
+		ret = TSI_AES_Set_Mode(s->sid,         /* sid        */
+							   1,              /* kinswap    */
+							   1,              /* koutswap   */
+							   1,              /* inswap     */
+							   1,              /* outswap    */
+							   0,              /* sm4en      */
+							   encDec,         /* encrypt    */
+							   opMode,         /* mode       */
+							   ctx->keySizeOp, /* keysz      */
+							   0,              /* ks         */
+							   0               /* ks_num     */
+							   );
+		if (ret != 0)
+			goto err_out;
+		s->opMode = opMode;
+		s->encDec = encDec;
+	}
+
+	*ps = s;
+	return 0;
+
+err_out:
+	nu_aes_error(s, ret);
+	return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+}
+
+/* Chaining value for the block after the last one of a run */
+static void nu_aes_next_iv(int opMode, int encDec, unsigned char iv[AES_BLOCK_SIZE],
+						   const uint8_t *lastIn, const uint8_t *lastOut, size_t blocks)
+{
+	unsigned int c;
+	int i;
+
+	switch (opMode)
+	{
+	case AES_MODE_CBC:
+	case AES_MODE_CFB:
+		memcpy(iv, encDec ? lastOut : lastIn, AES_BLOCK_SIZE);
+		break;
+	case AES_MODE_OFB:
+		for (i = 0; i < AES_BLOCK_SIZE; i++)
+			iv[i] = lastIn[i] ^ lastOut[i];
+		break;
+	case AES_MODE_CTR:
+		/* The engine steps the whole 128-bit block as a big-endian counter */
+		for (i = AES_BLOCK_SIZE - 1; i >= 0; i--)
+		{
+			c = iv[i] + (blocks & 0xFF);
+			iv[i] = (unsigned char)c;
+			blocks = (blocks >> 8) + (c >> 8);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+/* Do AES encrypt/decrypt with H/W accelerator
  *
- * AES DMA buffer size MAX_DMA_CHAIN_SIZE must be a multiple of 16-byte block size.
- * Its value is estimated to trade memory footprint off against performance.
+ * The whole buffer goes through the engine as one stream, a piece of up to
+ * MAX_DMA_CHAIN_SIZE per TSI_AES_Run. A trailing partial block is padded
+ * with zeros; only dataSize bytes are written to output, the full last
+ * output block is returned in last[] for the stream cipher modes.
  *
+ * iv is NULL for ECB, otherwise it is loaded before every piece and holds
+ * the chaining value for the next block on return.
  */
-#define MAX_DMA_CHAIN_SIZE (AES_BLOCK_SIZE*6)
+static int __nvt_aes_crypt(mbedtls_aes_context *ctx, int opMode, int encDec,
+						   unsigned char iv[AES_BLOCK_SIZE],
+						   const unsigned char *input,
+						   unsigned char *output, size_t dataSize,
+						   unsigned char last[AES_BLOCK_SIZE])
+{
+	nu_aes_session_t *s;
+	uint8_t *pin = nc_ptr(s_u8in);
+	uint8_t *pout = nc_ptr(s_u8out);
+	size_t len, blen;
+	int  ret;
+
+	ret = nu_aes_begin(ctx, opMode, encDec, &s);
+	if (ret != 0)
+		return ret;
+
+	while (dataSize > 0)
+	{
+		len = (dataSize > MAX_DMA_CHAIN_SIZE) ? MAX_DMA_CHAIN_SIZE : dataSize;
+		blen = (len + AES_BLOCK_SIZE - 1) & ~(size_t)(AES_BLOCK_SIZE - 1);
+
+		memcpy(pin, input, len);
+		if (blen != len)
+			memset(pin + len, 0, blen - len);
+
+		if (iv != NULL)
+		{
+			memcpy(nc_ptr(s_u32iv), iv, AES_BLOCK_SIZE);
+			ret = TSI_AES_Set_IV(s->sid, ptr_to_u32(s_u32iv));
+			if (ret != 0)
+				goto err_out;
+		}
+
+		ret = TSI_AES_Run(s->sid, 1, blen, ptr_to_u32(s_u8in), ptr_to_u32(s_u8out));
+		if (ret != 0)
+			goto err_out;
+
+		memcpy(output, pout, len);
+
+		if (iv != NULL)
+			nu_aes_next_iv(opMode, encDec, iv, pin + blen - AES_BLOCK_SIZE,
+						   pout + blen - AES_BLOCK_SIZE, blen / AES_BLOCK_SIZE);
+		if (last != NULL)
+			memcpy(last, pout + blen - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+
+		input += len;
+		output += len;
+		dataSize -= len;
+	}
+	return 0;
+
+err_out:
+	nu_aes_error(s, ret);
+	return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+}
 
 void mbedtls_aes_init(mbedtls_aes_context *ctx)
 {
@@ -110,6 +374,7 @@ void mbedtls_aes_free(mbedtls_aes_context *ctx)
 	if(ctx == NULL)
 		return;
 
+	nu_aes_sess_drop(ctx);
 	mbedtls_zeroize(ctx, sizeof(mbedtls_aes_context));
 }
 
@@ -119,8 +384,7 @@ void mbedtls_aes_free(mbedtls_aes_context *ctx)
 int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key,
 						   unsigned int keybits)
 {
-	unsigned int i;
-	uint8_t *pu8;
+	nu_aes_session_t *s;
 
 	AES_VALIDATE_RET(ctx != NULL);
 	AES_VALIDATE_RET(key != NULL);
@@ -143,11 +407,14 @@ int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key,
 		return(MBEDTLS_ERR_AES_INVALID_KEY_LENGTH);
 	}
 
-	pu8 = (uint8_t *)&ctx->keys[0];
+	memcpy(ctx->keys, key, ctx->keySize);
 
-	for(i = 0; i < ctx->keySize; i++)
+	/* Keep the session, reload key and mode on next use */
+	s = nu_aes_sess_find(ctx);
+	if (s != NULL)
 	{
-		pu8[i] = key[i];
+		s->keyLoaded = 0;
+		s->opMode = -1;
 	}
 
 	return(0);
@@ -159,107 +426,45 @@ int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key,
 int mbedtls_aes_setkey_dec(mbedtls_aes_context *ctx, const unsigned char *key,
 						   unsigned int keybits)
 {
-	int ret;
-
 	AES_VALIDATE_RET(ctx != NULL);
 	AES_VALIDATE_RET(key != NULL);
 
-	/* Also checks keybits */
-	if((ret = mbedtls_aes_setkey_enc(ctx, key, keybits)) != 0)
-		goto exit;
-
-exit:
-	return(ret);
+	/* The engine derives the decryption round keys itself */
+	return mbedtls_aes_setkey_enc(ctx, key, keybits);
 }
 
-/* Do AES encrypt/decrypt with H/W accelerator
- *
- * NOTE: As input/output buffer doesn't follow constraint of DMA buffer, static allocated
- *       DMA compatible buffer is used for DMA instead and this needs extra copy.
- *
- * NOTE: dataSize requires to be:
- *       1) Multiple of block size 16
- *       2) <= MAX_DMA_CHAIN_SIZE
+/*
+ * AES-ECB block encryption
  */
-static int __nvt_aes_crypt(mbedtls_aes_context *ctx,
-						   const unsigned char *input,
-						   unsigned char *output, size_t dataSize)
+int mbedtls_internal_aes_encrypt(mbedtls_aes_context *ctx,
+								 const unsigned char input[AES_BLOCK_SIZE],
+								 unsigned char output[AES_BLOCK_SIZE])
 {
-	int  ret, sid;
-
-	if(dataSize > AES_BLOCK_SIZE)
-		return -1;
-
-	memcpy(nc_ptr(s_u8in), input, dataSize);
-
-	ret = TSI_Open_Session(C_CODE_AES, &sid);
-	if (ret != 0)
-		goto err_out;
-
-	dcache_invalidate_by_mva(ctx->iv, sizeof(ctx->iv));
-
-	ret = TSI_AES_Set_IV(sid, ptr_to_u32(ctx->iv));
-	if (ret != 0)
-		goto err_out;
-
-	dcache_invalidate_by_mva(ctx->keys, ctx->keySize);
-
-	ret = TSI_AES_Set_Key(sid, ctx->keySizeOp, ptr_to_u32(ctx->keys));
-	if (ret != 0)
-		goto err_out;
-
-	ret = TSI_AES_Set_Mode(sid,             /* sid        */
-						   1,               /* kinswap    */
-						   0,               /* koutswap   */
-						   1,               /* inswap     */
-						   1,               /* outswap    */
-						   0,               /* sm4en      */
-						   ctx->encDec,     /* encrypt    */
-						   ctx->opMode,     /* mode       */
-						   ctx->keySizeOp,  /* keysz      */
-						   0,               /* ks         */
-						   0                /* ks_num     */
-						   );
-	if (ret != 0)
-		goto err_out;
-
-	ret = TSI_AES_Run(sid, 1, dataSize, ptr_to_u32(s_u8in), ptr_to_u32(s_u8out));
-	if (ret != 0)
-		goto err_out;
-
-	TSI_Close_Session(C_CODE_AES, sid);
-
-	memcpy(output, nc_ptr(s_u8out), dataSize);
-
-	return 0;
-
-err_out:
-	sysprintf("TSI AES ERROR!!! 0x%x\n", ret);
-	TSI_Close_Session(C_CODE_AES, sid);
-	TSI_Print_Error(ret);
-	return -1;
+	return __nvt_aes_crypt(ctx, AES_MODE_ECB, 1, NULL, input, output, AES_BLOCK_SIZE, NULL);
 }
 
 /*
- * AES-ECB block encryption
+ * AES-ECB block decryption
  */
+int mbedtls_internal_aes_decrypt(mbedtls_aes_context *ctx,
+								 const unsigned char input[AES_BLOCK_SIZE],
+								 unsigned char output[AES_BLOCK_SIZE])
+{
+	return __nvt_aes_crypt(ctx, AES_MODE_ECB, 0, NULL, input, output, AES_BLOCK_SIZE, NULL);
+}
+
 void mbedtls_aes_encrypt(mbedtls_aes_context *ctx,
 						 const unsigned char input[AES_BLOCK_SIZE],
 						 unsigned char output[AES_BLOCK_SIZE])
 {
-	ctx->encDec = 1;
-	__nvt_aes_crypt(ctx, input, output, AES_BLOCK_SIZE);
+	mbedtls_internal_aes_encrypt(ctx, input, output);
 }
 
-/*
- * AES-ECB block decryption
- */
 void mbedtls_aes_decrypt(mbedtls_aes_context *ctx,
 						 const unsigned char input[AES_BLOCK_SIZE],
 						 unsigned char output[AES_BLOCK_SIZE])
 {
-	ctx->encDec = 0;
-	__nvt_aes_crypt(ctx, input, output, AES_BLOCK_SIZE);
+	mbedtls_internal_aes_decrypt(ctx, input, output);
 }
 
 /*
@@ -277,14 +482,10 @@ int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx,
 	AES_VALIDATE_RET(mode == MBEDTLS_AES_ENCRYPT ||
 		mode == MBEDTLS_AES_DECRYPT);
 
-	ctx->opMode = AES_MODE_ECB;
 	if(mode == MBEDTLS_AES_ENCRYPT)
-		mbedtls_aes_encrypt(ctx, input, output);
+		return mbedtls_internal_aes_encrypt(ctx, input, output);
 	else
-		mbedtls_aes_decrypt(ctx, input, output);
-
-
-	return(0);
+		return mbedtls_internal_aes_decrypt(ctx, input, output);
 }
 
 #if defined(MBEDTLS_CIPHER_MODE_CBC)
@@ -293,82 +494,33 @@ int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx,
  */
 int mbedtls_aes_crypt_cbc(mbedtls_aes_context *ctx,
 						  int mode,
-						  size_t len,
+						  size_t length,
 						  unsigned char iv[AES_BLOCK_SIZE],
 						  const unsigned char *input,
 						  unsigned char *output)
 {
-	int  ret, sid;
-
-	ctx->opMode = AES_MODE_CBC;
-
-	if (mode == MBEDTLS_AES_ENCRYPT)
-		ctx->encDec = 1;
-	else
-		ctx->encDec = 0;
-
-	/* Fetch IV byte data in little-endian */
-	ctx->iv[0] = nu_get32_le(iv);
-	ctx->iv[1] = nu_get32_le(iv + 4);
-	ctx->iv[2] = nu_get32_le(iv + 8);
-	ctx->iv[3] = nu_get32_le(iv + 12);
-
-	ret = TSI_Open_Session(C_CODE_AES, &sid);
-	if (ret != 0)
-		goto err_out;
-
-	dcache_invalidate_by_mva(ctx->iv, sizeof(ctx->iv));
-
-	ret = TSI_AES_Set_IV(sid, ptr_to_u32(ctx->iv));
-	if (ret != 0)
-		goto err_out;
-
-	dcache_invalidate_by_mva(ctx->keys, ctx->keySize);
-	ret = TSI_AES_Set_Key(sid, ctx->keySizeOp, ptr_to_u32(ctx->keys));
-	if (ret != 0)
-		goto err_out;
-
-	ret = TSI_AES_Set_Mode(sid,             /* sid        */
-						   1,               /* kinswap    */
-						   1,               /* koutswap   */
-						   1,               /* inswap     */
-						   1,               /* outswap    */
-						   0,               /* sm4en      */
-						   ctx->encDec,     /* encrypt    */
-						   ctx->opMode,     /* mode       */
-						   ctx->keySizeOp,  /* keysz      */
-						   0,               /* ks         */
-						   0                /* ks_num     */
-						   );
-	if (ret != 0)
-		goto err_out;
-
-	memcpy(nc_ptr(s_u8in), input, len);
-
-	ret = TSI_AES_Run(sid, 1, len, ptr_to_u32(s_u8in), ptr_to_u32(s_u8out));
-	if (ret != 0)
-		goto err_out;
-
-	TSI_Close_Session(C_CODE_AES, sid);
-
-	if (mode == MBEDTLS_AES_ENCRYPT)
-		memcpy(iv, nc_ptr(s_u8out), 16);
-	else
-		memcpy(iv, input, 16);
+	AES_VALIDATE_RET(ctx != NULL);
+	AES_VALIDATE_RET(mode == MBEDTLS_AES_ENCRYPT ||
+		mode == MBEDTLS_AES_DECRYPT);
+	AES_VALIDATE_RET(iv != NULL);
+	AES_VALIDATE_RET(input != NULL);
+	AES_VALIDATE_RET(output != NULL);
 
-	memcpy(output, nc_ptr(s_u8out), len);
+	if(length % AES_BLOCK_SIZE)
+		return(MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH);
 
-	return 0;
+	if(length == 0)
+		return(0);
 
-err_out:
-	sysprintf("TSI AES ERROR!!! 0x%x\n", ret);
-	TSI_Close_Session(C_CODE_AES, sid);
-	TSI_Print_Error(ret);
-	return -1;
+	return __nvt_aes_crypt(ctx, AES_MODE_CBC, (mode == MBEDTLS_AES_ENCRYPT),
+						   iv, input, output, length, NULL);
 }
 #endif /* MBEDTLS_CIPHER_MODE_CBC */
 
 #if defined(MBEDTLS_CIPHER_MODE_CFB)
+/*
+ * AES-CFB128 buffer encryption/decryption
+ */
 int mbedtls_aes_crypt_cfb128(mbedtls_aes_context *ctx,
 							 int mode,
 							 size_t length,
@@ -377,72 +529,60 @@ int mbedtls_aes_crypt_cfb128(mbedtls_aes_context *ctx,
 							 const unsigned char *input,
 							 unsigned char *output)
 {
-	int  ret, sid;
-
-	ctx->opMode = AES_MODE_CFB;
-
-	if (mode == MBEDTLS_AES_ENCRYPT)
-		ctx->encDec = 1;
-	else
-		ctx->encDec = 0;
-
-	/* Fetch IV byte data in little-endian */
-	ctx->iv[0] = nu_get32_le(iv);
-	ctx->iv[1] = nu_get32_le(iv + 4);
-	ctx->iv[2] = nu_get32_le(iv + 8);
-	ctx->iv[3] = nu_get32_le(iv + 12);
-
-	ret = TSI_Open_Session(C_CODE_AES, &sid);
-	if (ret != 0)
-		goto err_out;
-
-	dcache_invalidate_by_mva(ctx->iv, sizeof(ctx->iv));
-
-	ret = TSI_AES_Set_IV(sid, ptr_to_u32(ctx->iv));
-	if (ret != 0)
-		goto err_out;
-
-	dcache_invalidate_by_mva(ctx->keys, ctx->keySize);
-	ret = TSI_AES_Set_Key(sid, ctx->keySizeOp, ptr_to_u32(ctx->keys));
-	if (ret != 0)
-		goto err_out;
-
-	ret = TSI_AES_Set_Mode(sid,             /* sid        */
-						   1,               /* kinswap    */
-						   1,               /* koutswap   */
-						   1,               /* inswap     */
-						   1,               /* outswap    */
-						   0,               /* sm4en      */
-						   ctx->encDec,     /* encrypt    */
-						   ctx->opMode,     /* mode       */
-						   ctx->keySizeOp,  /* keysz      */
-						   0,               /* ks         */
-						   0                /* ks_num     */
-						   );
-	if (ret != 0)
-		goto err_out;
+	unsigned char last[AES_BLOCK_SIZE];
+	unsigned char c;
+	size_t n, tail;
+	int  ret;
 
-	memcpy(nc_ptr(s_u8in), input, length);
+	AES_VALIDATE_RET(ctx != NULL);
+	AES_VALIDATE_RET(mode == MBEDTLS_AES_ENCRYPT ||
+		mode == MBEDTLS_AES_DECRYPT);
+	AES_VALIDATE_RET(iv_off != NULL);
+	AES_VALIDATE_RET(iv != NULL);
+	AES_VALIDATE_RET(input != NULL);
+	AES_VALIDATE_RET(output != NULL);
 
-	ret = TSI_AES_Run(sid, 1, length, ptr_to_u32(s_u8in), ptr_to_u32(s_u8out));
-	if (ret != 0)
-		goto err_out;
+	n = *iv_off;
+	if(n > 15)
+		return(MBEDTLS_ERR_AES_BAD_INPUT_DATA);
 
-	memcpy(output, nc_ptr(s_u8out), length);
+	/* Finish the block left over from the previous call in software */
+	while((n != 0) && (length > 0))
+	{
+		c = *input++;
+		*output = (unsigned char)(c ^ iv[n]);
+		iv[n] = (mode == MBEDTLS_AES_ENCRYPT) ? *output : c;
+		output++;
+		length--;
+		n = (n + 1) & 0x0F;
+	}
 
-	TSI_Close_Session(C_CODE_AES, sid);
-	return 0;
+	if(length > 0)
+	{
+		tail = length % AES_BLOCK_SIZE;
+		ret = __nvt_aes_crypt(ctx, AES_MODE_CFB, (mode == MBEDTLS_AES_ENCRYPT),
+							  iv, input, output, length, last);
+		if(ret != 0)
+			return ret;
+
+		/* Partial last block: the feedback register holds the cipher text
+		 * bytes seen so far followed by the rest of the key stream block,
+		 * which is what the engine output for the zero padding. */
+		if((tail != 0) && (mode == MBEDTLS_AES_DECRYPT))
+			memcpy(iv + tail, last + tail, AES_BLOCK_SIZE - tail);
+		n = tail;
+	}
 
-err_out:
-	sysprintf("TSI AES ERROR!!! 0x%x\n", ret);
-	TSI_Close_Session(C_CODE_AES, sid);
-	TSI_Print_Error(ret);
-	return -1;
+	*iv_off = n;
+	return(0);
 }
 
-
 /*
  * AES-CFB8 buffer encryption/decryption
+ *
+ * Encryption feeds every cipher text byte back into the next block, so it
+ * runs one ECB block per byte on the cached session. Decryption knows all
+ * shift register values up front and runs them as ECB blocks in bulk.
  */
 int mbedtls_aes_crypt_cfb8(mbedtls_aes_context *ctx,
 						   int mode,
@@ -451,8 +591,12 @@ int mbedtls_aes_crypt_cfb8(mbedtls_aes_context *ctx,
 						   const unsigned char *input,
 						   unsigned char *output)
 {
-	unsigned char c;
-	unsigned char ov[AES_BLOCK_SIZE + 1];
+	nu_aes_session_t *s;
+	unsigned char ks[AES_BLOCK_SIZE];
+	uint8_t *pin = nc_ptr(s_u8in);
+	uint8_t *pout = nc_ptr(s_u8out);
+	size_t i, len;
+	int  ret;
 
 	AES_VALIDATE_RET(ctx != NULL);
 	AES_VALIDATE_RET(mode == MBEDTLS_AES_ENCRYPT ||
@@ -461,20 +605,49 @@ int mbedtls_aes_crypt_cfb8(mbedtls_aes_context *ctx,
 	AES_VALIDATE_RET(input != NULL);
 	AES_VALIDATE_RET(output != NULL);
 
-	while(length--)
+	if(mode == MBEDTLS_AES_ENCRYPT)
+	{
+		while(length--)
+		{
+			ret = __nvt_aes_crypt(ctx, AES_MODE_ECB, 1, NULL, iv, ks, AES_BLOCK_SIZE, NULL);
+			if(ret != 0)
+				return ret;
+
+			memmove(iv, iv + 1, AES_BLOCK_SIZE - 1);
+			iv[AES_BLOCK_SIZE - 1] = *output++ = (unsigned char)(ks[0] ^ *input++);
+		}
+		return(0);
+	}
+
+	while(length > 0)
 	{
-		memcpy(ov, iv, AES_BLOCK_SIZE);
-		mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, iv, iv);
+		len = (length > MAX_DMA_CHAIN_SIZE / AES_BLOCK_SIZE) ?
+			  MAX_DMA_CHAIN_SIZE / AES_BLOCK_SIZE : length;
 
-		if(mode == MBEDTLS_AES_DECRYPT)
-			ov[AES_BLOCK_SIZE] = *input;
+		for(i = 0; i < len; i++)
+		{
+			memcpy(pin + i * AES_BLOCK_SIZE, iv, AES_BLOCK_SIZE);
+			memmove(iv, iv + 1, AES_BLOCK_SIZE - 1);
+			iv[AES_BLOCK_SIZE - 1] = input[i];
+		}
 
-		c = *output++ = (unsigned char)(iv[0] ^ *input++);
+		ret = nu_aes_begin(ctx, AES_MODE_ECB, 1, &s);
+		if(ret != 0)
+			return ret;
 
-		if(mode == MBEDTLS_AES_ENCRYPT)
-			ov[AES_BLOCK_SIZE] = c;
+		ret = TSI_AES_Run(s->sid, 1, len * AES_BLOCK_SIZE, ptr_to_u32(s_u8in), ptr_to_u32(s_u8out));
+		if(ret != 0)
+		{
+			nu_aes_error(s, ret);
+			return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+		}
 
-		memcpy(iv, ov + 1, AES_BLOCK_SIZE);
+		for(i = 0; i < len; i++)
+			output[i] = (unsigned char)(input[i] ^ pout[i * AES_BLOCK_SIZE]);
+
+		input += len;
+		output += len;
+		length -= len;
 	}
 
 	return(0);
@@ -493,8 +666,9 @@ int mbedtls_aes_crypt_ctr(mbedtls_aes_context *ctx,
 						  const unsigned char *input,
 						  unsigned char *output)
 {
-	int c, i;
-	size_t n = *nc_off;
+	unsigned char lastIn[AES_BLOCK_SIZE];
+	size_t i, n, k;
+	int  ret;
 
 	AES_VALIDATE_RET(ctx != NULL);
 	AES_VALIDATE_RET(nc_off != NULL);
@@ -503,22 +677,36 @@ int mbedtls_aes_crypt_ctr(mbedtls_aes_context *ctx,
 	AES_VALIDATE_RET(input != NULL);
 	AES_VALIDATE_RET(output != NULL);
 
-	while(length--)
-	{
-		if(n == 0)
-		{
-			mbedtls_aes_crypt_ecb(ctx, MBEDTLS_AES_ENCRYPT, nonce_counter, stream_block);
-
-			for(i = AES_BLOCK_SIZE; i > 0; i--)
-				if(++nonce_counter[i - 1] != 0)
-					break;
-		}
-		c = *input++;
-		*output++ = (unsigned char)(c ^ stream_block[n]);
+	n = *nc_off;
+	if(n > 0x0F)
+		return(MBEDTLS_ERR_AES_BAD_INPUT_DATA);
 
+	/* Use up the key stream left over from the previous call */
+	while((n != 0) && (length > 0))
+	{
+		*output++ = (unsigned char)(*input++ ^ stream_block[n]);
+		length--;
 		n = (n + 1) & 0x0F;
 	}
 
+	if(length > 0)
+	{
+		/* Engine output of the last block is key stream XOR input, where
+		 * the input beyond a partial block is the zero padding. Keep the
+		 * input bytes, output may overwrite them. */
+		n = length % AES_BLOCK_SIZE;
+		k = n ? n : AES_BLOCK_SIZE;
+		memcpy(lastIn, input + length - k, k);
+
+		ret = __nvt_aes_crypt(ctx, AES_MODE_CTR, 1, nonce_counter,
+							  input, output, length, stream_block);
+		if(ret != 0)
+			return ret;
+
+		for(i = 0; i < k; i++)
+			stream_block[i] ^= lastIn[i];
+	}
+
 	*nc_off = n;
 
 	return(0);
@@ -527,7 +715,7 @@ int mbedtls_aes_crypt_ctr(mbedtls_aes_context *ctx,
 
 #if defined(MBEDTLS_CIPHER_MODE_OFB)
 /*
- * AES-CTR buffer encryption/decryption
+ * AES-OFB buffer encryption/decryption
  */
 int mbedtls_aes_crypt_ofb(mbedtls_aes_context* ctx,
 						  size_t length,
@@ -536,89 +724,117 @@ int mbedtls_aes_crypt_ofb(mbedtls_aes_context* ctx,
 						  const unsigned char* input,
 						  unsigned char* output)
 {
-	int  ret, sid;
+	size_t n;
+	int  ret;
 
-	if(length == 0)
-	{
-		/* Just do nothing */
-		return (0);
-	}
+	AES_VALIDATE_RET(ctx != NULL);
+	AES_VALIDATE_RET(iv_off != NULL);
+	AES_VALIDATE_RET(iv != NULL);
+	AES_VALIDATE_RET(input != NULL);
+	AES_VALIDATE_RET(output != NULL);
 
-	if((ctx == NULL) || (iv == NULL) || (input == NULL) || (output == NULL))
-	{
-		return MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH;
-	}
+	n = *iv_off;
+	if(n > 15)
+		return(MBEDTLS_ERR_AES_BAD_INPUT_DATA);
 
-	if((iv_off != NULL) && (*iv_off != 0))
+	/* iv holds the current key stream block */
+	while((n != 0) && (length > 0))
 	{
-		/* only support iv_off == 0 */
-		return MBEDTLS_ERR_AES_INVALID_INPUT_LENGTH;
+		*output++ = (unsigned char)(*input++ ^ iv[n]);
+		length--;
+		n = (n + 1) & 0x0F;
 	}
 
-
-	if(*iv_off != 0)
+	if(length > 0)
 	{
-		sysprintf("iv_off is not zero!\n");
-
+		ret = __nvt_aes_crypt(ctx, AES_MODE_OFB, 1, iv, input, output, length, NULL);
+		if(ret != 0)
+			return ret;
+		n = length % AES_BLOCK_SIZE;
 	}
 
-	ctx->opMode = AES_MODE_OFB;
-	ctx->encDec = 1;
+	*iv_off = n;
+	return 0;
+}
+#endif /* MBEDTLS_CIPHER_MODE_OFB */
+
+/*
+ * AEAD pass through TSI_AES_GCM_Run, shared by gcm_alt.c and ccm_alt.c
+ *
+ * info holds the formatted header blocks (GCM: IV and AAD, CCM: B0 and
+ * AAD), hdr[] the first three words of the TSI parameter block. ctr0 is
+ * the CCM initial counter block, NULL for GCM. The payload is streamed in
+ * AEAD_DMA_CHAIN_SIZE runs behind the header, the last run is flagged and
+ * returns the 16-byte tag.
+ */
+int nu_aes_aead_crypt(mbedtls_aes_context *ctx, int opMode, int encDec,
+					  const unsigned char ctr0[AES_BLOCK_SIZE],
+					  const unsigned char *info, size_t infoLen,
+					  const uint32_t hdr[3],
+					  const unsigned char *input, unsigned char *output,
+					  size_t length, unsigned char tag[AES_BLOCK_SIZE])
+{
+	nu_aes_session_t *s;
+	uint8_t *pin = nc_ptr(s_u8AeadIn);
+	uint8_t *pout = nc_ptr(s_u8AeadOut);
+	uint32_t *param = nc_ptr(s_u32AeadParam);
+	size_t off, len, blen, hlen;
+	int  last, ret;
 
-	/* Fetch IV byte data in little-endian */
-	ctx->iv[0] = nu_get32_le(iv);
-	ctx->iv[1] = nu_get32_le(iv + 4);
-	ctx->iv[2] = nu_get32_le(iv + 8);
-	ctx->iv[3] = nu_get32_le(iv + 12);
+	if((infoLen > NU_AES_AEAD_INFO_MAX) || (infoLen % AES_BLOCK_SIZE))
+		return MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
 
-	ret = TSI_Open_Session(C_CODE_AES, &sid);
-	if (ret != 0)
-		goto err_out;
+	ret = nu_aes_begin(ctx, opMode, encDec, &s);
+	if(ret != 0)
+		return ret;
 
-	dcache_invalidate_by_mva(ctx->iv, sizeof(ctx->iv));
+	if(ctr0 != NULL)
+	{
+		memcpy(nc_ptr(s_u32iv), ctr0, AES_BLOCK_SIZE);
+		ret = TSI_AES_Set_IV(s->sid, ptr_to_u32(s_u32iv));
+		if(ret != 0)
+			goto err_out;
+	}
 
-	ret = TSI_AES_Set_IV(sid, ptr_to_u32(ctx->iv));
-	if (ret != 0)
-		goto err_out;
+	param[0] = hdr[0];
+	param[1] = hdr[1];
+	param[2] = hdr[2];
+	param[3] = ptr_to_u32(s_u8AeadIn);
+	param[4] = ptr_to_u32(s_u8AeadOut);
 
-	dcache_invalidate_by_mva(ctx->keys, ctx->keySize);
-	ret = TSI_AES_Set_Key(sid, ctx->keySizeOp, ptr_to_u32(ctx->keys));
-	if (ret != 0)
-		goto err_out;
+	memcpy(pin, info, infoLen);
+	hlen = infoLen;
+	off = 0;
+	do
+	{
+		len = length - off;
+		if(len > AEAD_DMA_CHAIN_SIZE)
+			len = AEAD_DMA_CHAIN_SIZE;
+		blen = (len + AES_BLOCK_SIZE - 1) & ~(size_t)(AES_BLOCK_SIZE - 1);
+		last = (off + len == length);
 
-	ret = TSI_AES_Set_Mode(sid,             /* sid        */
-						   1,               /* kinswap    */
-						   1,               /* koutswap   */
-						   1,               /* inswap     */
-						   1,               /* outswap    */
-						   0,               /* sm4en      */
-						   ctx->encDec,     /* encrypt    */
-						   ctx->opMode,     /* mode       */
-						   ctx->keySizeOp,  /* keysz      */
-						   0,               /* ks         */
-						   0                /* ks_num     */
-						   );
-	if (ret != 0)
-		goto err_out;
+		memcpy(pin + hlen, input + off, len);
+		if(blen != len)
+			memset(pin + hlen + len, 0, blen - len);
 
-	memcpy(nc_ptr(s_u8in), input, length);
+		ret = TSI_AES_GCM_Run(s->sid, last, hlen + blen, ptr_to_u32(s_u32AeadParam));
+		if(ret != 0)
+			goto err_out;
 
-	ret = TSI_AES_Run(sid, 1, length, ptr_to_u32(s_u8in), ptr_to_u32(s_u8out));
-	if (ret != 0)
-		goto err_out;
+		memcpy(output + off, pout, len);
+		off += len;
 
-	memcpy(output, nc_ptr(s_u8out), length);
+		/* Later runs carry payload only */
+		hlen = 0;
+	} while(!last);
 
-	TSI_Close_Session(C_CODE_AES, sid);
+	memcpy(tag, pout + blen, AES_BLOCK_SIZE);
 	return 0;
 
 err_out:
-	sysprintf("TSI AES ERROR!!! 0x%x\n", ret);
-	TSI_Close_Session(C_CODE_AES, sid);
-	TSI_Print_Error(ret);
-	return -1;
+	nu_aes_error(s, ret);
+	return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
 }
-#endif /* MBEDTLS_CIPHER_MODE_OFB */
 
 #endif /* MBEDTLS_AES_ALT */
 
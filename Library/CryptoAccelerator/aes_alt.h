@@ -39,9 +39,7 @@ extern "C" {
 typedef struct {
     uint32_t keySize;       /* Key size: 128/192/256 */
     uint32_t keySizeOp;     /* AES_KEY_SIZE_128/192/256 */
-    uint32_t encDec;        /* 0: decrypt, 1: encrypt */
-    uint32_t opMode;        /* AES_MODE_ECB/CBC/CFB */
-    uint32_t iv[4];         /* IV for next block cipher */
+    uint32_t sessTag;       /* Tag of the cached TSI session, 0: none */
     uint32_t keys[8];       /* Cipher key */
 
     int MBEDTLS_PRIVATE(nr);             /*!< The number of rounds. */
@@ -269,6 +267,40 @@ void mbedtls_aes_decrypt( mbedtls_aes_context *ctx,
                           const unsigned char input[16],
                           unsigned char output[16] );
 
+/**
+ * \brief          Largest formatted GCM/CCM header (IV or B0 block plus
+ *                 padded AAD) that nu_aes_aead_crypt() takes in one run
+ */
+#define NU_AES_AEAD_INFO_MAX    256
+
+/**
+ * \brief          AEAD operation with TSI_AES_GCM_Run, used by the GCM and
+ *                 CCM ALT modules on the context's cached TSI session
+ *
+ * \param ctx      AES context holding the key
+ * \param opMode   AES_MODE_GCM or AES_MODE_CCM
+ * \param encDec   1: encrypt, 0: decrypt
+ * \param ctr0     CCM initial counter block, NULL for GCM
+ * \param info     formatted header blocks
+ * \param infoLen  header length, a multiple of 16 up to NU_AES_AEAD_INFO_MAX
+ * \param hdr      words 0..2 of the TSI parameter block
+ * \param input    payload
+ * \param output   processed payload, may be the same as input
+ * \param length   payload length
+ * \param tag      16-byte tag computed by the engine
+ *
+ * \return         0 if successful,
+ *                 MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED if the header
+ *                 does not fit, MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED on
+ *                 a TSI error
+ */
+int nu_aes_aead_crypt( mbedtls_aes_context *ctx, int opMode, int encDec,
+                       const unsigned char ctr0[16],
+                       const unsigned char *info, size_t infoLen,
+                       const uint32_t hdr[3],
+                       const unsigned char *input, unsigned char *output,
+                       size_t length, unsigned char tag[16] );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,698 @@
+/*
+ * Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ * Copyright (C) 2023, Nuvoton Technology Corporation, All Rights Reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Definition of CCM:
+ * http://csrc.nist.gov/publications/nistpubs/800-38C/SP800-38C_updated-July20_2007.pdf
+ * RFC 3610 "Counter with CBC-MAC (CCM)"
+ *
+ * The one-shot functions with an AES key and a tag are done by the TSI in
+ * one TSI_AES_GCM_Run per record in CCM mode, see SampleCode/TSI/TSI_AES_CCM.
+ * CCM* without tag, the streaming API and other ciphers keep the software
+ * CBC-MAC of ccm.c, with the AES blocks still done by the TSI.
+ */
+
+#include "common.h"
+
+#include "mbedtls/ccm.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/error.h"
+
+#if defined(MBEDTLS_CCM_C)
+#if defined(MBEDTLS_CCM_ALT)
+
+#include <string.h>
+#include "NuMicro.h"
+#include "tsi_cmd.h"
+
+#define CCM_BLOCK_SIZE  (16)
+
+#define CCM_PAD(n)      (((n) + CCM_BLOCK_SIZE - 1) & ~(size_t)(CCM_BLOCK_SIZE - 1))
+
+/*
+ * Initialize context
+ */
+void mbedtls_ccm_init(mbedtls_ccm_context *ctx)
+{
+	memset(ctx, 0, sizeof(mbedtls_ccm_context));
+}
+
+/* Encrypt one block with the key of the context */
+static int nu_ccm_block(mbedtls_ccm_context *ctx, const unsigned char input[16],
+						unsigned char output[16])
+{
+	size_t olen = 0;
+
+	if (ctx->isAes)
+		return mbedtls_aes_crypt_ecb(&ctx->aes, MBEDTLS_AES_ENCRYPT, input, output);
+
+	return mbedtls_cipher_update(&ctx->cipher_ctx, input, 16, output, &olen);
+}
+
+int mbedtls_ccm_setkey(mbedtls_ccm_context *ctx,
+					   mbedtls_cipher_id_t cipher,
+					   const unsigned char *key,
+					   unsigned int keybits)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	const mbedtls_cipher_info_t *cipher_info;
+
+	cipher_info = mbedtls_cipher_info_from_values(cipher, keybits,
+												  MBEDTLS_MODE_ECB);
+	if (cipher_info == NULL)
+		return(MBEDTLS_ERR_CCM_BAD_INPUT);
+
+	if (cipher_info->block_size != 16)
+		return(MBEDTLS_ERR_CCM_BAD_INPUT);
+
+	mbedtls_cipher_free(&ctx->cipher_ctx);
+
+	if (cipher == MBEDTLS_CIPHER_ID_AES)
+	{
+		ctx->isAes = 1;
+		return mbedtls_aes_setkey_enc(&ctx->aes, key, keybits);
+	}
+
+	ctx->isAes = 0;
+	if ((ret = mbedtls_cipher_setup(&ctx->cipher_ctx, cipher_info)) != 0)
+		return(ret);
+
+	if ((ret = mbedtls_cipher_setkey(&ctx->cipher_ctx, key, keybits,
+									 MBEDTLS_ENCRYPT)) != 0)
+	{
+		return(ret);
+	}
+
+	return(0);
+}
+
+/*
+ * Free context
+ */
+void mbedtls_ccm_free(mbedtls_ccm_context *ctx)
+{
+	if (ctx == NULL)
+		return;
+	mbedtls_aes_free(&ctx->aes);
+	mbedtls_cipher_free(&ctx->cipher_ctx);
+	mbedtls_platform_zeroize(ctx, sizeof(mbedtls_ccm_context));
+}
+
+#define CCM_STATE__CLEAR                0
+#define CCM_STATE__STARTED              (1 << 0)
+#define CCM_STATE__LENGHTS_SET          (1 << 1)
+#define CCM_STATE__AUTH_DATA_STARTED    (1 << 2)
+#define CCM_STATE__AUTH_DATA_FINISHED   (1 << 3)
+#define CCM_STATE__ERROR                (1 << 4)
+
+/*
+ * Encrypt or decrypt a partial block with CTR
+ */
+static int mbedtls_ccm_crypt(mbedtls_ccm_context *ctx,
+							 size_t offset, size_t use_len,
+							 const unsigned char *input,
+							 unsigned char *output)
+{
+	size_t i;
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	unsigned char tmp_buf[16] = {0};
+
+	if ((ret = nu_ccm_block(ctx, ctx->ctr, tmp_buf)) != 0)
+	{
+		ctx->state |= CCM_STATE__ERROR;
+		mbedtls_platform_zeroize(tmp_buf, sizeof(tmp_buf));
+		return ret;
+	}
+
+	for (i = 0; i < use_len; i++)
+		output[i] = input[i] ^ tmp_buf[offset + i];
+
+	mbedtls_platform_zeroize(tmp_buf, sizeof(tmp_buf));
+	return ret;
+}
+
+static void mbedtls_ccm_clear_state(mbedtls_ccm_context *ctx)
+{
+	ctx->state = CCM_STATE__CLEAR;
+	memset(ctx->y, 0, 16);
+	memset(ctx->ctr, 0, 16);
+}
+
+static int ccm_calculate_first_block_if_ready(mbedtls_ccm_context *ctx)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	unsigned char i;
+	size_t len_left;
+
+	/* length calulcation can be done only after both
+	 * mbedtls_ccm_starts() and mbedtls_ccm_set_lengths() have been executed
+	 */
+	if (!(ctx->state & CCM_STATE__STARTED) || !(ctx->state & CCM_STATE__LENGHTS_SET))
+		return 0;
+
+	/* CCM expects non-empty tag.
+	 * CCM* allows empty tag. For CCM* without tag, ignore plaintext length.
+	 */
+	if (ctx->tag_len == 0)
+	{
+		if (ctx->mode == MBEDTLS_CCM_STAR_ENCRYPT || ctx->mode == MBEDTLS_CCM_STAR_DECRYPT)
+		{
+			ctx->plaintext_len = 0;
+		}
+		else
+		{
+			return(MBEDTLS_ERR_CCM_BAD_INPUT);
+		}
+	}
+
+	/*
+	 * First block:
+	 * 0        .. 0        flags
+	 * 1        .. iv_len   nonce (aka iv)  - set by: mbedtls_ccm_starts()
+	 * iv_len+1 .. 15       length
+	 *
+	 * With flags as (bits):
+	 * 7        0
+	 * 6        add present?
+	 * 5 .. 3   (t - 2) / 2
+	 * 2 .. 0   q - 1
+	 */
+	ctx->y[0] |= (ctx->add_len > 0) << 6;
+	ctx->y[0] |= ((ctx->tag_len - 2) / 2) << 3;
+	ctx->y[0] |= ctx->q - 1;
+
+	for (i = 0, len_left = ctx->plaintext_len; i < ctx->q; i++, len_left >>= 8)
+		ctx->y[15 - i] = MBEDTLS_BYTE_0(len_left);
+
+	if (len_left > 0)
+	{
+		ctx->state |= CCM_STATE__ERROR;
+		return(MBEDTLS_ERR_CCM_BAD_INPUT);
+	}
+
+	/* Start CBC-MAC with first block*/
+	if ((ret = nu_ccm_block(ctx, ctx->y, ctx->y)) != 0)
+	{
+		ctx->state |= CCM_STATE__ERROR;
+		return(ret);
+	}
+
+	return (0);
+}
+
+int mbedtls_ccm_starts(mbedtls_ccm_context *ctx,
+					   int mode,
+					   const unsigned char *iv,
+					   size_t iv_len)
+{
+	/* Also implies q is within bounds */
+	if (iv_len < 7 || iv_len > 13)
+		return(MBEDTLS_ERR_CCM_BAD_INPUT);
+
+	ctx->mode = mode;
+	ctx->q = 16 - 1 - (unsigned char) iv_len;
+
+	/*
+	 * Prepare counter block for encryption:
+	 * 0        .. 0        flags
+	 * 1        .. iv_len   nonce (aka iv)
+	 * iv_len+1 .. 15       counter (initially 1)
+	 *
+	 * With flags as (bits):
+	 * 7 .. 3   0
+	 * 2 .. 0   q - 1
+	 */
+	memset(ctx->ctr, 0, 16);
+	ctx->ctr[0] = ctx->q - 1;
+	memcpy(ctx->ctr + 1, iv, iv_len);
+	memset(ctx->ctr + 1 + iv_len, 0, ctx->q);
+	ctx->ctr[15] = 1;
+
+	/*
+	 * See ccm_calculate_first_block_if_ready() for block layout description
+	 */
+	memcpy(ctx->y + 1, iv, iv_len);
+
+	ctx->state |= CCM_STATE__STARTED;
+	return ccm_calculate_first_block_if_ready(ctx);
+}
+
+int mbedtls_ccm_set_lengths(mbedtls_ccm_context *ctx,
+							size_t total_ad_len,
+							size_t plaintext_len,
+							size_t tag_len)
+{
+	/*
+	 * Check length requirements: SP800-38C A.1
+	 * Additional requirement: a < 2^16 - 2^8 to simplify the code.
+	 * 'length' checked later (when writing it to the first block)
+	 *
+	 * Also, loosen the requirements to enable support for CCM* (IEEE 802.15.4).
+	 */
+	if (tag_len == 2 || tag_len > 16 || tag_len % 2 != 0)
+		return(MBEDTLS_ERR_CCM_BAD_INPUT);
+
+	if (total_ad_len >= 0xFF00)
+		return(MBEDTLS_ERR_CCM_BAD_INPUT);
+
+	ctx->plaintext_len = plaintext_len;
+	ctx->add_len = total_ad_len;
+	ctx->tag_len = tag_len;
+	ctx->processed = 0;
+
+	ctx->state |= CCM_STATE__LENGHTS_SET;
+	return ccm_calculate_first_block_if_ready(ctx);
+}
+
+int mbedtls_ccm_update_ad(mbedtls_ccm_context *ctx,
+						  const unsigned char *add,
+						  size_t add_len)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	unsigned char i;
+	size_t use_len, offset;
+
+	if (ctx->state & CCM_STATE__ERROR)
+	{
+		return MBEDTLS_ERR_CCM_BAD_INPUT;
+	}
+
+	if (add_len > 0)
+	{
+		if (ctx->state & CCM_STATE__AUTH_DATA_FINISHED)
+		{
+			return MBEDTLS_ERR_CCM_BAD_INPUT;
+		}
+
+		if (!(ctx->state & CCM_STATE__AUTH_DATA_STARTED))
+		{
+			if (add_len > ctx->add_len)
+			{
+				return MBEDTLS_ERR_CCM_BAD_INPUT;
+			}
+
+			ctx->y[0] ^= (unsigned char)((ctx->add_len >> 8) & 0xFF);
+			ctx->y[1] ^= (unsigned char)((ctx->add_len) & 0xFF);
+
+			ctx->state |= CCM_STATE__AUTH_DATA_STARTED;
+		}
+		else if (ctx->processed + add_len > ctx->add_len)
+		{
+			return MBEDTLS_ERR_CCM_BAD_INPUT;
+		}
+
+		while (add_len > 0)
+		{
+			offset = (ctx->processed + 2) % 16; /* account for y[0] and y[1]
+												 * holding total auth data length */
+			use_len = 16 - offset;
+
+			if (use_len > add_len)
+				use_len = add_len;
+
+			for (i = 0; i < use_len; i++)
+				ctx->y[i + offset] ^= add[i];
+
+			ctx->processed += use_len;
+			add_len -= use_len;
+			add += use_len;
+
+			if (use_len + offset == 16 || ctx->processed == ctx->add_len)
+			{
+				if ((ret = nu_ccm_block(ctx, ctx->y, ctx->y)) != 0)
+				{
+					ctx->state |= CCM_STATE__ERROR;
+					return(ret);
+				}
+			}
+		}
+
+		if (ctx->processed == ctx->add_len)
+		{
+			ctx->state |= CCM_STATE__AUTH_DATA_FINISHED;
+			ctx->processed = 0; // prepare for mbedtls_ccm_update()
+		}
+	}
+
+	return (0);
+}
+
+int mbedtls_ccm_update(mbedtls_ccm_context *ctx,
+					   const unsigned char *input, size_t input_len,
+					   unsigned char *output, size_t output_size,
+					   size_t *output_len)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	unsigned char i;
+	size_t use_len, offset;
+
+	unsigned char local_output[16];
+
+	if (ctx->state & CCM_STATE__ERROR)
+	{
+		return MBEDTLS_ERR_CCM_BAD_INPUT;
+	}
+
+	/* Check against plaintext length only if performing operation with
+	 * authentication
+	 */
+	if (ctx->tag_len != 0 && ctx->processed + input_len > ctx->plaintext_len)
+	{
+		return MBEDTLS_ERR_CCM_BAD_INPUT;
+	}
+
+	if (output_size < input_len)
+		return(MBEDTLS_ERR_CCM_BAD_INPUT);
+	*output_len = input_len;
+
+	ret = 0;
+
+	while (input_len > 0)
+	{
+		offset = ctx->processed % 16;
+
+		use_len = 16 - offset;
+
+		if (use_len > input_len)
+			use_len = input_len;
+
+		ctx->processed += use_len;
+
+		if (ctx->mode == MBEDTLS_CCM_ENCRYPT || \
+			ctx->mode == MBEDTLS_CCM_STAR_ENCRYPT)
+		{
+			for (i = 0; i < use_len; i++)
+				ctx->y[i + offset] ^= input[i];
+
+			if (use_len + offset == 16 || ctx->processed == ctx->plaintext_len)
+			{
+				if ((ret = nu_ccm_block(ctx, ctx->y, ctx->y)) != 0)
+				{
+					ctx->state |= CCM_STATE__ERROR;
+					goto exit;
+				}
+			}
+
+			ret = mbedtls_ccm_crypt(ctx, offset, use_len, input, output);
+			if (ret != 0)
+				goto exit;
+		}
+
+		if (ctx->mode == MBEDTLS_CCM_DECRYPT || \
+			ctx->mode == MBEDTLS_CCM_STAR_DECRYPT)
+		{
+			/* Decrypt to local_output first, output may be shared memory
+			 * and must not be read back as input of Y.
+			 */
+			ret = mbedtls_ccm_crypt(ctx, offset, use_len, input, local_output);
+			if (ret != 0)
+				goto exit;
+
+			for (i = 0; i < use_len; i++)
+				ctx->y[i + offset] ^= local_output[i];
+
+			memcpy(output, local_output, use_len);
+			mbedtls_platform_zeroize(local_output, 16);
+
+			if (use_len + offset == 16 || ctx->processed == ctx->plaintext_len)
+			{
+				if ((ret = nu_ccm_block(ctx, ctx->y, ctx->y)) != 0)
+				{
+					ctx->state |= CCM_STATE__ERROR;
+					goto exit;
+				}
+			}
+		}
+
+		if (use_len + offset == 16 || ctx->processed == ctx->plaintext_len)
+		{
+			for (i = 0; i < ctx->q; i++)
+				if (++(ctx->ctr)[15 - i] != 0)
+					break;
+		}
+
+		input_len -= use_len;
+		input += use_len;
+		output += use_len;
+	}
+
+exit:
+	mbedtls_platform_zeroize(local_output, 16);
+
+	return ret;
+}
+
+int mbedtls_ccm_finish(mbedtls_ccm_context *ctx,
+					   unsigned char *tag, size_t tag_len)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	unsigned char i;
+
+	if (ctx->state & CCM_STATE__ERROR)
+	{
+		return MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	}
+
+	if (ctx->add_len > 0 && !(ctx->state & CCM_STATE__AUTH_DATA_FINISHED))
+	{
+		return MBEDTLS_ERR_CCM_BAD_INPUT;
+	}
+
+	if (ctx->plaintext_len > 0 && ctx->processed != ctx->plaintext_len)
+	{
+		return MBEDTLS_ERR_CCM_BAD_INPUT;
+	}
+
+	/*
+	 * Authentication: reset counter and crypt/mask internal tag
+	 */
+	for (i = 0; i < ctx->q; i++)
+		ctx->ctr[15 - i] = 0;
+
+	ret = mbedtls_ccm_crypt(ctx, 0, 16, ctx->y, ctx->y);
+	if (ret != 0)
+		return ret;
+	if (tag != NULL)
+		memcpy(tag, ctx->y, tag_len);
+	mbedtls_ccm_clear_state(ctx);
+
+	return(0);
+}
+
+/* Whole CCM operation on the TSI
+ *
+ * The engine takes B0, the AAD with its 2-byte length prefix padded to a
+ * block and the payload as one stream, and the first counter block Ctr0
+ * with Set_IV. Parameters are checked like mbedtls_ccm_set_lengths().
+ * Returns MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED when the header is too
+ * long for the engine, the caller then falls back to software.
+ */
+static int nu_ccm_tsi_crypt(mbedtls_ccm_context *ctx, int encDec, size_t length,
+							const unsigned char *iv, size_t iv_len,
+							const unsigned char *add, size_t add_len,
+							const unsigned char *input, unsigned char *output,
+							unsigned char *tag, size_t tag_len)
+{
+	unsigned char info[NU_AES_AEAD_INFO_MAX];
+	unsigned char ctr0[16];
+	unsigned char tagBuf[16];
+	uint32_t hdr[3];
+	size_t infoLen, len_left;
+	unsigned char q, i;
+	int  ret;
+
+	if (iv_len < 7 || iv_len > 13)
+		return(MBEDTLS_ERR_CCM_BAD_INPUT);
+	if (tag_len < 4 || tag_len > 16 || tag_len % 2 != 0)
+		return(MBEDTLS_ERR_CCM_BAD_INPUT);
+	if (add_len >= 0xFF00)
+		return(MBEDTLS_ERR_CCM_BAD_INPUT);
+
+	infoLen = CCM_BLOCK_SIZE + ((add_len > 0) ? CCM_PAD(add_len + 2) : 0);
+	if ((infoLen > NU_AES_AEAD_INFO_MAX) || ((uint64_t)length > 0xFFFFFFE0ull))
+		return MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
+
+	q = 16 - 1 - (unsigned char) iv_len;
+
+	/* B0: flags, nonce, payload length */
+	memset(info, 0, infoLen);
+	info[0] = (unsigned char)(((add_len > 0) << 6) | (((tag_len - 2) / 2) << 3) | (q - 1));
+	memcpy(info + 1, iv, iv_len);
+	for (i = 0, len_left = length; i < q; i++, len_left >>= 8)
+		info[15 - i] = MBEDTLS_BYTE_0(len_left);
+	if (len_left > 0)
+		return(MBEDTLS_ERR_CCM_BAD_INPUT);
+
+	if (add_len > 0)
+	{
+		info[16] = (unsigned char)((add_len >> 8) & 0xFF);
+		info[17] = (unsigned char)((add_len) & 0xFF);
+		memcpy(info + 18, add, add_len);
+	}
+
+	/* Ctr0: flags, nonce, zero counter */
+	memset(ctr0, 0, sizeof(ctr0));
+	ctr0[0] = q - 1;
+	memcpy(ctr0 + 1, iv, iv_len);
+
+	hdr[0] = 0;
+	hdr[1] = (uint32_t)infoLen;
+	hdr[2] = (uint32_t)CCM_PAD(length);
+
+	ret = nu_aes_aead_crypt(&ctx->aes, AES_MODE_CCM, encDec, ctr0, info, infoLen,
+							hdr, input, output, length, tagBuf);
+	if (ret == 0)
+		memcpy(tag, tagBuf, tag_len);
+
+	mbedtls_platform_zeroize(tagBuf, sizeof(tagBuf));
+	return ret;
+}
+
+/*
+ * Authenticated encryption or decryption
+ */
+static int ccm_auth_crypt(mbedtls_ccm_context *ctx, int mode, size_t length,
+						  const unsigned char *iv, size_t iv_len,
+						  const unsigned char *add, size_t add_len,
+						  const unsigned char *input, unsigned char *output,
+						  unsigned char *tag, size_t tag_len)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	size_t olen;
+
+	/* CCM* without tag has no MAC for the engine to compute */
+	if (ctx->isAes && tag_len != 0)
+	{
+		ret = nu_ccm_tsi_crypt(ctx, (mode == MBEDTLS_CCM_ENCRYPT || mode == MBEDTLS_CCM_STAR_ENCRYPT),
+							   length, iv, iv_len, add, add_len, input, output, tag, tag_len);
+		if (ret != MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED)
+			return(ret);
+	}
+
+	if ((ret = mbedtls_ccm_starts(ctx, mode, iv, iv_len)) != 0)
+		return(ret);
+
+	if ((ret = mbedtls_ccm_set_lengths(ctx, add_len, length, tag_len)) != 0)
+		return(ret);
+
+	if ((ret = mbedtls_ccm_update_ad(ctx, add, add_len)) != 0)
+		return(ret);
+
+	if ((ret = mbedtls_ccm_update(ctx, input, length,
+								  output, length, &olen)) != 0)
+		return(ret);
+
+	if ((ret = mbedtls_ccm_finish(ctx, tag, tag_len)) != 0)
+		return(ret);
+
+	return(0);
+}
+
+/*
+ * Authenticated encryption
+ */
+int mbedtls_ccm_star_encrypt_and_tag(mbedtls_ccm_context *ctx, size_t length,
+									 const unsigned char *iv, size_t iv_len,
+									 const unsigned char *add, size_t add_len,
+									 const unsigned char *input, unsigned char *output,
+									 unsigned char *tag, size_t tag_len)
+{
+	return(ccm_auth_crypt(ctx, MBEDTLS_CCM_STAR_ENCRYPT, length, iv, iv_len,
+						  add, add_len, input, output, tag, tag_len));
+}
+
+int mbedtls_ccm_encrypt_and_tag(mbedtls_ccm_context *ctx, size_t length,
+								const unsigned char *iv, size_t iv_len,
+								const unsigned char *add, size_t add_len,
+								const unsigned char *input, unsigned char *output,
+								unsigned char *tag, size_t tag_len)
+{
+	return(ccm_auth_crypt(ctx, MBEDTLS_CCM_ENCRYPT, length, iv, iv_len,
+						  add, add_len, input, output, tag, tag_len));
+}
+
+/*
+ * Authenticated decryption
+ */
+static int mbedtls_ccm_compare_tags(const unsigned char *tag1, const unsigned char *tag2, size_t tag_len)
+{
+	unsigned char i;
+	int diff;
+
+	/* Check tag in "constant-time" */
+	for (diff = 0, i = 0; i < tag_len; i++)
+		diff |= tag1[i] ^ tag2[i];
+
+	if (diff != 0)
+	{
+		return(MBEDTLS_ERR_CCM_AUTH_FAILED);
+	}
+
+	return(0);
+}
+
+static int ccm_auth_decrypt(mbedtls_ccm_context *ctx, int mode, size_t length,
+							const unsigned char *iv, size_t iv_len,
+							const unsigned char *add, size_t add_len,
+							const unsigned char *input, unsigned char *output,
+							const unsigned char *tag, size_t tag_len)
+{
+	int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+	unsigned char check_tag[16];
+
+	if ((ret = ccm_auth_crypt(ctx, mode, length,
+							  iv, iv_len, add, add_len,
+							  input, output, check_tag, tag_len)) != 0)
+	{
+		return(ret);
+	}
+
+	if ((ret = mbedtls_ccm_compare_tags(tag, check_tag, tag_len)) != 0)
+	{
+		mbedtls_platform_zeroize(output, length);
+		return(ret);
+	}
+
+	return(0);
+}
+
+int mbedtls_ccm_star_auth_decrypt(mbedtls_ccm_context *ctx, size_t length,
+								  const unsigned char *iv, size_t iv_len,
+								  const unsigned char *add, size_t add_len,
+								  const unsigned char *input, unsigned char *output,
+								  const unsigned char *tag, size_t tag_len)
+{
+	return ccm_auth_decrypt(ctx, MBEDTLS_CCM_STAR_DECRYPT, length,
+							iv, iv_len, add, add_len,
+							input, output, tag, tag_len);
+}
+
+int mbedtls_ccm_auth_decrypt(mbedtls_ccm_context *ctx, size_t length,
+							 const unsigned char *iv, size_t iv_len,
+							 const unsigned char *add, size_t add_len,
+							 const unsigned char *input, unsigned char *output,
+							 const unsigned char *tag, size_t tag_len)
+{
+	return ccm_auth_decrypt(ctx, MBEDTLS_CCM_DECRYPT, length,
+							iv, iv_len, add, add_len,
+							input, output, tag, tag_len);
+}
+
+#endif /* MBEDTLS_CCM_ALT */
+#endif /* MBEDTLS_CCM_C */
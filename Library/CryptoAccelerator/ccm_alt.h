@@ -0,0 +1,63 @@
+/**
+ * \file ccm_alt.h
+ *
+ * \brief Counter with CBC-MAC (CCM) for 128-bit block ciphers, with the AES
+ *        operations offloaded to the TSI
+ *
+ *  Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ *  Copyright (c) 2023, Nuvoton Technology Corporation
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_CCM_ALT_H
+#define MBEDTLS_CCM_ALT_H
+
+#if defined(MBEDTLS_CCM_ALT)
+
+#include "mbedtls/aes.h"
+#include "mbedtls/cipher.h"
+
+#if !defined(MBEDTLS_AES_ALT)
+#error "MBEDTLS_CCM_ALT requires MBEDTLS_AES_ALT"
+#endif
+
+/**
+ * \brief          CCM context structure
+ *
+ *                 With an AES key the one-shot functions run as a single
+ *                 TSI CCM operation on the session of the embedded AES
+ *                 context. CCM* without tag, the streaming functions and
+ *                 other ciphers use the software CBC-MAC below.
+ */
+typedef struct mbedtls_ccm_context
+{
+	unsigned char MBEDTLS_PRIVATE(y)[16];                  /*!< The Y working buffer */
+	unsigned char MBEDTLS_PRIVATE(ctr)[16];                /*!< The counter buffer */
+	mbedtls_aes_context aes;                               /*!< AES key and TSI session */
+	mbedtls_cipher_context_t MBEDTLS_PRIVATE(cipher_ctx);  /*!< Cipher of a non-AES key */
+	int      isAes;                                        /*!< Key is AES, cipher_ctx unused */
+	size_t MBEDTLS_PRIVATE(plaintext_len);                 /*!< Total plaintext length */
+	size_t MBEDTLS_PRIVATE(add_len);                       /*!< Total authentication data length */
+	size_t MBEDTLS_PRIVATE(tag_len);                       /*!< Total tag length */
+	size_t MBEDTLS_PRIVATE(processed);                     /*!< Bytes of AAD or payload input so far */
+	unsigned char MBEDTLS_PRIVATE(q);                      /*!< The Q working value */
+	unsigned char MBEDTLS_PRIVATE(mode);                   /*!< MBEDTLS_CCM_ENCRYPT/DECRYPT or the STAR variants */
+	int MBEDTLS_PRIVATE(state);                            /*!< Working value holding context's state */
+}
+mbedtls_ccm_context;
+
+#endif /* MBEDTLS_CCM_ALT */
+#endif /* MBEDTLS_CCM_ALT_H */
@@ -0,0 +1,450 @@
+/*
+ *  Benchmark of the mbedTLS primitives the TSI accelerates
+ *
+ *  Copyright (c) 2023, Nuvoton Technology Corporation
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+
+#include "common.h"
+
+#include "mbedtls/aes.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/ccm.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/sha512.h"
+#include "mbedtls/md.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/rsa.h"
+#include "mbedtls/error.h"
+
+#include <string.h>
+
+#include "crypto_bench.h"
+
+/* Built into the TSI port, which always carries the SHA-3 of sha_alt.c */
+#if defined(MBEDTLS_AES_ALT)
+#include "sha_alt.h"
+#define NU_BENCH_SHA3
+#endif
+
+/* Deterministic, a benchmark needs no entropy */
+static uint64_t s_rng = 0x9e3779b97f4a7c15ULL;
+
+static int nu_bench_rng(void *p_rng, unsigned char *output, size_t len)
+{
+	(void)p_rng;
+	while (len--)
+	{
+		s_rng ^= s_rng << 13;
+		s_rng ^= s_rng >> 7;
+		s_rng ^= s_rng << 17;
+		*output++ = (unsigned char)(s_rng >> 24);
+	}
+	return 0;
+}
+
+typedef int (*nu_bench_op)(void *ctx, size_t len);
+
+/* Repeat op for cfg->minMs and report the row */
+static int nu_bench_time(const nu_bench_cfg *cfg, const char *name, size_t size,
+						 nu_bench_op op, void *ctx)
+{
+	nu_bench_result r;
+	uint64_t t0, limit, bytes;
+	uint32_t rt0 = 0;
+
+	memset(&r, 0, sizeof(r));
+	r.name = name;
+	r.size = (uint32_t)size;
+
+	/* Sessions opened and code paged in before the clock starts */
+	r.ret = op(ctx, size);
+
+	limit = (uint64_t)cfg->tickHz * cfg->minMs / 1000;
+	if (cfg->roundTrips)
+		rt0 = cfg->roundTrips();
+	t0 = cfg->now();
+	while (r.ret == 0)
+	{
+		r.ret = op(ctx, size);
+		r.ops++;
+		r.ticks = cfg->now() - t0;
+		if (r.ticks >= limit)
+			break;
+	}
+	if (r.ticks == 0)
+		r.ticks = 1;
+
+	if (r.ret == 0)
+	{
+		bytes = (uint64_t)r.ops * size;
+		r.opsPerSec = (uint32_t)((uint64_t)r.ops * cfg->tickHz / r.ticks);
+		r.kBPerSec = (uint32_t)(bytes * cfg->tickHz / r.ticks / 1024);
+		if (cfg->cpuHz)
+		{
+			/* 1 kHz units keep ticks * cpuHz inside 64 bits */
+			r.cyclesPerOp = r.ticks * (cfg->cpuHz / 1000) / (cfg->tickHz / 1000) / r.ops;
+			if (bytes)
+				r.cyclesPerByte10 = (uint32_t)(r.ticks * (cfg->cpuHz / 1000) * 10 /
+											   (cfg->tickHz / 1000) / bytes);
+		}
+		if (cfg->roundTrips)
+			r.roundTrips100 = (uint32_t)((uint64_t)(cfg->roundTrips() - rt0) * 100 / r.ops);
+	}
+
+	cfg->report(&r, cfg->arg);
+	return r.ret;
+}
+
+/*---------------------------------------------------------------------------
+ *  Messages
+ *---------------------------------------------------------------------------*/
+
+#define M_AES_CBC       0
+#define M_AES_CTR       1
+#define M_AES_GCM       2
+#define M_AES_CCM       3
+#define M_SHA256        4
+#define M_SHA512        5
+#define M_SHA3_256      6
+#define M_HMAC256       7
+
+static const struct
+{
+	const char *name;
+	uint32_t  group;
+	int       mode;
+	int       bits;
+} s_msg[] =
+{
+	{ "AES-128-CBC",  NU_BENCH_AES, M_AES_CBC, 128 },
+	{ "AES-256-CBC",  NU_BENCH_AES, M_AES_CBC, 256 },
+	{ "AES-128-CTR",  NU_BENCH_AES, M_AES_CTR, 128 },
+	{ "AES-128-GCM",  NU_BENCH_AES, M_AES_GCM, 128 },
+	{ "AES-128-CCM",  NU_BENCH_AES, M_AES_CCM, 128 },
+	{ "SHA-256",      NU_BENCH_SHA, M_SHA256,  0 },
+	{ "SHA-512",      NU_BENCH_SHA, M_SHA512,  0 },
+#if defined(NU_BENCH_SHA3)
+	{ "SHA3-256",     NU_BENCH_SHA, M_SHA3_256, 0 },
+#endif
+	{ "HMAC-SHA256",  NU_BENCH_SHA, M_HMAC256, 0 },
+};
+
+typedef struct
+{
+	int       mode;
+	unsigned char *in, *out;
+	mbedtls_aes_context aes;
+	mbedtls_gcm_context gcm;
+	mbedtls_ccm_context ccm;
+	unsigned char key[32], iv[16], stream[16], tag[16], md[64];
+	size_t    off;
+}
+nu_bench_msg;
+
+static int nu_bench_msg_op(void *p, size_t len)
+{
+	nu_bench_msg *m = p;
+
+	switch (m->mode)
+	{
+	case M_AES_CBC:
+		return mbedtls_aes_crypt_cbc(&m->aes, MBEDTLS_AES_ENCRYPT, len, m->iv, m->in, m->out);
+	case M_AES_CTR:
+		return mbedtls_aes_crypt_ctr(&m->aes, len, &m->off, m->iv, m->stream, m->in, m->out);
+	case M_AES_GCM:
+		return mbedtls_gcm_crypt_and_tag(&m->gcm, MBEDTLS_GCM_ENCRYPT, len, m->iv, 12,
+										 NULL, 0, m->in, m->out, 16, m->tag);
+	case M_AES_CCM:
+		return mbedtls_ccm_encrypt_and_tag(&m->ccm, len, m->iv, 12, NULL, 0,
+										   m->in, m->out, m->tag, 16);
+	case M_SHA256:
+		return mbedtls_sha256(m->in, len, m->md, 0);
+	case M_SHA512:
+		return mbedtls_sha512(m->in, len, m->md, 0);
+#if defined(NU_BENCH_SHA3)
+	case M_SHA3_256:
+		return nu_sha(NU_SHA3_256, m->in, len, m->md);
+#endif
+	case M_HMAC256:
+		return mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), m->key, 32,
+							   m->in, len, m->md);
+	default:
+		return MBEDTLS_ERR_ERROR_GENERIC_ERROR;
+	}
+}
+
+static int nu_bench_msg_run(const nu_bench_cfg *cfg)
+{
+	static nu_bench_msg m;
+	size_t i, len;
+	int ret, err = 0;
+
+	nu_bench_rng(NULL, cfg->buf, cfg->maxSize);
+	for (i = 0; i < sizeof(s_msg) / sizeof(s_msg[0]); i++)
+	{
+		if (!(cfg->groups & s_msg[i].group))
+			continue;
+
+		memset(&m, 0, sizeof(m));
+		m.mode = s_msg[i].mode;
+		m.in = cfg->buf;
+		m.out = cfg->buf + cfg->maxSize;
+		nu_bench_rng(NULL, m.key, sizeof(m.key));
+		mbedtls_aes_init(&m.aes);
+		mbedtls_gcm_init(&m.gcm);
+		mbedtls_ccm_init(&m.ccm);
+
+		switch (m.mode)
+		{
+		case M_AES_CBC:
+		case M_AES_CTR:
+			ret = mbedtls_aes_setkey_enc(&m.aes, m.key, s_msg[i].bits);
+			break;
+		case M_AES_GCM:
+			ret = mbedtls_gcm_setkey(&m.gcm, MBEDTLS_CIPHER_ID_AES, m.key, s_msg[i].bits);
+			break;
+		case M_AES_CCM:
+			ret = mbedtls_ccm_setkey(&m.ccm, MBEDTLS_CIPHER_ID_AES, m.key, s_msg[i].bits);
+			break;
+		default:
+			ret = 0;
+			break;
+		}
+
+		for (len = NU_BENCH_MIN_SIZE; (ret == 0) && (len <= cfg->maxSize); len *= 4)
+			ret = nu_bench_time(cfg, s_msg[i].name, len, nu_bench_msg_op, &m);
+		if (!err)
+			err = ret;
+
+		mbedtls_ccm_free(&m.ccm);
+		mbedtls_gcm_free(&m.gcm);
+		mbedtls_aes_free(&m.aes);
+	}
+	return err;
+}
+
+/*---------------------------------------------------------------------------
+ *  Public key
+ *---------------------------------------------------------------------------*/
+
+#define P_ECDSA_SIGN    0
+#define P_ECDSA_VERIFY  1
+#define P_ECDH          2
+#define P_RSA_PUBLIC    3
+#define P_RSA_PRIVATE   4
+
+static const struct
+{
+	const char *sign, *verify, *ecdh;
+	mbedtls_ecp_group_id gid;
+	size_t    hlen;
+} s_curve[] =
+{
+	{ "ECDSA-P256 sign", "ECDSA-P256 verify", "ECDH-P256", MBEDTLS_ECP_DP_SECP256R1, 32 },
+	{ "ECDSA-P384 sign", "ECDSA-P384 verify", "ECDH-P384", MBEDTLS_ECP_DP_SECP384R1, 48 },
+	{ "ECDSA-P521 sign", "ECDSA-P521 verify", "ECDH-P521", MBEDTLS_ECP_DP_SECP521R1, 64 },
+};
+
+static const struct
+{
+	const char *pub, *priv;
+	int       bits;
+} s_rsa[] =
+{
+	{ "RSA-1024 public", "RSA-1024 private", 1024 },
+	{ "RSA-2048 public", "RSA-2048 private", 2048 },
+	{ "RSA-3072 public", "RSA-3072 private", 3072 },
+};
+
+typedef struct
+{
+	int       op;
+	mbedtls_ecdsa_context key, peer;
+	mbedtls_mpi r, s, z;
+	mbedtls_rsa_context rsa;
+	unsigned char hash[64];
+	size_t    hlen;
+	unsigned char *in, *out;
+}
+nu_bench_pk;
+
+static int nu_bench_pk_op(void *p, size_t len)
+{
+	nu_bench_pk *k = p;
+
+	(void)len;
+	switch (k->op)
+	{
+	case P_ECDSA_SIGN:
+		return mbedtls_ecdsa_sign(&k->key.grp, &k->r, &k->s, &k->key.d, k->hash, k->hlen,
+								  nu_bench_rng, NULL);
+	case P_ECDSA_VERIFY:
+		return mbedtls_ecdsa_verify(&k->key.grp, k->hash, k->hlen, &k->key.Q, &k->r, &k->s);
+	case P_ECDH:
+		return mbedtls_ecdh_compute_shared(&k->key.grp, &k->z, &k->peer.Q, &k->key.d,
+										   nu_bench_rng, NULL);
+	case P_RSA_PUBLIC:
+		return mbedtls_rsa_public(&k->rsa, k->in, k->out);
+	case P_RSA_PRIVATE:
+		return mbedtls_rsa_private(&k->rsa, nu_bench_rng, NULL, k->in, k->out);
+	default:
+		return MBEDTLS_ERR_ERROR_GENERIC_ERROR;
+	}
+}
+
+static int nu_bench_ecc_run(const nu_bench_cfg *cfg)
+{
+	static nu_bench_pk k;
+	size_t i;
+	int ret, err = 0;
+
+	for (i = 0; i < sizeof(s_curve) / sizeof(s_curve[0]); i++)
+	{
+		memset(&k, 0, sizeof(k));
+		mbedtls_ecdsa_init(&k.key);
+		mbedtls_ecdsa_init(&k.peer);
+		mbedtls_mpi_init(&k.r);
+		mbedtls_mpi_init(&k.s);
+		mbedtls_mpi_init(&k.z);
+		k.hlen = s_curve[i].hlen;
+		nu_bench_rng(NULL, k.hash, k.hlen);
+
+		ret = mbedtls_ecdsa_genkey(&k.key, s_curve[i].gid, nu_bench_rng, NULL);
+		if (ret == 0)
+			ret = mbedtls_ecdsa_genkey(&k.peer, s_curve[i].gid, nu_bench_rng, NULL);
+
+		/* Verify checks the signatures of the sign row */
+		k.op = P_ECDSA_SIGN;
+		if (ret == 0)
+			ret = nu_bench_time(cfg, s_curve[i].sign, 0, nu_bench_pk_op, &k);
+		k.op = P_ECDSA_VERIFY;
+		if (ret == 0)
+			ret = nu_bench_time(cfg, s_curve[i].verify, 0, nu_bench_pk_op, &k);
+		k.op = P_ECDH;
+		if (ret == 0)
+			ret = nu_bench_time(cfg, s_curve[i].ecdh, 0, nu_bench_pk_op, &k);
+		if (!err)
+			err = ret;
+
+		mbedtls_mpi_free(&k.z);
+		mbedtls_mpi_free(&k.s);
+		mbedtls_mpi_free(&k.r);
+		mbedtls_ecdsa_free(&k.peer);
+		mbedtls_ecdsa_free(&k.key);
+	}
+	return err;
+}
+
+static int nu_bench_rsa_run(const nu_bench_cfg *cfg)
+{
+	static nu_bench_pk k;
+	size_t i, len;
+	int ret, err = 0;
+
+	for (i = 0; i < sizeof(s_rsa) / sizeof(s_rsa[0]); i++)
+	{
+		memset(&k, 0, sizeof(k));
+		mbedtls_rsa_init(&k.rsa);
+		len = s_rsa[i].bits / 8;
+		k.in = cfg->buf;
+		k.out = cfg->buf + cfg->maxSize;
+		nu_bench_rng(NULL, k.in, len);
+		k.in[0] = 0;                /* below the modulus */
+
+		ret = mbedtls_rsa_gen_key(&k.rsa, nu_bench_rng, NULL, s_rsa[i].bits, 65537);
+
+		k.op = P_RSA_PUBLIC;
+		if (ret == 0)
+			ret = nu_bench_time(cfg, s_rsa[i].pub, 0, nu_bench_pk_op, &k);
+		k.op = P_RSA_PRIVATE;
+		if (ret == 0)
+			ret = nu_bench_time(cfg, s_rsa[i].priv, 0, nu_bench_pk_op, &k);
+		if (!err)
+			err = ret;
+
+		mbedtls_rsa_free(&k.rsa);
+	}
+	return err;
+}
+
+/*---------------------------------------------------------------------------
+ *  API
+ *---------------------------------------------------------------------------*/
+
+int nu_bench_run(const nu_bench_cfg *cfg)
+{
+	int ret, err = 0;
+
+	if ((cfg->now == NULL) || (cfg->tickHz < 1000) || (cfg->report == NULL) ||
+			(cfg->buf == NULL) || (cfg->maxSize < NU_BENCH_MIN_SIZE) ||
+			(cfg->maxSize > NU_BENCH_MAX_SIZE))
+		return MBEDTLS_ERR_ERROR_GENERIC_ERROR;
+
+	if (cfg->groups & (NU_BENCH_AES | NU_BENCH_SHA))
+	{
+		ret = nu_bench_msg_run(cfg);
+		if (!err)
+			err = ret;
+	}
+	if (cfg->groups & NU_BENCH_ECC)
+	{
+		ret = nu_bench_ecc_run(cfg);
+		if (!err)
+			err = ret;
+	}
+	if (cfg->groups & NU_BENCH_RSA)
+	{
+		ret = nu_bench_rsa_run(cfg);
+		if (!err)
+			err = ret;
+	}
+	return err;
+}
+
+const char *nu_bench_alts(void)
+{
+	static const char s_alts[] = ""
+#if defined(MBEDTLS_AES_ALT)
+		" AES"
+#endif
+#if defined(MBEDTLS_GCM_ALT)
+		" GCM"
+#endif
+#if defined(MBEDTLS_CCM_ALT)
+		" CCM"
+#endif
+#if defined(MBEDTLS_SHA256_ALT)
+		" SHA256"
+#endif
+#if defined(MBEDTLS_SHA512_ALT)
+		" SHA512"
+#endif
+#if defined(MBEDTLS_ECDSA_SIGN_ALT)
+		" ECDSA"
+#endif
+#if defined(MBEDTLS_ECDH_COMPUTE_SHARED_ALT)
+		" ECDH"
+#endif
+#if defined(MBEDTLS_RSA_ALT)
+		" RSA"
+#endif
+		;
+
+	return s_alts[0] ? s_alts + 1 : "none";
+}
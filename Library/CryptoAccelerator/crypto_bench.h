@@ -0,0 +1,112 @@
+/**
+ * \file crypto_bench.h
+ *
+ * \brief Benchmark of the mbedTLS primitives the TSI accelerates
+ *
+ *  Copyright (c) 2023, Nuvoton Technology Corporation
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_CRYPTO_BENCH_H
+#define MBEDTLS_CRYPTO_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Times the mbedTLS API the way programs call it, in the lines of mbedTLS
+ * programs/test/benchmark.c: AES-CBC/CTR/GCM/CCM and the SHA-2/SHA-3/HMAC
+ * digests for every message size from 16 bytes to maxSize, ECDSA sign and
+ * verify and ECDH on the NIST curves, and the RSA public and private
+ * operations. Whatever the configuration routes to the TSI runs on the
+ * TSI, the rest in software, so building the same program with and
+ * without the ALT modules gives the two sides of the comparison.
+ *
+ * Each row repeats one operation for at least minMs and reports it through
+ * the report callback; nothing is printed by the library.
+ */
+
+#define NU_BENCH_AES            0x01    /*!< AES modes and AEAD */
+#define NU_BENCH_SHA            0x02    /*!< digests and HMAC */
+#define NU_BENCH_ECC            0x04    /*!< ECDSA and ECDH */
+#define NU_BENCH_RSA            0x08    /*!< RSA public and private */
+#define NU_BENCH_ALL            0x0f
+
+#define NU_BENCH_MIN_SIZE       16
+#define NU_BENCH_MAX_SIZE       (1024 * 1024)
+
+/*!< Work buffer for messages up to max bytes: input and output */
+#define NU_BENCH_BUF_SIZE(max)  (2 * (size_t)(max))
+
+/**
+ * \brief          One benchmark row
+ */
+typedef struct nu_bench_result
+{
+	const char *name;           /*!< "AES-128-GCM", "ECDSA-P256 sign", valid in the callback */
+	uint32_t  size;             /*!< message bytes, 0 for public key operations */
+	uint32_t  ops;              /*!< operations timed */
+	uint64_t  ticks;            /*!< time they took */
+	uint32_t  opsPerSec;
+	uint32_t  kBPerSec;         /*!< 0 for public key operations */
+	uint32_t  cyclesPerByte10;  /*!< CPU cycles per byte x 10, 0 without cpuHz or size */
+	uint64_t  cyclesPerOp;      /*!< CPU cycles per operation, 0 without cpuHz */
+	uint32_t  roundTrips100;    /*!< TSI commands per operation x 100 */
+	int       ret;              /*!< error of the operation, 0 if successful */
+}
+nu_bench_result;
+
+/**
+ * \brief          Benchmark setup
+ */
+typedef struct nu_bench_cfg
+{
+	uint64_t  (*now)(void);     /*!< free running counter */
+	uint32_t  tickHz;           /*!< its frequency */
+	uint32_t  cpuHz;            /*!< CPU clock for the cycle counts, may be 0 */
+	uint32_t  (*roundTrips)(void);  /*!< TSI commands so far, may be NULL */
+	uint32_t  minMs;            /*!< time spent on a row */
+	uint32_t  maxSize;          /*!< largest message, NU_BENCH_MIN_SIZE..NU_BENCH_MAX_SIZE */
+	uint32_t  groups;           /*!< NU_BENCH_xxx */
+	unsigned char *buf;         /*!< NU_BENCH_BUF_SIZE(maxSize) bytes the TSI can reach */
+	void      (*report)(const nu_bench_result *r, void *arg);
+	void      *arg;             /*!< passed to report */
+}
+nu_bench_cfg;
+
+/**
+ * \brief          Run the selected groups
+ *
+ * \return         0 if every operation succeeded, otherwise the first
+ *                 error (the failing rows are still reported)
+ */
+int nu_bench_run(const nu_bench_cfg *cfg);
+
+/**
+ * \brief          The ALT modules this library was built with, such as
+ *                 "AES GCM CCM ECDSA ECDH RSA", or "none"
+ */
+const char *nu_bench_alts(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBEDTLS_CRYPTO_BENCH_H */
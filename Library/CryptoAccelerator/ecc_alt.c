@@ -0,0 +1,708 @@
+/*
+ * Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ * Copyright (C) 2023, Nuvoton Technology Corporation, All Rights Reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *  ECDSA and ECDH on the TSI ECC engine
+ *
+ *  SEC1 http://www.secg.org/index.php?action=secg,docs_secg
+ *  RFC 4492 for the related TLS structures and constants
+ */
+
+#include "common.h"
+
+#include "mbedtls/platform_util.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/error.h"
+
+#include "ecc_alt.h"
+
+#if defined(MBEDTLS_ECP_C) && defined(NU_ECC_ALT)
+
+#include <string.h>
+#include "NuMicro.h"
+#include "tsi_cmd.h"
+
+
+#if defined(MBEDTLS_ECP_RESTARTABLE)
+#error "MBEDTLS_ECP_RESTARTABLE cannot work with the TSI ECDSA/ECDH ALT"
+#endif
+
+/* TSI ECC parameter blocks
+ *
+ * The TSI ECC commands take their numbers as ASCII hex strings, one string
+ * per ECC_SLOT_SIZE slot of the parameter block, and write their results
+ * back the same way:
+ *
+ *   GenSignature    param: e, d, k         out: r, s
+ *   VerifySignature param: e, Qx, Qy, r, s
+ *   Multiply        param: Px, Py, k       out: Rx, Ry
+ *   GenPublicKey    param: d               out: Qx, Qy
+ */
+#define ECC_SLOT_SIZE   576
+
+__ALIGNED(64) static char s_eccParam[ECC_SLOT_SIZE * 5];
+__ALIGNED(64) static char s_eccOut[ECC_SLOT_SIZE * 2];
+
+/* Key Store handle in place of d, see ecc_alt.h */
+#define ECC_KS_MAGIC        0x4B530000UL    /* "KS" */
+#define ECC_KS_MAGIC_MSK    0xFFFF0000UL
+#define ECC_KS_ECDH         0x00008000UL
+#define ECC_KS_MEM(h)       (((h) >> 8) & 0x3)
+#define ECC_KS_KNUM(h)      ((h) & 0xff)
+
+/* mbedTLS group to TSI curve. Anything else runs in software. */
+static const struct
+{
+	mbedtls_ecp_group_id gid;
+	E_ECC_CURVE curve;
+} s_eccCurveMap[] =
+{
+	{ MBEDTLS_ECP_DP_SECP192R1, CURVE_P_192  },
+	{ MBEDTLS_ECP_DP_SECP224R1, CURVE_P_224  },
+	{ MBEDTLS_ECP_DP_SECP256R1, CURVE_P_256  },
+	{ MBEDTLS_ECP_DP_SECP384R1, CURVE_P_384  },
+	{ MBEDTLS_ECP_DP_SECP521R1, CURVE_P_521  },
+	{ MBEDTLS_ECP_DP_SECP192K1, CURVE_KO_192 },
+	{ MBEDTLS_ECP_DP_SECP224K1, CURVE_KO_224 },
+	{ MBEDTLS_ECP_DP_SECP256K1, CURVE_KO_256 },
+	{ MBEDTLS_ECP_DP_BP256R1,   CURVE_BP_256 },
+	{ MBEDTLS_ECP_DP_BP384R1,   CURVE_BP_384 },
+	{ MBEDTLS_ECP_DP_BP512R1,   CURVE_BP_512 },
+};
+
+#define ECC_CURVE_NUM   (sizeof(s_eccCurveMap) / sizeof(s_eccCurveMap[0]))
+
+/* Curves the TSI answered with ST_ECC_UNKNOWN_CURVE, by map index */
+static uint32_t s_eccCurveNak;
+
+/* Key Store key size codes of the KS_META_xxx size field */
+static const uint16_t s_ksKeySize[] = { 128, 163, 192, 224, 233, 255, 256, 283,
+										384, 409, 512, 521, 571 };
+
+/* Returned by the TSI helpers when the TSI cannot do the curve */
+#define ECC_ERR_NO_CURVE    MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE
+
+
+static int nu_ecc_curve_index(const mbedtls_ecp_group *grp)
+{
+	int i;
+
+	for (i = 0; i < (int)ECC_CURVE_NUM; i++)
+	{
+		if (s_eccCurveMap[i].gid == grp->id)
+			return i;
+	}
+	return -1;
+}
+
+/* TSI curve of grp, CURVE_UNDEF if it has to run in software */
+static E_ECC_CURVE nu_ecc_curve(const mbedtls_ecp_group *grp)
+{
+	int i = nu_ecc_curve_index(grp);
+
+	if ((i < 0) || (s_eccCurveNak & (1UL << i)))
+		return CURVE_UNDEF;
+	return s_eccCurveMap[i].curve;
+}
+
+static int nu_ecc_error(const mbedtls_ecp_group *grp, int ret)
+{
+	int i;
+
+	switch (ret)
+	{
+	case ST_ECC_UNKNOWN_CURVE:
+		/* Older TSI firmware; do not ask again for this curve */
+		i = nu_ecc_curve_index(grp);
+		if (i >= 0)
+			s_eccCurveNak |= (1UL << i);
+		return ECC_ERR_NO_CURVE;
+	case ST_ECC_INVALID_PRIV_KEY:
+	case ST_KS_ERROR:
+	case ST_KS_READ_PROTECT:
+		return MBEDTLS_ERR_ECP_INVALID_KEY;
+	case ST_SIG_VERIFY_ERROR:
+		return MBEDTLS_ERR_ECP_VERIFY_FAILED;
+	default:
+		sysprintf("TSI ECC ERROR!!! 0x%x\n", ret);
+		TSI_Print_Error(ret);
+		return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+	}
+}
+
+static void nu_ecc_clear(void)
+{
+	mbedtls_platform_zeroize(nc_ptr(s_eccParam), sizeof(s_eccParam));
+	mbedtls_platform_zeroize(nc_ptr(s_eccOut), sizeof(s_eccOut));
+}
+
+static int nu_ecc_put(int slot, const mbedtls_mpi *X)
+{
+	size_t olen;
+
+	return mbedtls_mpi_write_string(X, 16, (char *)nc_ptr(s_eccParam) + slot * ECC_SLOT_SIZE,
+									ECC_SLOT_SIZE, &olen);
+}
+
+static int nu_ecc_get(mbedtls_mpi *X, int slot)
+{
+	char *p = (char *)nc_ptr(s_eccOut) + slot * ECC_SLOT_SIZE;
+
+	p[ECC_SLOT_SIZE - 1] = 0;
+	return mbedtls_mpi_read_string(X, 16, p);
+}
+
+static int nu_ecc_get_point(mbedtls_ecp_point *P)
+{
+	int ret;
+
+	MBEDTLS_MPI_CHK(nu_ecc_get(&P->X, 0));
+	MBEDTLS_MPI_CHK(nu_ecc_get(&P->Y, 1));
+	MBEDTLS_MPI_CHK(mbedtls_mpi_lset(&P->Z, 1));
+cleanup:
+	return ret;
+}
+
+int nu_ecc_ks_handle(const mbedtls_mpi *d, int *mem, int *knum, int *isEcdh)
+{
+	unsigned char buf[4];
+	uint32_t h;
+
+	if ((mbedtls_mpi_cmp_int(d, 0) >= 0) || (mbedtls_mpi_bitlen(d) > 32))
+		return 0;
+	if (mbedtls_mpi_write_binary(d, buf, sizeof(buf)) != 0)
+		return 0;
+	h = ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) |
+		((uint32_t)buf[2] << 8) | buf[3];
+	if ((h & ECC_KS_MAGIC_MSK) != ECC_KS_MAGIC)
+		return 0;
+
+	if (mem != NULL)
+		*mem = ECC_KS_MEM(h);
+	if (knum != NULL)
+		*knum = ECC_KS_KNUM(h);
+	if (isEcdh != NULL)
+		*isEcdh = (h & ECC_KS_ECDH) ? 1 : 0;
+	return 1;
+}
+
+static int nu_ecc_ks_set(mbedtls_mpi *d, int mem, int knum, int isEcdh)
+{
+	uint32_t h = ECC_KS_MAGIC | ((uint32_t)(mem & 0x3) << 8) | (knum & 0xff);
+
+	if (isEcdh)
+		h |= ECC_KS_ECDH;
+	return mbedtls_mpi_lset(d, -(mbedtls_mpi_sint)h);
+}
+
+static int nu_ecc_ks_psel(int mem)
+{
+	return (mem == KS_OTP) ? ECC_KEY_SEL_KS_OTP : ECC_KEY_SEL_KS_SRAM;
+}
+
+/*
+ * Derive a suitable integer for group grp from a buffer of length len
+ * SEC1 4.1.3 step 5 aka SEC1 4.1.4 step 3
+ */
+static int nu_ecc_derive_mpi(const mbedtls_ecp_group *grp, mbedtls_mpi *x,
+							 const unsigned char *buf, size_t blen)
+{
+	int ret;
+	size_t n_size = (grp->nbits + 7) / 8;
+	size_t use_size = blen > n_size ? n_size : blen;
+
+	MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(x, buf, use_size));
+	if (use_size * 8 > grp->nbits)
+		MBEDTLS_MPI_CHK(mbedtls_mpi_shift_r(x, use_size * 8 - grp->nbits));
+
+	/* While at it, reduce modulo N */
+	if (mbedtls_mpi_cmp_mpi(x, &grp->N) >= 0)
+		MBEDTLS_MPI_CHK(mbedtls_mpi_sub_mpi(x, x, &grp->N));
+
+cleanup:
+	return ret;
+}
+
+/* Q = d * G on the TSI, d is a plain scalar or a Key Store handle */
+static int nu_ecc_gen_public(const mbedtls_ecp_group *grp, E_ECC_CURVE curve,
+							 const mbedtls_mpi *d, mbedtls_ecp_point *Q)
+{
+	int ret, mem, knum, isEcdh;
+
+	nu_ecc_clear();
+	if (nu_ecc_ks_handle(d, &mem, &knum, &isEcdh))
+	{
+		ret = TSI_ECC_GenPublicKey(curve, isEcdh, nu_ecc_ks_psel(mem), knum,
+								   0, ptr_to_u32(s_eccOut));
+	}
+	else
+	{
+		MBEDTLS_MPI_CHK(nu_ecc_put(0, d));
+		ret = TSI_ECC_GenPublicKey(curve, 0, ECC_KEY_SEL_USER, 0,
+								   ptr_to_u32(s_eccParam), ptr_to_u32(s_eccOut));
+	}
+	if (ret != 0)
+	{
+		ret = nu_ecc_error(grp, ret);
+		goto cleanup;
+	}
+	MBEDTLS_MPI_CHK(nu_ecc_get_point(Q));
+
+cleanup:
+	nu_ecc_clear();
+	return ret;
+}
+
+/* Generate d and Q = d * G; the RNG only draws d, as in software */
+static int nu_ecc_gen_keypair(mbedtls_ecp_group *grp, mbedtls_mpi *d, mbedtls_ecp_point *Q,
+							  int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+	E_ECC_CURVE curve = nu_ecc_curve(grp);
+	int ret;
+
+	if (curve == CURVE_UNDEF)
+		return mbedtls_ecp_gen_keypair(grp, d, Q, f_rng, p_rng);
+
+	MBEDTLS_MPI_CHK(mbedtls_ecp_gen_privkey(grp, d, f_rng, p_rng));
+	ret = nu_ecc_gen_public(grp, curve, d, Q);
+	if (ret == ECC_ERR_NO_CURVE)
+		ret = mbedtls_ecp_mul(grp, Q, d, &grp->G, f_rng, p_rng);
+
+cleanup:
+	return ret;
+}
+
+int nu_ecc_ks_bind(mbedtls_ecp_keypair *key, mbedtls_ecp_group_id gid,
+				   int mem, int knum, int isEcdh)
+{
+	E_ECC_CURVE curve;
+	int ret;
+
+	if (((mem != KS_SRAM) && (mem != KS_OTP)) || (knum < 0) || (knum > 0xff))
+		return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+
+	MBEDTLS_MPI_CHK(mbedtls_ecp_group_load(&key->grp, gid));
+	curve = nu_ecc_curve(&key->grp);
+	if (curve == CURVE_UNDEF)
+		return ECC_ERR_NO_CURVE;
+
+	MBEDTLS_MPI_CHK(nu_ecc_ks_set(&key->d, mem, knum, isEcdh));
+	MBEDTLS_MPI_CHK(nu_ecc_gen_public(&key->grp, curve, &key->d, &key->Q));
+
+cleanup:
+	return ret;
+}
+
+int nu_ecc_ks_import(mbedtls_ecp_keypair *key, uint32_t meta, int *knum)
+{
+	__ALIGNED(64) static uint32_t s_ksKey[18];
+	uint32_t *kw = nc_ptr(s_ksKey);
+	unsigned char buf[sizeof(s_ksKey)];
+	size_t i, bits, wcnt;
+	int ret, num, szCode = -1;
+
+	if (nu_ecc_curve(&key->grp) == CURVE_UNDEF)
+		return ECC_ERR_NO_CURVE;
+	MBEDTLS_MPI_CHK(mbedtls_ecp_check_privkey(&key->grp, &key->d));
+
+	for (i = 0; i < sizeof(s_ksKeySize) / sizeof(s_ksKeySize[0]); i++)
+	{
+		if (s_ksKeySize[i] == key->grp.pbits)
+			szCode = (int)i;
+	}
+	bits = key->grp.pbits;
+	if ((szCode < 0) || (mbedtls_mpi_bitlen(&key->d) > bits))
+		return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+
+	/* Key Store words are little endian, least significant word first */
+	wcnt = (bits + 31) / 32;
+	MBEDTLS_MPI_CHK(mbedtls_mpi_write_binary_le(&key->d, buf, wcnt * 4));
+	for (i = 0; i < wcnt; i++)
+		kw[i] = (uint32_t)buf[4 * i] | ((uint32_t)buf[4 * i + 1] << 8) |
+				((uint32_t)buf[4 * i + 2] << 16) | ((uint32_t)buf[4 * i + 3] << 24);
+
+	meta &= (KS_META_READABLE | KS_META_PRIV | KS_META_SECURE);
+	ret = TSI_KS_Write_SRAM(KS_META_ECC | ((uint32_t)szCode << KS_METADATA_SIZE_Pos) | meta,
+							s_ksKey, &num);
+	mbedtls_platform_zeroize(buf, sizeof(buf));
+	mbedtls_platform_zeroize(kw, sizeof(s_ksKey));
+	if (ret != 0)
+	{
+		ret = nu_ecc_error(&key->grp, ret);
+		goto cleanup;
+	}
+
+	/* mbedtls_mpi_lset() wipes the old limbs */
+	MBEDTLS_MPI_CHK(nu_ecc_ks_set(&key->d, KS_SRAM, num, 0));
+	if (knum != NULL)
+		*knum = num;
+
+cleanup:
+	return ret;
+}
+
+#if defined(MBEDTLS_ECDSA_C) && defined(MBEDTLS_ECDSA_SIGN_ALT)
+/*
+ * Software ECDSA signature (SEC1 4.1.3) for curves the TSI cannot do.
+ * The ephemeral key is the first draw from f_rng, as in ecdsa.c, so with
+ * MBEDTLS_ECDSA_DETERMINISTIC the signature matches software; the point
+ * multiplication blinds with later draws of the same RNG.
+ */
+static int nu_ecdsa_sign_sw(mbedtls_ecp_group *grp, mbedtls_mpi *r, mbedtls_mpi *s,
+							const mbedtls_mpi *d, const mbedtls_mpi *e,
+							int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+	int ret, key_tries, sign_tries = 0;
+	mbedtls_ecp_point R;
+	mbedtls_mpi k, t;
+
+	mbedtls_ecp_point_init(&R);
+	mbedtls_mpi_init(&k);
+	mbedtls_mpi_init(&t);
+
+	do
+	{
+		if (sign_tries++ > 10)
+		{
+			ret = MBEDTLS_ERR_ECP_RANDOM_FAILED;
+			goto cleanup;
+		}
+
+		/* Steps 1-3: generate a suitable ephemeral keypair and set r = xR mod n */
+		key_tries = 0;
+		do
+		{
+			if (key_tries++ > 10)
+			{
+				ret = MBEDTLS_ERR_ECP_RANDOM_FAILED;
+				goto cleanup;
+			}
+			MBEDTLS_MPI_CHK(mbedtls_ecp_gen_privkey(grp, &k, f_rng, p_rng));
+			MBEDTLS_MPI_CHK(mbedtls_ecp_mul(grp, &R, &k, &grp->G, f_rng, p_rng));
+			MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(r, &R.X, &grp->N));
+		}
+		while (mbedtls_mpi_cmp_int(r, 0) == 0);
+
+		/* Step 6: compute s = (e + r * d) / k */
+		MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(s, r, d));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_add_mpi(&t, e, s));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_inv_mod(s, &k, &grp->N));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(s, s, &t));
+		MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(s, s, &grp->N));
+	}
+	while (mbedtls_mpi_cmp_int(s, 0) == 0);
+
+cleanup:
+	mbedtls_ecp_point_free(&R);
+	mbedtls_mpi_free(&k);
+	mbedtls_mpi_free(&t);
+	return ret;
+}
+
+/*
+ * ECDSA signature on the TSI. A plain d signs with an ephemeral key drawn
+ * from f_rng, so deterministic ECDSA gives the same signature as software;
+ * a Key Store key signs with an ephemeral key from the TSI TRNG.
+ */
+int mbedtls_ecdsa_sign(mbedtls_ecp_group *grp, mbedtls_mpi *r, mbedtls_mpi *s,
+					   const mbedtls_mpi *d, const unsigned char *buf, size_t blen,
+					   int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+	E_ECC_CURVE curve;
+	mbedtls_mpi e, k;
+	int ret, tries, isKs, mem = 0, knum = 0;
+
+	if (grp == NULL || r == NULL || s == NULL || d == NULL || f_rng == NULL ||
+		(buf == NULL && blen != 0))
+		return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+
+	/* Fail cleanly on curves such as Curve25519 that can't be used for ECDSA */
+	if (mbedtls_ecp_get_type(grp) != MBEDTLS_ECP_TYPE_SHORT_WEIERSTRASS || grp->N.p == NULL)
+		return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+
+	isKs = nu_ecc_ks_handle(d, &mem, &knum, NULL);
+
+	/* Make sure d is in range 1..n-1 */
+	if (!isKs && (mbedtls_mpi_cmp_int(d, 1) < 0 || mbedtls_mpi_cmp_mpi(d, &grp->N) >= 0))
+		return MBEDTLS_ERR_ECP_INVALID_KEY;
+
+	mbedtls_mpi_init(&e);
+	mbedtls_mpi_init(&k);
+
+	/* Step 5: derive MPI from hashed message */
+	MBEDTLS_MPI_CHK(nu_ecc_derive_mpi(grp, &e, buf, blen));
+
+	curve = nu_ecc_curve(grp);
+	if (curve == CURVE_UNDEF)
+	{
+		ret = isKs ? ECC_ERR_NO_CURVE : nu_ecdsa_sign_sw(grp, r, s, d, &e, f_rng, p_rng);
+		goto cleanup;
+	}
+
+	tries = 0;
+	do
+	{
+		if (tries++ > 10)
+		{
+			ret = MBEDTLS_ERR_ECP_RANDOM_FAILED;
+			goto cleanup;
+		}
+
+		nu_ecc_clear();
+		MBEDTLS_MPI_CHK(nu_ecc_put(0, &e));
+		if (isKs)
+		{
+			ret = TSI_ECC_GenSignature(curve, 0, nu_ecc_ks_psel(mem), knum,
+									   ptr_to_u32(s_eccParam), ptr_to_u32(s_eccOut));
+		}
+		else
+		{
+			MBEDTLS_MPI_CHK(mbedtls_ecp_gen_privkey(grp, &k, f_rng, p_rng));
+			MBEDTLS_MPI_CHK(nu_ecc_put(1, d));
+			MBEDTLS_MPI_CHK(nu_ecc_put(2, &k));
+			ret = TSI_ECC_GenSignature(curve, 1, ECC_KEY_SEL_USER, 0,
+									   ptr_to_u32(s_eccParam), ptr_to_u32(s_eccOut));
+		}
+		if (ret != 0)
+		{
+			ret = nu_ecc_error(grp, ret);
+			if ((ret == ECC_ERR_NO_CURVE) && !isKs)
+				ret = nu_ecdsa_sign_sw(grp, r, s, d, &e, f_rng, p_rng);
+			goto cleanup;
+		}
+		MBEDTLS_MPI_CHK(nu_ecc_get(r, 0));
+		MBEDTLS_MPI_CHK(nu_ecc_get(s, 1));
+	}
+	while (mbedtls_mpi_cmp_int(r, 0) == 0 || mbedtls_mpi_cmp_int(s, 0) == 0);
+
+cleanup:
+	nu_ecc_clear();
+	mbedtls_mpi_free(&e);
+	mbedtls_mpi_free(&k);
+	return ret;
+}
+#endif /* MBEDTLS_ECDSA_C && MBEDTLS_ECDSA_SIGN_ALT */
+
+#if defined(MBEDTLS_ECDSA_C) && defined(MBEDTLS_ECDSA_VERIFY_ALT)
+/* Software ECDSA verification (SEC1 4.1.4) for curves the TSI cannot do */
+static int nu_ecdsa_verify_sw(mbedtls_ecp_group *grp, const mbedtls_mpi *e,
+							  const mbedtls_ecp_point *Q, const mbedtls_mpi *r,
+							  const mbedtls_mpi *s)
+{
+	int ret;
+	mbedtls_mpi s_inv, u1, u2;
+	mbedtls_ecp_point R;
+
+	mbedtls_ecp_point_init(&R);
+	mbedtls_mpi_init(&s_inv);
+	mbedtls_mpi_init(&u1);
+	mbedtls_mpi_init(&u2);
+
+	/* Step 4: u1 = e / s mod n, u2 = r / s mod n */
+	MBEDTLS_MPI_CHK(mbedtls_mpi_inv_mod(&s_inv, s, &grp->N));
+	MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&u1, e, &s_inv));
+	MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&u1, &u1, &grp->N));
+	MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&u2, r, &s_inv));
+	MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&u2, &u2, &grp->N));
+
+	/* Step 5: R = u1 G + u2 Q */
+	MBEDTLS_MPI_CHK(mbedtls_ecp_muladd(grp, &R, &u1, &grp->G, &u2, Q));
+	if (mbedtls_ecp_is_zero(&R))
+	{
+		ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+		goto cleanup;
+	}
+
+	/* Step 6-8: v = xR mod n, check v == r */
+	MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&R.X, &R.X, &grp->N));
+	if (mbedtls_mpi_cmp_mpi(&R.X, r) != 0)
+		ret = MBEDTLS_ERR_ECP_VERIFY_FAILED;
+
+cleanup:
+	mbedtls_ecp_point_free(&R);
+	mbedtls_mpi_free(&s_inv);
+	mbedtls_mpi_free(&u1);
+	mbedtls_mpi_free(&u2);
+	return ret;
+}
+
+int mbedtls_ecdsa_verify(mbedtls_ecp_group *grp, const unsigned char *buf, size_t blen,
+						 const mbedtls_ecp_point *Q, const mbedtls_mpi *r,
+						 const mbedtls_mpi *s)
+{
+	E_ECC_CURVE curve;
+	mbedtls_mpi e;
+	int ret;
+
+	if (grp == NULL || Q == NULL || r == NULL || s == NULL || (buf == NULL && blen != 0))
+		return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+
+	/* Fail cleanly on curves such as Curve25519 that can't be used for ECDSA */
+	if (mbedtls_ecp_get_type(grp) != MBEDTLS_ECP_TYPE_SHORT_WEIERSTRASS || grp->N.p == NULL)
+		return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+
+	/* Step 1: make sure r and s are in range 1..n-1 */
+	if (mbedtls_mpi_cmp_int(r, 1) < 0 || mbedtls_mpi_cmp_mpi(r, &grp->N) >= 0 ||
+		mbedtls_mpi_cmp_int(s, 1) < 0 || mbedtls_mpi_cmp_mpi(s, &grp->N) >= 0)
+		return MBEDTLS_ERR_ECP_VERIFY_FAILED;
+
+	/* The TSI takes Q as is, reject points off the curve here */
+	ret = mbedtls_ecp_check_pubkey(grp, Q);
+	if (ret != 0)
+		return ret;
+
+	mbedtls_mpi_init(&e);
+
+	/* Step 3: derive MPI from hashed message */
+	MBEDTLS_MPI_CHK(nu_ecc_derive_mpi(grp, &e, buf, blen));
+
+	curve = nu_ecc_curve(grp);
+	if (curve == CURVE_UNDEF)
+	{
+		ret = nu_ecdsa_verify_sw(grp, &e, Q, r, s);
+		goto cleanup;
+	}
+
+	nu_ecc_clear();
+	MBEDTLS_MPI_CHK(nu_ecc_put(0, &e));
+	MBEDTLS_MPI_CHK(nu_ecc_put(1, &Q->X));
+	MBEDTLS_MPI_CHK(nu_ecc_put(2, &Q->Y));
+	MBEDTLS_MPI_CHK(nu_ecc_put(3, r));
+	MBEDTLS_MPI_CHK(nu_ecc_put(4, s));
+	ret = TSI_ECC_VerifySignature(curve, ECC_KEY_SEL_USER, 0, 0, ptr_to_u32(s_eccParam));
+	if (ret != 0)
+	{
+		ret = nu_ecc_error(grp, ret);
+		if (ret == ECC_ERR_NO_CURVE)
+			ret = nu_ecdsa_verify_sw(grp, &e, Q, r, s);
+	}
+
+cleanup:
+	mbedtls_mpi_free(&e);
+	return ret;
+}
+#endif /* MBEDTLS_ECDSA_C && MBEDTLS_ECDSA_VERIFY_ALT */
+
+#if defined(MBEDTLS_ECDSA_C) && defined(MBEDTLS_ECDSA_GENKEY_ALT)
+int mbedtls_ecdsa_genkey(mbedtls_ecdsa_context *ctx, mbedtls_ecp_group_id gid,
+						 int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+	int ret;
+
+	if (ctx == NULL || f_rng == NULL)
+		return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+
+	ret = mbedtls_ecp_group_load(&ctx->grp, gid);
+	if (ret != 0)
+		return ret;
+
+	return nu_ecc_gen_keypair(&ctx->grp, &ctx->d, &ctx->Q, f_rng, p_rng);
+}
+#endif /* MBEDTLS_ECDSA_C && MBEDTLS_ECDSA_GENKEY_ALT */
+
+#if defined(MBEDTLS_ECDH_C) && defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT)
+int mbedtls_ecdh_gen_public(mbedtls_ecp_group *grp, mbedtls_mpi *d, mbedtls_ecp_point *Q,
+							int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+	if (grp == NULL || d == NULL || Q == NULL || f_rng == NULL)
+		return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+
+	return nu_ecc_gen_keypair(grp, d, Q, f_rng, p_rng);
+}
+#endif /* MBEDTLS_ECDH_C && MBEDTLS_ECDH_GEN_PUBLIC_ALT */
+
+#if defined(MBEDTLS_ECDH_C) && defined(MBEDTLS_ECDH_COMPUTE_SHARED_ALT)
+/*
+ * Compute shared secret (SEC1 3.3.1)
+ */
+int mbedtls_ecdh_compute_shared(mbedtls_ecp_group *grp, mbedtls_mpi *z,
+								const mbedtls_ecp_point *Q, const mbedtls_mpi *d,
+								int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+	E_ECC_CURVE curve;
+	mbedtls_ecp_point P;
+	int ret, isKs, mem = 0, knum = 0, isEcdh = 0;
+
+	if (grp == NULL || Q == NULL || d == NULL || z == NULL)
+		return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+
+	isKs = nu_ecc_ks_handle(d, &mem, &knum, &isEcdh);
+	curve = nu_ecc_curve(grp);
+
+	mbedtls_ecp_point_init(&P);
+
+	if (curve == CURVE_UNDEF)
+	{
+		if (isKs)
+		{
+			ret = ECC_ERR_NO_CURVE;
+			goto cleanup;
+		}
+		goto software;
+	}
+
+	/* The TSI takes the peer point as is, reject invalid curve points here */
+	MBEDTLS_MPI_CHK(mbedtls_ecp_check_pubkey(grp, Q));
+	if (!isKs)
+		MBEDTLS_MPI_CHK(mbedtls_ecp_check_privkey(grp, d));
+
+	nu_ecc_clear();
+	MBEDTLS_MPI_CHK(nu_ecc_put(0, &Q->X));
+	MBEDTLS_MPI_CHK(nu_ecc_put(1, &Q->Y));
+	if (isKs)
+	{
+		ret = TSI_ECC_Multiply(curve, isEcdh, nu_ecc_ks_psel(mem), 0x3, knum, 0, 0,
+							   ptr_to_u32(s_eccParam), ptr_to_u32(s_eccOut));
+	}
+	else
+	{
+		MBEDTLS_MPI_CHK(nu_ecc_put(2, d));
+		ret = TSI_ECC_Multiply(curve, 0, 0x3, 0x3, 0, 0, 0,
+							   ptr_to_u32(s_eccParam), ptr_to_u32(s_eccOut));
+	}
+	if (ret != 0)
+	{
+		ret = nu_ecc_error(grp, ret);
+		if ((ret == ECC_ERR_NO_CURVE) && !isKs)
+			goto software;
+		goto cleanup;
+	}
+	MBEDTLS_MPI_CHK(nu_ecc_get_point(&P));
+	goto check;
+
+software:
+	MBEDTLS_MPI_CHK(mbedtls_ecp_mul(grp, &P, d, Q, f_rng, p_rng));
+
+check:
+	if (mbedtls_ecp_is_zero(&P))
+	{
+		ret = MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+		goto cleanup;
+	}
+	MBEDTLS_MPI_CHK(mbedtls_mpi_copy(z, &P.X));
+
+cleanup:
+	nu_ecc_clear();
+	mbedtls_ecp_point_free(&P);
+	return ret;
+}
+#endif /* MBEDTLS_ECDH_C && MBEDTLS_ECDH_COMPUTE_SHARED_ALT */
+
+#endif /* MBEDTLS_ECP_C && NU_ECC_ALT */
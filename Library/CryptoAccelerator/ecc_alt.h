@@ -0,0 +1,100 @@
+/**
+ * \file ecc_alt.h
+ *
+ * \brief ECDSA and ECDH on the TSI ECC engine, Key Store private keys
+ *
+ *  Copyright (c) 2023, Nuvoton Technology Corporation
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_ECC_ALT_H
+#define MBEDTLS_ECC_ALT_H
+
+#include "mbedtls/ecp.h"
+
+#if defined(MBEDTLS_ECDSA_SIGN_ALT) || defined(MBEDTLS_ECDSA_VERIFY_ALT) || \
+	defined(MBEDTLS_ECDSA_GENKEY_ALT) || defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT) || \
+	defined(MBEDTLS_ECDH_COMPUTE_SHARED_ALT)
+#define NU_ECC_ALT
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A private key kept in the TSI Key Store is represented in the key pair
+ * by a handle in place of d: a negative value carrying the Key Store
+ * memory and key number. mbedtls_ecdsa_sign() and
+ * mbedtls_ecdh_compute_shared() pass it to the TSI, the software ECP code
+ * rejects it as an invalid key, so the secret can never be mistaken for a
+ * plain scalar. Signatures with a Key Store key take their ephemeral key
+ * from the TSI TRNG, deterministic ECDSA does not apply to them.
+ */
+
+/**
+ * \brief          Bind a key pair to a private key in the TSI Key Store
+ *
+ *                 Loads group \p gid, sets key->d to the handle of the Key
+ *                 Store key and computes key->Q on the TSI.
+ *
+ * \param key      Key pair to set up
+ * \param gid      Curve of the key
+ * \param mem      KS_SRAM or KS_OTP
+ * \param knum     Key number in \p mem
+ * \param isEcdh   1 for a key marked as ECDH key in the Key Store
+ *
+ * \return         0 if successful, MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE if
+ *                 the TSI does not support the curve, or an ECP/platform
+ *                 error code
+ */
+int nu_ecc_ks_bind(mbedtls_ecp_keypair *key, mbedtls_ecp_group_id gid,
+				   int mem, int knum, int isEcdh);
+
+/**
+ * \brief          Move the private key of a key pair to Key Store SRAM
+ *
+ *                 key->grp and key->d must be set. d is written to a free
+ *                 Key Store SRAM entry and replaced by its handle.
+ *
+ * \param key      Key pair to convert
+ * \param meta     Additional Key Store metadata flags (KS_META_PRIV,
+ *                 KS_META_SECURE, KS_META_READABLE), owner and size are
+ *                 set from the key
+ * \param knum     Set to the Key Store SRAM key number, may be NULL
+ *
+ * \return         0 if successful, or an ECP/platform error code
+ */
+int nu_ecc_ks_import(mbedtls_ecp_keypair *key, uint32_t meta, int *knum);
+
+/**
+ * \brief          Decode a Key Store handle
+ *
+ * \param d        Private key of a key pair
+ * \param mem      Set to KS_SRAM or KS_OTP, may be NULL
+ * \param knum     Set to the key number, may be NULL
+ * \param isEcdh   Set to the ECDH flag of the handle, may be NULL
+ *
+ * \return         1 if \p d is a Key Store handle, 0 otherwise
+ */
+int nu_ecc_ks_handle(const mbedtls_mpi *d, int *mem, int *knum, int *isEcdh);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBEDTLS_ECDSA_SIGN_ALT || ... */
+
+#endif /* MBEDTLS_ECC_ALT_H */
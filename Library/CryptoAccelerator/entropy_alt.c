@@ -0,0 +1,380 @@
+/*
+ *  Hardware entropy collector on the TSI TRNG
+ *
+ *  Copyright (c) 2023, Nuvoton Technology Corporation
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+/*
+ *  NIST SP 800-90B, 4.4 Approved Continuous Health Tests
+ */
+
+#include "common.h"
+
+#if defined(MBEDTLS_ENTROPY_C) && defined(MBEDTLS_ENTROPY_HARDWARE_ALT)
+
+#include "mbedtls/entropy.h"
+#include "mbedtls/platform_util.h"
+#include "entropy_poll.h"
+
+#include <string.h>
+#include "NuMicro.h"
+#include "tsi_cmd.h"
+#if defined(TSI_USE_FREERTOS)
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#endif
+
+#include "entropy_alt.h"
+
+#define BANK_BYTES      (NU_ENTROPY_BANK_WORDS * 4)
+
+/*
+ * Bank life cycle. Only the TSI completion moves FILLING to DONE, every
+ * other step is taken by the poll.
+ */
+#define BANK_EMPTY      0       /* used up or dropped, to be refilled */
+#define BANK_FILLING    1       /* TRNG command in flight */
+#define BANK_DONE       2       /* TRNG command completed, not checked yet */
+#define BANK_READY      3       /* passed the health tests, being served */
+
+typedef struct
+{
+	volatile int state;
+	int       status;           /* TSI status of the last fill */
+	uint32_t  pos;              /* bytes served */
+	TSI_REQ_T req;
+} nu_entropy_bank;
+
+/* Written by the TRNG, read and wiped by the CPU through the non-cacheable alias */
+__ALIGNED(64) static uint32_t s_bankData[NU_ENTROPY_BANKS][NU_ENTROPY_BANK_WORDS];
+
+static nu_entropy_bank s_bank[NU_ENTROPY_BANKS];
+static int s_cur;               /* bank served next */
+static int s_ready;
+static nu_entropy_stats s_stats;
+
+#if defined(TSI_USE_FREERTOS)
+static StaticSemaphore_t s_lockBuf;
+static SemaphoreHandle_t s_lock;
+#endif
+
+/* Polls of several tasks exclude each other, see entropy_alt.h */
+__attribute__ ((weak)) void nu_entropy_lock(void)
+{
+#if defined(TSI_USE_FREERTOS)
+	if (s_lock == NULL)
+	{
+		vTaskSuspendAll();
+		if (s_lock == NULL)
+			s_lock = xSemaphoreCreateMutexStatic(&s_lockBuf);
+		(void)xTaskResumeAll();
+	}
+	xSemaphoreTake(s_lock, portMAX_DELAY);
+#endif
+}
+
+__attribute__ ((weak)) void nu_entropy_unlock(void)
+{
+#if defined(TSI_USE_FREERTOS)
+	xSemaphoreGive(s_lock);
+#endif
+}
+
+#define HEALTH_OK       0
+#define HEALTH_RCT      1
+#define HEALTH_APT      2
+
+static int nu_entropy_health(const uint8_t *p, size_t len)
+{
+	uint8_t  a = p[0];
+	size_t   i, run = 1, cnt = 1;
+
+	for (i = 1; i < len; i++)
+	{
+		/* Repetition count test */
+		run = (p[i] == p[i - 1]) ? run + 1 : 1;
+		if (run >= NU_ENTROPY_RCT_CUTOFF)
+			return HEALTH_RCT;
+
+		/* Adaptive proportion test, the first byte of each window is the sample */
+		if ((i % NU_ENTROPY_APT_WINDOW) == 0)
+		{
+			a = p[i];
+			cnt = 1;
+		}
+		else if ((p[i] == a) && (++cnt >= NU_ENTROPY_APT_CUTOFF))
+		{
+			return HEALTH_APT;
+		}
+	}
+	return HEALTH_OK;
+}
+
+/* TSI completion, in WRHO1_IRQHandler or TSI_Poll() */
+static void nu_entropy_done(TSI_REQ_T *req, void *arg)
+{
+	nu_entropy_bank *b = arg;
+
+	b->status = TSI_Req_Status(req);
+	dmb();
+	b->state = BANK_DONE;
+}
+
+/* Health check a completed fill */
+static void nu_entropy_check(int i)
+{
+	nu_entropy_bank *b = &s_bank[i];
+	uint8_t *p = nc_ptr(s_bankData[i]);
+
+	if (b->state != BANK_DONE)
+		return;
+	dmb();
+	if (b->status != 0)
+	{
+		s_stats.trngErr++;
+		b->state = BANK_EMPTY;
+		return;
+	}
+	switch (nu_entropy_health(p, BANK_BYTES))
+	{
+	case HEALTH_RCT:
+		s_stats.rctFail++;
+		mbedtls_platform_zeroize(p, BANK_BYTES);
+		b->state = BANK_EMPTY;
+		break;
+	case HEALTH_APT:
+		s_stats.aptFail++;
+		mbedtls_platform_zeroize(p, BANK_BYTES);
+		b->state = BANK_EMPTY;
+		break;
+	default:
+		b->pos = 0;
+		b->state = BANK_READY;
+		break;
+	}
+}
+
+/* Refill the empty banks in the background */
+static void nu_entropy_refill(void)
+{
+	nu_entropy_bank *b;
+	int i;
+
+	for (i = 0; i < NU_ENTROPY_BANKS; i++)
+	{
+		b = &s_bank[i];
+		if (b->state != BANK_EMPTY)
+			continue;
+		/* The completion may run before TSI_Submit() returns */
+		b->state = BANK_FILLING;
+		if (TSI_TRNG_Gen_Random_Async(&b->req, NU_ENTROPY_BANK_WORDS,
+									  ptr_to_u32(s_bankData[i]), nu_entropy_done, b) != 0)
+		{
+			/* TSI busy, the next poll retries */
+			b->state = BANK_EMPTY;
+			return;
+		}
+		s_stats.refills++;
+	}
+}
+
+/* Fill a bank and wait for it */
+static void nu_entropy_fill(int i)
+{
+	nu_entropy_bank *b = &s_bank[i];
+
+	b->status = TSI_TRNG_Gen_Random(NU_ENTROPY_BANK_WORDS, ptr_to_u32(s_bankData[i]));
+	b->state = BANK_DONE;
+	nu_entropy_check(i);
+}
+
+/*
+ * Make a bank ready when none is: wait for a refill in flight, or fill an
+ * empty bank when the TSI refused the refills.
+ */
+static void nu_entropy_wait(void)
+{
+	nu_entropy_bank *b;
+	int i, k;
+
+	nu_entropy_refill();
+	for (k = 0; k < NU_ENTROPY_BANKS; k++)
+	{
+		i = (s_cur + k) % NU_ENTROPY_BANKS;
+		b = &s_bank[i];
+		if (b->state == BANK_FILLING)
+		{
+			TSI_Wait(&b->req, CMD_TIME_OUT_2S);
+			if (b->state == BANK_FILLING)
+			{
+				/* Timed out and recalled, no completion */
+				b->status = ST_CMD_ACK_TIME_OUT;
+				b->state = BANK_DONE;
+			}
+			nu_entropy_check(i);
+			return;
+		}
+	}
+	for (k = 0; k < NU_ENTROPY_BANKS; k++)
+	{
+		i = (s_cur + k) % NU_ENTROPY_BANKS;
+		if (s_bank[i].state == BANK_EMPTY)
+		{
+			nu_entropy_fill(i);
+			return;
+		}
+	}
+}
+
+/* Next ready bank from s_cur on, -1 if there is none */
+static int nu_entropy_next(void)
+{
+	int i, k;
+
+	for (i = 0; i < NU_ENTROPY_BANKS; i++)
+		nu_entropy_check(i);
+	for (k = 0; k < NU_ENTROPY_BANKS; k++)
+	{
+		i = (s_cur + k) % NU_ENTROPY_BANKS;
+		if (s_bank[i].state == BANK_READY)
+			return i;
+	}
+	return -1;
+}
+
+static int nu_entropy_start(void)
+{
+	int i;
+
+	if (s_ready)
+		return 0;
+
+	memset(&s_stats, 0, sizeof(s_stats));
+	memset(s_bank, 0, sizeof(s_bank));
+	s_cur = 0;
+
+	if (TSI_TRNG_Init(0, 0) != 0)
+	{
+		s_stats.trngErr++;
+		return MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+	}
+
+	/* No cache line of the banks may be written back over TRNG output */
+	dcache_clean_invalidate_by_mva(s_bankData, sizeof(s_bankData));
+
+	for (i = 0; i < NU_ENTROPY_BANKS; i++)
+		nu_entropy_fill(i);
+	if (nu_entropy_next() < 0)
+		return MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+
+	s_ready = 1;
+	return 0;
+}
+
+int nu_entropy_init(void)
+{
+	int ret;
+
+	nu_entropy_lock();
+	ret = nu_entropy_start();
+	nu_entropy_unlock();
+	return ret;
+}
+
+void nu_entropy_get_stats(nu_entropy_stats *st)
+{
+	int i;
+
+	nu_entropy_lock();
+	*st = s_stats;
+	st->level = 0;
+	for (i = 0; i < NU_ENTROPY_BANKS; i++)
+	{
+		if (s_bank[i].state == BANK_READY)
+			st->level += BANK_BYTES - s_bank[i].pos;
+	}
+	nu_entropy_unlock();
+}
+
+int mbedtls_hardware_poll(void *data, unsigned char *output, size_t len, size_t *olen)
+{
+	nu_entropy_bank *b;
+	uint8_t *p;
+	size_t done = 0, n;
+	int i, tries = 0, waited = 0;
+
+	((void)data);
+	*olen = 0;
+
+	nu_entropy_lock();
+
+	if (nu_entropy_start() != 0)
+	{
+		nu_entropy_unlock();
+		return MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+	}
+	s_stats.polls++;
+
+	/* Completions of the refills, when the driver has no interrupt */
+	TSI_Poll();
+
+	while (done < len)
+	{
+		i = nu_entropy_next();
+		if (i < 0)
+		{
+			/* Pool used up, or every fill failed its checks */
+			if (tries++ >= 2 * NU_ENTROPY_BANKS)
+			{
+				mbedtls_platform_zeroize(output, done);
+				nu_entropy_unlock();
+				return MBEDTLS_ERR_ENTROPY_SOURCE_FAILED;
+			}
+			waited = 1;
+			nu_entropy_wait();
+			continue;
+		}
+
+		s_cur = i;
+		b = &s_bank[i];
+		p = (uint8_t *)nc_ptr(s_bankData[i]) + b->pos;
+		n = BANK_BYTES - b->pos;
+		if (n > len - done)
+			n = len - done;
+		memcpy(output + done, p, n);
+		mbedtls_platform_zeroize(p, n);
+		done += n;
+		b->pos += n;
+		if (b->pos == BANK_BYTES)
+		{
+			b->state = BANK_EMPTY;
+			s_cur = (i + 1) % NU_ENTROPY_BANKS;
+		}
+	}
+
+	nu_entropy_refill();
+
+	if (waited)
+		s_stats.waits++;
+	s_stats.bytes += len;
+	nu_entropy_unlock();
+
+	*olen = len;
+	return 0;
+}
+
+#endif /* MBEDTLS_ENTROPY_C && MBEDTLS_ENTROPY_HARDWARE_ALT */
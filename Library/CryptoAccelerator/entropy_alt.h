@@ -0,0 +1,107 @@
+/**
+ * \file entropy_alt.h
+ *
+ * \brief TSI TRNG entropy source with an asynchronously refilled pool
+ *
+ *  Copyright (c) 2023, Nuvoton Technology Corporation
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_ENTROPY_ALT_H
+#define MBEDTLS_ENTROPY_ALT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * mbedtls_hardware_poll() for MBEDTLS_ENTROPY_HARDWARE_ALT, on the TSI TRNG.
+ *
+ * The entropy is served from NU_ENTROPY_BANKS banks of TRNG output that are
+ * filled ahead of time: nu_entropy_init(), or the first poll, fills them all,
+ * and a bank that has been used up is refilled with one asynchronous
+ * TSI_TRNG_Gen_Random command while the next one is served. A poll only
+ * waits on the TSI when every bank is used up or in flight.
+ *
+ * Every bank passes the SP 800-90B repetition count and adaptive proportion
+ * tests before it is used, for an assessed 4 bits of entropy per byte; a
+ * bank that fails is dropped and counted.
+ *
+ * The TSI completion, in WRHO1_IRQHandler or TSI_Poll(), only hands a
+ * filled bank back; everything else happens under nu_entropy_lock(). The
+ * pool is global, while the mutex of mbedtls_entropy_func() belongs to
+ * each entropy context, so two contexts, or a context and
+ * nu_entropy_init(), can poll at once. The default lock does nothing on
+ * bare metal and takes a FreeRTOS mutex with TSI_USE_FREERTOS; another
+ * RTOS overrides nu_entropy_lock() and nu_entropy_unlock() with its own.
+ */
+
+#define NU_ENTROPY_BANKS        2
+#define NU_ENTROPY_BANK_WORDS   256     /*!< 1 KB per TRNG command */
+
+/* SP 800-90B 4.4 cutoffs for H = 4 bits per byte, alpha = 2^-20 */
+#define NU_ENTROPY_RCT_CUTOFF   6       /*!< identical bytes in a row */
+#define NU_ENTROPY_APT_WINDOW   512
+#define NU_ENTROPY_APT_CUTOFF   62      /*!< first byte value in a window */
+
+/**
+ * \brief          Entropy source counters
+ */
+typedef struct nu_entropy_stats
+{
+	uint64_t  bytes;            /*!< bytes handed out */
+	uint32_t  polls;            /*!< mbedtls_hardware_poll() calls */
+	uint32_t  refills;          /*!< asynchronous bank refills submitted */
+	uint32_t  waits;            /*!< polls that had to wait for the TRNG */
+	uint32_t  rctFail;          /*!< banks dropped by the repetition count test */
+	uint32_t  aptFail;          /*!< banks dropped by the adaptive proportion test */
+	uint32_t  trngErr;          /*!< TRNG commands that failed */
+	uint32_t  level;            /*!< bytes ready in the pool */
+}
+nu_entropy_stats;
+
+/**
+ * \brief          Start the TRNG and fill the pool
+ *
+ *                 Called by the first mbedtls_hardware_poll() if not before.
+ *
+ * \return         0 if successful, MBEDTLS_ERR_ENTROPY_SOURCE_FAILED if the
+ *                 TRNG failed or its output failed the health tests
+ */
+int nu_entropy_init(void);
+
+/**
+ * \brief          Counters since nu_entropy_init()
+ */
+void nu_entropy_get_stats(nu_entropy_stats *st);
+
+/**
+ * \brief          Enter and leave the pool, weak, see above
+ *
+ *                 The section may wait for a TRNG command, so it must be a
+ *                 mutex, not a critical section. It never nests.
+ */
+void nu_entropy_lock(void);
+void nu_entropy_unlock(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBEDTLS_ENTROPY_ALT_H */
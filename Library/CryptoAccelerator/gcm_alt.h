@@ -0,0 +1,63 @@
+/**
+ * \file gcm_alt.h
+ *
+ * \brief Galois/Counter Mode (GCM) for 128-bit block ciphers, with the AES
+ *        operations offloaded to the TSI
+ *
+ *  Copyright (C) 2006-2015, ARM Limited, All Rights Reserved
+ *  Copyright (c) 2023, Nuvoton Technology Corporation
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_GCM_ALT_H
+#define MBEDTLS_GCM_ALT_H
+
+#if defined(MBEDTLS_GCM_ALT)
+
+#include "mbedtls/aes.h"
+#include "mbedtls/cipher.h"
+
+#if !defined(MBEDTLS_AES_ALT)
+#error "MBEDTLS_GCM_ALT requires MBEDTLS_AES_ALT"
+#endif
+
+/**
+ * \brief          GCM context structure
+ *
+ *                 With an AES key the one-shot functions run as a single
+ *                 TSI GCM operation on the session of the embedded AES
+ *                 context. The streaming functions and other ciphers use
+ *                 the software GHASH below.
+ */
+typedef struct mbedtls_gcm_context
+{
+	mbedtls_aes_context aes;                               /*!< AES key and TSI session */
+	mbedtls_cipher_context_t MBEDTLS_PRIVATE(cipher_ctx);  /*!< Cipher of a non-AES key */
+	int      isAes;                                        /*!< Key is AES, cipher_ctx unused */
+	int      tableReady;                                   /*!< HL/HH hold the multiples of H */
+	uint64_t MBEDTLS_PRIVATE(HL)[16];                      /*!< Precalculated HTable low. */
+	uint64_t MBEDTLS_PRIVATE(HH)[16];                      /*!< Precalculated HTable high. */
+	uint64_t MBEDTLS_PRIVATE(len);                         /*!< The total length of the encrypted data. */
+	uint64_t MBEDTLS_PRIVATE(add_len);                     /*!< The total length of the additional data. */
+	unsigned char MBEDTLS_PRIVATE(base_ectr)[16];          /*!< The first ECTR for tag. */
+	unsigned char MBEDTLS_PRIVATE(y)[16];                  /*!< The Y working value. */
+	unsigned char MBEDTLS_PRIVATE(buf)[16];                /*!< The buf working value. */
+	int MBEDTLS_PRIVATE(mode);                             /*!< MBEDTLS_GCM_ENCRYPT or MBEDTLS_GCM_DECRYPT */
+}
+mbedtls_gcm_context;
+
+#endif /* MBEDTLS_GCM_ALT */
+#endif /* MBEDTLS_GCM_ALT_H */
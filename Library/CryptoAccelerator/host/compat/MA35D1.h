@@ -0,0 +1,67 @@
+/**************************************************************************//**
+ * @file     MA35D1.h
+ *
+ * @brief    Host stand-in for the MA35D1 device header.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __MA35D1_HOST_H__
+#define __MA35D1_HOST_H__
+
+/*
+ * Only what tsi_cmd.c and the mbedTLS ALT port use. The Wormhole 1 block is
+ * a plain structure served by the TSI emulator in tsi_emu.c, which runs the
+ * pending mailbox traffic every time the driver reads the system counter
+ * and also stands in for the GIC calls of the WRHO1 interrupt.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define __I     volatile
+#define __O     volatile
+#define __IO    volatile
+
+#define __aligned(x)        __attribute__((aligned(x)))
+#define __ALIGNED(x)        __attribute__((aligned(x)))
+#define __STATIC_INLINE     static inline
+
+#include "whc_reg.h"
+
+/* Every register access lets the emulated TSI catch up, as the hardware
+   acts on a TXCTL or RXCTL write at once */
+WHC_T *tsi_emu_whc1_access(void);
+#define WHC1                (tsi_emu_whc1_access())
+
+/* 12 MHz system counter */
+uint64_t EL0_GetCurrentPhysicalValue(void);
+
+/* GIC, only the Wormhole 1 interrupt exists */
+typedef int32_t IRQn_ID_t;
+typedef void (*IRQHandler_t)(void);
+
+#define WRHO1_IRQn          61
+
+int32_t IRQ_SetHandler(IRQn_ID_t irqn, IRQHandler_t handler);
+int32_t IRQ_Enable(IRQn_ID_t irqn);
+int32_t IRQ_Disable(IRQn_ID_t irqn);
+
+#define sysprintf           printf
+#define isb()               do { } while (0)
+#define dmb()               __sync_synchronize()
+
+/* The host image is linked below 4 GB and has no non-cacheable alias */
+#define ptr_to_u32(x)       ((uint32_t)(uintptr_t)(x))
+#define nc_ptr(x)           ((void *)(x))
+
+/* TSI DMA reach, the emulator only serves the program image */
+int tsi_emu_dma_ok(const void *p, size_t len);
+#define NU_DMA_ADDR_OK(p, len)  tsi_emu_dma_ok((p), (len))
+
+static inline void dcache_clean_by_mva(void const *addr, size_t len) { (void)addr; (void)len; }
+static inline void dcache_invalidate_by_mva(void const *addr, size_t len) { (void)addr; (void)len; }
+static inline void dcache_clean_invalidate_by_mva(void const *addr, size_t len) { (void)addr; (void)len; }
+
+#endif /* __MA35D1_HOST_H__ */
@@ -0,0 +1,16 @@
+/**************************************************************************//**
+ * @file     NuMicro.h
+ *
+ * @brief    Host stand-in for the MA35D1 peripheral header.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __NUMICRO_HOST_H__
+#define __NUMICRO_HOST_H__
+
+#include "MA35D1.h"
+#include "whc.h"
+#include "tsi_cmd.h"
+
+#endif /* __NUMICRO_HOST_H__ */
@@ -0,0 +1,30 @@
+/**************************************************************************//**
+ * @file     mbedtls_config.h
+ *
+ * @brief    Target mbedTLS configuration with the SHA-256/SHA-512 ALTs, for
+ *           the host build of tsi_sha_test.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __TSI_EMU_SHA_CONFIG_H__
+#define __TSI_EMU_SHA_CONFIG_H__
+
+/*
+ * The target configuration does not allow SHA256_ALT together with the
+ * ECDH/ECDSA ALTs, so a SHA ALT build is the target configuration with
+ * those swapped. Built with this directory first in the include path, as
+ * ref/mbedtls_config.h.
+ */
+#include "../../mbedtls_config.h"
+
+#undef MBEDTLS_ECDH_GEN_PUBLIC_ALT
+#undef MBEDTLS_ECDH_COMPUTE_SHARED_ALT
+#undef MBEDTLS_ECDSA_VERIFY_ALT
+#undef MBEDTLS_ECDSA_SIGN_ALT
+#undef MBEDTLS_ECDSA_GENKEY_ALT
+
+#define MBEDTLS_SHA256_ALT
+#define MBEDTLS_SHA512_ALT
+
+#endif /* __TSI_EMU_SHA_CONFIG_H__ */
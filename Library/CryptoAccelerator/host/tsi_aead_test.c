@@ -0,0 +1,486 @@
+/**************************************************************************//**
+ * @file     tsi_aead_test.c
+ *
+ * @brief    Host test and benchmark of the GCM/CCM ALT port (gcm_alt.c,
+ *           ccm_alt.c) on the TSI emulator.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mbedtls/gcm.h"
+#include "mbedtls/ccm.h"
+
+#include "NuMicro.h"
+#include "tsi_emu.h"
+
+/*
+ * Compares the one-shot and streaming GCM/CCM functions against the software
+ * reference over key sizes, IV/nonce and tag lengths, AAD lengths on both
+ * sides of the TSI header limit (software fallback) and payloads that span
+ * several TSI runs. Checks tag verification failures, in-place operation and
+ * the non-AES ciphers that always run in software. Ends with records/s for
+ * TLS sized records on the TSI path and on the software path.
+ */
+
+#define MAX_MSG         (40000 + 64)
+
+static uint8_t s_pt[MAX_MSG], s_ref[MAX_MSG], s_out[MAX_MSG], s_dec[MAX_MSG];
+static uint8_t s_aad[512];
+static int s_fail;
+
+static uint32_t rnd(void)
+{
+	static uint32_t x = 0x2545F491;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static void rnd_fill(uint8_t *p, size_t len)
+{
+	while (len--)
+		*p++ = (uint8_t)rnd();
+}
+
+static void check(int ok, const char *what, int keybits, size_t ivlen,
+		  size_t alen, size_t len, size_t tlen)
+{
+	if (ok)
+		return;
+	printf("  FAIL: %s AES-%d iv %zu aad %zu len %zu tag %zu\n", what, keybits,
+	       ivlen, alen, len, tlen);
+	s_fail++;
+}
+
+static size_t piece(size_t left)
+{
+	size_t n = (rnd() & 1) ? 1 + rnd() % 40 : 1 + rnd() % 9000;
+
+	return n > left ? left : n;
+}
+
+/*---------------------------------------------------------------------------
+ *  GCM
+ *---------------------------------------------------------------------------*/
+
+static int gcm_stream(mbedtls_gcm_context *ctx, int mode, const uint8_t *iv,
+		      size_t ivlen, const uint8_t *add, size_t alen,
+		      const uint8_t *in, uint8_t *out, size_t len,
+		      uint8_t *tag, size_t tlen)
+{
+	size_t pos, n, olen;
+	int ret;
+
+	ret = mbedtls_gcm_starts(ctx, mode, iv, ivlen);
+	for (pos = 0; (pos < alen) && !ret; pos += n) {
+		n = piece(alen - pos);
+		ret = mbedtls_gcm_update_ad(ctx, add + pos, n);
+	}
+	for (pos = 0; (pos < len) && !ret; pos += n) {
+		n = piece(len - pos);
+		ret = mbedtls_gcm_update(ctx, in + pos, n, out + pos, n, &olen);
+	}
+	if (!ret)
+		ret = mbedtls_gcm_finish(ctx, NULL, 0, &olen, tag, tlen);
+	return ret;
+}
+
+static void test_gcm(void)
+{
+	static const size_t ivlens[] = { 12, 1, 16, 60 };
+	static const size_t alens[] = { 0, 13, 17, 200, 300 };
+	static const size_t lens[] = { 0, 1, 15, 16, 17, 100, 16384, 16385, 40000 };
+	static const size_t tlens[] = { 16, 4, 8, 13 };
+	static mbedtls_gcm_context ctx;
+	uint8_t key[32], iv[64], tag[16], rtag[16];
+	size_t ii, ai, li, ivlen, alen, len, tlen;
+	int kb, ret, inplace;
+
+	printf("GCM sweep ...\n");
+	for (kb = 128; kb <= 256; kb += 64)
+	for (ii = 0; ii < sizeof(ivlens) / sizeof(ivlens[0]); ii++)
+	for (ai = 0; ai < sizeof(alens) / sizeof(alens[0]); ai++)
+	for (li = 0; li < sizeof(lens) / sizeof(lens[0]); li++) {
+		ivlen = ivlens[ii];
+		alen = alens[ai];
+		len = lens[li];
+		tlen = tlens[(ii + ai + li) % 4];
+		inplace = (li & 1);
+
+		rnd_fill(key, sizeof(key));
+		rnd_fill(iv, ivlen);
+		rnd_fill(s_aad, alen);
+		rnd_fill(s_pt, len);
+		ret = tsi_emu_ref_gcm(1, key, kb, iv, ivlen, s_aad, alen, s_pt, s_ref,
+				      len, rtag, tlen);
+		check(ret == 0, "gcm reference", kb, ivlen, alen, len, tlen);
+
+		mbedtls_gcm_init(&ctx);
+		ret = mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, kb);
+
+		/* one-shot seal */
+		memcpy(s_out, s_pt, len);
+		ret |= mbedtls_gcm_crypt_and_tag(&ctx, MBEDTLS_GCM_ENCRYPT, len, iv,
+						 ivlen, s_aad, alen,
+						 inplace ? s_out : s_pt, s_out,
+						 tlen, tag);
+		check(ret == 0 && !memcmp(s_out, s_ref, len) && !memcmp(tag, rtag, tlen),
+		      "gcm seal", kb, ivlen, alen, len, tlen);
+
+		/* one-shot open */
+		memcpy(s_dec, s_ref, len);
+		ret = mbedtls_gcm_auth_decrypt(&ctx, len, iv, ivlen, s_aad, alen,
+					       rtag, tlen, inplace ? s_dec : s_ref,
+					       s_dec);
+		check(ret == 0 && !memcmp(s_dec, s_pt, len), "gcm open",
+		      kb, ivlen, alen, len, tlen);
+
+		/* forged tag */
+		rtag[rnd() % tlen] ^= 1 << (rnd() % 8);
+		ret = mbedtls_gcm_auth_decrypt(&ctx, len, iv, ivlen, s_aad, alen,
+					       rtag, tlen, s_ref, s_dec);
+		check(ret == MBEDTLS_ERR_GCM_AUTH_FAILED, "gcm forged tag",
+		      kb, ivlen, alen, len, tlen);
+
+		/* streaming, random pieces */
+		if (len <= 17 || li == 6) {
+			ret = gcm_stream(&ctx, MBEDTLS_GCM_ENCRYPT, iv, ivlen, s_aad,
+					 alen, s_pt, s_out, len, tag, tlen);
+			tsi_emu_ref_gcm(1, key, kb, iv, ivlen, s_aad, alen, s_pt,
+					s_ref, len, rtag, tlen);
+			check(ret == 0 && !memcmp(s_out, s_ref, len) &&
+			      !memcmp(tag, rtag, tlen), "gcm stream",
+			      kb, ivlen, alen, len, tlen);
+		}
+		mbedtls_gcm_free(&ctx);
+	}
+
+	/* Tag lengths the API rejects */
+	mbedtls_gcm_init(&ctx);
+	mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, 128);
+	ret = mbedtls_gcm_crypt_and_tag(&ctx, MBEDTLS_GCM_ENCRYPT, 16, iv, 12,
+					NULL, 0, s_pt, s_out, 3, tag);
+	check(ret == MBEDTLS_ERR_GCM_BAD_INPUT, "gcm tag 3", 128, 12, 0, 16, 3);
+	ret = mbedtls_gcm_crypt_and_tag(&ctx, MBEDTLS_GCM_ENCRYPT, 16, iv, 12,
+					NULL, 0, s_pt, s_out, 17, tag);
+	check(ret == MBEDTLS_ERR_GCM_BAD_INPUT, "gcm tag 17", 128, 12, 0, 16, 17);
+	mbedtls_gcm_free(&ctx);
+}
+
+/*---------------------------------------------------------------------------
+ *  CCM
+ *---------------------------------------------------------------------------*/
+
+static int ccm_stream(mbedtls_ccm_context *ctx, int mode, const uint8_t *iv,
+		      size_t ivlen, const uint8_t *add, size_t alen,
+		      const uint8_t *in, uint8_t *out, size_t len,
+		      uint8_t *tag, size_t tlen)
+{
+	size_t pos, n, olen;
+	int ret;
+
+	ret = mbedtls_ccm_starts(ctx, mode, iv, ivlen);
+	if (!ret)
+		ret = mbedtls_ccm_set_lengths(ctx, alen, len, tlen);
+	for (pos = 0; (pos < alen) && !ret; pos += n) {
+		n = piece(alen - pos);
+		ret = mbedtls_ccm_update_ad(ctx, add + pos, n);
+	}
+	for (pos = 0; (pos < len) && !ret; pos += n) {
+		n = piece(len - pos);
+		ret = mbedtls_ccm_update(ctx, in + pos, n, out + pos, n, &olen);
+	}
+	if (!ret)
+		ret = mbedtls_ccm_finish(ctx, tag, tlen);
+	return ret;
+}
+
+static void test_ccm(void)
+{
+	static const size_t alens[] = { 0, 13, 14, 200, 300 };
+	static const size_t lens[] = { 0, 1, 15, 16, 17, 100, 16384, 16385, 40000 };
+	static mbedtls_ccm_context ctx;
+	uint8_t key[32], iv[16], tag[16], rtag[16];
+	size_t nl, ai, li, alen, len, tlen;
+	int kb, ret, inplace;
+
+	printf("CCM sweep ...\n");
+	for (kb = 128; kb <= 256; kb += 64)
+	for (nl = 7; nl <= 13; nl++)
+	for (ai = 0; ai < sizeof(alens) / sizeof(alens[0]); ai++)
+	for (li = 0; li < sizeof(lens) / sizeof(lens[0]); li++) {
+		alen = alens[ai];
+		len = lens[li];
+		tlen = 4 + 2 * ((nl + ai + li) % 7);
+		inplace = (li & 1);
+
+		rnd_fill(key, sizeof(key));
+		rnd_fill(iv, nl);
+		rnd_fill(s_aad, alen);
+		rnd_fill(s_pt, len);
+		ret = tsi_emu_ref_ccm(1, key, kb, iv, nl, s_aad, alen, s_pt, s_ref,
+				      len, rtag, tlen);
+		check(ret == 0, "ccm reference", kb, nl, alen, len, tlen);
+
+		mbedtls_ccm_init(&ctx);
+		ret = mbedtls_ccm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, kb);
+
+		memcpy(s_out, s_pt, len);
+		ret |= mbedtls_ccm_encrypt_and_tag(&ctx, len, iv, nl, s_aad, alen,
+						   inplace ? s_out : s_pt, s_out,
+						   tag, tlen);
+		check(ret == 0 && !memcmp(s_out, s_ref, len) && !memcmp(tag, rtag, tlen),
+		      "ccm seal", kb, nl, alen, len, tlen);
+
+		memcpy(s_dec, s_ref, len);
+		ret = mbedtls_ccm_auth_decrypt(&ctx, len, iv, nl, s_aad, alen,
+					       inplace ? s_dec : s_ref, s_dec,
+					       rtag, tlen);
+		check(ret == 0 && !memcmp(s_dec, s_pt, len), "ccm open",
+		      kb, nl, alen, len, tlen);
+
+		rtag[rnd() % tlen] ^= 1 << (rnd() % 8);
+		ret = mbedtls_ccm_auth_decrypt(&ctx, len, iv, nl, s_aad, alen,
+					       s_ref, s_dec, rtag, tlen);
+		check(ret == MBEDTLS_ERR_CCM_AUTH_FAILED, "ccm forged tag",
+		      kb, nl, alen, len, tlen);
+
+		if (len <= 17 || li == 6) {
+			ret = ccm_stream(&ctx, MBEDTLS_CCM_ENCRYPT, iv, nl, s_aad,
+					 alen, s_pt, s_out, len, tag, tlen);
+			tsi_emu_ref_ccm(1, key, kb, iv, nl, s_aad, alen, s_pt, s_ref,
+					len, rtag, tlen);
+			check(ret == 0 && !memcmp(s_out, s_ref, len) &&
+			      !memcmp(tag, rtag, tlen), "ccm stream",
+			      kb, nl, alen, len, tlen);
+		}
+
+		/* CCM* without tag runs in software */
+		if (li < 6) {
+			ret = mbedtls_ccm_star_encrypt_and_tag(&ctx, len, iv, nl, s_aad,
+							       alen, s_pt, s_out,
+							       tag, 0);
+			tsi_emu_ref_ccm(1, key, kb, iv, nl, s_aad, alen, s_pt, s_ref,
+					len, rtag, 0);
+			check(ret == 0 && !memcmp(s_out, s_ref, len), "ccm* no tag",
+			      kb, nl, alen, len, 0);
+		}
+		mbedtls_ccm_free(&ctx);
+	}
+
+	/* Parameters the API rejects */
+	mbedtls_ccm_init(&ctx);
+	mbedtls_ccm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, 128);
+	ret = mbedtls_ccm_encrypt_and_tag(&ctx, 16, iv, 12, NULL, 0, s_pt, s_out,
+					  tag, 0);
+	check(ret == MBEDTLS_ERR_CCM_BAD_INPUT, "ccm tag 0", 128, 12, 0, 16, 0);
+	ret = mbedtls_ccm_encrypt_and_tag(&ctx, 16, iv, 12, NULL, 0, s_pt, s_out,
+					  tag, 5);
+	check(ret == MBEDTLS_ERR_CCM_BAD_INPUT, "ccm tag 5", 128, 12, 0, 16, 5);
+	ret = mbedtls_ccm_encrypt_and_tag(&ctx, 16, iv, 6, NULL, 0, s_pt, s_out,
+					  tag, 8);
+	check(ret == MBEDTLS_ERR_CCM_BAD_INPUT, "ccm nonce 6", 128, 6, 0, 16, 8);
+	ret = mbedtls_ccm_encrypt_and_tag(&ctx, 70000, iv, 13, NULL, 0, s_pt,
+					  s_out, tag, 8);
+	check(ret == MBEDTLS_ERR_CCM_BAD_INPUT, "ccm q overflow", 128, 13, 0, 70000, 8);
+	mbedtls_ccm_free(&ctx);
+}
+
+/*---------------------------------------------------------------------------
+ *  Other ciphers: software only, one-shot must match streaming
+ *---------------------------------------------------------------------------*/
+
+static void test_other_ciphers(void)
+{
+	static mbedtls_gcm_context gcm;
+	static mbedtls_ccm_context ccm;
+	uint8_t key[32], iv[12], tag[16], tag2[16];
+	size_t len = 1000;
+	struct tsi_emu_stats es;
+	int ret;
+
+	printf("ARIA-GCM / CAMELLIA-CCM ...\n");
+	rnd_fill(key, sizeof(key));
+	rnd_fill(iv, sizeof(iv));
+	rnd_fill(s_aad, 20);
+	rnd_fill(s_pt, len);
+	tsi_emu_reset_stats();
+
+	mbedtls_gcm_init(&gcm);
+	ret = mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_ARIA, key, 256);
+	ret |= mbedtls_gcm_crypt_and_tag(&gcm, MBEDTLS_GCM_ENCRYPT, len, iv, 12,
+					 s_aad, 20, s_pt, s_out, 16, tag);
+	ret |= gcm_stream(&gcm, MBEDTLS_GCM_ENCRYPT, iv, 12, s_aad, 20, s_pt,
+			  s_ref, len, tag2, 16);
+	ret |= mbedtls_gcm_auth_decrypt(&gcm, len, iv, 12, s_aad, 20, tag, 16,
+					s_out, s_dec);
+	check(ret == 0 && !memcmp(s_out, s_ref, len) && !memcmp(tag, tag2, 16) &&
+	      !memcmp(s_dec, s_pt, len), "aria gcm", 256, 12, 20, len, 16);
+	mbedtls_gcm_free(&gcm);
+
+	mbedtls_ccm_init(&ccm);
+	ret = mbedtls_ccm_setkey(&ccm, MBEDTLS_CIPHER_ID_CAMELLIA, key, 128);
+	ret |= mbedtls_ccm_encrypt_and_tag(&ccm, len, iv, 12, s_aad, 20, s_pt,
+					   s_out, tag, 8);
+	ret |= ccm_stream(&ccm, MBEDTLS_CCM_ENCRYPT, iv, 12, s_aad, 20, s_pt,
+			  s_ref, len, tag2, 8);
+	ret |= mbedtls_ccm_auth_decrypt(&ccm, len, iv, 12, s_aad, 20, s_out,
+					s_dec, tag, 8);
+	check(ret == 0 && !memcmp(s_out, s_ref, len) && !memcmp(tag, tag2, 8) &&
+	      !memcmp(s_dec, s_pt, len), "camellia ccm", 128, 12, 20, len, 8);
+	mbedtls_ccm_free(&ccm);
+
+	tsi_emu_get_stats(&es);
+	check(es.cmds == 0, "non-AES used the TSI", 0, 0, 0, 0, 0);
+}
+
+/*---------------------------------------------------------------------------
+ *  Records/s
+ *---------------------------------------------------------------------------*/
+
+enum {
+	P_TSI,          /* one-shot, TSI_AES_GCM_Run */
+	P_SW_TSI_AES,   /* streaming API: software GHASH/CBC-MAC, TSI AES blocks */
+	P_SW,           /* plain software mbedTLS */
+	P_NUM
+};
+
+static const char *const s_path_name[P_NUM] = {
+	"TSI one-shot", "SW MAC+TSI AES", "software"
+};
+
+static void put_be64(uint64_t v, uint8_t *p)
+{
+	int i;
+
+	for (i = 7; i >= 0; i--, v >>= 8)
+		p[i] = (uint8_t)v;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* TLS 1.2 AES-GCM record: 8-byte explicit nonce + 4-byte salt, 13-byte AAD */
+static int seal_record(int path, int is_ccm, void *ctx, const uint8_t *key,
+		       uint64_t seq, size_t len, uint8_t *tag)
+{
+	uint8_t iv[12], aad[13];
+
+	memset(iv, 0xA5, 4);
+	put_be64(seq, iv + 4);
+	memset(aad, 0, sizeof(aad));
+	put_be64(seq, aad);
+	aad[8] = 23;
+	aad[9] = 3;
+	aad[10] = 3;
+	aad[11] = (uint8_t)(len >> 8);
+	aad[12] = (uint8_t)len;
+
+	switch (path) {
+	case P_TSI:
+		return is_ccm ?
+		       mbedtls_ccm_encrypt_and_tag(ctx, len, iv, 12, aad, 13, s_pt,
+						   s_out, tag, 16) :
+		       mbedtls_gcm_crypt_and_tag(ctx, MBEDTLS_GCM_ENCRYPT, len, iv, 12,
+						 aad, 13, s_pt, s_out, 16, tag);
+	case P_SW_TSI_AES:
+		return is_ccm ?
+		       ccm_stream(ctx, MBEDTLS_CCM_ENCRYPT, iv, 12, aad, 13, s_pt,
+				  s_out, len, tag, 16) :
+		       gcm_stream(ctx, MBEDTLS_GCM_ENCRYPT, iv, 12, aad, 13, s_pt,
+				  s_out, len, tag, 16);
+	default:
+		return is_ccm ?
+		       tsi_emu_ref_ccm(1, key, 128, iv, 12, aad, 13, s_pt, s_out,
+				       len, tag, 16) :
+		       tsi_emu_ref_gcm(1, key, 128, iv, 12, aad, 13, s_pt, s_out,
+				       len, tag, 16);
+	}
+}
+
+static void bench(void)
+{
+	static const size_t lens[] = { 64, 1024, 16384 };
+	static mbedtls_gcm_context gcm;
+	static mbedtls_ccm_context ccm;
+	struct tsi_emu_stats es;
+	uint8_t key[16], tag[16];
+	double t0, t;
+	size_t li;
+	int path, is_ccm, i, n, ret = 0;
+
+	rnd_fill(key, sizeof(key));
+	rnd_fill(s_pt, 16384);
+
+	printf("\nAES-128 records/s on this host (emulated TSI), and TSI round trips per record\n");
+	printf("%-4s %-18s", "", "path");
+	for (li = 0; li < 3; li++)
+		printf(" %9zu B %6s", lens[li], "rt");
+	printf("\n");
+
+	for (is_ccm = 0; is_ccm < 2; is_ccm++)
+	for (path = 0; path < P_NUM; path++) {
+		printf("%-4s %-18s", is_ccm ? "CCM" : "GCM", s_path_name[path]);
+		for (li = 0; li < 3; li++) {
+			mbedtls_gcm_init(&gcm);
+			mbedtls_ccm_init(&ccm);
+			ret |= mbedtls_gcm_setkey(&gcm, MBEDTLS_CIPHER_ID_AES, key, 128);
+			ret |= mbedtls_ccm_setkey(&ccm, MBEDTLS_CIPHER_ID_AES, key, 128);
+
+			/* session, key and mode are set up by the first record */
+			ret |= seal_record(path, is_ccm, is_ccm ? (void *)&ccm : (void *)&gcm,
+					   key, 0, lens[li], tag);
+			n = (lens[li] >= 16384) ? 200 : 2000;
+			if (path == P_SW_TSI_AES)
+				n /= 10;
+			tsi_emu_reset_stats();
+			t0 = now();
+			for (i = 1; i <= n; i++)
+				ret |= seal_record(path, is_ccm,
+						   is_ccm ? (void *)&ccm : (void *)&gcm,
+						   key, i, lens[li], tag);
+			t = now() - t0;
+			tsi_emu_get_stats(&es);
+			printf(" %11.0f %6.1f", n / t, (double)es.cmds / n);
+
+			mbedtls_gcm_free(&gcm);
+			mbedtls_ccm_free(&ccm);
+		}
+		printf("\n");
+	}
+	check(ret == 0, "benchmark call", 128, 12, 13, 0, 16);
+}
+
+int main(void)
+{
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	if (mbedtls_gcm_self_test(1) != 0) {
+		printf("mbedtls_gcm_self_test failed\n");
+		s_fail++;
+	}
+	if (mbedtls_ccm_self_test(1) != 0) {
+		printf("mbedtls_ccm_self_test failed\n");
+		s_fail++;
+	}
+
+	test_gcm();
+	test_ccm();
+	test_other_ciphers();
+	bench();
+
+	printf("\n%s (%d failures)\n", s_fail ? "FAILED" : "PASSED", s_fail);
+	return s_fail ? 1 : 0;
+}
@@ -0,0 +1,348 @@
+/**************************************************************************//**
+ * @file     tsi_aes_test.c
+ *
+ * @brief    Host test of the AES ALT port (aes_alt.c) on the TSI emulator.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mbedtls/aes.h"
+
+#include "NuMicro.h"
+#include "tsi_emu.h"
+
+/*
+ * Compares aes_alt.c against the software reference for every mode, key
+ * size and a set of awkward lengths, with the message fed in random pieces,
+ * in place and out of place. Then exercises the session cache: more live
+ * contexts than cached sessions, a TSI that runs out of sessions, key
+ * changes in the middle of a stream and contexts reused at the same address.
+ * Ends with the number of TSI round trips per call.
+ */
+
+#define MAX_MSG         (10000 + 64)
+
+enum {
+	T_ECB, T_CBC, T_CFB128, T_CFB8, T_CTR, T_OFB, T_NUM
+};
+
+static const char *const s_mode_name[T_NUM] = {
+	"ECB", "CBC", "CFB128", "CFB8", "CTR", "OFB"
+};
+
+static const int s_ref_mode[T_NUM] = {
+	AES_MODE_ECB, AES_MODE_CBC, AES_MODE_CFB, TSI_EMU_REF_CFB8,
+	AES_MODE_CTR, AES_MODE_OFB
+};
+
+/* Stream state of one mbedtls call sequence */
+struct stream {
+	mbedtls_aes_context ctx;
+	int mode;
+	int encrypt;
+	uint8_t iv[16];
+	uint8_t sb[16];
+	size_t off;
+};
+
+static uint8_t s_pt[MAX_MSG], s_ref[MAX_MSG], s_out[MAX_MSG];
+static int s_fail;
+
+static uint32_t rnd(void)
+{
+	static uint32_t x = 0x2545F491;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static void rnd_fill(uint8_t *p, size_t len)
+{
+	while (len--)
+		*p++ = (uint8_t)rnd();
+}
+
+static int block_mode(int mode)
+{
+	return (mode == T_ECB) || (mode == T_CBC);
+}
+
+static int stream_setup(struct stream *st, int mode, int encrypt,
+			const uint8_t *key, int keybits, const uint8_t iv[16])
+{
+	mbedtls_aes_init(&st->ctx);
+	st->mode = mode;
+	st->encrypt = encrypt;
+	memcpy(st->iv, iv, 16);
+	memset(st->sb, 0, 16);
+	st->off = 0;
+
+	if (encrypt || (mode != T_ECB && mode != T_CBC))
+		return mbedtls_aes_setkey_enc(&st->ctx, key, keybits);
+	return mbedtls_aes_setkey_dec(&st->ctx, key, keybits);
+}
+
+static int stream_run(struct stream *st, const uint8_t *in, uint8_t *out,
+		      size_t len)
+{
+	int op = st->encrypt ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT;
+	size_t i;
+	int ret = 0;
+
+	switch (st->mode) {
+	case T_ECB:
+		for (i = 0; (i < len) && !ret; i += 16)
+			ret = mbedtls_aes_crypt_ecb(&st->ctx, op, in + i, out + i);
+		return ret;
+	case T_CBC:
+		return mbedtls_aes_crypt_cbc(&st->ctx, op, len, st->iv, in, out);
+	case T_CFB128:
+		return mbedtls_aes_crypt_cfb128(&st->ctx, op, len, &st->off, st->iv,
+						in, out);
+	case T_CFB8:
+		return mbedtls_aes_crypt_cfb8(&st->ctx, op, len, st->iv, in, out);
+	case T_CTR:
+		return mbedtls_aes_crypt_ctr(&st->ctx, len, &st->off, st->iv, st->sb,
+					     in, out);
+	case T_OFB:
+		return mbedtls_aes_crypt_ofb(&st->ctx, len, &st->off, st->iv, in, out);
+	default:
+		return -1;
+	}
+}
+
+/* Random piece size; block modes only take whole blocks */
+static size_t piece(int mode, size_t left)
+{
+	size_t n;
+
+	switch (rnd() % 4) {
+	case 0:
+		n = left;
+		break;
+	case 1:
+		n = 1 + rnd() % 33;
+		break;
+	default:
+		n = 1 + rnd() % 5000;
+		break;
+	}
+	if (n > left)
+		n = left;
+	if (block_mode(mode)) {
+		n &= ~(size_t)15;
+		if (n == 0)
+			n = left < 16 ? left : 16;
+	}
+	return n;
+}
+
+static void check(int ok, const char *what, int mode, int keybits, size_t len)
+{
+	if (ok)
+		return;
+	printf("  FAIL: %s %s-%d len %zu\n", what, s_mode_name[mode], keybits, len);
+	s_fail++;
+}
+
+static void test_modes(void)
+{
+	static const size_t lens[] = {
+		0, 1, 15, 16, 17, 100, 4095, 4096, 4097, 10000
+	};
+	static const int keybits[] = { 128, 192, 256 };
+	struct stream st;
+	uint8_t key[32], iv[16];
+	size_t li, len, pos, n;
+	int mode, ki, enc, inplace, ret;
+
+	printf("Mode / key size / length sweep ...\n");
+	for (mode = 0; mode < T_NUM; mode++)
+	for (ki = 0; ki < 3; ki++)
+	for (li = 0; li < sizeof(lens) / sizeof(lens[0]); li++)
+	for (enc = 0; enc < 2; enc++)
+	for (inplace = 0; inplace < 2; inplace++) {
+		len = lens[li];
+		if (block_mode(mode))
+			len &= ~(size_t)15;
+
+		rnd_fill(key, sizeof(key));
+		rnd_fill(iv, sizeof(iv));
+		rnd_fill(s_pt, len);
+
+		ret = tsi_emu_ref_aes(s_ref_mode[mode], enc, key, keybits[ki], iv,
+				      s_pt, s_ref, len);
+		if (ret) {
+			check(0, "reference", mode, keybits[ki], len);
+			continue;
+		}
+
+		ret = stream_setup(&st, mode, enc, key, keybits[ki], iv);
+		memcpy(s_out, s_pt, len);
+		for (pos = 0; (pos < len) && !ret; pos += n) {
+			n = piece(mode, len - pos);
+			ret = stream_run(&st, inplace ? s_out + pos : s_pt + pos,
+					 s_out + pos, n);
+		}
+		mbedtls_aes_free(&st.ctx);
+
+		check(ret == 0, inplace ? "in-place call" : "call",
+		      mode, keybits[ki], len);
+		check(memcmp(s_out, s_ref, len) == 0,
+		      inplace ? "in-place data" : "data", mode, keybits[ki], len);
+	}
+}
+
+/* More contexts than cached sessions, on a TSI with fewer sessions still */
+static void test_eviction(void)
+{
+#define N_CTX   7
+	static struct stream st[N_CTX];
+	static uint8_t ref[N_CTX][MAX_MSG], out[N_CTX][MAX_MSG];
+	static const int modes[N_CTX] = {
+		T_CTR, T_CBC, T_CFB128, T_OFB, T_CFB8, T_ECB, T_CTR
+	};
+	uint8_t key[N_CTX][32], iv[N_CTX][16];
+	size_t len = 3008, pos[N_CTX], n;
+	struct tsi_emu_stats es;
+	int i, round, ret = 0;
+
+	printf("Session eviction, %d contexts on 3 TSI sessions ...\n", N_CTX);
+	tsi_emu_set_max_sessions(3);
+	rnd_fill(s_pt, len);
+
+	for (i = 0; i < N_CTX; i++) {
+		rnd_fill(key[i], 32);
+		rnd_fill(iv[i], 16);
+		tsi_emu_ref_aes(s_ref_mode[modes[i]], 1, key[i], 128 + 64 * (i % 3),
+				iv[i], s_pt, ref[i], len);
+		ret |= stream_setup(&st[i], modes[i], 1, key[i], 128 + 64 * (i % 3),
+				    iv[i]);
+		pos[i] = 0;
+	}
+
+	for (round = 0; round < 400; round++) {
+		i = rnd() % N_CTX;
+		if (pos[i] == len)
+			continue;
+		n = piece(modes[i], len - pos[i]);
+		ret |= stream_run(&st[i], s_pt + pos[i], out[i] + pos[i], n);
+		pos[i] += n;
+	}
+	for (i = 0; i < N_CTX; i++) {
+		if (pos[i] < len)
+			ret |= stream_run(&st[i], s_pt + pos[i], out[i] + pos[i],
+					  len - pos[i]);
+		check(memcmp(out[i], ref[i], len) == 0, "evicted stream",
+		      modes[i], 128 + 64 * (i % 3), len);
+		mbedtls_aes_free(&st[i].ctx);
+	}
+	check(ret == 0, "evicted call", T_CTR, 0, len);
+
+	tsi_emu_get_stats(&es);
+	check(es.sessions == 0, "sessions left open", T_CTR, 0, es.sessions);
+	tsi_emu_set_max_sessions(8);
+#undef N_CTX
+}
+
+/* New key in the middle of a stream, and contexts reused at one address */
+static void test_rekey(void)
+{
+	static mbedtls_aes_context ctx;
+	uint8_t k1[32], k2[32], iv[16], iv2[16], sb[16];
+	size_t off = 0;
+	int ret = 0;
+
+	printf("Key change and context reuse ...\n");
+	rnd_fill(k1, 32);
+	rnd_fill(k2, 32);
+	rnd_fill(iv, 16);
+	rnd_fill(s_pt, 512);
+
+	/* setkey on a context with a live session */
+	memcpy(iv2, iv, 16);
+	mbedtls_aes_init(&ctx);
+	ret |= mbedtls_aes_setkey_enc(&ctx, k1, 256);
+	ret |= mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_ENCRYPT, 256, iv2, s_pt, s_out);
+	tsi_emu_ref_aes(AES_MODE_CBC, 1, k1, 256, iv, s_pt, s_ref, 256);
+	ret |= mbedtls_aes_setkey_enc(&ctx, k2, 128);
+	ret |= mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_ENCRYPT, 256, iv2,
+				     s_pt + 256, s_out + 256);
+	tsi_emu_ref_aes(AES_MODE_CBC, 1, k2, 128, s_ref + 240, s_pt + 256,
+			s_ref + 256, 256);
+	check(memcmp(s_out, s_ref, 512) == 0, "setkey mid-stream", T_CBC, 128, 512);
+
+	/* free + init at the same address */
+	mbedtls_aes_free(&ctx);
+	mbedtls_aes_init(&ctx);
+	ret |= mbedtls_aes_setkey_enc(&ctx, k1, 192);
+	memcpy(iv2, iv, 16);
+	ret |= mbedtls_aes_crypt_ctr(&ctx, 512, &off, iv2, sb, s_pt, s_out);
+	tsi_emu_ref_aes(AES_MODE_CTR, 1, k1, 192, iv, s_pt, s_ref, 512);
+	check(memcmp(s_out, s_ref, 512) == 0, "free/init reuse", T_CTR, 192, 512);
+
+	/* init over a live context without free: must not inherit its key */
+	mbedtls_aes_init(&ctx);
+	ret |= mbedtls_aes_setkey_enc(&ctx, k2, 256);
+	memcpy(iv2, iv, 16);
+	off = 0;
+	ret |= mbedtls_aes_crypt_ctr(&ctx, 512, &off, iv2, sb, s_pt, s_out);
+	tsi_emu_ref_aes(AES_MODE_CTR, 1, k2, 256, iv, s_pt, s_ref, 512);
+	check(memcmp(s_out, s_ref, 512) == 0, "init reuse", T_CTR, 256, 512);
+	mbedtls_aes_free(&ctx);
+
+	check(ret == 0, "rekey call", T_CBC, 0, 0);
+}
+
+static void report_round_trips(void)
+{
+	static const size_t lens[] = { 16, 1024, 65536 };
+	static uint8_t buf[65536];
+	struct tsi_emu_stats es;
+	struct stream st;
+	uint8_t key[16] = { 0 }, iv[16] = { 0 };
+	size_t li, n;
+	int mode, i;
+
+	printf("\nTSI round trips per call (steady state, 16 calls)\n");
+	printf("%-8s %10s %10s %10s\n", "mode", "16 B", "1 KB", "64 KB");
+	for (mode = 0; mode < T_NUM; mode++) {
+		printf("%-8s", s_mode_name[mode]);
+		for (li = 0; li < 3; li++) {
+			n = lens[li];
+			stream_setup(&st, mode, 1, key, 128, iv);
+			stream_run(&st, buf, buf, 16);          /* session + key + mode */
+			tsi_emu_reset_stats();
+			for (i = 0; i < 16; i++)
+				stream_run(&st, buf, buf, n);
+			tsi_emu_get_stats(&es);
+			mbedtls_aes_free(&st.ctx);
+			printf(" %10.1f", (double)es.cmds / 16);
+		}
+		printf("\n");
+	}
+}
+
+int main(void)
+{
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	if (mbedtls_aes_self_test(1) != 0) {
+		printf("mbedtls_aes_self_test failed\n");
+		s_fail++;
+	}
+
+	test_modes();
+	test_eviction();
+	test_rekey();
+	report_round_trips();
+
+	printf("\n%s (%d failures)\n", s_fail ? "FAILED" : "PASSED", s_fail);
+	return s_fail ? 1 : 0;
+}
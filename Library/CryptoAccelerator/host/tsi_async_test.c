@@ -0,0 +1,440 @@
+/**************************************************************************//**
+ * @file     tsi_async_test.c
+ *
+ * @brief    Host test of the asynchronous TSI command queue (TSI_Submit and
+ *           the _Async commands of tsi_cmd.c) on the TSI emulator.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "NuMicro.h"
+#include "tsi_emu.h"
+
+/*
+ * Runs with the emulated TSI executing each command inside the driver call
+ * and again with the pipelined TSI core. Checks that four AES requests on
+ * four sessions complete with their callbacks and match the reference, that
+ * four CBC pieces queued on one session chain like a single run, that error
+ * statuses reach the caller and that a blocking call gets through while the
+ * queue is full. With the pipelined core and some engine latency, also that
+ * requests stay pending, a fifth submit is refused and a time-out recalls
+ * its request, and that a blocking call without time-out waits behind a
+ * full queue. The polling build also checks that the TSI_Lock() hooks are
+ * balanced and never nest.
+ * Built once polling (tsi_async_test) and once with the WRHO1 interrupt
+ * (tsi_async_irq_test). Ends with AES runs/s of the blocking call against
+ * one to four requests in flight, with CPU work between the commands.
+ */
+
+#define NREQ            TSI_ASYNC_MAX
+#define BLK             4096
+#define T_OUT           1000
+
+#if defined(USE_IRQ)
+#define DISPATCH        "IRQ"
+#else
+#define DISPATCH        "poll"
+#endif
+
+static uint8_t s_key[NREQ][32] __attribute__((aligned(32)));
+static uint8_t s_iv[NREQ][16] __attribute__((aligned(32)));
+static uint8_t s_in[NREQ][BLK] __attribute__((aligned(32)));
+static uint8_t s_out[NREQ][BLK] __attribute__((aligned(32)));
+static uint8_t s_ref[NREQ * BLK];
+
+static TSI_REQ_T s_req[NREQ + 1];
+static int s_sid[NREQ];
+static int s_fail;
+
+/* Completion log of the callbacks */
+static int s_done[2 * NREQ];
+static int s_ndone;
+
+/* Internal to tsi_cmd.c, time_out 0 waits forever */
+int tsi_send_command_and_wait(TSI_REQ_T *req, int time_out);
+
+#if !defined(USE_IRQ)
+
+/* Replace the weak hooks of tsi_cmd.c: count the sections, catch nesting */
+static int s_lock_depth;
+static int s_lock_nested;
+static unsigned long s_locks;
+
+void TSI_Lock(void)
+{
+	if (s_lock_depth++)
+		s_lock_nested++;
+	s_locks++;
+}
+
+void TSI_Unlock(void)
+{
+	s_lock_depth--;
+}
+
+#endif
+
+static uint32_t rnd(void)
+{
+	static uint32_t x = 0x2545F491;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static void rnd_fill(uint8_t *p, size_t len)
+{
+	while (len--)
+		*p++ = (uint8_t)rnd();
+}
+
+static void check(int ok, const char *what, const char *name, int ret)
+{
+	if (ok)
+		return;
+	printf("  FAIL: %s %s (ret 0x%x)\n", name, what, (unsigned)ret);
+	s_fail++;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void on_done(TSI_REQ_T *req, void *arg)
+{
+	(void)req;
+	if (s_ndone < (int)(sizeof(s_done) / sizeof(s_done[0])))
+		s_done[s_ndone] = (int)(intptr_t)arg;
+	s_ndone++;
+}
+
+static int aes_setup(int i, int mode, int encrypt)
+{
+	int ret;
+
+	ret = TSI_AES_Set_Key(s_sid[i], AES_KEY_SIZE_128, ptr_to_u32(s_key[i]));
+	if (ret == 0)
+		ret = TSI_AES_Set_IV(s_sid[i], ptr_to_u32(s_iv[i]));
+	if (ret == 0)
+		ret = TSI_AES_Set_Mode(s_sid[i], 1, 1, 1, 1, 0, encrypt, mode,
+				       AES_KEY_SIZE_128, 0, 0);
+	return ret;
+}
+
+static int wait_all(int n)
+{
+	int i, ret = 0;
+
+	for (i = 0; i < n; i++)
+		ret |= TSI_Wait(&s_req[i], T_OUT);
+	return ret;
+}
+
+/*---------------------------------------------------------------------------
+ *  Conformance
+ *---------------------------------------------------------------------------*/
+
+static void test_sessions(const char *name)
+{
+	int i, ret = 0, in_order = 1;
+
+	for (i = 0; i < NREQ; i++) {
+		rnd_fill(s_key[i], 16);
+		rnd_fill(s_iv[i], 16);
+		rnd_fill(s_in[i], BLK);
+		ret |= aes_setup(i, AES_MODE_CBC, 1);
+	}
+	check(ret == 0, "session setup", name, ret);
+
+	s_ndone = 0;
+	for (i = 0; i < NREQ; i++) {
+		ret = TSI_AES_Run_Async(&s_req[i], s_sid[i], 1, BLK, ptr_to_u32(s_in[i]),
+					ptr_to_u32(s_out[i]), on_done, (void *)(intptr_t)i);
+		check(ret == 0, "submit", name, ret);
+	}
+	ret = wait_all(NREQ);
+	check(ret == 0, "completion", name, ret);
+	check(s_ndone == NREQ, "one callback per request", name, s_ndone);
+	for (i = 0; i < NREQ && i < s_ndone; i++)
+		in_order &= (s_done[i] == i);
+	check(in_order, "callbacks in submission order", name, 0);
+
+	for (i = 0; i < NREQ; i++) {
+		tsi_emu_ref_aes(AES_MODE_CBC, 1, s_key[i], 128, s_iv[i], s_in[i], s_ref, BLK);
+		check(!memcmp(s_out[i], s_ref, BLK), "result against the reference", name, i);
+		check(TSI_Req_Status(&s_req[i]) == 0, "status after completion", name,
+		      TSI_Req_Status(&s_req[i]));
+	}
+	check(TSI_Poll() == 0, "nothing left in flight", name, 0);
+}
+
+static void test_chain(const char *name)
+{
+	int i, ret;
+
+	/* Same session, same ACK characteristic: matched in FIFO order */
+	rnd_fill(s_key[0], 16);
+	rnd_fill(s_iv[0], 16);
+	rnd_fill(&s_in[0][0], NREQ * BLK);
+	ret = aes_setup(0, AES_MODE_CBC, 1);
+	check(ret == 0, "chain setup", name, ret);
+
+	s_ndone = 0;
+	for (i = 0; i < NREQ; i++) {
+		ret = TSI_AES_Run_Async(&s_req[i], s_sid[0], i == NREQ - 1, BLK,
+					ptr_to_u32(s_in[i]), ptr_to_u32(s_out[i]),
+					on_done, (void *)(intptr_t)i);
+		check(ret == 0, "chained submit", name, ret);
+	}
+	ret = wait_all(NREQ);
+	check(ret == 0 && s_ndone == NREQ, "chained completion", name, ret);
+
+	tsi_emu_ref_aes(AES_MODE_CBC, 1, s_key[0], 128, s_iv[0], &s_in[0][0], s_ref,
+			NREQ * BLK);
+	check(!memcmp(&s_out[0][0], s_ref, NREQ * BLK), "queued CBC pieces equal one run",
+	      name, 0);
+}
+
+static void test_errors(const char *name, int pipelined)
+{
+	struct tsi_emu_stats es;
+	uint32_t ver;
+	int i, ret, sid;
+
+	/* Error status of one request does not disturb its neighbours */
+	for (i = 0; i < NREQ; i++)
+		aes_setup(i, AES_MODE_ECB, 1);
+	s_ndone = 0;
+	for (i = 0; i < NREQ; i++) {
+		sid = (i == 1) ? 0xff : s_sid[i];
+		ret = TSI_AES_Run_Async(&s_req[i], sid, 1, BLK, ptr_to_u32(s_in[i]),
+					ptr_to_u32(s_out[i]), on_done, (void *)(intptr_t)i);
+		check(ret == 0, "submit", name, ret);
+	}
+	for (i = 0; i < NREQ; i++) {
+		ret = TSI_Wait(&s_req[i], T_OUT);
+		if (i == 1)
+			check(ret != 0 && ret != ST_CMD_ACK_TIME_OUT && ret != ST_REQ_PENDING,
+			      "error status of a bad session", name, ret);
+		else
+			check(ret == 0, "neighbours of a failed request", name, ret);
+	}
+	check(s_ndone == NREQ, "callbacks of failed requests", name, s_ndone);
+
+	/* A blocking call waits for a free slot behind a full queue */
+	for (i = 0; i < NREQ; i++)
+		TSI_AES_Run_Async(&s_req[i], s_sid[i], 1, BLK, ptr_to_u32(s_in[i]),
+				  ptr_to_u32(s_out[i]), NULL, NULL);
+	ret = TSI_Get_Version(&ver);
+	check(ret == 0, "blocking call behind a full queue", name, ret);
+	ret = wait_all(NREQ);
+	check(ret == 0, "queue drained", name, ret);
+
+	if (!pipelined)
+		return;
+
+	/* Pending until the TSI core answers, no fifth request meanwhile */
+	tsi_emu_set_latency(20000);
+	tsi_emu_reset_stats();
+	for (i = 0; i < NREQ; i++) {
+		ret = TSI_AES_Run_Async(&s_req[i], s_sid[i], 1, BLK, ptr_to_u32(s_in[i]),
+					ptr_to_u32(s_out[i]), NULL, NULL);
+		check(ret == 0, "submit", name, ret);
+		ret = TSI_Req_Status(&s_req[i]);
+		check(ret == ST_REQ_PENDING, "pending while in flight", name, ret);
+	}
+	ret = TSI_AES_Run_Async(&s_req[NREQ], s_sid[0], 1, BLK, ptr_to_u32(s_in[0]),
+				ptr_to_u32(s_out[0]), NULL, NULL);
+	check(ret == ST_WHC_TX_BUSY, "submit beyond the queue depth refused", name, ret);
+	ret = wait_all(NREQ);
+	check(ret == 0, "completion after latency", name, ret);
+	tsi_emu_get_stats(&es);
+	check(es.queue_peak == NREQ, "requests queued in the TSI", name, es.queue_peak);
+
+	/* Time-out recalls the request, its late ACK is dropped */
+	tsi_emu_set_latency(50000);
+	ret = TSI_AES_Run_Async(&s_req[0], s_sid[0], 1, BLK, ptr_to_u32(s_in[0]),
+				ptr_to_u32(s_out[0]), NULL, NULL);
+	check(ret == 0, "submit", name, ret);
+	ret = TSI_Wait(&s_req[0], 5);
+	check(ret == ST_CMD_ACK_TIME_OUT, "time-out", name, ret);
+	check(TSI_Poll() == 0, "timed-out request removed", name, 0);
+
+	/* Without time-out a blocking call waits for a channel, however long */
+	tsi_emu_set_latency(20000);
+	for (i = 0; i < NREQ; i++)
+		TSI_AES_Run_Async(&s_req[i], s_sid[i], 1, BLK, ptr_to_u32(s_in[i]),
+				  ptr_to_u32(s_out[i]), NULL, NULL);
+	memset(&s_req[NREQ], 0, sizeof(s_req[NREQ]));
+	s_req[NREQ].cmd[0] = CMD_TSI_GET_VERSION << 16;
+	ret = tsi_send_command_and_wait(&s_req[NREQ], 0);
+	check(ret == 0, "blocking call without time-out behind a full queue", name, ret);
+	ret = wait_all(NREQ);
+	check(ret == 0, "queue drained", name, ret);
+
+	tsi_emu_set_latency(0);
+	usleep(80000);
+	TSI_Poll();
+	check((WHC1->RXSTS & 0xf) == 0, "late ACK released", name, WHC1->RXSTS);
+	ret = TSI_Get_Version(&ver);
+	check(ret == 0, "command after a time-out", name, ret);
+}
+
+static void test_mode(int pipelined)
+{
+	const char *name = pipelined ? "pipelined" : "inline";
+	struct tsi_emu_stats es;
+	int i, ret;
+
+	printf("%s TSI, %s dispatch ...\n", name, DISPATCH);
+	tsi_emu_set_pipelined(pipelined);
+	tsi_emu_reset_stats();
+
+	for (i = 0; i < NREQ; i++) {
+		ret = TSI_Open_Session(C_CODE_AES, &s_sid[i]);
+		check(ret == 0, "open session", name, ret);
+	}
+
+	test_sessions(name);
+	test_chain(name);
+	test_errors(name, pipelined);
+
+	for (i = 0; i < NREQ; i++)
+		TSI_Close_Session(C_CODE_AES, s_sid[i]);
+
+	tsi_emu_get_stats(&es);
+#if defined(USE_IRQ)
+	check(es.irqs > 0, "completions delivered by WRHO1 interrupt", name, 0);
+#else
+	check(es.irqs == 0, "no interrupt without USE_IRQ", name, (int)es.irqs);
+#endif
+	tsi_emu_set_pipelined(0);
+}
+
+/*---------------------------------------------------------------------------
+ *  Throughput
+ *---------------------------------------------------------------------------*/
+
+#define BENCH_OPS       400
+#define BENCH_LAT_US    100
+#define BENCH_WORK_US   60
+
+/* Stands in for the application preparing the next buffer */
+static void cpu_work(void)
+{
+	double t0 = now();
+
+	while (now() - t0 < BENCH_WORK_US * 1e-6)
+		;
+}
+
+static double bench_sync(void)
+{
+	double t0;
+	int i, ret = 0;
+
+	t0 = now();
+	for (i = 0; i < BENCH_OPS; i++) {
+		cpu_work();
+		ret |= TSI_AES_Run(s_sid[i % NREQ], 1, BLK, ptr_to_u32(s_in[i % NREQ]),
+				   ptr_to_u32(s_out[i % NREQ]));
+	}
+	check(ret == 0, "blocking runs", "bench", ret);
+	return now() - t0;
+}
+
+static double bench_async(int depth)
+{
+	double t0;
+	int sent = 0, done = 0, slot, ret = 0;
+
+	t0 = now();
+	while (done < BENCH_OPS) {
+		/* Keep depth requests in flight, work on the next one meanwhile */
+		while (sent < BENCH_OPS && sent - done < depth) {
+			cpu_work();
+			slot = sent % depth;
+			ret |= TSI_AES_Run_Async(&s_req[slot], s_sid[slot], 1, BLK,
+						 ptr_to_u32(s_in[slot]), ptr_to_u32(s_out[slot]),
+						 NULL, NULL);
+			sent++;
+		}
+		ret |= TSI_Wait(&s_req[done % depth], T_OUT);
+		done++;
+	}
+	check(ret == 0, "queued runs", "bench", ret);
+	return now() - t0;
+}
+
+static void bench(void)
+{
+	struct tsi_emu_stats es;
+	double t, ts;
+	int i, depth;
+
+	printf("\n%d-byte AES runs/s, TSI latency %d us, %d us of CPU work per run, %s dispatch\n",
+	       BLK, BENCH_LAT_US, BENCH_WORK_US, DISPATCH);
+	printf("%-10s %10s %9s %8s %6s %8s\n", "", "runs/s", "us/run", "speedup", "peak",
+	       "irq/run");
+
+	tsi_emu_set_pipelined(1);
+	tsi_emu_set_latency(BENCH_LAT_US);
+	for (i = 0; i < NREQ; i++) {
+		TSI_Open_Session(C_CODE_AES, &s_sid[i]);
+		aes_setup(i, AES_MODE_ECB, 1);
+	}
+
+	tsi_emu_reset_stats();
+	ts = bench_sync();
+	tsi_emu_get_stats(&es);
+	printf("%-10s %10.0f %9.1f %8.2f %6u %8.2f\n", "blocking", BENCH_OPS / ts,
+	       1e6 * ts / BENCH_OPS, 1.0, es.queue_peak, (double)es.irqs / BENCH_OPS);
+
+	for (depth = 1; depth <= NREQ; depth++) {
+		tsi_emu_reset_stats();
+		t = bench_async(depth);
+		tsi_emu_get_stats(&es);
+		printf("async x%-3d %10.0f %9.1f %8.2f %6u %8.2f\n", depth, BENCH_OPS / t,
+		       1e6 * t / BENCH_OPS, ts / t, es.queue_peak,
+		       (double)es.irqs / BENCH_OPS);
+	}
+
+	for (i = 0; i < NREQ; i++)
+		TSI_Close_Session(C_CODE_AES, s_sid[i]);
+	tsi_emu_set_latency(0);
+	tsi_emu_set_pipelined(0);
+}
+
+int main(void)
+{
+	int ret;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	ret = TSI_Init();
+	check(ret == 0, "TSI_Init", "", ret);
+
+	test_mode(0);
+	test_mode(1);
+	bench();
+
+#if !defined(USE_IRQ)
+	check(s_locks > 0, "TSI_Lock() hook used", "", 0);
+	check(s_lock_depth == 0 && s_lock_nested == 0, "TSI_Lock() balanced, not nested", "", s_lock_nested);
+#endif
+
+	printf("\n%s (%d failures)\n", s_fail ? "FAILED" : "PASSED", s_fail);
+	return s_fail ? 1 : 0;
+}
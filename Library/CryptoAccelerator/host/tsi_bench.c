@@ -0,0 +1,185 @@
+/**************************************************************************//**
+ * @file     tsi_bench.c
+ *
+ * @brief    Host run of the crypto benchmark (crypto_bench.c), on the TSI
+ *           emulator and in software side by side.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "NuMicro.h"
+#include "tsi_emu.h"
+#include "crypto_bench.h"
+
+/*
+ * The library runs twice: built with the ALT port on the emulated TSI, and
+ * built with the software reference (ref_nu_bench_run, renamed like the
+ * rest of the reference, see Makefile). Rows are matched by name and size.
+ *
+ *   tsi_bench [-t ms] [-m max bytes] [-g groups] [-l latency us] [-c]
+ *
+ * -g takes the NU_BENCH_xxx mask, -l runs the TSI pipelined with that much
+ * engine latency per command, -c prints CSV for regression tracking. The
+ * TSI round trips per operation do not depend on the host and are the
+ * column to track; the rates are those of this host and the emulator.
+ */
+
+int ref_nu_bench_run(const nu_bench_cfg *cfg);
+const char *ref_nu_bench_alts(void);
+
+#define ROWS_MAX    160
+
+typedef struct {
+	char name[24];
+	nu_bench_result r;
+} row_t;
+
+typedef struct {
+	row_t row[ROWS_MAX];
+	int n;
+} table_t;
+
+static table_t s_tsi, s_sw;
+
+static uint8_t s_buf[NU_BENCH_BUF_SIZE(NU_BENCH_MAX_SIZE)] __attribute__((aligned(64)));
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void collect(const nu_bench_result *r, void *arg)
+{
+	table_t *t = arg;
+	row_t *row;
+
+	if (t->n >= ROWS_MAX)
+		return;
+	row = &t->row[t->n++];
+	snprintf(row->name, sizeof(row->name), "%s", r->name);
+	row->r = *r;
+	row->r.name = row->name;
+	fprintf(stderr, ".");
+}
+
+static const nu_bench_result *find(const table_t *t, const row_t *key)
+{
+	int i;
+
+	for (i = 0; i < t->n; i++)
+		if (!strcmp(t->row[i].name, key->name) && (t->row[i].r.size == key->r.size))
+			return &t->row[i].r;
+	return NULL;
+}
+
+static void print_table(int csv)
+{
+	const nu_bench_result *t, *s;
+	double x;
+	int i;
+
+	if (csv)
+		printf("op,bytes,tsi_ops_s,tsi_kB_s,tsi_rt_op,sw_ops_s,sw_kB_s\n");
+	else
+		printf("%-18s %8s %10s %10s %8s %10s %10s %7s\n", "", "bytes", "TSI op/s",
+		       "TSI kB/s", "rt/op", "sw op/s", "sw kB/s", "TSI/sw");
+
+	for (i = 0; i < s_tsi.n; i++) {
+		t = &s_tsi.row[i].r;
+		s = find(&s_sw, &s_tsi.row[i]);
+		if (csv) {
+			printf("%s,%u,%u,%u,%u.%02u,%u,%u\n", t->name, t->size, t->opsPerSec,
+			       t->kBPerSec, t->roundTrips100 / 100, t->roundTrips100 % 100,
+			       s ? s->opsPerSec : 0, s ? s->kBPerSec : 0);
+			continue;
+		}
+		if (t->ret) {
+			printf("%-18s %8u  failed -0x%04x\n", t->name, t->size, (unsigned)-t->ret);
+			continue;
+		}
+		printf("%-18s %8u %10u %10u %8.2f", t->name, t->size, t->opsPerSec, t->kBPerSec,
+		       t->roundTrips100 / 100.0);
+		if (!s || s->ret) {
+			/* SHA-3 has no software module */
+			printf(" %10s %10s %7s\n", "-", "-", "-");
+			continue;
+		}
+		x = ((double)t->ops / t->ticks) / ((double)s->ops / s->ticks);
+		printf(" %10u %10u %7.2f\n", s->opsPerSec, s->kBPerSec, x);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	nu_bench_cfg cfg;
+	uint32_t latency = 0;
+	int opt, csv = 0, ret, ret_sw;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.now = now_ns;
+	cfg.tickHz = 1000000000u;
+	cfg.minMs = 50;
+	cfg.maxSize = NU_BENCH_MAX_SIZE;
+	cfg.groups = NU_BENCH_ALL;
+	cfg.buf = s_buf;
+
+	while ((opt = getopt(argc, argv, "t:m:g:l:c")) != -1) {
+		switch (opt) {
+		case 't': cfg.minMs = strtoul(optarg, NULL, 0); break;
+		case 'm': cfg.maxSize = strtoul(optarg, NULL, 0); break;
+		case 'g': cfg.groups = strtoul(optarg, NULL, 0); break;
+		case 'l': latency = strtoul(optarg, NULL, 0); break;
+		case 'c': csv = 1; break;
+		default:
+			fprintf(stderr, "usage: %s [-t ms] [-m max bytes] [-g groups] [-l latency us] [-c]\n",
+				argv[0]);
+			return 2;
+		}
+	}
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	if (TSI_Init() != 0) {
+		fprintf(stderr, "TSI_Init failed\n");
+		return 1;
+	}
+	if (latency) {
+		tsi_emu_set_pipelined(1);
+		tsi_emu_set_latency(latency);
+	}
+
+	if (!csv)
+		printf("ALTs on the emulated TSI (%u us per command): %s, in software: %s\n\n",
+		       latency, nu_bench_alts(), ref_nu_bench_alts());
+
+	cfg.roundTrips = TSI_Get_Cmd_Count;
+	cfg.report = collect;
+	cfg.arg = &s_tsi;
+	ret = nu_bench_run(&cfg);
+
+	cfg.roundTrips = NULL;
+	cfg.arg = &s_sw;
+	ret_sw = ref_nu_bench_run(&cfg);
+	fprintf(stderr, "\n");
+
+	tsi_emu_set_latency(0);
+	tsi_emu_set_pipelined(0);
+
+	print_table(csv);
+
+	if (ret || ret_sw) {
+		fprintf(stderr, "benchmark failed: TSI -0x%04x, software -0x%04x\n",
+			(unsigned)-ret, (unsigned)-ret_sw);
+		return 1;
+	}
+	return 0;
+}
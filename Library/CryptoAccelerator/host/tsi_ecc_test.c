@@ -0,0 +1,549 @@
+/**************************************************************************//**
+ * @file     tsi_ecc_test.c
+ *
+ * @brief    Host test and benchmark of the ECDSA/ECDH ALT port (ecc_alt.c)
+ *           on the TSI emulator.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/md.h"
+
+#include "NuMicro.h"
+#include "tsi_emu.h"
+#include "ecc_alt.h"
+
+/*
+ * For every curve the TSI supports: key generation, deterministic ECDSA
+ * against the software reference (same r and s for hashes shorter and
+ * longer than the order), randomized signatures, verification failures,
+ * invalid public points, ASN.1 signatures and ECDH both ways. Key Store
+ * keys are imported to SRAM, bound from SRAM and OTP, and used for signing
+ * and ECDH. A curve switched off in the emulator checks the software
+ * fallback. Ends with ECDHE-ECDSA handshakes/s on the TSI path and in
+ * software.
+ */
+
+static int s_fail;
+
+static const struct {
+	mbedtls_ecp_group_id gid;
+	int curve;
+	const char *name;
+} s_curves[] = {
+	{ MBEDTLS_ECP_DP_SECP192R1, CURVE_P_192,  "P-192" },
+	{ MBEDTLS_ECP_DP_SECP224R1, CURVE_P_224,  "P-224" },
+	{ MBEDTLS_ECP_DP_SECP256R1, CURVE_P_256,  "P-256" },
+	{ MBEDTLS_ECP_DP_SECP384R1, CURVE_P_384,  "P-384" },
+	{ MBEDTLS_ECP_DP_SECP521R1, CURVE_P_521,  "P-521" },
+	{ MBEDTLS_ECP_DP_SECP192K1, CURVE_KO_192, "secp192k1" },
+	{ MBEDTLS_ECP_DP_SECP224K1, CURVE_KO_224, "secp224k1" },
+	{ MBEDTLS_ECP_DP_SECP256K1, CURVE_KO_256, "secp256k1" },
+	{ MBEDTLS_ECP_DP_BP256R1,   CURVE_BP_256, "BP-256" },
+	{ MBEDTLS_ECP_DP_BP384R1,   CURVE_BP_384, "BP-384" },
+	{ MBEDTLS_ECP_DP_BP512R1,   CURVE_BP_512, "BP-512" },
+};
+
+#define CURVE_NUM   (int)(sizeof(s_curves) / sizeof(s_curves[0]))
+
+/* Hash lengths of SHA-1/224/256/384/512, plus a raw 80-byte value */
+static const struct {
+	size_t len;
+	mbedtls_md_type_t md;
+} s_hashes[] = {
+	{ 20, MBEDTLS_MD_SHA1 },
+	{ 28, MBEDTLS_MD_SHA224 },
+	{ 32, MBEDTLS_MD_SHA256 },
+	{ 48, MBEDTLS_MD_SHA384 },
+	{ 64, MBEDTLS_MD_SHA512 },
+	{ 80, MBEDTLS_MD_SHA256 },
+};
+
+#define PT_MAX      (1 + 2 * MBEDTLS_ECP_MAX_BYTES)
+
+static uint32_t rnd(void)
+{
+	static uint32_t x = 0x2545F491;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static void rnd_fill(uint8_t *p, size_t len)
+{
+	while (len--)
+		*p++ = (uint8_t)rnd();
+}
+
+static int test_rng(void *p, unsigned char *out, size_t len)
+{
+	(void)p;
+	rnd_fill(out, len);
+	return 0;
+}
+
+static void check(int ok, const char *what, const char *curve, int ret)
+{
+	if (ok)
+		return;
+	printf("  FAIL: %s %s (ret -0x%04x)\n", curve, what, (unsigned)-ret);
+	s_fail++;
+}
+
+static size_t nlen_of(const mbedtls_ecp_group *grp)
+{
+	return (grp->nbits + 7) / 8;
+}
+
+static int point_bin(const mbedtls_ecp_group *grp, const mbedtls_ecp_point *P,
+		     uint8_t *buf, size_t *len)
+{
+	return mbedtls_ecp_point_write_binary(grp, P, MBEDTLS_ECP_PF_UNCOMPRESSED,
+					      len, buf, PT_MAX);
+}
+
+/* Q == d * G by the software reference */
+static int ref_pubkey_ok(const mbedtls_ecp_keypair *kp, const mbedtls_mpi *d)
+{
+	uint8_t db[MBEDTLS_ECP_MAX_BYTES], q[PT_MAX], r[PT_MAX];
+	size_t dl = nlen_of(&kp->grp), ql, rl;
+
+	if (mbedtls_mpi_write_binary(d, db, dl) || point_bin(&kp->grp, &kp->Q, q, &ql) ||
+	    tsi_emu_ref_ecp_mul(kp->grp.id, db, dl, NULL, 0, r, sizeof(r), &rl))
+		return 0;
+	return (ql == rl) && !memcmp(q, r, ql);
+}
+
+/* ECDSA signature (r, s) by Q over hash, checked by the software reference */
+static int ref_verify(const mbedtls_ecp_keypair *kp, const uint8_t *hash, size_t hlen,
+		      const mbedtls_mpi *r, const mbedtls_mpi *s)
+{
+	uint8_t q[PT_MAX], rb[MBEDTLS_ECP_MAX_BYTES], sb[MBEDTLS_ECP_MAX_BYTES];
+	size_t ql, nl = nlen_of(&kp->grp);
+
+	if (point_bin(&kp->grp, &kp->Q, q, &ql) || mbedtls_mpi_write_binary(r, rb, nl) ||
+	    mbedtls_mpi_write_binary(s, sb, nl))
+		return -1;
+	return tsi_emu_ref_ecdsa_verify(kp->grp.id, q, ql, hash, hlen, rb, sb, nl);
+}
+
+/*---------------------------------------------------------------------------
+ *  Per curve
+ *---------------------------------------------------------------------------*/
+
+static void test_ecdsa(const char *name, mbedtls_ecdsa_context *a)
+{
+	uint8_t hash[80], rb[MBEDTLS_ECP_MAX_BYTES], sb[MBEDTLS_ECP_MAX_BYTES];
+	uint8_t rr[MBEDTLS_ECP_MAX_BYTES], rs[MBEDTLS_ECP_MAX_BYTES];
+	uint8_t db[MBEDTLS_ECP_MAX_BYTES], sig[MBEDTLS_ECDSA_MAX_LEN];
+	size_t nl = nlen_of(&a->grp), hi, slen;
+	mbedtls_ecp_point Qbad;
+	mbedtls_mpi r, s, t;
+	int ret;
+
+	mbedtls_mpi_init(&r);
+	mbedtls_mpi_init(&s);
+	mbedtls_mpi_init(&t);
+	mbedtls_ecp_point_init(&Qbad);
+	mbedtls_mpi_write_binary(&a->d, db, nl);
+
+	for (hi = 0; hi < sizeof(s_hashes) / sizeof(s_hashes[0]); hi++) {
+		rnd_fill(hash, s_hashes[hi].len);
+
+		/* RFC 6979: the TSI signs with the ephemeral key of the HMAC_DRBG */
+		ret = mbedtls_ecdsa_sign_det_ext(&a->grp, &r, &s, &a->d, hash,
+						 s_hashes[hi].len, s_hashes[hi].md,
+						 test_rng, NULL);
+		ret |= mbedtls_mpi_write_binary(&r, rb, nl);
+		ret |= mbedtls_mpi_write_binary(&s, sb, nl);
+		ret |= tsi_emu_ref_ecdsa_sign_det(a->grp.id, s_hashes[hi].md, db, nl, hash,
+						  s_hashes[hi].len, rr, rs, nl);
+		check(ret == 0 && !memcmp(rb, rr, nl) && !memcmp(sb, rs, nl),
+		      "deterministic signature", name, ret);
+
+		ret = mbedtls_ecdsa_verify(&a->grp, hash, s_hashes[hi].len, &a->Q, &r, &s);
+		check(ret == 0, "verify", name, ret);
+		hash[0] ^= 0x01;    /* only the leftmost nbits of the hash count */
+		ret = mbedtls_ecdsa_verify(&a->grp, hash, s_hashes[hi].len, &a->Q, &r, &s);
+		check(ret == MBEDTLS_ERR_ECP_VERIFY_FAILED, "verify of a changed hash", name, ret);
+	}
+
+	/* Randomized signature, verified by software */
+	rnd_fill(hash, 32);
+	ret = mbedtls_ecdsa_sign(&a->grp, &r, &s, &a->d, hash, 32, test_rng, NULL);
+	check(ret == 0 && ref_verify(a, hash, 32, &r, &s) == 0, "random signature", name, ret);
+
+	/* r, s out of range and Q off the curve */
+	mbedtls_mpi_lset(&t, 0);
+	ret = mbedtls_ecdsa_verify(&a->grp, hash, 32, &a->Q, &t, &s);
+	check(ret == MBEDTLS_ERR_ECP_VERIFY_FAILED, "verify with r = 0", name, ret);
+	ret = mbedtls_ecdsa_verify(&a->grp, hash, 32, &a->Q, &r, &a->grp.N);
+	check(ret == MBEDTLS_ERR_ECP_VERIFY_FAILED, "verify with s = n", name, ret);
+	mbedtls_ecp_copy(&Qbad, &a->Q);
+	mbedtls_mpi_add_int(&Qbad.Y, &Qbad.Y, 1);
+	ret = mbedtls_ecdsa_verify(&a->grp, hash, 32, &Qbad, &r, &s);
+	check(ret == MBEDTLS_ERR_ECP_INVALID_KEY, "verify with Q off the curve", name, ret);
+
+	/* ASN.1 round trip through ecdsa.c */
+	ret = mbedtls_ecdsa_write_signature(a, MBEDTLS_MD_SHA256, hash, 32, sig, sizeof(sig),
+					    &slen, test_rng, NULL);
+	if (ret == 0)
+		ret = mbedtls_ecdsa_read_signature(a, hash, 32, sig, slen);
+	check(ret == 0, "ASN.1 signature", name, ret);
+
+	mbedtls_mpi_free(&r);
+	mbedtls_mpi_free(&s);
+	mbedtls_mpi_free(&t);
+	mbedtls_ecp_point_free(&Qbad);
+}
+
+static void test_ecdh(const char *name, mbedtls_ecdsa_context *a, mbedtls_ecp_keypair *b,
+		      mbedtls_mpi *z)
+{
+	uint8_t db[MBEDTLS_ECP_MAX_BYTES], q[PT_MAX], r[PT_MAX], zb[MBEDTLS_ECP_MAX_BYTES];
+	size_t ql, rl, pl = (a->grp.pbits + 7) / 8, nl = nlen_of(&a->grp);
+	mbedtls_ecp_point Qbad;
+	mbedtls_mpi z2;
+	int ret;
+
+	mbedtls_mpi_init(&z2);
+	mbedtls_ecp_point_init(&Qbad);
+
+	ret = mbedtls_ecp_group_load(&b->grp, a->grp.id);
+	if (ret == 0)
+		ret = mbedtls_ecdh_gen_public(&b->grp, &b->d, &b->Q, test_rng, NULL);
+	check(ret == 0 && ref_pubkey_ok(b, &b->d), "ECDH public key", name, ret);
+
+	ret = mbedtls_ecdh_compute_shared(&a->grp, z, &b->Q, &a->d, test_rng, NULL);
+	ret |= mbedtls_ecdh_compute_shared(&b->grp, &z2, &a->Q, &b->d, test_rng, NULL);
+	check(ret == 0 && !mbedtls_mpi_cmp_mpi(z, &z2), "ECDH shared secret", name, ret);
+
+	/* X of d_a * Q_b by software */
+	mbedtls_mpi_write_binary(&a->d, db, nl);
+	point_bin(&b->grp, &b->Q, q, &ql);
+	ret = tsi_emu_ref_ecp_mul(a->grp.id, db, nl, q, ql, r, sizeof(r), &rl);
+	mbedtls_mpi_write_binary(z, zb, pl);
+	check(ret == 0 && !memcmp(zb, r + 1, pl), "ECDH against software", name, ret);
+
+	mbedtls_ecp_copy(&Qbad, &b->Q);
+	mbedtls_mpi_add_int(&Qbad.X, &Qbad.X, 1);
+	ret = mbedtls_ecdh_compute_shared(&a->grp, &z2, &Qbad, &a->d, test_rng, NULL);
+	check(ret == MBEDTLS_ERR_ECP_INVALID_KEY, "ECDH with an invalid peer point", name, ret);
+
+	mbedtls_mpi_free(&z2);
+	mbedtls_ecp_point_free(&Qbad);
+}
+
+static void test_ks(const char *name, mbedtls_ecdsa_context *a, const mbedtls_ecp_keypair *b,
+		    const mbedtls_mpi *z)
+{
+	__attribute__((aligned(64))) static uint32_t kbuf[18];
+	mbedtls_ecp_keypair ks, kb;
+	mbedtls_mpi r, s, z2;
+	uint8_t hash[32];
+	int ret, knum = -1, mem = -1, kn = -1;
+
+	mbedtls_ecp_keypair_init(&ks);
+	mbedtls_ecp_keypair_init(&kb);
+	mbedtls_mpi_init(&r);
+	mbedtls_mpi_init(&s);
+	mbedtls_mpi_init(&z2);
+
+	/* Import a copy of a's key */
+	ret = mbedtls_ecp_group_copy(&ks.grp, &a->grp);
+	ret |= mbedtls_mpi_copy(&ks.d, &a->d);
+	ret |= mbedtls_ecp_copy(&ks.Q, &a->Q);
+	if (ret == 0)
+		ret = nu_ecc_ks_import(&ks, 0, &knum);
+	check(ret == 0 && nu_ecc_ks_handle(&ks.d, &mem, &kn, NULL) && mem == KS_SRAM &&
+	      kn == knum && mbedtls_mpi_cmp_mpi(&ks.d, &a->d) != 0, "Key Store import", name, ret);
+	check(mbedtls_ecp_check_privkey(&ks.grp, &ks.d) != 0,
+	      "software accepts a Key Store handle", name, 0);
+	ret = TSI_KS_Read(KS_SRAM, knum, kbuf, 18);
+	check(ret == ST_KS_READ_PROTECT, "Key Store key readable", name, ret);
+
+	/* Sign with the Key Store key: TRNG ephemeral key, verified by software */
+	rnd_fill(hash, sizeof(hash));
+	ret = mbedtls_ecdsa_sign(&ks.grp, &r, &s, &ks.d, hash, sizeof(hash), test_rng, NULL);
+	check(ret == 0 && ref_verify(a, hash, sizeof(hash), &r, &s) == 0,
+	      "Key Store signature", name, ret);
+	ret = mbedtls_ecdsa_sign_det_ext(&ks.grp, &r, &s, &ks.d, hash, sizeof(hash),
+					 MBEDTLS_MD_SHA256, test_rng, NULL);
+	check(ret == 0 && ref_verify(a, hash, sizeof(hash), &r, &s) == 0,
+	      "Key Store signature, deterministic API", name, ret);
+
+	ret = mbedtls_ecdh_compute_shared(&ks.grp, &z2, &b->Q, &ks.d, test_rng, NULL);
+	check(ret == 0 && !mbedtls_mpi_cmp_mpi(&z2, z), "Key Store ECDH", name, ret);
+
+	/* Bind the same SRAM key afresh */
+	ret = nu_ecc_ks_bind(&kb, a->grp.id, KS_SRAM, knum, 0);
+	check(ret == 0 && !mbedtls_ecp_point_cmp(&kb.Q, &a->Q), "Key Store bind", name, ret);
+
+	TSI_KS_EraseAll();
+	ret = mbedtls_ecdsa_sign(&kb.grp, &r, &s, &kb.d, hash, sizeof(hash), test_rng, NULL);
+	check(ret == MBEDTLS_ERR_ECP_INVALID_KEY, "signature with an erased key", name, ret);
+
+	mbedtls_ecp_keypair_free(&ks);
+	mbedtls_ecp_keypair_free(&kb);
+	mbedtls_mpi_free(&r);
+	mbedtls_mpi_free(&s);
+	mbedtls_mpi_free(&z2);
+}
+
+static void test_curve(int ci)
+{
+	const char *name = s_curves[ci].name;
+	mbedtls_ecdsa_context a;
+	mbedtls_ecp_keypair b;
+	mbedtls_mpi z;
+	int ret;
+
+	mbedtls_ecdsa_init(&a);
+	mbedtls_ecp_keypair_init(&b);
+	mbedtls_mpi_init(&z);
+
+	ret = mbedtls_ecdsa_genkey(&a, s_curves[ci].gid, test_rng, NULL);
+	check(ret == 0 && ref_pubkey_ok(&a, &a.d), "key generation", name, ret);
+	if (ret == 0) {
+		test_ecdsa(name, &a);
+		test_ecdh(name, &a, &b, &z);
+		test_ks(name, &a, &b, &z);
+	}
+
+	mbedtls_ecdsa_free(&a);
+	mbedtls_ecp_keypair_free(&b);
+	mbedtls_mpi_free(&z);
+}
+
+/*---------------------------------------------------------------------------
+ *  Key Store OTP and software fallback
+ *---------------------------------------------------------------------------*/
+
+static void test_otp(void)
+{
+	__attribute__((aligned(64))) static uint32_t kw[8];
+	mbedtls_ecdsa_context a;
+	mbedtls_ecp_keypair ko;
+	mbedtls_mpi r, s;
+	uint8_t le[32], hash[32];
+	int i, ret;
+
+	mbedtls_ecdsa_init(&a);
+	mbedtls_ecp_keypair_init(&ko);
+	mbedtls_mpi_init(&r);
+	mbedtls_mpi_init(&s);
+
+	ret = mbedtls_ecdsa_genkey(&a, MBEDTLS_ECP_DP_SECP256R1, test_rng, NULL);
+	ret |= mbedtls_mpi_write_binary_le(&a.d, le, sizeof(le));
+	for (i = 0; i < 8; i++)
+		kw[i] = le[4 * i] | (le[4 * i + 1] << 8) | (le[4 * i + 2] << 16) |
+			((uint32_t)le[4 * i + 3] << 24);
+	if (ret == 0)
+		ret = TSI_KS_Write_OTP(3, KS_META_ECC | KS_META_256, kw);
+	if (ret == 0)
+		ret = nu_ecc_ks_bind(&ko, MBEDTLS_ECP_DP_SECP256R1, KS_OTP, 3, 0);
+	check(ret == 0 && !mbedtls_ecp_point_cmp(&ko.Q, &a.Q), "OTP bind", "P-256", ret);
+
+	rnd_fill(hash, sizeof(hash));
+	ret = mbedtls_ecdsa_sign(&ko.grp, &r, &s, &ko.d, hash, sizeof(hash), test_rng, NULL);
+	check(ret == 0 && ref_verify(&a, hash, sizeof(hash), &r, &s) == 0, "OTP signature",
+	      "P-256", ret);
+
+	ret = nu_ecc_ks_bind(&ko, MBEDTLS_ECP_DP_SECP256R1, KS_OTP, 4, 0);
+	check(ret == MBEDTLS_ERR_ECP_INVALID_KEY, "bind of an empty OTP key", "P-256", ret);
+
+	mbedtls_ecdsa_free(&a);
+	mbedtls_ecp_keypair_free(&ko);
+	mbedtls_mpi_free(&r);
+	mbedtls_mpi_free(&s);
+}
+
+static void test_fallback(void)
+{
+	const int ci = CURVE_NUM - 1;
+	const char *name = s_curves[ci].name;
+	struct tsi_emu_stats es;
+	mbedtls_ecdsa_context a;
+	mbedtls_ecp_keypair b;
+	mbedtls_mpi z;
+	int ret;
+
+	printf("%s with the TSI curve switched off ...\n", name);
+	tsi_emu_set_ecc_curve(s_curves[ci].curve, 0);
+
+	mbedtls_ecdsa_init(&a);
+	mbedtls_ecp_keypair_init(&b);
+	mbedtls_mpi_init(&z);
+
+	/* The first command learns that the TSI lacks the curve */
+	ret = mbedtls_ecdsa_genkey(&a, s_curves[ci].gid, test_rng, NULL);
+	check(ret == 0 && ref_pubkey_ok(&a, &a.d), "software key generation", name, ret);
+
+	tsi_emu_reset_stats();
+	test_ecdsa(name, &a);
+	test_ecdh(name, &a, &b, &z);
+	tsi_emu_get_stats(&es);
+	check(es.cmds_class[C_CODE_ECC] == 0, "TSI asked again for the curve", name, 0);
+
+	ret = nu_ecc_ks_import(&a, 0, NULL);
+	check(ret == MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE, "Key Store import", name, ret);
+
+	mbedtls_ecdsa_free(&a);
+	mbedtls_ecp_keypair_free(&b);
+	mbedtls_mpi_free(&z);
+	tsi_emu_set_ecc_curve(s_curves[ci].curve, 1);
+}
+
+/*---------------------------------------------------------------------------
+ *  Handshakes/s
+ *---------------------------------------------------------------------------*/
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Public key operations of one ECDHE-ECDSA handshake, both peers: two
+ * ephemeral keys, the server's ServerKeyExchange signature, its
+ * verification by the client and the two shared secrets. Certificate
+ * chain checks would add one verification per certificate.
+ */
+static int handshake_tsi(const mbedtls_ecdsa_context *srv)
+{
+	mbedtls_ecp_keypair c, s;
+	mbedtls_mpi r, sg, zc, zs;
+	uint8_t hash[32];
+	int ret;
+
+	mbedtls_ecp_keypair_init(&c);
+	mbedtls_ecp_keypair_init(&s);
+	mbedtls_mpi_init(&r);
+	mbedtls_mpi_init(&sg);
+	mbedtls_mpi_init(&zc);
+	mbedtls_mpi_init(&zs);
+	rnd_fill(hash, sizeof(hash));
+
+	ret = mbedtls_ecp_group_load(&c.grp, srv->grp.id);
+	ret |= mbedtls_ecp_group_load(&s.grp, srv->grp.id);
+	ret |= mbedtls_ecdh_gen_public(&s.grp, &s.d, &s.Q, test_rng, NULL);
+	ret |= mbedtls_ecdsa_sign_det_ext((mbedtls_ecp_group *)&srv->grp, &r, &sg, &srv->d,
+					  hash, sizeof(hash), MBEDTLS_MD_SHA256, test_rng, NULL);
+	ret |= mbedtls_ecdsa_verify((mbedtls_ecp_group *)&srv->grp, hash, sizeof(hash),
+				    &srv->Q, &r, &sg);
+	ret |= mbedtls_ecdh_gen_public(&c.grp, &c.d, &c.Q, test_rng, NULL);
+	ret |= mbedtls_ecdh_compute_shared(&c.grp, &zc, &s.Q, &c.d, test_rng, NULL);
+	ret |= mbedtls_ecdh_compute_shared(&s.grp, &zs, &c.Q, &s.d, test_rng, NULL);
+	if (ret == 0 && mbedtls_mpi_cmp_mpi(&zc, &zs))
+		ret = -1;
+
+	mbedtls_ecp_keypair_free(&c);
+	mbedtls_ecp_keypair_free(&s);
+	mbedtls_mpi_free(&r);
+	mbedtls_mpi_free(&sg);
+	mbedtls_mpi_free(&zc);
+	mbedtls_mpi_free(&zs);
+	return ret;
+}
+
+static int handshake_sw(const mbedtls_ecdsa_context *srv)
+{
+	uint8_t dsrv[MBEDTLS_ECP_MAX_BYTES], qsrv[PT_MAX];
+	uint8_t dc[MBEDTLS_ECP_MAX_BYTES], ds[MBEDTLS_ECP_MAX_BYTES];
+	uint8_t qc[PT_MAX], qs[PT_MAX], zc[PT_MAX], zs[PT_MAX];
+	uint8_t r[MBEDTLS_ECP_MAX_BYTES], s[MBEDTLS_ECP_MAX_BYTES], hash[32];
+	size_t nl = nlen_of(&srv->grp), ql, qcl, qsl, zcl, zsl;
+	int gid = srv->grp.id, ret;
+
+	rnd_fill(hash, sizeof(hash));
+	ret = mbedtls_mpi_write_binary(&srv->d, dsrv, nl);
+	ret |= point_bin(&srv->grp, &srv->Q, qsrv, &ql);
+
+	/* Ephemeral keys below n: one byte shorter than the order */
+	rnd_fill(ds, nl);
+	rnd_fill(dc, nl);
+	ds[0] = dc[0] = 0;
+
+	ret |= tsi_emu_ref_ecp_mul(gid, ds, nl, NULL, 0, qs, sizeof(qs), &qsl);
+	ret |= tsi_emu_ref_ecdsa_sign_det(gid, MBEDTLS_MD_SHA256, dsrv, nl, hash,
+					  sizeof(hash), r, s, nl);
+	ret |= tsi_emu_ref_ecdsa_verify(gid, qsrv, ql, hash, sizeof(hash), r, s, nl);
+	ret |= tsi_emu_ref_ecp_mul(gid, dc, nl, NULL, 0, qc, sizeof(qc), &qcl);
+	ret |= tsi_emu_ref_ecp_mul(gid, dc, nl, qs, qsl, zc, sizeof(zc), &zcl);
+	ret |= tsi_emu_ref_ecp_mul(gid, ds, nl, qc, qcl, zs, sizeof(zs), &zsl);
+	if (ret == 0 && ((zcl != zsl) || memcmp(zc, zs, zcl)))
+		ret = -1;
+	return ret;
+}
+
+static void bench(void)
+{
+	static const int bench_curves[] = { 2, 3, 4 };      /* P-256, P-384, P-521 */
+	struct tsi_emu_stats es;
+	mbedtls_ecdsa_context srv;
+	double t0, t_tsi, t_sw;
+	int bi, i, n, ret = 0;
+
+	printf("\nECDHE-ECDSA handshakes/s on this host (emulated TSI), and TSI round trips\n");
+	printf("per handshake (2 key generations, 1 signature, 1 verification, 2 ECDH)\n");
+	printf("%-10s %12s %12s %6s\n", "curve", "TSI path", "software", "rt");
+
+	for (bi = 0; bi < (int)(sizeof(bench_curves) / sizeof(bench_curves[0])); bi++) {
+		int ci = bench_curves[bi];
+
+		mbedtls_ecdsa_init(&srv);
+		ret |= mbedtls_ecdsa_genkey(&srv, s_curves[ci].gid, test_rng, NULL);
+		n = (ci == 4) ? 20 : 50;
+
+		ret |= handshake_tsi(&srv);
+		tsi_emu_reset_stats();
+		t0 = now();
+		for (i = 0; i < n; i++)
+			ret |= handshake_tsi(&srv);
+		t_tsi = now() - t0;
+		tsi_emu_get_stats(&es);
+
+		t0 = now();
+		for (i = 0; i < n; i++)
+			ret |= handshake_sw(&srv);
+		t_sw = now() - t0;
+
+		printf("%-10s %12.1f %12.1f %6.1f\n", s_curves[ci].name, n / t_tsi, n / t_sw,
+		       (double)es.cmds / n);
+		mbedtls_ecdsa_free(&srv);
+	}
+	check(ret == 0, "benchmark call", "", ret);
+}
+
+int main(void)
+{
+	int ci;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	for (ci = 0; ci < CURVE_NUM; ci++) {
+		printf("%s ...\n", s_curves[ci].name);
+		test_curve(ci);
+	}
+	printf("Key Store OTP ...\n");
+	test_otp();
+	test_fallback();
+	bench();
+
+	printf("\n%s (%d failures)\n", s_fail ? "FAILED" : "PASSED", s_fail);
+	return s_fail ? 1 : 0;
+}
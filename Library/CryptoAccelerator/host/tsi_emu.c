@@ -0,0 +1,2298 @@
+/**************************************************************************//**
+ * @file     tsi_emu.c
+ *
+ * @brief    Host emulator of the TSI behind the Wormhole 1 mailbox.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "mbedtls/aes.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/ccm.h"
+#include "mbedtls/ecp.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/rsa.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/sha512.h"
+
+#include "MA35D1.h"
+#include "tsi_cmd.h"
+#include "tsi_emu.h"
+
+/*
+ * The mailbox is served from EL0_GetCurrentPhysicalValue(), which the
+ * driver reads in every wait loop. By default a command runs right there,
+ * so it completes between TSI_Submit() and the first poll and the driver
+ * never needs a second thread. In the pipelined mode the commands go to a
+ * TSI core thread instead and only their ACKs are posted from there. The
+ * WRHO1 interrupt handler is called from the same place when the driver
+ * enabled it, or from IRQ_Enable() for an interrupt raised while masked.
+ *
+ * Data words follow the TSI swap flags: with a swap bit set the engine sees
+ * the bytes in memory order, without it every 32-bit word is byte-reversed.
+ */
+
+#define EMU_ACK_QUEUE       16
+#define EMU_RX_CHANNELS     4
+
+struct emu_aes {
+	uint32_t mode_word;         /* cmd[1] of Set_Mode */
+	int      mode_set;
+	uint32_t key[8];            /* raw key words from Set_Key */
+	int      key_wcnt;
+	uint32_t iv[4];             /* raw words from Set_IV */
+	uint8_t  fb[16];            /* feedback register */
+
+	/* GCM/CCM message in progress across TSI_AES_GCM_Run commands */
+	int      aead;              /* AES_MODE_GCM/CCM, 0: none */
+	size_t   aead_left;         /* payload bytes still to come */
+	size_t   aead_tlen;
+	mbedtls_gcm_context gcm;
+	mbedtls_ccm_context ccm;
+};
+
+#define EMU_SHA_MAX_BLOCK   144     /* SHA3-224 rate */
+#define EMU_SHA_MAX_DIGEST  64
+#define EMU_SHA_MAX_KEY     256     /* HMAC key bytes from the data stream */
+
+struct emu_keccak {
+	uint64_t s[25];
+	size_t   rate;
+	size_t   pos;
+};
+
+/* One running hash of the SHA engine */
+struct emu_hash {
+	int      sel;               /* SHA_MODE_SEL_xxx */
+	int      mode;              /* SHA_MODE_xxx */
+	size_t   blk;               /* block size, SHA-3 rate */
+	size_t   dlen;              /* digest bytes */
+	union {
+		mbedtls_sha1_context   sha1;
+		mbedtls_sha256_context sha256;
+		mbedtls_sha512_context sha512;
+		struct emu_keccak      keccak;
+	} u;
+};
+
+struct emu_sha {
+	int      started;           /* between SHA_Start and SHA_Finish */
+	int      inswap, outswap;
+	int      hmac;
+	size_t   keylen;            /* HMAC key bytes still to come from the stream */
+	size_t   keypad;            /*   padded to a word */
+	size_t   keygot;
+	uint8_t  key[EMU_SHA_MAX_KEY];
+	uint8_t  k0[EMU_SHA_MAX_BLOCK];     /* HMAC block key */
+	uint64_t msg;               /* message bytes so far */
+	struct emu_hash h;
+};
+
+struct emu_session {
+	int      open;
+	int      class_code;
+	struct emu_aes aes;
+	struct emu_sha sha;
+};
+
+typedef int (*emu_handler_t)(const uint32_t cmd[4], uint32_t ack[4]);
+
+WHC_T tsi_emu_whc1 = { .TXSTS = 0xf };
+
+extern char __executable_start[];
+extern char _end[];
+
+static struct emu_session s_sess[TSI_EMU_MAX_SESSIONS];
+static int s_max_sess = 8;
+static struct tsi_emu_stats s_stats;
+
+static uint32_t s_ackq[EMU_ACK_QUEUE][4];
+static int s_ackq_head, s_ackq_cnt;
+
+/*
+ * Pipelined mode: the commands are queued to a TSI core thread and run in
+ * order, concurrently with the program. s_exec_mtx guards the engine state
+ * and statistics, s_mbox_mtx the TSI and ACK queues; the WHC1 registers
+ * are only touched by the program thread.
+ */
+#define EMU_TSI_QUEUE       8
+
+static pthread_mutex_t s_exec_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t s_mbox_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_tsiq_cv = PTHREAD_COND_INITIALIZER;
+static pthread_t s_tsi_thread;
+static int s_tsi_running, s_tsi_stop;
+static uint32_t s_tsiq[EMU_TSI_QUEUE][4];
+static int s_tsiq_head, s_tsiq_cnt, s_tsiq_busy, s_tsiq_peak;
+static uint32_t s_latency_us;
+
+/* WRHO1 interrupt, taken on the program thread */
+static IRQHandler_t s_irq_handler;
+static int s_irq_enabled, s_in_irq;
+static uint32_t s_irq_pending;
+static uint64_t s_irqs;
+
+/*---------------------------------------------------------------------------
+ *  Memory access
+ *---------------------------------------------------------------------------*/
+
+static void *emu_dma(uint32_t addr, size_t len)
+{
+	uintptr_t a = addr;
+
+	if ((a < (uintptr_t)__executable_start) || (a + len > (uintptr_t)_end) ||
+	    (a + len < a))
+		return NULL;
+	return (void *)a;
+}
+
+static void emu_load(uint8_t *dst, const void *src, size_t len, int swap)
+{
+	const uint8_t *s = src;
+	size_t i;
+
+	if (swap) {
+		memcpy(dst, s, len);
+		return;
+	}
+	for (i = 0; i < len; i++) {
+		size_t j = (i & ~(size_t)3) + 3 - (i & 3);
+
+		dst[i] = (j < len) ? s[j] : 0;
+	}
+}
+
+static void emu_store(void *dst, const uint8_t *src, size_t len, int swap)
+{
+	/* byte reversal is its own inverse */
+	emu_load(dst, src, len, swap);
+}
+
+/*---------------------------------------------------------------------------
+ *  TSI control and sessions
+ *---------------------------------------------------------------------------*/
+
+static struct emu_session *emu_session(const uint32_t cmd[4], int class_code)
+{
+	int sid = cmd[0] & 0xff;
+
+	if ((sid >= s_max_sess) || !s_sess[sid].open ||
+	    (s_sess[sid].class_code != class_code))
+		return NULL;
+	return &s_sess[sid];
+}
+
+static void emu_aead_abort(struct emu_aes *a);
+
+static void emu_session_clear(struct emu_session *s)
+{
+	emu_aead_abort(&s->aes);
+	memset(s, 0, sizeof(*s));
+}
+
+static int emu_tsi_ctrl(const uint32_t cmd[4], uint32_t ack[4])
+{
+	int i, class_code, sid;
+
+	switch ((cmd[0] >> 16) & 0xffff) {
+	case CMD_TSI_SYNC:
+		return ST_SUCCESS;
+
+	case CMD_TSI_GET_VERSION:
+		ack[1] = 0x1100e0e0;
+		return ST_SUCCESS;
+
+	case CMD_TSI_RESET:
+		for (i = 0; i < TSI_EMU_MAX_SESSIONS; i++)
+			emu_session_clear(&s_sess[i]);
+		s_stats.sessions = 0;
+		return ST_SUCCESS;
+
+	case CMD_TSI_LOAD_EX_FUNC:
+		/* The extended commands are built in */
+		return emu_dma(cmd[1], cmd[2]) ? ST_SUCCESS : ST_BUS_ERROR;
+
+	case CMD_TSI_OPEN_SESSION:
+		class_code = cmd[0] & 0xff;
+		if ((class_code != C_CODE_AES) && (class_code != C_CODE_SHA))
+			return ST_INVALID_PARAM;
+		for (i = 0; i < s_max_sess; i++)
+			if (!s_sess[i].open)
+				break;
+		if (i >= s_max_sess)
+			return ST_NO_AVAIL_SESSION;
+		memset(&s_sess[i], 0, sizeof(s_sess[i]));
+		s_sess[i].open = 1;
+		s_sess[i].class_code = class_code;
+		ack[1] = i;
+		if (++s_stats.sessions > s_stats.sessions_peak)
+			s_stats.sessions_peak = s_stats.sessions;
+		return ST_SUCCESS;
+
+	case CMD_TSI_CLOSE_SESSION:
+		class_code = (cmd[0] >> 8) & 0xff;
+		sid = cmd[0] & 0xff;
+		if (!emu_session(cmd, class_code))
+			return ST_INVALID_SESSION_ID;
+		emu_session_clear(&s_sess[sid]);
+		s_stats.sessions--;
+		return ST_SUCCESS;
+
+	default:
+		return ST_UNKNOWN_CMD;
+	}
+}
+
+/*---------------------------------------------------------------------------
+ *  AES
+ *---------------------------------------------------------------------------*/
+
+#define AES_MW_KINSWAP(w)   (((w) >> 25) & 1)
+#define AES_MW_INSWAP(w)    (((w) >> 23) & 1)
+#define AES_MW_OUTSWAP(w)   (((w) >> 22) & 1)
+#define AES_MW_SM4EN(w)     (((w) >> 17) & 1)
+#define AES_MW_ENCRYPT(w)   (((w) >> 16) & 1)
+#define AES_MW_MODE(w)      (((w) >> 8) & 0xff)
+#define AES_MW_KEYSZ(w)     (((w) >> 2) & 0x3)
+
+static void emu_ctr_inc(uint8_t ctr[16])
+{
+	int i;
+
+	for (i = 15; i >= 0; i--)
+		if (++ctr[i] != 0)
+			break;
+}
+
+/* Run the feedback modes block by block; a short last block is a stream tail */
+static int emu_aes_crypt(struct emu_aes *a, const uint8_t *in, uint8_t *out,
+			 size_t len)
+{
+	mbedtls_aes_context enc, dec;
+	uint8_t key[32], blk[16], ks[16];
+	int mode = AES_MW_MODE(a->mode_word);
+	int encrypt = AES_MW_ENCRYPT(a->mode_word);
+	size_t off, n, i;
+
+	if ((mode == AES_MODE_ECB || mode == AES_MODE_CBC) && (len & 15))
+		return ST_INVALID_PARAM;
+
+	emu_load(key, a->key, a->key_wcnt * 4, AES_MW_KINSWAP(a->mode_word));
+	mbedtls_aes_init(&enc);
+	mbedtls_aes_init(&dec);
+	mbedtls_aes_setkey_enc(&enc, key, a->key_wcnt * 32);
+	mbedtls_aes_setkey_dec(&dec, key, a->key_wcnt * 32);
+
+	for (off = 0; off < len; off += 16) {
+		n = (len - off < 16) ? len - off : 16;
+		memset(blk, 0, sizeof(blk));
+		memcpy(blk, in + off, n);
+
+		switch (mode) {
+		case AES_MODE_ECB:
+			mbedtls_aes_crypt_ecb(encrypt ? &enc : &dec,
+					      encrypt ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT,
+					      blk, out + off);
+			break;
+
+		case AES_MODE_CBC:
+			if (encrypt) {
+				for (i = 0; i < 16; i++)
+					blk[i] ^= a->fb[i];
+				mbedtls_aes_crypt_ecb(&enc, MBEDTLS_AES_ENCRYPT, blk, a->fb);
+				memcpy(out + off, a->fb, 16);
+			} else {
+				mbedtls_aes_crypt_ecb(&dec, MBEDTLS_AES_DECRYPT, blk, ks);
+				for (i = 0; i < 16; i++)
+					out[off + i] = ks[i] ^ a->fb[i];
+				memcpy(a->fb, blk, 16);
+			}
+			break;
+
+		case AES_MODE_CFB:
+			mbedtls_aes_crypt_ecb(&enc, MBEDTLS_AES_ENCRYPT, a->fb, ks);
+			for (i = 0; i < 16; i++)
+				ks[i] ^= blk[i];
+			memcpy(out + off, ks, n);
+			memcpy(a->fb, encrypt ? ks : blk, 16);
+			break;
+
+		case AES_MODE_OFB:
+			mbedtls_aes_crypt_ecb(&enc, MBEDTLS_AES_ENCRYPT, a->fb, a->fb);
+			for (i = 0; i < n; i++)
+				out[off + i] = blk[i] ^ a->fb[i];
+			break;
+
+		case AES_MODE_CTR:
+			mbedtls_aes_crypt_ecb(&enc, MBEDTLS_AES_ENCRYPT, a->fb, ks);
+			for (i = 0; i < n; i++)
+				out[off + i] = blk[i] ^ ks[i];
+			emu_ctr_inc(a->fb);
+			break;
+
+		default:
+			mbedtls_aes_free(&enc);
+			mbedtls_aes_free(&dec);
+			return ST_INVALID_PARAM;
+		}
+	}
+
+	mbedtls_aes_free(&enc);
+	mbedtls_aes_free(&dec);
+	return ST_SUCCESS;
+}
+
+/*
+ * GCM and CCM take the formatted header and the payload as one stream (see
+ * SampleCode/TSI/TSI_AES_GCM and TSI_AES_CCM). The header must arrive whole
+ * in the first run; it is checked and fed to the software GCM/CCM, and the
+ * payload of every run goes through the same context. The last run writes
+ * the 16-byte tag behind its padded payload.
+ */
+#define EMU_PAD16(n)        (((n) + 15) & ~(size_t)15)
+
+static void emu_aead_abort(struct emu_aes *a)
+{
+	if (a->aead == AES_MODE_GCM)
+		mbedtls_gcm_free(&a->gcm);
+	else if (a->aead == AES_MODE_CCM)
+		mbedtls_ccm_free(&a->ccm);
+	a->aead = 0;
+}
+
+static int emu_aead_start(struct emu_aes *a, const uint32_t param[5],
+			  const uint8_t *in, size_t cnt, size_t *hlen)
+{
+	uint8_t key[32], c0[16];
+	int mode = AES_MW_MODE(a->mode_word);
+	int encrypt = AES_MW_ENCRYPT(a->mode_word);
+	size_t ivlen, ivpart, alen, plen, q, i;
+	uint64_t bits;
+	int ret;
+
+	emu_load(key, a->key, a->key_wcnt * 4, AES_MW_KINSWAP(a->mode_word));
+
+	switch (mode) {
+	case AES_MODE_GCM:
+		ivlen = param[0];
+		alen = param[1];
+		plen = param[2];
+		if (ivlen == 0)
+			return ST_INVALID_PARAM;
+		ivpart = (ivlen == 12) ? 16 : EMU_PAD16(ivlen) + 16;
+		*hlen = ivpart + EMU_PAD16(alen);
+		if (cnt < *hlen)
+			return ST_INVALID_PARAM;
+
+		/* IV || 0^31 || 1, or the IV followed by its bit length */
+		if (ivlen == 12) {
+			if (in[12] || in[13] || in[14] || (in[15] != 1))
+				return ST_INVALID_PARAM;
+		} else {
+			for (bits = 0, i = ivpart - 8; i < ivpart; i++)
+				bits = (bits << 8) | in[i];
+			if (bits != (uint64_t)ivlen * 8)
+				return ST_INVALID_PARAM;
+		}
+
+		mbedtls_gcm_init(&a->gcm);
+		a->aead = AES_MODE_GCM;
+		ret = mbedtls_gcm_setkey(&a->gcm, MBEDTLS_CIPHER_ID_AES, key, a->key_wcnt * 32);
+		if (!ret)
+			ret = mbedtls_gcm_starts(&a->gcm, encrypt ? MBEDTLS_GCM_ENCRYPT :
+						 MBEDTLS_GCM_DECRYPT, in, ivlen);
+		if (!ret)
+			ret = mbedtls_gcm_update_ad(&a->gcm, in + ivpart, alen);
+		a->aead_tlen = 16;
+		break;
+
+	case AES_MODE_CCM:
+		*hlen = param[1];
+		if ((*hlen < 16) || (*hlen & 15) || (param[2] & 15) || (cnt < *hlen))
+			return ST_INVALID_PARAM;
+
+		/* B0: flags, nonce, payload length */
+		q = (in[0] & 7) + 1;
+		if (q < 2 || q > 8)
+			return ST_INVALID_PARAM;
+		for (plen = 0, i = 16 - q; i < 16; i++)
+			plen = (plen << 8) | in[i];
+		alen = (in[0] & 0x40) ? (size_t)((in[16] << 8) | in[17]) : 0;
+		if ((*hlen != 16 + (alen ? EMU_PAD16(alen + 2) : 0)) ||
+		    (EMU_PAD16(plen) != param[2]))
+			return ST_INVALID_PARAM;
+
+		/* Ctr0 from Set_IV must match the nonce of B0 */
+		emu_load(c0, a->iv, 16, AES_MW_KINSWAP(a->mode_word));
+		if ((c0[0] != q - 1) || memcmp(c0 + 1, in + 1, 15 - q))
+			return ST_INVALID_PARAM;
+		for (i = 16 - q; i < 16; i++)
+			if (c0[i])
+				return ST_INVALID_PARAM;
+
+		mbedtls_ccm_init(&a->ccm);
+		a->aead = AES_MODE_CCM;
+		a->aead_tlen = ((in[0] >> 3) & 7) * 2 + 2;
+		ret = mbedtls_ccm_setkey(&a->ccm, MBEDTLS_CIPHER_ID_AES, key, a->key_wcnt * 32);
+		if (!ret)
+			ret = mbedtls_ccm_starts(&a->ccm, encrypt ? MBEDTLS_CCM_ENCRYPT :
+						 MBEDTLS_CCM_DECRYPT, in + 1, 15 - q);
+		if (!ret)
+			ret = mbedtls_ccm_set_lengths(&a->ccm, alen, plen, a->aead_tlen);
+		if (!ret)
+			ret = mbedtls_ccm_update_ad(&a->ccm, in + 18, alen);
+		break;
+
+	default:
+		return ST_INVALID_PARAM;
+	}
+
+	if (ret) {
+		emu_aead_abort(a);
+		return ST_INVALID_PARAM;
+	}
+	a->aead_left = plen;
+	return ST_SUCCESS;
+}
+
+static int emu_aead_run(struct emu_aes *a, const uint32_t cmd[4])
+{
+	const uint32_t *param;
+	const void *src;
+	void *dst;
+	uint8_t *in = NULL, *out = NULL;
+	size_t cnt = cmd[1] & 0xffffff, hlen = 0, n, real, olen, tlen = 0;
+	int last = (cmd[1] >> 24) & 1;
+	int ret;
+
+	param = emu_dma(cmd[2], 5 * sizeof(uint32_t));
+	if (!param)
+		return ST_BUS_ERROR;
+	src = emu_dma(param[3], cnt);
+	if (!src) {
+		ret = ST_BUS_ERROR;
+		goto abort;
+	}
+
+	in = malloc(cnt + 16);
+	if (!in) {
+		ret = ST_HW_ERROR;
+		goto abort;
+	}
+	emu_load(in, src, cnt, AES_MW_INSWAP(a->mode_word));
+
+	if (!a->aead) {
+		ret = emu_aead_start(a, param, in, cnt, &hlen);
+		if (ret != ST_SUCCESS)
+			goto abort;
+	}
+
+	/* Only the last run may end inside a block */
+	n = cnt - hlen;
+	if (!last && (n & 15)) {
+		ret = ST_INVALID_PARAM;
+		goto abort;
+	}
+	if (last)
+		tlen = 16;
+	dst = emu_dma(param[4], n + tlen);
+	out = calloc(1, n + tlen + 16);
+	if (!dst || !out) {
+		ret = dst ? ST_HW_ERROR : ST_BUS_ERROR;
+		goto abort;
+	}
+
+	real = (n < a->aead_left) ? n : a->aead_left;
+	if (real) {
+		if (a->aead == AES_MODE_GCM)
+			ret = mbedtls_gcm_update(&a->gcm, in + hlen, real, out, real, &olen);
+		else
+			ret = mbedtls_ccm_update(&a->ccm, in + hlen, real, out, real, &olen);
+		if (ret) {
+			ret = ST_INVALID_PARAM;
+			goto abort;
+		}
+		a->aead_left -= real;
+	}
+
+	if (last) {
+		if (a->aead_left) {
+			ret = ST_INVALID_PARAM;
+			goto abort;
+		}
+		if (a->aead == AES_MODE_GCM)
+			ret = mbedtls_gcm_finish(&a->gcm, NULL, 0, &olen, out + n, 16);
+		else
+			ret = mbedtls_ccm_finish(&a->ccm, out + n, a->aead_tlen);
+		emu_aead_abort(a);
+		if (ret) {
+			ret = ST_INVALID_PARAM;
+			goto out;
+		}
+	}
+
+	emu_store(dst, out, n + tlen, AES_MW_OUTSWAP(a->mode_word));
+	s_stats.aes_runs++;
+	s_stats.aes_bytes += cnt;
+	ret = ST_SUCCESS;
+	goto out;
+
+abort:
+	emu_aead_abort(a);
+out:
+	free(in);
+	free(out);
+	return ret;
+}
+
+static int emu_aes(const uint32_t cmd[4], uint32_t ack[4])
+{
+	struct emu_session *s = emu_session(cmd, C_CODE_AES);
+	struct emu_aes *a;
+	const void *src;
+	void *dst;
+	uint8_t *in, *out;
+	size_t len;
+	int ret;
+
+	(void)ack;
+	if (!s)
+		return ST_INVALID_SESSION_ID;
+	a = &s->aes;
+
+	switch ((cmd[0] >> 16) & 0xffff) {
+	case CMD_AES_SET_MODE:
+		if (AES_MW_SM4EN(cmd[1]) || (AES_MW_KEYSZ(cmd[1]) > AES_KEY_SIZE_256) ||
+		    ((cmd[2] >> 5) != SEL_KEY_FROM_REG))
+			return ST_INVALID_PARAM;
+		emu_aead_abort(a);
+		a->mode_word = cmd[1];
+		a->mode_set = 1;
+		emu_load(a->fb, a->iv, 16, AES_MW_KINSWAP(a->mode_word));
+		return ST_SUCCESS;
+
+	case CMD_AES_SET_IV:
+		src = emu_dma(cmd[1], 16);
+		if (!src)
+			return ST_BUS_ERROR;
+		memcpy(a->iv, src, 16);
+		if (a->mode_set)
+			emu_load(a->fb, a->iv, 16, AES_MW_KINSWAP(a->mode_word));
+		return ST_SUCCESS;
+
+	case CMD_AES_SET_KEY:
+		if ((cmd[1] != 4) && (cmd[1] != 6) && (cmd[1] != 8))
+			return ST_INVALID_PARAM;
+		src = emu_dma(cmd[2], cmd[1] * 4);
+		if (!src)
+			return ST_BUS_ERROR;
+		memcpy(a->key, src, cmd[1] * 4);
+		a->key_wcnt = cmd[1];
+		return ST_SUCCESS;
+
+	case CMD_AES_RUN:
+		if (!a->mode_set || !a->key_wcnt ||
+		    (a->key_wcnt != 4 + 2 * (int)AES_MW_KEYSZ(a->mode_word)))
+			return ST_INVALID_OPERATION;
+		len = cmd[1] & 0xffffff;
+		src = emu_dma(cmd[2], len);
+		dst = emu_dma(cmd[3], len);
+		if (!src || !dst)
+			return ST_BUS_ERROR;
+
+		in = malloc(len + 16);
+		out = malloc(len + 16);
+		if (!in || !out) {
+			free(in);
+			free(out);
+			return ST_HW_ERROR;
+		}
+		emu_load(in, src, len, AES_MW_INSWAP(a->mode_word));
+		ret = emu_aes_crypt(a, in, out, len);
+		if (ret == ST_SUCCESS)
+			emu_store(dst, out, len, AES_MW_OUTSWAP(a->mode_word));
+		free(in);
+		free(out);
+
+		/* The last run of a cascade restarts from the programmed IV */
+		if ((cmd[1] >> 24) & 1)
+			emu_load(a->fb, a->iv, 16, AES_MW_KINSWAP(a->mode_word));
+
+		s_stats.aes_runs++;
+		s_stats.aes_bytes += len;
+		return ret;
+
+	case CMD_AES_GCM_RUN:
+		if (!a->mode_set || !a->key_wcnt ||
+		    (a->key_wcnt != 4 + 2 * (int)AES_MW_KEYSZ(a->mode_word)))
+			return ST_INVALID_OPERATION;
+		return emu_aead_run(a, cmd);
+
+	default:
+		return ST_UNKNOWN_CMD;
+	}
+}
+
+/*---------------------------------------------------------------------------
+ *  Key Store
+ *---------------------------------------------------------------------------*/
+
+#define EMU_KS_MAX_WORDS    128     /* 4096-bit keys */
+
+struct emu_ks_key {
+	int      used;
+	int      revoked;
+	uint32_t meta;
+	int      wcnt;
+	uint32_t w[EMU_KS_MAX_WORDS];   /* least significant word first */
+};
+
+static struct emu_ks_key s_ks_sram[KS_SRAM_KEY_CNT];
+static struct emu_ks_key s_ks_otp[KS_OTP_KEY_CNT];
+
+/* Key bits of the KS_META_xxx size codes */
+static const uint16_t s_ks_bits[] = {
+	128, 163, 192, 224, 233, 255, 256, 283, 384, 409, 512, 521, 571, 0, 0, 0,
+	1024, 1536, 2048, 3072, 4096
+};
+
+static int emu_ks_wcnt(uint32_t meta)
+{
+	uint32_t code = (meta & KS_METADATA_SIZE_Msk) >> KS_METADATA_SIZE_Pos;
+
+	if ((code >= sizeof(s_ks_bits) / sizeof(s_ks_bits[0])) || !s_ks_bits[code])
+		return -1;
+	return (s_ks_bits[code] + 31) / 32;
+}
+
+/* Usable key of one owner, NULL if there is none */
+static struct emu_ks_key *emu_ks_get(int mem, int knum, uint32_t owner)
+{
+	struct emu_ks_key *k;
+
+	if ((mem == KS_SRAM) && (knum >= 0) && (knum < KS_SRAM_KEY_CNT))
+		k = &s_ks_sram[knum];
+	else if ((mem == KS_OTP) && (knum >= 0) && (knum < KS_OTP_KEY_CNT))
+		k = &s_ks_otp[knum];
+	else
+		return NULL;
+	if (!k->used || k->revoked || (((k->meta >> KS_METADATA_OWNER_Pos) & 0x7) != owner))
+		return NULL;
+	return k;
+}
+
+static int emu_ks_store(struct emu_ks_key *k, uint32_t meta, uint32_t addr)
+{
+	const void *src;
+	int wcnt = emu_ks_wcnt(meta);
+
+	if (wcnt < 0)
+		return ST_INVALID_PARAM;
+	src = emu_dma(addr, wcnt * 4);
+	if (!src)
+		return ST_BUS_ERROR;
+	memset(k, 0, sizeof(*k));
+	memcpy(k->w, src, wcnt * 4);
+	k->wcnt = wcnt;
+	k->meta = meta;
+	k->used = 1;
+	return ST_SUCCESS;
+}
+
+static int emu_ks(const uint32_t cmd[4], uint32_t ack[4])
+{
+	struct emu_ks_key *k = NULL;
+	int mem = cmd[1] >> 30, knum = cmd[1] & 0xff;
+	int i, wcnt;
+	void *dst;
+
+	switch ((cmd[0] >> 16) & 0xffff) {
+	case CMD_KS_WRITE_SRAM_KEY:
+		for (i = 0; i < KS_SRAM_KEY_CNT; i++)
+			if (!s_ks_sram[i].used)
+				break;
+		if (i == KS_SRAM_KEY_CNT) {
+			ack[1] = (uint32_t)-1;
+			return ST_KS_FULL;
+		}
+		ack[1] = i;
+		return emu_ks_store(&s_ks_sram[i], cmd[1], cmd[2]);
+
+	case CMD_KS_WRITE_OTP_KEY:
+		if (cmd[3] >= KS_OTP_KEY_CNT)
+			return ST_INVALID_PARAM;
+		if (s_ks_otp[cmd[3]].used)
+			return ST_KS_ERROR;
+		return emu_ks_store(&s_ks_otp[cmd[3]], cmd[1], cmd[2]);
+
+	case CMD_KS_READ_KEY:
+		if ((mem == KS_SRAM) && (knum < KS_SRAM_KEY_CNT))
+			k = &s_ks_sram[knum];
+		else if ((mem == KS_OTP) && (knum < KS_OTP_KEY_CNT))
+			k = &s_ks_otp[knum];
+		if (!k || !k->used || k->revoked)
+			return ST_KS_ERROR;
+		if (!(k->meta & KS_META_READABLE))
+			return ST_KS_READ_PROTECT;
+		wcnt = (cmd[1] >> 8) & 0xffff;
+		if (wcnt > k->wcnt)
+			wcnt = k->wcnt;
+		dst = emu_dma(cmd[2], wcnt * 4);
+		if (!dst)
+			return ST_BUS_ERROR;
+		memcpy(dst, k->w, wcnt * 4);
+		return ST_SUCCESS;
+
+	case CMD_KS_REVOKE_KEY:
+	case CMD_KS_ERASE_KEY:
+		if ((mem == KS_SRAM) && (knum < KS_SRAM_KEY_CNT))
+			k = &s_ks_sram[knum];
+		else if ((mem == KS_OTP) && (knum < KS_OTP_KEY_CNT))
+			k = &s_ks_otp[knum];
+		if (!k || !k->used)
+			return ST_KS_ERROR;
+		if (((cmd[0] >> 16) & 0xffff) == CMD_KS_REVOKE_KEY)
+			k->revoked = 1;
+		else
+			memset(k, 0, sizeof(*k));
+		return ST_SUCCESS;
+
+	case CMD_KS_ERASE_ALL:
+		memset(s_ks_sram, 0, sizeof(s_ks_sram));
+		return ST_SUCCESS;
+
+	default:
+		return ST_UNKNOWN_CMD;
+	}
+}
+
+/*---------------------------------------------------------------------------
+ *  SHA
+ *---------------------------------------------------------------------------*/
+
+static const uint64_t s_keccak_rc[24] = {
+	0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+	0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+	0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+	0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+	0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+	0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+	0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+	0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL,
+};
+
+static const uint8_t s_keccak_rot[24] = {
+	1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14,
+	27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44,
+};
+
+static const uint8_t s_keccak_pi[24] = {
+	10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4,
+	15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1,
+};
+
+#define EMU_ROL64(x, n)     (((x) << (n)) | ((x) >> (64 - (n))))
+
+/* Keccak-f[1600] */
+static void emu_keccak_f(uint64_t s[25])
+{
+	uint64_t bc[5], t;
+	int r, i, j;
+
+	for (r = 0; r < 24; r++) {
+		for (i = 0; i < 5; i++)
+			bc[i] = s[i] ^ s[i + 5] ^ s[i + 10] ^ s[i + 15] ^ s[i + 20];
+		for (i = 0; i < 5; i++) {
+			t = bc[(i + 4) % 5] ^ EMU_ROL64(bc[(i + 1) % 5], 1);
+			for (j = 0; j < 25; j += 5)
+				s[j + i] ^= t;
+		}
+		t = s[1];
+		for (i = 0; i < 24; i++) {
+			j = s_keccak_pi[i];
+			bc[0] = s[j];
+			s[j] = EMU_ROL64(t, s_keccak_rot[i]);
+			t = bc[0];
+		}
+		for (j = 0; j < 25; j += 5) {
+			for (i = 0; i < 5; i++)
+				bc[i] = s[j + i];
+			for (i = 0; i < 5; i++)
+				s[j + i] ^= ~bc[(i + 1) % 5] & bc[(i + 2) % 5];
+		}
+		s[0] ^= s_keccak_rc[r];
+	}
+}
+
+static void emu_keccak_absorb(struct emu_keccak *k, const uint8_t *p, size_t len)
+{
+	while (len--) {
+		k->s[k->pos / 8] ^= (uint64_t)*p++ << (8 * (k->pos % 8));
+		if (++k->pos == k->rate) {
+			emu_keccak_f(k->s);
+			k->pos = 0;
+		}
+	}
+}
+
+/* FIPS 202 SHA-3 padding, the digest fits in one rate */
+static void emu_keccak_finish(struct emu_keccak *k, uint8_t *out, size_t dlen)
+{
+	size_t i;
+
+	k->s[k->pos / 8] ^= (uint64_t)0x06 << (8 * (k->pos % 8));
+	k->s[(k->rate - 1) / 8] ^= (uint64_t)0x80 << (8 * ((k->rate - 1) % 8));
+	emu_keccak_f(k->s);
+	for (i = 0; i < dlen; i++)
+		out[i] = (uint8_t)(k->s[i / 8] >> (8 * (i % 8)));
+}
+
+/* Engine and mode of SHA_MODE_SEL_xxx/SHA_MODE_xxx, SHAKE is not emulated */
+static int emu_hash_setup(struct emu_hash *h, int sel, int mode)
+{
+	static const struct {
+		int mode;
+		uint8_t dlen;
+		uint8_t blk2, blk3;     /* SHA-2, SHA-3 block */
+	} modes[] = {
+		{ SHA_MODE_SHA1,   20,  64,   0 },
+		{ SHA_MODE_SHA224, 28,  64, 144 },
+		{ SHA_MODE_SHA256, 32,  64, 136 },
+		{ SHA_MODE_SHA384, 48, 128, 104 },
+		{ SHA_MODE_SHA512, 64, 128,  72 },
+	};
+	size_t i;
+
+	memset(h, 0, sizeof(*h));
+	for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+		if (modes[i].mode != mode)
+			continue;
+		h->sel = sel;
+		h->mode = mode;
+		h->dlen = modes[i].dlen;
+		if (sel == SHA_MODE_SEL_SHA2)
+			h->blk = modes[i].blk2;
+		else if (sel == SHA_MODE_SEL_SHA3)
+			h->blk = modes[i].blk3;
+		return h->blk ? ST_SUCCESS : ST_INVALID_PARAM;
+	}
+	return ST_INVALID_PARAM;
+}
+
+static void emu_hash_start(struct emu_hash *h)
+{
+	if (h->sel == SHA_MODE_SEL_SHA3) {
+		memset(&h->u.keccak, 0, sizeof(h->u.keccak));
+		h->u.keccak.rate = h->blk;
+	} else if (h->mode == SHA_MODE_SHA1) {
+		mbedtls_sha1_init(&h->u.sha1);
+		mbedtls_sha1_starts(&h->u.sha1);
+	} else if (h->blk == 64) {
+		mbedtls_sha256_init(&h->u.sha256);
+		mbedtls_sha256_starts(&h->u.sha256, h->mode == SHA_MODE_SHA224);
+	} else {
+		mbedtls_sha512_init(&h->u.sha512);
+		mbedtls_sha512_starts(&h->u.sha512, h->mode == SHA_MODE_SHA384);
+	}
+}
+
+static void emu_hash_update(struct emu_hash *h, const uint8_t *p, size_t len)
+{
+	if (h->sel == SHA_MODE_SEL_SHA3)
+		emu_keccak_absorb(&h->u.keccak, p, len);
+	else if (h->mode == SHA_MODE_SHA1)
+		mbedtls_sha1_update(&h->u.sha1, p, len);
+	else if (h->blk == 64)
+		mbedtls_sha256_update(&h->u.sha256, p, len);
+	else
+		mbedtls_sha512_update(&h->u.sha512, p, len);
+}
+
+static void emu_hash_finish(struct emu_hash *h, uint8_t *out)
+{
+	uint8_t d[EMU_SHA_MAX_DIGEST];
+
+	if (h->sel == SHA_MODE_SEL_SHA3)
+		emu_keccak_finish(&h->u.keccak, d, h->dlen);
+	else if (h->mode == SHA_MODE_SHA1)
+		mbedtls_sha1_finish(&h->u.sha1, d);
+	else if (h->blk == 64)
+		mbedtls_sha256_finish(&h->u.sha256, d);
+	else
+		mbedtls_sha512_finish(&h->u.sha512, d);
+	memcpy(out, d, h->dlen);
+}
+
+/* RFC 2104 block key and inner hash */
+static void emu_hmac_key(struct emu_sha *sha, const uint8_t *key, size_t len)
+{
+	struct emu_hash *h = &sha->h;
+	uint8_t pad[EMU_SHA_MAX_BLOCK];
+	size_t i;
+
+	memset(sha->k0, 0, sizeof(sha->k0));
+	if (len > h->blk) {
+		emu_hash_start(h);
+		emu_hash_update(h, key, len);
+		emu_hash_finish(h, sha->k0);
+	} else if (len) {
+		memcpy(sha->k0, key, len);
+	}
+	for (i = 0; i < h->blk; i++)
+		pad[i] = sha->k0[i] ^ 0x36;
+	emu_hash_start(h);
+	emu_hash_update(h, pad, h->blk);
+}
+
+static void emu_hmac_finish(struct emu_sha *sha, uint8_t *out)
+{
+	struct emu_hash *h = &sha->h;
+	uint8_t pad[EMU_SHA_MAX_BLOCK], inner[EMU_SHA_MAX_DIGEST];
+	size_t i;
+
+	emu_hash_finish(h, inner);
+	for (i = 0; i < h->blk; i++)
+		pad[i] = sha->k0[i] ^ 0x5c;
+	emu_hash_start(h);
+	emu_hash_update(h, pad, h->blk);
+	emu_hash_update(h, inner, h->dlen);
+	emu_hash_finish(h, out);
+}
+
+/*
+ * Data of SHA_Update/SHA_Finish: the HMAC key, when it comes from the
+ * stream, then the message. Updates must keep the message a whole number
+ * of blocks.
+ */
+static int emu_sha_data(struct emu_sha *sha, uint32_t addr, size_t len, int final)
+{
+	const uint8_t *src;
+	uint8_t *buf;
+	size_t n;
+
+	if (!sha->started)
+		return ST_INVALID_OPERATION;
+	src = len ? emu_dma(addr, len) : NULL;
+	if (len && (!src || (addr & 3)))
+		return ST_BUS_ERROR;
+	n = sha->keypad - sha->keygot;
+	if (n > len)
+		n = len;
+	if (!final && ((len - n) % sha->h.blk))
+		return ST_INVALID_PARAM;
+	if (final && (sha->keygot + n < sha->keypad))
+		return ST_INVALID_PARAM;
+
+	buf = malloc(len ? len : 1);
+	if (!buf)
+		return ST_HW_ERROR;
+	if (len)
+		emu_load(buf, src, len, sha->inswap);
+	if (n) {
+		memcpy(sha->key + sha->keygot, buf, n);
+		sha->keygot += n;
+		if (sha->keygot == sha->keypad)
+			emu_hmac_key(sha, sha->key, sha->keylen);
+	}
+	emu_hash_update(&sha->h, buf + n, len - n);
+	sha->msg += len - n;
+	free(buf);
+	s_stats.sha_runs++;
+	s_stats.sha_bytes += len;
+	return ST_SUCCESS;
+}
+
+static int emu_sha_start(const uint32_t cmd[4])
+{
+	struct emu_session *s = emu_session(cmd, C_CODE_SHA);
+	struct emu_sha *sha;
+	struct emu_ks_key *k;
+	uint8_t key[EMU_KS_MAX_WORDS * 4];
+	int ks = (cmd[3] >> 5) & 0x7, ret, i;
+
+	if (!s)
+		return ST_INVALID_SESSION_ID;
+	sha = &s->sha;
+	memset(sha, 0, sizeof(*sha));
+	ret = emu_hash_setup(&sha->h, (cmd[1] >> 12) & 0x7, (cmd[1] >> 8) & 0x7);
+	if (ret != ST_SUCCESS)
+		return ret;
+	sha->inswap = (cmd[1] >> 23) & 1;
+	sha->outswap = (cmd[1] >> 22) & 1;
+	sha->hmac = (cmd[1] >> 11) & 1;
+
+	if (!sha->hmac) {
+		emu_hash_start(&sha->h);
+	} else if (ks != SEL_KEY_FROM_REG) {
+		/* Key Store words hold the key bytes most significant first */
+		k = emu_ks_get((ks == SEL_KEY_FROM_KS_OTP) ? KS_OTP : KS_SRAM,
+			       cmd[3] & 0x1f, KS_OWNER_HMAC);
+		if (!k)
+			return ST_KS_ERROR;
+		for (i = 0; i < k->wcnt; i++) {
+			key[4 * i] = k->w[i] >> 24;
+			key[4 * i + 1] = (k->w[i] >> 16) & 0xff;
+			key[4 * i + 2] = (k->w[i] >> 8) & 0xff;
+			key[4 * i + 3] = k->w[i] & 0xff;
+		}
+		emu_hmac_key(sha, key, k->wcnt * 4);
+	} else {
+		if (cmd[2] > EMU_SHA_MAX_KEY)
+			return ST_INVALID_PARAM;
+		sha->keylen = cmd[2];
+		sha->keypad = (cmd[2] + 3) & ~3u;
+		if (!sha->keypad)
+			emu_hmac_key(sha, NULL, 0);
+	}
+	sha->started = 1;
+	return ST_SUCCESS;
+}
+
+static int emu_sha_update(const uint32_t cmd[4])
+{
+	struct emu_session *s = emu_session(cmd, C_CODE_SHA);
+
+	if (!s)
+		return ST_INVALID_SESSION_ID;
+	return emu_sha_data(&s->sha, cmd[2], cmd[1], 0);
+}
+
+static int emu_sha_finish(const uint32_t cmd[4])
+{
+	struct emu_session *s = emu_session(cmd, C_CODE_SHA);
+	struct emu_sha *sha;
+	uint8_t d[EMU_SHA_MAX_DIGEST];
+	size_t wcnt = cmd[1] >> 24;
+	void *dst;
+	int ret;
+
+	if (!s)
+		return ST_INVALID_SESSION_ID;
+	sha = &s->sha;
+	if (sha->started && (wcnt * 4 > sha->h.dlen))
+		return ST_INVALID_PARAM;
+	/* The last data goes with SHA_Finish, it cannot be empty */
+	if (!(cmd[1] & 0xffffff))
+		return ST_INVALID_PARAM;
+	dst = emu_dma(cmd[3], wcnt * 4);
+	if (!dst)
+		return ST_BUS_ERROR;
+	ret = emu_sha_data(sha, cmd[2], cmd[1] & 0xffffff, 1);
+	if (ret != ST_SUCCESS)
+		return ret;
+	if (sha->hmac)
+		emu_hmac_finish(sha, d);
+	else
+		emu_hash_finish(&sha->h, d);
+	emu_store(dst, d, wcnt * 4, sha->outswap);
+	sha->started = 0;
+	return ST_SUCCESS;
+}
+
+static int emu_sha(const uint32_t cmd[4], uint32_t ack[4])
+{
+	struct emu_sha sha;
+	uint8_t d[EMU_SHA_MAX_DIGEST];
+	size_t len = ((cmd[0] & 0xffff) << 8) | (cmd[1] >> 24);
+	size_t wcnt = cmd[1] & 0xff;
+	void *dst;
+	int ret;
+
+	(void)ack;
+	if (((cmd[0] >> 16) & 0xffff) != CMD_SHA_ALL_AT_ONCE)
+		return ST_UNKNOWN_CMD;
+
+	memset(&sha, 0, sizeof(sha));
+	ret = emu_hash_setup(&sha.h, (cmd[1] >> 12) & 0x7, (cmd[1] >> 8) & 0x7);
+	if (ret != ST_SUCCESS)
+		return ret;
+	if (wcnt * 4 > sha.h.dlen)
+		return ST_INVALID_PARAM;
+	dst = emu_dma(cmd[3], wcnt * 4);
+	if (!dst)
+		return ST_BUS_ERROR;
+	sha.inswap = (cmd[1] >> 23) & 1;
+	sha.outswap = (cmd[1] >> 22) & 1;
+	sha.started = 1;
+	emu_hash_start(&sha.h);
+	ret = emu_sha_data(&sha, cmd[2], len, 1);
+	if (ret != ST_SUCCESS)
+		return ret;
+	emu_hash_finish(&sha.h, d);
+	emu_store(dst, d, wcnt * 4, sha.outswap);
+	return ST_SUCCESS;
+}
+
+/*---------------------------------------------------------------------------
+ *  ECC
+ *---------------------------------------------------------------------------*/
+
+/*
+ * Numbers travel as ASCII hex strings in EMU_ECC_SLOT byte slots. Results
+ * are written as lower case hex without leading zeros.
+ */
+#define EMU_ECC_SLOT        576
+
+static const struct {
+	int curve;
+	mbedtls_ecp_group_id gid;
+} s_ecc_curves[] = {
+	{ CURVE_P_192,  MBEDTLS_ECP_DP_SECP192R1 },
+	{ CURVE_P_224,  MBEDTLS_ECP_DP_SECP224R1 },
+	{ CURVE_P_256,  MBEDTLS_ECP_DP_SECP256R1 },
+	{ CURVE_P_384,  MBEDTLS_ECP_DP_SECP384R1 },
+	{ CURVE_P_521,  MBEDTLS_ECP_DP_SECP521R1 },
+	{ CURVE_KO_192, MBEDTLS_ECP_DP_SECP192K1 },
+	{ CURVE_KO_224, MBEDTLS_ECP_DP_SECP224K1 },
+	{ CURVE_KO_256, MBEDTLS_ECP_DP_SECP256K1 },
+	{ CURVE_BP_256, MBEDTLS_ECP_DP_BP256R1 },
+	{ CURVE_BP_384, MBEDTLS_ECP_DP_BP384R1 },
+	{ CURVE_BP_512, MBEDTLS_ECP_DP_BP512R1 },
+};
+
+#define EMU_ECC_CURVES  (int)(sizeof(s_ecc_curves) / sizeof(s_ecc_curves[0]))
+
+static uint32_t s_ecc_off;      /* curves answered with ST_ECC_UNKNOWN_CURVE */
+
+/* Not a cryptographic generator; it only stands in for the TSI TRNG */
+static int emu_rng(void *p, unsigned char *out, size_t len)
+{
+	static uint64_t x = 0x9e3779b97f4a7c15ull;
+
+	(void)p;
+	while (len--) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		*out++ = (unsigned char)(x >> 24);
+	}
+	return 0;
+}
+
+static int emu_ecc_group(int curve, mbedtls_ecp_group *grp)
+{
+	int i;
+
+	for (i = 0; i < EMU_ECC_CURVES; i++) {
+		if (s_ecc_curves[i].curve != curve)
+			continue;
+		if (s_ecc_off & (1u << i))
+			break;
+		return mbedtls_ecp_group_load(grp, s_ecc_curves[i].gid) ? ST_HW_ERROR : ST_SUCCESS;
+	}
+	return ST_ECC_UNKNOWN_CURVE;
+}
+
+static int emu_hex_get(mbedtls_mpi *X, const char *slot)
+{
+	char s[EMU_ECC_SLOT + 1];
+
+	memcpy(s, slot, EMU_ECC_SLOT);
+	s[EMU_ECC_SLOT] = 0;
+	if (!s[0] || mbedtls_mpi_read_string(X, 16, s) || (mbedtls_mpi_cmp_int(X, 0) < 0))
+		return ST_INVALID_PARAM;
+	return ST_SUCCESS;
+}
+
+static int emu_hex_put(char *slot, const mbedtls_mpi *X)
+{
+	char s[EMU_ECC_SLOT];
+	size_t olen, i = 0;
+
+	if (mbedtls_mpi_write_string(X, 16, s, sizeof(s), &olen))
+		return ST_HW_ERROR;
+	while ((s[i] == '0') && s[i + 1])
+		i++;
+	memset(slot, 0, EMU_ECC_SLOT);
+	for (olen = 0; s[i]; i++, olen++)
+		slot[olen] = (s[i] >= 'A' && s[i] <= 'F') ? s[i] - 'A' + 'a' : s[i];
+	return ST_SUCCESS;
+}
+
+/* Key Store key of one owner as a number; sel is a xxx_KEY_SEL_KS_OTP/SRAM code */
+static int emu_ks_mpi(mbedtls_mpi *X, int sel, int knum, uint32_t owner)
+{
+	struct emu_ks_key *k;
+	uint8_t b[EMU_KS_MAX_WORDS * 4];
+	int i;
+
+	k = emu_ks_get((sel == ECC_KEY_SEL_KS_OTP) ? KS_OTP : KS_SRAM, knum, owner);
+	if (!k)
+		return ST_KS_ERROR;
+	for (i = 0; i < k->wcnt; i++) {
+		b[4 * i] = k->w[i] & 0xff;
+		b[4 * i + 1] = (k->w[i] >> 8) & 0xff;
+		b[4 * i + 2] = (k->w[i] >> 16) & 0xff;
+		b[4 * i + 3] = k->w[i] >> 24;
+	}
+	return mbedtls_mpi_read_binary_le(X, b, k->wcnt * 4) ? ST_HW_ERROR : ST_SUCCESS;
+}
+
+/* Private key or multiplier from the user slot or the Key Store, range checked */
+static int emu_ecc_scalar(const mbedtls_ecp_group *grp, mbedtls_mpi *d, int sel,
+			  int knum, const char *slot)
+{
+	int ret;
+
+	if (sel == ECC_KEY_SEL_USER)
+		ret = emu_hex_get(d, slot);
+	else if ((sel == ECC_KEY_SEL_KS_OTP) || (sel == ECC_KEY_SEL_KS_SRAM))
+		ret = emu_ks_mpi(d, sel, knum, KS_OWNER_ECC);
+	else
+		ret = mbedtls_ecp_gen_privkey(grp, d, emu_rng, NULL) ? ST_HW_ERROR : ST_SUCCESS;
+	if (ret == ST_SUCCESS && (mbedtls_mpi_cmp_int(d, 1) < 0 ||
+				  mbedtls_mpi_cmp_mpi(d, &grp->N) >= 0))
+		ret = ST_ECC_INVALID_PRIV_KEY;
+	return ret;
+}
+
+/* Message representative as the engine takes it: leftmost nbits, mod n */
+static int emu_ecc_digest(const mbedtls_ecp_group *grp, mbedtls_mpi *e, const char *slot)
+{
+	int ret = emu_hex_get(e, slot);
+
+	if (ret == ST_SUCCESS && mbedtls_mpi_bitlen(e) > grp->nbits)
+		ret = mbedtls_mpi_shift_r(e, mbedtls_mpi_bitlen(e) - grp->nbits) ? ST_HW_ERROR : ret;
+	if (ret == ST_SUCCESS && mbedtls_mpi_mod_mpi(e, e, &grp->N))
+		ret = ST_HW_ERROR;
+	return ret;
+}
+
+static int emu_ecc_point(const mbedtls_ecp_group *grp, mbedtls_ecp_point *P,
+			 const char *xs, const char *ys)
+{
+	int ret = emu_hex_get(&P->X, xs);
+
+	if (ret == ST_SUCCESS)
+		ret = emu_hex_get(&P->Y, ys);
+	if (ret == ST_SUCCESS && (mbedtls_mpi_lset(&P->Z, 1) || mbedtls_ecp_check_pubkey(grp, P)))
+		ret = ST_INVALID_PARAM;
+	return ret;
+}
+
+static int emu_ecc_put_point(char *out, const mbedtls_ecp_point *P)
+{
+	int ret = emu_hex_put(out, &P->X);
+
+	if (ret == ST_SUCCESS)
+		ret = emu_hex_put(out + EMU_ECC_SLOT, &P->Y);
+	return ret;
+}
+
+#define EMU_CHK(f)  do { if ((ret = (f)) != 0) { ret = ST_HW_ERROR; goto out; } } while (0)
+#define EMU_ST(f)   do { if ((ret = (f)) != ST_SUCCESS) goto out; } while (0)
+
+static int emu_ecc_sign(const mbedtls_ecp_group *grp, const uint32_t cmd[4])
+{
+	int rsel = (cmd[1] >> 10) & 1, psel = (cmd[1] >> 8) & 3, knum = cmd[1] & 0xff;
+	char *param = emu_dma(cmd[2], EMU_ECC_SLOT * 3);
+	char *sig = emu_dma(cmd[3], EMU_ECC_SLOT * 2);
+	mbedtls_mpi e, d, k, r, s, t;
+	mbedtls_ecp_point R;
+	int ret;
+
+	if (!param || !sig)
+		return ST_BUS_ERROR;
+	mbedtls_mpi_init(&e); mbedtls_mpi_init(&d); mbedtls_mpi_init(&k);
+	mbedtls_mpi_init(&r); mbedtls_mpi_init(&s); mbedtls_mpi_init(&t);
+	mbedtls_ecp_point_init(&R);
+
+	EMU_ST(emu_ecc_digest(grp, &e, param));
+	EMU_ST(emu_ecc_scalar(grp, &d, psel, knum, param + EMU_ECC_SLOT));
+	ret = emu_ecc_scalar(grp, &k, rsel ? ECC_KEY_SEL_USER : ECC_KEY_SEL_TRNG, 0,
+			     param + 2 * EMU_ECC_SLOT);
+	if (ret != ST_SUCCESS) {
+		ret = ST_INVALID_PARAM;
+		goto out;
+	}
+
+	EMU_CHK(mbedtls_ecp_mul((mbedtls_ecp_group *)grp, &R, &k, &grp->G, emu_rng, NULL));
+	EMU_CHK(mbedtls_mpi_mod_mpi(&r, &R.X, &grp->N));
+	EMU_CHK(mbedtls_mpi_mul_mpi(&t, &r, &d));
+	EMU_CHK(mbedtls_mpi_add_mpi(&t, &t, &e));
+	EMU_CHK(mbedtls_mpi_inv_mod(&s, &k, &grp->N));
+	EMU_CHK(mbedtls_mpi_mul_mpi(&s, &s, &t));
+	EMU_CHK(mbedtls_mpi_mod_mpi(&s, &s, &grp->N));
+	if (!mbedtls_mpi_cmp_int(&r, 0) || !mbedtls_mpi_cmp_int(&s, 0)) {
+		ret = ST_INVALID_PARAM;
+		goto out;
+	}
+	EMU_ST(emu_hex_put(sig, &r));
+	EMU_ST(emu_hex_put(sig + EMU_ECC_SLOT, &s));
+out:
+	mbedtls_mpi_free(&e); mbedtls_mpi_free(&d); mbedtls_mpi_free(&k);
+	mbedtls_mpi_free(&r); mbedtls_mpi_free(&s); mbedtls_mpi_free(&t);
+	mbedtls_ecp_point_free(&R);
+	return ret;
+}
+
+static int emu_ecc_verify(const mbedtls_ecp_group *grp, const uint32_t cmd[4])
+{
+	int psel = (cmd[1] >> 16) & 3, y_knum = (cmd[1] >> 8) & 0xff, x_knum = cmd[1] & 0xff;
+	char *param = emu_dma(cmd[2], EMU_ECC_SLOT * 5);
+	mbedtls_mpi e, r, s, si, u1, u2;
+	mbedtls_ecp_point Q, R;
+	int ret;
+
+	if (!param)
+		return ST_BUS_ERROR;
+	mbedtls_mpi_init(&e); mbedtls_mpi_init(&r); mbedtls_mpi_init(&s);
+	mbedtls_mpi_init(&si); mbedtls_mpi_init(&u1); mbedtls_mpi_init(&u2);
+	mbedtls_ecp_point_init(&Q); mbedtls_ecp_point_init(&R);
+
+	EMU_ST(emu_ecc_digest(grp, &e, param));
+	if (psel == ECC_KEY_SEL_USER) {
+		EMU_ST(emu_ecc_point(grp, &Q, param + EMU_ECC_SLOT, param + 2 * EMU_ECC_SLOT));
+	} else {
+		EMU_ST(emu_ks_mpi(&Q.X, psel, x_knum, KS_OWNER_ECC));
+		EMU_ST(emu_ks_mpi(&Q.Y, psel, y_knum, KS_OWNER_ECC));
+		if (mbedtls_mpi_lset(&Q.Z, 1) || mbedtls_ecp_check_pubkey(grp, &Q)) {
+			ret = ST_INVALID_PARAM;
+			goto out;
+		}
+	}
+	EMU_ST(emu_hex_get(&r, param + 3 * EMU_ECC_SLOT));
+	EMU_ST(emu_hex_get(&s, param + 4 * EMU_ECC_SLOT));
+	if (mbedtls_mpi_cmp_int(&r, 1) < 0 || mbedtls_mpi_cmp_mpi(&r, &grp->N) >= 0 ||
+	    mbedtls_mpi_cmp_int(&s, 1) < 0 || mbedtls_mpi_cmp_mpi(&s, &grp->N) >= 0) {
+		ret = ST_SIG_VERIFY_ERROR;
+		goto out;
+	}
+
+	EMU_CHK(mbedtls_mpi_inv_mod(&si, &s, &grp->N));
+	EMU_CHK(mbedtls_mpi_mul_mpi(&u1, &e, &si));
+	EMU_CHK(mbedtls_mpi_mod_mpi(&u1, &u1, &grp->N));
+	EMU_CHK(mbedtls_mpi_mul_mpi(&u2, &r, &si));
+	EMU_CHK(mbedtls_mpi_mod_mpi(&u2, &u2, &grp->N));
+	EMU_CHK(mbedtls_ecp_muladd((mbedtls_ecp_group *)grp, &R, &u1, &grp->G, &u2, &Q));
+	if (mbedtls_ecp_is_zero(&R)) {
+		ret = ST_SIG_VERIFY_ERROR;
+		goto out;
+	}
+	EMU_CHK(mbedtls_mpi_mod_mpi(&R.X, &R.X, &grp->N));
+	ret = mbedtls_mpi_cmp_mpi(&R.X, &r) ? ST_SIG_VERIFY_ERROR : ST_SUCCESS;
+out:
+	mbedtls_mpi_free(&e); mbedtls_mpi_free(&r); mbedtls_mpi_free(&s);
+	mbedtls_mpi_free(&si); mbedtls_mpi_free(&u1); mbedtls_mpi_free(&u2);
+	mbedtls_ecp_point_free(&Q); mbedtls_ecp_point_free(&R);
+	return ret;
+}
+
+static int emu_ecc_multiply(const mbedtls_ecp_group *grp, const uint32_t cmd[4])
+{
+	int msel = (cmd[1] >> 26) & 3, sps = (cmd[1] >> 24) & 3;
+	int m_knum = (cmd[1] >> 16) & 0xff, x_knum = (cmd[1] >> 8) & 0xff, y_knum = cmd[1] & 0xff;
+	char *param = emu_dma(cmd[2], EMU_ECC_SLOT * 3);
+	char *out = emu_dma(cmd[3], EMU_ECC_SLOT * 2);
+	mbedtls_ecp_point P, R;
+	mbedtls_mpi k;
+	int ret;
+
+	if (!param || !out)
+		return ST_BUS_ERROR;
+	if (!msel || !sps)
+		return ST_INVALID_PARAM;
+	mbedtls_mpi_init(&k);
+	mbedtls_ecp_point_init(&P); mbedtls_ecp_point_init(&R);
+
+	EMU_ST(emu_ecc_scalar(grp, &k, msel, m_knum, param + 2 * EMU_ECC_SLOT));
+	if (sps == 0x3) {
+		EMU_ST(emu_ecc_point(grp, &P, param, param + EMU_ECC_SLOT));
+	} else {
+		EMU_ST(emu_ks_mpi(&P.X, sps, x_knum, KS_OWNER_ECC));
+		EMU_ST(emu_ks_mpi(&P.Y, sps, y_knum, KS_OWNER_ECC));
+		if (mbedtls_mpi_lset(&P.Z, 1) || mbedtls_ecp_check_pubkey(grp, &P)) {
+			ret = ST_INVALID_PARAM;
+			goto out;
+		}
+	}
+	EMU_CHK(mbedtls_ecp_mul((mbedtls_ecp_group *)grp, &R, &k, &P, emu_rng, NULL));
+	if (mbedtls_ecp_is_zero(&R)) {
+		ret = ST_INVALID_PARAM;
+		goto out;
+	}
+	ret = emu_ecc_put_point(out, &R);
+out:
+	mbedtls_mpi_free(&k);
+	mbedtls_ecp_point_free(&P); mbedtls_ecp_point_free(&R);
+	return ret;
+}
+
+static int emu_ecc_gen_pub(const mbedtls_ecp_group *grp, const uint32_t cmd[4])
+{
+	int psel = (cmd[1] >> 8) & 3, knum = cmd[1] & 0xff;
+	char *priv = (psel == ECC_KEY_SEL_USER) ? emu_dma(cmd[2], EMU_ECC_SLOT) : NULL;
+	char *pub = emu_dma(cmd[3], EMU_ECC_SLOT * 2);
+	mbedtls_ecp_point Q;
+	mbedtls_mpi d;
+	int ret;
+
+	if (!pub || ((psel == ECC_KEY_SEL_USER) && !priv))
+		return ST_BUS_ERROR;
+	mbedtls_mpi_init(&d);
+	mbedtls_ecp_point_init(&Q);
+
+	EMU_ST(emu_ecc_scalar(grp, &d, psel, knum, priv));
+	EMU_CHK(mbedtls_ecp_mul((mbedtls_ecp_group *)grp, &Q, &d, &grp->G, emu_rng, NULL));
+	ret = emu_ecc_put_point(pub, &Q);
+out:
+	mbedtls_mpi_free(&d);
+	mbedtls_ecp_point_free(&Q);
+	return ret;
+}
+
+static int emu_ecc(const uint32_t cmd[4], uint32_t ack[4])
+{
+	mbedtls_ecp_group grp;
+	int ret;
+
+	(void)ack;
+	mbedtls_ecp_group_init(&grp);
+	ret = emu_ecc_group(cmd[0] & 0xff, &grp);
+	if (ret != ST_SUCCESS)
+		goto out;
+
+	switch ((cmd[0] >> 16) & 0xffff) {
+	case CMD_ECC_GEN_PUB_KEY:
+		ret = emu_ecc_gen_pub(&grp, cmd);
+		break;
+	case CMD_ECC_GEN_SIG:
+		ret = emu_ecc_sign(&grp, cmd);
+		break;
+	case CMD_ECC_VERIFY_SIG:
+		ret = emu_ecc_verify(&grp, cmd);
+		break;
+	case CMD_ECC_MULTIPLY:
+		ret = emu_ecc_multiply(&grp, cmd);
+		break;
+	default:
+		ret = ST_UNKNOWN_CMD;
+		break;
+	}
+out:
+	mbedtls_ecp_group_free(&grp);
+	return ret;
+}
+
+/*---------------------------------------------------------------------------
+ *  RSA
+ *---------------------------------------------------------------------------*/
+
+/*
+ * Numbers are little endian, least significant word first, one
+ * EMU_RSA_SLOT slot each: M, N, exponent, then P and Q in CRT mode, where
+ * the exponent is D and the result is recombined from the halves.
+ */
+#define EMU_RSA_SLOT        512
+#define EMU_RSA_SLOTS_CRT   12
+
+static int s_rsa_fault;         /* results still to be corrupted */
+
+static int emu_rsa_get(mbedtls_mpi *X, const uint8_t *slot, size_t len)
+{
+	return mbedtls_mpi_read_binary_le(X, slot, len) ? ST_HW_ERROR : ST_SUCCESS;
+}
+
+static int emu_rsa_crt(mbedtls_mpi *R, const mbedtls_mpi *M, const mbedtls_mpi *D,
+		       const mbedtls_mpi *P, const mbedtls_mpi *Q)
+{
+	mbedtls_mpi dp, dq, qi, m1, m2, t;
+	int ret;
+
+	mbedtls_mpi_init(&dp);
+	mbedtls_mpi_init(&dq);
+	mbedtls_mpi_init(&qi);
+	mbedtls_mpi_init(&m1);
+	mbedtls_mpi_init(&m2);
+	mbedtls_mpi_init(&t);
+
+	/* dp = D mod (P - 1), dq = D mod (Q - 1), qi = Q^-1 mod P */
+	EMU_CHK(mbedtls_mpi_sub_int(&t, P, 1));
+	EMU_CHK(mbedtls_mpi_mod_mpi(&dp, D, &t));
+	EMU_CHK(mbedtls_mpi_sub_int(&t, Q, 1));
+	EMU_CHK(mbedtls_mpi_mod_mpi(&dq, D, &t));
+	if (mbedtls_mpi_inv_mod(&qi, Q, P)) {
+		ret = ST_INVALID_PARAM;
+		goto out;
+	}
+
+	/* R = m2 + Q * (qi * (m1 - m2) mod P) */
+	EMU_CHK(mbedtls_mpi_exp_mod(&m1, M, &dp, P, NULL));
+	EMU_CHK(mbedtls_mpi_exp_mod(&m2, M, &dq, Q, NULL));
+	EMU_CHK(mbedtls_mpi_sub_mpi(&t, &m1, &m2));
+	EMU_CHK(mbedtls_mpi_mul_mpi(&t, &t, &qi));
+	EMU_CHK(mbedtls_mpi_mod_mpi(&t, &t, P));
+	EMU_CHK(mbedtls_mpi_mul_mpi(&t, &t, Q));
+	EMU_CHK(mbedtls_mpi_add_mpi(R, &m2, &t));
+out:
+	mbedtls_mpi_free(&dp);
+	mbedtls_mpi_free(&dq);
+	mbedtls_mpi_free(&qi);
+	mbedtls_mpi_free(&m1);
+	mbedtls_mpi_free(&m2);
+	mbedtls_mpi_free(&t);
+	return ret;
+}
+
+static int emu_rsa_exp_mod(const uint32_t cmd[4])
+{
+	int rsa_len = cmd[0] & 0xff, crt = (cmd[1] >> 10) & 1;
+	int esel = (cmd[1] >> 8) & 3, knum = cmd[1] & 0xff;
+	size_t len = (size_t)(rsa_len + 1) * 128;
+	const uint8_t *param;
+	uint8_t *out;
+	mbedtls_mpi M, N, X, P, Q, R;
+	int ret;
+
+	if (rsa_len > 3 || esel == 0)
+		return ST_INVALID_PARAM;
+	param = emu_dma(cmd[2], EMU_RSA_SLOT * (crt ? EMU_RSA_SLOTS_CRT : 3));
+	out = emu_dma(cmd[3], len);
+	if (!param || !out)
+		return ST_BUS_ERROR;
+
+	mbedtls_mpi_init(&M);
+	mbedtls_mpi_init(&N);
+	mbedtls_mpi_init(&X);
+	mbedtls_mpi_init(&P);
+	mbedtls_mpi_init(&Q);
+	mbedtls_mpi_init(&R);
+
+	EMU_ST(emu_rsa_get(&M, param, len));
+	EMU_ST(emu_rsa_get(&N, param + EMU_RSA_SLOT, len));
+	if (esel == RSA_KEY_SEL_USER)
+		EMU_ST(emu_rsa_get(&X, param + 2 * EMU_RSA_SLOT, len));
+	else
+		EMU_ST(emu_ks_mpi(&X, esel, knum, KS_OWNER_RSA_EXP));
+	if ((mbedtls_mpi_get_bit(&N, 0) == 0) || (mbedtls_mpi_cmp_mpi(&M, &N) >= 0) ||
+	    (mbedtls_mpi_cmp_int(&X, 0) == 0) || (mbedtls_mpi_size(&X) > len)) {
+		ret = ST_INVALID_PARAM;
+		goto out;
+	}
+
+	if (crt) {
+		EMU_ST(emu_rsa_get(&P, param + 3 * EMU_RSA_SLOT, len));
+		EMU_ST(emu_rsa_get(&Q, param + 4 * EMU_RSA_SLOT, len));
+		if ((mbedtls_mpi_cmp_int(&P, 1) <= 0) || (mbedtls_mpi_cmp_int(&Q, 1) <= 0)) {
+			ret = ST_INVALID_PARAM;
+			goto out;
+		}
+		EMU_ST(emu_rsa_crt(&R, &M, &X, &P, &Q));
+	} else {
+		EMU_CHK(mbedtls_mpi_exp_mod(&R, &M, &X, &N, NULL));
+	}
+	if (s_rsa_fault > 0) {
+		s_rsa_fault--;
+		EMU_CHK(mbedtls_mpi_add_int(&R, &R, 1));
+	}
+	/* A wrong P or Q gives a wrong result, not an error, as on the TSI */
+	EMU_CHK(mbedtls_mpi_mod_mpi(&R, &R, &N));
+	EMU_CHK(mbedtls_mpi_write_binary_le(&R, out, len));
+out:
+	mbedtls_mpi_free(&M);
+	mbedtls_mpi_free(&N);
+	mbedtls_mpi_free(&X);
+	mbedtls_mpi_free(&P);
+	mbedtls_mpi_free(&Q);
+	mbedtls_mpi_free(&R);
+	return ret;
+}
+
+/*---------------------------------------------------------------------------
+ *  TRNG
+ *---------------------------------------------------------------------------*/
+
+static int s_trng_init;
+static int s_trng_fault, s_trng_fault_n;   /* TSI_EMU_TRNG_xxx, commands left */
+
+static int emu_trng(const uint32_t cmd[4], uint32_t ack[4])
+{
+	uint8_t *dst;
+	size_t len, i;
+
+	(void)ack;
+	switch ((cmd[0] >> 16) & 0xffff) {
+	case CMD_TRNG_INIT:
+		if ((cmd[0] & 0xffff) > 2)
+			return ST_INVALID_PARAM;
+		if ((cmd[0] & 0xffff) && !emu_dma(cmd[1], 48 * 4))
+			return ST_BUS_ERROR;
+		s_trng_init = 1;
+		return ST_SUCCESS;
+
+	case CMD_TRNG_GEN_RANDOM:
+		if (!s_trng_init)
+			return ST_HW_NOT_READY;
+		len = (size_t)cmd[2] * 4;
+		dst = emu_dma(cmd[3], len);
+		if (!dst || (cmd[3] & 3))
+			return ST_BUS_ERROR;
+		emu_rng(NULL, dst, len);
+		if (s_trng_fault_n > 0) {
+			s_trng_fault_n--;
+			if (s_trng_fault == TSI_EMU_TRNG_STUCK) {
+				memset(dst, 0xa5, len);
+			} else if (s_trng_fault == TSI_EMU_TRNG_BIASED) {
+				for (i = 0; i < len; i += 4)
+					dst[i] = 0x5a;
+			} else {
+				return ST_HW_ERROR;
+			}
+		}
+		return ST_SUCCESS;
+
+	default:
+		return ST_UNKNOWN_CMD;
+	}
+}
+
+/*---------------------------------------------------------------------------
+ *  Mailbox
+ *---------------------------------------------------------------------------*/
+
+static const emu_handler_t s_handlers[16] = {
+	[C_CODE_TSI_CTRL] = emu_tsi_ctrl,
+	[C_CODE_TRNG]     = emu_trng,
+	[C_CODE_AES]      = emu_aes,
+	[C_CODE_SHA]      = emu_sha,
+	[C_CODE_ECC]      = emu_ecc,
+	/* Key Store commands are 0x0Axx, not C_CODE_KS */
+	[CMD_KS_WRITE_SRAM_KEY >> 8] = emu_ks,
+};
+
+/* TSI clock setting TSI_Init() sends after loading the patch image */
+static int emu_set_clock(const uint32_t cmd[4])
+{
+	(void)cmd;
+	return ST_SUCCESS;
+}
+
+/* Extended commands, 0xFExx/0xF9xx in the upper half of cmd[0] */
+static const struct {
+	uint32_t cmd;
+	int class_code;             /* class counted in the statistics */
+	int (*fn)(const uint32_t cmd[4]);
+} s_ext_handlers[] = {
+	{ CMD_EXT_SHA_START,   C_CODE_SHA, emu_sha_start },
+	{ CMD_EXT_SHA_UPDATE,  C_CODE_SHA, emu_sha_update },
+	{ CMD_EXT_SHA_FINISH,  C_CODE_SHA, emu_sha_finish },
+	{ CMD_EXT_RSA_EXP_MOD, C_CODE_RSA, emu_rsa_exp_mod },
+	{ 0xFA01,              C_CODE_TSI_CTRL, emu_set_clock },
+};
+
+static int emu_execute_ext(const uint32_t cmd[4])
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(s_ext_handlers) / sizeof(s_ext_handlers[0]); i++) {
+		if ((cmd[0] >> 16) == s_ext_handlers[i].cmd) {
+			s_stats.cmds_class[s_ext_handlers[i].class_code]++;
+			return s_ext_handlers[i].fn(cmd);
+		}
+	}
+	return ST_UNKNOWN_CMD;
+}
+
+static void emu_ack_push(const uint32_t ack[4])
+{
+	pthread_mutex_lock(&s_mbox_mtx);
+	if (s_ackq_cnt == EMU_ACK_QUEUE)
+		fprintf(stderr, "tsi_emu: ACK queue overflow, ACK 0x%08x dropped\n", ack[0]);
+	else
+		memcpy(s_ackq[(s_ackq_head + s_ackq_cnt++) % EMU_ACK_QUEUE], ack, 16);
+	pthread_mutex_unlock(&s_mbox_mtx);
+}
+
+static void emu_sleep_us(uint32_t us)
+{
+	struct timespec ts = { us / 1000000, (long)(us % 1000000) * 1000 };
+
+	while (nanosleep(&ts, &ts) != 0)
+		;
+}
+
+static void emu_execute(const uint32_t cmd[4])
+{
+	uint32_t ack[4] = { 0 };
+	int class_code = (cmd[0] >> 24) & 0xff;
+	int status;
+
+	if (s_latency_us)
+		emu_sleep_us(s_latency_us);
+
+	pthread_mutex_lock(&s_exec_mtx);
+	s_stats.cmds++;
+
+	if (class_code >= 0xF0) {
+		status = emu_execute_ext(cmd);
+	} else {
+		s_stats.cmds_class[class_code & 0xf]++;
+		if ((class_code < 16) && s_handlers[class_code])
+			status = s_handlers[class_code](cmd, ack);
+		else
+			status = ST_UNKNOWN_CMD;
+	}
+	if (status != ST_SUCCESS)
+		s_stats.errors++;
+	pthread_mutex_unlock(&s_exec_mtx);
+
+	ack[0] = (cmd[0] & TCK_CHR_MASK) | ((status & 0xff) << 8);
+	emu_ack_push(ack);
+}
+
+/* TSI core of the pipelined mode: runs the queued commands in order */
+static void *emu_tsi_main(void *arg)
+{
+	uint32_t cmd[4];
+
+	(void)arg;
+	pthread_mutex_lock(&s_mbox_mtx);
+	for (;;) {
+		while (!s_tsiq_cnt && !s_tsi_stop)
+			pthread_cond_wait(&s_tsiq_cv, &s_mbox_mtx);
+		if (!s_tsiq_cnt)
+			break;
+		memcpy(cmd, s_tsiq[s_tsiq_head], sizeof(cmd));
+		s_tsiq_head = (s_tsiq_head + 1) % EMU_TSI_QUEUE;
+		s_tsiq_cnt--;
+		s_tsiq_busy = 1;
+		pthread_mutex_unlock(&s_mbox_mtx);
+
+		emu_execute(cmd);
+
+		pthread_mutex_lock(&s_mbox_mtx);
+		s_tsiq_busy = 0;
+	}
+	pthread_mutex_unlock(&s_mbox_mtx);
+	return NULL;
+}
+
+/* Queue a command to the TSI core, or answer it when the queue is full */
+static void emu_tsi_queue(const uint32_t cmd[4])
+{
+	uint32_t ack[4] = { 0 };
+
+	pthread_mutex_lock(&s_mbox_mtx);
+	if (s_tsiq_cnt < EMU_TSI_QUEUE) {
+		memcpy(s_tsiq[(s_tsiq_head + s_tsiq_cnt++) % EMU_TSI_QUEUE], cmd, 16);
+		if (s_tsiq_cnt + s_tsiq_busy > s_tsiq_peak)
+			s_tsiq_peak = s_tsiq_cnt + s_tsiq_busy;
+		pthread_cond_signal(&s_tsiq_cv);
+		pthread_mutex_unlock(&s_mbox_mtx);
+		return;
+	}
+	pthread_mutex_unlock(&s_mbox_mtx);
+
+	ack[0] = (cmd[0] & TCK_CHR_MASK) | (ST_CMD_QUEUE_FULL << 8);
+	emu_ack_push(ack);
+}
+
+/* Take the WRHO1 interrupt if it is pending, enabled and not active */
+static void emu_irq_check(void)
+{
+	uint32_t pend;
+
+	if (!s_irq_handler || !s_irq_enabled || s_in_irq)
+		return;
+	/* A handler may send commands whose ACKs raise the interrupt again */
+	while ((pend = s_irq_pending & tsi_emu_whc1.INTEN) != 0) {
+		s_irq_pending &= ~pend;
+		tsi_emu_whc1.INTSTS = pend;
+		s_in_irq = 1;
+		s_irq_handler();
+		s_in_irq = 0;
+		tsi_emu_whc1.INTSTS = 0;
+		s_irqs++;
+	}
+}
+
+static void emu_service(void)
+{
+	WHC_T *whc = &tsi_emu_whc1;
+	uint32_t cmd[4];
+	int i, j;
+
+	/* CPU released RX channels */
+	if (whc->RXCTL) {
+		whc->RXSTS &= ~(whc->RXCTL & 0xf);
+		whc->RXCTL = 0;
+	}
+
+	/* New messages; a recall of an already fetched command is a no-op */
+	if (whc->TXCTL) {
+		for (i = 0; i < 4; i++) {
+			if (!(whc->TXCTL & (1u << i)))
+				continue;
+			for (j = 0; j < 4; j++)
+				cmd[j] = whc->TMDAT[i][j];
+			if (s_tsi_running)
+				emu_tsi_queue(cmd);
+			else
+				emu_execute(cmd);
+		}
+		whc->TXCTL = 0;
+	}
+	whc->TXSTS = 0xf;
+
+	/* Post ACKs to free RX channels */
+	pthread_mutex_lock(&s_mbox_mtx);
+	for (i = 0; (i < EMU_RX_CHANNELS) && s_ackq_cnt; i++) {
+		if (whc->RXSTS & (1u << i))
+			continue;
+		for (j = 0; j < 4; j++)
+			whc->RMDAT[i][j] = s_ackq[s_ackq_head][j];
+		s_ackq_head = (s_ackq_head + 1) % EMU_ACK_QUEUE;
+		s_ackq_cnt--;
+		whc->RXSTS |= (1u << i);
+		s_irq_pending |= (WHC_INTSTS_RX0IF_Msk << i) & whc->INTEN;
+	}
+	pthread_mutex_unlock(&s_mbox_mtx);
+
+	emu_irq_check();
+}
+
+WHC_T *tsi_emu_whc1_access(void)
+{
+	emu_service();
+	return &tsi_emu_whc1;
+}
+
+uint64_t EL0_GetCurrentPhysicalValue(void)
+{
+	struct timespec ts;
+
+	emu_service();
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 12000000ull + (uint64_t)ts.tv_nsec / 1000 * 12;
+}
+
+int32_t IRQ_SetHandler(IRQn_ID_t irqn, IRQHandler_t handler)
+{
+	if (irqn != WRHO1_IRQn)
+		return -1;
+	s_irq_handler = handler;
+	return 0;
+}
+
+int32_t IRQ_Enable(IRQn_ID_t irqn)
+{
+	if (irqn != WRHO1_IRQn)
+		return -1;
+	s_irq_enabled = 1;
+	emu_irq_check();
+	return 0;
+}
+
+int32_t IRQ_Disable(IRQn_ID_t irqn)
+{
+	if (irqn != WRHO1_IRQn)
+		return -1;
+	s_irq_enabled = 0;
+	return 0;
+}
+
+/*---------------------------------------------------------------------------
+ *  Control and reference
+ *---------------------------------------------------------------------------*/
+
+void tsi_emu_reset(void)
+{
+	int i;
+
+	pthread_mutex_lock(&s_exec_mtx);
+	for (i = 0; i < TSI_EMU_MAX_SESSIONS; i++)
+		emu_session_clear(&s_sess[i]);
+	s_stats.sessions = 0;
+	/* Key Store SRAM is volatile, OTP keys stay */
+	memset(s_ks_sram, 0, sizeof(s_ks_sram));
+	s_trng_fault_n = 0;
+	pthread_mutex_unlock(&s_exec_mtx);
+
+	pthread_mutex_lock(&s_mbox_mtx);
+	memset((void *)&tsi_emu_whc1, 0, sizeof(tsi_emu_whc1));
+	tsi_emu_whc1.TXSTS = 0xf;
+	s_ackq_head = s_ackq_cnt = 0;
+	s_tsiq_head = s_tsiq_cnt = 0;
+	s_irq_pending = 0;
+	pthread_mutex_unlock(&s_mbox_mtx);
+}
+
+void tsi_emu_set_pipelined(int enable)
+{
+	if (enable && !s_tsi_running) {
+		s_tsi_stop = 0;
+		if (pthread_create(&s_tsi_thread, NULL, emu_tsi_main, NULL) == 0)
+			s_tsi_running = 1;
+	} else if (!enable && s_tsi_running) {
+		/* The TSI core finishes the queued commands first */
+		pthread_mutex_lock(&s_mbox_mtx);
+		s_tsi_stop = 1;
+		pthread_cond_signal(&s_tsiq_cv);
+		pthread_mutex_unlock(&s_mbox_mtx);
+		pthread_join(s_tsi_thread, NULL);
+		s_tsi_running = 0;
+	}
+}
+
+void tsi_emu_set_latency(uint32_t us)
+{
+	s_latency_us = us;
+}
+
+int tsi_emu_dma_ok(const void *p, size_t len)
+{
+	uintptr_t a = (uintptr_t)p;
+
+	return (a <= 0xffffffffu) && (emu_dma((uint32_t)a, len) != NULL);
+}
+
+void tsi_emu_set_ecc_curve(int curve, int enable)
+{
+	int i;
+
+	for (i = 0; i < EMU_ECC_CURVES; i++) {
+		if (s_ecc_curves[i].curve != curve)
+			continue;
+		if (enable)
+			s_ecc_off &= ~(1u << i);
+		else
+			s_ecc_off |= (1u << i);
+	}
+}
+
+void tsi_emu_set_rsa_fault(int n)
+{
+	s_rsa_fault = n;
+}
+
+void tsi_emu_set_trng_fault(int fault, int n)
+{
+	pthread_mutex_lock(&s_exec_mtx);
+	s_trng_fault = fault;
+	s_trng_fault_n = n;
+	pthread_mutex_unlock(&s_exec_mtx);
+}
+
+void tsi_emu_set_max_sessions(int n)
+{
+	if (n < 1)
+		n = 1;
+	if (n > TSI_EMU_MAX_SESSIONS)
+		n = TSI_EMU_MAX_SESSIONS;
+	s_max_sess = n;
+}
+
+void tsi_emu_get_stats(struct tsi_emu_stats *st)
+{
+	pthread_mutex_lock(&s_exec_mtx);
+	*st = s_stats;
+	pthread_mutex_unlock(&s_exec_mtx);
+	pthread_mutex_lock(&s_mbox_mtx);
+	st->queue_peak = s_tsiq_peak;
+	pthread_mutex_unlock(&s_mbox_mtx);
+	st->irqs = s_irqs;
+}
+
+void tsi_emu_reset_stats(void)
+{
+	uint32_t sessions;
+
+	pthread_mutex_lock(&s_exec_mtx);
+	sessions = s_stats.sessions;
+	memset(&s_stats, 0, sizeof(s_stats));
+	s_stats.sessions = sessions;
+	s_stats.sessions_peak = sessions;
+	pthread_mutex_unlock(&s_exec_mtx);
+	pthread_mutex_lock(&s_mbox_mtx);
+	s_tsiq_peak = s_tsiq_cnt + s_tsiq_busy;
+	pthread_mutex_unlock(&s_mbox_mtx);
+	s_irqs = 0;
+}
+
+int tsi_emu_ref_aes(int mode, int encrypt, const uint8_t *key, int keybits,
+		    const uint8_t iv[16], const uint8_t *in, uint8_t *out,
+		    size_t len)
+{
+	mbedtls_aes_context ctx;
+	uint8_t v[16], sb[16];
+	size_t off = 0, i;
+	int op = encrypt ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT;
+	int ret;
+
+	mbedtls_aes_init(&ctx);
+	if (encrypt || mode == AES_MODE_CFB || mode == AES_MODE_OFB ||
+	    mode == AES_MODE_CTR || mode == TSI_EMU_REF_CFB8)
+		ret = mbedtls_aes_setkey_enc(&ctx, key, keybits);
+	else
+		ret = mbedtls_aes_setkey_dec(&ctx, key, keybits);
+	if (ret)
+		goto out;
+
+	if (iv)
+		memcpy(v, iv, 16);
+
+	switch (mode) {
+	case AES_MODE_ECB:
+		for (i = 0; (i + 16 <= len) && !ret; i += 16)
+			ret = mbedtls_aes_crypt_ecb(&ctx, op, in + i, out + i);
+		break;
+	case AES_MODE_CBC:
+		ret = mbedtls_aes_crypt_cbc(&ctx, op, len, v, in, out);
+		break;
+	case AES_MODE_CFB:
+		ret = mbedtls_aes_crypt_cfb128(&ctx, op, len, &off, v, in, out);
+		break;
+	case TSI_EMU_REF_CFB8:
+		ret = mbedtls_aes_crypt_cfb8(&ctx, op, len, v, in, out);
+		break;
+	case AES_MODE_OFB:
+		ret = mbedtls_aes_crypt_ofb(&ctx, len, &off, v, in, out);
+		break;
+	case AES_MODE_CTR:
+		ret = mbedtls_aes_crypt_ctr(&ctx, len, &off, v, sb, in, out);
+		break;
+	default:
+		ret = -1;
+		break;
+	}
+out:
+	mbedtls_aes_free(&ctx);
+	return ret;
+}
+
+int tsi_emu_ref_sha(int sel, int mode, const uint8_t *in, size_t len,
+		    uint8_t *out)
+{
+	struct emu_hash h;
+
+	if (emu_hash_setup(&h, sel, mode) != ST_SUCCESS)
+		return -1;
+	emu_hash_start(&h);
+	emu_hash_update(&h, in, len);
+	emu_hash_finish(&h, out);
+	return 0;
+}
+
+int tsi_emu_ref_hmac(int sel, int mode, const uint8_t *key, size_t keylen,
+		     const uint8_t *in, size_t len, uint8_t *out)
+{
+	struct emu_sha sha;
+
+	memset(&sha, 0, sizeof(sha));
+	if (emu_hash_setup(&sha.h, sel, mode) != ST_SUCCESS)
+		return -1;
+	emu_hmac_key(&sha, key, keylen);
+	emu_hash_update(&sha.h, in, len);
+	emu_hmac_finish(&sha, out);
+	return 0;
+}
+
+int tsi_emu_ref_gcm(int encrypt, const uint8_t *key, int keybits,
+		    const uint8_t *iv, size_t iv_len, const uint8_t *add,
+		    size_t add_len, const uint8_t *in, uint8_t *out, size_t len,
+		    uint8_t *tag, size_t tag_len)
+{
+	mbedtls_gcm_context ctx;
+	int ret;
+
+	mbedtls_gcm_init(&ctx);
+	ret = mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, keybits);
+	if (!ret)
+		ret = mbedtls_gcm_crypt_and_tag(&ctx, encrypt ? MBEDTLS_GCM_ENCRYPT :
+						MBEDTLS_GCM_DECRYPT, len, iv, iv_len,
+						add, add_len, in, out, tag_len, tag);
+	mbedtls_gcm_free(&ctx);
+	return ret;
+}
+
+int tsi_emu_ref_ccm(int encrypt, const uint8_t *key, int keybits,
+		    const uint8_t *iv, size_t iv_len, const uint8_t *add,
+		    size_t add_len, const uint8_t *in, uint8_t *out, size_t len,
+		    uint8_t *tag, size_t tag_len)
+{
+	mbedtls_ccm_context ctx;
+	int ret;
+
+	mbedtls_ccm_init(&ctx);
+	ret = mbedtls_ccm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, keybits);
+	if (ret)
+		goto out;
+	if (encrypt)
+		ret = mbedtls_ccm_star_encrypt_and_tag(&ctx, len, iv, iv_len, add,
+						       add_len, in, out, tag, tag_len);
+	else
+		ret = mbedtls_ccm_star_auth_decrypt(&ctx, len, iv, iv_len, add,
+						    add_len, in, out, tag, tag_len);
+out:
+	mbedtls_ccm_free(&ctx);
+	return ret;
+}
+
+/*
+ * ECC references. Scalars and coordinates are big-endian byte strings,
+ * points are uncompressed (04 || X || Y).
+ */
+static int emu_ref_point(const mbedtls_ecp_group *grp, mbedtls_ecp_point *P,
+			 const uint8_t *buf, size_t len)
+{
+	if (!buf)
+		return mbedtls_ecp_copy(P, &grp->G);
+	return mbedtls_ecp_point_read_binary(grp, P, buf, len);
+}
+
+int tsi_emu_ref_ecp_mul(int gid, const uint8_t *k, size_t klen,
+			const uint8_t *P, size_t plen, uint8_t *R, size_t rsize,
+			size_t *rlen)
+{
+	mbedtls_ecp_group grp;
+	mbedtls_ecp_point A, B;
+	mbedtls_mpi m;
+	int ret;
+
+	mbedtls_ecp_group_init(&grp);
+	mbedtls_ecp_point_init(&A);
+	mbedtls_ecp_point_init(&B);
+	mbedtls_mpi_init(&m);
+	ret = mbedtls_ecp_group_load(&grp, gid);
+	if (!ret)
+		ret = emu_ref_point(&grp, &A, P, plen);
+	if (!ret)
+		ret = mbedtls_mpi_read_binary(&m, k, klen);
+	if (!ret)
+		ret = mbedtls_ecp_mul(&grp, &B, &m, &A, emu_rng, NULL);
+	if (!ret)
+		ret = mbedtls_ecp_point_write_binary(&grp, &B, MBEDTLS_ECP_PF_UNCOMPRESSED,
+						     rlen, R, rsize);
+	mbedtls_ecp_group_free(&grp);
+	mbedtls_ecp_point_free(&A);
+	mbedtls_ecp_point_free(&B);
+	mbedtls_mpi_free(&m);
+	return ret;
+}
+
+int tsi_emu_ref_ecdsa_sign_det(int gid, int md_alg, const uint8_t *d,
+			       size_t dlen, const uint8_t *hash, size_t hlen,
+			       uint8_t *r, uint8_t *s, size_t nlen)
+{
+	mbedtls_ecp_group grp;
+	mbedtls_mpi md, mr, ms;
+	int ret;
+
+	mbedtls_ecp_group_init(&grp);
+	mbedtls_mpi_init(&md);
+	mbedtls_mpi_init(&mr);
+	mbedtls_mpi_init(&ms);
+	ret = mbedtls_ecp_group_load(&grp, gid);
+	if (!ret)
+		ret = mbedtls_mpi_read_binary(&md, d, dlen);
+	if (!ret)
+		ret = mbedtls_ecdsa_sign_det_ext(&grp, &mr, &ms, &md, hash, hlen,
+						 md_alg, emu_rng, NULL);
+	if (!ret)
+		ret = mbedtls_mpi_write_binary(&mr, r, nlen);
+	if (!ret)
+		ret = mbedtls_mpi_write_binary(&ms, s, nlen);
+	mbedtls_ecp_group_free(&grp);
+	mbedtls_mpi_free(&md);
+	mbedtls_mpi_free(&mr);
+	mbedtls_mpi_free(&ms);
+	return ret;
+}
+
+int tsi_emu_ref_ecdsa_verify(int gid, const uint8_t *Q, size_t qlen,
+			     const uint8_t *hash, size_t hlen, const uint8_t *r,
+			     const uint8_t *s, size_t nlen)
+{
+	mbedtls_ecp_group grp;
+	mbedtls_ecp_point P;
+	mbedtls_mpi mr, ms;
+	int ret;
+
+	mbedtls_ecp_group_init(&grp);
+	mbedtls_ecp_point_init(&P);
+	mbedtls_mpi_init(&mr);
+	mbedtls_mpi_init(&ms);
+	ret = mbedtls_ecp_group_load(&grp, gid);
+	if (!ret)
+		ret = mbedtls_ecp_point_read_binary(&grp, &P, Q, qlen);
+	if (!ret)
+		ret = mbedtls_mpi_read_binary(&mr, r, nlen);
+	if (!ret)
+		ret = mbedtls_mpi_read_binary(&ms, s, nlen);
+	if (!ret)
+		ret = mbedtls_ecdsa_verify(&grp, hash, hlen, &P, &mr, &ms);
+	mbedtls_ecp_group_free(&grp);
+	mbedtls_ecp_point_free(&P);
+	mbedtls_mpi_free(&mr);
+	mbedtls_mpi_free(&ms);
+	return ret;
+}
+
+int tsi_emu_ref_rsa_public(const uint8_t *N, const uint8_t *E, size_t elen,
+			   const uint8_t *in, uint8_t *out, size_t len)
+{
+	mbedtls_mpi mn, me, mx;
+	int ret;
+
+	mbedtls_mpi_init(&mn);
+	mbedtls_mpi_init(&me);
+	mbedtls_mpi_init(&mx);
+	ret = mbedtls_mpi_read_binary(&mn, N, len);
+	if (!ret)
+		ret = mbedtls_mpi_read_binary(&me, E, elen);
+	if (!ret)
+		ret = mbedtls_mpi_read_binary(&mx, in, len);
+	if (!ret)
+		ret = mbedtls_mpi_exp_mod(&mx, &mx, &me, &mn, NULL);
+	if (!ret)
+		ret = mbedtls_mpi_write_binary(&mx, out, len);
+	mbedtls_mpi_free(&mn);
+	mbedtls_mpi_free(&me);
+	mbedtls_mpi_free(&mx);
+	return ret;
+}
+
+/* Key of the last tsi_emu_ref_rsa_private() call, so benchmarks time the operation */
+static mbedtls_rsa_context s_ref_rsa;
+static uint8_t s_ref_rsa_key[2 * 512 + 8];
+static size_t s_ref_rsa_klen;
+
+int tsi_emu_ref_rsa_private(const uint8_t *P, const uint8_t *Q, size_t plen,
+			    const uint8_t *E, size_t elen, const uint8_t *in,
+			    uint8_t *out, size_t len)
+{
+	size_t klen = 2 * plen + elen;
+	int ret = 0;
+
+	if ((plen > 512) || (elen > 8))
+		return MBEDTLS_ERR_RSA_BAD_INPUT_DATA;
+	if ((klen != s_ref_rsa_klen) || memcmp(s_ref_rsa_key, P, plen) ||
+	    memcmp(s_ref_rsa_key + plen, Q, plen) || memcmp(s_ref_rsa_key + 2 * plen, E, elen)) {
+		mbedtls_rsa_free(&s_ref_rsa);
+		mbedtls_rsa_init(&s_ref_rsa);
+		s_ref_rsa_klen = 0;
+		ret = mbedtls_rsa_import_raw(&s_ref_rsa, NULL, 0, P, plen, Q, plen, NULL, 0,
+					     E, elen);
+		if (!ret)
+			ret = mbedtls_rsa_complete(&s_ref_rsa);
+		if (ret)
+			return ret;
+		memcpy(s_ref_rsa_key, P, plen);
+		memcpy(s_ref_rsa_key + plen, Q, plen);
+		memcpy(s_ref_rsa_key + 2 * plen, E, elen);
+		s_ref_rsa_klen = klen;
+	}
+	if (mbedtls_rsa_get_len(&s_ref_rsa) != len)
+		return MBEDTLS_ERR_RSA_BAD_INPUT_DATA;
+	return mbedtls_rsa_private(&s_ref_rsa, emu_rng, NULL, in, out);
+}
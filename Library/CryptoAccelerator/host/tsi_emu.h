@@ -0,0 +1,152 @@
+/**************************************************************************//**
+ * @file     tsi_emu.h
+ *
+ * @brief    Host emulator of the TSI behind the Wormhole 1 mailbox.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __TSI_EMU_H__
+#define __TSI_EMU_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * The emulator decodes the TSI command words written to WHC1 TMDAT, runs
+ * them on the mbedTLS software implementation and posts the ACK words to
+ * RMDAT, so tsi_cmd.c and the ALT port run unchanged on Linux. Every
+ * command is one mailbox round trip. The mailbox is serviced on every WHC1
+ * register access and system counter read. The WRHO1 interrupt is delivered to
+ * the handler tsi_cmd.c registers when built with USE_IRQ.
+ *
+ * DMA addresses are 32-bit as on the target. They are only accepted inside
+ * the host program image (static data of a non-PIE build), anything else is
+ * answered with ST_BUS_ERROR, which catches stack or heap buffers handed to
+ * the TSI the same way the target's DMA constraints would.
+ *
+ * Implemented: session control, AES block modes, the GCM/CCM runs of
+ * TSI_AES_GCM_Run, SHA-1/SHA-2/SHA-3 and HMAC (no SHAKE), the ECC commands,
+ * TSI_RSA_Exp_Mod, the TRNG and the Key Store key commands. SHA_Update
+ * refuses source addresses that are not word aligned and message data that
+ * is not a whole number of blocks.
+ */
+
+#define TSI_EMU_MAX_SESSIONS    16
+
+struct tsi_emu_stats {
+	uint64_t cmds;              /* mailbox round trips */
+	uint64_t cmds_class[16];    /* per TSI command class code */
+	uint64_t aes_runs;          /* TSI_AES_Run commands */
+	uint64_t aes_bytes;         /* bytes through the AES engine */
+	uint64_t sha_runs;          /* SHA_Update/SHA_Finish/All_At_Once commands */
+	uint64_t sha_bytes;         /* bytes through the SHA engine */
+	uint64_t errors;            /* commands answered with an error status */
+	uint32_t sessions;          /* currently open AES/SHA sessions */
+	uint32_t sessions_peak;
+	uint64_t irqs;              /* WRHO1 interrupts taken */
+	uint32_t queue_peak;        /* most commands queued in the TSI, pipelined mode */
+};
+
+void tsi_emu_reset(void);
+void tsi_emu_set_max_sessions(int n);
+
+/*
+ * Pipelined mode: commands run in order on a TSI core thread, concurrently
+ * with the program, and several can be queued. Off by default, where each
+ * command runs inside the driver call that sent it. Switching it off waits
+ * for the queued commands.
+ */
+void tsi_emu_set_pipelined(int enable);
+
+/* Engine time added to every command, in microseconds (default 0) */
+void tsi_emu_set_latency(uint32_t us);
+void tsi_emu_get_stats(struct tsi_emu_stats *st);
+void tsi_emu_reset_stats(void);
+
+/* Whether the emulated TSI DMA reaches len bytes at p */
+int tsi_emu_dma_ok(const void *p, size_t len);
+
+/*
+ * Make the ECC commands answer ST_ECC_UNKNOWN_CURVE for an E_ECC_CURVE, as
+ * a TSI firmware without that curve would.
+ */
+void tsi_emu_set_ecc_curve(int curve, int enable);
+
+/*
+ * Corrupt the results of the next n RSA exponentiations, as a glitch of
+ * the RSA engine, or a CRT parameter layout it does not take, would.
+ */
+void tsi_emu_set_rsa_fault(int n);
+
+/*
+ * Software reference for the test programs, computed by the same mbedTLS
+ * code the emulator uses. mode is AES_MODE_ECB/CBC/CFB/OFB/CTR or
+ * TSI_EMU_REF_CFB8, the whole message is processed in one call.
+ */
+#define TSI_EMU_REF_CFB8        0x100
+
+int tsi_emu_ref_aes(int mode, int encrypt, const uint8_t *key, int keybits,
+		    const uint8_t iv[16], const uint8_t *in, uint8_t *out,
+		    size_t len);
+
+/*
+ * Make the next n TRNG_Gen_Random commands return stuck output (every
+ * byte the same), biased output (every fourth byte the same) or fail.
+ */
+#define TSI_EMU_TRNG_STUCK      1
+#define TSI_EMU_TRNG_BIASED     2
+#define TSI_EMU_TRNG_ERROR      3
+
+void tsi_emu_set_trng_fault(int fault, int n);
+
+/*
+ * SHA and HMAC references, sel/mode are SHA_MODE_SEL_xxx/SHA_MODE_xxx as
+ * in the TSI commands. out receives the full digest.
+ */
+int tsi_emu_ref_sha(int sel, int mode, const uint8_t *in, size_t len,
+		    uint8_t *out);
+int tsi_emu_ref_hmac(int sel, int mode, const uint8_t *key, size_t keylen,
+		     const uint8_t *in, size_t len, uint8_t *out);
+
+/*
+ * GCM and CCM (CCM* for tag_len 0) references. For decryption tag is the
+ * expected tag and a mismatch returns the mbedTLS AUTH_FAILED error.
+ */
+int tsi_emu_ref_gcm(int encrypt, const uint8_t *key, int keybits,
+		    const uint8_t *iv, size_t iv_len, const uint8_t *add,
+		    size_t add_len, const uint8_t *in, uint8_t *out, size_t len,
+		    uint8_t *tag, size_t tag_len);
+int tsi_emu_ref_ccm(int encrypt, const uint8_t *key, int keybits,
+		    const uint8_t *iv, size_t iv_len, const uint8_t *add,
+		    size_t add_len, const uint8_t *in, uint8_t *out, size_t len,
+		    uint8_t *tag, size_t tag_len);
+
+/*
+ * ECC references on mbedtls_ecp_group_id gid. Scalars, r and s are
+ * big-endian byte strings (r and s nlen bytes each), points uncompressed
+ * 04 || X || Y. tsi_emu_ref_ecp_mul() multiplies the generator when P is
+ * NULL. Deterministic ECDSA follows RFC 6979 with hash md_alg.
+ */
+int tsi_emu_ref_ecp_mul(int gid, const uint8_t *k, size_t klen,
+			const uint8_t *P, size_t plen, uint8_t *R, size_t rsize,
+			size_t *rlen);
+int tsi_emu_ref_ecdsa_sign_det(int gid, int md_alg, const uint8_t *d,
+			       size_t dlen, const uint8_t *hash, size_t hlen,
+			       uint8_t *r, uint8_t *s, size_t nlen);
+int tsi_emu_ref_ecdsa_verify(int gid, const uint8_t *Q, size_t qlen,
+			     const uint8_t *hash, size_t hlen, const uint8_t *r,
+			     const uint8_t *s, size_t nlen);
+
+/*
+ * RSA references for a len-byte modulus, all numbers big-endian. The
+ * public operation takes N, the private one builds the key from P and Q
+ * (plen bytes each) and E.
+ */
+int tsi_emu_ref_rsa_public(const uint8_t *N, const uint8_t *E, size_t elen,
+			   const uint8_t *in, uint8_t *out, size_t len);
+int tsi_emu_ref_rsa_private(const uint8_t *P, const uint8_t *Q, size_t plen,
+			    const uint8_t *E, size_t elen, const uint8_t *in,
+			    uint8_t *out, size_t len);
+
+#endif /* __TSI_EMU_H__ */
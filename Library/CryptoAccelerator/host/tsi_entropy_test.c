@@ -0,0 +1,430 @@
+/**************************************************************************//**
+ * @file     tsi_entropy_test.c
+ *
+ * @brief    Host test and benchmark of the TRNG entropy source
+ *           (entropy_alt.c) on the TSI emulator.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "entropy_poll.h"
+
+#include "NuMicro.h"
+#include "tsi_emu.h"
+#include "entropy_alt.h"
+
+/*
+ * The pool is filled by the first poll and refilled in the background: a
+ * long run of polls must not wait, and with a slow pipelined TSI a burst
+ * the size of the pool is served without a mailbox round trip while the
+ * next poll waits for the refill. Stuck, biased and failing TRNG output is
+ * dropped by the health tests and counted, and a TRNG that keeps failing
+ * fails the poll. CTR-DRBG seeds and reseeds from the pool, and the
+ * mbedTLS entropy and CTR-DRBG self tests run on it. Polls of several
+ * threads go through the pool lock, which is balanced and never nested.
+ * Ends with polls/s from the pool and from one TRNG command per poll.
+ */
+
+static int s_fail;
+
+/* The pool lock of entropy_alt.c, with the depth counted inside it */
+static pthread_mutex_t s_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int s_lock_depth;
+static int s_lock_nested;
+static unsigned long s_locks;
+
+void nu_entropy_lock(void)
+{
+	pthread_mutex_lock(&s_pool_mutex);
+	if (s_lock_depth++)
+		s_lock_nested++;
+	s_locks++;
+}
+
+void nu_entropy_unlock(void)
+{
+	s_lock_depth--;
+	pthread_mutex_unlock(&s_pool_mutex);
+}
+
+#define POLL_LEN    MBEDTLS_ENTROPY_MAX_GATHER
+#define POOL_BYTES  (NU_ENTROPY_BANKS * NU_ENTROPY_BANK_WORDS * 4)
+
+static void check(int ok, const char *what, int ret)
+{
+	if (ok)
+		return;
+	printf("  FAIL: %s (ret -0x%04x)\n", what, (unsigned)-ret);
+	s_fail++;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* CPU busy elsewhere; the emulated mailbox is serviced on timer reads */
+static void idle_ms(int ms)
+{
+	struct timespec ts = { 0, 100000L };
+	double t0 = now();
+
+	while (now() - t0 < ms * 1e-3) {
+		nanosleep(&ts, NULL);
+		EL0_GetCurrentPhysicalValue();
+	}
+}
+
+static uint64_t trng_cmds(void)
+{
+	struct tsi_emu_stats es;
+
+	tsi_emu_get_stats(&es);
+	return es.cmds_class[C_CODE_TRNG];
+}
+
+static int poll(uint8_t *out, size_t len)
+{
+	size_t olen = 0;
+	int ret;
+
+	ret = mbedtls_hardware_poll(NULL, out, len, &olen);
+	if ((ret == 0) && (olen != len))
+		ret = -1;
+	return ret;
+}
+
+/* Longest run of one byte value */
+static size_t max_run(const uint8_t *p, size_t len)
+{
+	size_t i, run = 1, best = len ? 1 : 0;
+
+	for (i = 1; i < len; i++) {
+		run = (p[i] == p[i - 1]) ? run + 1 : 1;
+		if (run > best)
+			best = run;
+	}
+	return best;
+}
+
+/*---------------------------------------------------------------------------
+ *  Pool
+ *---------------------------------------------------------------------------*/
+
+static void test_pool(void)
+{
+	static uint8_t out[64 * 1024];
+	nu_entropy_stats st;
+	size_t i;
+	int ret = 0;
+
+	printf("Pool ...\n");
+	ret = poll(out, POLL_LEN);
+	check(ret == 0, "first poll", ret);
+	nu_entropy_get_stats(&st);
+	check((st.level == POOL_BYTES - POLL_LEN) && (st.refills == 0) && (st.waits == 0),
+	      "pool filled by the first poll", (int)st.level);
+
+	/* 64 KB in gathers: every one served from the pool */
+	for (i = 0; i < sizeof(out); i += POLL_LEN)
+		ret |= poll(out + i, POLL_LEN);
+	check(ret == 0, "polls", ret);
+	nu_entropy_get_stats(&st);
+	check(st.waits == 0, "polls waited for the TRNG", (int)st.waits);
+	check(st.refills >= sizeof(out) / (NU_ENTROPY_BANK_WORDS * 4) - 1, "refills", (int)st.refills);
+	check(max_run(out, sizeof(out)) < NU_ENTROPY_RCT_CUTOFF, "output run", 0);
+	for (i = POLL_LEN; i < sizeof(out); i += POLL_LEN)
+		if (!memcmp(out, out + i, POLL_LEN))
+			break;
+	check(i >= sizeof(out), "repeated output", 0);
+
+	/* Odd sizes across banks */
+	for (i = 1; i < 3000; i += 397)
+		ret |= poll(out, i);
+	check(ret == 0, "odd sizes", ret);
+}
+
+/* A slow TSI behind: a burst the size of the pool needs no round trip */
+static void test_async(void)
+{
+	uint8_t out[POLL_LEN];
+	nu_entropy_stats s0, s1;
+	uint64_t c0;
+	double t0, tmax = 0, t;
+	int i, n, ret = 0;
+
+	printf("Asynchronous refill, 2 ms TSI latency ...\n");
+	tsi_emu_set_pipelined(1);
+	tsi_emu_set_latency(2000);
+
+	/* Let the pool fill up; a poll takes in the completed refills */
+	idle_ms(20);
+	ret |= poll(out, 1);
+	idle_ms(20);
+	ret |= poll(out, 1);
+
+	nu_entropy_get_stats(&s0);
+	check(s0.level > POOL_BYTES - NU_ENTROPY_BANK_WORDS * 4, "pool refilled", (int)s0.level);
+	n = s0.level / POLL_LEN;
+	c0 = trng_cmds();
+	for (i = 0; i < n; i++) {
+		t0 = now();
+		ret |= poll(out, POLL_LEN);
+		t = now() - t0;
+		if (t > tmax)
+			tmax = t;
+	}
+	nu_entropy_get_stats(&s1);
+	check(ret == 0, "burst", ret);
+	check(s1.waits == s0.waits, "burst waited for the TRNG", (int)(s1.waits - s0.waits));
+	check(tmax < 1e-3, "burst poll took a TSI round trip", (int)(tmax * 1e6));
+	check(trng_cmds() - c0 <= NU_ENTROPY_BANKS, "burst TRNG commands", (int)(trng_cmds() - c0));
+
+	/* Pool used up with the refills in flight: this one waits */
+	ret |= poll(out, POLL_LEN);
+	ret |= poll(out, POLL_LEN);
+	nu_entropy_get_stats(&s1);
+	check(ret == 0, "poll past the pool", ret);
+	check(s1.waits > s0.waits, "poll past the pool did not wait", 0);
+
+	tsi_emu_set_latency(0);
+	tsi_emu_set_pipelined(0);
+	TSI_Poll();
+}
+
+/*---------------------------------------------------------------------------
+ *  Health tests
+ *---------------------------------------------------------------------------*/
+
+static void test_health(void)
+{
+	static uint8_t out[8 * 1024];
+	nu_entropy_stats s0, s1;
+	size_t i;
+	int ret = 0;
+
+	printf("Health tests ...\n");
+
+	nu_entropy_get_stats(&s0);
+	tsi_emu_set_trng_fault(TSI_EMU_TRNG_STUCK, 1);
+	for (i = 0; i < sizeof(out); i += POLL_LEN)
+		ret |= poll(out + i, POLL_LEN);
+	nu_entropy_get_stats(&s1);
+	check(ret == 0, "polls around a stuck bank", ret);
+	check(s1.rctFail == s0.rctFail + 1, "stuck bank not dropped", (int)(s1.rctFail - s0.rctFail));
+	check(max_run(out, sizeof(out)) < NU_ENTROPY_RCT_CUTOFF, "stuck output served", 0);
+
+	tsi_emu_set_trng_fault(TSI_EMU_TRNG_BIASED, 1);
+	for (i = 0; i < sizeof(out); i += POLL_LEN)
+		ret |= poll(out + i, POLL_LEN);
+	nu_entropy_get_stats(&s0);
+	check(ret == 0, "polls around a biased bank", ret);
+	check(s0.aptFail == s1.aptFail + 1, "biased bank not dropped", (int)(s0.aptFail - s1.aptFail));
+
+	tsi_emu_set_trng_fault(TSI_EMU_TRNG_ERROR, 1);
+	for (i = 0; i < sizeof(out); i += POLL_LEN)
+		ret |= poll(out + i, POLL_LEN);
+	nu_entropy_get_stats(&s1);
+	check(ret == 0, "polls around a TRNG error", ret);
+	check(s1.trngErr == s0.trngErr + 1, "TRNG error not counted", (int)(s1.trngErr - s0.trngErr));
+
+	/* A TRNG that stays stuck fails the poll once the pool is used up */
+	tsi_emu_set_trng_fault(TSI_EMU_TRNG_STUCK, 1000);
+	for (i = 0, ret = 0; (ret == 0) && (i < 2 * POOL_BYTES); i += POLL_LEN)
+		ret = poll(out, POLL_LEN);
+	check(ret == MBEDTLS_ERR_ENTROPY_SOURCE_FAILED, "stuck TRNG", ret);
+	tsi_emu_set_trng_fault(0, 0);
+	ret = poll(out, POLL_LEN);
+	check(ret == 0, "recovery", ret);
+}
+
+/*---------------------------------------------------------------------------
+ *  CTR-DRBG
+ *---------------------------------------------------------------------------*/
+
+static void test_drbg(void)
+{
+	mbedtls_entropy_context ent;
+	mbedtls_ctr_drbg_context drbg;
+	uint8_t out[64];
+	uint64_t c0;
+	int i, n = 400, ret;
+
+	printf("CTR-DRBG ...\n");
+	mbedtls_entropy_init(&ent);
+	mbedtls_ctr_drbg_init(&drbg);
+	ret = mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &ent,
+				    (const uint8_t *)"tsi_entropy_test", 16);
+	check(ret == 0, "seed", ret);
+
+	/* Prediction resistance: a reseed per call, served by the pool */
+	mbedtls_ctr_drbg_set_prediction_resistance(&drbg, MBEDTLS_CTR_DRBG_PR_ON);
+	c0 = trng_cmds();
+	for (i = 0; (ret == 0) && (i < n); i++)
+		ret = mbedtls_ctr_drbg_random(&drbg, out, sizeof(out));
+	check(ret == 0, "random with reseeds", ret);
+	printf("  %d reseeds, %.2f TRNG commands per reseed\n", n,
+	       (double)(trng_cmds() - c0) / n);
+	check((trng_cmds() - c0) * 4 < (uint64_t)n, "TRNG commands per reseed", 0);
+
+	mbedtls_ctr_drbg_free(&drbg);
+	mbedtls_entropy_free(&ent);
+
+	ret = mbedtls_entropy_self_test(0);
+	check(ret == 0, "entropy self test", ret);
+	ret = mbedtls_ctr_drbg_self_test(0);
+	check(ret == 0, "CTR-DRBG self test", ret);
+}
+
+/*---------------------------------------------------------------------------
+ *  Polls/s
+ *---------------------------------------------------------------------------*/
+
+/* One TRNG command per poll, the source this replaces */
+static int sync_poll(uint8_t *out, size_t len)
+{
+	static uint32_t buf[POLL_LEN / 4] __attribute__((aligned(64)));
+	int ret;
+
+	ret = TSI_TRNG_Gen_Random(POLL_LEN / 4, ptr_to_u32(buf));
+	memcpy(out, buf, len);
+	return ret;
+}
+
+static double bench_rate(int (*fn)(uint8_t *, size_t), int *ret)
+{
+	uint8_t out[POLL_LEN];
+	double t0 = now(), t;
+	int n = 0;
+
+	do {
+		*ret |= fn(out, POLL_LEN);
+		n++;
+		t = now() - t0;
+	} while (t < 0.2);
+	return n / t;
+}
+
+static void bench(void)
+{
+	static const uint32_t lat[] = { 0, 50, 200 };
+	nu_entropy_stats s0, s1;
+	double pool, sync;
+	size_t i;
+	int ret = 0;
+
+	printf("\n%d-byte polls/s on this host (emulated TSI, pipelined), from the pool\n", POLL_LEN);
+	printf("and with one TRNG command per poll, and the pool polls that waited\n");
+	printf("%10s %12s %12s %8s\n", "latency", "pool/s", "TRNG/s", "waited");
+
+	tsi_emu_set_pipelined(1);
+	for (i = 0; i < sizeof(lat) / sizeof(lat[0]); i++) {
+		tsi_emu_set_latency(lat[i]);
+		nu_entropy_get_stats(&s0);
+		pool = bench_rate(poll, &ret);
+		nu_entropy_get_stats(&s1);
+		sync = bench_rate(sync_poll, &ret);
+		printf("%8u us %12.0f %12.0f %7.1f%%\n", lat[i], pool, sync,
+		       100.0 * (s1.waits - s0.waits) / (s1.polls - s0.polls));
+	}
+	tsi_emu_set_latency(0);
+	tsi_emu_set_pipelined(0);
+	TSI_Poll();
+	check(ret == 0, "benchmark call", ret);
+}
+
+/*---------------------------------------------------------------------------
+ *  Several threads
+ *---------------------------------------------------------------------------*/
+
+#define THREADS         4
+#define THREAD_POLLS    2000
+#define THREAD_LEN      48
+
+static uint8_t s_thread_out[THREADS][THREAD_POLLS][THREAD_LEN];
+static int s_thread_ret[THREADS];
+
+static void *poll_thread(void *arg)
+{
+	int t = (int)(intptr_t)arg, i;
+
+	for (i = 0; i < THREAD_POLLS && s_thread_ret[t] == 0; i++)
+		s_thread_ret[t] = poll(s_thread_out[t][i], THREAD_LEN);
+	return NULL;
+}
+
+static int cmp_out(const void *a, const void *b)
+{
+	return memcmp(a, b, THREAD_LEN);
+}
+
+/* Every thread gets its own bytes, the counters add up */
+static void test_threads(void)
+{
+	pthread_t th[THREADS];
+	nu_entropy_stats st0, st;
+	uint8_t (*all)[THREAD_LEN] = &s_thread_out[0][0];
+	size_t i, n = THREADS * THREAD_POLLS;
+	int t, dup = 0;
+
+	printf("Threads ...\n");
+	nu_entropy_get_stats(&st0);
+	for (t = 0; t < THREADS; t++)
+		pthread_create(&th[t], NULL, poll_thread, (void *)(intptr_t)t);
+	for (t = 0; t < THREADS; t++) {
+		pthread_join(th[t], NULL);
+		check(s_thread_ret[t] == 0, "poll in a thread", s_thread_ret[t]);
+	}
+	nu_entropy_get_stats(&st);
+	check(st.polls - st0.polls == n, "polls counted", 0);
+	check(st.bytes - st0.bytes == (uint64_t)n * THREAD_LEN, "bytes counted", 0);
+
+	qsort(all, n, THREAD_LEN, cmp_out);
+	for (i = 1; i < n; i++)
+		dup += (memcmp(all[i - 1], all[i], THREAD_LEN) == 0);
+	check(dup == 0, "no bytes served twice", dup);
+
+	check(s_locks > 0 && s_lock_depth == 0 && s_lock_nested == 0,
+	      "nu_entropy_lock() used, balanced, not nested", s_lock_nested);
+}
+
+int main(void)
+{
+	nu_entropy_stats st;
+	int ret;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	ret = TSI_Init();
+	check(ret == 0, "TSI_Init", ret);
+
+	test_pool();
+	test_async();
+	test_health();
+	test_drbg();
+	test_threads();
+
+	bench();
+
+	nu_entropy_get_stats(&st);
+	printf("\n%llu bytes in %u polls, %u refills, %u waits, RCT %u, APT %u, TRNG errors %u\n",
+	       (unsigned long long)st.bytes, st.polls, st.refills, st.waits, st.rctFail,
+	       st.aptFail, st.trngErr);
+
+	printf("\n%s (%d failures)\n", s_fail ? "FAILED" : "PASSED", s_fail);
+	return s_fail ? 1 : 0;
+}
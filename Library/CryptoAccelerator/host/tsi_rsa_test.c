@@ -0,0 +1,463 @@
+/**************************************************************************//**
+ * @file     tsi_rsa_test.c
+ *
+ * @brief    Host test and benchmark of the RSA ALT port (rsa_alt.c) on the
+ *           TSI emulator.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mbedtls/rsa.h"
+#include "mbedtls/md.h"
+
+#include "NuMicro.h"
+#include "tsi_emu.h"
+#include "rsa_alt.h"
+
+/*
+ * For every modulus size the TSI supports: key generation, raw public and
+ * private operations against the software reference, PKCS#1 v1.5 and
+ * PSS signatures, v1.5 and OAEP encryption, a tampered signature and the
+ * number of TSI commands per operation. The private exponent is imported
+ * to Key Store SRAM and bound afresh, a wrong key number must fail the
+ * bind check. A 1536-bit key checks the software fallback, corrupted
+ * results the glitch check, and mbedtls_rsa_self_test() runs on the
+ * port. Ends with private/public ops/s and latencies on the TSI path and
+ * in software. Built as tsi_rsa_test, and with NU_RSA_USE_CRT as
+ * tsi_rsa_crt_test, where a wrong CRT result is computed again without
+ * CRT.
+ */
+
+static int s_fail;
+
+static const struct {
+	unsigned int bits;
+	const char *name;
+} s_sizes[] = {
+	{ 1024, "RSA-1024" },
+	{ 2048, "RSA-2048" },
+	{ 3072, "RSA-3072" },
+	{ 4096, "RSA-4096" },
+};
+
+#define SIZE_NUM    (int)(sizeof(s_sizes) / sizeof(s_sizes[0]))
+#define RSA_MAX     512
+#define RSA_E       65537
+
+static uint32_t rnd(void)
+{
+	static uint32_t x = 0x2545F491;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static void rnd_fill(uint8_t *p, size_t len)
+{
+	while (len--)
+		*p++ = (uint8_t)rnd();
+}
+
+static int test_rng(void *p, unsigned char *out, size_t len)
+{
+	(void)p;
+	rnd_fill(out, len);
+	return 0;
+}
+
+static void check(int ok, const char *what, const char *name, int ret)
+{
+	if (ok)
+		return;
+	printf("  FAIL: %s %s (ret -0x%04x)\n", name, what, (unsigned)-ret);
+	s_fail++;
+}
+
+static uint64_t rsa_cmds(void)
+{
+	struct tsi_emu_stats es;
+
+	tsi_emu_get_stats(&es);
+	return es.cmds_class[C_CODE_RSA];
+}
+
+/* Random input below N: the top byte is cleared */
+static void rnd_input(const mbedtls_rsa_context *rsa, uint8_t *in)
+{
+	rnd_fill(in, rsa->len);
+	in[0] = 0;
+}
+
+/* Big-endian N, P, Q and E of a key for the software reference */
+struct key_bin {
+	uint8_t n[RSA_MAX], p[RSA_MAX / 2], q[RSA_MAX / 2], e[4];
+	size_t len, plen;
+};
+
+static int key_bin(const mbedtls_rsa_context *rsa, struct key_bin *k)
+{
+	k->len = rsa->len;
+	k->plen = rsa->len / 2;
+	return mbedtls_rsa_export_raw(rsa, k->n, k->len, k->p, k->plen, k->q, k->plen,
+				      NULL, 0, k->e, sizeof(k->e));
+}
+
+/*---------------------------------------------------------------------------
+ *  Per key size
+ *---------------------------------------------------------------------------*/
+
+static void test_raw(const char *name, mbedtls_rsa_context *rsa, const struct key_bin *k)
+{
+	uint8_t in[RSA_MAX], out[RSA_MAX], ref[RSA_MAX];
+	uint64_t c0;
+	int i, ret;
+
+	for (i = 0; i < 4; i++) {
+		rnd_input(rsa, in);
+		c0 = rsa_cmds();
+		ret = mbedtls_rsa_public(rsa, in, out);
+		check(ret == 0 && rsa_cmds() - c0 == 1, "public operation on the TSI", name, ret);
+		ret |= tsi_emu_ref_rsa_public(k->n, k->e, sizeof(k->e), in, ref, k->len);
+		check(ret == 0 && !memcmp(out, ref, k->len), "public operation", name, ret);
+
+		/* Exponentiation, CRT with NU_RSA_USE_CRT, plus the glitch check */
+		c0 = rsa_cmds();
+		ret = mbedtls_rsa_private(rsa, test_rng, NULL, in, out);
+		check(ret == 0 && rsa_cmds() - c0 == 2, "private operation on the TSI", name, ret);
+		ret |= tsi_emu_ref_rsa_private(k->p, k->q, k->plen, k->e, sizeof(k->e), in,
+					       ref, k->len);
+		check(ret == 0 && !memcmp(out, ref, k->len), "private operation", name, ret);
+	}
+
+	/* Input not below N */
+	memcpy(in, k->n, k->len);
+	ret = mbedtls_rsa_private(rsa, test_rng, NULL, in, out);
+	check(ret != 0, "private operation on N", name, ret);
+	ret = mbedtls_rsa_private(rsa, NULL, NULL, in, out);
+	check(ret == MBEDTLS_ERR_RSA_BAD_INPUT_DATA, "private operation without RNG", name, ret);
+}
+
+static void test_pkcs1(const char *name, mbedtls_rsa_context *rsa)
+{
+	uint8_t hash[32], sig[RSA_MAX], msg[32], ct[RSA_MAX], pt[RSA_MAX];
+	size_t olen;
+	int pad, ret;
+
+	rnd_fill(hash, sizeof(hash));
+	rnd_fill(msg, sizeof(msg));
+
+	for (pad = 0; pad < 2; pad++) {
+		const char *pn = pad ? "PSS/OAEP" : "PKCS#1 v1.5";
+		char what[64];
+
+		ret = mbedtls_rsa_set_padding(rsa, pad ? MBEDTLS_RSA_PKCS_V21 : MBEDTLS_RSA_PKCS_V15,
+					      MBEDTLS_MD_SHA256);
+		ret |= mbedtls_rsa_pkcs1_sign(rsa, test_rng, NULL, MBEDTLS_MD_SHA256,
+					      sizeof(hash), hash, sig);
+		ret |= mbedtls_rsa_pkcs1_verify(rsa, MBEDTLS_MD_SHA256, sizeof(hash), hash, sig);
+		snprintf(what, sizeof(what), "%s signature", pn);
+		check(ret == 0, what, name, ret);
+
+		sig[rsa->len / 2] ^= 0x10;
+		ret = mbedtls_rsa_pkcs1_verify(rsa, MBEDTLS_MD_SHA256, sizeof(hash), hash, sig);
+		snprintf(what, sizeof(what), "%s tampered signature", pn);
+		check(ret != 0, what, name, ret);
+
+		ret = mbedtls_rsa_pkcs1_encrypt(rsa, test_rng, NULL, sizeof(msg), msg, ct);
+		ret |= mbedtls_rsa_pkcs1_decrypt(rsa, test_rng, NULL, &olen, ct, pt, sizeof(pt));
+		snprintf(what, sizeof(what), "%s encryption", pn);
+		check(ret == 0 && olen == sizeof(msg) && !memcmp(pt, msg, olen), what, name, ret);
+
+		ct[rsa->len - 1] ^= 0x01;
+		ret = mbedtls_rsa_pkcs1_decrypt(rsa, test_rng, NULL, &olen, ct, pt, sizeof(pt));
+		snprintf(what, sizeof(what), "%s tampered ciphertext", pn);
+		check(ret != 0, what, name, ret);
+	}
+	mbedtls_rsa_set_padding(rsa, MBEDTLS_RSA_PKCS_V15, MBEDTLS_MD_NONE);
+}
+
+static void test_ks(const char *name, mbedtls_rsa_context *rsa, const struct key_bin *k)
+{
+	__attribute__((aligned(64))) static uint32_t kbuf[RSA_MAX / 4];
+	mbedtls_rsa_context ks, kb, other;
+	uint8_t in[RSA_MAX], out[RSA_MAX], ref[RSA_MAX], hash[32], sig[RSA_MAX];
+	int ret, knum = -1, knum2 = -1;
+
+	mbedtls_rsa_init(&ks);
+	mbedtls_rsa_init(&kb);
+	mbedtls_rsa_init(&other);
+
+	/* Move the private exponent of a copy to Key Store SRAM */
+	ret = mbedtls_rsa_copy(&ks, rsa);
+	if (ret == 0)
+		ret = nu_rsa_ks_import(&ks, 0, &knum);
+	check(ret == 0 && knum >= 0 && ks.ksSel == RSA_KEY_SEL_KS_SRAM &&
+	      mbedtls_mpi_cmp_int(&ks.D, 0) == 0 && mbedtls_mpi_cmp_int(&ks.P, 0) == 0,
+	      "Key Store import", name, ret);
+	check(mbedtls_rsa_check_privkey(&ks) != 0, "private key check of a Key Store key",
+	      name, 0);
+	ret = TSI_KS_Read(KS_SRAM, knum, kbuf, k->len / 4);
+	check(ret == ST_KS_READ_PROTECT, "Key Store key readable", name, ret);
+
+	/* Non-CRT exponentiation with the Key Store exponent */
+	rnd_input(rsa, in);
+	ret = mbedtls_rsa_private(&ks, test_rng, NULL, in, out);
+	ret |= tsi_emu_ref_rsa_private(k->p, k->q, k->plen, k->e, sizeof(k->e), in, ref, k->len);
+	check(ret == 0 && !memcmp(out, ref, k->len), "Key Store private operation", name, ret);
+
+	rnd_fill(hash, sizeof(hash));
+	ret = mbedtls_rsa_pkcs1_sign(&ks, test_rng, NULL, MBEDTLS_MD_SHA256, sizeof(hash),
+				     hash, sig);
+	ret |= mbedtls_rsa_pkcs1_verify(rsa, MBEDTLS_MD_SHA256, sizeof(hash), hash, sig);
+	check(ret == 0, "Key Store signature", name, ret);
+
+	/* Bind the SRAM key to a public-only context */
+	ret = mbedtls_rsa_import(&kb, &rsa->N, NULL, NULL, NULL, &rsa->E);
+	ret |= mbedtls_rsa_complete(&kb);
+	if (ret == 0)
+		ret = nu_rsa_ks_bind(&kb, KS_SRAM, knum);
+	if (ret == 0)
+		ret = mbedtls_rsa_private(&kb, test_rng, NULL, in, out);
+	check(ret == 0 && !memcmp(out, ref, k->len), "Key Store bind", name, ret);
+
+	/* The exponent of another key of the same size does not match N and E */
+	ret = mbedtls_rsa_gen_key(&other, test_rng, NULL, k->len * 8, RSA_E);
+	if (ret == 0)
+		ret = nu_rsa_ks_import(&other, 0, &knum2);
+	mbedtls_rsa_free(&kb);
+	mbedtls_rsa_init(&kb);
+	ret |= mbedtls_rsa_import(&kb, &rsa->N, NULL, NULL, NULL, &rsa->E);
+	ret |= mbedtls_rsa_complete(&kb);
+	if (ret == 0)
+		ret = nu_rsa_ks_bind(&kb, KS_SRAM, knum2);
+	check(ret == MBEDTLS_ERR_RSA_KEY_CHECK_FAILED && kb.ksSel == 0,
+	      "bind of a foreign exponent", name, ret);
+
+	TSI_KS_EraseAll();
+	ret = mbedtls_rsa_private(&ks, test_rng, NULL, in, out);
+	check(ret == MBEDTLS_ERR_RSA_BAD_INPUT_DATA, "private operation with an erased key",
+	      name, ret);
+
+	mbedtls_rsa_free(&ks);
+	mbedtls_rsa_free(&kb);
+	mbedtls_rsa_free(&other);
+}
+
+static void test_size(int si)
+{
+	const char *name = s_sizes[si].name;
+	mbedtls_rsa_context rsa;
+	static struct key_bin k;
+	int ret;
+
+	mbedtls_rsa_init(&rsa);
+
+	ret = mbedtls_rsa_gen_key(&rsa, test_rng, NULL, s_sizes[si].bits, RSA_E);
+	if (ret == 0)
+		ret = key_bin(&rsa, &k);
+	check(ret == 0 && mbedtls_rsa_check_privkey(&rsa) == 0, "key generation", name, ret);
+	if (ret == 0) {
+		test_raw(name, &rsa, &k);
+		test_pkcs1(name, &rsa);
+		test_ks(name, &rsa, &k);
+	}
+
+	mbedtls_rsa_free(&rsa);
+}
+
+/*---------------------------------------------------------------------------
+ *  Software fallback, glitch check, self test
+ *---------------------------------------------------------------------------*/
+
+static void test_fallback(void)
+{
+	const char *name = "RSA-1536";
+	mbedtls_rsa_context rsa;
+	uint64_t c0;
+	int ret;
+
+	printf("%s (no TSI size) ...\n", name);
+	mbedtls_rsa_init(&rsa);
+
+	c0 = rsa_cmds();
+	ret = mbedtls_rsa_gen_key(&rsa, test_rng, NULL, 1536, RSA_E);
+	check(ret == 0, "key generation", name, ret);
+	if (ret == 0) {
+		test_pkcs1(name, &rsa);
+		check(rsa_cmds() == c0, "TSI used for an unsupported size", name, 0);
+		ret = nu_rsa_ks_import(&rsa, 0, NULL);
+		check(ret == MBEDTLS_ERR_RSA_BAD_INPUT_DATA, "Key Store import", name, ret);
+	}
+
+	mbedtls_rsa_free(&rsa);
+}
+
+static void test_glitch(void)
+{
+	const char *name = "RSA-2048";
+	mbedtls_rsa_context rsa;
+	uint8_t in[RSA_MAX], out[RSA_MAX];
+#if NU_RSA_USE_CRT
+	uint64_t c0;
+#endif
+	int ret;
+
+	printf("Glitch check ...\n");
+	mbedtls_rsa_init(&rsa);
+
+	ret = mbedtls_rsa_gen_key(&rsa, test_rng, NULL, 2048, RSA_E);
+	check(ret == 0, "key generation", name, ret);
+	if (ret != 0) {
+		mbedtls_rsa_free(&rsa);
+		return;
+	}
+	rnd_input(&rsa, in);
+
+	/* One wrong private result */
+	tsi_emu_set_rsa_fault(1);
+#if NU_RSA_USE_CRT
+	c0 = rsa_cmds();
+#endif
+	ret = mbedtls_rsa_private(&rsa, test_rng, NULL, in, out);
+#if NU_RSA_USE_CRT
+	check(ret == 0 && rsa_cmds() - c0 == 4, "corrupted CRT result computed again without CRT", name, ret);
+#else
+	check(ret == MBEDTLS_ERR_RSA_VERIFY_FAILED, "corrupted result", name, ret);
+#endif
+
+	/* Every result wrong */
+	tsi_emu_set_rsa_fault(4);
+	ret = mbedtls_rsa_private(&rsa, test_rng, NULL, in, out);
+	check(ret == MBEDTLS_ERR_RSA_VERIFY_FAILED, "corrupted results", name, ret);
+	tsi_emu_set_rsa_fault(0);
+
+	ret = mbedtls_rsa_private(&rsa, test_rng, NULL, in, out);
+	check(ret == 0, "private operation after the fault", name, ret);
+
+	mbedtls_rsa_free(&rsa);
+}
+
+/*---------------------------------------------------------------------------
+ *  Ops/s and latency
+ *---------------------------------------------------------------------------*/
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct lat {
+	double total, max;
+	int n;
+};
+
+static void lat_add(struct lat *l, double t0)
+{
+	double t = now() - t0;
+
+	l->total += t;
+	if (t > l->max)
+		l->max = t;
+	l->n++;
+}
+
+static void lat_print(const char *name, const char *op, const struct lat *tsi,
+		      const struct lat *sw, double rt)
+{
+	printf("%-10s %-8s %10.1f %10.1f %9.3f %9.3f %9.3f %9.3f %5.1f\n", name, op,
+	       tsi->n / tsi->total, sw->n / sw->total, 1e3 * tsi->total / tsi->n,
+	       1e3 * tsi->max, 1e3 * sw->total / sw->n, 1e3 * sw->max, rt);
+}
+
+static void bench(void)
+{
+	struct lat tp, sp, tq, sq;
+	mbedtls_rsa_context rsa;
+	static struct key_bin k;
+	uint8_t in[RSA_MAX], out[RSA_MAX];
+	uint64_t c0, c1;
+	double t0;
+	int si, i, n, ret = 0;
+
+	printf("\nRSA ops/s on this host (emulated TSI), mean and max latency in ms, and TSI\n");
+	printf("round trips per private operation (exponentiation + glitch check)\n");
+	printf("%-10s %-8s %10s %10s %9s %9s %9s %9s %5s\n", "key", "op", "TSI/s", "sw/s",
+	       "TSI avg", "TSI max", "sw avg", "sw max", "rt");
+
+	for (si = 1; si < SIZE_NUM; si++) {
+		memset(&tp, 0, sizeof(tp));
+		memset(&sp, 0, sizeof(sp));
+		memset(&tq, 0, sizeof(tq));
+		memset(&sq, 0, sizeof(sq));
+
+		mbedtls_rsa_init(&rsa);
+		ret |= mbedtls_rsa_gen_key(&rsa, test_rng, NULL, s_sizes[si].bits, RSA_E);
+		ret |= key_bin(&rsa, &k);
+		n = (si == 3) ? 10 : 30;
+		rnd_input(&rsa, in);
+
+		c0 = rsa_cmds();
+		for (i = 0; i < n; i++) {
+			t0 = now();
+			ret |= mbedtls_rsa_private(&rsa, test_rng, NULL, in, out);
+			lat_add(&tp, t0);
+		}
+		c1 = rsa_cmds();
+		for (i = 0; i < n; i++) {
+			t0 = now();
+			ret |= tsi_emu_ref_rsa_private(k.p, k.q, k.plen, k.e, sizeof(k.e), in,
+						       out, k.len);
+			lat_add(&sp, t0);
+		}
+		for (i = 0; i < 10 * n; i++) {
+			t0 = now();
+			ret |= mbedtls_rsa_public(&rsa, in, out);
+			lat_add(&tq, t0);
+		}
+		for (i = 0; i < 10 * n; i++) {
+			t0 = now();
+			ret |= tsi_emu_ref_rsa_public(k.n, k.e, sizeof(k.e), in, out, k.len);
+			lat_add(&sq, t0);
+		}
+
+		lat_print(s_sizes[si].name, "private", &tp, &sp, (double)(c1 - c0) / n);
+		lat_print(s_sizes[si].name, "public", &tq, &sq, 1.0);
+		mbedtls_rsa_free(&rsa);
+	}
+	check(ret == 0, "benchmark call", "", ret);
+}
+
+int main(void)
+{
+	int si, ret;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	for (si = 0; si < SIZE_NUM; si++) {
+		printf("%s ...\n", s_sizes[si].name);
+		test_size(si);
+	}
+	test_fallback();
+	test_glitch();
+
+	printf("mbedtls_rsa_self_test ...\n");
+	ret = mbedtls_rsa_self_test(0);
+	check(ret == 0, "self test", "RSA", ret);
+
+	bench();
+
+	printf("\n%s (%d failures)\n", s_fail ? "FAILED" : "PASSED", s_fail);
+	return s_fail ? 1 : 0;
+}
@@ -0,0 +1,517 @@
+/**************************************************************************//**
+ * @file     tsi_sha_test.c
+ *
+ * @brief    Host test and benchmark of the SHA/HMAC port (sha_alt.c,
+ *           sha256_alt.c, sha512_alt.c) on the TSI emulator.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#define MBEDTLS_ALLOW_PRIVATE_ACCESS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mbedtls/sha256.h"
+#include "mbedtls/sha512.h"
+#include "mbedtls/error.h"
+
+#include "NuMicro.h"
+#include "tsi_emu.h"
+#include "sha_alt.h"
+
+/*
+ * For every digest: the "abc" known answer, then random messages fed in
+ * random pieces from a buffer in the program image (TSI reachable, sent in
+ * place), at odd offsets (staged) and from the heap (unreachable, staged),
+ * checked against the software reference. Large word aligned spans must go
+ * to the TSI in NU_SHA_RUN_SIZE runs rather than staging buffer loads.
+ * HMAC with short, block sized and long keys and with a Key Store key, the
+ * mbedTLS SHA-256/SHA-512 API with its self tests, clone, a TSI out of
+ * sessions and the sessions left open. Ends with MB/s per message size
+ * against software and the TSI round trips per MB.
+ */
+
+static int s_fail;
+
+static const struct {
+	const char *name;
+	int sel, mode;
+	const char *abc;
+} s_algs[NU_SHA_ALG_NUM] = {
+	[NU_SHA_1]    = { "SHA-1",    SHA_MODE_SEL_SHA1, SHA_MODE_SHA1,
+			  "a9993e364706816aba3e25717850c26c9cd0d89d" },
+	[NU_SHA_224]  = { "SHA-224",  SHA_MODE_SEL_SHA2, SHA_MODE_SHA224,
+			  "23097d223405d8228642a477bda255b32aadbce4bda0b3f7e36c9da7" },
+	[NU_SHA_256]  = { "SHA-256",  SHA_MODE_SEL_SHA2, SHA_MODE_SHA256,
+			  "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+	[NU_SHA_384]  = { "SHA-384",  SHA_MODE_SEL_SHA2, SHA_MODE_SHA384,
+			  "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded1631a8b605a43ff5bed"
+			  "8086072ba1e7cc2358baeca134c825a7" },
+	[NU_SHA_512]  = { "SHA-512",  SHA_MODE_SEL_SHA2, SHA_MODE_SHA512,
+			  "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+			  "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f" },
+	[NU_SHA3_224] = { "SHA3-224", SHA_MODE_SEL_SHA3, SHA_MODE_SHA224,
+			  "e642824c3f8cf24ad09234ee7d3c766fc9a3a5168d0c94ad73b46fdf" },
+	[NU_SHA3_256] = { "SHA3-256", SHA_MODE_SEL_SHA3, SHA_MODE_SHA256,
+			  "3a985da74fe225b2045c172d6bd390bd855f086e3e9d525b46bfe24511431532" },
+	[NU_SHA3_384] = { "SHA3-384", SHA_MODE_SEL_SHA3, SHA_MODE_SHA384,
+			  "ec01498288516fc926459f58e2c6ad8df9b473cb0fc08c2596da7cf0e49be4b2"
+			  "98d88cea927ac7f539f1edf228376d25" },
+	[NU_SHA3_512] = { "SHA3-512", SHA_MODE_SEL_SHA3, SHA_MODE_SHA512,
+			  "b751850b1a57168a5693cd924b6b096e08f621827444f70d884f5d0240d2712e"
+			  "10e116e9192af3c91a7ec57647e3934057340b4cf408d5a56592f8274eec53f0" },
+};
+
+#define MSG_MAX         (1024 * 1024 + 64)
+#define BENCH_MAX       (32 * 1024 * 1024)
+
+/* Static, so the emulated TSI reaches them */
+static uint8_t s_msg[MSG_MAX] __attribute__((aligned(64)));
+static uint8_t s_big[BENCH_MAX] __attribute__((aligned(64)));
+
+static uint32_t rnd(void)
+{
+	static uint32_t x = 0x2545F491;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static void rnd_fill(uint8_t *p, size_t len)
+{
+	while (len--)
+		*p++ = (uint8_t)rnd();
+}
+
+static void check(int ok, const char *what, const char *name, int ret)
+{
+	if (ok)
+		return;
+	printf("  FAIL: %s %s (ret -0x%04x)\n", name, what, (unsigned)-ret);
+	s_fail++;
+}
+
+static void hex_bin(const char *hex, uint8_t *out)
+{
+	unsigned int v;
+
+	for (; hex[0] && hex[1]; hex += 2) {
+		sscanf(hex, "%2x", &v);
+		*out++ = (uint8_t)v;
+	}
+}
+
+static uint64_t sha_cmds(void)
+{
+	struct tsi_emu_stats es;
+
+	tsi_emu_get_stats(&es);
+	return es.cmds;
+}
+
+/* Digest of p in random pieces, some larger than the staging buffer */
+static int sha_pieces(nu_sha_context *ctx, const uint8_t *p, size_t len, uint8_t *out)
+{
+	size_t n;
+	int ret = 0;
+
+	while ((ret == 0) && (len > 0)) {
+		switch (rnd() % 4) {
+		case 0:  n = rnd() % 8; break;
+		case 1:  n = rnd() % 300; break;
+		case 2:  n = rnd() % 5000; break;
+		default: n = rnd() % 70000; break;
+		}
+		if (n > len)
+			n = len;
+		ret = nu_sha_update(ctx, p, n);
+		p += n;
+		len -= n;
+	}
+	return ret ? ret : nu_sha_finish(ctx, out);
+}
+
+/*---------------------------------------------------------------------------
+ *  Digests
+ *---------------------------------------------------------------------------*/
+
+static void test_digest(int alg)
+{
+	const char *name = s_algs[alg].name;
+	nu_sha_context ctx;
+	uint8_t out[NU_SHA_MAX_DIGEST], ref[NU_SHA_MAX_DIGEST], *heap;
+	size_t dlen = nu_sha_size(alg), blk, len, off;
+	uint64_t c0;
+	int i, ret;
+
+	hex_bin(s_algs[alg].abc, ref);
+	ret = nu_sha(alg, (const uint8_t *)"abc", 3, out);
+	check((ret == 0) && !memcmp(out, ref, dlen), "\"abc\"", name, ret);
+
+	heap = malloc(MSG_MAX);
+	nu_sha_init(&ctx);
+	for (i = 0; i < 12; i++) {
+		len = (i < 4) ? (size_t)i * 37 : rnd() % 200000;
+		off = (i & 1) ? rnd() % 4 : 0;
+		rnd_fill(s_msg + off, len);
+		memcpy(heap + off, s_msg + off, len);
+		tsi_emu_ref_sha(s_algs[alg].sel, s_algs[alg].mode, s_msg + off, len, ref);
+
+		ret = nu_sha_starts(&ctx, alg);
+		if (ret == 0)
+			ret = sha_pieces(&ctx, s_msg + off, len, out);
+		check((ret == 0) && !memcmp(out, ref, dlen), "streamed", name, ret);
+
+		ret = nu_sha_starts(&ctx, alg);
+		if (ret == 0)
+			ret = sha_pieces(&ctx, heap + off, len, out);
+		check((ret == 0) && !memcmp(out, ref, dlen), "streamed from heap", name, ret);
+
+		memset(out, 0, sizeof(out));
+		ret = nu_sha(alg, heap + off, len, out);
+		check((ret == 0) && !memcmp(out, ref, dlen), "one-shot", name, ret);
+		ret = nu_sha(alg, s_msg + off, len, out);
+		check((ret == 0) && !memcmp(out, ref, dlen), "one-shot in place", name, ret);
+	}
+
+	/* Whole blocks, in one update and block by block: SHA_Finish gets the last */
+	blk = nu_sha_block_size(alg);
+	for (i = 0; i < 3; i++) {
+		len = blk * ((i < 2) ? i + 1 : 300);
+		rnd_fill(s_msg, len);
+		tsi_emu_ref_sha(s_algs[alg].sel, s_algs[alg].mode, s_msg, len, ref);
+
+		ret = nu_sha_starts(&ctx, alg);
+		if (ret == 0)
+			ret = nu_sha_update(&ctx, s_msg, len);
+		if (ret == 0)
+			ret = nu_sha_finish(&ctx, out);
+		check((ret == 0) && !memcmp(out, ref, dlen), "whole blocks", name, ret);
+
+		ret = nu_sha_starts(&ctx, alg);
+		for (off = 0; (ret == 0) && (off < len); off += blk)
+			ret = nu_sha_update(&ctx, s_msg + off, blk);
+		if (ret == 0)
+			ret = nu_sha_finish(&ctx, out);
+		check((ret == 0) && !memcmp(out, ref, dlen), "block by block", name, ret);
+	}
+
+	/* 1 MB in one update: a handful of TSI runs, not 256 staged loads */
+	len = 1024 * 1024 + 13;
+	rnd_fill(s_msg, len);
+	tsi_emu_ref_sha(s_algs[alg].sel, s_algs[alg].mode, s_msg, len, ref);
+	c0 = sha_cmds();
+	ret = nu_sha_starts(&ctx, alg);
+	if (ret == 0)
+		ret = nu_sha_update(&ctx, s_msg, len);
+	if (ret == 0)
+		ret = nu_sha_finish(&ctx, out);
+	check((ret == 0) && !memcmp(out, ref, dlen), "1 MB update", name, ret);
+	check(sha_cmds() - c0 <= 10, "1 MB update not sent in place", name, (int)(sha_cmds() - c0));
+	nu_sha_free(&ctx);
+	free(heap);
+}
+
+/*---------------------------------------------------------------------------
+ *  HMAC
+ *---------------------------------------------------------------------------*/
+
+static void test_hmac(int alg)
+{
+	static const size_t klens[] = { 0, 3, 4, 20, 64, 65, 128, 131, 144, 200 };
+	static uint32_t ks_key[32];
+	const char *name = s_algs[alg].name;
+	nu_sha_context ctx;
+	uint8_t key[256], out[NU_SHA_MAX_DIGEST], ref[NU_SHA_MAX_DIGEST];
+	size_t dlen = nu_sha_size(alg), len, ki, kw;
+	int i, knum, ret;
+
+	if (alg == NU_SHA_256) {
+		/* RFC 4231 test case 2 */
+		hex_bin("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843", ref);
+		ret = nu_hmac(alg, (const uint8_t *)"Jefe", 4,
+			      (const uint8_t *)"what do ya want for nothing?", 28, out);
+		check((ret == 0) && !memcmp(out, ref, dlen), "HMAC RFC 4231", name, ret);
+	}
+
+	nu_sha_init(&ctx);
+	for (ki = 0; ki < sizeof(klens) / sizeof(klens[0]); ki++) {
+		rnd_fill(key, klens[ki]);
+		len = (ki < 3) ? ki * 50 : rnd() % 100000;
+		rnd_fill(s_msg, len);
+		tsi_emu_ref_hmac(s_algs[alg].sel, s_algs[alg].mode, key, klens[ki], s_msg, len, ref);
+
+		ret = nu_hmac_starts(&ctx, alg, key, klens[ki]);
+		if (ret == 0)
+			ret = sha_pieces(&ctx, s_msg, len, out);
+		check((ret == 0) && !memcmp(out, ref, dlen), "HMAC streamed", name, ret);
+
+		ret = nu_hmac(alg, key, klens[ki], s_msg + 1, len ? len - 1 : 0, out);
+		tsi_emu_ref_hmac(s_algs[alg].sel, s_algs[alg].mode, key, klens[ki], s_msg + 1,
+				 len ? len - 1 : 0, ref);
+		check((ret == 0) && !memcmp(out, ref, dlen), "HMAC one-shot", name, ret);
+	}
+
+	/* Key Store key, zero padded to 512 or 1024 bits, big-endian words */
+	kw = ((alg == NU_SHA_384) || (alg == NU_SHA_512)) ? 32 : 16;
+	memset(key, 0, sizeof(key));
+	rnd_fill(key, 40);
+	for (i = 0; i < (int)kw; i++)
+		ks_key[i] = ((uint32_t)key[4 * i] << 24) | ((uint32_t)key[4 * i + 1] << 16) |
+			    ((uint32_t)key[4 * i + 2] << 8) | key[4 * i + 3];
+	ret = TSI_KS_Write_SRAM(KS_META_HMAC | ((kw == 32) ? KS_META_1024 : KS_META_512),
+				ks_key, &knum);
+	check(ret == 0, "Key Store write", name, ret);
+	len = rnd() % 20000;
+	rnd_fill(s_msg, len);
+	tsi_emu_ref_hmac(s_algs[alg].sel, s_algs[alg].mode, key, 40, s_msg, len, ref);
+	ret = nu_hmac_starts_ks(&ctx, alg, KS_SRAM, knum);
+	if (ret == 0)
+		ret = sha_pieces(&ctx, s_msg, len, out);
+	check((ret == 0) && !memcmp(out, ref, dlen), "HMAC Key Store key", name, ret);
+
+	/* Nothing for SHA_Finish to carry */
+	ret = nu_hmac_starts_ks(&ctx, alg, KS_SRAM, knum);
+	if (ret == 0)
+		ret = nu_sha_finish(&ctx, out);
+	check(ret == MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED, "HMAC Key Store key, empty message",
+	      name, ret);
+	TSI_KS_EraseKey(KS_SRAM, knum);
+
+	/* An erased key must fail, and keep failing */
+	ret = nu_hmac_starts_ks(&ctx, alg, KS_SRAM, knum);
+	if (ret == 0)
+		ret = nu_sha_update(&ctx, s_msg, 4096);
+	check(ret == MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED, "HMAC erased key", name, ret);
+	ret = nu_sha_finish(&ctx, out);
+	check(ret == MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED, "HMAC finish after failure", name, ret);
+	nu_sha_free(&ctx);
+}
+
+/*---------------------------------------------------------------------------
+ *  mbedTLS API, clone and sessions
+ *---------------------------------------------------------------------------*/
+
+static void test_mbedtls(void)
+{
+	mbedtls_sha256_context c256, d256;
+	mbedtls_sha512_context c512;
+	uint8_t out[64], ref[64];
+	int ret;
+
+	printf("mbedTLS SHA-256/SHA-512 ...\n");
+	ret = mbedtls_sha256_self_test(0);
+	check(ret == 0, "self test", "SHA-256", ret);
+	ret = mbedtls_sha512_self_test(0);
+	check(ret == 0, "self test", "SHA-512", ret);
+
+	rnd_fill(s_msg, 300000);
+	tsi_emu_ref_sha(SHA_MODE_SEL_SHA2, SHA_MODE_SHA384, s_msg, 300000, ref);
+	mbedtls_sha512_init(&c512);
+	ret = mbedtls_sha512_starts(&c512, 1);
+	if (ret == 0)
+		ret = mbedtls_sha512_update(&c512, s_msg, 300000);
+	if (ret == 0)
+		ret = mbedtls_sha512_finish(&c512, out);
+	check((ret == 0) && !memcmp(out, ref, 48), "streamed", "SHA-384", ret);
+	mbedtls_sha512_free(&c512);
+
+	/* A clone of a context that has not reached the TSI is a full copy */
+	tsi_emu_ref_sha(SHA_MODE_SEL_SHA2, SHA_MODE_SHA256, s_msg, 40, ref);
+	mbedtls_sha256_init(&c256);
+	mbedtls_sha256_init(&d256);
+	mbedtls_sha256_starts(&c256, 0);
+	mbedtls_sha256_update(&c256, s_msg, 20);
+	mbedtls_sha256_clone(&d256, &c256);
+	mbedtls_sha256_update(&d256, s_msg + 20, 20);
+	ret = mbedtls_sha256_finish(&d256, out);
+	check((ret == 0) && !memcmp(out, ref, 32), "clone", "SHA-256", ret);
+	mbedtls_sha256_update(&c256, s_msg + 20, 20);
+	ret = mbedtls_sha256_finish(&c256, out);
+	check((ret == 0) && !memcmp(out, ref, 32), "clone source", "SHA-256", ret);
+
+	/* One that has cannot be copied, and says so */
+	tsi_emu_ref_sha(SHA_MODE_SEL_SHA2, SHA_MODE_SHA256, s_msg, 8192, ref);
+	mbedtls_sha256_starts(&c256, 0);
+	mbedtls_sha256_update(&c256, s_msg, 4096);
+	mbedtls_sha256_clone(&d256, &c256);
+	ret = mbedtls_sha256_update(&d256, s_msg + 4096, 4096);
+	check(ret == MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED, "clone of a running digest",
+	      "SHA-256", ret);
+	ret = mbedtls_sha256_finish(&d256, out);
+	check(ret == MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED, "clone finish", "SHA-256", ret);
+	mbedtls_sha256_update(&c256, s_msg + 4096, 4096);
+	ret = mbedtls_sha256_finish(&c256, out);
+	check((ret == 0) && !memcmp(out, ref, 32), "source of a failed clone", "SHA-256", ret);
+
+	/* Freed mid-stream, its session must be closed */
+	mbedtls_sha256_starts(&c256, 0);
+	mbedtls_sha256_update(&c256, s_msg, 4096);
+	mbedtls_sha256_free(&c256);
+	mbedtls_sha256_free(&d256);
+}
+
+static void test_sessions(void)
+{
+	nu_sha_context a, b;
+	struct tsi_emu_stats es;
+	uint8_t out[64], ref[64];
+	int ret;
+
+	printf("Out of TSI sessions ...\n");
+	tsi_emu_set_max_sessions(1);
+	nu_sha_init(&a);
+	nu_sha_init(&b);
+	rnd_fill(s_msg, 8192);
+	nu_sha_starts(&a, NU_SHA_256);
+	nu_sha_starts(&b, NU_SHA_256);
+	ret = nu_sha_update(&a, s_msg, 4096);
+	check(ret == 0, "first context", "", ret);
+	ret = nu_sha_update(&b, s_msg, 4096);
+	check(ret == MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED, "second context", "", ret);
+	ret = nu_sha_update(&b, s_msg + 4096, 10);
+	check(ret == MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED, "sticky error", "", ret);
+
+	/* Short digests need no session */
+	tsi_emu_ref_sha(SHA_MODE_SEL_SHA2, SHA_MODE_SHA256, s_msg, 60, ref);
+	ret = nu_sha(NU_SHA_256, s_msg, 60, out);
+	check((ret == 0) && !memcmp(out, ref, 32), "short digest", "", ret);
+
+	tsi_emu_ref_sha(SHA_MODE_SEL_SHA2, SHA_MODE_SHA256, s_msg, 4096, ref);
+	ret = nu_sha_finish(&a, out);
+	check((ret == 0) && !memcmp(out, ref, 32), "first context finish", "", ret);
+	nu_sha_free(&a);
+	nu_sha_free(&b);
+	tsi_emu_set_max_sessions(8);
+
+	tsi_emu_get_stats(&es);
+	check(es.sessions == 0, "sessions left open", "", (int)es.sessions);
+}
+
+/*---------------------------------------------------------------------------
+ *  MB/s
+ *---------------------------------------------------------------------------*/
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int bench_ref(int alg, int hmac, const uint8_t *p, size_t len, uint8_t *out)
+{
+	static const uint8_t key[32] = { 1 };
+
+	if (hmac)
+		return tsi_emu_ref_hmac(s_algs[alg].sel, s_algs[alg].mode, key, 32, p, len, out);
+	return tsi_emu_ref_sha(s_algs[alg].sel, s_algs[alg].mode, p, len, out);
+}
+
+static int bench_tsi(int alg, int hmac, const uint8_t *p, size_t len, uint8_t *out)
+{
+	static const uint8_t key[32] = { 1 };
+	nu_sha_context ctx;
+	int ret;
+
+	nu_sha_init(&ctx);
+	ret = hmac ? nu_hmac_starts(&ctx, alg, key, 32) : nu_sha_starts(&ctx, alg);
+	if (ret == 0)
+		ret = nu_sha_update(&ctx, p, len);
+	if (ret == 0)
+		ret = nu_sha_finish(&ctx, out);
+	nu_sha_free(&ctx);
+	return ret;
+}
+
+static double bench_rate(int (*fn)(int, int, const uint8_t *, size_t, uint8_t *),
+			 int alg, int hmac, const uint8_t *p, size_t len, int *ret)
+{
+	uint8_t out[NU_SHA_MAX_DIGEST];
+	double t0 = now(), t;
+	size_t done = 0;
+
+	do {
+		*ret |= fn(alg, hmac, p, len, out);
+		done += len;
+		t = now() - t0;
+	} while ((t < 0.05) && (done < 64 * 1024 * 1024));
+	return done / t / 1e6;
+}
+
+static void bench(void)
+{
+	static const size_t sizes[] = {
+		16, 64, 256, 1024, 4096, 16384, 65536, 1024 * 1024, BENCH_MAX
+	};
+	static const struct {
+		int alg, hmac;
+		const char *name;
+	} runs[] = {
+		{ NU_SHA_256,  0, "SHA-256" },
+		{ NU_SHA_512,  0, "SHA-512" },
+		{ NU_SHA3_256, 0, "SHA3-256" },
+		{ NU_SHA_256,  1, "HMAC-256" },
+	};
+	uint8_t *heap = malloc(BENCH_MAX + 4);
+	uint64_t c0, c1, c2;
+	uint8_t out[NU_SHA_MAX_DIGEST];
+	size_t ri, si, len;
+	int ret = 0;
+
+	rnd_fill(s_big, BENCH_MAX);
+	memcpy(heap + 1, s_big, BENCH_MAX);
+
+	printf("\nSHA MB/s on this host (emulated TSI) for one update of each size: in place\n");
+	printf("from an aligned TSI reachable buffer, staged from an unaligned heap buffer,\n");
+	printf("and in software, with the TSI round trips per MB of either TSI path\n");
+	printf("%-9s %9s %10s %10s %10s %9s %9s\n", "digest", "bytes", "in place", "staged",
+	       "sw", "rt/MB", "rt/MB st");
+
+	for (ri = 0; ri < sizeof(runs) / sizeof(runs[0]); ri++) {
+		for (si = 0; si < sizeof(sizes) / sizeof(sizes[0]); si++) {
+			len = sizes[si];
+			c0 = sha_cmds();
+			ret |= bench_tsi(runs[ri].alg, runs[ri].hmac, s_big, len, out);
+			c1 = sha_cmds();
+			ret |= bench_tsi(runs[ri].alg, runs[ri].hmac, heap + 1, len, out);
+			c2 = sha_cmds();
+			printf("%-9s %9zu %10.1f %10.1f %10.1f %9.1f %9.1f\n", runs[ri].name, len,
+			       bench_rate(bench_tsi, runs[ri].alg, runs[ri].hmac, s_big, len, &ret),
+			       bench_rate(bench_tsi, runs[ri].alg, runs[ri].hmac, heap + 1, len, &ret),
+			       bench_rate(bench_ref, runs[ri].alg, runs[ri].hmac, s_big, len, &ret),
+			       (c1 - c0) * 1048576.0 / len, (c2 - c1) * 1048576.0 / len);
+		}
+	}
+	free(heap);
+	check(ret == 0, "benchmark call", "", ret);
+}
+
+int main(void)
+{
+	int alg, ret;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	ret = TSI_Init();
+	check(ret == 0, "TSI_Init", "", ret);
+
+	for (alg = 0; alg < NU_SHA_ALG_NUM; alg++) {
+		printf("%s ...\n", s_algs[alg].name);
+		test_digest(alg);
+		test_hmac(alg);
+	}
+	test_mbedtls();
+	test_sessions();
+
+	bench();
+
+	printf("\n%s (%d failures)\n", s_fail ? "FAILED" : "PASSED", s_fail);
+	return s_fail ? 1 : 0;
+}
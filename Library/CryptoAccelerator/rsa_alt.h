@@ -0,0 +1,133 @@
+/**
+ * \file rsa_alt.h
+ *
+ * \brief RSA public-key cryptosystem on the TSI RSA engine
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  Copyright (c) 2023, Nuvoton Technology Corporation
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_RSA_ALT_H
+#define MBEDTLS_RSA_ALT_H
+
+/* Included by mbedtls/rsa.h in place of its own context definition */
+#include "mbedtls/bignum.h"
+#if defined(MBEDTLS_THREADING_C)
+#include "mbedtls/threading.h"
+#endif
+
+#if defined(MBEDTLS_RSA_ALT)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief          RSA context structure
+ *
+ *                 Same as the software context, plus the Key Store location
+ *                 of D for keys whose private exponent is kept in the TSI.
+ */
+typedef struct mbedtls_rsa_context
+{
+    int MBEDTLS_PRIVATE(ver);                    /*!<  Reserved for internal purposes. */
+    size_t MBEDTLS_PRIVATE(len);                 /*!<  The size of \p N in Bytes. */
+
+    mbedtls_mpi MBEDTLS_PRIVATE(N);              /*!<  The public modulus. */
+    mbedtls_mpi MBEDTLS_PRIVATE(E);              /*!<  The public exponent. */
+
+    mbedtls_mpi MBEDTLS_PRIVATE(D);              /*!<  The private exponent. */
+    mbedtls_mpi MBEDTLS_PRIVATE(P);              /*!<  The first prime factor. */
+    mbedtls_mpi MBEDTLS_PRIVATE(Q);              /*!<  The second prime factor. */
+
+    mbedtls_mpi MBEDTLS_PRIVATE(DP);             /*!<  <code>D % (P - 1)</code>. */
+    mbedtls_mpi MBEDTLS_PRIVATE(DQ);             /*!<  <code>D % (Q - 1)</code>. */
+    mbedtls_mpi MBEDTLS_PRIVATE(QP);             /*!<  <code>1 / (Q % P)</code>. */
+
+    mbedtls_mpi MBEDTLS_PRIVATE(RN);             /*!<  cached <code>R^2 mod N</code>. */
+
+    mbedtls_mpi MBEDTLS_PRIVATE(RP);             /*!<  cached <code>R^2 mod P</code>. */
+    mbedtls_mpi MBEDTLS_PRIVATE(RQ);             /*!<  cached <code>R^2 mod Q</code>. */
+
+    mbedtls_mpi MBEDTLS_PRIVATE(Vi);             /*!<  The cached blinding value. */
+    mbedtls_mpi MBEDTLS_PRIVATE(Vf);             /*!<  The cached un-blinding value. */
+
+    int MBEDTLS_PRIVATE(padding);                /*!< MBEDTLS_RSA_PKCS_V15 or MBEDTLS_RSA_PKCS_V21 */
+    int MBEDTLS_PRIVATE(hash_id);                /*!< Hash of the EME-OAEP and EMSA-PSS MGF */
+
+    int MBEDTLS_PRIVATE(ksSel);                  /*!< RSA_KEY_SEL_KS_SRAM/OTP if D is in the Key Store, else 0 */
+    int MBEDTLS_PRIVATE(ksNum);                  /*!< Key Store key number of D */
+#if defined(MBEDTLS_THREADING_C)
+    /* Invariant: the mutex is initialized iff ver != 0. */
+    mbedtls_threading_mutex_t MBEDTLS_PRIVATE(mutex);    /*!<  Thread-safety mutex. */
+#endif
+}
+mbedtls_rsa_context;
+
+/*
+ * Private keys in memory run as one exponentiation with D. With
+ * NU_RSA_USE_CRT 1, keys with P and Q use the CRT mode of TSI_RSA_Exp_Mod()
+ * instead. Its parameter layout is not documented and not confirmed on
+ * hardware, so a CRT result that fails the glitch check is computed again
+ * without CRT.
+ */
+#ifndef NU_RSA_USE_CRT
+#define NU_RSA_USE_CRT      0
+#endif
+
+/*
+ * A context bound to a Key Store private exponent holds N and E only. Its
+ * private operations run on the TSI without CRT, the exponent never leaves
+ * the Key Store. mbedtls_rsa_check_privkey() and mbedtls_rsa_export() of
+ * the private parts fail on such a context.
+ */
+
+/**
+ * \brief          Use a private exponent in the TSI Key Store
+ *
+ * \param ctx      RSA context with N and E imported and completed
+ * \param mem      KS_SRAM or KS_OTP
+ * \param knum     Key number of the KS_META_RSA_EXP key in \p mem
+ *
+ * \return         0 if successful, MBEDTLS_ERR_RSA_BAD_INPUT_DATA if the
+ *                 modulus size is not supported by the TSI
+ */
+int nu_rsa_ks_bind(mbedtls_rsa_context *ctx, int mem, int knum);
+
+/**
+ * \brief          Move the private exponent of a key to Key Store SRAM
+ *
+ *                 D is written to a free Key Store SRAM entry, then D, P,
+ *                 Q and the CRT values are cleared from the context.
+ *
+ * \param ctx      RSA private key context
+ * \param meta     Additional Key Store metadata flags (KS_META_PRIV,
+ *                 KS_META_SECURE, KS_META_READABLE), owner and size are
+ *                 set from the key
+ * \param knum     Set to the Key Store SRAM key number, may be NULL
+ *
+ * \return         0 if successful, or an RSA/platform error code
+ */
+int nu_rsa_ks_import(mbedtls_rsa_context *ctx, uint32_t meta, int *knum);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBEDTLS_RSA_ALT */
+
+#endif /* MBEDTLS_RSA_ALT_H */
@@ -32,25 +32,23 @@
 
 #if defined (MBEDTLS_SHA256_ALT)
 
-#include "NuMicro.h"
-
-#define  NU_SHA256_BLOCK_SIZE   (4096)
+#include "sha_alt.h"
 
 /**
  * \brief          SHA-256 context structure
  *
  *                 The structure is used both for SHA-256 and for SHA-224
  *                 checksum calculations. The choice between these two is
- *                 made in the call to mbedtls_sha256_starts_ret().
+ *                 made in the call to mbedtls_sha256_starts().
+ *
+ *                 The digest runs on a TSI SHA session, see sha_alt.h.
+ *                 mbedtls_sha256_clone() of a context that has already sent
+ *                 data to the TSI is not supported, so TLS, which clones its
+ *                 handshake checksum, needs the software SHA-256.
  */
 typedef struct mbedtls_sha256_context
 {
-	int32_t   MBEDTLS_PRIVATE(is224);         /*!< 0 = use SHA256, 1 = use SHA224 */
-	uint8_t   buffer[NU_SHA256_BLOCK_SIZE];   /*!< Buffer to store input data */
-	uint32_t  buffer_len;                     /*!< Number of bytes stored in sbuf */
-	int32_t   first;                          /*!< First block flag */
-	uint32_t  ctl;                            /*!< SHA register settings */
-	int       sid;
+	nu_sha_context MBEDTLS_PRIVATE(nu);     /*!< TSI digest */
 }
 mbedtls_sha256_context;
 
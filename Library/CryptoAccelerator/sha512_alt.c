@@ -0,0 +1,111 @@
+/*
+ *  FIPS-180-2 compliant SHA-384/512 implementation
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  Copyright (C) 2023, Nuvoton Technology Corporation, All Rights Reserved.
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  SHA-384 and SHA-512 on the TSI SHA engine, see sha_alt.c.
+ */
+/*
+ *  The SHA-512 Secure Hash Standard was published by NIST in 2002.
+ *
+ *  http://csrc.nist.gov/publications/fips/fips180-2/fips180-2.pdf
+ */
+
+#include "common.h"
+
+#include "mbedtls/sha512.h"
+#include "mbedtls/error.h"
+
+#if defined(MBEDTLS_SHA512_C)
+#if defined(MBEDTLS_SHA512_ALT)
+#include "mbedtls/platform_util.h"
+
+#include "sha_alt.h"
+
+#define SHA512_VALIDATE_RET(cond)                           \
+	MBEDTLS_INTERNAL_VALIDATE_RET( cond, MBEDTLS_ERR_SHA512_BAD_INPUT_DATA )
+#define SHA512_VALIDATE(cond)  MBEDTLS_INTERNAL_VALIDATE( cond )
+
+#ifndef ARG_UNUSED
+#define ARG_UNUSED(arg)  ((void)arg)
+#endif
+
+
+void mbedtls_sha512_init(mbedtls_sha512_context *ctx)
+{
+	SHA512_VALIDATE( ctx != NULL );
+
+	nu_sha_init(&ctx->MBEDTLS_PRIVATE(nu));
+}
+
+void mbedtls_sha512_free(mbedtls_sha512_context *ctx)
+{
+	if (ctx == NULL)
+	{
+		return;
+	}
+	nu_sha_free(&ctx->MBEDTLS_PRIVATE(nu));
+}
+
+void mbedtls_sha512_clone(mbedtls_sha512_context *dst,
+						  const mbedtls_sha512_context *src)
+{
+	SHA512_VALIDATE( dst != NULL );
+	SHA512_VALIDATE( src != NULL );
+
+	nu_sha_clone(&dst->MBEDTLS_PRIVATE(nu), &src->MBEDTLS_PRIVATE(nu));
+}
+
+int mbedtls_sha512_starts(mbedtls_sha512_context *ctx, int is384)
+{
+	SHA512_VALIDATE_RET( ctx != NULL );
+#if defined(MBEDTLS_SHA384_C)
+	SHA512_VALIDATE_RET( is384 == 0 || is384 == 1 );
+#else
+	SHA512_VALIDATE_RET( is384 == 0 );
+#endif
+
+	return nu_sha_starts(&ctx->MBEDTLS_PRIVATE(nu), is384 ? NU_SHA_384 : NU_SHA_512);
+}
+
+int mbedtls_internal_sha512_process( mbedtls_sha512_context *ctx, const unsigned char data[128] )
+{
+	ARG_UNUSED(ctx);
+	ARG_UNUSED(data);
+
+	return MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
+}
+
+int mbedtls_sha512_update(mbedtls_sha512_context *ctx, const unsigned char *input, size_t ilen)
+{
+	SHA512_VALIDATE_RET( ctx != NULL );
+	SHA512_VALIDATE_RET( ilen == 0 || input != NULL );
+
+	return nu_sha_update(&ctx->MBEDTLS_PRIVATE(nu), input, ilen);
+}
+
+int mbedtls_sha512_finish(mbedtls_sha512_context *ctx, unsigned char *output)
+{
+	SHA512_VALIDATE_RET( ctx != NULL );
+	SHA512_VALIDATE_RET( (unsigned char *)output != NULL );
+
+	return nu_sha_finish(&ctx->MBEDTLS_PRIVATE(nu), output);
+}
+
+#endif /* MBEDTLS_SHA512_ALT */
+#endif /* MBEDTLS_SHA512_C */
@@ -0,0 +1,46 @@
+/**
+ * \file sha512_alt.h
+ *
+ * \brief SHA-384 and SHA-512 on the TSI SHA engine
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  Copyright (c) 2023, Nuvoton Technology Corporation
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_SHA512_ALT_H
+#define MBEDTLS_SHA512_ALT_H
+
+#if defined(MBEDTLS_SHA512_ALT)
+
+#include "sha_alt.h"
+
+/**
+ * \brief          SHA-512 context structure
+ *
+ *                 Used for SHA-384 and SHA-512, chosen by
+ *                 mbedtls_sha512_starts(). Same TSI digest and the same
+ *                 clone restriction as mbedtls_sha256_context.
+ */
+typedef struct mbedtls_sha512_context
+{
+	nu_sha_context MBEDTLS_PRIVATE(nu);     /*!< TSI digest */
+}
+mbedtls_sha512_context;
+
+#endif /* MBEDTLS_SHA512_ALT */
+
+#endif /* MBEDTLS_SHA512_ALT_H */
@@ -0,0 +1,461 @@
+/*
+ *  SHA-2, SHA-3 and HMAC on the TSI SHA engine
+ *
+ *  Copyright (c) 2023, Nuvoton Technology Corporation
+ *
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+/*
+ *  FIPS 180-4 (SHA-1, SHA-2), FIPS 202 (SHA-3), RFC 2104 (HMAC)
+ */
+
+#include "common.h"
+
+#include "mbedtls/platform_util.h"
+#include "mbedtls/error.h"
+
+#include <string.h>
+#include "NuMicro.h"
+#include "tsi_cmd.h"
+
+#include "sha_alt.h"
+
+
+/* The TSI DMA takes 32-bit addresses */
+#ifndef NU_DMA_ADDR_OK
+#define NU_DMA_ADDR_OK(p, len)  (((uint64_t)(uintptr_t)(p) + (len)) <= 0x100000000ULL)
+#endif
+
+/* DMA staging buffer
+ *
+ * Holds the HMAC key and last block of a context together with the
+ * input that completes the block, and carries input the TSI cannot read in
+ * place. The CPU writes it through the non-cacheable alias. Every update
+ * empties it, so all contexts share it.
+ */
+#define SHA_STAGE_SIZE      4096
+
+__ALIGNED(64) static uint8_t s_shaStage[SHA_STAGE_SIZE];
+__ALIGNED(64) static uint8_t s_shaDigest[NU_SHA_MAX_DIGEST];
+
+/* All At Once takes a 24-bit length */
+#define SHA_ONCE_MAX        0xFFFFFF
+
+static const struct
+{
+	uint8_t  sel;       /* SHA_MODE_SEL_xxx */
+	uint8_t  mode;      /* SHA_MODE_xxx */
+	uint8_t  wcnt;      /* digest words */
+	uint8_t  blk;       /* block size (SHA-3 rate) in bytes */
+} s_shaInfo[NU_SHA_ALG_NUM] =
+{
+	[NU_SHA_1]    = { SHA_MODE_SEL_SHA1, SHA_MODE_SHA1,    5,  64 },
+	[NU_SHA_224]  = { SHA_MODE_SEL_SHA2, SHA_MODE_SHA224,  7,  64 },
+	[NU_SHA_256]  = { SHA_MODE_SEL_SHA2, SHA_MODE_SHA256,  8,  64 },
+	[NU_SHA_384]  = { SHA_MODE_SEL_SHA2, SHA_MODE_SHA384, 12, 128 },
+	[NU_SHA_512]  = { SHA_MODE_SEL_SHA2, SHA_MODE_SHA512, 16, 128 },
+	[NU_SHA3_224] = { SHA_MODE_SEL_SHA3, SHA_MODE_SHA224,  7, 144 },
+	[NU_SHA3_256] = { SHA_MODE_SEL_SHA3, SHA_MODE_SHA256,  8, 136 },
+	[NU_SHA3_384] = { SHA_MODE_SEL_SHA3, SHA_MODE_SHA384, 12, 104 },
+	[NU_SHA3_512] = { SHA_MODE_SEL_SHA3, SHA_MODE_SHA512, 16,  72 },
+};
+
+#define SHA_ALG_OK(alg)     (((alg) >= 0) && ((alg) < NU_SHA_ALG_NUM))
+
+
+size_t nu_sha_size(int alg)
+{
+	return SHA_ALG_OK(alg) ? s_shaInfo[alg].wcnt * 4 : 0;
+}
+
+size_t nu_sha_block_size(int alg)
+{
+	return SHA_ALG_OK(alg) ? s_shaInfo[alg].blk : 0;
+}
+
+static void nu_sha_close(nu_sha_context *ctx)
+{
+	if (ctx->sid >= 0)
+		TSI_Close_Session(C_CODE_SHA, ctx->sid);
+	ctx->sid = -1;
+}
+
+/* End the digest with an error, later calls return it */
+static int nu_sha_fail(nu_sha_context *ctx, int ret)
+{
+	nu_sha_close(ctx);
+	ctx->err = ret;
+	return ret;
+}
+
+void nu_sha_init(nu_sha_context *ctx)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->alg = -1;
+	ctx->sid = -1;
+}
+
+void nu_sha_free(nu_sha_context *ctx)
+{
+	if (ctx == NULL)
+		return;
+	nu_sha_close(ctx);
+	mbedtls_platform_zeroize(ctx, sizeof(*ctx));
+	ctx->alg = -1;
+	ctx->sid = -1;
+}
+
+void nu_sha_clone(nu_sha_context *dst, const nu_sha_context *src)
+{
+	if (dst == src)
+		return;
+	nu_sha_close(dst);
+	*dst = *src;
+	if (src->sid >= 0)
+	{
+		/* The digest so far lives in the TSI session of src */
+		dst->sid = -1;
+		dst->err = MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
+	}
+}
+
+static int nu_sha_begin(nu_sha_context *ctx, int alg)
+{
+	if (!SHA_ALG_OK(alg))
+		return MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
+	nu_sha_close(ctx);
+	ctx->alg = alg;
+	ctx->err = 0;
+	ctx->hmac = 0;
+	ctx->ks = SEL_KEY_FROM_REG;
+	ctx->ksNum = 0;
+	ctx->keyLen = 0;
+	ctx->head = 0;
+	ctx->bufLen = 0;
+	return 0;
+}
+
+int nu_sha_starts(nu_sha_context *ctx, int alg)
+{
+	return nu_sha_begin(ctx, alg);
+}
+
+int nu_hmac_starts(nu_sha_context *ctx, int alg, const unsigned char *key,
+				   size_t keylen)
+{
+	unsigned char dgst[NU_SHA_MAX_DIGEST];
+	int ret;
+
+	if ((ret = nu_sha_begin(ctx, alg)) != 0)
+		return ret;
+
+	if (keylen > s_shaInfo[alg].blk)
+	{
+		if ((ret = nu_sha(alg, key, keylen, dgst)) != 0)
+			return nu_sha_fail(ctx, ret);
+		key = dgst;
+		keylen = nu_sha_size(alg);
+	}
+
+	/* The key leads the data stream, padded to a word */
+	ctx->hmac = 1;
+	ctx->keyLen = keylen;
+	ctx->head = (keylen + 3) & ~3UL;
+	memset(ctx->buf, 0, ctx->head);
+	memcpy(ctx->buf, key, keylen);
+	ctx->bufLen = ctx->head;
+	mbedtls_platform_zeroize(dgst, sizeof(dgst));
+	return 0;
+}
+
+int nu_hmac_starts_ks(nu_sha_context *ctx, int alg, int mem, int knum)
+{
+	int ret;
+
+	if ((ret = nu_sha_begin(ctx, alg)) != 0)
+		return ret;
+	ctx->hmac = 1;
+	ctx->ks = (mem == KS_OTP) ? SEL_KEY_FROM_KS_OTP : SEL_KEY_FROM_KS_SRAM;
+	ctx->ksNum = knum;
+	return 0;
+}
+
+/* Open the TSI session at the first data that goes to the TSI */
+static int nu_sha_engage(nu_sha_context *ctx)
+{
+	int ret;
+
+	if (ctx->sid >= 0)
+		return 0;
+
+	ret = TSI_Open_Session(C_CODE_SHA, &ctx->sid);
+	if (ret != 0)
+	{
+		ctx->sid = -1;
+		return nu_sha_fail(ctx, MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED);
+	}
+	ret = TSI_SHA_Start(ctx->sid,
+						1,                          /* inswap   */
+						1,                          /* outswap  */
+						s_shaInfo[ctx->alg].sel,    /* mode_sel */
+						ctx->hmac,                  /* hmac     */
+						s_shaInfo[ctx->alg].mode,   /* mode     */
+						ctx->keyLen,                /* keylen   */
+						ctx->ks,                    /* ks       */
+						ctx->ksNum                  /* ks_num   */
+						);
+	if (ret != 0)
+		return nu_sha_fail(ctx, MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED);
+	return 0;
+}
+
+/*
+ * Whole blocks from the caller's buffer. Each run is cleaned from the data
+ * cache while the TSI works on the previous one.
+ */
+static int nu_sha_stream(nu_sha_context *ctx, const uint8_t *p, size_t len)
+{
+	TSI_REQ_T req[2];
+	size_t run, n;
+	int cur = 0, inflight = 0, ret = 0, st;
+
+	run = NU_SHA_RUN_SIZE / s_shaInfo[ctx->alg].blk * s_shaInfo[ctx->alg].blk;
+
+	while (len > 0)
+	{
+		n = (len < run) ? len : run;
+		dcache_clean_by_mva(p, n);
+
+		st = TSI_SHA_Update_Async(&req[cur], ctx->sid, n, ptr_to_u32(p), NULL, NULL);
+
+		/* The previous run is ahead of this one in the TSI */
+		if (inflight)
+		{
+			ret = TSI_Wait(&req[cur ^ 1], CMD_TIME_OUT_2S);
+			inflight = 0;
+		}
+		if (st == 0)
+		{
+			inflight = 1;
+			cur ^= 1;
+		}
+		else if ((st == ST_WHC_TX_BUSY) && (ret == 0))
+		{
+			/* Channels held by other requests */
+			ret = TSI_SHA_Update(ctx->sid, n, ptr_to_u32(p));
+		}
+		else if (ret == 0)
+		{
+			ret = st;
+		}
+		if (ret != 0)
+			break;
+		p += n;
+		len -= n;
+	}
+	if (inflight)
+	{
+		st = TSI_Wait(&req[cur ^ 1], CMD_TIME_OUT_2S);
+		if (ret == 0)
+			ret = st;
+	}
+	return ret;
+}
+
+int nu_sha_update(nu_sha_context *ctx, const unsigned char *input, size_t ilen)
+{
+	uint8_t *stage = nc_ptr(s_shaStage);
+	size_t blk, msg, k, span, n, take;
+	int ret;
+
+	if (!SHA_ALG_OK(ctx->alg))
+		return MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
+	if (ctx->err != 0)
+		return ctx->err;
+	if (ilen == 0)
+		return 0;
+
+	/* The last 1 to blk message bytes stay for TSI_SHA_Finish */
+	blk = s_shaInfo[ctx->alg].blk;
+	msg = ctx->bufLen - ctx->head;
+	if (msg + ilen <= blk)
+	{
+		memcpy(ctx->buf + ctx->bufLen, input, ilen);
+		ctx->bufLen += ilen;
+		return 0;
+	}
+
+	if ((ret = nu_sha_engage(ctx)) != 0)
+		return ret;
+
+	/* k input bytes complete the buffered block, whole blocks follow */
+	k = (blk - msg) % blk;
+	span = (ilen - k - 1) / blk * blk;
+
+	if ((span > SHA_STAGE_SIZE) && !(((uintptr_t)input + k) & 3) &&
+		NU_DMA_ADDR_OK(input + k, span))
+	{
+		if (ctx->bufLen + k > 0)
+		{
+			memcpy(stage, ctx->buf, ctx->bufLen);
+			memcpy(stage + ctx->bufLen, input, k);
+			ret = TSI_SHA_Update(ctx->sid, ctx->bufLen + k, ptr_to_u32(s_shaStage));
+		}
+		if (ret == 0)
+			ret = nu_sha_stream(ctx, input + k, span);
+		n = k + span;
+	}
+	else
+	{
+		/* Staged, the first piece also carries the buffered bytes */
+		memcpy(stage, ctx->buf, ctx->bufLen);
+		take = (SHA_STAGE_SIZE - ctx->bufLen + msg) / blk * blk - msg;
+		if (take > k + span)
+			take = k + span;
+		memcpy(stage + ctx->bufLen, input, take);
+		ret = TSI_SHA_Update(ctx->sid, ctx->bufLen + take, ptr_to_u32(s_shaStage));
+
+		for (n = take; (ret == 0) && (n < k + span); n += take)
+		{
+			take = k + span - n;
+			if (take > SHA_STAGE_SIZE / blk * blk)
+				take = SHA_STAGE_SIZE / blk * blk;
+			memcpy(stage, input + n, take);
+			ret = TSI_SHA_Update(ctx->sid, take, ptr_to_u32(s_shaStage));
+		}
+	}
+	if (ret != 0)
+		return nu_sha_fail(ctx, MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED);
+
+	ctx->head = 0;
+	ctx->bufLen = ilen - n;
+	memcpy(ctx->buf, input + n, ctx->bufLen);
+	return 0;
+}
+
+/*
+ * HMAC of an empty message under an empty key, which leaves TSI_SHA_Finish()
+ * nothing to carry: K0 is all zero, so both hashes run without a session.
+ */
+static int nu_hmac_empty(int alg, unsigned char *output)
+{
+	unsigned char pad[NU_SHA_MAX_BLOCK + NU_SHA_MAX_DIGEST];
+	const size_t blk = s_shaInfo[alg].blk;
+	int ret;
+
+	memset(pad, 0x36, blk);
+	ret = nu_sha(alg, pad, blk, pad + blk);
+	if (ret == 0)
+	{
+		memset(pad, 0x5c, blk);
+		ret = nu_sha(alg, pad, blk + nu_sha_size(alg), output);
+	}
+	mbedtls_platform_zeroize(pad, sizeof(pad));
+	return ret;
+}
+
+int nu_sha_finish(nu_sha_context *ctx, unsigned char *output)
+{
+	const int alg = ctx->alg;
+	int ret;
+
+	if (!SHA_ALG_OK(alg))
+		return MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
+	if (ctx->err != 0)
+		return ctx->err;
+
+	memcpy(nc_ptr(s_shaStage), ctx->buf, ctx->bufLen);
+	if ((ctx->sid < 0) && !ctx->hmac)
+	{
+		/* Short message, no session needed */
+		ret = TSI_SHA_All_At_Once(1, 1, s_shaInfo[alg].sel, s_shaInfo[alg].mode,
+								  s_shaInfo[alg].wcnt, ctx->bufLen,
+								  ptr_to_u32(s_shaStage), ptr_to_u32(s_shaDigest));
+	}
+	else if (ctx->bufLen == 0)
+	{
+		/* Empty message under an empty or a Key Store key, no session yet */
+		ret = (ctx->ks == SEL_KEY_FROM_REG) ? nu_hmac_empty(alg, output) :
+			  MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
+		if (ret != 0)
+			return nu_sha_fail(ctx, ret);
+		return 0;
+	}
+	else
+	{
+		if ((ret = nu_sha_engage(ctx)) != 0)
+			return ret;
+		ret = TSI_SHA_Finish(ctx->sid, s_shaInfo[alg].wcnt, ctx->bufLen,
+							 ptr_to_u32(s_shaStage), ptr_to_u32(s_shaDigest));
+	}
+	if (ret != 0)
+		return nu_sha_fail(ctx, MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED);
+
+	memcpy(output, nc_ptr(s_shaDigest), nu_sha_size(alg));
+	nu_sha_close(ctx);
+	mbedtls_platform_zeroize(ctx->buf, sizeof(ctx->buf));
+	ctx->head = 0;
+	ctx->bufLen = 0;
+	return 0;
+}
+
+int nu_sha(int alg, const unsigned char *input, size_t ilen,
+		   unsigned char *output)
+{
+	nu_sha_context ctx;
+	int ret;
+
+	if (!SHA_ALG_OK(alg))
+		return MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED;
+
+	/* In place, one command */
+	if ((ilen > SHA_STAGE_SIZE) && (ilen <= SHA_ONCE_MAX) &&
+		!((uintptr_t)input & 3) && NU_DMA_ADDR_OK(input, ilen))
+	{
+		dcache_clean_by_mva(input, ilen);
+		ret = TSI_SHA_All_At_Once(1, 1, s_shaInfo[alg].sel, s_shaInfo[alg].mode,
+								  s_shaInfo[alg].wcnt, ilen, ptr_to_u32(input),
+								  ptr_to_u32(s_shaDigest));
+		if (ret != 0)
+			return MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED;
+		memcpy(output, nc_ptr(s_shaDigest), nu_sha_size(alg));
+		return 0;
+	}
+
+	nu_sha_init(&ctx);
+	ret = nu_sha_starts(&ctx, alg);
+	if (ret == 0)
+		ret = nu_sha_update(&ctx, input, ilen);
+	if (ret == 0)
+		ret = nu_sha_finish(&ctx, output);
+	nu_sha_free(&ctx);
+	return ret;
+}
+
+int nu_hmac(int alg, const unsigned char *key, size_t keylen,
+			const unsigned char *input, size_t ilen, unsigned char *output)
+{
+	nu_sha_context ctx;
+	int ret;
+
+	nu_sha_init(&ctx);
+	ret = nu_hmac_starts(&ctx, alg, key, keylen);
+	if (ret == 0)
+		ret = nu_sha_update(&ctx, input, ilen);
+	if (ret == 0)
+		ret = nu_sha_finish(&ctx, output);
+	nu_sha_free(&ctx);
+	return ret;
+}
@@ -0,0 +1,192 @@
+/**
+ * \file sha_alt.h
+ *
+ * \brief SHA-2, SHA-3 and HMAC on the TSI SHA engine
+ *
+ *  Copyright (c) 2023, Nuvoton Technology Corporation
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  This file is part of mbed TLS (https://tls.mbed.org)
+ */
+#ifndef MBEDTLS_SHA_ALT_H
+#define MBEDTLS_SHA_ALT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * One streaming digest on a TSI SHA session, shared by the SHA-256/SHA-512
+ * ALT contexts and used directly for SHA-3 and HMAC, which mbedTLS 3.1 has
+ * no module for.
+ *
+ * Input goes to the TSI straight from the caller's buffer: the buffered
+ * partial block is completed from the input through a DMA staging buffer,
+ * then the whole blocks that follow are cleaned from the data cache and
+ * streamed with TSI_SHA_Update() in NU_SHA_RUN_SIZE runs. The last 1 to
+ * block size bytes stay in the context, because TSI_SHA_Finish() must carry
+ * data, as in the ALT this replaces. Input the TSI cannot reach, or
+ * that is not word aligned once the partial block is completed, is carried
+ * through the staging buffer instead.
+ *
+ * The TSI session is opened when the first block goes to the TSI and
+ * closed by nu_sha_finish() or nu_sha_free(), so idle and short-lived
+ * contexts hold none. The TSI cannot export a running digest: cloning a
+ * context that already streamed data gives a copy whose update and finish
+ * fail with MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED.
+ */
+
+#define NU_SHA_1            0
+#define NU_SHA_224          1
+#define NU_SHA_256          2
+#define NU_SHA_384          3
+#define NU_SHA_512          4
+#define NU_SHA3_224         5
+#define NU_SHA3_256         6
+#define NU_SHA3_384         7
+#define NU_SHA3_512         8
+#define NU_SHA_ALG_NUM      9
+
+#define NU_SHA_MAX_BLOCK    144     /*!< SHA3-224 rate */
+#define NU_SHA_MAX_DIGEST   64
+
+/* Longest TSI_SHA_Update() run from a caller's buffer */
+#define NU_SHA_RUN_SIZE     (256 * 1024)
+
+/**
+ * \brief          TSI digest context
+ */
+typedef struct nu_sha_context
+{
+	int       alg;                  /*!< NU_SHA_xxx, -1 before starts */
+	int       sid;                  /*!< TSI session ID, -1: no session */
+	int       err;                  /*!< error that ended the digest, 0: none */
+	int       ks;                   /*!< HMAC key source, SEL_KEY_FROM_xxx */
+	int       ksNum;                /*!< HMAC Key Store key number */
+	int       hmac;                 /*!< 1: HMAC */
+	uint32_t  keyLen;               /*!< HMAC key bytes ahead of the message */
+	uint32_t  head;                 /*!< bytes of the padded HMAC key in buf */
+	uint32_t  bufLen;               /*!< bytes in buf, head included */
+	uint8_t   buf[2 * NU_SHA_MAX_BLOCK];    /*!< HMAC key and last block */
+}
+nu_sha_context;
+
+void nu_sha_init(nu_sha_context *ctx);
+void nu_sha_free(nu_sha_context *ctx);
+
+/**
+ * \brief          Clone a digest context
+ *
+ *                 See above for contexts that already streamed data.
+ */
+void nu_sha_clone(nu_sha_context *dst, const nu_sha_context *src);
+
+/**
+ * \brief          Start a digest
+ *
+ * \param ctx      Context to use, a running digest is abandoned
+ * \param alg      NU_SHA_xxx or NU_SHA3_xxx
+ *
+ * \return         0 if successful, MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED
+ *                 for an unknown \p alg
+ */
+int nu_sha_starts(nu_sha_context *ctx, int alg);
+
+/**
+ * \brief          Start an HMAC with a key from memory
+ *
+ *                 Keys longer than the block size are hashed first, as
+ *                 RFC 2104 requires.
+ *
+ * \param ctx      Context to use, a running digest is abandoned
+ * \param alg      Underlying hash, NU_SHA_xxx or NU_SHA3_xxx
+ * \param key      HMAC key
+ * \param keylen   Key length in bytes
+ *
+ * \return         0 if successful, or a platform error code
+ */
+int nu_hmac_starts(nu_sha_context *ctx, int alg, const unsigned char *key,
+				   size_t keylen);
+
+/**
+ * \brief          Start an HMAC with a key in the TSI Key Store
+ *
+ *                 The key is a KS_META_HMAC key no longer than the block
+ *                 size of \p alg (KS_META_512 for SHA-1/224/256 and SHA-3,
+ *                 KS_META_1024 for SHA-384 and SHA-512), zero padded, each
+ *                 word big-endian.
+ *
+ * \param ctx      Context to use, a running digest is abandoned
+ * \param alg      Underlying hash
+ * \param mem      KS_SRAM or KS_OTP
+ * \param knum     Key number in \p mem
+ *
+ * \return         0 if successful, or a platform error code
+ */
+int nu_hmac_starts_ks(nu_sha_context *ctx, int alg, int mem, int knum);
+
+/**
+ * \brief          Feed message data
+ *
+ * \return         0 if successful, MBEDTLS_ERR_PLATFORM_HW_ACCEL_FAILED if
+ *                 the TSI failed, or the error that ended the digest before
+ */
+int nu_sha_update(nu_sha_context *ctx, const unsigned char *input, size_t ilen);
+
+/**
+ * \brief          Finish the digest and close its TSI session
+ *
+ * \param output   nu_sha_size() bytes of digest or MAC
+ *
+ * \return         0 if successful, or an error as nu_sha_update().
+ *                 MBEDTLS_ERR_PLATFORM_FEATURE_UNSUPPORTED for an empty
+ *                 message under a Key Store key, which would leave
+ *                 TSI_SHA_Finish() without data.
+ */
+int nu_sha_finish(nu_sha_context *ctx, unsigned char *output);
+
+/**
+ * \brief          Digest or MAC size in bytes, 0 for an unknown \p alg
+ */
+size_t nu_sha_size(int alg);
+
+/**
+ * \brief          Block size in bytes, 0 for an unknown \p alg
+ */
+size_t nu_sha_block_size(int alg);
+
+/**
+ * \brief          One-shot digest
+ *
+ *                 A word aligned input the TSI can reach is hashed in place
+ *                 with a single TSI command.
+ */
+int nu_sha(int alg, const unsigned char *input, size_t ilen,
+		   unsigned char *output);
+
+/**
+ * \brief          One-shot HMAC
+ */
+int nu_hmac(int alg, const unsigned char *key, size_t keylen,
+			const unsigned char *input, size_t ilen, unsigned char *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBEDTLS_SHA_ALT_H */
@@ -128,10 +128,18 @@ extern "C"
 #define ST_KS_FULL              0x81   /*!< Key Store full */
 #define ST_WHC_TX_BUSY          0xd1   /*!< All TX channel of Wormhole are busy */
 #define ST_CMD_ACK_TIME_OUT     0xd2   /*!< TSI MA35D1es not ack command in time limit */
+#define ST_REQ_PENDING          0xd3   /*!< Asynchronous request not completed yet */
+
+#define TSI_ASYNC_MAX           4      /*!< Requests in flight at a time, one per WHC1 channel */
 
 /// @cond HIDDEN_SYMBOLS
 
 /*!< TSI command request */
+struct tsi_cmd_t;
+
+/*!< Completion callback of an asynchronous request, see TSI_Submit() */
+typedef void (*TSI_CALLBACK_T)(struct tsi_cmd_t *req, void *arg);
+
 typedef struct tsi_cmd_t
 {
     uint32_t    cmd[4];      /*!< TSI command words */
@@ -143,6 +151,9 @@ typedef struct tsi_cmd_t
     uint32_t    caddr_src;   /*!< current data source address */
     uint32_t    caddr_dst;   /*!< current data destination address */
     uint32_t    remain_len;  /*!< remaining data length */
+    volatile int pending;    /*!< set while the request is in flight */
+    TSI_CALLBACK_T callback; /*!< completion callback, may be NULL */
+    void        *cb_arg;     /*!< argument of the completion callback */
 }  TSI_REQ_T;
 
 #define TC_GET_CLASS_CODE(r)    ((((r)->cmd[0])>>24)&0xff)
@@ -231,6 +242,34 @@ int TSI_ECC_VerifySignature(E_ECC_CURVE curve_id, int psel, int x_knum, int y_kn
 int TSI_ECC_Multiply(E_ECC_CURVE curve_id, int type, int msel, int sps, int m_knum, int x_knum, int y_knum, uint32_t param_addr, uint32_t dest_addr);
 int TSI_RSA_Exp_Mod(int rsa_len, int crt, int esel, int e_knum, uint32_t param_addr, uint32_t dest_addr);
 
+void TSI_Lock(void);
+void TSI_Unlock(void);
+int TSI_Submit(TSI_REQ_T *req, TSI_CALLBACK_T callback, void *arg);
+int TSI_Poll(void);
+int TSI_Req_Status(TSI_REQ_T *req);
+int TSI_Wait(TSI_REQ_T *req, int time_out);
+uint32_t TSI_Get_Cmd_Count(void);
+int TSI_TRNG_Gen_Random_Async(TSI_REQ_T *req, uint32_t wcnt, uint32_t dest_addr,
+                              TSI_CALLBACK_T callback, void *arg);
+int TSI_AES_Run_Async(TSI_REQ_T *req, int sid, int is_last, int data_cnt, uint32_t src_addr,
+                      uint32_t dest_addr, TSI_CALLBACK_T callback, void *arg);
+int TSI_AES_GCM_Run_Async(TSI_REQ_T *req, int sid, int is_last, int data_cnt, uint32_t param_addr,
+                          TSI_CALLBACK_T callback, void *arg);
+int TSI_SHA_Update_Async(TSI_REQ_T *req, int sid, int data_cnt, uint32_t src_addr,
+                         TSI_CALLBACK_T callback, void *arg);
+int TSI_ECC_GenSignature_Async(TSI_REQ_T *req, E_ECC_CURVE curve_id, int rsel, int psel, int key_idx,
+                               uint32_t param_addr, uint32_t sig_addr, TSI_CALLBACK_T callback, void *arg);
+int TSI_ECC_VerifySignature_Async(TSI_REQ_T *req, E_ECC_CURVE curve_id, int psel, int x_knum, int y_knum,
+                                  uint32_t param_addr, TSI_CALLBACK_T callback, void *arg);
+int TSI_ECC_Multiply_Async(TSI_REQ_T *req, E_ECC_CURVE curve_id, int type, int msel, int sps, int m_knum,
+                           int x_knum, int y_knum, uint32_t param_addr, uint32_t dest_addr,
+                           TSI_CALLBACK_T callback, void *arg);
+int TSI_RSA_Exp_Mod_Async(TSI_REQ_T *req, int rsa_len, int crt, int esel, int e_knum, uint32_t param_addr,
+                          uint32_t dest_addr, TSI_CALLBACK_T callback, void *arg);
+#if defined(TSI_USE_FREERTOS)
+void TSI_Notify_Task(TSI_REQ_T *req, void *task);
+#endif
+
 int TSI_KS_Write_SRAM(uint32_t u32Meta, uint32_t au32Key[], int *iKeyNum);
 int TSI_KS_Write_OTP(int KeyNum, uint32_t u32Meta, uint32_t au32Key[]);
 int TSI_KS_Read(KS_MEM_Type eType, int32_t i32KeyIdx, uint32_t au32Key[], uint32_t u32WordCnt);
@@ -10,6 +10,10 @@
 #include "MA35D1.h"
 #include "whc.h"
 #include "tsi_cmd.h"
+#if defined(TSI_USE_FREERTOS)
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
 
 /** @addtogroup Standard_Driver Standard Driver
   @{
@@ -58,151 +62,355 @@ ERR_CODE_T  _err_code_tbl[] =
 	ST_KS_FULL,               "ST_KS_FULL",
 	ST_WHC_TX_BUSY,           "ST_WHC_TX_BUSY",
 	ST_CMD_ACK_TIME_OUT,      "ST_CMD_ACK_TIME_OUT",
+	ST_REQ_PENDING,           "ST_REQ_PENDING",
 };
 
+/*
+ * Requests in flight, oldest first. An ACK carries the class code, sub-code
+ * and session ID of its command (TCK_CHR_MASK) and the TSI completes
+ * commands in order, so an ACK belongs to the oldest request in flight with
+ * the same characteristic.
+ */
+static TSI_REQ_T  *_inflight[TSI_ASYNC_MAX];
+static volatile int  _inflight_cnt;
+static uint32_t  _cmd_count;          /* commands sent, see TSI_Get_Cmd_Count() */
+
 #ifdef USE_IRQ
 
-static volatile int  whc1_irq;
+/* The ACK dispatch runs in WRHO1_IRQHandler, mask it around list updates */
+#define TSI_LOCK()      IRQ_Disable(WRHO1_IRQn)
+#define TSI_UNLOCK()    IRQ_Enable(WRHO1_IRQn)
+
+#else
+
+/* Tasks submitting and polling at once exclude each other, see TSI_Lock() */
+#define TSI_LOCK()      TSI_Lock()
+#define TSI_UNLOCK()    TSI_Unlock()
+
+#endif
 
-static void set_whc1_irq_flag(int val)
+static uint32_t get_time(void)
 {
-	isb();
-	whc1_irq = val;
-	isb();
+	return EL0_GetCurrentPhysicalValue() / 12000;
 }
 
-static int get_whc1_irq_flag(void)
+static void tsi_inflight_remove(int idx)
 {
-	isb();
-	return whc1_irq;
+	for ( ; idx < _inflight_cnt - 1; idx++)
+		_inflight[idx] = _inflight[idx + 1];
+	_inflight_cnt--;
 }
 
-void WRHO1_IRQHandler(void)
+/*
+ * Move the ACKs in the RX channels to their requests and release the
+ * channels. Completed requests are returned in done[] for the callbacks,
+ * which run after the list update. Caller holds TSI_LOCK or is the ISR.
+ */
+static int tsi_collect_acks(TSI_REQ_T *done[TSI_ASYNC_MAX])
 {
+	TSI_REQ_T  *req;
+	uint32_t   ack[4], rel = 0;
+	int        i, j, n = 0;
+
+	for (i = 0; i < 4; i++)
+	{
+		if (!(WHC1->RXSTS & (1 << i)))      /* Check CHxRDY */
+			continue;
+		for (j = 0; j < 4; j++)
+			ack[j] = WHC1->RMDAT[i][j];
+		rel |= (1 << i);
+		// sysprintf("[%d] ACK: 0x%x 0x%x 0x%x 0x%x\n", get_time(), ack[0], ack[1], ack[2], ack[3]);
+
+		for (j = 0; j < _inflight_cnt; j++)
+		{
+			if ((_inflight[j]->cmd[0] & TCK_CHR_MASK) == (ack[0] & TCK_CHR_MASK))
+				break;
+		}
+		if (j >= _inflight_cnt)
+			continue;                       /* ACK of a recalled command */
+
+		req = _inflight[j];
+		tsi_inflight_remove(j);
+		memcpy(req->ack, ack, sizeof(ack));
+		req->pending = 0;
+		done[n++] = req;
+	}
+	if (rel)
+		WHC1->RXCTL = rel;                  /* set CHxACK */
+	return n;
+}
+
+static void tsi_run_callbacks(TSI_REQ_T *done[], int n)
+{
+	TSI_CALLBACK_T  cb;
 	int  i;
+
+	for (i = 0; i < n; i++)
+	{
+		cb = done[i]->callback;
+		if (cb != NULL)
+			cb(done[i], done[i]->cb_arg);
+	}
+}
+
+#ifdef USE_IRQ
+
+void WRHO1_IRQHandler(void)
+{
+	TSI_REQ_T  *done[TSI_ASYNC_MAX];
 	uint32_t  intsts;
 
 	intsts = WHC1->INTSTS;
+	WHC1->INTSTS = 0x0f00003f;
 
 	if (intsts & (WHC_INTSTS_RX3IF_Msk | WHC_INTSTS_RX2IF_Msk |
 		WHC_INTSTS_RX1IF_Msk | WHC_INTSTS_RX0IF_Msk))
 	{
-		set_whc1_irq_flag(1);
+		tsi_run_callbacks(done, tsi_collect_acks(done));
 	}
-	WHC1->INTSTS = 0x0f00003f;
 }
 
-#else
+#endif
 
-static void set_whc1_irq_flag(int val) {}
+/// @endcond HIDDEN_SYMBOLS
 
-static int get_whc1_irq_flag(void)
-{
-	if (WHC1->RXSTS & 0xf)
-		return 1;
-	else
-		return 0;
-}
+#ifndef USE_IRQ
 
+/**
+  * @brief    Enter the section that updates the requests in flight and the
+  *           WHC1 channels. Without USE_IRQ, TSI_Submit(), TSI_Poll() and
+  *           TSI_Wait() may run in several tasks at once. The default keeps
+  *           the other FreeRTOS tasks out with TSI_USE_FREERTOS and does
+  *           nothing on bare metal. Another RTOS overrides TSI_Lock() and
+  *           TSI_Unlock() with its own mutex. The section never nests and
+  *           never blocks.
+  */
+__attribute__ ((weak)) void TSI_Lock(void)
+{
+#if defined(TSI_USE_FREERTOS)
+	vTaskSuspendAll();
 #endif
+}
 
-static uint32_t get_time(void)
+/**
+  * @brief    Leave the section entered by TSI_Lock().
+  */
+__attribute__ ((weak)) void TSI_Unlock(void)
 {
-	return EL0_GetCurrentPhysicalValue() / 12000;
+#if defined(TSI_USE_FREERTOS)
+	(void)xTaskResumeAll();
+#endif
 }
 
-int tsi_wait_ack(TSI_REQ_T *req, int time_out)
+#endif
+
+/**
+  * @brief    Send a TSI command without waiting for its completion.
+  * @param[in]  req        Request with the command words in cmd[]. It is the
+  *                        handle of the command until it completes and must
+  *                        stay valid until then.
+  * @param[in]  callback   Called with \p req and \p arg on completion, may be
+  *                        NULL. It runs in WRHO1_IRQHandler with USE_IRQ,
+  *                        otherwise in TSI_Poll() or TSI_Wait().
+  * @param[in]  arg        Argument of \p callback
+  * @return   0                 success
+  * @return   ST_WHC_TX_BUSY    TSI_ASYNC_MAX requests are in flight or no
+  *                             WHC1 channel is free, TSI_Poll() and retry
+  */
+int TSI_Submit(TSI_REQ_T *req, TSI_CALLBACK_T callback, void *arg)
 {
 	int        i;
-	uint64_t   t0;
 
-	t0 = EL0_GetCurrentPhysicalValue();
-	while (!get_whc1_irq_flag())
+	TSI_LOCK();
+	if (_inflight_cnt >= TSI_ASYNC_MAX)
 	{
-		if (time_out && (EL0_GetCurrentPhysicalValue() - t0 > (time_out * 12000)))
-		{
-			/* command time-out, recall message */
-			WHC1->TXCTL = (1<<(16+req->tx_channel));
-			return ST_CMD_ACK_TIME_OUT;
-		}
-	}
-	for (i = 0; i < 4; i++)
-	{
-		if (WHC1->RXSTS & (1 << i))         /* Check CHxRDY */
-		{
-			if ((WHC1->RMDAT[i][0] & TCK_CHR_MASK) == (req->cmd[0] & TCK_CHR_MASK))
-			{
-				req->ack[0] = WHC1->RMDAT[i][0];
-				req->ack[1] = WHC1->RMDAT[i][1];
-				req->ack[2] = WHC1->RMDAT[i][2];
-				req->ack[3] = WHC1->RMDAT[i][3];
-				WHC1->RXCTL = (1 << i);     /* set CHxACK */
-				// sysprintf("[%d] ACK: 0x%x 0x%x 0x%x 0x%x\n", get_time(), req->ack[0], req->ack[1], req->ack[2], req->ack[3]);
-				return 0;
-			}
-			else
-			{
-				req->ack[0] = WHC1->RMDAT[i][0];
-				req->ack[1] = WHC1->RMDAT[i][1];
-				req->ack[2] = WHC1->RMDAT[i][2];
-				req->ack[3] = WHC1->RMDAT[i][3];
-				// sysprintf("[%d] [%d] INVALID ACK: 0x%x 0x%x 0x%x 0x%x\n", get_time(), i, req->ack[0], req->ack[1], req->ack[2], req->ack[3]);
-				WHC1->RXCTL = (1 << i);     /* set CHxACK */
-				return 0;
-			}
-		}
+		TSI_UNLOCK();
+		return ST_WHC_TX_BUSY;
 	}
-	sysprintf("tsi_wait_ack - error, irq occurred, but ack not received!!\n");
-}
-
-int tsi_send_command(TSI_REQ_T *req)
-{
-	int        i;
-
 	for (i = 0; i < 4; i++)
 	{
 		if (WHC1->TXSTS & (1<<i))      /* Check CHxRDY */
 			break;
 	}
 	if (i >= 4)
+	{
+		TSI_UNLOCK();
 		return ST_WHC_TX_BUSY;         /* No WHC channel is ready for sending message */
+	}
 
 	// sysprintf("[%d] CMD: 0x%x 0x%x 0x%x 0x%x\n", get_time(), req->cmd[0], req->cmd[1], req->cmd[2], req->cmd[3]);
 
+	req->callback = callback;
+	req->cb_arg = arg;
+	req->pending = 1;
+	req->tx_channel = i;
+	req->tx_jiffy = EL0_GetCurrentPhysicalValue();
+	memset(req->ack, 0, sizeof(req->ack));
+	_inflight[_inflight_cnt++] = req;
+
 	WHC1->TMDAT[i][0] = req->cmd[0];
 	WHC1->TMDAT[i][1] = req->cmd[1];
 	WHC1->TMDAT[i][2] = req->cmd[2];
 	WHC1->TMDAT[i][3] = req->cmd[3];
-
-	set_whc1_irq_flag(0);
 	WHC1->TXCTL = (1 << i);            /* send message */
-	req->tx_channel = i;
-	req->tx_jiffy = EL0_GetCurrentPhysicalValue();
+	_cmd_count++;
+	TSI_UNLOCK();
+	return 0;
+}
+
+/**
+  * @brief    Complete the requests whose ACK has arrived.
+  *           Only needed without USE_IRQ, where it also runs the callbacks.
+  * @return   Number of requests still in flight
+  */
+int TSI_Poll(void)
+{
+	TSI_REQ_T  *done[TSI_ASYNC_MAX];
+	int  n;
+
+	TSI_LOCK();
+	n = tsi_collect_acks(done);
+	TSI_UNLOCK();
+	tsi_run_callbacks(done, n);
+	return _inflight_cnt;
+}
+
+/**
+  * @brief    Status of an asynchronous request.
+  * @param[in]  req        Request passed to TSI_Submit()
+  * @return   ST_REQ_PENDING    in flight
+  * @return   otherwise         status from the TSI ACK
+  */
+int TSI_Req_Status(TSI_REQ_T *req)
+{
+	if (req->pending)
+		return ST_REQ_PENDING;
+	return TA_GET_STATUS(req);
+}
+
+/**
+  * @brief    Wait for an asynchronous request to complete.
+  * @param[in]  req        Request passed to TSI_Submit()
+  * @param[in]  time_out   Time-out in ms, 0 waits forever
+  * @return   ST_CMD_ACK_TIME_OUT   no ACK in time, the request was recalled
+  * @return   otherwise             status from the TSI ACK
+  */
+int TSI_Wait(TSI_REQ_T *req, int time_out)
+{
+	uint64_t   t0, t1;
+	int        i;
+
+	t0 = EL0_GetCurrentPhysicalValue();
+	while (req->pending)
+	{
+#ifndef USE_IRQ
+		TSI_Poll();
+#endif
+		t1 = EL0_GetCurrentPhysicalValue();
+		if (time_out && req->pending && (t1 - t0 > (time_out * 12000)))
+		{
+			TSI_LOCK();
+			for (i = 0; i < _inflight_cnt; i++)
+			{
+				if (_inflight[i] == req)
+				{
+					/* command time-out, recall message */
+					WHC1->TXCTL = (1<<(16+req->tx_channel));
+					tsi_inflight_remove(i);
+					req->ack[0] = (req->cmd[0] & TCK_CHR_MASK) | (ST_CMD_ACK_TIME_OUT << 8);
+					req->pending = 0;
+					break;
+				}
+			}
+			TSI_UNLOCK();
+		}
+	}
+	return TA_GET_STATUS(req);
+}
+
+/**
+  * @brief    Number of commands sent to the TSI since boot, synchronous and
+  *           asynchronous. Each one is a mailbox round trip.
+  * @return   Command count, wraps at 2^32
+  */
+uint32_t TSI_Get_Cmd_Count(void)
+{
+	return _cmd_count;
+}
+
+/// @cond HIDDEN_SYMBOLS
+
+int tsi_wait_ack(TSI_REQ_T *req, int time_out)
+{
+	if (TSI_Wait(req, time_out) == ST_CMD_ACK_TIME_OUT)
+		return ST_CMD_ACK_TIME_OUT;
 	return 0;
 }
 
+int tsi_send_command(TSI_REQ_T *req)
+{
+	return TSI_Submit(req, NULL, NULL);
+}
+
+/* Send and wait, time_out in ms for getting a channel and again for the ACK, 0 waits forever */
 int tsi_send_command_and_wait(TSI_REQ_T *req, int time_out)
 {
+	uint64_t   t0;
 	int  ret;
 
-	ret = tsi_send_command(req);
-	if (ret != 0)
-		return ret;
-
-	ret = tsi_wait_ack(req, time_out);
+	/* Asynchronous requests may hold all channels for a while */
+	t0 = EL0_GetCurrentPhysicalValue();
+	while ((ret = TSI_Submit(req, NULL, NULL)) == ST_WHC_TX_BUSY)
+	{
+		TSI_Poll();
+		if (time_out && (EL0_GetCurrentPhysicalValue() - t0 > (time_out * 12000)))
+			return ret;
+	}
 	if (ret != 0)
 		return ret;
 
-	return TA_GET_STATUS(req);
+	return TSI_Wait(req, time_out);
 }
 
 int tsi_clear_rx_data(void)
 {
-	TSI_REQ_T  req;
+	uint64_t   t0;
 
-	while (tsi_wait_ack(&req, 2) != ST_CMD_ACK_TIME_OUT);
+	/* Drop the ACKs of recalled commands until the mailbox is quiet for 2 ms */
+	t0 = EL0_GetCurrentPhysicalValue();
+	while (EL0_GetCurrentPhysicalValue() - t0 < 2 * 12000)
+	{
+		if (WHC1->RXSTS & 0xf)
+		{
+			TSI_Poll();
+			t0 = EL0_GetCurrentPhysicalValue();
+		}
+	}
+	return 0;
 }
 
+#if defined(TSI_USE_FREERTOS)
+
+/**
+  * @brief    TSI_CALLBACK_T giving a FreeRTOS direct to task notification.
+  * @param[in]  req        Completed request
+  * @param[in]  task       TaskHandle_t of the task to notify, which waits with
+  *                        ulTaskNotifyTake() and then reads TSI_Req_Status()
+  */
+void TSI_Notify_Task(TSI_REQ_T *req, void *task)
+{
+#ifdef USE_IRQ
+	BaseType_t  woken = pdFALSE;
+
+	vTaskNotifyGiveFromISR((TaskHandle_t)task, &woken);
+	portYIELD_FROM_ISR(woken);
+#else
+	xTaskNotifyGive((TaskHandle_t)task);
+#endif
+}
+
+#endif
+
 /// @endcond HIDDEN_SYMBOLS
 
 /**
@@ -458,6 +666,16 @@ int TSI_TRNG_Init(int method, uint32_t pb_addr)
 	return ret;
 }
 
+/// @cond HIDDEN_SYMBOLS
+static void tsi_trng_gen_req(TSI_REQ_T *req, uint32_t wcnt, uint32_t dest_addr)
+{
+	memset(req, 0, sizeof(*req));
+	req->cmd[0] = (CMD_TRNG_GEN_RANDOM << 16);
+	req->cmd[2] = wcnt;
+	req->cmd[3] = dest_addr;
+}
+/// @endcond HIDDEN_SYMBOLS
+
 /**
   * @brief    Request TRNG to generate random numbers.
   * @param[in]  wcnt          Word count of random numbers
@@ -469,13 +687,22 @@ int TSI_TRNG_Gen_Random(uint32_t wcnt, uint32_t dest_addr)
 {
 	TSI_REQ_T  req;
 
-	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (CMD_TRNG_GEN_RANDOM << 16);
-	req.cmd[2] = wcnt;
-	req.cmd[3] = dest_addr;
+	tsi_trng_gen_req(&req, wcnt, dest_addr);
 	return tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 }
 
+/**
+  * @brief    Asynchronous TSI_TRNG_Gen_Random(), see TSI_Submit().
+  * @return   0               submitted
+  * @return   otherwise       error code from TSI_Submit()
+  */
+int TSI_TRNG_Gen_Random_Async(TSI_REQ_T *req, uint32_t wcnt, uint32_t dest_addr,
+			TSI_CALLBACK_T callback, void *arg)
+{
+	tsi_trng_gen_req(req, wcnt, dest_addr);
+	return TSI_Submit(req, callback, arg);
+}
+
 
 /**
   * @brief    PRNG re-seed
@@ -688,6 +915,17 @@ int TSI_AES_Set_Key(int sid, int keysz, uint32_t key_addr)
 	return tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 }
 
+/// @cond HIDDEN_SYMBOLS
+static void tsi_aes_run_req(TSI_REQ_T *req, int sid, int is_last, int data_cnt, uint32_t src_addr, uint32_t dest_addr)
+{
+	memset(req, 0, sizeof(*req));
+	req->cmd[0] = (CMD_AES_RUN << 16) | sid;
+	req->cmd[1] = (is_last << 24) | data_cnt;
+	req->cmd[2] = src_addr;
+	req->cmd[3] = dest_addr;
+}
+/// @endcond HIDDEN_SYMBOLS
+
 /**
   * @brief    Start AES encrypt/decrypt.
   * @param[in]  sid           The session ID obtained from TSI_Open_Session().
@@ -706,14 +944,32 @@ int TSI_AES_Run(int sid, int is_last, int data_cnt, uint32_t src_addr, uint32_t
 {
 	TSI_REQ_T  req;
 
-	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (CMD_AES_RUN << 16) | sid;
-	req.cmd[1] = (is_last << 24) | data_cnt;
-	req.cmd[2] = src_addr;
-	req.cmd[3] = dest_addr;
+	tsi_aes_run_req(&req, sid, is_last, data_cnt, src_addr, dest_addr);
 	return tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 }
 
+/**
+  * @brief    Asynchronous TSI_AES_Run(), see TSI_Submit().
+  * @return   0               submitted
+  * @return   otherwise       error code from TSI_Submit()
+  */
+int TSI_AES_Run_Async(TSI_REQ_T *req, int sid, int is_last, int data_cnt, uint32_t src_addr, uint32_t dest_addr,
+			TSI_CALLBACK_T callback, void *arg)
+{
+	tsi_aes_run_req(req, sid, is_last, data_cnt, src_addr, dest_addr);
+	return TSI_Submit(req, callback, arg);
+}
+
+/// @cond HIDDEN_SYMBOLS
+static void tsi_aes_gcm_run_req(TSI_REQ_T *req, int sid, int is_last, int data_cnt, uint32_t param_addr)
+{
+	memset(req, 0, sizeof(*req));
+	req->cmd[0] = (CMD_AES_GCM_RUN << 16) | sid;
+	req->cmd[1] = (is_last << 24) | data_cnt;
+	req->cmd[2] = param_addr;
+}
+/// @endcond HIDDEN_SYMBOLS
+
 /**
   * @brief    Start AES GCM mode encrypt/decrypt.
   * @param[in]  sid           The session ID obtained from TSI_Open_Session().
@@ -731,13 +987,22 @@ int TSI_AES_GCM_Run(int sid, int is_last, int data_cnt, uint32_t param_addr)
 {
 	TSI_REQ_T  req;
 
-	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (CMD_AES_GCM_RUN << 16) | sid;
-	req.cmd[1] = (is_last << 24) | data_cnt;
-	req.cmd[2] = param_addr;
+	tsi_aes_gcm_run_req(&req, sid, is_last, data_cnt, param_addr);
 	return tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 }
 
+/**
+  * @brief    Asynchronous TSI_AES_GCM_Run(), see TSI_Submit().
+  * @return   0               submitted
+  * @return   otherwise       error code from TSI_Submit()
+  */
+int TSI_AES_GCM_Run_Async(TSI_REQ_T *req, int sid, int is_last, int data_cnt, uint32_t param_addr,
+			TSI_CALLBACK_T callback, void *arg)
+{
+	tsi_aes_gcm_run_req(req, sid, is_last, data_cnt, param_addr);
+	return TSI_Submit(req, callback, arg);
+}
+
 /**
   * @brief    Read or write AES/SM4 intermediate feedback data.
   * @param[in]  sid           The session ID obtained from TSI_Open_Session().
@@ -797,7 +1062,7 @@ int TSI_SHA_Start(int sid, int inswap, int outswap, int mode_sel, int hmac,
 	TSI_REQ_T  req;
 
 	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (CMD_EXT_SHA_START << 16) | sid;
+	req.cmd[0] = ((uint32_t)CMD_EXT_SHA_START << 16) | sid;
 	req.cmd[1] = (inswap << 23) | (outswap << 22) | (0x1 << 20) | (mode_sel << 12) |
 				 (hmac << 11) | (mode << 8);
 	req.cmd[2] = keylen;
@@ -805,6 +1070,16 @@ int TSI_SHA_Start(int sid, int inswap, int outswap, int mode_sel, int hmac,
 	return tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 }
 
+/// @cond HIDDEN_SYMBOLS
+static void tsi_sha_update_req(TSI_REQ_T *req, int sid, int data_cnt, uint32_t src_addr)
+{
+	memset(req, 0, sizeof(*req));
+	req->cmd[0] = ((uint32_t)CMD_EXT_SHA_UPDATE << 16) | sid;
+	req->cmd[1] = data_cnt;
+	req->cmd[2] = src_addr;
+}
+/// @endcond HIDDEN_SYMBOLS
+
 /**
   * @brief    Update SHA data.
   * @param[in]  sid           The session ID obtained from TSI_Open_Session().
@@ -817,13 +1092,22 @@ int TSI_SHA_Update(int sid, int data_cnt, uint32_t src_addr)
 {
 	TSI_REQ_T  req;
 
-	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (CMD_EXT_SHA_UPDATE << 16) | sid;
-	req.cmd[1] = data_cnt;
-	req.cmd[2] = src_addr;
+	tsi_sha_update_req(&req, sid, data_cnt, src_addr);
 	return tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 }
 
+/**
+  * @brief    Asynchronous TSI_SHA_Update(), see TSI_Submit().
+  * @return   0               submitted
+  * @return   otherwise       error code from TSI_Submit()
+  */
+int TSI_SHA_Update_Async(TSI_REQ_T *req, int sid, int data_cnt, uint32_t src_addr,
+			TSI_CALLBACK_T callback, void *arg)
+{
+	tsi_sha_update_req(req, sid, data_cnt, src_addr);
+	return TSI_Submit(req, callback, arg);
+}
+
 
 /**
   * @brief    Update the last block of data and get result digest.
@@ -840,7 +1124,7 @@ int TSI_SHA_Finish(int sid, int wcnt, int data_cnt, uint32_t src_addr, uint32_t
 	TSI_REQ_T  req;
 
 	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (CMD_EXT_SHA_FINISH << 16) | sid;
+	req.cmd[0] = ((uint32_t)CMD_EXT_SHA_FINISH << 16) | sid;
 	req.cmd[1] = (wcnt << 24) | data_cnt;
 	req.cmd[2] = src_addr;
 	req.cmd[3] = dest_addr;
@@ -881,7 +1165,7 @@ int TSI_SHA_All_At_Once(int inswap, int outswap, int mode_sel, int mode,
 
 	memset(&req, 0, sizeof(req));
 	req.cmd[0] = (CMD_SHA_ALL_AT_ONCE << 16) | ((data_cnt >> 8) & 0xffff);
-	req.cmd[1] = ((data_cnt & 0xff) << 24) | (inswap << 23) | (outswap << 22) |
+	req.cmd[1] = ((uint32_t)(data_cnt & 0xff) << 24) | (inswap << 23) | (outswap << 22) |
 				 (mode_sel << 12) | (mode << 8) | wcnt;
 	req.cmd[2] = src_addr;
 	req.cmd[3] = dest_addr;
@@ -917,6 +1201,17 @@ int TSI_ECC_GenPublicKey(E_ECC_CURVE curve_id, int is_ecdh, int psel, int d_knum
 	return tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 }
 
+/// @cond HIDDEN_SYMBOLS
+static void tsi_ecc_gen_sig_req(TSI_REQ_T *req, E_ECC_CURVE curve_id, int rsel, int psel, int d_knum, uint32_t param_addr, uint32_t sig_addr)
+{
+	memset(req, 0, sizeof(*req));
+	req->cmd[0] = (CMD_ECC_GEN_SIG << 16) | curve_id;
+	req->cmd[1] = (rsel << 10) | (psel << 8) | d_knum;
+	req->cmd[2] = param_addr;
+	req->cmd[3] = sig_addr;
+}
+/// @endcond HIDDEN_SYMBOLS
+
 /**
   * @brief    Generate an ECC signature.
   * @param[in]  curve_id      ECC curve ID
@@ -938,14 +1233,32 @@ int TSI_ECC_GenSignature(E_ECC_CURVE curve_id, int rsel, int psel, int d_knum, u
 {
 	TSI_REQ_T  req;
 
-	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (CMD_ECC_GEN_SIG << 16) | curve_id;
-	req.cmd[1] = (rsel << 10) | (psel << 8) | d_knum;
-	req.cmd[2] = param_addr;
-	req.cmd[3] = sig_addr;
+	tsi_ecc_gen_sig_req(&req, curve_id, rsel, psel, d_knum, param_addr, sig_addr);
 	return tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 }
 
+/**
+  * @brief    Asynchronous TSI_ECC_GenSignature(), see TSI_Submit().
+  * @return   0               submitted
+  * @return   otherwise       error code from TSI_Submit()
+  */
+int TSI_ECC_GenSignature_Async(TSI_REQ_T *req, E_ECC_CURVE curve_id, int rsel, int psel, int d_knum, uint32_t param_addr, uint32_t sig_addr,
+			TSI_CALLBACK_T callback, void *arg)
+{
+	tsi_ecc_gen_sig_req(req, curve_id, rsel, psel, d_knum, param_addr, sig_addr);
+	return TSI_Submit(req, callback, arg);
+}
+
+/// @cond HIDDEN_SYMBOLS
+static void tsi_ecc_verify_sig_req(TSI_REQ_T *req, E_ECC_CURVE curve_id, int psel, int x_knum, int y_knum, uint32_t param_addr)
+{
+	memset(req, 0, sizeof(*req));
+	req->cmd[0] = (CMD_ECC_VERIFY_SIG << 16) | curve_id;
+	req->cmd[1] = (psel << 16) | (y_knum << 8) | x_knum;
+	req->cmd[2] = param_addr;
+}
+/// @endcond HIDDEN_SYMBOLS
+
 /**
   * @brief    Verify if an ECC signature valid or not.
   * @param[in]  curve_id      ECC curve ID
@@ -963,13 +1276,34 @@ int TSI_ECC_VerifySignature(E_ECC_CURVE curve_id, int psel, int x_knum, int y_kn
 {
 	TSI_REQ_T  req;
 
-	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (CMD_ECC_VERIFY_SIG << 16) | curve_id;
-	req.cmd[1] = (psel << 16) | (y_knum << 8) | x_knum;
-	req.cmd[2] = param_addr;
+	tsi_ecc_verify_sig_req(&req, curve_id, psel, x_knum, y_knum, param_addr);
 	return tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 }
 
+/**
+  * @brief    Asynchronous TSI_ECC_VerifySignature(), see TSI_Submit().
+  * @return   0               submitted
+  * @return   otherwise       error code from TSI_Submit()
+  */
+int TSI_ECC_VerifySignature_Async(TSI_REQ_T *req, E_ECC_CURVE curve_id, int psel, int x_knum, int y_knum, uint32_t param_addr,
+			TSI_CALLBACK_T callback, void *arg)
+{
+	tsi_ecc_verify_sig_req(req, curve_id, psel, x_knum, y_knum, param_addr);
+	return TSI_Submit(req, callback, arg);
+}
+
+/// @cond HIDDEN_SYMBOLS
+static void tsi_ecc_multiply_req(TSI_REQ_T *req, E_ECC_CURVE curve_id, int type, int msel, int sps, int m_knum, int x_knum, int y_knum, uint32_t param_addr, uint32_t dest_addr)
+{
+	memset(req, 0, sizeof(*req));
+	req->cmd[0] = (CMD_ECC_MULTIPLY << 16) | curve_id;
+	req->cmd[1] = (type << 28) | (msel << 26) | (sps << 24) | (m_knum << 16) |
+				 (x_knum << 8) | (y_knum);
+	req->cmd[2] = param_addr;
+	req->cmd[3] = dest_addr;
+}
+/// @endcond HIDDEN_SYMBOLS
+
 /**
   * @brief    Execute ECC point multiplication.
   * @param[in]  curve_id      ECC curve ID
@@ -995,15 +1329,33 @@ int TSI_ECC_Multiply(E_ECC_CURVE curve_id, int type, int msel, int sps, int m_kn
 {
 	TSI_REQ_T  req;
 
-	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (CMD_ECC_MULTIPLY << 16) | curve_id;
-	req.cmd[1] = (type << 28) | (msel << 26) | (sps << 24) | (m_knum << 16) |
-				 (x_knum << 8) | (y_knum);
-	req.cmd[2] = param_addr;
-	req.cmd[3] = dest_addr;
+	tsi_ecc_multiply_req(&req, curve_id, type, msel, sps, m_knum, x_knum, y_knum, param_addr, dest_addr);
 	return tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 }
 
+/**
+  * @brief    Asynchronous TSI_ECC_Multiply(), see TSI_Submit().
+  * @return   0               submitted
+  * @return   otherwise       error code from TSI_Submit()
+  */
+int TSI_ECC_Multiply_Async(TSI_REQ_T *req, E_ECC_CURVE curve_id, int type, int msel, int sps, int m_knum, int x_knum, int y_knum, uint32_t param_addr, uint32_t dest_addr,
+			TSI_CALLBACK_T callback, void *arg)
+{
+	tsi_ecc_multiply_req(req, curve_id, type, msel, sps, m_knum, x_knum, y_knum, param_addr, dest_addr);
+	return TSI_Submit(req, callback, arg);
+}
+
+/// @cond HIDDEN_SYMBOLS
+static void tsi_rsa_exp_mod_req(TSI_REQ_T *req, int rsa_len, int crt, int esel, int e_knum, uint32_t param_addr, uint32_t dest_addr)
+{
+	memset(req, 0, sizeof(*req));
+	req->cmd[0] = ((uint32_t)CMD_EXT_RSA_EXP_MOD << 16) | rsa_len;
+	req->cmd[1] = (crt<<10) | (esel<<8) | e_knum;
+	req->cmd[2] = param_addr;
+	req->cmd[3] = dest_addr;
+}
+/// @endcond HIDDEN_SYMBOLS
+
 /**
   * @brief    Execute RSA exponent modulus.
   * @param[in]  rsa_len       RSA bit length
@@ -1026,14 +1378,22 @@ int TSI_RSA_Exp_Mod(int rsa_len, int crt, int esel, int e_knum, uint32_t param_a
 {
 	TSI_REQ_T  req;
 
-	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (CMD_EXT_RSA_EXP_MOD << 16) | rsa_len;
-	req.cmd[1] = (crt<<10) | (esel<<8) | e_knum;
-	req.cmd[2] = param_addr;
-	req.cmd[3] = dest_addr;
+	tsi_rsa_exp_mod_req(&req, rsa_len, crt, esel, e_knum, param_addr, dest_addr);
 	return tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 }
 
+/**
+  * @brief    Asynchronous TSI_RSA_Exp_Mod(), see TSI_Submit().
+  * @return   0               submitted
+  * @return   otherwise       error code from TSI_Submit()
+  */
+int TSI_RSA_Exp_Mod_Async(TSI_REQ_T *req, int rsa_len, int crt, int esel, int e_knum, uint32_t param_addr, uint32_t dest_addr,
+			TSI_CALLBACK_T callback, void *arg)
+{
+	tsi_rsa_exp_mod_req(req, rsa_len, crt, esel, e_knum, param_addr, dest_addr);
+	return TSI_Submit(req, callback, arg);
+}
+
 /**
   * @brief      Write key to key store SRAM
   * @param[in]  u32Meta     The metadata of the key. It could be the combine of
@@ -1265,7 +1625,7 @@ int  TSI_OTP_Read(uint32_t u32Addr, uint32_t *u32Data)
 	int  ret;
 
 	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (CMD_EXT_OTP_READ << 16);
+	req.cmd[0] = ((uint32_t)CMD_EXT_OTP_READ << 16);
 	req.cmd[1] = u32Addr;
 	ret = tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 	*u32Data = req.ack[1];
@@ -1285,7 +1645,7 @@ int  TSI_OTP_Program(uint32_t u32Addr, uint32_t u32Data)
 	int  ret;
 
 	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (CMD_EXT_OTP_PROGRAM << 16);
+	req.cmd[0] = ((uint32_t)CMD_EXT_OTP_PROGRAM << 16);
 	req.cmd[1] = u32Addr;
 	req.cmd[2] = u32Data;
 	ret = tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
@@ -1603,7 +1963,6 @@ int TSI_Init(void)
 	int ret;
 
 #ifdef USE_IRQ
-	set_whc1_irq_flag(0);
 	IRQ_SetHandler(WRHO1_IRQn, WRHO1_IRQHandler);
 	WHC1->INTSTS = 0xffffffff;
 	IRQ_Enable(WRHO1_IRQn);
@@ -1636,7 +1995,7 @@ int TSI_Init(void)
 	}
 
 	memset(&req, 0, sizeof(req));
-	req.cmd[0] = (0xFA01 << 16);
+	req.cmd[0] = ((uint32_t)0xFA01 << 16);
 	req.cmd[1] = 180000000;
 	ret = tsi_send_command_and_wait(&req, CMD_TIME_OUT_2S);
 	if (ret != 0)
@@ -87,6 +87,7 @@ extern "C"
 #define UMAS_ERR_CMD_STATUS         -1037  /*!< SCSI command status failed                      */
 #define UMAS_ERR_IVALID_PARM        -1038  /*!< Invalid parameter.                              */
 #define UMAS_ERR_DRIVE_NOT_FOUND    -1039  /*!< drive not found                                 */
+#define UMAS_ERR_BUSY               -1040  /*!< asynchronous command still in progress          */
 
 #define HID_RET_OK                  0      /*!< Return with no errors.                          */
 #define HID_RET_DEV_NOT_FOUND       -1081  /*!< HID device not found or removed.                */
@@ -220,6 +221,9 @@ int  usbh_umas_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
 int  usbh_umas_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
 int  usbh_umas_ioctl(int drv_no, int cmd, void *buff);
 int  usbh_umas_reset_disk(int drv_no);
+int  usbh_umas_read_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
+int  usbh_umas_write_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
+int  usbh_umas_async_poll(int drv_no);
 
 /*------------------------------------------------------------------*/
 /*                                                                  */
@@ -89,6 +89,15 @@ struct bulk_cs_wrap
 
 #define SCSI_BUFF_LEN             36
 
+/* Stages of an asynchronous (polled) Bulk-Only transaction */
+#define MSC_ASYNC_IDLE            0      /* no asynchronous command                       */
+#define MSC_ASYNC_CBW             1      /* command block wrapper in progress             */
+#define MSC_ASYNC_DATA            2      /* data stage in progress                        */
+#define MSC_ASYNC_CSW             3      /* command status wrapper in progress            */
+#define MSC_ASYNC_DONE            4      /* completed, result not yet collected           */
+
+#define MSC_ASYNC_TIMEOUT         2000   /* per-stage timeout of asynchronous command     */
+
 typedef struct msc_t
 {
     IFACE_T     *iface;
@@ -104,6 +113,13 @@ typedef struct msc_t
     uint32_t    uTotalSectorN;
     uint32_t    nSectorSize;
     uint32_t    uDiskSize;
+    UTR_T       *async_utr;              /* UTR of the asynchronous command stage         */
+    uint8_t     async_stage;             /* MSC_ASYNC_* stage of asynchronous command     */
+    uint8_t     async_dir_in;            /* asynchronous command data stage is IN         */
+    uint8_t     *async_buff;             /* data buffer of asynchronous command           */
+    uint32_t    async_len;               /* data length of asynchronous command           */
+    uint32_t    async_t0;                /* start tick of current asynchronous stage      */
+    int         async_ret;               /* result of completed asynchronous command      */
     int         drv_no;                  /* Logical drive number associated with this instance */
     FATFS       fatfs_vol;               /* FATFS volumn                                  */
     struct msc_t  *next;                 /* point to next MSC device                      */
@@ -111,6 +127,10 @@ typedef struct msc_t
 
 
 int  run_scsi_command(MSC_T *msc, uint8_t *buff, uint32_t data_len, int bIsDataIn, int timeout_ticks);
+int  run_scsi_command_async(MSC_T *msc, uint8_t *buff, uint32_t data_len, int bIsDataIn);
+int  poll_scsi_command_async(MSC_T *msc);
+void wait_scsi_command_async(MSC_T *msc);
+void quit_scsi_command_async(MSC_T *msc);
 
 
 /// @endcond
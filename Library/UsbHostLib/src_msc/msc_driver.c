@@ -251,6 +251,24 @@ static int  msc_test_unit_ready(MSC_T *msc)
     return ret;
 }
 
+static void  msc_build_rw_cmd(MSC_T *msc, uint8_t opcode, uint32_t sec_no, int sec_cnt)
+{
+    struct bulk_cb_wrap  *cmd_blk = &msc->cmd_blk;         /* MSC Bulk-only command block   */
+
+    memset(cmd_blk, 0, sizeof(*cmd_blk));
+
+    cmd_blk->Flags   = (opcode == READ_10) ? 0x80 : 0;
+    cmd_blk->Length  = 10;
+    cmd_blk->CDB[0]  = opcode;
+    cmd_blk->CDB[1]  = msc->lun << 5;
+    cmd_blk->CDB[2]  = (sec_no >> 24) & 0xFF;
+    cmd_blk->CDB[3]  = (sec_no >> 16) & 0xFF;
+    cmd_blk->CDB[4]  = (sec_no >> 8) & 0xFF;
+    cmd_blk->CDB[5]  = sec_no & 0xFF;
+    cmd_blk->CDB[7]  = (sec_cnt >> 8) & 0xFF;
+    cmd_blk->CDB[8]  = sec_cnt & 0xFF;
+}
+
 /// @endcond HIDDEN_SYMBOLS
 
 /**
@@ -269,7 +287,6 @@ static int  msc_test_unit_ready(MSC_T *msc)
 int  usbh_umas_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
 {
     MSC_T   *msc;
-    struct bulk_cb_wrap  *cmd_blk;         /* MSC Bulk-only command block   */
     int   ret;
 
     //msc_debug_msg("usbh_umas_read - %d, %d\n", sec_no, sec_cnt);
@@ -278,21 +295,10 @@ int  usbh_umas_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
     if (msc == NULL)
         return UMAS_ERR_DRIVE_NOT_FOUND;
 
-    cmd_blk = &msc->cmd_blk;
+    wait_scsi_command_async(msc);
 
     //msc_debug_msg("read sector 0x%x\n", sector_no);
-    memset(cmd_blk, 0, sizeof(*cmd_blk));
-
-    cmd_blk->Flags   = 0x80;
-    cmd_blk->Length  = 10;
-    cmd_blk->CDB[0]  = READ_10;
-    cmd_blk->CDB[1]  = msc->lun << 5;
-    cmd_blk->CDB[2]  = (sec_no >> 24) & 0xFF;
-    cmd_blk->CDB[3]  = (sec_no >> 16) & 0xFF;
-    cmd_blk->CDB[4]  = (sec_no >> 8) & 0xFF;
-    cmd_blk->CDB[5]  = sec_no & 0xFF;
-    cmd_blk->CDB[7]  = (sec_cnt >> 8) & 0xFF;
-    cmd_blk->CDB[8]  = sec_cnt & 0xFF;
+    msc_build_rw_cmd(msc, READ_10, sec_no, sec_cnt);
 
     ret = run_scsi_command(msc, buff, sec_cnt * 512, 1, 2000);
     if (ret != 0)
@@ -318,7 +324,6 @@ int  usbh_umas_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
 int  usbh_umas_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
 {
     MSC_T   *msc;
-    struct bulk_cb_wrap  *cmd_blk;         /* MSC Bulk-only command block   */
     int   ret;
 
     //msc_debug_msg("usbh_umas_write - %d, %d\n", sec_no, sec_cnt);
@@ -327,19 +332,9 @@ int  usbh_umas_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
     if (msc == NULL)
         return UMAS_ERR_DRIVE_NOT_FOUND;
 
-    cmd_blk = &msc->cmd_blk;
-    memset((uint8_t *)&(msc->cmd_blk), 0, sizeof(msc->cmd_blk));
+    wait_scsi_command_async(msc);
 
-    cmd_blk->Flags   = 0;
-    cmd_blk->Length  = 10;
-    cmd_blk->CDB[0]  = WRITE_10;
-    cmd_blk->CDB[1]  = msc->lun << 5;
-    cmd_blk->CDB[2]  = (sec_no >> 24) & 0xFF;
-    cmd_blk->CDB[3]  = (sec_no >> 16) & 0xFF;
-    cmd_blk->CDB[4]  = (sec_no >> 8) & 0xFF;
-    cmd_blk->CDB[5]  = sec_no & 0xFF;
-    cmd_blk->CDB[7]  = (sec_cnt >> 8) & 0xFF;
-    cmd_blk->CDB[8]  = sec_cnt & 0xFF;
+    msc_build_rw_cmd(msc, WRITE_10, sec_no, sec_cnt);
 
     ret = run_scsi_command(msc, buff, sec_cnt * 512, 0, 2000);
     if (ret < 0)
@@ -350,6 +345,118 @@ int  usbh_umas_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
     return 0;
 }
 
+/**
+  * @brief       Start reading a number of contiguous sectors from mass storage device
+  *              without waiting for completion. Only one asynchronous command can be
+  *              outstanding per drive. Progress is made by calling usbh_umas_async_poll().
+  *
+  * @param[in]   drv_no    FATFS drive volume number.
+  * @param[in]   sec_no    Sector number of the start sector.
+  * @param[in]   sec_cnt   Number of sectors to be read.
+  * @param[out]  buff      Memory buffer to store data read from disk.
+  *                        It must be non-cache and stay valid until the command completed.
+  * @return
+  *              - 0    Command issued
+  *              - \ref UMAS_ERR_DRIVE_NOT_FOUND   There's no mass storage device mounted to this volume.
+  *              - \ref UMAS_ERR_BUSY   The previous asynchronous command has not been collected.
+  *              - \ref UMAS_ERR_IO      Failed to issue the command.
+  */
+int  usbh_umas_read_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    MSC_T   *msc;
+    int   ret;
+
+    msc = find_msc_by_drive(drv_no);
+    if (msc == NULL)
+        return UMAS_ERR_DRIVE_NOT_FOUND;
+
+    if (msc->async_stage != MSC_ASYNC_IDLE)
+        return UMAS_ERR_BUSY;
+
+    msc_build_rw_cmd(msc, READ_10, sec_no, sec_cnt);
+
+    ret = run_scsi_command_async(msc, buff, sec_cnt * 512, 1);
+    if (ret < 0)
+    {
+        msc_debug_msg("usbh_umas_read_async failed! [%d]\n", ret);
+        return UMAS_ERR_IO;
+    }
+    return 0;
+}
+
+/**
+  * @brief       Start writing a number of contiguous sectors to mass storage device
+  *              without waiting for completion. Only one asynchronous command can be
+  *              outstanding per drive. Progress is made by calling usbh_umas_async_poll().
+  *
+  * @param[in]   drv_no    FATFS drive volume number.
+  * @param[in]   sec_no    Sector number of the start sector.
+  * @param[in]   sec_cnt   Number of sectors to be written.
+  * @param[in]   buff      Memory buffer hold the data to be written.
+  *                        It must be non-cache and stay valid until the command completed.
+  * @return
+  *              - 0    Command issued
+  *              - \ref UMAS_ERR_DRIVE_NOT_FOUND   There's no mass storage device mounted to this volume.
+  *              - \ref UMAS_ERR_BUSY   The previous asynchronous command has not been collected.
+  *              - \ref UMAS_ERR_IO      Failed to issue the command.
+  */
+int  usbh_umas_write_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+    MSC_T   *msc;
+    int   ret;
+
+    msc = find_msc_by_drive(drv_no);
+    if (msc == NULL)
+        return UMAS_ERR_DRIVE_NOT_FOUND;
+
+    if (msc->async_stage != MSC_ASYNC_IDLE)
+        return UMAS_ERR_BUSY;
+
+    msc_build_rw_cmd(msc, WRITE_10, sec_no, sec_cnt);
+
+    ret = run_scsi_command_async(msc, buff, sec_cnt * 512, 0);
+    if (ret < 0)
+    {
+        msc_debug_msg("usbh_umas_write_async failed! [%d]\n", ret);
+        return UMAS_ERR_IO;
+    }
+    return 0;
+}
+
+/**
+  * @brief       Advance the asynchronous command of a drive and collect its result
+  *              once completed. Must be called repeatedly until it returns a value
+  *              other than \ref UMAS_ERR_BUSY.
+  *
+  * @param[in]   drv_no    FATFS drive volume number.
+  * @return
+  *              - \ref UMAS_OK   Command completed successfully, or no command outstanding.
+  *              - \ref UMAS_ERR_BUSY   Command is still in progress.
+  *              - \ref UMAS_ERR_DRIVE_NOT_FOUND   There's no mass storage device mounted to this volume.
+  *              - \ref UMAS_ERR_IO      Command failed.
+  */
+int  usbh_umas_async_poll(int drv_no)
+{
+    MSC_T   *msc;
+    int   ret;
+
+    msc = find_msc_by_drive(drv_no);
+    if (msc == NULL)
+        return UMAS_ERR_DRIVE_NOT_FOUND;
+
+    ret = poll_scsi_command_async(msc);
+    if (ret == 1)
+        return UMAS_ERR_BUSY;
+
+    msc->async_stage = MSC_ASYNC_IDLE;
+    if (ret < 0)
+    {
+        msc_debug_msg("usbh_umas_async_poll - command failed! [%d]\n", ret);
+        return UMAS_ERR_IO;
+    }
+    return UMAS_OK;
+}
+
 /**
   * @brief       Get information from USB disk volume.
   *
@@ -373,6 +480,7 @@ int  usbh_umas_ioctl(int drv_no, int cmd, void *buff)
     switch (cmd)
     {
     case CTRL_SYNC:
+        wait_scsi_command_async(msc);
         return RES_OK;
 
     case GET_SECTOR_COUNT:
@@ -615,6 +723,7 @@ static void msc_disconnect(IFACE_T *iface)
         msc_p = msc->next;
         if (msc->iface == iface)
         {
+            quit_scsi_command_async(msc);
             fatfs_drive_free(msc->drv_no);
             msc_list_remove(msc);
             usbh_free_mem(msc, sizeof(*msc));
@@ -111,4 +111,162 @@ int  run_scsi_command(MSC_T *msc, uint8_t *buff, uint32_t data_len, int bIsDataI
     return do_scsi_command(msc, buff, data_len, bIsDataIn, timeout_ticks);
 }
 
+/*
+ *  Asynchronous Bulk-Only transaction.
+ *  The CBW, data and CSW stages are issued one after another by poll_scsi_command_async().
+ *  UTR completion callbacks run in interrupt context and only flag bIsTransferDone, the
+ *  next stage is always submitted from the polling caller.
+ */
+static int  async_submit_stage(MSC_T *msc, EP_INFO_T *ep, uint8_t *buff, uint32_t len, int stage)
+{
+    UTR_T   *utr = msc->async_utr;
+    int     ret;
+
+    utr->ep = ep;
+    utr->buff = buff;
+    utr->data_len = len;
+    utr->xfer_len = 0;
+    utr->func = bulk_xfer_done;
+    utr->bIsTransferDone = 0;
+
+    msc->async_stage = stage;
+    msc->async_t0 = get_ticks();
+
+    ret = usbh_bulk_xfer(utr);
+    if (ret < 0)
+        return ret;
+    return 0;
+}
+
+static void  async_finish(MSC_T *msc, int ret)
+{
+    free_utr(msc->async_utr);
+    msc->async_utr = NULL;
+    msc->async_ret = ret;
+    msc->async_stage = MSC_ASYNC_DONE;
+}
+
+int  run_scsi_command_async(MSC_T *msc, uint8_t *buff, uint32_t data_len, int bIsDataIn)
+{
+    struct bulk_cb_wrap  *cmd_blk = &msc->cmd_blk;         /* MSC Bulk-only command block   */
+    int   ret;
+
+    if (msc->async_stage != MSC_ASYNC_IDLE)
+        return UMAS_ERR_BUSY;
+
+    msc->async_utr = alloc_utr(msc->iface->udev);
+    if (!msc->async_utr)
+        return USBH_ERR_MEMORY_OUT;
+
+    cmd_blk->Signature = MSC_CB_SIGN;
+    cmd_blk->Tag = __tag++;
+    cmd_blk->DataTransferLength = data_len;
+    cmd_blk->Lun = msc->lun;
+
+    msc->async_buff = buff;
+    msc->async_len = data_len;
+    msc->async_dir_in = bIsDataIn ? 1 : 0;
+
+    ret = async_submit_stage(msc, msc->ep_bulk_out, (uint8_t *)cmd_blk, MSC_CB_WRAP_LEN, MSC_ASYNC_CBW);
+    if (ret < 0)
+    {
+        free_utr(msc->async_utr);
+        msc->async_utr = NULL;
+        msc->async_stage = MSC_ASYNC_IDLE;
+        return ret;
+    }
+    return 0;
+}
+
+/*
+ *  Advance the asynchronous command.
+ *  Return 1 if it's still in progress, otherwise the command result (0 or error code).
+ *  The result is held in MSC_ASYNC_DONE stage until collected by the caller.
+ */
+int  poll_scsi_command_async(MSC_T *msc)
+{
+    UTR_T   *utr = msc->async_utr;
+    int     ret;
+
+    if (msc->async_stage == MSC_ASYNC_IDLE)
+        return 0;
+
+    if (msc->async_stage == MSC_ASYNC_DONE)
+        return msc->async_ret;
+
+    if (utr->bIsTransferDone == 0)
+    {
+        if (get_ticks() - msc->async_t0 > MSC_ASYNC_TIMEOUT)
+        {
+            usbh_quit_utr(utr);
+            async_finish(msc, USBH_ERR_TIMEOUT);
+            return msc->async_ret;
+        }
+        return 1;
+    }
+
+    if (utr->status < 0)
+    {
+        async_finish(msc, utr->status);
+        return msc->async_ret;
+    }
+
+    switch (msc->async_stage)
+    {
+    case MSC_ASYNC_CBW:
+        if (msc->async_len > 0)
+        {
+            ret = async_submit_stage(msc, msc->async_dir_in ? msc->ep_bulk_in : msc->ep_bulk_out,
+                                     msc->async_buff, msc->async_len, MSC_ASYNC_DATA);
+            break;
+        }
+    /* fall through - no data stage */
+    case MSC_ASYNC_DATA:
+        ret = async_submit_stage(msc, msc->ep_bulk_in, (uint8_t *)&msc->cmd_status,
+                                 MSC_CS_WRAP_LEN, MSC_ASYNC_CSW);
+        break;
+
+    default:    /* MSC_ASYNC_CSW */
+        if (msc->cmd_status.Status != 0)
+        {
+            msc_debug_msg("    !! CSW status error.\n");
+            ret = UMAS_ERR_CMD_STATUS;
+        }
+        else
+            ret = 0;
+        async_finish(msc, ret);
+        return ret;
+    }
+
+    if (ret < 0)
+    {
+        async_finish(msc, ret);
+        return ret;
+    }
+    return 1;
+}
+
+/*
+ *  Block until the asynchronous command has left the bus. Its result is kept.
+ */
+void  wait_scsi_command_async(MSC_T *msc)
+{
+    while (poll_scsi_command_async(msc) == 1)
+        ;
+}
+
+/*
+ *  Abort the asynchronous command and release its UTR. Used on device disconnect.
+ */
+void  quit_scsi_command_async(MSC_T *msc)
+{
+    if (msc->async_utr != NULL)
+    {
+        usbh_quit_utr(msc->async_utr);
+        free_utr(msc->async_utr);
+        msc->async_utr = NULL;
+    }
+    msc->async_stage = MSC_ASYNC_IDLE;
+}
+
 /// @endcond HIDDEN_SYMBOLS
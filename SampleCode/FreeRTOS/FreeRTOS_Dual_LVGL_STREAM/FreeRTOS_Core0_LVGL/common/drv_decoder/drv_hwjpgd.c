@@ -12,12 +12,14 @@
 #if LV_USE_HWJPGD
 
 #include "../../misc/lv_fs_private.h"
+#include "../../misc/cache/lv_cache_private.h"
 #include <string.h>
 #include <stdio.h>
 #include "drv_hwjpgd.h"
 #include "../../core/lv_global.h"
 #include "nu_misc.h"
 #include "plat_jpeg.h"
+#include "bitstream.h"
 
 /*********************
  *      DEFINES
@@ -27,14 +29,77 @@
 #define image_cache_draw_buf_handlers   &(LV_GLOBAL_DEFAULT()->image_cache_draw_buf_handlers)
 #define JPEG_SIGNATURE                  0xFFD8FF
 #define IS_JPEG_SIGNATURE(x)            (((x) & 0x00FFFFFF) == JPEG_SIGNATURE)
+#define JPEG_HEAD_SIZE                  0x20000     /* enough for an EXIF segment and the frame header */
 
 #ifndef nc_ptr
     #define nc_ptr(x)                   (volatile uint32_t*)((uint32_t)x|0x80000000)
 #endif
 
+#ifndef LV_HWJPGD_CACHE_SIZE
+    #define LV_HWJPGD_CACHE_SIZE        (16 * 1024 * 1024)  /* bytes of decoded images kept */
+#endif
+
+#ifndef LV_HWJPGD_ASYNC
+    #define LV_HWJPGD_ASYNC             (LV_USE_OS != LV_OS_NONE)
+#endif
+
+#ifndef LV_HWJPGD_QUEUE_LEN
+    #define LV_HWJPGD_QUEUE_LEN         8
+#endif
+
+#ifndef LV_HWJPGD_REDRAW_MS
+    #define LV_HWJPGD_REDRAW_MS         LV_DEF_REFR_PERIOD  /* how often finished decodes are looked for */
+#endif
+
+#ifndef LV_HWJPGD_STACK_SIZE
+    #define LV_HWJPGD_STACK_SIZE        (8 * 1024)
+#endif
+
+#ifndef LV_HWJPGD_PLACEHOLDER_COLOR
+    #define LV_HWJPGD_PLACEHOLDER_COLOR 0x404040        /* shown while decoding */
+#endif
+
+#ifndef LV_HWJPGD_REVALIDATE_MS
+    #define LV_HWJPGD_REVALIDATE_MS     1000            /* how often a cached file is compared with the disk */
+#endif
+
+#ifndef LV_HWJPGD_COLOR_DEPTH
+    #define LV_HWJPGD_COLOR_DEPTH       LV_COLOR_DEPTH  /* 16 halves the memory of 32-bit displays */
+#endif
+
+#define FINGERPRINT_SPAN                512             /* bytes hashed at each end of the file */
+
 /**********************
  *      TYPEDEFS
  **********************/
+typedef struct
+{
+    uint32_t width;             /* as coded */
+    uint32_t height;
+    uint32_t orientation;
+    uint32_t out_w;             /* rotated and scaled, as reported to LVGL */
+    uint32_t out_h;
+} jpeg_head_t;
+
+typedef enum
+{
+    ENTRY_PENDING,
+    ENTRY_READY,
+    ENTRY_FAILED,
+} entry_state_t;
+
+/* lv_fs has no modification time, size and a hash of both ends of the file stand in for it */
+typedef struct
+{
+    lv_cache_slot_size_t slot;  /* decoded bytes, first for the size-based LRU */
+    const char *path;           /* the key */
+    uint32_t file_size;
+    uint32_t fingerprint;
+    uint32_t checked;           /* tick of the last comparison with the file */
+    jpeg_head_t head;
+    lv_draw_buf_t *decoded;
+    volatile entry_state_t state;
+} hwjpgd_entry_t;
 
 /**********************
  *  STATIC PROTOTYPES
@@ -42,18 +107,45 @@
 static lv_result_t decoder_info(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc, lv_image_header_t *header);
 static lv_result_t decoder_open(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc);
 static void decoder_close(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc);
-static bool get_jpeg_head_info(const char *filename, uint32_t *width, uint32_t *height, uint32_t *orientation);
-static lv_draw_buf_t *decode_jpeg_file(const char *filename);
-static lv_draw_buf_t *decode_jpeg_data(const lv_image_dsc_t *img_dsc);
-static uint8_t *read_file(const char *filename, uint32_t *size);
-static bool get_jpeg_resolution(uint8_t *data, uint32_t data_size, uint32_t *width, uint32_t *height);
-static bool get_jpeg_direction(uint8_t *data, uint32_t data_size, uint32_t *orientation);
+static bool get_jpeg_head_info(const char *filename, jpeg_head_t *head);
+static void get_jpeg_out_size(jpeg_head_t *head);
+static bool get_file_stamp(const char *filename, uint32_t *file_size, uint32_t *fingerprint);
+static lv_draw_buf_t *create_draw_buf(const jpeg_head_t *head);
+static int decode_jpeg_common(const void *jpeg_data, uint32_t data_size, const jpeg_head_t *head, lv_draw_buf_t *decoded);
+static bool decode_jpeg_file(const char *filename, const jpeg_head_t *head, lv_draw_buf_t *decoded);
+static lv_cache_entry_t *cache_acquire(const char *filename);
+static lv_cache_entry_t *cache_create(const char *filename);
+static void cache_decode(hwjpgd_entry_t *entry);
+static lv_cache_compare_res_t cache_compare_cb(const hwjpgd_entry_t *lhs, const hwjpgd_entry_t *rhs);
+static void cache_free_cb(hwjpgd_entry_t *entry, void *user_data);
+#if LV_HWJPGD_ASYNC
+    static bool worker_queue(lv_cache_entry_t *cache_entry);
+    static void worker_thread(void *user_data);
+    static void redraw_timer_cb(lv_timer_t *timer);
+#endif
+static uint8_t *read_file(const char *filename, uint32_t max_size, uint32_t *size, uint32_t *file_size);
+static bool get_jpeg_resolution(const BS_JPEG_INFO_T *info, uint32_t *width, uint32_t *height);
+static bool get_jpeg_direction(const BS_JPEG_INFO_T *info, uint32_t *orientation);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
-static volatile uint8_t _BitStreamBuf[0x800000] __attribute__((aligned(64))); /* 8 MB */
-static uint32_t jpg_width, jpg_height, jpg_srcFormat;
+static volatile uint8_t _BitStreamBuf[0x800000] __attribute__((aligned(64))); /* 8 MB, one decode at a time */
+static lv_mutex_t bitstream_lock;   /* held from filling _BitStreamBuf until its decode is done */
+static lv_cache_t *hwjpgd_cache;
+static uint32_t max_w, max_h;
+
+#if LV_HWJPGD_ASYNC
+static lv_thread_t worker;
+static lv_thread_sync_t worker_sync;
+static lv_mutex_t queue_lock;
+static lv_cache_entry_t *queue[LV_HWJPGD_QUEUE_LEN];
+static uint32_t queue_head, queue_tail;
+static volatile bool worker_quit;
+static volatile bool worker_running;
+static volatile bool redraw_pending;
+static lv_timer_t *redraw_timer;
+#endif
 
 /**********************
  *      MACROS
@@ -78,6 +170,33 @@ void lv_hwjpgd_init(void)
         dec->name = DECODER_NAME;
 
         plat_jpeg_init();
+        lv_mutex_init(&bitstream_lock);
+
+        hwjpgd_cache = lv_cache_create(&lv_cache_class_lru_rb_size, sizeof(hwjpgd_entry_t), LV_HWJPGD_CACHE_SIZE,
+        (lv_cache_ops_t)
+        {
+            .compare_cb = (lv_cache_compare_cb_t) cache_compare_cb,
+            .create_cb = NULL,
+            .free_cb = (lv_cache_free_cb_t) cache_free_cb
+        });
+        lv_cache_set_name(hwjpgd_cache, DECODER_NAME);
+
+#if LV_HWJPGD_ASYNC
+        lv_mutex_init(&queue_lock);
+        lv_thread_sync_init(&worker_sync);
+        worker_quit = false;
+        worker_running = true;
+        redraw_pending = false;
+        /* The worker never takes the LVGL lock, the timer redraws for it */
+        redraw_timer = lv_timer_create(redraw_timer_cb, LV_HWJPGD_REDRAW_MS, NULL);
+        if (!redraw_timer ||
+                (lv_thread_init(&worker, LV_THREAD_PRIO_LOW, worker_thread, LV_HWJPGD_STACK_SIZE, NULL) != LV_RESULT_OK))
+        {
+            LV_LOG_WARN("No decode thread, decoding on the render thread");
+            worker_quit = true;
+            worker_running = false;
+        }
+#endif
     }
 }
 
@@ -93,12 +212,58 @@ void lv_hwjpgd_deinit(void)
         {
             lv_image_decoder_delete(dec);
 
+#if LV_HWJPGD_ASYNC
+            /*
+             * The thread finishes the queued decodes, then returns. It needs
+             * no LVGL lock for that, so the caller may hold it.
+             */
+            worker_quit = true;
+            lv_thread_sync_signal(&worker_sync);
+            while (worker_running)
+                lv_delay_ms(1);
+            lv_thread_sync_delete(&worker_sync);
+            lv_mutex_delete(&queue_lock);
+            if (redraw_timer)
+            {
+                lv_timer_delete(redraw_timer);
+                redraw_timer = NULL;
+            }
+#endif
+            lv_cache_destroy(hwjpgd_cache, NULL);
+            hwjpgd_cache = NULL;
+
+            lv_mutex_delete(&bitstream_lock);
             plat_jpeg_deinit();
             break;
         }
     }
 }
 
+void lv_hwjpgd_set_max_size(uint32_t w, uint32_t h)
+{
+    max_w = w;
+    max_h = h;
+
+    /* Sizes reported before no longer hold */
+    lv_hwjpgd_cache_drop(NULL);
+    lv_image_header_cache_drop(NULL);
+}
+
+void lv_hwjpgd_cache_drop(const char *path)
+{
+    if (!hwjpgd_cache)
+        return;
+
+    if (path == NULL)
+    {
+        lv_cache_drop_all(hwjpgd_cache, NULL);
+        return;
+    }
+
+    hwjpgd_entry_t search_key = { .path = path };
+    lv_cache_drop(hwjpgd_cache, &search_key, NULL);
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -106,8 +271,7 @@ static lv_result_t decoder_info(lv_image_decoder_t *decoder, lv_image_decoder_ds
 {
     LV_UNUSED(decoder); /*Unused*/
     lv_image_src_t src_type = dsc->src_type; /*Get the source type*/
-    uint32_t width, height;
-    uint32_t orientation = 0;
+    jpeg_head_t head;
 
     /*If it's a JPEG file...*/
     if (src_type == LV_IMAGE_SRC_FILE)
@@ -135,20 +299,20 @@ static lv_result_t decoder_info(lv_image_decoder_t *decoder, lv_image_decoder_ds
             return LV_RESULT_INVALID;
         }
 
-        if (!get_jpeg_head_info(src, &width, &height, &orientation))
+        if (!get_jpeg_head_info(src, &head))
         {
             return LV_RESULT_INVALID;
         }
 
-#if (LV_COLOR_DEPTH==16)
+#if (LV_HWJPGD_COLOR_DEPTH==16)
         header->cf = LV_COLOR_FORMAT_RGB565;
-#elif (LV_COLOR_DEPTH==32)
+#elif (LV_HWJPGD_COLOR_DEPTH==32)
         header->cf = LV_COLOR_FORMAT_XRGB8888;
 #endif
 
         /*Save the data in the header*/
-        header->w = jpg_width = (orientation % 180) ? height : width;
-        header->h = jpg_height = (orientation % 180) ? width : height;
+        header->w = head.out_w;
+        header->h = head.out_h;
 
         return LV_RESULT_OK;
     }
@@ -166,21 +330,23 @@ static lv_result_t decoder_info(lv_image_decoder_t *decoder, lv_image_decoder_ds
         }
 
         /*Save the data in the header*/
-#if (LV_COLOR_DEPTH==16)
+#if (LV_HWJPGD_COLOR_DEPTH==16)
         header->cf = LV_COLOR_FORMAT_RGB565;
-#elif (LV_COLOR_DEPTH==32)
+#elif (LV_HWJPGD_COLOR_DEPTH==32)
         header->cf = LV_COLOR_FORMAT_XRGB8888;
 #endif
-        header->w = jpg_width = img_dsc->header.w;
-        header->h = jpg_height = img_dsc->header.h;
+        header->w = img_dsc->header.w;
+        header->h = img_dsc->header.h;
 
         return LV_RESULT_OK;
     }
 
     return LV_RESULT_INVALID; /*If didn't succeeded earlier then it's an error*/
 }
+
 /**
  * Open a JPEG image and return the decoded image.
+ * Files come from the decoder's own cache, possibly as a placeholder while the worker decodes them.
  * @param decoder Pointer to the decoder.
  * @param dsc     Pointer to the decoder descriptor.
  * @return LV_RESULT_OK on success; LV_RESULT_INVALID on failure.
@@ -189,90 +355,131 @@ static lv_result_t decoder_open(lv_image_decoder_t *decoder, lv_image_decoder_ds
 {
     LV_UNUSED(decoder);
 
-    lv_draw_buf_t *decoded = NULL;
-
     if (dsc->src_type == LV_IMAGE_SRC_FILE)
     {
-        decoded = decode_jpeg_file(dsc->src);
-        if (!decoded)
+        lv_cache_entry_t *cache_entry = cache_acquire(dsc->src);
+
+        if (!cache_entry)
+            cache_entry = cache_create(dsc->src);
+        if (!cache_entry)
+            return LV_RESULT_INVALID;
+
+        hwjpgd_entry_t *entry = lv_cache_entry_get_data(cache_entry);
+        if (entry->state == ENTRY_FAILED)
         {
-            LV_LOG_WARN("Failed to decode JPEG file: %s", (const char *)dsc->src);
+            /* Not kept, the error may not last: the next open decodes again */
+            lv_cache_drop(hwjpgd_cache, entry, NULL);
+            lv_cache_release(hwjpgd_cache, cache_entry, NULL);
             return LV_RESULT_INVALID;
         }
+
+        /* Held until decoder_close(), LVGL's image cache is not involved */
+        dsc->decoded = entry->decoded;
+        dsc->user_data = cache_entry;
+
+        return LV_RESULT_OK;
     }
     else if (dsc->src_type == LV_IMAGE_SRC_VARIABLE)
     {
         const lv_image_dsc_t *img_dsc = dsc->src;
+        jpeg_head_t head = { 0 };
+        lv_draw_buf_t *decoded;
 
-        // Optionally preprocess or copy data
-        lv_memcpy(nc_ptr(_BitStreamBuf), img_dsc->data, img_dsc->data_size);
+        if (img_dsc->data_size > sizeof(_BitStreamBuf))
+            return LV_RESULT_INVALID;
+
+        head.width = head.out_w = img_dsc->header.w;
+        head.height = head.out_h = img_dsc->header.h;
 
-        decoded = decode_jpeg_data(img_dsc);
+        decoded = create_draw_buf(&head);
         if (!decoded)
+            return LV_RESULT_INVALID;
+
+        /* The worker may be decoding a file from the same buffer */
+        lv_mutex_lock(&bitstream_lock);
+        lv_memcpy(nc_ptr(_BitStreamBuf), img_dsc->data, img_dsc->data_size);
+        int ret = decode_jpeg_common(nc_ptr(_BitStreamBuf), img_dsc->data_size, &head, decoded);
+        lv_mutex_unlock(&bitstream_lock);
+
+        if (ret < 0)
         {
             LV_LOG_WARN("Failed to decode JPEG data");
+            lv_draw_buf_destroy(decoded);
             return LV_RESULT_INVALID;
         }
-    }
-    else
-    {
-        return LV_RESULT_INVALID;
-    }
 
-    dsc->decoded = decoded;
+        dsc->decoded = decoded;
 
-    // Skip cache if explicitly disabled or caching is globally off
-    if (dsc->args.no_cache || !lv_image_cache_is_enabled())
-    {
-        return LV_RESULT_OK;
-    }
+        // Skip cache if explicitly disabled or caching is globally off
+        if (dsc->args.no_cache || !lv_image_cache_is_enabled())
+        {
+            return LV_RESULT_OK;
+        }
 
-    // Try to cache the decoded image
-    lv_image_cache_data_t search_key =
-    {
-        .src_type = dsc->src_type,
-        .src = dsc->src,
-        .slot.size = decoded->data_size
-    };
+        // Try to cache the decoded image
+        lv_image_cache_data_t search_key =
+        {
+            .src_type = dsc->src_type,
+            .src = dsc->src,
+            .slot.size = decoded->data_size
+        };
 
-    lv_cache_entry_t *entry = lv_image_decoder_add_to_cache(decoder, &search_key, decoded, NULL);
-    if (!entry)
-    {
-        lv_draw_buf_destroy(decoded);
-        return LV_RESULT_INVALID;
-    }
+        lv_cache_entry_t *entry = lv_image_decoder_add_to_cache(decoder, &search_key, decoded, NULL);
+        if (!entry)
+        {
+            lv_draw_buf_destroy(decoded);
+            return LV_RESULT_INVALID;
+        }
 
-    dsc->cache_entry = entry;
+        dsc->cache_entry = entry;
 
-    return LV_RESULT_OK;
-}
+        return LV_RESULT_OK;
+    }
 
+    return LV_RESULT_INVALID;
+}
 
-// Shared JPEG decoding backend
-static lv_draw_buf_t *decode_jpeg_common(const void *jpeg_data, uint32_t data_size)
+static lv_draw_buf_t *create_draw_buf(const jpeg_head_t *head)
 {
-    S_JPEG_CTX ctx = {0};
-
-    if ((jpg_width % 8) != 0 || (jpg_height  % 8) != 0)
-    {
-        LV_LOG_WARN("jpg_width (%d) or jpg_height (%d) is not a multiple of 32", jpg_width, jpg_height);
-        return NULL;
-    }
-
     lv_draw_buf_t *decoded = lv_draw_buf_create_ex(image_cache_draw_buf_handlers,
-                             jpg_width, jpg_height,
-                             ctx.m_u32DstFormat,
+                             head->out_w, head->out_h,
+#if (LV_HWJPGD_COLOR_DEPTH==16)
+                             LV_COLOR_FORMAT_RGB565,
+#else
+                             LV_COLOR_FORMAT_XRGB8888,
+#endif
                              LV_STRIDE_AUTO);
     if (!decoded)
+        LV_LOG_WARN("Failed to create %" LV_PRIu32 "x%" LV_PRIu32 " draw buffer", head->out_w, head->out_h);
+
+    return decoded;
+}
+
+// Shared JPEG decoding backend, the post-processor writes straight into the draw buffer
+static int decode_jpeg_common(const void *jpeg_data, uint32_t data_size, const jpeg_head_t *head, lv_draw_buf_t *decoded)
+{
+    S_JPEG_CTX ctx = {0};
+    uint32_t rot_w = (head->orientation % 180) ? head->height : head->width;
+    uint32_t rot_h = (head->orientation % 180) ? head->width : head->height;
+
+    if ((head->out_w % 8) != 0 || (head->out_h % 8) != 0)
     {
-        LV_LOG_WARN("Failed to create draw buffer");
-        goto fail_jpgd_common;
+        LV_LOG_WARN("jpg_width (%d) or jpg_height (%d) is not a multiple of 8", head->out_w, head->out_h);
+        return -1;
     }
 
-    ctx.m_u32Width       = jpg_width;
-    ctx.m_u32Height      = jpg_height;
-    ctx.m_pvSrcBufAddr   = nc_ptr(jpeg_data);
+    ctx.m_u32Width       = rot_w;
+    ctx.m_u32Height      = rot_h;
+    ctx.m_u32Rotation    = head->orientation;
+    ctx.m_u32OutWidth    = head->out_w;
+    ctx.m_u32OutHeight   = head->out_h;
+    ctx.m_pvSrcBufAddr   = (void *)jpeg_data;
     ctx.m_u32SrcBufLen   = data_size;
+#if (LV_HWJPGD_COLOR_DEPTH==16)
+    ctx.m_u32DstFormat   = JPEG_DEC_DST_RGB565;
+#else
+    ctx.m_u32DstFormat   = JPEG_DEC_DST_XRGB8888;
+#endif
     ctx.m_pvDstBufAddr   = (void *)decoded->data;
     ctx.m_u32DstBufLen   = decoded->data_size;
 
@@ -280,33 +487,25 @@ static lv_draw_buf_t *decode_jpeg_common(const void *jpeg_data, uint32_t data_si
     if (ret < 0)
     {
         LV_LOG_WARN("plat_jpeg_decode failed (%d)", ret);
-        goto fail_jpgd_common;
     }
 
-    return decoded;
-
-fail_jpgd_common:
-
-    if (decoded)
-        lv_draw_buf_destroy(decoded);
-
-    return NULL;
-
+    return ret;
 }
 
-// Decode JPEG from file
-static lv_draw_buf_t *decode_jpeg_file(const char *filename)
+// Decode JPEG from file, on the worker or on the render thread when the queue is full
+static bool decode_jpeg_file(const char *filename, const jpeg_head_t *head, lv_draw_buf_t *decoded)
 {
     lv_fs_file_t f;
     lv_fs_res_t res;
     uint32_t file_size = 0, read_size = 0;
+    bool ok;
 
 
     res = lv_fs_open(&f, filename, LV_FS_MODE_RD);
     if (res != LV_FS_RES_OK)
     {
         LV_LOG_WARN("Failed to open file: %s", filename);
-        return NULL;
+        return false;
     }
 
     if (lv_fs_seek(&f, 0, LV_FS_SEEK_END) != LV_FS_RES_OK ||
@@ -315,40 +514,263 @@ static lv_draw_buf_t *decode_jpeg_file(const char *filename)
     {
         LV_LOG_WARN("Failed to determine file size: %s", filename);
         lv_fs_close(&f);
-        return NULL;
+        return false;
+    }
+
+    if (file_size > sizeof(_BitStreamBuf))
+    {
+        LV_LOG_WARN("JPEG file too large (%" LV_PRIu32 " bytes): %s", file_size, filename);
+        lv_fs_close(&f);
+        return false;
     }
 
+    /* Read and decode as one, _BitStreamBuf is shared by every decode */
+    lv_mutex_lock(&bitstream_lock);
+
     if (lv_fs_read(&f, nc_ptr(_BitStreamBuf), file_size, &read_size) != LV_FS_RES_OK || read_size != file_size)
     {
         LV_LOG_WARN("Failed to read JPEG file: %s", filename);
-        lv_fs_close(&f);
-        return NULL;
+        ok = false;
+    }
+    else
+    {
+        ok = decode_jpeg_common(nc_ptr(_BitStreamBuf), file_size, head, decoded) >= 0;
     }
 
+    lv_mutex_unlock(&bitstream_lock);
     lv_fs_close(&f);
 
-    return decode_jpeg_common(nc_ptr(_BitStreamBuf), file_size);
+    return ok;
+}
+
+/*
+ * Decoded image cache.
+ */
+
+/* Look a file up, dropping the entry if the file changed since it was decoded */
+static lv_cache_entry_t *cache_acquire(const char *filename)
+{
+    hwjpgd_entry_t search_key = { .path = filename };
+    lv_cache_entry_t *cache_entry = lv_cache_acquire(hwjpgd_cache, &search_key, NULL);
+    uint32_t file_size, fingerprint;
+
+    if (!cache_entry)
+        return NULL;
+
+    hwjpgd_entry_t *entry = lv_cache_entry_get_data(cache_entry);
+    if ((entry->state == ENTRY_PENDING) || (lv_tick_elaps(entry->checked) < LV_HWJPGD_REVALIDATE_MS))
+        return cache_entry;
+
+    if (get_file_stamp(filename, &file_size, &fingerprint) &&
+            (file_size == entry->file_size) && (fingerprint == entry->fingerprint))
+    {
+        entry->checked = lv_tick_get();
+        return cache_entry;
+    }
+
+    /* Freed once the last user lets go of it */
+    lv_cache_drop(hwjpgd_cache, &search_key, NULL);
+    lv_cache_release(hwjpgd_cache, cache_entry, NULL);
+    lv_image_header_cache_drop(filename);
+
+    return NULL;
 }
 
-// Decode JPEG from in-memory descriptor
-static lv_draw_buf_t *decode_jpeg_data(const lv_image_dsc_t *img_dsc)
+/* Add a file to the cache and decode it, in the background if possible */
+static lv_cache_entry_t *cache_create(const char *filename)
 {
-    return decode_jpeg_common(nc_ptr(_BitStreamBuf), img_dsc->data_size);
+    hwjpgd_entry_t search_key = { 0 };
+    lv_cache_entry_t *cache_entry;
+    hwjpgd_entry_t *entry;
+
+    if (!get_file_stamp(filename, &search_key.file_size, &search_key.fingerprint) ||
+            !get_jpeg_head_info(filename, &search_key.head))
+        return NULL;
+
+    search_key.slot.size = lv_draw_buf_width_to_stride(search_key.head.out_w,
+#if (LV_HWJPGD_COLOR_DEPTH==16)
+                           LV_COLOR_FORMAT_RGB565
+#else
+                           LV_COLOR_FORMAT_XRGB8888
+#endif
+                                                      ) * search_key.head.out_h;
+    if (search_key.slot.size > LV_HWJPGD_CACHE_SIZE)
+    {
+        LV_LOG_WARN("%" LV_PRIu32 "x%" LV_PRIu32 " exceeds LV_HWJPGD_CACHE_SIZE, see lv_hwjpgd_set_max_size(): %s",
+                    search_key.head.out_w, search_key.head.out_h, filename);
+        return NULL;
+    }
+
+    search_key.path = lv_strdup(filename);
+    if (!search_key.path)
+        return NULL;
+    search_key.checked = lv_tick_get();
+    search_key.state = ENTRY_PENDING;
+
+    /*
+     * Added before the buffer is allocated, so the LRU gives back room
+     * first; it evicts under the cache lock and fails when every entry
+     * left is in use.
+     */
+    cache_entry = lv_cache_add(hwjpgd_cache, &search_key, NULL);
+    if (!cache_entry)
+    {
+        lv_free((void *)search_key.path);
+        return NULL;
+    }
+    entry = lv_cache_entry_get_data(cache_entry);
+
+    entry->decoded = create_draw_buf(&entry->head);
+    if (!entry->decoded)
+    {
+        lv_cache_drop(hwjpgd_cache, entry, NULL);
+        lv_cache_release(hwjpgd_cache, cache_entry, NULL);
+        return NULL;
+    }
+
+#if LV_HWJPGD_ASYNC
+    if (!worker_quit)
+    {
+        uint32_t i;
+
+        /* The placeholder is what LVGL draws until the worker is done */
+#if (LV_HWJPGD_COLOR_DEPTH==16)
+        uint16_t *px = (uint16_t *)entry->decoded->data;
+        uint16_t color = lv_color_to_u16(lv_color_hex(LV_HWJPGD_PLACEHOLDER_COLOR));
+#else
+        uint32_t *px = (uint32_t *)entry->decoded->data;
+        uint32_t color = lv_color_to_u32(lv_color_hex(LV_HWJPGD_PLACEHOLDER_COLOR));
+#endif
+        for (i = 0; i < entry->decoded->data_size / sizeof(*px); i++)
+            px[i] = color;
+
+        /* Written back before the post-processor writes behind the cache */
+        dcache_clean_by_mva(entry->decoded->data, entry->decoded->data_size);
+
+        /* The queue holds a reference of its own until the decode is done */
+        lv_cache_entry_t *queued = lv_cache_acquire(hwjpgd_cache, entry, NULL);
+        if (queued && worker_queue(queued))
+            return cache_entry;
+        if (queued)
+            lv_cache_release(hwjpgd_cache, queued, NULL);
+    }
+#endif
+
+    cache_decode(entry);
+
+    return cache_entry;
 }
 
+static void cache_decode(hwjpgd_entry_t *entry)
+{
+    bool ok = decode_jpeg_file(entry->path, &entry->head, entry->decoded);
+
+    /* Lines the render thread read from the placeholder are stale now */
+    dcache_invalidate_by_mva(entry->decoded->data, entry->decoded->data_size);
+
+    entry->state = ok ? ENTRY_READY : ENTRY_FAILED;
+}
+
+static lv_cache_compare_res_t cache_compare_cb(const hwjpgd_entry_t *lhs, const hwjpgd_entry_t *rhs)
+{
+    int32_t cmp_res = lv_strcmp(lhs->path, rhs->path);
+
+    if (cmp_res != 0)
+        return cmp_res > 0 ? 1 : -1;
+
+    return 0;
+}
+
+static void cache_free_cb(hwjpgd_entry_t *entry, void *user_data)
+{
+    LV_UNUSED(user_data);
+
+    if (entry->decoded)
+        lv_draw_buf_destroy(entry->decoded);
+    lv_free((void *)entry->path);
+}
+
+#if LV_HWJPGD_ASYNC
+static bool worker_queue(lv_cache_entry_t *cache_entry)
+{
+    bool queued = false;
+
+    lv_mutex_lock(&queue_lock);
+    if ((queue_head - queue_tail) < LV_HWJPGD_QUEUE_LEN)
+    {
+        queue[queue_head++ % LV_HWJPGD_QUEUE_LEN] = cache_entry;
+        queued = true;
+    }
+    lv_mutex_unlock(&queue_lock);
+
+    if (queued)
+        lv_thread_sync_signal(&worker_sync);
+
+    return queued;
+}
+
+static void worker_thread(void *user_data)
+{
+    LV_UNUSED(user_data);
+
+    while (1)
+    {
+        lv_cache_entry_t *cache_entry = NULL;
+
+        lv_mutex_lock(&queue_lock);
+        if (queue_head != queue_tail)
+            cache_entry = queue[queue_tail++ % LV_HWJPGD_QUEUE_LEN];
+        lv_mutex_unlock(&queue_lock);
+
+        if (!cache_entry)
+        {
+            if (worker_quit)
+                break;
+            lv_thread_sync_wait(&worker_sync);
+            continue;
+        }
+
+        hwjpgd_entry_t *entry = lv_cache_entry_get_data(cache_entry);
+
+        cache_decode(entry);
+
+        /* A failed decode keeps the placeholder until something else redraws it */
+        if (entry->state == ENTRY_READY)
+            redraw_pending = true;
+        lv_cache_release(hwjpgd_cache, cache_entry, NULL);
+    }
+
+    worker_running = false;
+}
+
+/* Draw again what showed the placeholder, in the LVGL thread */
+static void redraw_timer_cb(lv_timer_t *timer)
+{
+    LV_UNUSED(timer);
+
+    if (redraw_pending)
+    {
+        redraw_pending = false;
+        lv_obj_invalidate(lv_screen_active());
+    }
+}
+#endif
+
 /**
- * Read an entire file into a dynamically allocated buffer.
- * @param filename The file path.
- * @param size     Output pointer to receive the data size.
+ * Read the first bytes of a file into a dynamically allocated buffer.
+ * @param filename  The file path.
+ * @param max_size  Most bytes to read.
+ * @param size      Output pointer to receive the data size.
+ * @param file_size Output pointer to receive the file size.
  * @return Pointer to the allocated buffer, or NULL on failure.
  */
-static uint8_t *read_file(const char *filename, uint32_t *size)
+static uint8_t *read_file(const char *filename, uint32_t max_size, uint32_t *size, uint32_t *file_size)
 {
-    if (!filename || !size) return NULL;
+    if (!filename || !size || !file_size) return NULL;
 
     *size = 0;
     lv_fs_file_t f;
-    uint32_t file_size = 0, read_size = 0;
+    uint32_t read_size = 0;
 
     if (lv_fs_open(&f, filename, LV_FS_MODE_RD) != LV_FS_RES_OK)
     {
@@ -357,7 +779,7 @@ static uint8_t *read_file(const char *filename, uint32_t *size)
     }
 
     if (lv_fs_seek(&f, 0, LV_FS_SEEK_END) != LV_FS_RES_OK ||
-            lv_fs_tell(&f, &file_size) != LV_FS_RES_OK ||
+            lv_fs_tell(&f, file_size) != LV_FS_RES_OK ||
             lv_fs_seek(&f, 0, LV_FS_SEEK_SET) != LV_FS_RES_OK)
     {
         LV_LOG_WARN("Failed to get file size: %s", filename);
@@ -365,17 +787,20 @@ static uint8_t *read_file(const char *filename, uint32_t *size)
         return NULL;
     }
 
-    uint8_t *data = lv_malloc(file_size);
+    if (max_size > *file_size)
+        max_size = *file_size;
+
+    uint8_t *data = lv_malloc(max_size);
     if (!data)
     {
-        LV_LOG_WARN("Memory allocation failed (%d bytes) for file: %s", file_size, filename);
+        LV_LOG_WARN("Memory allocation failed (%d bytes) for file: %s", max_size, filename);
         lv_fs_close(&f);
         return NULL;
     }
 
-    if (lv_fs_read(&f, data, file_size, &read_size) != LV_FS_RES_OK || read_size != file_size)
+    if (lv_fs_read(&f, data, max_size, &read_size) != LV_FS_RES_OK || read_size != max_size)
     {
-        LV_LOG_WARN("Failed to read full file: %s", filename);
+        LV_LOG_WARN("Failed to read file: %s", filename);
         lv_free(data);
         data = NULL;
     }
@@ -392,31 +817,129 @@ static uint8_t *read_file(const char *filename, uint32_t *size)
  * Extract JPEG metadata (dimensions + orientation) from file.
  * @return true on success, false otherwise.
  */
-static bool get_jpeg_head_info(const char *filename, uint32_t *width, uint32_t *height, uint32_t *orientation)
+static bool get_jpeg_head_info(const char *filename, jpeg_head_t *head)
 {
-    if (!filename || !width || !height || !orientation)
+    if (!filename || !head)
         return false;
 
-    uint32_t data_size = 0;
-    uint8_t *data = read_file(filename, &data_size);
+    BS_JPEG_INFO_T info;
+    uint32_t data_size = 0, file_size = 0;
+    int ret;
+
+    /* The headers are at the head of the file, read the rest only if they are longer */
+    uint8_t *data = read_file(filename, JPEG_HEAD_SIZE, &data_size, &file_size);
     if (!data)
         return false;
 
-    bool ok = true;
+    ret = bs_jpeg_parse(data, data_size, &info);
+    if ((ret == BS_ERR_TRUNCATED) && (data_size < file_size))
+    {
+        lv_free(data);
+        data = read_file(filename, file_size, &data_size, &file_size);
+        if (!data)
+            return false;
+        ret = bs_jpeg_parse(data, data_size, &info);
+    }
+    lv_free(data);
+
+    if (ret != BS_OK)
+    {
+        LV_LOG_WARN("Failed to parse JPEG headers (%d) of: %s", ret, filename);
+        return false;
+    }
 
-    if (!get_jpeg_resolution(data, data_size, width, height))
+    if (!get_jpeg_resolution(&info, &head->width, &head->height))
     {
         LV_LOG_WARN("Failed to get JPEG size from: %s", filename);
-        ok = false;
+        return false;
     }
 
-    if (!get_jpeg_direction(data, data_size, orientation))
+    if (!get_jpeg_direction(&info, &head->orientation))
     {
         LV_LOG_WARN("Failed to get JPEG orientation from: %s", filename);
-        // Orientation failure is non-fatal; we don't override `ok`
+        // Orientation failure is non-fatal
+        head->orientation = 0;
     }
 
-    lv_free(data);
+    get_jpeg_out_size(head);
+
+    return true;
+}
+
+/**
+ * Size of the decoded image: rotated, then scaled by the post-processor to fit
+ * lv_hwjpgd_set_max_size() with the aspect ratio kept, in multiples of 8.
+ */
+static void get_jpeg_out_size(jpeg_head_t *head)
+{
+    uint32_t w = (head->orientation % 180) ? head->height : head->width;
+    uint32_t h = (head->orientation % 180) ? head->width : head->height;
+
+    if ((max_w && (w > max_w)) || (max_h && (h > max_h)))
+    {
+        uint64_t sw = max_w ? max_w : w;
+        uint64_t sh = max_h ? max_h : h;
+
+        /* Fit the side that overflows most */
+        if (sw * h <= sh * w)
+        {
+            h = (uint32_t)(sw * h / w);
+            w = (uint32_t)sw;
+        }
+        else
+        {
+            w = (uint32_t)(sh * w / h);
+            h = (uint32_t)sh;
+        }
+
+        w = LV_MAX(w & ~7U, 8);
+        h = LV_MAX(h & ~7U, 8);
+    }
+
+    head->out_w = w;
+    head->out_h = h;
+}
+
+/**
+ * File size and FNV-1a hash of its first and last bytes, to notice a file rewritten in place.
+ * @return true on success, false otherwise.
+ */
+static bool get_file_stamp(const char *filename, uint32_t *file_size, uint32_t *fingerprint)
+{
+    uint8_t buf[FINGERPRINT_SPAN];
+    uint32_t hash = 0x811C9DC5;
+    uint32_t read_size, i;
+    lv_fs_file_t f;
+    bool ok = false;
+
+    if (lv_fs_open(&f, filename, LV_FS_MODE_RD) != LV_FS_RES_OK)
+        return false;
+
+    if (lv_fs_seek(&f, 0, LV_FS_SEEK_END) != LV_FS_RES_OK ||
+            lv_fs_tell(&f, file_size) != LV_FS_RES_OK ||
+            lv_fs_seek(&f, 0, LV_FS_SEEK_SET) != LV_FS_RES_OK)
+        goto _exit_get_file_stamp;
+
+    if (lv_fs_read(&f, buf, sizeof(buf), &read_size) != LV_FS_RES_OK)
+        goto _exit_get_file_stamp;
+    for (i = 0; i < read_size; i++)
+        hash = (hash ^ buf[i]) * 0x01000193;
+
+    if (*file_size > 2 * FINGERPRINT_SPAN)
+    {
+        if (lv_fs_seek(&f, *file_size - FINGERPRINT_SPAN, LV_FS_SEEK_SET) != LV_FS_RES_OK ||
+                lv_fs_read(&f, buf, sizeof(buf), &read_size) != LV_FS_RES_OK)
+            goto _exit_get_file_stamp;
+        for (i = 0; i < read_size; i++)
+            hash = (hash ^ buf[i]) * 0x01000193;
+    }
+
+    *fingerprint = hash;
+    ok = true;
+
+_exit_get_file_stamp:
+
+    lv_fs_close(&f);
 
     return ok;
 }
@@ -427,48 +950,57 @@ static bool get_jpeg_head_info(const char *filename, uint32_t *width, uint32_t *
 static void decoder_close(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc)
 {
     LV_UNUSED(decoder);
-    if (dsc->args.no_cache || !lv_image_cache_is_enabled())
+
+    if (dsc->user_data)
+    {
+        /* A file, the draw buffer stays in the decoder's cache */
+        lv_cache_release(hwjpgd_cache, dsc->user_data, NULL);
+        dsc->user_data = NULL;
+    }
+    else if (dsc->args.no_cache || !lv_image_cache_is_enabled())
     {
         lv_draw_buf_destroy((lv_draw_buf_t *)dsc->decoded);
     }
 }
 
 /**
- * Parse JPEG resolution (width & height) from data.
+ * JPEG resolution (width & height) of a frame the decoder supports:
+ * baseline YCbCr with 4:2:0, 4:2:2 or 4:4:4 sampling.
  */
-static bool get_jpeg_resolution(uint8_t *data, uint32_t data_size, uint32_t *width, uint32_t *height)
+static bool get_jpeg_resolution(const BS_JPEG_INFO_T *info, uint32_t *width, uint32_t *height)
 {
-    if (!data || !width || !height)
+    if (!info || !width || !height)
         return false;
 
-    S_JPEG_CTX ctx = {0};
-    ctx.m_pvSrcBufAddr = data;
-    ctx.m_u32SrcBufLen = data_size;
+    if (info->u8Sof != 0xC0)
+    {
+        LV_LOG_WARN("Unsupported JPEG format (marker 0x%02X)", info->u8Sof);
+        return false;
+    }
 
-    int result = plat_jpeg_parse(&ctx, true);
-    if (result < 0)
+    if ((info->u8Components != 3) ||
+            (info->au8Sampling[1] != 0x11) || (info->au8Sampling[2] != 0x11) ||
+            ((info->au8Sampling[0] != 0x22) && (info->au8Sampling[0] != 0x21) && (info->au8Sampling[0] != 0x11)))
     {
-        LV_LOG_WARN("JPEG_Parse() failed.");
+        LV_LOG_WARN("Unsupported JPEG components (%d, 0x%02X)", info->u8Components, info->au8Sampling[0]);
         return false;
     }
 
-    *width = ctx.m_u32Width;
-    *height = ctx.m_u32Height;
+    *width = info->u32Width;
+    *height = info->u32Height;
 
     return true;
 }
 
 /**
- * Parse JPEG EXIF orientation. Placeholder implementation.
+ * JPEG EXIF orientation as the clockwise rotation that displays the image upright.
+ * Mirrored orientations are shown rotated, without the flip.
  */
-static bool get_jpeg_direction(uint8_t *data, uint32_t data_size, uint32_t *orientation)
+static bool get_jpeg_direction(const BS_JPEG_INFO_T *info, uint32_t *orientation)
 {
-    LV_UNUSED(data);
-    LV_UNUSED(data_size);
-
-    if (!orientation) return false;
+    if (!info || !orientation) return false;
 
-    *orientation = 0; // Stub: Always return 0 for now
+    *orientation = bs_jpeg_rotation(info->u8Orientation);
     return true;
 }
 
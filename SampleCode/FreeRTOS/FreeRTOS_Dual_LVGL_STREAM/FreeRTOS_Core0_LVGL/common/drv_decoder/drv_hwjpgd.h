@@ -32,6 +32,21 @@ void lv_hwjpgd_init(void);
 
 void lv_hwjpgd_deinit(void);
 
+/**
+ * Decode JPEG files no larger than this, scaling bigger ones down by the
+ * post-processor at decode time, aspect ratio kept. 0 for no limit.
+ * Drops the decoded images and headers already cached.
+ * @param w     most width in pixels
+ * @param h     most height in pixels
+ */
+void lv_hwjpgd_set_max_size(uint32_t w, uint32_t h);
+
+/**
+ * Forget the decoded image of a file, e.g. after rewriting it.
+ * @param path  the file name as given to the image, NULL for all files
+ */
+void lv_hwjpgd_cache_drop(const char *path);
+
 /**********************
  *      MACROS
  **********************/
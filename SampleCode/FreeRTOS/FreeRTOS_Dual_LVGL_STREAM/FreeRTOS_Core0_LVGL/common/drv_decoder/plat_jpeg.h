@@ -30,6 +30,11 @@ extern "C" {
 #ifndef JPEG_DEC_YUV444
 #define JPEG_DEC_YUV444                 2
 #endif
+
+/* m_u32DstFormat */
+#define JPEG_DEC_DST_AUTO               0   /* as LV_COLOR_DEPTH */
+#define JPEG_DEC_DST_RGB565             1
+#define JPEG_DEC_DST_XRGB8888           2
 /**********************
  *      TYPEDEFS
  **********************/
@@ -37,6 +42,9 @@ typedef struct
 {
     uint32_t m_u32Width;
     uint32_t m_u32Height;
+    uint32_t m_u32Rotation;     /* clockwise degrees applied by PP, width and height are the rotated ones */
+    uint32_t m_u32OutWidth;     /* PP scales to this size, 0 keeps width and height */
+    uint32_t m_u32OutHeight;
 
     uint32_t m_u32SrcFormat;
     void  *m_pvSrcBufAddr;
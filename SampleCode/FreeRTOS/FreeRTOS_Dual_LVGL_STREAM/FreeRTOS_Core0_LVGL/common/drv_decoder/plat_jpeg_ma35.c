@@ -228,7 +228,10 @@ int32_t plat_jpeg_decode(S_JPEG_CTX *ctx)
     int32_t ret = -1;
 
     if (!ctx)
-        goto _exit_decode;
+        return ret;
+
+    /* _pp is shared by every caller */
+    JPEG_LOCK();
 
     _pp.img_out_x       = 0;
     _pp.img_out_y       = 0;
@@ -238,21 +241,26 @@ int32_t plat_jpeg_decode(S_JPEG_CTX *ctx)
     _pp.alpha           = 255;
     _pp.transparency    = 0;
 
+    if (ctx->m_u32DstFormat == JPEG_DEC_DST_RGB565)
+        _pp.img_out_fmt = VC8000_PP_F_RGB565;
+    else if (ctx->m_u32DstFormat == JPEG_DEC_DST_XRGB8888)
+        _pp.img_out_fmt = VC8000_PP_F_RGB888;
+    else
 #if (LV_COLOR_DEPTH==16)
-    _pp.img_out_fmt     = VC8000_PP_F_RGB565;
+        _pp.img_out_fmt = VC8000_PP_F_RGB565;
 #elif (LV_COLOR_DEPTH==32)
-    _pp.img_out_fmt     = VC8000_PP_F_RGB888;
+        _pp.img_out_fmt = VC8000_PP_F_RGB888;
 #endif
-    _pp.rotation        = VC8000_PP_ROTATION_NONE;
+    _pp.rotation        = (ctx->m_u32Rotation == 90) ? VC8000_PP_ROTATION_RIGHT_90 :
+                          (ctx->m_u32Rotation == 180) ? VC8000_PP_ROTATION_180 :
+                          (ctx->m_u32Rotation == 270) ? VC8000_PP_ROTATION_LEFT_90 : VC8000_PP_ROTATION_NONE;
     _pp.pp_out_dst      = VC8000_PP_OUT_DST_USER;
-    _pp.frame_buf_w     = ctx->m_u32Width;
-    _pp.frame_buf_h     = ctx->m_u32Height;
-    _pp.img_out_w       = ctx->m_u32Width;
-    _pp.img_out_h       = ctx->m_u32Height;
+    _pp.frame_buf_w     = ctx->m_u32OutWidth ? ctx->m_u32OutWidth : ctx->m_u32Width;
+    _pp.frame_buf_h     = ctx->m_u32OutHeight ? ctx->m_u32OutHeight : ctx->m_u32Height;
+    _pp.img_out_w       = _pp.frame_buf_w;
+    _pp.img_out_h       = _pp.frame_buf_h;
     _pp.pp_out_paddr    = (uint32_t)(uintptr_t)ctx->m_pvDstBufAddr;
 
-    JPEG_LOCK();
-
     int handle = VC8000_JPEG_Open_Instance();
     if (handle < 0)
     {
@@ -30,6 +30,8 @@
 
 #define LV_DEF_REFR_PERIOD              20
 #define CONFIG_LV_DISP_FULL_REFRESH     0
+#define CONFIG_LV_DISP_FLUSH_PDMA       1
+#define CONFIG_LV_DISP_TRIPLE_BUFFER    0
 
 #define lv_snprintf                     snprintf
 #define lv_vsnprintf                    vsnprintf
@@ -38,6 +38,7 @@ enum
 #define NU_PDMA_GET_BASE(ch)   (PDMA_T *)((((ch)/PDMA_CH_MAX)*0x10000U) + DEF_PDMA_BASE_START)
 #define NU_PDMA_GET_MOD_IDX(ch)   ((ch)/PDMA_CH_MAX)
 #define NU_PDMA_GET_MOD_CHIDX(ch)   ((ch)%PDMA_CH_MAX)
+#define NU_PDMA_STRIDE_CH_MAX       (sizeof(((PDMA_T *)0)->STRIDE) / sizeof(STRIDE_T))  /* Channels with stride mode */
 
 
 
@@ -712,19 +713,32 @@ static void _nu_pdma_transfer(int i32ChannID, uint32_t u32Peripheral, nu_pdma_de
             uint32_t u32SrcCtl    = (next->CTL & PDMA_DSCT_CTL_SAINC_Msk);
             uint32_t u32DstCtl    = (next->CTL & PDMA_DSCT_CTL_DAINC_Msk);
             uint32_t u32FlushLen  = u32TxCnt * u32DataWidth;
+            uint32_t u32SrcFlushLen = u32FlushLen;
+            uint32_t u32DstFlushLen = u32FlushLen;
+
+            /* A stride transfer spans its rows and the gaps between them. */
+            if ((next->CTL & PDMA_DSCT_CTL_STRIDEEN_Msk) && (NU_PDMA_GET_MOD_CHIDX(i32ChannID) < NU_PDMA_STRIDE_CH_MAX))
+            {
+                uint32_t u32RowCnt = (PDMA->STRIDE[NU_PDMA_GET_MOD_CHIDX(i32ChannID)].STCR & 0xFFFF) + 1;
+                uint32_t u32Gaps   = (u32TxCnt + u32RowCnt - 1) / u32RowCnt - 1;
+                uint32_t u32Asocr  = PDMA->STRIDE[NU_PDMA_GET_MOD_CHIDX(i32ChannID)].ASOCR;
+
+                u32SrcFlushLen += u32Gaps * (u32Asocr & 0xFFFF) * u32DataWidth;
+                u32DstFlushLen += u32Gaps * (u32Asocr >> 16) * u32DataWidth;
+            }
 
             /* Flush Src buffer into memory. */
             if ((u32SrcCtl == PDMA_SAR_INC)) // for M2P, M2M
             {
             	void const * addr = (void const * )((uint64_t)next->SA);
-            	dcache_clean_invalidate_by_mva(addr, u32FlushLen);
+            	dcache_clean_invalidate_by_mva(addr, u32SrcFlushLen);
             }
 
             /* Flush Dst buffer into memory. */
             if ((u32DstCtl == PDMA_DAR_INC)) // for P2M, M2M
             {
             	void const * addr = (void const * )((uint64_t)next->DA);
-            	dcache_clean_invalidate_by_mva(addr, u32FlushLen);
+            	dcache_clean_invalidate_by_mva(addr, u32DstFlushLen);
             }
 
             /* Flush descriptor into memory */
@@ -786,11 +800,30 @@ static void _nu_pdma_free_sgtbls(nu_pdma_chn_t *psPdmaChann)
     if (psPdmaChann->m_ppsSgtbl)
     {
         nu_pdma_sgtbls_free(psPdmaChann->m_ppsSgtbl, psPdmaChann->m_u32WantedSGTblNum);
+        nvt_free_align(psPdmaChann->m_ppsSgtbl);
         psPdmaChann->m_ppsSgtbl = NULL;
         psPdmaChann->m_u32WantedSGTblNum = 0;
     }
 }
 
+/* Keep u32Num SG tables for the channel, from the previous transfer if it used as many. */
+static int _nu_pdma_want_sgtbls(nu_pdma_chn_t *psPdmaChann, uint32_t u32Num)
+{
+    if (psPdmaChann->m_u32WantedSGTblNum == u32Num)
+        return 0;
+
+    if (psPdmaChann->m_u32WantedSGTblNum > 0)
+        _nu_pdma_free_sgtbls(psPdmaChann);
+
+    psPdmaChann->m_ppsSgtbl = (nu_pdma_desc_t *)nvt_malloc_align(sizeof(nu_pdma_desc_t) * u32Num, 4);
+    if (!psPdmaChann->m_ppsSgtbl)
+        return -1;
+
+    psPdmaChann->m_u32WantedSGTblNum = u32Num;
+
+    return nu_pdma_sgtbls_allocate(psPdmaChann->m_ppsSgtbl, u32Num);
+}
+
 static int _nu_pdma_transfer_chain(int i32ChannID, uint32_t u32DataWidth, uint32_t u32AddrSrc, uint32_t u32AddrDst, uint32_t u32TransferCnt, uint32_t u32IdleTimeout_us)
 {
     int i = 0;
@@ -805,21 +838,9 @@ static int _nu_pdma_transfer_chain(int i32ChannID, uint32_t u32DataWidth, uint32
 
     psPeriphCtl = &psPdmaChann->m_spPeripCtl;
 
-    if (psPdmaChann->m_u32WantedSGTblNum != (u32TransferCnt / NU_PDMA_MAX_TXCNT + 1))
-    {
-        if (psPdmaChann->m_u32WantedSGTblNum > 0)
-            _nu_pdma_free_sgtbls(psPdmaChann);
-
-        psPdmaChann->m_u32WantedSGTblNum = u32TransferCnt / NU_PDMA_MAX_TXCNT + 1;
-
-        psPdmaChann->m_ppsSgtbl = (nu_pdma_desc_t *)nvt_malloc_align(sizeof(nu_pdma_desc_t) * psPdmaChann->m_u32WantedSGTblNum, 4);
-        if (!psPdmaChann->m_ppsSgtbl)
-            goto exit__nu_pdma_transfer_chain;
-
-        ret = nu_pdma_sgtbls_allocate(psPdmaChann->m_ppsSgtbl, psPdmaChann->m_u32WantedSGTblNum);
-        if (ret != 0)
-            goto exit__nu_pdma_transfer_chain;
-    }
+    ret = _nu_pdma_want_sgtbls(psPdmaChann, u32TransferCnt / NU_PDMA_MAX_TXCNT + 1);
+    if (ret != 0)
+        goto exit__nu_pdma_transfer_chain;
 
     for (i = 0; i < psPdmaChann->m_u32WantedSGTblNum; i++)
     {
@@ -895,6 +916,80 @@ exit_nu_pdma_transfer:
     return -(ret);
 }
 
+int nu_pdma_transfer_2d(int i32ChannID, uint32_t u32DataWidth, uint32_t u32AddrSrc, uint32_t u32AddrDst, uint32_t u32Width, uint32_t u32Height, uint32_t u32SrcPitch, uint32_t u32DstPitch, uint32_t u32IdleTimeout_us)
+{
+    int ret = 1;
+    PDMA_T *PDMA = NU_PDMA_GET_BASE(i32ChannID);
+    uint32_t u32ModChannId = NU_PDMA_GET_MOD_CHIDX(i32ChannID);
+    uint32_t u32RowsPerDesc, u32DescNum, u32Rows, i;
+    nu_pdma_chn_t *psPdmaChann;
+    nu_pdma_desc_t head, desc;
+
+    if (nu_pdma_check_is_nonallocated(i32ChannID))
+        goto exit_nu_pdma_transfer_2d;
+    else if (u32ModChannId >= NU_PDMA_STRIDE_CH_MAX)
+        goto exit_nu_pdma_transfer_2d;
+    else if (!u32Width || !u32Height || (u32Width > NU_PDMA_MAX_TXCNT))
+        goto exit_nu_pdma_transfer_2d;
+    else if ((u32SrcPitch < u32Width) || ((u32SrcPitch - u32Width) > NU_PDMA_MAX_STRIDE_GAP) ||
+             (u32DstPitch < u32Width) || ((u32DstPitch - u32Width) > NU_PDMA_MAX_STRIDE_GAP))
+        goto exit_nu_pdma_transfer_2d;
+
+    psPdmaChann = &nu_pdma_chn_arr[i32ChannID - NU_PDMA_CH_Pos];
+
+    /* Every descriptor moves whole rows, the row shape is shared by the channel. */
+    u32RowsPerDesc = NU_PDMA_MAX_TXCNT / u32Width;
+    u32DescNum = (u32Height + u32RowsPerDesc - 1) / u32RowsPerDesc;
+
+    if (u32DescNum == 1)
+    {
+        head = &PDMA->DSCT[u32ModChannId];
+    }
+    else
+    {
+        if (_nu_pdma_want_sgtbls(psPdmaChann, u32DescNum) != 0)
+        {
+            _nu_pdma_free_sgtbls(psPdmaChann);
+            goto exit_nu_pdma_transfer_2d;
+        }
+        head = psPdmaChann->m_ppsSgtbl[0];
+    }
+
+    for (i = 0; i < u32DescNum; i++)
+    {
+        desc = (u32DescNum == 1) ? head : psPdmaChann->m_ppsSgtbl[i];
+        u32Rows = (u32Height > u32RowsPerDesc) ? u32RowsPerDesc : u32Height;
+
+        if (nu_pdma_desc_setup(i32ChannID,
+                               desc,
+                               u32DataWidth,
+                               u32AddrSrc,
+                               u32AddrDst,
+                               u32Rows * u32Width,
+                               ((i + 1) == u32DescNum) ? NULL : psPdmaChann->m_ppsSgtbl[i + 1],
+                               ((i + 1) == u32DescNum) ? 0 : 1) != 0) // Silent, w/o TD interrupt
+            goto exit_nu_pdma_transfer_2d;
+
+        desc->CTL |= PDMA_DSCT_CTL_STRIDEEN_Msk;
+
+        u32Height -= u32Rows;
+        u32AddrSrc += u32Rows * u32SrcPitch * (u32DataWidth / 8);
+        u32AddrDst += u32Rows * u32DstPitch * (u32DataWidth / 8);
+    }
+
+    /* Transfers of a row, then the transfers skipped to the next row. */
+    PDMA->STRIDE[u32ModChannId].STCR = u32Width - 1;
+    PDMA->STRIDE[u32ModChannId].ASOCR = ((u32DstPitch - u32Width) << 16) | (u32SrcPitch - u32Width);
+
+    _nu_pdma_transfer(i32ChannID, psPdmaChann->m_spPeripCtl.m_u32Peripheral, head, u32IdleTimeout_us);
+
+    ret = 0;
+
+exit_nu_pdma_transfer_2d:
+
+    return -(ret);
+}
+
 int nu_pdma_sg_transfer(int i32ChannID, nu_pdma_desc_t head, uint32_t u32IdleTimeout_us)
 {
     int ret = 1;
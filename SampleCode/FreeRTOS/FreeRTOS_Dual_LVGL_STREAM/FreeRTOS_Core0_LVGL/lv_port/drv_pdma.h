@@ -13,7 +13,7 @@
 #include "nu_misc.h"
 
 #ifndef NU_PDMA_SGTBL_POOL_SIZE
-    #define NU_PDMA_SGTBL_POOL_SIZE     (16)
+    #define NU_PDMA_SGTBL_POOL_SIZE     (64)
 #endif
 
 #define NU_PDMA_CAP_NONE                (0 << 0)
@@ -28,6 +28,7 @@
 
 #define NU_PDMA_SG_LIMITED_DISTANCE     ((PDMA_DSCT_NEXT_NEXT_Msk>>PDMA_DSCT_NEXT_NEXT_Pos)+1)
 #define NU_PDMA_MAX_TXCNT               ((PDMA_DSCT_CTL_TXCNT_Msk>>PDMA_DSCT_CTL_TXCNT_Pos)+1)
+#define NU_PDMA_MAX_STRIDE_GAP          (0xFFFF)
 
 typedef enum
 {
@@ -78,6 +79,9 @@ int nu_pdma_sg_transfer(int i32ChannID, nu_pdma_desc_t head, uint32_t u32IdleTim
 int nu_pdma_sgtbls_allocate(nu_pdma_desc_t *ppsSgtbls, int num);
 void nu_pdma_sgtbls_free(nu_pdma_desc_t *ppsSgtbls, int num);
 
+// For 2D (stride) memory-to-memory transfer; width and pitches in transfers
+int nu_pdma_transfer_2d(int i32ChannID, uint32_t u32DataWidth, uint32_t u32AddrSrc, uint32_t u32AddrDst, uint32_t u32Width, uint32_t u32Height, uint32_t u32SrcPitch, uint32_t u32DstPitch, uint32_t u32IdleTimeout_us);
+
 // For memory actor
 void *nu_pdma_memcpy(void *dest, void *src, unsigned int count);
 int nu_pdma_mempush(void *dest, void *src, uint32_t data_width, unsigned int transfer_count);
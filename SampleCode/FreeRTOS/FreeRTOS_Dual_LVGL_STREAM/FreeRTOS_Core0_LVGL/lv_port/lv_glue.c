@@ -122,7 +122,10 @@ void sysDelay(uint32_t ms)
     vTaskDelay(ms / portTICK_PERIOD_MS);
 }
 
-#if (CONFIG_LV_DISP_FULL_REFRESH==1)
+/* Both screen-sized buffer modes pace themselves on the blank count. */
+#define CONFIG_LCD_VSYNC_IRQ    ((CONFIG_LV_DISP_FULL_REFRESH==1) || (CONFIG_LV_DISP_TRIPLE_BUFFER==1))
+
+#if CONFIG_LCD_VSYNC_IRQ
 
 #define DISP_ENABLE_INT()     (DISP->DisplayIntrEnable |=  DISP_DisplayIntrEnable_DISP0_Msk)
 #define DISP_GET_INTSTS()     (DISP->DisplayIntr & DISP_DisplayIntr_DISP0_Msk)
@@ -207,7 +210,7 @@ int lcd_device_initialize(void)
                   LV_VER_RES_MAX,
                   ptr_to_u32(s_au8FrameBuf)) == 0);
 
-#if (CONFIG_LV_DISP_FULL_REFRESH==1)
+#if CONFIG_LCD_VSYNC_IRQ
     IRQ_SetHandler((IRQn_ID_t)DISP_IRQn, lcd_disp_handler);
     IRQ_Enable((IRQn_ID_t)DISP_IRQn);
     DISP_ENABLE_INT();
@@ -256,7 +259,7 @@ int lcd_device_control(int cmd, void *argv)
     }
     break;
 
-#if (CONFIG_LV_DISP_FULL_REFRESH==1)
+#if CONFIG_LCD_VSYNC_IRQ
     case evLCD_CTRL_WAIT_VSYNC:
     {
         volatile uint32_t next = s_vu32Displayblank + 1;
@@ -266,6 +269,13 @@ int lcd_device_control(int cmd, void *argv)
         }
     }
     break;
+
+    case evLCD_CTRL_GET_VSYNC_CNT:
+    {
+        LV_ASSERT(argv != NULL);
+        *((uint32_t *)argv) = s_vu32Displayblank;
+    }
+    break;
 #endif
 
     case evLCD_CTRL_RECT_UPDATE:
@@ -289,7 +299,7 @@ void lcd_device_close(void)
 
 int lcd_device_finalize(void)
 {
-#if (CONFIG_LV_DISP_FULL_REFRESH==1)
+#if CONFIG_LCD_VSYNC_IRQ
     IRQ_Disable((IRQn_ID_t)DISP_IRQn);
 #endif
 
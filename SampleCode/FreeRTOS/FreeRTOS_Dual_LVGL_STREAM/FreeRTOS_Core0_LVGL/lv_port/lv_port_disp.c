@@ -8,6 +8,7 @@
 
 #include "lvgl.h"
 #include "lv_glue.h"
+#include "drv_pdma.h"
 
 #if CONFIG_LV_DISP_FULL_REFRESH
 static void lv_port_disp_full(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
@@ -25,7 +26,231 @@ static void lv_port_disp_full(lv_display_t *disp, const lv_area_t *area, uint8_t
 
 #else
 
+#if CONFIG_LV_DISP_FLUSH_PDMA
+static int s_i32FlushChann = -1;
+static SemaphoreHandle_t s_xFlushDone = NULL;
+
+static void lv_port_disp_pdma_done(void *pvUserData, uint32_t u32Events)
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    if (u32Events & NU_PDMA_EVENT_ABORT)
+        nu_pdma_channel_terminate(s_i32FlushChann);
+
+    /* The draw buffer is free, LVGL goes on rendering into it. */
+    if (pvUserData)
+        lv_display_flush_ready((lv_display_t *)pvUserData);
+
+    xSemaphoreGiveFromISR(s_xFlushDone, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/* Without a channel the copies fall back to the CPU. */
+static void lv_port_disp_pdma_init(lv_display_t *disp)
+{
+    s_xFlushDone = xSemaphoreCreateBinary();
+    LV_ASSERT(s_xFlushDone != NULL);
+
+    s_i32FlushChann = nu_pdma_channel_allocate(PDMA_MEM);
+    if (s_i32FlushChann >= 0)
+    {
+        struct nu_pdma_chn_cb sChnCB;
+
+        sChnCB.m_eCBType = eCBType_Event;
+        sChnCB.m_pfnCBHandler = lv_port_disp_pdma_done;
+        sChnCB.m_pvUserData = (void *)disp;
+
+        nu_pdma_filtering_set(s_i32FlushChann, NU_PDMA_EVENT_ABORT | NU_PDMA_EVENT_TRANSFER_DONE);
+        nu_pdma_callback_register(s_i32FlushChann, &sChnCB);
+    }
+    LV_LOG_INFO("Flush with PDMA channel %d.", s_i32FlushChann);
+}
+#endif
+
+#if CONFIG_LV_DISP_TRIPLE_BUFFER
+
+/*
+ * Three screen-sized buffers in VRAM, rendered in turn with LVGL's direct mode.
+ * Only the invalidated areas are redrawn, so before a frame is rendered into the
+ * back buffer the tiles changed by the two frames since it was last shown are
+ * copied forward from the front buffer, except the ones the new frame redraws.
+ */
+#define TILE_SHIFT          6
+#define TILE_SIZE           (1 << TILE_SHIFT)
+#define TILE_COLS           ((LV_HOR_RES_MAX + TILE_SIZE - 1) >> TILE_SHIFT)
+#define TILE_ROWS           ((LV_VER_RES_MAX + TILE_SIZE - 1) >> TILE_SHIFT)
+
+#if (TILE_COLS > 31)
+    #error "A row of tiles must fit in the 32-bit tile mask"
+#endif
+
+static lv_draw_buf_t s_asFrameBuf[CONFIG_LCD_FB_NUM];
+static uint32_t s_au32Rendered[CONFIG_LCD_FB_NUM][TILE_ROWS];   /* Tiles drawn by the frame in each buffer */
+static uint32_t s_au32PanVsync[CONFIG_LCD_FB_NUM];              /* Blank count when each buffer was panned */
+static uint32_t s_au32Covered[TILE_ROWS];                       /* Tiles the coming frame redraws as a whole */
+static uint32_t s_u32Back = 1;                                  /* FB0 is on screen at start-up */
+
+static uint32_t lv_port_disp_vsync_count(void)
+{
+    uint32_t u32Count;
+
+    LV_ASSERT(lcd_device_control(evLCD_CTRL_GET_VSYNC_CNT, (void *)&u32Count) == 0);
+
+    return u32Count;
+}
+
+static uint32_t lv_port_disp_tile_bits(int32_t x1, int32_t x2)
+{
+    uint32_t u32Bits = 0xFFFFFFFFu >> (31 - (x2 - x1));
+
+    return u32Bits << x1;
+}
+
+/* Copy a rectangle of tiles from the front buffer into the back buffer. */
+static void lv_port_disp_copy_tiles(S_LCD_INFO *psLCDInfo, uint32_t u32Col, uint32_t u32Row, uint32_t u32Cols, uint32_t u32Rows)
+{
+    uint32_t x = u32Col << TILE_SHIFT;
+    uint32_t y = u32Row << TILE_SHIFT;
+    uint32_t w = LV_MIN(u32Cols << TILE_SHIFT, psLCDInfo->u32ResWidth - x);
+    uint32_t h = LV_MIN(u32Rows << TILE_SHIFT, psLCDInfo->u32ResHeight - y);
+    uint32_t u32Pitch = psLCDInfo->u32ResWidth * psLCDInfo->u32BytePerPixel;
+    uint32_t u32Offset = y * u32Pitch + x * psLCDInfo->u32BytePerPixel;
+    uint32_t u32Front = (s_u32Back + CONFIG_LCD_FB_NUM - 1) % CONFIG_LCD_FB_NUM;
+    uint8_t *pu8Src = (uint8_t *)s_asFrameBuf[u32Front].data + u32Offset;
+    uint8_t *pu8Dst = (uint8_t *)s_asFrameBuf[s_u32Back].data + u32Offset;
+    uint32_t i;
+
+#if CONFIG_LV_DISP_FLUSH_PDMA
+    if (s_i32FlushChann >= 0)
+    {
+        xSemaphoreTake(s_xFlushDone, 0);
+
+        /* The driver cleans the source and invalidates the destination lines. */
+        if (nu_pdma_transfer_2d(s_i32FlushChann,
+                                psLCDInfo->u32BytePerPixel * 8,
+                                ptr_to_u32(pu8Src),
+                                ptr_to_u32(pu8Dst),
+                                w, h, psLCDInfo->u32ResWidth, psLCDInfo->u32ResWidth, 0) == 0)
+        {
+            xSemaphoreTake(s_xFlushDone, portMAX_DELAY);
+            return;
+        }
+    }
+#endif
+
+    for (i = 0; i < h; i++)
+        lv_memcpy(pu8Dst + i * u32Pitch, pu8Src + i * u32Pitch, w * psLCDInfo->u32BytePerPixel);
+
+    dcache_clean_by_mva(pu8Dst, (h - 1) * u32Pitch + w * psLCDInfo->u32BytePerPixel);
+}
+
+static void lv_port_disp_event_cb(lv_event_t *e)
+{
+    lv_display_t *disp = (lv_display_t *)lv_event_get_current_target(e);
+    S_LCD_INFO *psLCDInfo = (S_LCD_INFO *)lv_display_get_driver_data(disp);
+
+    switch (lv_event_get_code(e))
+    {
+    case LV_EVENT_INVALIDATE_AREA:
+    {
+        const lv_area_t *area = (const lv_area_t *)lv_event_get_param(e);
+
+        /* Only tiles lying wholly inside the area are redrawn as a whole. */
+        int32_t x1 = (area->x1 + TILE_SIZE - 1) >> TILE_SHIFT;
+        int32_t y1 = (area->y1 + TILE_SIZE - 1) >> TILE_SHIFT;
+        int32_t x2 = (area->x2 == (int32_t)psLCDInfo->u32ResWidth - 1) ? (TILE_COLS - 1) : (((area->x2 + 1) >> TILE_SHIFT) - 1);
+        int32_t y2 = (area->y2 == (int32_t)psLCDInfo->u32ResHeight - 1) ? (TILE_ROWS - 1) : (((area->y2 + 1) >> TILE_SHIFT) - 1);
+
+        for (; (x1 <= x2) && (y1 <= y2); y1++)
+            s_au32Covered[y1] |= lv_port_disp_tile_bits(x1, x2);
+    }
+    break;
+
+    case LV_EVENT_RENDER_START:
+    {
+        uint32_t u32Prev = (s_u32Back + 1) % CONFIG_LCD_FB_NUM;
+        uint32_t u32Front = (s_u32Back + CONFIG_LCD_FB_NUM - 1) % CONFIG_LCD_FB_NUM;
+        uint32_t au32Copy[TILE_ROWS];
+        uint32_t u32Row, u32Col, u32Run, u32End;
+
+        /* The back buffer stays on screen until the frame after it has been latched. */
+        while ((int32_t)(lv_port_disp_vsync_count() - s_au32PanVsync[u32Prev]) <= 0)
+            vTaskDelay(1);
+
+        for (u32Row = 0; u32Row < TILE_ROWS; u32Row++)
+            au32Copy[u32Row] = (s_au32Rendered[u32Prev][u32Row] | s_au32Rendered[u32Front][u32Row]) & ~s_au32Covered[u32Row];
+
+        /* Grow each run of tiles downwards over the rows repeating it. */
+        for (u32Row = 0; u32Row < TILE_ROWS; u32Row++)
+        {
+            while (au32Copy[u32Row])
+            {
+                uint32_t u32Bits;
+
+                u32Col = __builtin_ctz(au32Copy[u32Row]);
+                u32Run = __builtin_ctz(~(au32Copy[u32Row] >> u32Col));
+                u32Bits = lv_port_disp_tile_bits(u32Col, u32Col + u32Run - 1);
+
+                for (u32End = u32Row; (u32End < TILE_ROWS) && ((au32Copy[u32End] & u32Bits) == u32Bits); u32End++)
+                    au32Copy[u32End] &= ~u32Bits;
+
+                lv_port_disp_copy_tiles(psLCDInfo, u32Col, u32Row, u32Run, u32End - u32Row);
+            }
+        }
+
+        lv_memzero(s_au32Rendered[s_u32Back], sizeof(s_au32Rendered[s_u32Back]));
+    }
+    break;
+
+    case LV_EVENT_REFR_READY:
+        lv_memzero(s_au32Covered, sizeof(s_au32Covered));
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void lv_port_disp_triple(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    S_LCD_INFO *psLCDInfo = (S_LCD_INFO *)lv_display_get_driver_data(disp);
+    uint32_t u32Pitch = psLCDInfo->u32ResWidth * psLCDInfo->u32BytePerPixel;
+    int32_t y;
+
+    /* px_map is the whole back buffer, the area is drawn in place. */
+    dcache_clean_by_mva(px_map + area->y1 * u32Pitch + area->x1 * psLCDInfo->u32BytePerPixel,
+                        (lv_area_get_height(area) - 1) * u32Pitch + lv_area_get_width(area) * psLCDInfo->u32BytePerPixel);
+
+    for (y = area->y1 >> TILE_SHIFT; y <= (area->y2 >> TILE_SHIFT); y++)
+        s_au32Rendered[s_u32Back][y] |= lv_port_disp_tile_bits(area->x1 >> TILE_SHIFT, area->x2 >> TILE_SHIFT);
+
+    if (lv_display_flush_is_last(disp))
+    {
+        /* The new address is latched at the next blank, nothing waits for it here. */
+        LV_ASSERT(lcd_device_control(evLCD_CTRL_PAN_DISPLAY, (void *)px_map) == 0);
+        s_au32PanVsync[s_u32Back] = lv_port_disp_vsync_count();
+
+        s_u32Back = (s_u32Back + 1) % CONFIG_LCD_FB_NUM;
+        lv_display_set_draw_buffers(disp, &s_asFrameBuf[s_u32Back], NULL);
+    }
+
+    lv_display_flush_ready(disp);
+}
+
+#else
+
 static void *buf3_next = NULL;
+
+#if CONFIG_LV_DISP_FLUSH_PDMA
+/* Sleep while the PDMA copies instead of spinning on the flushing flag. */
+static void lv_port_disp_flush_wait(lv_display_t *disp)
+{
+    LV_UNUSED(disp);
+
+    xSemaphoreTake(s_xFlushDone, portMAX_DELAY);
+}
+#endif
+
 static void lv_port_disp_partial(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
 {
 
@@ -38,6 +263,22 @@ static void lv_port_disp_partial(lv_display_t *disp, const lv_area_t *area, uint
     uint32_t *pDisp = (uint32_t *)nc_ptr(psLCDInfo->pvVramStartAddr + (LV_HOR_RES_MAX * area->y1 + area->x1) * sizeof(uint32_t));
     uint32_t *pSrc = (uint32_t *)px_map;
 
+#if CONFIG_LV_DISP_FLUSH_PDMA
+    if (s_i32FlushChann >= 0)
+    {
+        /* The previous copy is done, drop a completion nobody waited for. */
+        xSemaphoreTake(s_xFlushDone, 0);
+
+        /* Rows of w pixels from the draw buffer into the screen, lv_port_disp_pdma_done() signals the end. */
+        if (nu_pdma_transfer_2d(s_i32FlushChann,
+                                psLCDInfo->u32BytePerPixel * 8,
+                                ptr_to_u32(px_map),
+                                ptr_to_u32(psLCDInfo->pvVramStartAddr + (LV_HOR_RES_MAX * area->y1 + area->x1) * psLCDInfo->u32BytePerPixel),
+                                w, h, w, LV_HOR_RES_MAX, 0) == 0)
+            return;
+    }
+#endif
+
     for (y = 0; y < h; y++)
     {
         for (x = 0; x < w; x++)
@@ -54,11 +295,13 @@ static void lv_port_disp_partial(lv_display_t *disp, const lv_area_t *area, uint
 
 #endif
 
+#endif
+
 void lv_port_disp_init(void)
 {
     lv_display_t *disp;
     static S_LCD_INFO sLcdInfo = {0};
-    void *buf1, *buf2;
+    void *buf1;
     uint32_t u32FBSize;
 
     /* Initial display device */
@@ -68,7 +311,6 @@ void lv_port_disp_init(void)
 
     u32FBSize = sLcdInfo.u32ResHeight * sLcdInfo.u32ResWidth * sLcdInfo.u32BytePerPixel;
     buf1 = (void *)sLcdInfo.pvVramStartAddr;
-    buf2 = (void *)buf1 + u32FBSize;
 
     disp = lv_display_create(sLcdInfo.u32ResWidth, sLcdInfo.u32ResHeight);
     LV_ASSERT(disp != NULL);
@@ -76,18 +318,56 @@ void lv_port_disp_init(void)
     lv_display_set_driver_data(disp, &sLcdInfo);
 
 #if CONFIG_LV_DISP_FULL_REFRESH
+    void *buf2 = (void *)buf1 + u32FBSize;
+
     LV_LOG_INFO("Use two screen-size buffer, buf1: 0x%08x, buf2: 0x%08x: 0x%08x", buf1, buf2);
-    lv_color_format_t cf = lv_display_get_color_format(disp);
 
     lv_display_set_flush_cb(disp, lv_port_disp_full); /*Set a flush callback to draw to the display*/
     lv_display_set_buffers(disp, buf1, buf2, u32FBSize, LV_DISPLAY_RENDER_MODE_FULL); /*Set an initialized buffer*/
 
+#elif CONFIG_LV_DISP_TRIPLE_BUFFER
+    lv_color_format_t cf = lv_display_get_color_format(disp);
+    uint32_t u32Stride = lv_draw_buf_width_to_stride(sLcdInfo.u32ResWidth, cf);
+    uint32_t u32Now;
+    int i;
+
+    LV_ASSERT(sLcdInfo.u32VramSize >= (u32FBSize * CONFIG_LCD_FB_NUM));
+
+    for (i = 0; i < CONFIG_LCD_FB_NUM; i++)
+        LV_ASSERT(lv_draw_buf_init(&s_asFrameBuf[i], sLcdInfo.u32ResWidth, sLcdInfo.u32ResHeight, cf, u32Stride,
+                                   (void *)buf1 + i * u32FBSize, u32FBSize) == LV_RESULT_OK);
+
+    /* All buffers hold the same blank screen, so FB0 counts as latched already. */
+    u32Now = lv_port_disp_vsync_count();
+    for (i = 0; i < CONFIG_LCD_FB_NUM; i++)
+        s_au32PanVsync[i] = u32Now - 1;
+
+    LV_LOG_INFO("Use three screen-size buffer from 0x%08x, tile %dx%d.", buf1, TILE_SIZE, TILE_SIZE);
+
+    lv_display_set_flush_cb(disp, lv_port_disp_triple);
+    lv_display_set_draw_buffers(disp, &s_asFrameBuf[s_u32Back], NULL);
+    lv_display_set_render_mode(disp, LV_DISPLAY_RENDER_MODE_DIRECT);
+    lv_display_add_event_cb(disp, lv_port_disp_event_cb, LV_EVENT_ALL, NULL);
+
+#if CONFIG_LV_DISP_FLUSH_PDMA
+    /* Copies forward are waited for in the event handler. */
+    lv_port_disp_pdma_init(NULL);
+#endif
+
 #else
+    void *buf2 = (void *)buf1 + u32FBSize;
+
     buf3_next = (void *)(buf2 + u32FBSize);
 
     LV_LOG_INFO("Use two screen-size shadow buffer, 0x%08x, 0x%08x.", buf2, buf3_next);
 
     lv_display_set_flush_cb(disp, lv_port_disp_partial);               /*Set a flush callback to draw to the display*/
     lv_display_set_buffers(disp, buf2, buf3_next, u32FBSize, LV_DISPLAY_RENDER_MODE_PARTIAL); /*Set an initialized buffer*/
+
+#if CONFIG_LV_DISP_FLUSH_PDMA
+    lv_port_disp_pdma_init(disp);
+    if (s_i32FlushChann >= 0)
+        lv_display_set_flush_wait_cb(disp, lv_port_disp_flush_wait);
+#endif
 #endif
 }
@@ -0,0 +1,110 @@
+/**************************************************************************//**
+ * @file     main.c
+ * @brief    Benchmark the mbedTLS crypto primitives, TSI accelerated or in
+ *           software, from 16 bytes to 1 MB per message.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "NuMicro.h"
+#include "tsi_cmd.h"
+#include "common.h"
+#include "crypto_bench.h"
+
+/*
+ * The primitives run wherever mbedtls_config.h routes them. Build once as
+ * is for the TSI numbers, and once with the ALT modules of
+ * Library/CryptoAccelerator/mbedtls_config.h commented out for software.
+ */
+
+#define BENCH_MIN_MS    200     /* time spent on every row */
+
+static __ALIGNED(64) uint8_t s_buf[NU_BENCH_BUF_SIZE(NU_BENCH_MAX_SIZE)];
+
+void SYS_Init(void)
+{
+	/* Enable UART module clock */
+	CLK_EnableModuleClock(UART0_MODULE);
+
+	/* Select UART module clock source as SYSCLK1 and UART module clock divider as 15 */
+	CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL2_UART0SEL_SYSCLK1_DIV2, CLK_CLKDIV1_UART0(15));
+
+	/* enable Wormhole 1 clock */
+	CLK_EnableModuleClock(WH1_MODULE);
+
+	/* Set GPE multi-function pins for UART0 RXD and TXD */
+	SYS->GPE_MFPH &= ~(SYS_GPE_MFPH_PE14MFP_Msk | SYS_GPE_MFPH_PE15MFP_Msk);
+	SYS->GPE_MFPH |= (SYS_GPE_MFPH_PE14MFP_UART0_TXD | SYS_GPE_MFPH_PE15MFP_UART0_RXD);
+}
+
+static void print_row(const nu_bench_result *r, void *arg)
+{
+	(void)arg;
+
+	if (r->ret != 0)
+	{
+		sysprintf("%-18s %8d  failed -0x%x\n", r->name, r->size, -r->ret);
+		return;
+	}
+	sysprintf("%-18s %8d %9d %9d %5d.%d %10d %4d.%02d\n", r->name, r->size,
+	          r->opsPerSec, r->kBPerSec, r->cyclesPerByte10 / 10, r->cyclesPerByte10 % 10,
+	          (uint32_t)r->cyclesPerOp, r->roundTrips100 / 100, r->roundTrips100 % 100);
+}
+
+int32_t main(void)
+{
+	nu_bench_cfg cfg;
+	uint64_t t0;
+	int  ret;
+
+	/* Unlock protected registers */
+	SYS_UnlockReg();
+
+	/* Init System, IP clock and multi-function I/O */
+	SYS_Init();
+
+	/* Init UART0 for sysprintf */
+	UART_Open(UART0, 115200);
+
+	SystemCoreClockUpdate();
+
+	if (TSI_Init() != 0)
+	{
+		sysprintf("TSI Init failed!\n");
+		while (1);
+	}
+
+	sysprintf("MBEDTLS crypto benchmark, CPU @ %d Hz\n", SystemCoreClock);
+	sysprintf("ALT modules: %s\n\n", nu_bench_alts());
+	sysprintf("%-18s %8s %9s %9s %7s %10s %7s\n", "", "bytes", "op/s", "kB/s",
+	          "cyc/B", "cyc/op", "rt/op");
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.now = EL0_GetCurrentPhysicalValue;
+	cfg.tickHz = 12000000;
+	cfg.cpuHz = SystemCoreClock;
+	cfg.roundTrips = TSI_Get_Cmd_Count;
+	cfg.minMs = BENCH_MIN_MS;
+	cfg.maxSize = NU_BENCH_MAX_SIZE;
+	cfg.groups = NU_BENCH_ALL;
+	cfg.buf = s_buf;
+	cfg.report = print_row;
+
+	t0 = EL0_GetCurrentPhysicalValue();
+	ret = nu_bench_run(&cfg);
+	sysprintf("\nTotal elapsed time is %d ms\n", (uint32_t)((EL0_GetCurrentPhysicalValue() - t0) / 12000));
+
+	if (ret != 0)
+	{
+		sysprintf("Test fail!\n");
+	}
+	sysprintf("Test Done!\n");
+	while(1);
+
+}
+
+int mbedtls_platform_entropy_poll( void *data, unsigned char *output, size_t len, size_t *olen )
+{
+	return 0;
+}
@@ -8,7 +8,12 @@
  * Core0      Core1 (this core)
  *   A  <----->  B (Tx & Rx) (High freq. short packet)
  *   C  <----->  D (Tx & Rx) (Low freq. long packet)
- *   E  <----->  F (Tx & Rx) (CRC test)
+ *   E  <----->  F (Tx & Rx) (CRC test, ping-pong latency)
+ *
+ * Each task owns the Rx endpoint listed just before its Tx endpoint.
+ * RxIPI_IRQHandler wakes it with a task notification, there is no
+ * polling: press 'l' for the Core1 share of the E <-> F round trip,
+ * from RxIPI to the reply kicked, as percentiles.
  * 
  * @note     TIMER8/TIMER9 has been assigned to OpenAMP for IPI.
  *
@@ -29,20 +34,17 @@
 int ReadTaskB_cb(struct rpmsg_endpoint *ept, void *data, size_t len, uint32_t src, void *priv);
 int ReadTaskD_cb(struct rpmsg_endpoint *ept, void *data, size_t len, uint32_t src, void *priv);
 int ReadTaskF_cb(struct rpmsg_endpoint *ept, void *data, size_t len, uint32_t src, void *priv);
-void vPollTaskB( void *pvParameters );
 void vSendTaskB( void *pvParameters );
-void vPollTaskD( void *pvParameters );
 void vSendTaskD( void *pvParameters );
-void vPollTaskF( void *pvParameters );
 void vSendTaskF( void *pvParameters );
 
-/* User defined endpoints */
+/* User defined endpoints, an Rx endpoint is served by the task of the next one */
 struct amp_endpoint eptinst[] = {
-	{ {"eptA->B", EPT_TYPE_RX}, ReadTaskB_cb, vPollTaskB },        /* Task B */
+	{ {"eptA->B", EPT_TYPE_RX}, ReadTaskB_cb, NULL },              /* Task B */
 	{ {"eptB->A", EPT_TYPE_TX, TASKB_TX_SIZE}, NULL, vSendTaskB }, /* Task B */
-	{ {"eptC->D", EPT_TYPE_RX}, ReadTaskD_cb, vPollTaskD },        /* Task D */
+	{ {"eptC->D", EPT_TYPE_RX}, ReadTaskD_cb, NULL },              /* Task D */
 	{ {"eptD->C", EPT_TYPE_TX, TASKD_TX_SIZE}, NULL, vSendTaskD }, /* Task D */
-    { {"eptE->F", EPT_TYPE_RX}, ReadTaskF_cb, vPollTaskF },        /* Task F */
+    { {"eptE->F", EPT_TYPE_RX}, ReadTaskF_cb, NULL },              /* Task F */
 	{ {"eptF->E", EPT_TYPE_TX, TASKF_TX_SIZE}, NULL, vSendTaskF }, /* Task F */
 };
 char tx_bufB[TASKB_TX_SIZE];
@@ -51,7 +53,14 @@ char tx_bufD[TASKD_TX_SIZE];
 TaskHandle_t createTaskHandle;
 unsigned long throughput[4];
 
+/* Core1 part of the E <-> F ping-pong, 1 us bins */
+#define LAT_BINS        1000
+#define LAT_TICKS_US    12 /* global timer runs at 12 MHz */
+static uint32_t lat_hist[LAT_BINS + 1];
+static uint32_t lat_count, lat_max;
+
 #define rpmsgEpt_to_ampEpt(ept) metal_container_of(ept, struct amp_endpoint, ept)
+#define EPT_RX_BIT      0 /* notification bit of the Rx endpoint of a task */
 
 void UART16_Init()
 {
@@ -115,8 +124,11 @@ int amp_create_ept(struct rpmsg_device *rpdev, struct amp_endpoint *amp_ept)
         ret = -1;
     }
 
-    if(ret >= 0) {
+    if(ret >= 0 && amp_ept->task_fn) {
         xTaskCreate( amp_ept->task_fn, amp_ept->eptinfo.name, configMINIMAL_STACK_SIZE, &amp_ept->ept, tskIDLE_PRIORITY + 2, &amp_ept->taskHandle );
+    }
+
+    if(ret >= 0) {
         sysprintf("rpmsg%d: %s endpoint \"%s\" is created.\n", id++,
             (info->type == EPT_TYPE_TX) ? "Tx" : "Rx",
             info->name);
@@ -160,6 +172,9 @@ int amp_destroy_ept(struct amp_endpoint *amp_ept)
 
     if(amp_ept->taskHandle)
     {
+        /* Stop RxIPI from waking the task */
+        if(amp_ept != eptinst && amp_ept[-1].eptinfo.type == EPT_TYPE_RX && amp_ept[-1].ept.priv)
+            ma35_rpmsg_notify_task(&amp_ept[-1].ept, NULL, EPT_RX_BIT);
         vTaskDelete(amp_ept->taskHandle);
         amp_ept->taskHandle = NULL;
     }
@@ -190,6 +205,95 @@ int amp_close(void)
     return 0;
 }
 
+/**
+ * @brief Deliver everything RxIPI queued for an Rx endpoint,
+ *        its callback runs in the calling task
+ *
+ * @param ept Rx endpoint
+ */
+static void amp_rx_dispatch(struct rpmsg_endpoint *ept)
+{
+    int ret;
+
+    while(ept->priv && (ret = ma35_rpmsg_poll(ept)) != 0)
+    {
+        if(ret == RPMSG_ERR_PERM)
+        {
+            sysprintf("%s: Remote closed.\n", pcTaskGetName(NULL));
+            /* 1. do nothing and try reconnecting 2. call ma35_rpmsg_destroy_ept and exit */
+            // ma35_rpmsg_destroy_ept(ept);
+            // vTaskDelete(NULL);
+            break;
+        }
+        else if(ret == RPMSG_ERR_NO_BUFF)
+            sysprintf("%s: Rx buffer is full.\n", pcTaskGetName(NULL));
+        else if(ret < 0)
+            break;
+    }
+}
+
+/**
+ * @brief Serve the Rx endpoint until tick count xWake
+ *
+ * @param ept Rx endpoint of the calling task
+ * @param xWake tick count to return at
+ */
+static void amp_rx_wait_until(struct rpmsg_endpoint *ept, TickType_t xWake)
+{
+    TickType_t xLeft;
+
+    while((xLeft = xWake - xTaskGetTickCount()) != 0 && xLeft < (portMAX_DELAY >> 1))
+    {
+        if(ma35_rpmsg_wait(xLeft) & (1UL << EPT_RX_BIT))
+            amp_rx_dispatch(ept);
+    }
+}
+
+static void lat_record(uint64_t stamp)
+{
+    uint32_t us = (uint32_t)((EL0_GetCurrentPhysicalValue() - stamp) / LAT_TICKS_US);
+
+    lat_hist[us < LAT_BINS ? us : LAT_BINS]++;
+    lat_count++;
+    if(us > lat_max)
+        lat_max = us;
+}
+
+static void lat_report(void)
+{
+    static const uint32_t permille[] = { 500, 900, 990, 999 };
+    uint32_t i, bin, sum, rank;
+
+    if(!lat_count)
+    {
+        sysprintf("Latency: no ping-pong on \"eptE->F\" yet.\n");
+        return;
+    }
+
+    sysprintf("Latency RxIPI to reply (us), %d ping-pongs:", lat_count);
+    for(i = 0; i < sizeof(permille) / sizeof(permille[0]); i++)
+    {
+        rank = (uint32_t)(((uint64_t)lat_count * permille[i] + 999) / 1000);
+        for(bin = 0, sum = 0; bin < LAT_BINS; bin++)
+        {
+            sum += lat_hist[bin];
+            if(sum >= rank)
+                break;
+        }
+        if(bin < LAT_BINS)
+            sysprintf(" p%d.%d %d", permille[i] / 10, permille[i] % 10, bin);
+        else
+            sysprintf(" p%d.%d >%d", permille[i] / 10, permille[i] % 10, LAT_BINS);
+    }
+    sysprintf(" max %d\n", lat_max);
+}
+
+static void lat_reset(void)
+{
+    memset(lat_hist, 0, sizeof(lat_hist));
+    lat_count = lat_max = 0;
+}
+
 /**
  * @brief User Rx callback, do not call this directly.
  *        The function is called when a POLLIN event is received.
@@ -216,40 +320,18 @@ int ReadTaskB_cb(struct rpmsg_endpoint *ept, void *data, size_t len, uint32_t sr
 }
 
 /**
- * @brief User poll task, call ma35_rpmsg_poll to get status
- *
- * @param pvParameters ept
- */
-void vPollTaskB( void *pvParameters )
-{
-    int ret;
-
-    for( ;; )
-    {
-        ret = ma35_rpmsg_poll(pvParameters);
-        if(ret == RPMSG_ERR_PERM)
-        {
-            sysprintf("%s: Remote closed.\n", pcTaskGetName(NULL));
-            /* 1. do nothing and try reconnecting 2. call ma35_rpmsg_destroy_ept and exit */
-            // ma35_rpmsg_destroy_ept(pvParameters);
-            // vTaskDelete(NULL);
-        }
-        else if(ret == RPMSG_ERR_NO_BUFF)
-            sysprintf("%s: Rx buffer is full.\n", pcTaskGetName(NULL));
-
-        vTaskDelay(2);
-    }
-}
-
-/**
- * @brief User Tx task, call ma35_rpmsg_send to send data
+ * @brief User Tx task, call ma35_rpmsg_send to send data,
+ *        also delivers "eptA->B" when RxIPI wakes it
  *
  * @param pvParameters ept
  */
 void vSendTaskB( void *pvParameters )
 {
+	struct rpmsg_endpoint *eptRx = &(rpmsgEpt_to_ampEpt(pvParameters) - 1)->ept;
 	int i, ret, size, j = 0;
 
+    ma35_rpmsg_notify_task(eptRx, xTaskGetCurrentTaskHandle(), EPT_RX_BIT);
+
     for( ;; )
     {
         /* Start of user write function */
@@ -279,7 +361,7 @@ void vSendTaskB( void *pvParameters )
             throughput[1] += ret;
         }
 
-        vTaskDelay(10);
+        amp_rx_wait_until(eptRx, xTaskGetTickCount() + 10);
     }
 }
 
@@ -309,40 +391,18 @@ int ReadTaskD_cb(struct rpmsg_endpoint *ept, void *data, size_t len, uint32_t sr
 }
 
 /**
- * @brief User poll task, call ma35_rpmsg_poll to get status
- *
- * @param pvParameters ept
- */
-void vPollTaskD( void *pvParameters )
-{
-    int ret;
-
-    for( ;; )
-    {
-        ret = ma35_rpmsg_poll(pvParameters);
-        if(ret == RPMSG_ERR_PERM)
-        {
-            sysprintf("%s: Remote closed.\n", pcTaskGetName(NULL));
-            /* 1. do nothing and try reconnecting 2. call ma35_rpmsg_destroy_ept and exit */
-            // ma35_rpmsg_destroy_ept(pvParameters);
-            // vTaskDelete(NULL);
-        }
-        else if(ret == RPMSG_ERR_NO_BUFF)
-            sysprintf("%s: Rx buffer is full.\n", pcTaskGetName(NULL));
-
-        vTaskDelay(10);
-    }
-}
-
-/**
- * @brief User Tx task, call ma35_rpmsg_send to send data
+ * @brief User Tx task, call ma35_rpmsg_send to send data,
+ *        also delivers "eptC->D" when RxIPI wakes it
  *
  * @param pvParameters ept
  */
 void vSendTaskD( void *pvParameters )
 {
+	struct rpmsg_endpoint *eptRx = &(rpmsgEpt_to_ampEpt(pvParameters) - 1)->ept;
 	int i, ret, size, j = 0;
 
+    ma35_rpmsg_notify_task(eptRx, xTaskGetCurrentTaskHandle(), EPT_RX_BIT);
+
     for( ;; )
     {
         /* Start of user write function */
@@ -372,7 +432,7 @@ void vSendTaskD( void *pvParameters )
             throughput[3] += ret;
         }
 
-        vTaskDelay(100);
+        amp_rx_wait_until(eptRx, xTaskGetTickCount() + 100);
     }
 }
 
@@ -393,67 +453,41 @@ int ReadTaskF_cb(struct rpmsg_endpoint *ept, void *data, size_t len, uint32_t sr
     struct amp_endpoint *eptRead = rpmsgEpt_to_ampEpt(ept);
     struct amp_endpoint *eptSend = eptRead + 1;
 	char *rxbuf = data;
-	int rxlen = len;
+	int rxlen = len, ret;
 	(void)src;
 	(void)priv;
 
     /* Start of user read function */
     uint32_t crc_cal = crc32(0UL, rxbuf, rxlen);
-    // signal to vSendTaskF
-    xTaskNotify(eptSend->taskHandle, crc_cal, eSetValueWithOverwrite);
+    // runs in vSendTaskF, reply right away
+    ret = ma35_rpmsg_send(&eptSend->ept, &crc_cal, sizeof(crc_cal));
+    if(ret < 0) {
+        if(ret == RPMSG_ERR_NO_BUFF)
+            sysprintf("%s: Tx blocking.\n", pcTaskGetName(NULL));
+    }
+    else
+        lat_record(ma35_rpmsg_rx_stamp(ept));
     /* End of user read function */
 
 	return RPMSG_SUCCESS;
 }
 
 /**
- * @brief User poll task, call ma35_rpmsg_poll to get status
- *
- * @param pvParameters ept
- */
-void vPollTaskF( void *pvParameters )
-{
-    int ret;
-
-    for( ;; )
-    {
-        ret = ma35_rpmsg_poll(pvParameters);
-        if(ret == RPMSG_ERR_PERM)
-        {
-            sysprintf("%s: Remote closed.\n", pcTaskGetName(NULL));
-            /* 1. do nothing and try reconnecting 2. call ma35_rpmsg_destroy_ept and exit */
-            // ma35_rpmsg_destroy_ept(pvParameters);
-            // vTaskDelete(NULL);
-        }
-        else if(ret == RPMSG_ERR_NO_BUFF)
-            sysprintf("%s: Rx buffer is full.\n", pcTaskGetName(NULL));
-
-        vTaskDelay(100);
-    }
-}
-
-/**
- * @brief User Tx task, call ma35_rpmsg_send to send data
+ * @brief User Tx task, ReadTaskF_cb sends the replies
  *
  * @param pvParameters ept
  */
 void vSendTaskF( void *pvParameters )
 {
-	int i, ret, size = sizeof(uint32_t);
-    uint32_t txbuf;
+	struct rpmsg_endpoint *eptRx = &(rpmsgEpt_to_ampEpt(pvParameters) - 1)->ept;
+
+    ma35_rpmsg_notify_task(eptRx, xTaskGetCurrentTaskHandle(), EPT_RX_BIT);
 
     for( ;; )
     {
-        /* Start of user write function */
-        // This task is woken up by ReadTaskF_cb
-        txbuf = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-        /* End of user write function */
-
-        ret = ma35_rpmsg_send(pvParameters, &txbuf, size);
-        if(ret < 0) {
-            if(ret == RPMSG_ERR_NO_BUFF)
-                sysprintf("%s: Tx blocking.\n", pcTaskGetName(NULL));
-        }
+        // This task is woken up by RxIPI_IRQHandler
+        if(ma35_rpmsg_wait(portMAX_DELAY) & (1UL << EPT_RX_BIT))
+            amp_rx_dispatch(eptRx);
     }
 }
 
@@ -519,6 +553,9 @@ void vCmdTask( void *pvParameters )
                 case 'h':
                     sysprintf("Heap available: %d bytes\n", xPortGetFreeHeapSize());
                     break;
+                case 'l':
+                    lat_report();
+                    break;
                 case 'r':
                     sysprintf("Restart tasks.\n");
                     amp_close();
@@ -534,6 +571,7 @@ void vCmdTask( void *pvParameters )
                 case 'z':
                     stattick = 0;
                     throughput[0] = throughput[1] = throughput[2] = throughput[3] = 0;
+                    lat_reset();
                     sysprintf("Reset statistics.\n");
                     break;
                 default:
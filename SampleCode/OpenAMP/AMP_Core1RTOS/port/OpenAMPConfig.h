@@ -59,11 +59,12 @@ int ma35_rpmsg_create_rxept(struct rpmsg_endpoint *ept, struct rpmsg_device *rde
 int ma35_rpmsg_destroy_ept(struct rpmsg_endpoint *ept);
 
 /**
- * @brief Receive data by rx endpoint
- *        poll for head or remote close
+ * @brief Receive data by rx endpoint, never blocks
+ *        deliver one message or remote close queued by RxIPI_IRQHandler
  *        this function calls user callback if data is ready
  * @param ept 
  * @return "true" for success
+ *         "0" if nothing is queued
  *         "RPMSG_ERR_PERM" if remote endpoint closed
  *         - 1. Do nothing and try reconnecting 2. Destroy and exit
  *         "RPMSG_ERR_NO_BUFF" if rx buffer is full
@@ -71,6 +72,36 @@ int ma35_rpmsg_destroy_ept(struct rpmsg_endpoint *ept);
  */
 int ma35_rpmsg_poll(struct rpmsg_endpoint *ept);
 
+/**
+ * @brief Wake a task on rx endpoint events
+ *        RxIPI_IRQHandler sets "bit" in the notification value of "task"
+ *        when data arrives or the remote closes, the task collects the
+ *        bits with ma35_rpmsg_wait and calls ma35_rpmsg_poll until it
+ *        returns 0 for every endpoint flagged.
+ * @param ept  rx endpoint
+ * @param task owning task, NULL to stop notifying
+ * @param bit  0 ~ 31, one per endpoint of the task
+ * @return int 0 for success
+ */
+int ma35_rpmsg_notify_task(struct rpmsg_endpoint *ept, TaskHandle_t task, int bit);
+
+/**
+ * @brief Block the calling task until one of its rx endpoints has events
+ *
+ * @param ticks longest wait
+ * @return uint32_t bitmap of endpoints to poll, 0 on timeout
+ */
+uint32_t ma35_rpmsg_wait(TickType_t ticks);
+
+/**
+ * @brief Global timer count when RxIPI received the message being
+ *        delivered, valid in the rx callback
+ *
+ * @param ept rx endpoint
+ * @return uint64_t EL0 physical count
+ */
+uint64_t ma35_rpmsg_rx_stamp(struct rpmsg_endpoint *ept);
+
 /**
  * @brief Send data by tx endpoint
  * 
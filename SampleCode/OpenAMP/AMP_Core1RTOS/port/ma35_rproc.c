@@ -24,10 +24,10 @@
 extern void *resource_table_shmem;
 
 void RxIPI_IRQHandler(void);
-static int ma35_rpmsg_receive(struct rpmsg_endpoint_priv *ept_priv);
+static int ma35_rpmsg_receive(struct rpmsg_endpoint_priv *ept_priv, uint64_t stamp, BaseType_t *woken);
 static int check_tx_bind_ready(struct rpmsg_endpoint_priv *ept_priv);
 static int check_rx_bind_ready(struct rpmsg_endpoint_priv *ept_priv);
-static int ma35_rpmsg_reconnect_ept(struct rpmsg_endpoint_priv *ept_priv);
+static int ma35_rpmsg_reconnect_ept(struct rpmsg_endpoint_priv *ept_priv, BaseType_t *woken);
 static int ma35_desc_init(struct remoteproc_priv *priv);
 
 /**
@@ -69,6 +69,8 @@ ma35_rproc_init(struct remoteproc *rproc,
 	/* Init HW here to support IPI */
 	IRQ_SetHandler((IRQn_ID_t)RXIPI_IRQ_NUM, RxIPI_IRQHandler);
 	IRQ_SetTarget(RXIPI_IRQ_NUM, IRQ_CPU_1);
+	/* Handler wakes tasks, keep it within FreeRTOS API priorities */
+	IRQ_SetPriority((IRQn_ID_t)RXIPI_IRQ_NUM, configMAX_API_CALL_INTERRUPT_PRIORITY << portPRIORITY_SHIFT);
 	IRQ_Enable((IRQn_ID_t)RXIPI_IRQ_NUM);
 
 	/* Rx handler is registered by remote */
@@ -148,6 +150,8 @@ void RxIPI_IRQHandler(void)
 	struct remote_resource_table *rsc_table = resource_table_shmem;
 	struct rpmsg_endpoint_priv *ept_priv;
 	struct rsc_table_desc *desc;
+	uint64_t stamp = EL0_GetCurrentPhysicalValue();
+	BaseType_t woken = pdFALSE;
 
 	if(TIMER_GetIntFlag(RXIPI_BASE) == 1)
 		TIMER_ClearIntFlag(RXIPI_BASE);
@@ -183,16 +187,21 @@ void RxIPI_IRQHandler(void)
 				desc->STS = VRING_DESC_STS_READING;
 				if(ept_priv->cmd & VRING_DESC_CMD_HEAD)
 				{
-					if(ma35_rpmsg_receive(ept_priv) != RPMSG_SUCCESS)
+					if(ma35_rpmsg_receive(ept_priv, stamp, &woken) != RPMSG_SUCCESS)
 						continue;
 				}
 				else if(ept_priv->cmd & VRING_DESC_CMD_CLOSE)
 				{
-					ma35_rpmsg_reconnect_ept(ept_priv);
+					ma35_rpmsg_reconnect_ept(ept_priv, &woken);
 				}
+				/* Wake the owner, one bit per endpoint */
+				if(ept_priv->owner)
+					xTaskNotifyFromISR(ept_priv->owner, ept_priv->notify_bit, eSetBits, &woken);
 			}
 		}
 	}
+
+	portYIELD_FROM_ISR(woken);
 }
 
 // Use timer to generate INT to remote
@@ -333,6 +342,7 @@ int ma35_rpmsg_poll(struct rpmsg_endpoint *ept)
 	{
 		if(rxqueue.cmd & VRING_DESC_CMD_HEAD)
 		{
+			ept_priv->rx_stamp = rxqueue.stamp;
 			if(ept->cb)
 				ept->cb(ept, rxqueue.rxbuf, rxqueue.len, 0, NULL);
 
@@ -353,6 +363,45 @@ int ma35_rpmsg_poll(struct rpmsg_endpoint *ept)
 	return 0;
 }
 
+int ma35_rpmsg_notify_task(struct rpmsg_endpoint *ept, TaskHandle_t task, int bit)
+{
+	struct rpmsg_endpoint_priv *ept_priv;
+
+	if(!ept || !ept->priv || bit < 0 || bit > 31)
+		return RPMSG_ERR_PARAM;
+
+	ept_priv = ept->priv;
+	if(ept_priv->ept_type != EPT_TYPE_RX)
+		return RPMSG_EOPNOTSUPP;
+
+	taskENTER_CRITICAL();
+	ept_priv->notify_bit = 1UL << bit;
+	ept_priv->owner = task;
+	taskEXIT_CRITICAL();
+
+	/* Pick up what was queued before the owner was known */
+	if(task && uxQueueMessagesWaiting(ept_priv->xQueue))
+		xTaskNotify(task, ept_priv->notify_bit, eSetBits);
+
+	return 0;
+}
+
+uint32_t ma35_rpmsg_wait(TickType_t ticks)
+{
+	uint32_t pending = 0;
+
+	xTaskNotifyWait(0, ~0UL, &pending, ticks);
+
+	return pending;
+}
+
+uint64_t ma35_rpmsg_rx_stamp(struct rpmsg_endpoint *ept)
+{
+	struct rpmsg_endpoint_priv *ept_priv = ept->priv;
+
+	return ept_priv ? ept_priv->rx_stamp : 0;
+}
+
 static int ma35_rpmsg_desc_reset(struct rpmsg_endpoint *ept)
 {
 	struct rpmsg_endpoint_priv *ept_priv;
@@ -516,7 +565,7 @@ static int check_tx_bind_ready(struct rpmsg_endpoint_priv *ept_priv)
 		return RPMSG_ERR_NO_BUFF;
 	else if(desc->STS == VRING_DESC_STS_CLOSE)
 	{
-		ma35_rpmsg_reconnect_ept(ept_priv);
+		ma35_rpmsg_reconnect_ept(ept_priv, NULL);
 		return RPMSG_ERR_PERM;
 	}
 
@@ -534,7 +583,7 @@ static int check_rx_bind_ready(struct rpmsg_endpoint_priv *ept_priv)
 	return RPMSG_SUCCESS;
 }
 
-static int ma35_kill_ns_bind(struct rpmsg_endpoint_priv *ept_priv)
+static int ma35_kill_ns_bind(struct rpmsg_endpoint_priv *ept_priv, BaseType_t *woken)
 {
 	struct rsc_table_desc *rxdesc;
 	struct rxbuf_queue_t rxqueue;
@@ -552,7 +601,7 @@ static int ma35_kill_ns_bind(struct rpmsg_endpoint_priv *ept_priv)
 
 	rxqueue.cmd = ept_priv->cmd;
 	// No matter success or not
-	xQueueSend(ept_priv->xQueue, &rxqueue, QUEUE_WAIT_TICK);
+	xQueueSendFromISR(ept_priv->xQueue, &rxqueue, woken);
 	rxdesc->STS = VRING_DESC_STS_CLOSE;
 
 	return RPMSG_SUCCESS;
@@ -574,7 +623,7 @@ int ma35_rpmsg_send(struct rpmsg_endpoint *ept, const void *data, int len)
 		return RPMSG_EOPNOTSUPP;
 }
 
-static int ma35_rpmsg_receive(struct rpmsg_endpoint_priv *ept_priv)
+static int ma35_rpmsg_receive(struct rpmsg_endpoint_priv *ept_priv, uint64_t stamp, BaseType_t *woken)
 {
 	struct rsc_table_desc *desc;
 	struct rxbuf_queue_t rxqueue;
@@ -596,8 +645,9 @@ static int ma35_rpmsg_receive(struct rpmsg_endpoint_priv *ept_priv)
 	rxqueue.len = rxlen;
 	rxqueue.cmd = ept_priv->cmd;
 	rxqueue.id = ept_priv->poolid;
+	rxqueue.stamp = stamp;
 	// enqueue to rx queue
-	if(xQueueSend(ept_priv->xQueue, &rxqueue, QUEUE_WAIT_TICK) != pdTRUE)
+	if(xQueueSendFromISR(ept_priv->xQueue, &rxqueue, woken) != pdTRUE)
 	{
 		// queue is full, flow control on queue
 		ma35_rpmsg_receive_status(ept_priv, VRING_DESC_STS_ERR);
@@ -769,7 +819,7 @@ static int ma35_rpmsg_request_shmem(struct rpmsg_endpoint *ept, struct rpmsg_dev
 	return ret;
 }
 
-static int ma35_rpmsg_reconnect_ept(struct rpmsg_endpoint_priv *ept_priv)
+static int ma35_rpmsg_reconnect_ept(struct rpmsg_endpoint_priv *ept_priv, BaseType_t *woken)
 {
 	struct rsc_table_desc *desc;
 
@@ -786,7 +836,7 @@ static int ma35_rpmsg_reconnect_ept(struct rpmsg_endpoint_priv *ept_priv)
 	}
 	else // EPT_TYPE_RX
 	{
-		ma35_kill_ns_bind(ept_priv);
+		ma35_kill_ns_bind(ept_priv, woken);
 	}
 
 	// ept reset finished, add to list
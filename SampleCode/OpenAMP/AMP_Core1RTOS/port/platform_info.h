@@ -15,6 +15,7 @@
 #include <openamp/rpmsg.h>
 
 #include "FreeRTOS.h"
+#include "task.h"
 #include "queue.h"
 
 #if defined __cplusplus
@@ -52,6 +53,7 @@ struct rxbuf_queue_t {
 	int len;
 	uint8_t cmd;
 	uint8_t id;
+	uint64_t stamp; // global timer count at RxIPI
 };
 
 struct rpmsg_endpoint_priv {
@@ -75,6 +77,9 @@ struct rpmsg_endpoint_priv {
 	void *rxns;
 	void **rxpool; // pre-allocated buffer pool
 	int poolid;
+	TaskHandle_t owner; // task woken by RxIPI, NULL if polled
+	uint32_t notify_bit; // bit set in owner's notification value
+	uint64_t rx_stamp; // RxIPI time of the message being delivered
 };
 
 struct rpmsg_endpoint_info{
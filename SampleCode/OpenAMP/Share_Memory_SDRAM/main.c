@@ -11,6 +11,7 @@
 #include "rpmsg.h"
 #include "openamp.h"
 #include "mbox_whc.h"
+#include "shm_ring.h"
 
 #define TEST_SECONDS    10
 #define TX_RX_SIZE      SHM_TX_RX_SIZE
@@ -31,6 +32,7 @@ uint32_t g_au32RxBuf[WHC_BUFFER_LEN];
 uint32_t g_au32TxBuf[WHC_BUFFER_LEN];
 
 static uint32_t rx_status = 0;
+static uint32_t rx_len = 0;
 static volatile uint64_t _start_time = 0;
 
 static int rx_callback(struct rpmsg_endpoint *rp_chnl, void *data, size_t len, uint32_t src, void *priv);
@@ -110,7 +112,8 @@ static int rx_callback(struct rpmsg_endpoint *rp_chnl, void *data, size_t len, u
             start_timer();
         }
 
-        memcpy((void *)((char *)received_rpmsg), (const void *) ((u64)src), len > sizeof(received_rpmsg) ? sizeof(received_rpmsg) : len);
+        rx_len = len > sizeof(received_rpmsg) ? sizeof(received_rpmsg) : len;
+        memcpy((void *)((char *)received_rpmsg), (const void *) ((u64)src | NON_CACHE), rx_len);
 
 #ifdef CHECK_RX_DATA
         /* !! Note: sysprintf will reduce performance. */
@@ -131,7 +134,8 @@ static int rx_callback(struct rpmsg_endpoint *rp_chnl, void *data, size_t len, u
 int main()
 {
     struct rpmsg_endpoint resmgr_ept;
-    uint32_t i, ret, u32ImageSize;
+    uint32_t i, u32ImageSize, u32MsgSize;
+    int ret;
     uint64_t t0;
 
     global_timer_init();
@@ -184,6 +188,18 @@ int main()
             break;
     }
 
+    /* A message fills one ring slot, or the whole TX buffer without rings */
+    if (Mbox_Ring_Enabled())
+    {
+        u32MsgSize = SHM_RING_SLOT_SIZE;
+        sysprintf("# Message ring: %d slots of %d bytes\n\n", SHM_RING_SLOTS, (int)SHM_RING_SLOT_SIZE);
+    }
+    else
+    {
+        u32MsgSize = TX_RX_SIZE;
+        sysprintf("# Message ring not supported by RTP, one message per ACK\n\n");
+    }
+
     start_timer();
     u32TxSize = 0;
     while (1)
@@ -192,8 +208,8 @@ int main()
         if (t0 >= (TEST_SECONDS * 1000))
             break;
 
-        /* Send message to RTP M4 and wait RTP M4 response ACK */
-        ret = OPENAMP_send_data(&resmgr_ept, transmit_rpmsg, TX_RX_SIZE);
+        /* Queue message to RTP M4, wait while the ring is full or for the ACK without ring */
+        ret = OPENAMP_send_data(&resmgr_ept, transmit_rpmsg, u32MsgSize);
         if (ret < 0)
         {
             sysprintf("Failed to send message\r\n");
@@ -210,6 +226,10 @@ int main()
         u32TxSize += ret;
     }
 
+    /* Count the time until RTP M4 has consumed the queued messages */
+    while (OPENAMP_check_TxDone(&resmgr_ept) != 1);
+    t0 = get_ticks();
+
     sysprintf("# Transfer Time (ms)  : %d\n", t0);
     sysprintf("# Transfer Size (byte): %d\n", u32TxSize);
     sysprintf("# Transfer Speed (B/s): %d\n\n", u32TxSize / t0 * 1000);
@@ -249,7 +269,7 @@ int main()
 
 #ifdef CHECK_RX_DATA
             /* !! Note: comparing will reduce performance. */
-            for (i = 0; i < TX_RX_SIZE; i++)
+            for (i = 0; i < rx_len; i++)
             {
                 if (received_rpmsg[i] != (i %256))
                 {
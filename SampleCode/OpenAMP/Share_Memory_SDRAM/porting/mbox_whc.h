@@ -13,10 +13,22 @@
 #define COMMAND_SEND_MSG_TO_M4         0x80
 #define COMMAND_RECEIVE_M4_ACK         0x81
 
+/* Doorbells of the message rings, sent when a ring turns non-empty */
+#define COMMAND_RECEIVE_M4_RING        0x62
+#define COMMAND_SEND_RING_TO_M4        0x82
+
 #define COMMAND_SEND_TEST_START_TO_M4  0x90
 #define COMMAND_SEND_TEST_TX_TO_M4     0x91
 #define COMMAND_SEND_TEST_RX_TO_M4     0x92
 
+/*
+ * The A35 offers the rings in word 2 of its first command, an RTP that
+ * supports them resets both rings and answers with the same value in word 1
+ * of the ACK. Without that answer every message goes through the single
+ * TX/RX buffer and waits for its ACK.
+ */
+#define SHM_RING_MAGIC                 0x474E4952  /* "RING" */
+
 
 #define RX_NO_MSG           1
 #define RX_NEW_MSG          2
@@ -27,6 +39,7 @@
 int Mbox_Notify(void *priv, uint32_t id);
 int Mbox_Init(void);
 int Mbox_Poll(struct rpmsg_endpoint *ept);
+int Mbox_Ring_Enabled(void);
 
 
 #endif /* MAILBOX_WHC_H_ */
@@ -8,6 +8,7 @@
  
 #include "openamp.h"
 #include "rsc_table.h"
+#include "shm_ring.h"
 #include "metal/sys.h"
 #include "metal/device.h"
 
@@ -17,6 +18,7 @@
 
 /* Globals */
 extern uint32_t WHC0_TX_Flag;
+extern SHM_RING_T g_TxRing;
 extern uint8_t u8RxStart;
 
 static struct metal_io_region *shm_io;
@@ -156,12 +158,41 @@ void OPENAMP_check_for_message(struct rpmsg_endpoint *ept)
     Mbox_Poll(ept);
 }
 
+static int OPENAMP_send_ring(const void *data, uint32_t u32Len)
+{
+    uint32_t au32TxBuf[WHC_BUFFER_LEN] = { COMMAND_SEND_RING_TO_M4, 0, 0, 0 };
+    void *pvSlot;
+
+    /* A message is never split or cut, the caller sizes it to a slot */
+    if (u32Len > SHM_RING_SLOT_SIZE)
+        return -1;
+
+    pvSlot = shm_ring_alloc(&g_TxRing);
+    if (pvSlot == NULL)
+        return 0;
+
+    memcpy(pvSlot, data, u32Len);
+
+    /* Ring the doorbell only when the RTP may have gone idle */
+    if (shm_ring_publish(&g_TxRing, u32Len))
+    {
+        while ((WHC0->TXSTS & (1ul << mbox_ch)) == 0);
+        WHC_Send(WHC0, mbox_ch, au32TxBuf);
+    }
+
+    return (int)u32Len;
+}
+
 int OPENAMP_send_data(struct rpmsg_endpoint *ept, const void *data, int len)
 {
     uint32_t u32TX_Length = len;
     uint32_t au32TxBuf[WHC_BUFFER_LEN];
     uint32_t i;
 
+    /* Messages are queued, commands still wait for their ACK */
+    if ((len != 0) && Mbox_Ring_Enabled())
+        return OPENAMP_send_ring(data, (uint32_t)len);
+
     if (len > SHM_TX_RX_SIZE)
         u32TX_Length = SHM_TX_RX_SIZE;
 
@@ -181,6 +212,9 @@ int OPENAMP_send_data(struct rpmsg_endpoint *ept, const void *data, int len)
             au32TxBuf[0] = COMMAND_SEND_TEST_START_TO_M4;
             au32TxBuf[1] = COMMAND_SEND_TEST_RX_TO_M4;
         }
+        /* Offer the message rings */
+        au32TxBuf[2] = SHM_RING_MAGIC;
+        au32TxBuf[3] = 0;
     }
     else
     {
@@ -199,11 +233,26 @@ int OPENAMP_send_data(struct rpmsg_endpoint *ept, const void *data, int len)
     return (int)u32TX_Length;
 }
 
+/* The last command is acknowledged and another message can be sent */
 int OPENAMP_check_TxAck(struct rpmsg_endpoint *ept)
 {
-    if (WHC0_TX_Flag == TX_ACK)
-        return 1;
-    else
+    if (WHC0_TX_Flag != TX_ACK)
+        return 0;
+
+    if (Mbox_Ring_Enabled() && (shm_ring_count(&g_TxRing) >= SHM_RING_SLOTS))
         return 0;
+
+    return 1;
 }
 
+/* Everything sent so far has been consumed by the RTP */
+int OPENAMP_check_TxDone(struct rpmsg_endpoint *ept)
+{
+    if (WHC0_TX_Flag != TX_ACK)
+        return 0;
+
+    if (Mbox_Ring_Enabled() && (shm_ring_count(&g_TxRing) != 0))
+        return 0;
+
+    return 1;
+}
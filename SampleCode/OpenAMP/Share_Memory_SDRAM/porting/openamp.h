@@ -38,10 +38,16 @@ void OPENAMP_check_for_message(struct rpmsg_endpoint *ept);
 /* Wait loop on endpoint ready ( message dest address is know)*/
 void OPENAMP_Wait_EndPointready(struct rpmsg_endpoint *rp_ept);
 
+/* Send len bytes, returns the bytes sent, 0 while the TX ring is full,
+   -1 if len exceeds SHM_RING_SLOT_SIZE once the rings are enabled */
 int OPENAMP_send_data(struct rpmsg_endpoint *ept, const void *data, int len);
 
+/* The last command is acknowledged and another message can be sent */
 int OPENAMP_check_TxAck(struct rpmsg_endpoint *ept);
 
+/* Every message sent has been consumed */
+int OPENAMP_check_TxDone(struct rpmsg_endpoint *ept);
+
 #ifdef __cplusplus
 }
 #endif
@@ -29,15 +29,13 @@
 #endif /* MAILBOX_WHC_IF_ENABLED */
 
 #if defined(__CC_ARM) || (defined(__ARMCC_VERSION) && (__ARMCC_VERSION >= 6010050))
-
-#define Shere_Memory_Size 128*2
-static uint32_t Shere_Memory__[Shere_Memory_Size];
-
-#define SHM_START_ADDRESS       (metal_phys_addr_t)(0x2401ff00)
+/* RTP M4 view (RTP/main.c): the same DDR, the A35 TX buffer is its RX buffer */
+#define Shere_Memory_Size       (32*2*1024)
+#define SHM_START_ADDRESS       (metal_phys_addr_t)(0x86000000)
 #define SHM_SIZE                (size_t)Shere_Memory_Size
 #define SHM_TX_RX_SIZE          (size_t)(Shere_Memory_Size/2)
-#define SHM_RX_START_ADDRESS    SHM_START_ADDRESS
-#define SHM_TX_START_ADDRESS    SHM_RX_START_ADDRESS+SHM_TX_RX_SIZE
+#define SHM_RX_START_ADDRESS    (SHM_START_ADDRESS)
+#define SHM_TX_START_ADDRESS    (SHM_RX_START_ADDRESS+SHM_TX_RX_SIZE)
 #else
 #define Shere_Memory_Size       (32*2*1024)
 #define SHM_START_ADDRESS       (metal_phys_addr_t)(0x86000000)
@@ -47,6 +45,12 @@ static uint32_t Shere_Memory__[Shere_Memory_Size];
 #define SHM_RX_START_ADDRESS    (SHM_TX_START_ADDRESS+SHM_TX_RX_SIZE)
 #endif
 
+/* Message rings (shm_ring.h), in the TX/RX buffers once the RTP accepts them */
+#define SHM_RING_SLOTS          16
+#define SHM_RING_SIZE           SHM_TX_RX_SIZE
+#define SHM_RING_TX_ADDRESS     SHM_TX_START_ADDRESS
+#define SHM_RING_RX_ADDRESS     SHM_RX_START_ADDRESS
+
 #define VRING_RX_STR_ADDR        -1
 #define VRING_TX_STR_ADDR        -1
 #define VRING_BUF_ADDR           -1
@@ -0,0 +1,228 @@
+/*************************************************************************//**
+ * @file     main.c
+ * @version  V1.00
+ * @brief    RTP M4 side of the OpenAMP share memory sample (SRAM).
+ *
+ *           Receives the first message of the A35 and sends one back. When
+ *           the A35 offers the message rings (SHM_RING_MAGIC) both rings are
+ *           reset and the offer is echoed in the ACK, otherwise messages go
+ *           through the single TX/RX buffer and wait for their ACK.
+ *
+ *           Built with the MA35D1 RTP BSP together with
+ *           ThirdParty/AMP/virtual_driver/shm_ring.c and linked with
+ *           share_memory_rtp.sct, which keeps the image, stack and heap out
+ *           of the shared memory at the top of the RTP SRAM;
+ *           ../porting/openamp_conf.h gives the M4 view of the shared memory.
+ *           The output image replaces ../share_memory_demo.bin. The .bin
+ *           shipped with the sample is the image from before the message
+ *           rings and has not been rebuilt from this source: it never echoes
+ *           the ring offer, so the A35 stays on the TX/RX buffer.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "NuMicro.h"
+#include "shm_ring.h"
+
+#define TX_RX_SIZE      SHM_TX_RX_SIZE
+#define TX_MSG_SIZE     10
+
+static SHM_RING_T s_TxRing;         /* M4 to A35 messages */
+static SHM_RING_T s_RxRing;         /* A35 to M4 messages */
+static int s_bRing = 0;
+
+static uint32_t s_au32RxCom[WHC_BUFFER_LEN];
+static uint32_t s_au32Cmd[WHC_BUFFER_LEN];
+static volatile uint32_t s_u32CmdFlag = 0;
+static volatile uint32_t s_u32AckFlag = 0;
+
+static uint8_t s_au8Msg[TX_RX_SIZE];
+
+void WHC0_IRQHandler(void)
+{
+    uint32_t i;
+
+    if (WHC_IS_RX_READY(WHC0, mbox_ch))
+    {
+        WHC_Recv(WHC0, mbox_ch, s_au32RxCom);
+
+        if (s_au32RxCom[0] == COMMAND_SEND_ACK_TO_M4)
+        {
+            s_u32AckFlag = 1;
+        }
+        else if (s_au32RxCom[0] != COMMAND_SEND_RING_TO_M4)
+        {
+            /* The A35 waits for the ACK before its next command */
+            for (i = 0; i < WHC_BUFFER_LEN; i++)
+                s_au32Cmd[i] = s_au32RxCom[i];
+
+            s_u32CmdFlag = 1;
+        }
+        /* A ring doorbell only wakes the core, the main loop polls the ring */
+
+        WHC_CLR_INT_FLAG(WHC0, WHC_INTSTS_RX0IF_Msk << mbox_ch);
+    }
+}
+
+void SYS_Init(void)
+{
+    /* Unlock protected registers */
+    SYS_UnlockReg();
+
+    /* Enable UART16 clock, the pins are assigned by the A35 */
+    CLK_EnableModuleClock(UART16_MODULE);
+    CLK_SetModuleClock(UART16_MODULE, CLK_CLKSEL3_UART16SEL_HXT, CLK_CLKDIV3_UART16(1));
+
+    /* Update System Core Clock */
+    SystemCoreClockUpdate();
+
+    /* Lock protected registers */
+    SYS_LockReg();
+}
+
+static void Mbox_Send(uint32_t *pu32Buf)
+{
+    while (WHC_Send(WHC0, mbox_ch, pu32Buf) != 0);
+}
+
+static void Print_Message(const uint8_t *pu8Msg, uint32_t u32Len)
+{
+    uint32_t i;
+
+    printf(" Receive %d bytes data from A35: \n", u32Len);
+    for (i = 0; i < u32Len; i++)
+        printf("0x%x\n", pu8Msg[i]);
+}
+
+/* A message in the RX buffer, the ACK takes over the rings if the A35 offers them */
+static void Recv_Buffer(void)
+{
+    uint32_t au32Ack[WHC_BUFFER_LEN] = { COMMAND_RECEIVE_M4_ACK, 0, 0, 0 };
+    uint32_t u32Len = s_au32Cmd[1];
+
+    if (u32Len > TX_RX_SIZE)
+        u32Len = TX_RX_SIZE;
+
+    memcpy(s_au8Msg, (void *)SHM_RX_START_ADDRESS, u32Len);
+
+    if ((s_au32Cmd[2] == SHM_RING_MAGIC) && !s_bRing)
+    {
+        /* Both rings are empty before the A35 sees the answer */
+        shm_ring_init(&s_TxRing, SHM_RING_TX_ADDRESS);
+        shm_ring_init(&s_RxRing, SHM_RING_RX_ADDRESS);
+        shm_ring_reset(&s_TxRing);
+        shm_ring_reset(&s_RxRing);
+        s_bRing = 1;
+    }
+
+    if (s_bRing)
+        au32Ack[1] = SHM_RING_MAGIC;
+
+    Mbox_Send(au32Ack);
+
+    Print_Message(s_au8Msg, u32Len);
+}
+
+/* Messages queued in the ring, releasing a slot is the ACK */
+static void Recv_Ring(void)
+{
+    uint32_t u32Len;
+    void *pvMsg;
+
+    while ((pvMsg = shm_ring_peek(&s_RxRing, &u32Len)) != NULL)
+    {
+        memcpy(s_au8Msg, pvMsg, u32Len);
+        shm_ring_release(&s_RxRing);
+
+        Print_Message(s_au8Msg, u32Len);
+    }
+}
+
+/* One message to the A35, returns 0 while it cannot be sent yet */
+static int Send_Message(const uint8_t *pu8Msg, uint32_t u32Len)
+{
+    uint32_t au32TxBuf[WHC_BUFFER_LEN] = { 0, 0, 0, 0 };
+    void *pvSlot;
+
+    if (s_bRing)
+    {
+        pvSlot = shm_ring_alloc(&s_TxRing);
+        if (pvSlot == NULL)
+            return 0;
+
+        memcpy(pvSlot, pu8Msg, u32Len);
+
+        /* Ring the doorbell only when the A35 may have gone idle */
+        if (shm_ring_publish(&s_TxRing, u32Len))
+        {
+            au32TxBuf[0] = COMMAND_RECEIVE_M4_RING;
+            Mbox_Send(au32TxBuf);
+        }
+
+        return 1;
+    }
+
+    if (!s_u32AckFlag)
+        return 0;
+
+    s_u32AckFlag = 0;
+    memcpy((void *)SHM_TX_START_ADDRESS, pu8Msg, u32Len);
+
+    au32TxBuf[0] = COMMAND_RECEIVE_M4_MSG;
+    au32TxBuf[1] = u32Len;
+    Mbox_Send(au32TxBuf);
+
+    return 1;
+}
+
+int main(void)
+{
+    uint8_t au8TxMsg[TX_MSG_SIZE];
+    int bSent = 0;
+    uint32_t i;
+
+    SYS_Init();
+
+    /* Initialize UART16 to 115200-8n1 for print message */
+    UART_Open(UART16, 115200);
+
+    printf("\nThis sample code demonstrate OpenAMP share memory function (RTP side)\n\n");
+
+    for (i = 0; i < TX_MSG_SIZE; i++)
+        au8TxMsg[i] = i;
+
+    WHC_ENABLE_INT(WHC0, WHC_INTEN_RX0IEN_Msk << mbox_ch);
+    NVIC_EnableIRQ(WRHO0_IRQn);
+
+    /* The first message needs no ACK */
+    s_u32AckFlag = 1;
+
+    while (1)
+    {
+        if (s_u32CmdFlag)
+        {
+            s_u32CmdFlag = 0;
+
+            if (s_au32Cmd[0] == COMMAND_SEND_MSG_TO_M4)
+                Recv_Buffer();
+            else
+                printf("\n unknow command!! \n");
+
+            /* Answer the first message of the A35 */
+            if (!bSent)
+            {
+                while (!Send_Message(au8TxMsg, TX_MSG_SIZE));
+                printf(" Transfer %d bytes data to A35 \n", TX_MSG_SIZE);
+                printf("\n Test END !!\n");
+                bSent = 1;
+            }
+        }
+
+        if (s_bRing)
+            Recv_Ring();
+    }
+}
+
+/*** (C) COPYRIGHT 2023 Nuvoton Technology Corp. ***/
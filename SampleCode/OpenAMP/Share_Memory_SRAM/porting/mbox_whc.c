@@ -9,9 +9,14 @@
 #include "openamp/open_amp.h"
 #include "NuMicro.h"
 #include "openamp_conf.h"
+#include "shm_ring.h"
 
 vu32 WHC0_RX_Flag = RX_NO_MSG;
 vu32 WHC0_TX_Flag = TX_NO_ACK;
+vu32 WHC0_Ring_Flag = 0;
+
+SHM_RING_T g_TxRing;
+SHM_RING_T g_RxRing;
 
 uint32_t au32RxCom[4];
 uint32_t au32TxCom[4];
@@ -43,9 +48,38 @@ int Mbox_Init(void)
     return 0;
 }
 
+// Messages go through the shared memory rings
+int Mbox_Ring_Enabled(void)
+{
+    return (WHC0_Ring_Flag != 0);
+}
+
+// Drain the RX ring, no ACK: releasing a slot is the ACK
+static int Mbox_Poll_Ring(struct rpmsg_endpoint *ept)
+{
+    uint32_t u32Len;
+    void *pvMsg;
+    int n = 0;
+
+    WHC0_RX_Flag = RX_NO_MSG;
+
+    while ((pvMsg = shm_ring_peek(&g_RxRing, &u32Len)) != NULL)
+    {
+        au32RxBuf[0] = COMMAND_RECEIVE_M4_MSG;
+        ept->cb(ept, &au32RxBuf, (size_t)u32Len, shm_ring_peek_phys(&g_RxRing), NULL);
+        shm_ring_release(&g_RxRing);
+        n++;
+    }
+
+    return n ? 0 : -1;
+}
+
 // Poll mailbox
 int Mbox_Poll(struct rpmsg_endpoint *ept)
 {
+    if (WHC0_Ring_Flag)
+        return Mbox_Poll_Ring(ept);
+
     if (WHC0_RX_Flag == RX_NEW_MSG)
     {
         ept->cb(ept, &au32RxBuf, (size_t)au32RxBuf[1], SHM_RX_START_ADDRESS, NULL);
@@ -83,8 +117,19 @@ void WHC0_IRQHandler(void)
 
             WHC0_RX_Flag = RX_NEW_MSG;
         }
+        else if (au32RxCom[0] == COMMAND_RECEIVE_M4_RING)
+        {
+            WHC0_RX_Flag = RX_NEW_MSG;
+        }
         else if (au32RxCom[0] == COMMAND_RECEIVE_M4_ACK)
         {
+            if ((au32RxCom[1] == SHM_RING_MAGIC) && !WHC0_Ring_Flag)
+            {
+                /* RTP accepted the rings and has reset them */
+                shm_ring_init(&g_TxRing, SHM_RING_TX_ADDRESS);
+                shm_ring_init(&g_RxRing, SHM_RING_RX_ADDRESS);
+                WHC0_Ring_Flag = 1;
+            }
             WHC0_TX_Flag = TX_ACK;
         }
 
@@ -38,6 +38,9 @@ static uint32_t Shere_Memory__[Shere_Memory_Size];
 #define SHM_TX_RX_SIZE          (size_t)(Shere_Memory_Size/2)
 #define SHM_RX_START_ADDRESS    SHM_START_ADDRESS
 #define SHM_TX_START_ADDRESS    SHM_RX_START_ADDRESS+SHM_TX_RX_SIZE
+
+#define SHM_RING_RX_ADDRESS     (0x2401f000)
+#define SHM_RING_TX_ADDRESS     (SHM_RING_RX_ADDRESS+SHM_RING_SIZE)
 #else
 #define Shere_Memory_Size       (128*2)
 #define SHM_START_ADDRESS       (metal_phys_addr_t)(0x2401ff00)
@@ -45,8 +48,18 @@ static uint32_t Shere_Memory__[Shere_Memory_Size];
 #define SHM_TX_RX_SIZE          (size_t)(Shere_Memory_Size/2)
 #define SHM_TX_START_ADDRESS    (SHM_START_ADDRESS)
 #define SHM_RX_START_ADDRESS    (SHM_TX_START_ADDRESS+SHM_TX_RX_SIZE)
+
+#define SHM_RING_TX_ADDRESS     (0x2401f000)
+#define SHM_RING_RX_ADDRESS     (SHM_RING_TX_ADDRESS+SHM_RING_SIZE)
 #endif
 
+/*
+ * Message rings (shm_ring.h), below the TX/RX buffers, too small to hold them.
+ * 0x2401f000 - 0x2401ffff is outside the RTP image, see RTP/share_memory_rtp.sct.
+ */
+#define SHM_RING_SLOTS          8
+#define SHM_RING_SIZE           (0x780)
+
 #define VRING_RX_STR_ADDR        -1
 #define VRING_TX_STR_ADDR        -1
 #define VRING_BUF_ADDR           -1
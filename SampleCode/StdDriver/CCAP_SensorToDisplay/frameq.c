@@ -0,0 +1,174 @@
+/**************************************************************************//**
+ * @file     frameq.c
+ *
+ * @brief    Capture buffer manager: CCAP packet buffers handed to consumers
+ *           through lock-free queues.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <string.h>
+#include "frameq.h"
+
+#define FRAMEQ_MASK     (FRAMEQ_BUF_MAX - 1)
+
+/* Return a buffer to the capture side. Consumer only. */
+static void FrameQ_PutFree(S_FRAMEQ *psQ, uint32_t u32Index)
+{
+    psQ->au32Free[psQ->u32FreeHead & FRAMEQ_MASK] = u32Index;
+    __DMB();
+    psQ->u32FreeHead = psQ->u32FreeHead + 1;
+}
+
+/**
+ * @brief      Initialize a capture queue and point the CCAP at the first buffer
+ *
+ * @param[in]  psQ       The queue
+ * @param[in]  ccap      The pointer of the specified CCAP module
+ * @param[in]  pu32Addr  Packet buffer addresses, each one a whole frame
+ * @param[in]  u32Num    Number of buffers, 3 to FRAMEQ_BUF_MAX
+ *
+ * @retval     0         Success
+ * @retval     -1        Wrong number of buffers
+ *
+ * @details    Call before CCAP_Start(), then FrameQ_FrameEnd() on every frame end interrupt.
+ *             Three buffers let the sensor, the queue and the consumer each hold one.
+ */
+int32_t FrameQ_Init(S_FRAMEQ *psQ, CCAP_T *ccap, const uint32_t *pu32Addr, uint32_t u32Num)
+{
+    uint32_t i;
+
+    if ((u32Num < 3) || (u32Num > FRAMEQ_BUF_MAX))
+        return -1;
+
+    memset(psQ, 0, sizeof(*psQ));
+    psQ->ccap = ccap;
+    psQ->u32Num = u32Num;
+    for (i = 0; i < u32Num; i++)
+        psQ->au32Addr[i] = pu32Addr[i];
+
+    for (i = 1; i < u32Num; i++)
+        FrameQ_PutFree(psQ, i);
+
+    psQ->u32Capturing = 0;
+    CCAP_SetPacketBuf(ccap, psQ->au32Addr[0]);
+
+    return 0;
+}
+
+/**
+ * @brief      Publish the frame just captured and move the CCAP to a free buffer
+ *
+ * @param[in]  psQ       The queue
+ *
+ * @details    Call from the CCAP interrupt handler on VINTF. The new address is latched
+ *             at the next frame start. Without a free buffer the next frame overwrites
+ *             this one, which is then dropped instead of published.
+ */
+void FrameQ_FrameEnd(S_FRAMEQ *psQ)
+{
+    uint64_t u64Now = EL0_GetCurrentPhysicalValue();
+    S_CCAP_FRAME *psFrame;
+    uint32_t u32Next;
+
+    psQ->u32Seq++;
+
+    if (psQ->u32FreeTail == psQ->u32FreeHead)
+    {
+        psQ->u32DropNoBuf++;
+        return;
+    }
+    __DMB();
+    u32Next = psQ->au32Free[psQ->u32FreeTail & FRAMEQ_MASK];
+    psQ->u32FreeTail = psQ->u32FreeTail + 1;
+
+    CCAP_SetPacketBuf(psQ->ccap, psQ->au32Addr[u32Next]);
+
+    /* Every buffer is in one ring at most, the ready ring cannot overflow */
+    psFrame = &psQ->asReady[psQ->u32ReadyHead & FRAMEQ_MASK];
+    psFrame->u32Addr = psQ->au32Addr[psQ->u32Capturing];
+    psFrame->u32Index = psQ->u32Capturing;
+    psFrame->u32Seq = psQ->u32Seq;
+    psFrame->u64Timestamp = u64Now;
+    __DMB();
+    psQ->u32ReadyHead = psQ->u32ReadyHead + 1;
+
+    psQ->u32Capturing = u32Next;
+    psQ->u32Captured++;
+}
+
+/**
+ * @brief      Take the oldest captured frame
+ *
+ * @param[in]  psQ       The queue
+ * @param[out] psFrame   The frame, valid until FrameQ_Release()
+ *
+ * @retval     0         Got a frame
+ * @retval     -1        No frame ready
+ *
+ * @details    The CCAP writes memory directly. A consumer reading pixels with the CPU
+ *             invalidates the data cache over the frame first, DMA consumers need not.
+ */
+int32_t FrameQ_Acquire(S_FRAMEQ *psQ, S_CCAP_FRAME *psFrame)
+{
+    if (psQ->u32ReadyTail == psQ->u32ReadyHead)
+        return -1;
+    __DMB();
+
+    *psFrame = psQ->asReady[psQ->u32ReadyTail & FRAMEQ_MASK];
+    __DMB();
+    psQ->u32ReadyTail = psQ->u32ReadyTail + 1;
+
+    return 0;
+}
+
+/**
+ * @brief      Take the newest captured frame, releasing the older ones unseen
+ *
+ * @param[in]  psQ       The queue
+ * @param[out] psFrame   The frame, valid until FrameQ_Release()
+ *
+ * @retval     0         Got a frame
+ * @retval     -1        No frame ready
+ *
+ * @details    For consumers such as the display that want the freshest picture.
+ */
+int32_t FrameQ_AcquireLatest(S_FRAMEQ *psQ, S_CCAP_FRAME *psFrame)
+{
+    S_CCAP_FRAME sNewer;
+
+    if (FrameQ_Acquire(psQ, psFrame) != 0)
+        return -1;
+
+    while (FrameQ_Acquire(psQ, &sNewer) == 0)
+    {
+        FrameQ_Release(psQ, psFrame);
+        psQ->u32DropSkipped++;
+        *psFrame = sNewer;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief      Give a frame's buffer back for capturing
+ *
+ * @param[in]  psQ       The queue
+ * @param[in]  psFrame   A frame from FrameQ_Acquire() or FrameQ_AcquireLatest()
+ */
+void FrameQ_Release(S_FRAMEQ *psQ, const S_CCAP_FRAME *psFrame)
+{
+    FrameQ_PutFree(psQ, psFrame->u32Index);
+}
+
+/**
+ * @brief      Read the frame counters
+ *
+ * @param[in]  psQ       The queue
+ * @param[out] psStat    The counters
+ */
+void FrameQ_GetStat(S_FRAMEQ *psQ, S_FRAMEQ_STAT *psStat)
+{
+    psStat->u32Captured = psQ->u32Captured;
+    psStat->u32DropNoBuf = psQ->u32DropNoBuf;
+    psStat->u32DropSkipped = psQ->u32DropSkipped;
+}
@@ -0,0 +1,65 @@
+/**************************************************************************//**
+ * @file     frameq.h
+ *
+ * @brief    Capture buffer manager: CCAP packet buffers handed to consumers
+ *           through lock-free queues.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __FRAMEQ_H__
+#define __FRAMEQ_H__
+
+#include "NuMicro.h"
+
+#define FRAMEQ_BUF_MAX      8       /* Packet buffers per queue, a power of two */
+
+/* A captured frame, owned by the consumer between acquire and release */
+typedef struct
+{
+    uint32_t u32Addr;               /* Packet buffer address */
+    uint32_t u32Index;              /* Buffer index, as given to FrameQ_Init() */
+    uint32_t u32Seq;                /* Frame number, gaps are dropped frames */
+    uint64_t u64Timestamp;          /* Generic timer count at frame end */
+} S_CCAP_FRAME;
+
+typedef struct
+{
+    uint32_t u32Captured;           /* Frames published to the consumer */
+    uint32_t u32DropNoBuf;          /* Frames overwritten, the consumer held every other buffer */
+    uint32_t u32DropSkipped;        /* Published frames FrameQ_AcquireLatest() released unseen */
+} S_FRAMEQ_STAT;
+
+/*
+ * Single producer, single consumer: CCAP_IRQHandler() produces, one thread
+ * consumes. A buffer sits in exactly one place at a time, being captured,
+ * in the ready ring, held by the consumer or in the free ring.
+ */
+typedef struct
+{
+    CCAP_T *ccap;
+    uint32_t au32Addr[FRAMEQ_BUF_MAX];
+    uint32_t u32Num;
+    uint32_t u32Capturing;          /* Buffer the current frame goes to */
+    uint32_t u32Seq;
+
+    volatile uint32_t u32ReadyHead; /* Written by the producer only */
+    volatile uint32_t u32ReadyTail; /* Written by the consumer only */
+    S_CCAP_FRAME asReady[FRAMEQ_BUF_MAX];
+
+    volatile uint32_t u32FreeHead;  /* Written by the consumer only */
+    volatile uint32_t u32FreeTail;  /* Written by the producer only */
+    uint32_t au32Free[FRAMEQ_BUF_MAX];
+
+    volatile uint32_t u32Captured;
+    volatile uint32_t u32DropNoBuf;
+    uint32_t u32DropSkipped;
+} S_FRAMEQ;
+
+int32_t FrameQ_Init(S_FRAMEQ *psQ, CCAP_T *ccap, const uint32_t *pu32Addr, uint32_t u32Num);
+void FrameQ_FrameEnd(S_FRAMEQ *psQ);
+int32_t FrameQ_Acquire(S_FRAMEQ *psQ, S_CCAP_FRAME *psFrame);
+int32_t FrameQ_AcquireLatest(S_FRAMEQ *psQ, S_CCAP_FRAME *psFrame);
+void FrameQ_Release(S_FRAMEQ *psQ, const S_CCAP_FRAME *psFrame);
+void FrameQ_GetStat(S_FRAMEQ *psQ, S_FRAMEQ_STAT *psStat);
+
+#endif /* __FRAMEQ_H__ */
@@ -9,6 +9,7 @@
 #include "NuMicro.h"
 #include "displib.h"
 #include "sensor.h"
+#include "frameq.h"
 
 #define DDR_ADR_FRAMEBUFFER   0x88000000UL
 
@@ -26,14 +27,17 @@
 #define SYSTEM_HEIGHT               600
 //uint8_t u8FrameBuffer[SYSTEM_WIDTH*SYSTEM_HEIGHT*2];
 
+/* Packet buffers, the display scans out one of them while the CCAP fills another */
+#define FRAME_NUM                     3
+#define FRAME_SIZE                 (SYSTEM_WIDTH*SYSTEM_HEIGHT*2)
+
 //#define DISPLAY_ARGB8
 #define DISPLAY_RGB565
 
 /*------------------------------------------------------------------------------------------*/
-/* To run CCAPInterruptHandler, when CAP frame end interrupt                                */
+/* Capture buffer queue, fed by the CAP frame end interrupt                                 */
 /*------------------------------------------------------------------------------------------*/
-volatile uint32_t u32FramePass = 0;
-static uint32_t u32EscapeFrame = 0;
+static S_FRAMEQ sFrameQ;
 
 /* LCD attributes 1024x600 */
 DISP_LCD_INFO LcdPanelInfo =
@@ -178,11 +182,6 @@ void DISP_Open(void)
     SYS->GPH_MFPH |= (SYS_GPH_MFPH_PH12MFP_LCM_DATA20 | SYS_GPH_MFPH_PH13MFP_LCM_DATA21 | SYS_GPH_MFPH_PH14MFP_LCM_DATA22 | SYS_GPH_MFPH_PH15MFP_LCM_DATA23);
 }
 
-void CCAPInterruptHandler(void)
-{
-/*    u32FramePass++; */
-}
-
 /*------------------------------------------------------------------------------------------*/
 /*  CCAPIRQHandler                                                                          */
 /*------------------------------------------------------------------------------------------*/
@@ -192,9 +191,8 @@ void CCAP_IRQHandler(void)
     u32CapInt = CCAP->INT;
     if( (u32CapInt & (CCAP_INT_VIEN_Msk | CCAP_INT_VINTF_Msk )) == (CCAP_INT_VIEN_Msk | CCAP_INT_VINTF_Msk))
     {
-        CCAPInterruptHandler();
+        FrameQ_FrameEnd(&sFrameQ);
         CCAP->INT |= CCAP_INT_VINTF_Msk;        /* Clear Frame end interrupt */
-        u32EscapeFrame = u32EscapeFrame+1;
     }
 
     if((u32CapInt & (CCAP_INT_ADDRMIEN_Msk|CCAP_INT_ADDRMINTF_Msk)) == (CCAP_INT_ADDRMIEN_Msk|CCAP_INT_ADDRMINTF_Msk))
@@ -257,7 +255,12 @@ void CCAP_SetFreq(uint32_t u32SensorFreq)
 
 void PacketFormatDownScale(void)
 {
-    uint32_t u32Frame;
+    uint32_t au32Buf[FRAME_NUM];
+    S_CCAP_FRAME sShown, sPrev, sNew;
+    S_FRAMEQ_STAT sStat;
+    uint32_t u32Latch = 0, u32Report = 0;
+    int32_t bShown = 0, bPending = 0;
+    uint32_t i;
 
     /* Initialize HM1055 sensor and set HM1055 output YUV422 format  */
     if (InitHM1055_VGA_YUV422(CCAP) == 0)
@@ -276,8 +279,10 @@ void PacketFormatDownScale(void)
     /* Set Cropping Window Vertical/Horizontal Starting Address and Cropping Window Size */
     CCAP_SetCroppingWindow(CCAP, 0,0,SENSOR_IN_HEIGHT,SENSOR_IN_WIDTH);
 
-    /* Set System Memory Packet Base Address Register */
-    CCAP_SetPacketBuf(CCAP, ptr_to_u32(DDR_ADR_FRAMEBUFFER));
+    /* Rotate the System Memory Packet Base Address among the packet buffers */
+    for (i = 0; i < FRAME_NUM; i++)
+        au32Buf[i] = DDR_ADR_FRAMEBUFFER + i * FRAME_SIZE;
+    FrameQ_Init(&sFrameQ, CCAP, au32Buf, FRAME_NUM);
 
     /* Set Packet Scaling Vertical/Horizontal Factor Register */
     CCAP_SetPacketScaling(CCAP, SYSTEM_HEIGHT,SENSOR_IN_HEIGHT,SYSTEM_WIDTH,SENSOR_IN_WIDTH);
@@ -288,13 +293,36 @@ void PacketFormatDownScale(void)
     /* Start Image Capture Interface */
     CCAP_Start(CCAP);
 
-    u32Frame = u32FramePass;
     while(1)
     {
-        if(u32Frame != u32FramePass)
+        /* The buffer shown before is free once the new address is latched */
+        if (bPending && (DISPLIB_GetFrameCounter() != u32Latch))
+        {
+            FrameQ_Release(&sFrameQ, &sPrev);
+            bPending = 0;
+        }
+
+        if (!bPending && (FrameQ_AcquireLatest(&sFrameQ, &sNew) == 0))
+        {
+            /* Zero copy: scan out the packet buffer itself */
+            DISPLIB_SetFBAddr(sNew.u32Addr);
+            u32Latch = DISPLIB_GetFrameCounter();
+
+            if (bShown)
+            {
+                sPrev = sShown;
+                bPending = 1;
+            }
+            sShown = sNew;
+            bShown = 1;
+        }
+
+        FrameQ_GetStat(&sFrameQ, &sStat);
+        if ((sStat.u32Captured - u32Report) >= 300)
         {
-            u32Frame = u32FramePass;
-            sysprintf("Get frame %3d\n",u32Frame);
+            u32Report = sStat.u32Captured;
+            sysprintf("Captured %d, dropped %d (no buffer), skipped %d\n",
+                      sStat.u32Captured, sStat.u32DropNoBuf, sStat.u32DropSkipped);
         }
     }
 
@@ -8,6 +8,8 @@
 #include <stdio.h>
 #include "NuMicro.h"
 #include "displib.h"
+#include "blit.h"
+#include "blit_pdma.h"
 
 #define DDR_ADR_FRAMEBUFFER   0x88000000UL
 
@@ -16,6 +18,10 @@
 //#define DISPLAY_YUV422
 #define DISPLAY_NV12
 
+/* The blit library copies the image to the framebuffer on this PDMA channel */
+static BLIT_PDMA_T s_sBlitPdma;
+static BLIT_ENGINE_T s_sBlitEngine;
+
 extern uint32_t ImageARGB8DataBase, ImageARGB8DataLimit, ImageRGB565DataBase, ImageRGB565DataLimit, ImageYUV422DataBase, ImageYUV422DataLimit, ImageNV12DataBase, ImageNV12DataLimit;
 
 /* LCD attributes 1024x600 */
@@ -56,6 +62,7 @@ void SYS_Init(void)
 
     /* Enable IP clock */
     CLK_EnableModuleClock(UART0_MODULE);
+    CLK_EnableModuleClock(PDMA2_MODULE);
 
     /* Select IP clock source */
     CLK_SetModuleClock(UART0_MODULE, CLK_CLKSEL2_UART0SEL_HXT, CLK_CLKDIV1_UART0(1));
@@ -107,6 +114,27 @@ void DISP_Open(void)
     SYS->GPH_MFPH |= (SYS_GPH_MFPH_PH12MFP_LCM_DATA20 | SYS_GPH_MFPH_PH13MFP_LCM_DATA21 | SYS_GPH_MFPH_PH14MFP_LCM_DATA22 | SYS_GPH_MFPH_PH15MFP_LCM_DATA23);
 }
 
+/*
+ * Copy a u32Width x u32Height image of u32Format to the framebuffer with
+ * the blit library. A same format copy this large runs as PDMA stride
+ * transfers; if the PDMA fails, the CPU copies the image instead.
+ */
+void FB_LoadImage(void *pvImage, uint32_t u32Size, uint32_t u32Format, uint32_t u32Width, uint32_t u32Height)
+{
+    uint32_t u32Pitch = u32Width * blit_fmt_bpp(u32Format);
+    BLIT_SURFACE_T sSrc = { nc_ptr(pvImage), u32Width, u32Height, u32Pitch, u32Format };
+    BLIT_SURFACE_T sDst = { nc_ptr(DDR_ADR_FRAMEBUFFER), u32Width, u32Height, u32Pitch, u32Format };
+
+    if (u32Size < u32Pitch * u32Height)
+    {
+        sysprintf("Image is %d bytes, expected %d\n", u32Size, u32Pitch * u32Height);
+        return;
+    }
+
+    if (blit_copy(&sDst, 0, 0, &sSrc, 0, 0, u32Width, u32Height) == BLIT_ERR_ENGINE)
+        sysprintf("PDMA copy failed, the CPU copied the image\n");
+}
+
 int main(void)
 {
     uint32_t file_size;
@@ -124,6 +152,10 @@ int main(void)
     /* Open DISP IP Clock and set multi-function pins */
     DISP_Open();
 
+    /* Blit PDMA engine on channel 0 of PDMA2 */
+    blit_pdma_init(&s_sBlitPdma, &s_sBlitEngine, PDMA2, 0);
+    blit_engine_add(&s_sBlitEngine);
+
     /* Assign the highest AXI port priority to Display */
     DISPLIB_DDR_AXIPort_Priority();
 
@@ -149,7 +181,7 @@ int main(void)
 #ifdef DISPLAY_ARGB8
     file_size = ptr_to_u32(&ImageARGB8DataLimit) - ptr_to_u32(&ImageARGB8DataBase);
     /* Prepare DISP Framebuffer image */
-    memcpy((void *)(nc_ptr(DDR_ADR_FRAMEBUFFER)), (const void *)(nc_ptr(&ImageARGB8DataBase)), file_size);
+    FB_LoadImage(&ImageARGB8DataBase, file_size, BLIT_FMT_ARGB8888, LcdPanelInfo.u32ResolutionWidth, LcdPanelInfo.u32ResolutionHeight);
 
     /* Configure DISP Framebuffer settings  */
     DISPLIB_SetFBConfig(eFBFmt_A8R8G8B8, LcdPanelInfo.u32ResolutionWidth, LcdPanelInfo.u32ResolutionHeight, DDR_ADR_FRAMEBUFFER);
@@ -158,7 +190,7 @@ int main(void)
 #ifdef DISPLAY_RGB565
     file_size = ptr_to_u32(&ImageRGB565DataLimit) - ptr_to_u32(&ImageRGB565DataBase);
     /* Prepare DISP Framebuffer image */
-    memcpy((void *)(nc_ptr(DDR_ADR_FRAMEBUFFER)), (const void *)(nc_ptr(&ImageRGB565DataBase)), file_size);
+    FB_LoadImage(&ImageRGB565DataBase, file_size, BLIT_FMT_RGB565, LcdPanelInfo.u32ResolutionWidth, LcdPanelInfo.u32ResolutionHeight);
 
     /* Configure DISP Framebuffer settings  */
     DISPLIB_SetFBConfig(eFBFmt_R5G6B5, LcdPanelInfo.u32ResolutionWidth, LcdPanelInfo.u32ResolutionHeight, DDR_ADR_FRAMEBUFFER);
@@ -167,7 +199,7 @@ int main(void)
 #ifdef DISPLAY_YUV422
     file_size = ptr_to_u32(&ImageYUV422DataLimit) - ptr_to_u32(&ImageYUV422DataBase);
     /* Prepare DISP Framebuffer image */
-    memcpy((void *)(nc_ptr(DDR_ADR_FRAMEBUFFER)), (const void *)(nc_ptr(&ImageYUV422DataBase)), file_size);
+    FB_LoadImage(&ImageYUV422DataBase, file_size, BLIT_FMT_YUY2, LcdPanelInfo.u32ResolutionWidth, LcdPanelInfo.u32ResolutionHeight);
 
     /* Configure DISP Framebuffer settings  */
     DISPLIB_SetFBConfig(eFBFmt_YUY2, LcdPanelInfo.u32ResolutionWidth, LcdPanelInfo.u32ResolutionHeight, DDR_ADR_FRAMEBUFFER);
@@ -176,7 +208,8 @@ int main(void)
 #ifdef DISPLAY_NV12
     file_size = ptr_to_u32(&ImageNV12DataLimit) - ptr_to_u32(&ImageNV12DataBase);
     /* Prepare DISP Framebuffer image */
-    memcpy((void *)(nc_ptr(DDR_ADR_FRAMEBUFFER)), (const void *)(nc_ptr(&ImageNV12DataBase)), file_size);
+    /* The Y plane then the interleaved UV plane, half as high: bytes moved as 16-bit pixels */
+    FB_LoadImage(&ImageNV12DataBase, file_size, BLIT_FMT_RGB565, LcdPanelInfo.u32ResolutionWidth / 2, LcdPanelInfo.u32ResolutionHeight * 3 / 2);
 
     /* Configure DISP Framebuffer settings  */
     DISPLIB_SetFBConfig(eFBFmt_NV12, LcdPanelInfo.u32ResolutionWidth, LcdPanelInfo.u32ResolutionHeight, DDR_ADR_FRAMEBUFFER);
@@ -12,6 +12,7 @@
 #include "NuMicro.h"
 #include "usbh_lib.h"
 #include "usbh_uac.h"
+#include "audio_dsp.h"
 
 #define PCM_BUF_LEN            (192*24)     /* suggest 1K at least */
 
@@ -51,8 +52,8 @@ void ResetAudioLoopBack(void)
  */
 int audio_in_callback(UAC_DEV_T *dev, uint8_t *data, int len)
 {
-    int        i, cp_len;
-    uint16_t   *dptr, *bptr;
+    int        cp_len;
+    int16_t    *dptr, *bptr;
 
     if (g_bMicIsMono)
     {
@@ -65,13 +66,10 @@ int audio_in_callback(UAC_DEV_T *dev, uint8_t *data, int len)
             cp_len = len;
         }
 
-        dptr = (uint16_t *)data;
-        bptr = (uint16_t *)&g_u8PcmBuf[g_UacRecPos];
-        for (i = 0; i < cp_len; i+=2)
-        {
-            *bptr++ = *dptr;                /* 16-bit PCM data                            */
-            *bptr++ = *dptr++;              /* duplicate PCM data                         */
-        }
+        /* 16-bit PCM data, duplicated to both channels */
+        dptr = (int16_t *)data;
+        bptr = (int16_t *)&g_u8PcmBuf[g_UacRecPos];
+        audio_dsp_interleave_s16(bptr, dptr, dptr, cp_len/2);
 
         g_UacRecPos = (g_UacRecPos + cp_len*2) % PCM_BUF_LEN;
         g_UacRecCnt += cp_len;
@@ -79,13 +77,9 @@ int audio_in_callback(UAC_DEV_T *dev, uint8_t *data, int len)
 
         if (len)
         {
-            dptr = (uint16_t *)&data[cp_len];
-            bptr = (uint16_t *)g_u8PcmBuf;
-            for (i = 0; i < len; i+=2)
-            {
-                *bptr++ = *dptr;            /* 16-bit PCM data                            */
-                *bptr++ = *dptr++;          /* duplicate PCM data                         */
-            }
+            dptr = (int16_t *)&data[cp_len];
+            bptr = (int16_t *)g_u8PcmBuf;
+            audio_dsp_interleave_s16(bptr, dptr, dptr, len/2);
             g_UacRecPos = len*2;
             g_UacRecCnt += len;
         }
@@ -0,0 +1,198 @@
+/**************************************************************************//**
+ * @file     audio_pipe.c
+ *
+ * @brief    PCM playback pipeline on a PDMA scatter-gather descriptor ring.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <string.h>
+
+#include "NuMicro.h"
+#include "config.h"
+#include "audio_pipe.h"
+
+#if (AUDIO_PIPE_PERIODS < 3)
+#error "AUDIO_PIPE_PERIODS must be at least 3"
+#endif
+
+#if ((PCM_BUFFER_SIZE * 4) % 64) != 0
+#error "PCM_BUFFER_SIZE must fill whole cache lines"
+#endif
+
+#define PIPE_CTL_DATA   (((PCM_BUFFER_SIZE - 1) << PDMA_DSCT_CTL_TXCNT_Pos) | PDMA_WIDTH_32 | PDMA_SAR_INC | \
+                         PDMA_DAR_FIX | PDMA_REQ_SINGLE | PDMA_OP_SCATTER)
+#define PIPE_CTL_SILENT (((PCM_BUFFER_SIZE - 1) << PDMA_DSCT_CTL_TXCNT_Pos) | PDMA_WIDTH_32 | PDMA_SAR_FIX | \
+                         PDMA_DAR_FIX | PDMA_REQ_SINGLE | PDMA_OP_SCATTER)
+
+static uint32_t   s_au32Period[AUDIO_PIPE_PERIODS][PCM_BUFFER_SIZE] __attribute__((aligned(64)));
+static uint32_t   s_au32Zero[16] __attribute__((aligned(64)));
+static DMA_DESC_T s_asDesc[AUDIO_PIPE_PERIODS] __attribute__((aligned(64)));
+
+/*
+ * Free running period counters, each written by one side only:
+ * s_u32Wr by the producer, s_u32Arm and s_u32Done by the interrupt.
+ */
+static volatile uint32_t s_u32Wr;       /* periods committed */
+static volatile uint32_t s_u32Arm;      /* next period to arm */
+static volatile uint32_t s_u32Done;     /* periods played */
+static uint32_t s_u32Fill;              /* samples in the period being filled */
+static uint32_t s_u32Ahead;             /* periods the producer may commit ahead of playback */
+static volatile int s_bRunning;
+static volatile int s_bDrain;           /* the producer is done, silence is no underrun */
+static volatile AUDIO_PIPE_STAT_T s_sStat;
+
+static DMA_DESC_T *pipe_desc(uint32_t u32Idx)
+{
+    return (DMA_DESC_T *)nc_ptr(&s_asDesc[u32Idx % AUDIO_PIPE_PERIODS]);
+}
+
+/* Point the descriptor of period u32Idx at its buffer, or at silence if it is not committed */
+static int pipe_arm(uint32_t u32Idx)
+{
+    DMA_DESC_T *psDesc = pipe_desc(u32Idx);
+
+    if ((int32_t)(s_u32Wr - u32Idx) > 0)
+    {
+        psDesc->ctl = PIPE_CTL_DATA;
+        psDesc->src = ptr_to_u32(s_au32Period[u32Idx % AUDIO_PIPE_PERIODS]);
+        return 1;
+    }
+
+    psDesc->ctl = PIPE_CTL_SILENT;
+    psDesc->src = ptr_to_u32(s_au32Zero);
+    return 0;
+}
+
+void audio_pipe_init(uint32_t u32SampleRate, uint32_t u32LatencyMs)
+{
+    uint32_t i;
+
+    s_u32Wr = 0;
+    s_u32Arm = 0;
+    s_u32Done = 0;
+    s_u32Fill = 0;
+    s_bRunning = 0;
+    s_bDrain = 0;
+    memset((void *)&s_sStat, 0, sizeof(s_sStat));
+    s_sStat.u32MinLead = 0xFFFFFFFF;
+
+    /* Whole periods covering the latency; two are armed at any time, one is being filled */
+    s_u32Ahead = ((uint64_t)u32SampleRate * u32LatencyMs + PCM_BUFFER_SIZE * 1000 - 1) / (PCM_BUFFER_SIZE * 1000);
+    if (s_u32Ahead < 2)
+        s_u32Ahead = 2;
+    if (s_u32Ahead > AUDIO_PIPE_PERIODS - 1)
+        s_u32Ahead = AUDIO_PIPE_PERIODS - 1;
+
+    /* The zero word is read by the PDMA, it must be zero in memory and not only in the cache */
+    dcache_clean_by_mva(s_au32Zero, sizeof(s_au32Zero));
+
+    for (i = 0; i < AUDIO_PIPE_PERIODS; i++)
+    {
+        pipe_desc(i)->dest = ptr_to_u32(&AUDIO_PIPE_I2S->TXFIFO);
+        pipe_desc(i)->offset = ptr_to_u32(&s_asDesc[(i + 1) % AUDIO_PIPE_PERIODS]);
+        pipe_arm(i);
+    }
+}
+
+void audio_pipe_start(void)
+{
+    /* The period playing first and the one loaded after it */
+    pipe_arm(0);
+    pipe_arm(1);
+    s_u32Arm = 2;
+    s_bRunning = 1;
+
+    PDMA_Open(AUDIO_PIPE_PDMA, 1 << AUDIO_PIPE_PDMA_CH);
+    PDMA_SetTransferMode(AUDIO_PIPE_PDMA, AUDIO_PIPE_PDMA_CH, AUDIO_PIPE_PDMA_REQ, 1, ptr_to_u32(&s_asDesc[0]));
+    PDMA_EnableInt(AUDIO_PIPE_PDMA, AUDIO_PIPE_PDMA_CH, 0);
+    IRQ_Enable((IRQn_ID_t)AUDIO_PIPE_PDMA_IRQn);
+}
+
+void audio_pipe_stop(void)
+{
+    IRQ_Disable((IRQn_ID_t)AUDIO_PIPE_PDMA_IRQn);
+    PDMA_DisableInt(AUDIO_PIPE_PDMA, AUDIO_PIPE_PDMA_CH, 0);
+    PDMA_Close(AUDIO_PIPE_PDMA);
+    s_bRunning = 0;
+}
+
+uint32_t *audio_pipe_get(uint32_t *pu32Len)
+{
+    uint32_t u32Arm = s_u32Arm;
+
+    if (s_u32Fill == 0)
+    {
+        /* Periods armed as silence are gone, resume with the first one still open */
+        if ((int32_t)(u32Arm - s_u32Wr) > 0)
+            s_u32Wr = u32Arm;
+
+        /* The slot is reused once the PDMA is done with it, s_u32Ahead < AUDIO_PIPE_PERIODS */
+        if ((s_u32Wr - s_u32Done) >= s_u32Ahead)
+            return NULL;
+    }
+
+    *pu32Len = PCM_BUFFER_SIZE - s_u32Fill;
+    return &s_au32Period[s_u32Wr % AUDIO_PIPE_PERIODS][s_u32Fill];
+}
+
+void audio_pipe_put(uint32_t u32Len)
+{
+    s_u32Fill += u32Len;
+    if (s_u32Fill < PCM_BUFFER_SIZE)
+        return;
+
+    /* The period reaches memory before the interrupt can arm it */
+    dcache_clean_by_mva(s_au32Period[s_u32Wr % AUDIO_PIPE_PERIODS], PCM_BUFFER_SIZE * 4);
+    __DSB();
+    s_u32Wr = s_u32Wr + 1;
+    s_u32Fill = 0;
+}
+
+void audio_pipe_drain(void)
+{
+    uint32_t *pu32Buf, u32Len;
+
+    if (s_u32Fill)
+    {
+        /* A partial period is always open, the ahead check is done at its first sample */
+        pu32Buf = audio_pipe_get(&u32Len);
+        memset(pu32Buf, 0, u32Len * 4);
+        audio_pipe_put(u32Len);
+    }
+    s_bDrain = 1;
+}
+
+uint32_t audio_pipe_pending(void)
+{
+    int32_t i32Pending = (int32_t)(s_u32Wr - s_u32Done);
+
+    return (i32Pending > 0) ? (uint32_t)i32Pending : 0;
+}
+
+int audio_pipe_running(void)
+{
+    return s_bRunning;
+}
+
+void audio_pipe_period_done(void)
+{
+    uint32_t u32Lead;
+
+    s_u32Done = s_u32Done + 1;
+    s_sStat.u32Periods++;
+
+    u32Lead = audio_pipe_pending();
+    if (u32Lead < s_sStat.u32MinLead)
+        s_sStat.u32MinLead = u32Lead;
+
+    if (!pipe_arm(s_u32Arm) && !s_bDrain)
+        s_sStat.u32Underruns++;
+    s_u32Arm = s_u32Arm + 1;
+}
+
+void audio_pipe_get_stat(AUDIO_PIPE_STAT_T *psStat)
+{
+    psStat->u32Periods = s_sStat.u32Periods;
+    psStat->u32Underruns = s_sStat.u32Underruns;
+    psStat->u32MinLead = s_sStat.u32MinLead;
+}
@@ -0,0 +1,76 @@
+/**************************************************************************//**
+ * @file     audio_pipe.h
+ *
+ * @brief    PCM playback pipeline: a ring of periods played by a PDMA
+ *           scatter-gather descriptor ring into the I2S TX FIFO.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __AUDIO_PIPE_H__
+#define __AUDIO_PIPE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*
+ * The ring has AUDIO_PIPE_PERIODS periods of PCM_BUFFER_SIZE words, one
+ * 16-bit stereo sample per word, and one descriptor per period linked in a
+ * circle. Period buffers are cacheable: the producer writes them through the
+ * cache and cleans each period when it commits it.
+ *
+ * The PDMA loads the descriptor of the next period as soon as it finishes
+ * one, so the period done interrupt of period n arms period n + 2: pointing
+ * its descriptor at the period buffer if it is committed, or at a zero word
+ * with a fixed source address if not. A period the producer misses is
+ * played as silence and counted as an underrun, the producer then continues
+ * with the first period not armed yet; nothing late is ever played out of
+ * order and the descriptors never have to be reloaded.
+ */
+
+typedef struct
+{
+    uint32_t u32Periods;        /* periods played, silent ones included */
+    uint32_t u32Underruns;      /* periods armed as silence while playing */
+    uint32_t u32MinLead;        /* least committed periods ahead of the PDMA seen at a period done */
+} AUDIO_PIPE_STAT_T;
+
+/* Empty the ring and set how far the producer may run ahead of playback */
+void audio_pipe_init(uint32_t u32SampleRate, uint32_t u32LatencyMs);
+
+/* Start the PDMA on the committed periods, the I2S is enabled by the caller */
+void audio_pipe_start(void);
+
+/*
+ * Producer: room for *pu32Len samples in the period being filled, NULL
+ * while the committed periods already cover the latency.
+ */
+uint32_t *audio_pipe_get(uint32_t *pu32Len);
+
+/* Producer: u32Len samples were written at audio_pipe_get(), a full period is committed */
+void audio_pipe_put(uint32_t u32Len);
+
+/* Producer: end of stream, the partial period is committed padded with silence */
+void audio_pipe_drain(void);
+
+/* Periods committed and not played yet */
+uint32_t audio_pipe_pending(void);
+
+/* Whether audio_pipe_start() was called and audio_pipe_stop() was not */
+int audio_pipe_running(void);
+
+/* Stop the PDMA, committed periods are dropped */
+void audio_pipe_stop(void);
+
+/* Period done interrupt of the PDMA channel */
+void audio_pipe_period_done(void);
+
+void audio_pipe_get_stat(AUDIO_PIPE_STAT_T *psStat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __AUDIO_PIPE_H__ */
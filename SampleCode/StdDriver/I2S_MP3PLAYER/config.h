@@ -17,8 +17,24 @@
 //#define USE_SDH
 #define USE_USBH
 
-#define PCM_BUFFER_SIZE        2304
-#define FILE_IO_BUFFER_SIZE    4096
+#define PCM_BUFFER_SIZE        2304     /* samples of a PCM period, 16-bit stereo in one word  */
+#define FILE_IO_BUFFER_SIZE    4096     /* bytes of a file read                                 */
+#define MP3_INPUT_SIZE         (4 * FILE_IO_BUFFER_SIZE)    /* decoder input buffer            */
+
+/* PCM playback pipeline of audio_pipe.c */
+#define AUDIO_PIPE_PERIODS     8        /* PCM periods of the PDMA descriptor ring              */
+#define AUDIO_PIPE_LATENCY_MS  200      /* how far decoding runs ahead of playback              */
+#define AUDIO_PIPE_PDMA        PDMA2
+#define AUDIO_PIPE_PDMA_CH     2
+#define AUDIO_PIPE_PDMA_REQ    PDMA_I2S0_TX
+#define AUDIO_PIPE_PDMA_IRQn   PDMA2_IRQn
+#define AUDIO_PIPE_I2S         I2S0
+
+/* USB disk read-ahead and write-behind of diskio.c */
+#define DISK_RA_CHUNK_SECTORS  32       /* sectors of a read-ahead chunk          */
+#define DISK_RA_DEPTH          4        /* number of read-ahead chunks            */
+#define DISK_WB_CHUNK_SECTORS  8        /* sectors of a write-behind entry        */
+#define DISK_WB_DEPTH          4        /* number of write-behind entries         */
 
 struct mp3Header
 {
@@ -57,16 +73,14 @@ typedef struct dma_desc_t
 } DMA_DESC_T;
 
 
-void PDMA_Reset_SCTable(uint8_t id);
 void NAU8822_ConfigSampleRate(uint32_t u32SampleRate);
 void NAU88L25_ConfigSampleRate(uint32_t u32SampleRate);
 
 int mp3CountV1L3Headers(unsigned char *pBytes, size_t size);
-extern void PDMA_Init(void);
 extern void NAU8822_Setup(void);
 extern void NAU88L25_Setup(void);
 extern void NAU88L25_Reset(void);
 extern void MP3Player(uint8_t *pFileName);
-extern volatile uint8_t u8PCMBuffer_Playing;
+extern void disk_io_poll(void);
 
 #endif
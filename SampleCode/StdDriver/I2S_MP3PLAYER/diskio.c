@@ -14,6 +14,344 @@
 #include "usbh_lib.h"
 #include "ff.h"
 #include "diskio.h"
+#include "config.h"
+
+/*-----------------------------------------------------------------------*/
+/* Read-ahead / write-behind cache of the USB disk                       */
+/*-----------------------------------------------------------------------*/
+/* Sequential reads are served from a ring of read-ahead chunks which is */
+/* refilled by asynchronous READ_10 commands while the decoder runs.     */
+/* Writes are copied into a bounded queue and written back by            */
+/* asynchronous WRITE_10 commands. The USB mass storage driver allows    */
+/* one asynchronous command per drive, queued writes have priority.      */
+/* The engine is advanced by disk_io_poll() and by every disk access.    */
+/*-----------------------------------------------------------------------*/
+
+#define SECTOR_SIZE     512
+
+#define RA_FREE         0       /* chunk not used */
+#define RA_QUEUED       1       /* chunk waiting to be issued */
+#define RA_BUSY         2       /* chunk read in progress */
+#define RA_VALID        3       /* chunk holds valid data */
+#define RA_ERROR        4       /* chunk read failed */
+
+#define IO_NONE         0       /* no asynchronous command in flight */
+#define IO_READ         1       /* read-ahead chunk in flight */
+#define IO_WRITE        2       /* write-behind entry in flight */
+
+typedef struct
+{
+    DWORD   sector;             /* start sector of the chunk */
+    UINT    count;              /* number of sectors of the chunk */
+    BYTE    state;              /* RA_xxx */
+} RA_CHUNK_T;
+
+typedef struct
+{
+    DWORD   sector;             /* start sector of the entry */
+    UINT    count;              /* number of sectors of the entry */
+} WB_ENTRY_T;
+
+static BYTE s_au8RaPool[DISK_RA_DEPTH][DISK_RA_CHUNK_SECTORS * SECTOR_SIZE] __attribute__((aligned(64)));
+static BYTE s_au8WbPool[DISK_WB_DEPTH][DISK_WB_CHUNK_SECTORS * SECTOR_SIZE] __attribute__((aligned(64)));
+
+static RA_CHUNK_T s_asRa[DISK_RA_DEPTH];
+static UINT       s_u32RaHead;          /* index of the oldest chunk */
+static UINT       s_u32RaCnt;           /* number of chunks in use */
+static DWORD      s_u32RaEnd;           /* first sector after the newest chunk */
+
+static WB_ENTRY_T s_asWb[DISK_WB_DEPTH];
+static UINT       s_u32WbHead;          /* index of the oldest entry */
+static UINT       s_u32WbCnt;           /* number of queued entries */
+static DRESULT    s_eWbErr;             /* failure of a write-behind, reported at next write or sync */
+
+static int        s_i32IoDrv = -1;      /* physical drive bound to the cache */
+static BYTE       s_u8IoOp = IO_NONE;   /* IO_xxx */
+static UINT       s_u32IoIdx;           /* chunk or entry index of the command in flight */
+static DWORD      s_u32LastEnd;         /* first sector after the last read */
+static DWORD      s_u32DiskSectors;     /* capacity of the bound drive */
+
+static BYTE *ra_buff(UINT idx)
+{
+    return (BYTE *)nc_ptr(s_au8RaPool[idx]);
+}
+
+static BYTE *wb_buff(UINT idx)
+{
+    return (BYTE *)nc_ptr(s_au8WbPool[idx]);
+}
+
+static RA_CHUNK_T *ra_chunk(UINT n)    /* n-th chunk counted from the oldest one */
+{
+    return &s_asRa[(s_u32RaHead + n) % DISK_RA_DEPTH];
+}
+
+static WB_ENTRY_T *wb_entry(UINT n)    /* n-th entry counted from the oldest one */
+{
+    return &s_asWb[(s_u32WbHead + n) % DISK_WB_DEPTH];
+}
+
+static int overlap(DWORD s1, UINT c1, DWORD s2, UINT c2)
+{
+    return (s1 < s2 + c2) && (s2 < s1 + c1);
+}
+
+/* Collect the command in flight. Return 1 if it is still in progress. */
+static int io_complete(void)
+{
+    int  ret;
+
+    if (s_u8IoOp == IO_NONE)
+        return 0;
+
+    ret = usbh_umas_async_poll(s_i32IoDrv);
+    if (ret == UMAS_ERR_BUSY)
+        return 1;
+
+    if (s_u8IoOp == IO_READ)
+    {
+        s_asRa[s_u32IoIdx].state = (ret == UMAS_OK) ? RA_VALID : RA_ERROR;
+    }
+    else
+    {
+        if (ret != UMAS_OK)
+            s_eWbErr = RES_ERROR;
+        s_u32WbHead = (s_u32WbHead + 1) % DISK_WB_DEPTH;
+        s_u32WbCnt--;
+    }
+    s_u8IoOp = IO_NONE;
+    return 0;
+}
+
+/* Complete the command in flight and issue the next one. Writes go first. */
+static void io_service(void)
+{
+    UINT n;
+
+    if (io_complete())
+        return;
+
+    if (s_u32WbCnt)
+    {
+        WB_ENTRY_T *wb = wb_entry(0);
+
+        s_u32IoIdx = s_u32WbHead;
+        if (usbh_umas_write_async(s_i32IoDrv, wb->sector, wb->count, wb_buff(s_u32IoIdx)) == UMAS_OK)
+        {
+            s_u8IoOp = IO_WRITE;
+        }
+        else
+        {
+            s_eWbErr = RES_ERROR;
+            s_u32WbHead = (s_u32WbHead + 1) % DISK_WB_DEPTH;
+            s_u32WbCnt--;
+        }
+        return;
+    }
+
+    for (n = 0; n < s_u32RaCnt; n++)
+    {
+        RA_CHUNK_T *ra = ra_chunk(n);
+
+        if (ra->state != RA_QUEUED)
+            continue;
+
+        s_u32IoIdx = (s_u32RaHead + n) % DISK_RA_DEPTH;
+        if (usbh_umas_read_async(s_i32IoDrv, ra->sector, ra->count, ra_buff(s_u32IoIdx)) == UMAS_OK)
+        {
+            ra->state = RA_BUSY;
+            s_u8IoOp = IO_READ;
+        }
+        else
+        {
+            ra->state = RA_ERROR;
+        }
+        return;
+    }
+}
+
+/* Wait for the command in flight without issuing a new one */
+static void io_wait(void)
+{
+    while (io_complete())
+        ;
+}
+
+/* Append chunks after the newest one until the ring is full */
+static void ra_fill(void)
+{
+    while (s_u32RaCnt < DISK_RA_DEPTH && s_u32RaEnd < s_u32DiskSectors)
+    {
+        RA_CHUNK_T *ra = ra_chunk(s_u32RaCnt);
+
+        ra->sector = s_u32RaEnd;
+        ra->count = DISK_RA_CHUNK_SECTORS;
+        if (ra->sector + ra->count > s_u32DiskSectors)
+            ra->count = s_u32DiskSectors - ra->sector;
+        ra->state = RA_QUEUED;
+        s_u32RaEnd += ra->count;
+        s_u32RaCnt++;
+    }
+}
+
+/* Drop all chunks. A chunk in flight is waited for, its buffer is about to be reused. */
+static void ra_drop(void)
+{
+    s_u32RaCnt = 0;
+    if (s_u8IoOp == IO_READ)
+        io_wait();
+}
+
+/* Release the chunks entirely before the given sector */
+static void ra_consume(DWORD sector)
+{
+    while (s_u32RaCnt)
+    {
+        RA_CHUNK_T *ra = ra_chunk(0);
+
+        if (ra->sector + ra->count > sector || ra->state == RA_BUSY)
+            break;
+        s_u32RaHead = (s_u32RaHead + 1) % DISK_RA_DEPTH;
+        s_u32RaCnt--;
+    }
+}
+
+/* Serve a read from the ring. Return 0 when the ring does not cover it. */
+static int ra_read(BYTE *buff, DWORD sector, UINT count)
+{
+    if (s_u32RaCnt == 0 || sector < ra_chunk(0)->sector || sector + count > s_u32RaEnd)
+        return 0;
+
+    while (count)
+    {
+        RA_CHUNK_T *ra = NULL;
+        UINT n, idx, cnt;
+
+        for (n = 0; n < s_u32RaCnt; n++)
+        {
+            ra = ra_chunk(n);
+            if (sector < ra->sector + ra->count)
+                break;
+        }
+        idx = (s_u32RaHead + n) % DISK_RA_DEPTH;
+
+        while (ra->state == RA_QUEUED || ra->state == RA_BUSY)
+            io_service();
+
+        if (ra->state != RA_VALID)
+        {
+            ra_drop();
+            return 0;
+        }
+
+        cnt = ra->sector + ra->count - sector;
+        if (cnt > count)
+            cnt = count;
+        memcpy(buff, ra_buff(idx) + (sector - ra->sector) * SECTOR_SIZE, cnt * SECTOR_SIZE);
+        buff += cnt * SECTOR_SIZE;
+        sector += cnt;
+        count -= cnt;
+    }
+    return 1;
+}
+
+/* Wait until all queued writes reached the disk */
+static void wb_flush(void)
+{
+    while (s_u32WbCnt || s_u8IoOp == IO_WRITE)
+        io_service();
+}
+
+static int wb_overlap(DWORD sector, UINT count)
+{
+    UINT n;
+
+    for (n = 0; n < s_u32WbCnt; n++)
+    {
+        if (overlap(wb_entry(n)->sector, wb_entry(n)->count, sector, count))
+            return 1;
+    }
+    return 0;
+}
+
+/* Queue a write. Return 0 when the write does not fit into an entry. */
+static int wb_write(const BYTE *buff, DWORD sector, UINT count)
+{
+    WB_ENTRY_T *wb;
+    UINT idx;
+
+    if (count > DISK_WB_CHUNK_SECTORS)
+        return 0;
+
+    /* Merge with the newest entry if it is not in flight and the data fits in */
+    if (s_u32WbCnt && !(s_u8IoOp == IO_WRITE && s_u32WbCnt == 1))
+    {
+        idx = (s_u32WbHead + s_u32WbCnt - 1) % DISK_WB_DEPTH;
+        wb = &s_asWb[idx];
+        if (sector >= wb->sector && sector <= wb->sector + wb->count &&
+                sector + count <= wb->sector + DISK_WB_CHUNK_SECTORS)
+        {
+            memcpy(wb_buff(idx) + (sector - wb->sector) * SECTOR_SIZE, buff, count * SECTOR_SIZE);
+            if (sector + count > wb->sector + wb->count)
+                wb->count = sector + count - wb->sector;
+            return 1;
+        }
+    }
+
+    while (s_u32WbCnt == DISK_WB_DEPTH)
+        io_service();
+
+    idx = (s_u32WbHead + s_u32WbCnt) % DISK_WB_DEPTH;
+    wb = &s_asWb[idx];
+    memcpy(wb_buff(idx), buff, count * SECTOR_SIZE);
+    wb->sector = sector;
+    wb->count = count;
+    s_u32WbCnt++;
+    return 1;
+}
+
+static void io_bind(BYTE pdrv)
+{
+    DWORD  u32Sectors = 0;
+
+    s_i32IoDrv = pdrv;
+    s_u8IoOp = IO_NONE;
+    s_u32RaCnt = 0;
+    s_u32WbCnt = 0;
+    s_eWbErr = RES_OK;
+    s_u32LastEnd = 0;
+
+    usbh_umas_ioctl(pdrv, GET_SECTOR_COUNT, &u32Sectors);
+    s_u32DiskSectors = u32Sectors;
+
+    /* Pools are accessed via the non-cacheable alias only. */
+    dcache_clean_invalidate_by_mva(s_au8RaPool, sizeof(s_au8RaPool));
+    dcache_clean_invalidate_by_mva(s_au8WbPool, sizeof(s_au8WbPool));
+}
+
+/*
+ * Forget the chunks and the queued writes of a medium which is gone or may
+ * have been replaced. Nothing is written: the queued data belongs to the old
+ * medium. The command in flight is only collected, it owns a pool buffer.
+ */
+static void io_unbind(void)
+{
+    io_wait();
+    s_u32RaCnt = 0;
+    s_u32WbCnt = 0;
+    s_eWbErr = RES_OK;
+    s_i32IoDrv = -1;
+}
+
+/**
+ *  @brief  Advance the asynchronous read-ahead and write-behind of the USB disk.
+ *          Call it while the CPU waits for something else.
+ */
+void disk_io_poll(void)
+{
+    if (s_i32IoDrv >= 0)
+        io_service();
+}
 
 /*-----------------------------------------------------------------------*/
 /* Initialize a Drive                                                    */
@@ -21,8 +359,16 @@
 DSTATUS disk_initialize (BYTE pdrv)       /* Physical drive number (0..) */
 {
     usbh_pooling_hubs();
+
+    /* FatFs initializes a drive again after the medium was removed or changed */
+    if (s_i32IoDrv == pdrv)
+        io_unbind();
+
     if (usbh_umas_disk_status(pdrv) == UMAS_ERR_NO_DEVICE)
         return STA_NODISK;
+
+    if (s_i32IoDrv < 0)
+        io_bind(pdrv);
     return RES_OK;
 }
 
@@ -35,7 +381,11 @@ DSTATUS disk_status (BYTE pdrv)       /* Physical drive number (0..) */
 {
     usbh_pooling_hubs();
     if (usbh_umas_disk_status(pdrv) == UMAS_ERR_NO_DEVICE)
+    {
+        if (s_i32IoDrv == pdrv)
+            io_unbind();
         return STA_NODISK;
+    }
     return RES_OK;
 }
 
@@ -51,21 +401,61 @@ DRESULT disk_read (
 )
 {
     int       ret;
+    int       bSequential;
 //  int       sec_size;
 
     // printf("disk_read - drv:%d, sec:%d, cnt:%d, buff:0x%x\n", pdrv, sector, count, (uint32_t)buff);
 
+    if (pdrv == s_i32IoDrv)
+    {
+        bSequential = (sector == s_u32LastEnd);
+        s_u32LastEnd = sector + count;
+
+        if (wb_overlap(sector, count))
+            wb_flush();
+
+        if (ra_read(buff, sector, count))
+        {
+            ra_consume(sector + count);
+            ra_fill();
+            io_service();
+            return RES_OK;
+        }
+
+        /*
+         * A sequential miss starts a new stream, and so does any miss without
+         * a stream to keep. Others (FAT, directory) keep the ring.
+         */
+        if (bSequential || s_u32RaCnt == 0)
+        {
+            ra_drop();
+            s_u32RaEnd = sector + count;
+        }
+        io_wait();
+    }
+
     ret = usbh_umas_read(pdrv, sector, count, buff);
     if (ret != UMAS_OK)
     {
         usbh_umas_reset_disk(pdrv);
         ret = usbh_umas_read(pdrv, sector, count, buff);
     }
+
+    if ((pdrv == s_i32IoDrv) && (ret == UMAS_OK))
+    {
+        ra_fill();
+        io_service();
+    }
+
     if (ret == UMAS_OK)
         return RES_OK;
 
     if (ret == UMAS_ERR_NO_DEVICE)
+    {
+        if (pdrv == s_i32IoDrv)
+            io_unbind();
         return RES_NOTRDY;
+    }
 
     if (ret == UMAS_ERR_IO)
         return RES_ERROR;
@@ -87,10 +477,34 @@ DRESULT disk_write (
 )
 {
     int       ret;
+    DRESULT   res;
 //  int       sec_size;
 
     //printf("disk_write - drv:%d, sec:%d, cnt:%d, buff:0x%x\n", pdrv, sector, count, (uint32_t)buff);
 
+    if (pdrv == s_i32IoDrv)
+    {
+        if (s_eWbErr != RES_OK)
+        {
+            res = s_eWbErr;
+            s_eWbErr = RES_OK;
+            return res;
+        }
+
+        /* The ring must not serve data older than this write. */
+        if (s_u32RaCnt && overlap(ra_chunk(0)->sector, s_u32RaEnd - ra_chunk(0)->sector, sector, count))
+            ra_drop();
+
+        if (wb_write(buff, sector, count))
+        {
+            io_service();
+            return RES_OK;
+        }
+
+        wb_flush();
+        io_wait();
+    }
+
     ret = usbh_umas_write(pdrv, sector, count, (uint8_t *)buff);
     if (ret != UMAS_OK)
     {
@@ -102,7 +516,11 @@ DRESULT disk_write (
         return RES_OK;
 
     if (ret == UMAS_ERR_NO_DEVICE)
+    {
+        if (pdrv == s_i32IoDrv)
+            io_unbind();
         return RES_NOTRDY;
+    }
 
     if (ret == UMAS_ERR_IO)
         return RES_ERROR;
@@ -122,6 +540,18 @@ DRESULT disk_ioctl (
 )
 {
     int  ret;
+    DRESULT   res;
+
+    if ((pdrv == s_i32IoDrv) && (cmd == CTRL_SYNC))
+    {
+        wb_flush();
+        if (s_eWbErr != RES_OK)
+        {
+            res = s_eWbErr;
+            s_eWbErr = RES_OK;
+            return res;
+        }
+    }
 
     ret = usbh_umas_ioctl(pdrv, cmd, buff);
 
@@ -132,10 +562,12 @@ DRESULT disk_ioctl (
         return RES_PARERR;
 
     if (ret == UMAS_ERR_NO_DEVICE)
+    {
+        if (pdrv == s_i32IoDrv)
+            io_unbind();
         return RES_NOTRDY;
+    }
 
     return RES_PARERR;
 }
 
-
-
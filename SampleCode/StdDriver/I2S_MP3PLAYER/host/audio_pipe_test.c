@@ -0,0 +1,333 @@
+/**************************************************************************//**
+ * @file     audio_pipe_test.c
+ *
+ * @brief    Test of the PCM playback pipeline of the I2S_MP3PLAYER sample,
+ *           audio_pipe.c, against a simulated PDMA.
+ *
+ * A producer written like MP3_Output() of mp3.c numbers its samples from 1,
+ * the PDMA plays them into a log, and the log is checked period by period:
+ * every period played is silence or a committed period in order, nothing is
+ * played twice, every silent period before the drain is counted as an
+ * underrun, and without underruns the stream comes out whole. The interrupt
+ * is taken up to a period late. It never preempts the producer inside an
+ * audio_pipe_* call, the target may; the cache cleans are not modelled.
+ *
+ * Run: ./audio_pipe_test
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "config.h"
+#include "audio_pipe.h"
+#include "pdma_sim.h"
+
+#define PS		PCM_BUFFER_SIZE
+#define FRAME		1152		/* samples of an MP3 frame */
+#define WAIT_WORDS	64		/* words played while the producer waits for room */
+#define MAX_PERIODS	512		/* periods the log holds */
+#define MAX_WAITS	(2 * AUDIO_PIPE_PERIODS * PS / WAIT_WORDS)	/* waits for a period to play */
+
+static int s_fail;
+static int s_verbose;
+
+#define CHECK(c, ...)							\
+	do {								\
+		if (!(c)) {						\
+			printf("  FAIL %s:%d: ", __func__, __LINE__);	\
+			printf(__VA_ARGS__);				\
+			printf("\n");					\
+			s_fail++;					\
+			return;						\
+		}							\
+	} while (0)
+
+static uint32_t s_log[MAX_PERIODS * PS];	/* words played */
+static uint32_t s_nlog;
+static int s_overflow;
+static uint32_t s_next;				/* last sample produced */
+static uint32_t s_max_pending;
+static unsigned long s_drain_irqs;		/* interrupts taken before the drain */
+static int s_stuck;				/* no room, or nothing played, for too long */
+
+static void sink(uint32_t word)
+{
+	if (s_nlog < MAX_PERIODS * PS)
+		s_log[s_nlog++] = word;
+	else
+		s_overflow = 1;
+}
+
+static void setup(uint32_t rate, uint32_t latency_ms)
+{
+	audio_pipe_stop();
+	pdma_sim_reset();
+	pdma_sim_set_handler(audio_pipe_period_done);
+	pdma_sim_set_sink(sink);
+	s_nlog = 0;
+	s_overflow = 0;
+	s_max_pending = 0;
+	s_drain_irqs = ~0UL;
+	s_stuck = 0;
+	audio_pipe_init(rate, latency_ms);
+}
+
+/* The PDMA plays while the producer decodes or waits, the interrupt runs up to a period late */
+static void play(unsigned int words)
+{
+	pdma_sim_set_irq_delay((unsigned int)rand() % PS);
+	pdma_sim_run(words);
+}
+
+static void note_pending(void)
+{
+	if (audio_pipe_pending() > s_max_pending)
+		s_max_pending = audio_pipe_pending();
+}
+
+/* MP3_Output() and MP3_WaitOutput() of mp3.c */
+static void output(uint32_t len)
+{
+	uint32_t *pu32Pcm, u32Len, i, k, waits = 0;
+
+	for (i = 0; i < len && !s_stuck; i += u32Len) {
+		while ((pu32Pcm = audio_pipe_get(&u32Len)) == NULL) {
+			if (!audio_pipe_running())
+				audio_pipe_start();
+			else
+				play(WAIT_WORDS);
+			if (++waits > MAX_WAITS) {
+				s_stuck = 1;
+				return;
+			}
+		}
+		if (u32Len > len - i)
+			u32Len = len - i;
+		for (k = 0; k < u32Len; k++)
+			pu32Pcm[k] = ++s_next;
+		audio_pipe_put(u32Len);
+		note_pending();
+	}
+}
+
+/* The end of MP3Player() */
+static void drain(void)
+{
+	uint32_t waits = 0;
+
+	s_drain_irqs = pdma_sim_stats()->irqs;
+	audio_pipe_drain();
+	note_pending();
+	if (audio_pipe_pending() && !audio_pipe_running())
+		audio_pipe_start();
+	while (audio_pipe_pending() && !s_stuck) {
+		play(WAIT_WORDS);
+		if (++waits > MAX_WAITS * AUDIO_PIPE_PERIODS)
+			s_stuck = 1;
+	}
+	/* Out to the last period armed, silent ones included */
+	play(2 * PS);
+}
+
+/*
+ * A stream of the given length; a frame costs cost_pct percent of its
+ * playing time, one in stall_every frames costs stall_periods periods.
+ */
+static void stream(uint32_t samples, unsigned int cost_pct, unsigned int stall_every,
+		   unsigned int stall_periods)
+{
+	uint32_t done, len, frames = 0;
+
+	for (done = 0; done < samples && !s_stuck; done += len) {
+		len = samples - done < FRAME ? samples - done : FRAME;
+		output(len);
+		if (!audio_pipe_running())
+			continue;
+		if (stall_every && (++frames % stall_every) == 0)
+			play(stall_periods * PS);
+		else
+			play(len * ((unsigned int)rand() % (cost_pct + 1)) / 100);
+	}
+	drain();
+}
+
+/*
+ * The log against the stream first..s_next: returns the underruns seen.
+ * Periods armed by an interrupt before the drain, from the third one, are
+ * underruns when silent.
+ */
+static int check_log(uint32_t first, uint32_t *lost)
+{
+	uint32_t p, k, last = first - 1, played = 0, silent = 0;
+	int end = 0;
+	const uint32_t *w;
+
+	if (s_overflow)
+		return -1;
+	for (p = 0; p < s_nlog / PS; p++) {
+		w = &s_log[p * PS];
+		if (w[0] == 0) {
+			for (k = 1; k < PS && w[k] == 0; k++)
+				;
+			if (k < PS) {
+				printf("  period %u: silence then sample %u\n", p, w[k]);
+				return -1;
+			}
+			if (p >= 2 && p <= s_drain_irqs + 1)
+				silent++;
+			continue;
+		}
+		if (end || w[0] <= last || w[0] > s_next) {
+			printf("  period %u: sample %u after sample %u\n", p, w[0], last);
+			return -1;
+		}
+		/* A whole committed period, the last one may be padded with silence */
+		for (k = 1; k < PS && w[k] == w[0] + k; k++)
+			;
+		played += k;
+		last = w[k - 1];
+		if (k < PS) {
+			for (; k < PS && w[k] == 0; k++)
+				;
+			if (k < PS || last != s_next) {
+				printf("  period %u: broken at sample %u\n", p, last);
+				return -1;
+			}
+			end = 1;
+		}
+	}
+	*lost = s_next - (first - 1) - played;
+	return (int)silent;
+}
+
+static void check_stream(uint32_t first, int expect_underruns)
+{
+	AUDIO_PIPE_STAT_T sStat;
+	struct pdma_sim_stats *st = pdma_sim_stats();
+	uint32_t lost = 0;
+	int silent;
+
+	audio_pipe_get_stat(&sStat);
+	silent = check_log(first, &lost);
+	if (s_verbose)
+		printf("  %u samples: %u periods played, %u underruns, %u samples lost, at least %u periods ahead\n",
+		       s_next - first + 1, sStat.u32Periods, sStat.u32Underruns, lost, sStat.u32MinLead);
+	CHECK(!s_stuck, "the pipeline stalled");
+	CHECK(silent >= 0, "log of the PDMA");
+	CHECK(st->bad_descs == 0, "bad descriptors");
+	CHECK(st->lost_irqs == 0, "%lu interrupts merged", st->lost_irqs);
+	CHECK(sStat.u32Periods == st->irqs, "%u periods for %lu interrupts", sStat.u32Periods, st->irqs);
+	CHECK(sStat.u32Underruns == (uint32_t)silent, "%u underruns counted, %d silent periods",
+	      sStat.u32Underruns, silent);
+	CHECK(s_max_pending <= AUDIO_PIPE_PERIODS - 1, "%u periods pending", s_max_pending);
+	if (expect_underruns) {
+		CHECK(sStat.u32Underruns > 0, "no underrun");
+		/* Only a period being filled when it was armed as silence is lost */
+		CHECK(lost <= sStat.u32Underruns * PS, "%u samples lost", lost);
+	} else {
+		CHECK(sStat.u32Underruns == 0, "%u underruns", sStat.u32Underruns);
+		CHECK(lost == 0, "%u samples lost", lost);
+	}
+}
+
+/* Periods committed before the producer has to wait */
+static void test_latency(void)
+{
+	static const struct {
+		uint32_t rate, ms, ahead;
+	} t[] = {
+		{ 44100, 200, 4 },
+		{ 44100, 300, 6 },
+		{ 44100, 400, AUDIO_PIPE_PERIODS - 1 },
+		{ 48000, 0, 2 },
+		{ 8000, 100, 2 },
+		{ 48000, 10000, AUDIO_PIPE_PERIODS - 1 },
+	};
+	uint32_t *pu32Pcm, u32Len;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(t) / sizeof(t[0]); i++) {
+		setup(t[i].rate, t[i].ms);
+		while ((pu32Pcm = audio_pipe_get(&u32Len)) != NULL) {
+			memset(pu32Pcm, 0x55, u32Len * 4);
+			audio_pipe_put(u32Len);
+		}
+		CHECK(audio_pipe_pending() == t[i].ahead, "%u Hz, %u ms: %u periods ahead",
+		      t[i].rate, t[i].ms, audio_pipe_pending());
+	}
+}
+
+/* The producer keeps ahead: the whole stream, in order, no underrun */
+static void test_steady(uint32_t latency_ms)
+{
+	uint32_t first = s_next + 1;
+
+	setup(44100, latency_ms);
+	stream(100 * PS + 777, 60, 0, 0);
+	check_stream(first, 0);
+}
+
+/* The producer misses periods: silence, counted, and the stream goes on in order */
+static void test_underrun(unsigned int stall_every, unsigned int stall_periods)
+{
+	uint32_t first = s_next + 1;
+
+	setup(44100, 200);
+	stream(100 * PS + 5, 50, stall_every, stall_periods);
+	check_stream(first, 1);
+}
+
+/* Shorter than the latency: played from the drain, padded with silence */
+static void test_short(uint32_t samples)
+{
+	uint32_t first = s_next + 1;
+
+	setup(48000, 200);
+	stream(samples, 60, 0, 0);
+	check_stream(first, 0);
+	CHECK(s_nlog >= ((samples + PS - 1) / PS) * PS, "%u words played", s_nlog);
+}
+
+/* Stopped in the middle, nothing of the old stream comes out after a new init */
+static void test_restart(void)
+{
+	uint32_t first;
+
+	setup(44100, 200);
+	output(20 * PS);
+	play(3 * PS);
+	audio_pipe_stop();
+
+	first = s_next + 1;
+	setup(44100, 200);
+	stream(30 * PS + 100, 60, 0, 0);
+	check_stream(first, 0);
+	CHECK(s_log[0] == first, "started with sample %u, not %u", s_log[0], first);
+}
+
+int main(void)
+{
+	unsigned int seed;
+
+	for (seed = 1; seed <= 20 && !s_fail; seed++) {
+		srand(seed);
+		s_verbose = seed == 1;
+		test_latency();
+		test_steady(200);
+		test_steady(1000);
+		test_underrun(7, 5);
+		test_underrun(3, 2);
+		test_short(1);
+		test_short(PS + 3);
+		test_short(3 * PS);
+		test_restart();
+	}
+	audio_pipe_stop();
+
+	printf("%s\n", s_fail ? "FAIL" : "PASS");
+	return s_fail ? 1 : 0;
+}
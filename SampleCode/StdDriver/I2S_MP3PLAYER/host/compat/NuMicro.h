@@ -0,0 +1,82 @@
+/**************************************************************************//**
+ * @file     NuMicro.h
+ *
+ * @brief    Host stand-in for the device header, with what diskio.c and
+ *           audio_pipe.c use: the non-cacheable alias, the cache maintenance
+ *           calls and the PDMA and I2S of the PCM pipeline, served by
+ *           pdma_sim.c.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __HOST_NUMICRO_H__
+#define __HOST_NUMICRO_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* One memory, no caches */
+#define nc_ptr(x)	((void *)(x))
+
+static inline void dcache_clean_invalidate_by_mva(void const *addr, size_t len)
+{
+	(void)addr;
+	(void)len;
+}
+
+static inline void dcache_clean_by_mva(void const *addr, size_t len)
+{
+	(void)addr;
+	(void)len;
+}
+
+#define __DSB()		do { } while (0)
+
+/* The PDMA takes 32-bit addresses: link with -no-pie to keep static data below 4 GB */
+#define ptr_to_u32(x)	((uint32_t)(uintptr_t)(x))
+
+typedef int32_t IRQn_ID_t;
+
+#define PDMA2_IRQn	77
+
+int32_t IRQ_Enable(IRQn_ID_t irqn);
+int32_t IRQ_Disable(IRQn_ID_t irqn);
+
+typedef struct {
+	volatile uint32_t TXFIFO;
+} I2S_T;
+
+typedef struct {
+	uint32_t ch_en;
+} PDMA_T;
+
+extern I2S_T sim_i2s0;
+extern PDMA_T sim_pdma2;
+
+#define I2S0		(&sim_i2s0)
+#define PDMA2		(&sim_pdma2)
+
+/* As in pdma.h and pdma_reg.h */
+#define PDMA_DSCT_CTL_OPMODE_Msk	0x00000003UL
+#define PDMA_DSCT_CTL_SAINC_Msk		0x00000300UL
+#define PDMA_DSCT_CTL_DAINC_Msk		0x00000C00UL
+#define PDMA_DSCT_CTL_TXWIDTH_Msk	0x00003000UL
+#define PDMA_DSCT_CTL_TXCNT_Pos		16
+#define PDMA_DSCT_CTL_TXCNT_Msk		(0xFFFFUL << PDMA_DSCT_CTL_TXCNT_Pos)
+
+#define PDMA_OP_SCATTER		0x00000002UL
+#define PDMA_WIDTH_32		0x00002000UL
+#define PDMA_SAR_INC		0x00000000UL
+#define PDMA_SAR_FIX		0x00000300UL
+#define PDMA_DAR_FIX		0x00000C00UL
+#define PDMA_REQ_SINGLE		0x00000004UL
+#define PDMA_I2S0_TX		86UL
+
+void PDMA_Open(PDMA_T *pdma, uint32_t u32Mask);
+void PDMA_Close(PDMA_T *pdma);
+void PDMA_SetTransferMode(PDMA_T *pdma, uint32_t u32Ch, uint32_t u32Peripheral,
+			  uint32_t u32ScatterEn, uint32_t u32DescAddr);
+void PDMA_EnableInt(PDMA_T *pdma, uint32_t u32Ch, uint32_t u32Mask);
+void PDMA_DisableInt(PDMA_T *pdma, uint32_t u32Ch, uint32_t u32Mask);
+
+#endif /* __HOST_NUMICRO_H__ */
@@ -0,0 +1,31 @@
+/**************************************************************************//**
+ * @file     usbh_lib.h
+ *
+ * @brief    Host stand-in for the USB Host Library API of the mass storage
+ *           driver, served by usbh_sim.c.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __HOST_USBH_LIB_H__
+#define __HOST_USBH_LIB_H__
+
+#include <stdint.h>
+
+#define UMAS_OK			0
+#define UMAS_ERR_NO_DEVICE	-1031
+#define UMAS_ERR_IO		-1033
+#define UMAS_ERR_IVALID_PARM	-1038
+#define UMAS_ERR_BUSY		-1040
+
+int usbh_pooling_hubs(void);
+int usbh_umas_disk_status(int drv_no);
+int usbh_umas_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
+int usbh_umas_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
+int usbh_umas_ioctl(int drv_no, int cmd, void *buff);
+int usbh_umas_reset_disk(int drv_no);
+int usbh_umas_read_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
+int usbh_umas_write_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff);
+int usbh_umas_async_poll(int drv_no);
+
+#endif /* __HOST_USBH_LIB_H__ */
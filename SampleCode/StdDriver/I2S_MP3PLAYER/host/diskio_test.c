@@ -0,0 +1,351 @@
+/**************************************************************************//**
+ * @file     diskio_test.c
+ *
+ * @brief    Test of the USB disk read-ahead and write-behind of the
+ *           I2S_MP3PLAYER diskio.c against a simulated drive.
+ *
+ * Checks the data every read returns and the commands the drive sees:
+ * a sequential stream is served by asynchronous read-ahead chunks while
+ * FAT and directory reads go around it, written sectors are never read
+ * stale, queued writes reach the medium by CTRL_SYNC, a failed
+ * write-behind is reported, nothing cached or queued outlives the medium,
+ * and a random mix of reads, writes and syncs
+ * matches a plain model of the disk.
+ *
+ * Run: ./diskio_test
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "ff.h"
+#include "diskio.h"
+#include "config.h"
+#include "usbh_sim.h"
+
+#define SS			SIM_SECTOR_SIZE
+#define DISK_SECTORS		8192
+#define FAT_SECTOR		40		/* somewhere away from the streams */
+#define POLLS_PER_READ		4		/* disk_io_poll() calls of the decoder between reads */
+
+static int s_fail;
+
+#define CHECK(c, ...)							\
+	do {								\
+		if (!(c)) {						\
+			printf("  FAIL %s:%d: ", __func__, __LINE__);	\
+			printf(__VA_ARGS__);				\
+			printf("\n");					\
+			s_fail++;					\
+			return;						\
+		}							\
+	} while (0)
+
+static BYTE s_model[DISK_SECTORS][SS];		/* what the disk must hold */
+
+static void setup(unsigned int latency)
+{
+	uint32_t s;
+
+	usbh_sim_destroy();
+	if (usbh_sim_create(DISK_SECTORS)) {
+		fprintf(stderr, "no memory\n");
+		exit(2);
+	}
+	usbh_sim_set_latency(latency);
+	for (s = 0; s < DISK_SECTORS; s++)
+		memcpy(s_model[s], usbh_sim_sector(s), SS);
+	/* Binds the cache to drive 0 and resets it */
+	disk_initialize(0);
+}
+
+static int same_as_model(const BYTE *buff, DWORD sector, UINT count)
+{
+	return memcmp(buff, s_model[sector], (size_t)count * SS) == 0;
+}
+
+static void fill(BYTE *buff, DWORD sector, UINT count, unsigned int seed)
+{
+	size_t i;
+
+	for (i = 0; i < (size_t)count * SS; i++)
+		buff[i] = (BYTE)(seed * 29 + sector * 3 + i * 5 + (i >> 9));
+}
+
+static DRESULT model_write(DWORD sector, UINT count, unsigned int seed)
+{
+	BYTE buff[16 * SS];
+
+	fill(buff, sector, count, seed);
+	memcpy(s_model[sector], buff, (size_t)count * SS);
+	return disk_write(0, buff, sector, count);
+}
+
+static void poll_some(void)
+{
+	int i;
+
+	for (i = 0; i < POLLS_PER_READ; i++)
+		disk_io_poll();
+}
+
+/* A file read FILE_IO_BUFFER_SIZE at a time, the FAT now and then */
+static void test_stream(unsigned int latency)
+{
+	BYTE buff[FILE_IO_BUFFER_SIZE];
+	UINT cnt = FILE_IO_BUFFER_SIZE / SS;
+	DWORD sector, start = 1000, len = 4096;
+	struct usbh_sim_stats *st;
+
+	setup(latency);
+	st = usbh_sim_stats();
+	for (sector = start; sector < start + len; sector += cnt) {
+		CHECK(disk_read(0, buff, sector, cnt) == RES_OK, "read %lu", sector);
+		CHECK(same_as_model(buff, sector, cnt), "data of sector %lu", sector);
+		if (((sector - start) % 256) == 0) {
+			CHECK(disk_read(0, buff, FAT_SECTOR, 1) == RES_OK, "FAT read");
+			CHECK(same_as_model(buff, FAT_SECTOR, 1), "FAT data");
+		}
+		poll_some();
+	}
+
+	printf("  latency %3u: %lu sectors by %lu sync reads, %lu by %lu read-ahead chunks\n",
+	       latency, st->sync_read_secs, st->sync_read_cmds, st->async_read_secs, st->async_read_cmds);
+	/* The first read and the FAT reads only */
+	CHECK(st->sync_read_cmds <= 1 + len / 256, "%lu synchronous reads", st->sync_read_cmds);
+	CHECK(st->async_read_secs >= len - cnt, "read-ahead covered %lu of %lu sectors", st->async_read_secs, len);
+	/* Never more than the stream plus the ring ahead of it */
+	CHECK(st->async_read_secs <= len + DISK_RA_DEPTH * DISK_RA_CHUNK_SECTORS,
+	      "%lu sectors read ahead", st->async_read_secs);
+	CHECK(st->max_async_read == DISK_RA_CHUNK_SECTORS, "chunks of %lu sectors", st->max_async_read);
+	CHECK(st->bad_params == 0, "commands outside the disk");
+}
+
+/* FatFs reading a file through its sector window, one sector at a time */
+static void test_single_sectors(void)
+{
+	BYTE buff[SS];
+	DWORD sector;
+	struct usbh_sim_stats *st;
+
+	setup(2);
+	st = usbh_sim_stats();
+	for (sector = 3000; sector < 3000 + 1024; sector++) {
+		CHECK(disk_read(0, buff, sector, 1) == RES_OK, "read %lu", sector);
+		CHECK(same_as_model(buff, sector, 1), "data of sector %lu", sector);
+		disk_io_poll();
+	}
+	CHECK(st->sync_read_cmds == 1, "%lu synchronous reads", st->sync_read_cmds);
+}
+
+/* The stream runs into the last sector of the disk */
+static void test_disk_end(void)
+{
+	BYTE buff[FILE_IO_BUFFER_SIZE];
+	UINT cnt = 3;
+	DWORD sector;
+
+	setup(1);
+	for (sector = DISK_SECTORS - 700; sector + cnt <= DISK_SECTORS; sector += cnt) {
+		CHECK(disk_read(0, buff, sector, cnt) == RES_OK, "read %lu", sector);
+		CHECK(same_as_model(buff, sector, cnt), "data of sector %lu", sector);
+		poll_some();
+	}
+	CHECK(usbh_sim_stats()->bad_params == 0, "commands outside the disk");
+}
+
+/* Writes inside the read-ahead ring and over queued writes are never read stale */
+static void test_coherence(void)
+{
+	BYTE buff[FILE_IO_BUFFER_SIZE];
+	UINT cnt = FILE_IO_BUFFER_SIZE / SS;
+	DWORD sector, start = 2000;
+
+	setup(5);
+	for (sector = start; sector < start + 64; sector += cnt) {
+		CHECK(disk_read(0, buff, sector, cnt) == RES_OK, "read %lu", sector);
+		poll_some();
+	}
+
+	/* Ahead of the stream, in a chunk that is already read or in flight */
+	CHECK(model_write(start + 70, 2, 1) == RES_OK, "write");
+	CHECK(model_write(start + 64 + DISK_RA_CHUNK_SECTORS, 1, 2) == RES_OK, "write");
+	/* Read back while still queued */
+	CHECK(disk_read(0, buff, start + 70, 2) == RES_OK, "read back");
+	CHECK(same_as_model(buff, start + 70, 2), "read back of a queued write");
+
+	for (sector = start + 64; sector < start + 512; sector += cnt) {
+		CHECK(disk_read(0, buff, sector, cnt) == RES_OK, "read %lu", sector);
+		CHECK(same_as_model(buff, sector, cnt), "data of sector %lu after a write", sector);
+		poll_some();
+	}
+	CHECK(disk_ioctl(0, CTRL_SYNC, NULL) == RES_OK, "sync");
+	CHECK(memcmp(usbh_sim_sector(start + 70), s_model[start + 70], 2 * SS) == 0, "medium after sync");
+}
+
+/* Small appends are merged, queued, and on the medium after CTRL_SYNC */
+static void test_write_behind(void)
+{
+	struct usbh_sim_stats *st;
+	DWORD sector;
+
+	setup(20);
+	st = usbh_sim_stats();
+	for (sector = 5000; sector < 5100; sector++)
+		CHECK(model_write(sector, 1, 3) == RES_OK, "write %lu", sector);
+	CHECK(st->sync_write_secs == 0, "%lu sectors written synchronously", st->sync_write_secs);
+	CHECK(disk_ioctl(0, CTRL_SYNC, NULL) == RES_OK, "sync");
+	CHECK(st->async_write_secs == 100, "%lu sectors written behind", st->async_write_secs);
+	CHECK(memcmp(usbh_sim_sector(5000), s_model[5000], 100 * SS) == 0, "medium after sync");
+
+	/* Larger than an entry: written through */
+	CHECK(model_write(6000, DISK_WB_CHUNK_SECTORS + 1, 4) == RES_OK, "write through");
+	CHECK(st->sync_write_secs == DISK_WB_CHUNK_SECTORS + 1, "write through of %lu sectors", st->sync_write_secs);
+	CHECK(memcmp(usbh_sim_sector(6000), s_model[6000], (DISK_WB_CHUNK_SECTORS + 1) * SS) == 0,
+	      "medium after write through");
+}
+
+/* A failed write-behind surfaces at the next sync, once */
+static void test_write_error(void)
+{
+	setup(3);
+	usbh_sim_fail_next_write();
+	CHECK(model_write(7000, 1, 5) == RES_OK, "queued write");
+	CHECK(disk_ioctl(0, CTRL_SYNC, NULL) == RES_ERROR, "sync reports the failed write");
+	CHECK(disk_ioctl(0, CTRL_SYNC, NULL) == RES_OK, "the error is reported once");
+}
+
+/* Another medium with every byte set to b, as the cache under test finds it */
+static void swap_medium(BYTE b)
+{
+	uint32_t s;
+
+	usbh_sim_destroy();
+	if (usbh_sim_create(DISK_SECTORS)) {
+		fprintf(stderr, "no memory\n");
+		exit(2);
+	}
+	usbh_sim_set_latency(20);
+	for (s = 0; s < DISK_SECTORS; s++)
+		memset(usbh_sim_sector(s), b, SS);
+}
+
+static int medium_is(DWORD sector, UINT count, BYTE b)
+{
+	UINT i;
+
+	for (i = 0; i < count * SS; i++)
+		if (usbh_sim_sector(sector)[i] != b)
+			return 0;
+	return 1;
+}
+
+/* Queued writes and read-ahead of a replaced medium are dropped, not written to the new one */
+static void test_media_change(void)
+{
+	BYTE buff[FILE_IO_BUFFER_SIZE];
+	UINT cnt = FILE_IO_BUFFER_SIZE / SS;
+	DWORD sector;
+
+	setup(20);
+	for (sector = 2000; sector < 2000 + 4 * cnt; sector += cnt)
+		CHECK(disk_read(0, buff, sector, cnt) == RES_OK, "read %lu", sector);
+	for (sector = 5000; sector < 5100; sector++)
+		CHECK(model_write(sector, 1, 6) == RES_OK, "write %lu", sector);
+	CHECK(usbh_sim_stats()->async_write_secs < 100, "nothing left queued to test");
+
+	/* Removed and another one plugged in before FatFs noticed */
+	swap_medium(0xA5);
+	CHECK(disk_initialize(0) == RES_OK, "initialize");
+	CHECK(disk_ioctl(0, CTRL_SYNC, NULL) == RES_OK, "sync");
+	CHECK(medium_is(5000, 100, 0xA5), "writes of the old medium on the new one");
+	CHECK(disk_read(0, buff, 2000 + 4 * cnt, cnt) == RES_OK, "read");
+	CHECK(buff[0] == 0xA5 && buff[cnt * SS - 1] == 0xA5,
+	      "read-ahead of the old medium served");
+
+	/* Removed: the drive reports no disk, the queue goes with it */
+	for (sector = 5000; sector < 5100; sector++)
+		CHECK(model_write(sector, 1, 7) == RES_OK, "write %lu", sector);
+	usbh_sim_destroy();
+	CHECK(disk_status(0) == STA_NODISK, "status without the drive");
+	swap_medium(0x5A);
+	CHECK(disk_initialize(0) == RES_OK, "initialize");
+	CHECK(disk_ioctl(0, CTRL_SYNC, NULL) == RES_OK, "sync");
+	CHECK(usbh_sim_stats()->async_write_secs == 0 && medium_is(5000, 100, 0x5A),
+	      "writes of the removed medium on the new one");
+
+	/* The model follows the medium for the tests after this one */
+	setup(3);
+}
+
+/* Random reads, writes and syncs against the model */
+static void test_random(void)
+{
+	BYTE buff[16 * SS];
+	DWORD stream = 100, sector;
+	UINT count;
+	unsigned int i, r;
+
+	setup(4);
+	srand(28);
+	for (i = 0; i < 20000; i++) {
+		r = (unsigned int)rand() % 100;
+		count = 1 + (unsigned int)rand() % 16;
+		if (r < 60) {
+			/* Mostly the stream, which wraps */
+			if (stream + count > DISK_SECTORS)
+				stream = 100;
+			sector = stream;
+			stream += count;
+		} else {
+			sector = (unsigned int)rand() % (DISK_SECTORS - count);
+		}
+
+		if (r < 80) {
+			CHECK(disk_read(0, buff, sector, count) == RES_OK, "read %lu", sector);
+			CHECK(same_as_model(buff, sector, count), "step %u: data of %u sectors at %lu", i, count, sector);
+		} else if (r < 98) {
+			CHECK(model_write(sector, count, i) == RES_OK, "write %lu", sector);
+		} else {
+			CHECK(disk_ioctl(0, CTRL_SYNC, NULL) == RES_OK, "sync");
+		}
+		if (r & 1)
+			disk_io_poll();
+	}
+	CHECK(disk_ioctl(0, CTRL_SYNC, NULL) == RES_OK, "sync");
+	for (sector = 0; sector < DISK_SECTORS; sector++)
+		CHECK(memcmp(usbh_sim_sector(sector), s_model[sector], SS) == 0, "medium sector %lu", sector);
+	CHECK(usbh_sim_stats()->bad_params == 0, "commands outside the disk");
+}
+
+int main(void)
+{
+	static const unsigned int latency[] = { 0, 1, 8, 64 };
+	unsigned int i;
+
+	printf("stream\n");
+	for (i = 0; i < sizeof(latency) / sizeof(latency[0]); i++)
+		test_stream(latency[i]);
+	printf("single sectors\n");
+	test_single_sectors();
+	printf("disk end\n");
+	test_disk_end();
+	printf("coherence\n");
+	test_coherence();
+	printf("write-behind\n");
+	test_write_behind();
+	printf("write error\n");
+	test_write_error();
+	printf("media change\n");
+	test_media_change();
+	printf("random\n");
+	test_random();
+
+	usbh_sim_destroy();
+	printf("%s\n", s_fail ? "FAIL" : "PASS");
+	return s_fail != 0;
+}
@@ -0,0 +1,200 @@
+/**************************************************************************//**
+ * @file     pdma_sim.c
+ *
+ * @brief    Simulated PDMA channel in scatter-gather mode feeding the I2S TX
+ *           FIFO, for the host build of audio_pipe.c.
+ *
+ * One channel of PDMA2. As the PDMA does, the channel copies a descriptor
+ * when it loads it, so later changes to the table only affect descriptors
+ * loaded later, and it loads the next descriptor as soon as one is done,
+ * before the transfer done interrupt is taken. The interrupt is taken a
+ * given number of words later, between words: a handler running late sees
+ * the next period already playing. A descriptor done while its predecessor's
+ * interrupt is still pending is counted, the hardware would merge the two.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "pdma_sim.h"
+
+/* As DMA_DESC_T of the sample */
+struct pdma_sim_desc {
+	uint32_t ctl;
+	uint32_t src;
+	uint32_t dest;
+	uint32_t offset;
+};
+
+I2S_T sim_i2s0;
+PDMA_T sim_pdma2;
+
+static uint32_t s_ch;
+static int s_active;
+static struct pdma_sim_desc s_desc;	/* the descriptor loaded */
+static uint32_t s_pos, s_count;
+static int s_int_en, s_irq_en;
+static int s_pending;
+static unsigned int s_irq_left, s_irq_delay;
+static void (*s_handler)(void);
+static void (*s_sink)(uint32_t word);
+static struct pdma_sim_stats s_stats;
+
+void pdma_sim_reset(void)
+{
+	s_active = 0;
+	s_int_en = 0;
+	s_irq_en = 0;
+	s_pending = 0;
+	sim_pdma2.ch_en = 0;
+	memset(&s_stats, 0, sizeof(s_stats));
+}
+
+void pdma_sim_set_handler(void (*handler)(void))
+{
+	s_handler = handler;
+}
+
+void pdma_sim_set_sink(void (*sink)(uint32_t word))
+{
+	s_sink = sink;
+}
+
+void pdma_sim_set_irq_delay(unsigned int words)
+{
+	s_irq_delay = words;
+}
+
+struct pdma_sim_stats *pdma_sim_stats(void)
+{
+	return &s_stats;
+}
+
+static void load_desc(uint32_t addr)
+{
+	memcpy(&s_desc, (void *)(uintptr_t)addr, sizeof(s_desc));
+	s_stats.descs++;
+	s_pos = 0;
+	s_count = ((s_desc.ctl & PDMA_DSCT_CTL_TXCNT_Msk) >> PDMA_DSCT_CTL_TXCNT_Pos) + 1;
+
+	if ((s_desc.ctl & PDMA_DSCT_CTL_OPMODE_Msk) != PDMA_OP_SCATTER ||
+	    (s_desc.ctl & PDMA_DSCT_CTL_TXWIDTH_Msk) != PDMA_WIDTH_32 ||
+	    (s_desc.ctl & PDMA_DSCT_CTL_DAINC_Msk) != PDMA_DAR_FIX ||
+	    s_desc.dest != ptr_to_u32(&sim_i2s0.TXFIFO) || !s_desc.src || !s_desc.offset) {
+		printf("  pdma_sim: bad descriptor at 0x%08x: ctl 0x%08x src 0x%08x dest 0x%08x next 0x%08x\n",
+		       addr, s_desc.ctl, s_desc.src, s_desc.dest, s_desc.offset);
+		s_stats.bad_descs++;
+		s_active = 0;
+	}
+}
+
+static void move_word(void)
+{
+	const uint32_t *src = (const uint32_t *)(uintptr_t)s_desc.src;
+	uint32_t word;
+
+	if ((s_desc.ctl & PDMA_DSCT_CTL_SAINC_Msk) == PDMA_SAR_FIX)
+		word = src[0];
+	else
+		word = src[s_pos];
+	sim_i2s0.TXFIFO = word;
+	s_stats.words++;
+	if (s_sink)
+		s_sink(word);
+
+	if (++s_pos < s_count)
+		return;
+
+	/* Done: the next descriptor is loaded first, then the interrupt is raised */
+	load_desc(s_desc.offset);
+	if (s_pending)
+		s_stats.lost_irqs++;
+	s_pending = 1;
+	s_irq_left = s_irq_delay;
+}
+
+static void take_irq(void)
+{
+	if (!s_pending || !s_int_en || !s_irq_en)
+		return;
+	if (s_irq_left) {
+		s_irq_left--;
+		return;
+	}
+	s_pending = 0;
+	s_stats.irqs++;
+	if (s_handler)
+		s_handler();
+}
+
+unsigned int pdma_sim_run(unsigned int words)
+{
+	unsigned int n;
+
+	for (n = 0; n < words && s_active; n++) {
+		move_word();
+		take_irq();
+	}
+	return n;
+}
+
+/* The driver calls of audio_pipe.c */
+
+void PDMA_Open(PDMA_T *pdma, uint32_t u32Mask)
+{
+	pdma->ch_en |= u32Mask;
+}
+
+void PDMA_Close(PDMA_T *pdma)
+{
+	pdma->ch_en = 0;
+	s_active = 0;
+	s_pending = 0;
+}
+
+void PDMA_SetTransferMode(PDMA_T *pdma, uint32_t u32Ch, uint32_t u32Peripheral,
+			  uint32_t u32ScatterEn, uint32_t u32DescAddr)
+{
+	if (pdma != PDMA2 || !(pdma->ch_en & (1u << u32Ch)) || u32Peripheral != PDMA_I2S0_TX || !u32ScatterEn) {
+		printf("  pdma_sim: channel %u not set up for scatter-gather to I2S0\n", u32Ch);
+		s_stats.bad_descs++;
+		return;
+	}
+	s_ch = u32Ch;
+	s_active = 1;
+	s_pending = 0;
+	load_desc(u32DescAddr);
+}
+
+void PDMA_EnableInt(PDMA_T *pdma, uint32_t u32Ch, uint32_t u32Mask)
+{
+	(void)pdma;
+	if (u32Ch == s_ch && u32Mask == 0)
+		s_int_en = 1;
+}
+
+void PDMA_DisableInt(PDMA_T *pdma, uint32_t u32Ch, uint32_t u32Mask)
+{
+	(void)pdma;
+	if (u32Ch == s_ch && u32Mask == 0)
+		s_int_en = 0;
+}
+
+int32_t IRQ_Enable(IRQn_ID_t irqn)
+{
+	if (irqn != PDMA2_IRQn)
+		return -1;
+	s_irq_en = 1;
+	return 0;
+}
+
+int32_t IRQ_Disable(IRQn_ID_t irqn)
+{
+	if (irqn != PDMA2_IRQn)
+		return -1;
+	s_irq_en = 0;
+	return 0;
+}
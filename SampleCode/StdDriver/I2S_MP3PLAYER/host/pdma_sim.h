@@ -0,0 +1,38 @@
+/**************************************************************************//**
+ * @file     pdma_sim.h
+ *
+ * @brief    Simulated PDMA channel in scatter-gather mode feeding the I2S TX
+ *           FIFO, for the host build of audio_pipe.c.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __PDMA_SIM_H__
+#define __PDMA_SIM_H__
+
+#include <stdint.h>
+
+struct pdma_sim_stats {
+	unsigned long words;		/* words written to the TX FIFO */
+	unsigned long descs;		/* descriptors loaded */
+	unsigned long irqs;		/* transfer done interrupts taken */
+	unsigned long lost_irqs;	/* descriptors done while the last interrupt was pending */
+	unsigned long bad_descs;	/* not a 32-bit copy into the TX FIFO, the channel stops */
+};
+
+/* Channel closed, interrupts off, statistics cleared */
+void pdma_sim_reset(void);
+
+/* The transfer done interrupt handler */
+void pdma_sim_set_handler(void (*handler)(void));
+/* Called with every word written to the TX FIFO */
+void pdma_sim_set_sink(void (*sink)(uint32_t word));
+/* Words moved after a descriptor is done before its interrupt is taken */
+void pdma_sim_set_irq_delay(unsigned int words);
+
+/* Move up to the given number of words, returns how many were moved */
+unsigned int pdma_sim_run(unsigned int words);
+
+struct pdma_sim_stats *pdma_sim_stats(void);
+
+#endif /* __PDMA_SIM_H__ */
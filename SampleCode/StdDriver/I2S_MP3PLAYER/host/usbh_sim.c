@@ -0,0 +1,241 @@
+/**************************************************************************//**
+ * @file     usbh_sim.c
+ *
+ * @brief    Simulated USB mass storage drive behind the usbh_umas_* API,
+ *           for the host build of diskio.c.
+ *
+ * One drive, one asynchronous command at a time as in msc_xfer.c. An
+ * asynchronous command moves its data at the poll that completes it, so
+ * a caller touching the buffer of a command in flight is caught by the
+ * content checks. Synchronous commands first finish the asynchronous
+ * one, as the driver does.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "usbh_lib.h"
+#include "usbh_sim.h"
+
+#define OP_NONE		0
+#define OP_READ		1
+#define OP_WRITE	2
+
+static uint8_t *s_media;
+static uint32_t s_sectors;
+static unsigned int s_latency = 3;
+static int s_fail_write;
+static struct usbh_sim_stats s_stats;
+
+static struct {
+	int op;
+	uint32_t sector;
+	int count;
+	uint8_t *buff;
+	unsigned int left;		/* polls until completion */
+	int fail;
+} s_async;
+
+uint8_t sim_pattern(uint32_t s, unsigned int i)
+{
+	return (uint8_t)(s * 37 + (s >> 8) + i * 11);
+}
+
+int usbh_sim_create(uint32_t sectors)
+{
+	uint32_t s;
+	unsigned int i;
+
+	s_media = malloc((size_t)sectors * SIM_SECTOR_SIZE);
+	if (!s_media)
+		return -1;
+	for (s = 0; s < sectors; s++)
+		for (i = 0; i < SIM_SECTOR_SIZE; i++)
+			s_media[(size_t)s * SIM_SECTOR_SIZE + i] = sim_pattern(s, i);
+	s_sectors = sectors;
+	memset(&s_stats, 0, sizeof(s_stats));
+	memset(&s_async, 0, sizeof(s_async));
+	return 0;
+}
+
+void usbh_sim_destroy(void)
+{
+	free(s_media);
+	s_media = NULL;
+}
+
+void usbh_sim_set_latency(unsigned int polls)
+{
+	s_latency = polls;
+}
+
+void usbh_sim_fail_next_write(void)
+{
+	s_fail_write = 1;
+}
+
+uint8_t *usbh_sim_sector(uint32_t s)
+{
+	return s_media + (size_t)s * SIM_SECTOR_SIZE;
+}
+
+struct usbh_sim_stats *usbh_sim_stats(void)
+{
+	return &s_stats;
+}
+
+static int range_ok(uint32_t sec_no, int sec_cnt)
+{
+	if (sec_cnt > 0 && sec_no < s_sectors && (uint32_t)sec_cnt <= s_sectors - sec_no)
+		return 1;
+	s_stats.bad_params++;
+	return 0;
+}
+
+static void async_finish(void)
+{
+	size_t len = (size_t)s_async.count * SIM_SECTOR_SIZE;
+
+	if (s_async.op == OP_READ)
+		memcpy(s_async.buff, usbh_sim_sector(s_async.sector), len);
+	else if (!s_async.fail)
+		memcpy(usbh_sim_sector(s_async.sector), s_async.buff, len);
+	s_async.op = OP_NONE;
+}
+
+int usbh_pooling_hubs(void)
+{
+	return 0;
+}
+
+int usbh_umas_disk_status(int drv_no)
+{
+	return (drv_no == 0 && s_media) ? UMAS_OK : UMAS_ERR_NO_DEVICE;
+}
+
+int usbh_umas_read(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+	if (!s_media)
+		return UMAS_ERR_NO_DEVICE;
+	if (drv_no != 0 || !range_ok(sec_no, sec_cnt))
+		return UMAS_ERR_IVALID_PARM;
+	while (usbh_umas_async_poll(drv_no) == UMAS_ERR_BUSY)
+		;
+	memcpy(buff, usbh_sim_sector(sec_no), (size_t)sec_cnt * SIM_SECTOR_SIZE);
+	s_stats.sync_read_cmds++;
+	s_stats.sync_read_secs += sec_cnt;
+	return UMAS_OK;
+}
+
+int usbh_umas_write(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+	if (!s_media)
+		return UMAS_ERR_NO_DEVICE;
+	if (drv_no != 0 || !range_ok(sec_no, sec_cnt))
+		return UMAS_ERR_IVALID_PARM;
+	while (usbh_umas_async_poll(drv_no) == UMAS_ERR_BUSY)
+		;
+	memcpy(usbh_sim_sector(sec_no), buff, (size_t)sec_cnt * SIM_SECTOR_SIZE);
+	s_stats.sync_write_secs += sec_cnt;
+	return UMAS_OK;
+}
+
+int usbh_umas_ioctl(int drv_no, int cmd, void *buff)
+{
+	if (drv_no != 0 || !s_media)
+		return UMAS_ERR_NO_DEVICE;
+
+	switch (cmd) {
+	case CTRL_SYNC:
+		return UMAS_OK;
+	case GET_SECTOR_COUNT:
+		*(DWORD *)buff = s_sectors;
+		return UMAS_OK;
+	case GET_SECTOR_SIZE:
+		*(WORD *)buff = SIM_SECTOR_SIZE;
+		return UMAS_OK;
+	case GET_BLOCK_SIZE:
+		*(DWORD *)buff = 1;
+		return UMAS_OK;
+	default:
+		return UMAS_ERR_IVALID_PARM;
+	}
+}
+
+int usbh_umas_reset_disk(int drv_no)
+{
+	return (drv_no == 0 && s_media) ? UMAS_OK : UMAS_ERR_NO_DEVICE;
+}
+
+static int async_start(int op, int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+	if (!s_media)
+		return UMAS_ERR_NO_DEVICE;
+	if (drv_no != 0 || !range_ok(sec_no, sec_cnt))
+		return UMAS_ERR_IVALID_PARM;
+	if (s_async.op != OP_NONE) {
+		fprintf(stderr, "usbh_sim: asynchronous command issued while one is in flight\n");
+		exit(1);
+	}
+	s_async.op = op;
+	s_async.sector = sec_no;
+	s_async.count = sec_cnt;
+	s_async.buff = buff;
+	s_async.left = s_latency;
+	s_async.fail = 0;
+	return UMAS_OK;
+}
+
+int usbh_umas_read_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+	int ret = async_start(OP_READ, drv_no, sec_no, sec_cnt, buff);
+
+	if (ret == UMAS_OK) {
+		s_stats.async_read_cmds++;
+		s_stats.async_read_secs += sec_cnt;
+		if ((unsigned long)sec_cnt > s_stats.max_async_read)
+			s_stats.max_async_read = sec_cnt;
+	}
+	return ret;
+}
+
+int usbh_umas_write_async(int drv_no, uint32_t sec_no, int sec_cnt, uint8_t *buff)
+{
+	int ret = async_start(OP_WRITE, drv_no, sec_no, sec_cnt, buff);
+
+	if (ret == UMAS_OK) {
+		s_async.fail = s_fail_write;
+		s_fail_write = 0;
+		s_stats.async_write_secs += sec_cnt;
+	}
+	return ret;
+}
+
+int usbh_umas_async_poll(int drv_no)
+{
+	int fail;
+
+	if (drv_no != 0)
+		return UMAS_ERR_IVALID_PARM;
+	if (s_async.op == OP_NONE)
+		return UMAS_OK;
+	if (!s_media) {
+		/* Unplugged, the command died with the drive */
+		s_async.op = OP_NONE;
+		return UMAS_ERR_NO_DEVICE;
+	}
+
+	s_stats.polls++;
+	if (s_async.left) {
+		s_async.left--;
+		return UMAS_ERR_BUSY;
+	}
+	fail = s_async.fail;
+	async_finish();
+	return fail ? UMAS_ERR_IO : UMAS_OK;
+}
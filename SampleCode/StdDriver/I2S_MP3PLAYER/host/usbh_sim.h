@@ -0,0 +1,46 @@
+/**************************************************************************//**
+ * @file     usbh_sim.h
+ *
+ * @brief    Simulated USB mass storage drive behind the usbh_umas_* API,
+ *           for the host build of diskio.c.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __USBH_SIM_H__
+#define __USBH_SIM_H__
+
+#include <stdint.h>
+
+#define SIM_SECTOR_SIZE		512
+
+struct usbh_sim_stats {
+	unsigned long sync_read_cmds;
+	unsigned long sync_read_secs;
+	unsigned long sync_write_secs;
+	unsigned long async_read_cmds;
+	unsigned long async_read_secs;
+	unsigned long async_write_secs;
+	unsigned long polls;
+	unsigned long max_async_read;	/* largest asynchronous READ_10, sectors */
+	unsigned long bad_params;	/* commands outside the medium */
+};
+
+/* Drive 0 of the given size, every sector filled with sim_pattern() */
+int usbh_sim_create(uint32_t sectors);
+/* Unplug drive 0: a command in flight and every command after fail, no device */
+void usbh_sim_destroy(void);
+
+/* Polls an asynchronous command stays busy */
+void usbh_sim_set_latency(unsigned int polls);
+/* Make the next asynchronous WRITE_10 fail */
+void usbh_sim_fail_next_write(void);
+
+/* Byte i of sector s as created */
+uint8_t sim_pattern(uint32_t s, unsigned int i);
+/* The medium, bypassing the cache under test */
+uint8_t *usbh_sim_sector(uint32_t s);
+
+struct usbh_sim_stats *usbh_sim_stats(void);
+
+#endif /* __USBH_SIM_H__ */
@@ -11,9 +11,7 @@
 #include "NuMicro.h"
 
 #include "config.h"
-
-extern volatile uint8_t aPCMBuffer_Full[2];
-volatile uint8_t u8PCMBuffer_Playing = 0;
+#include "audio_pipe.h"
 
 void PDMA2_IRQHandler(void)
 {
@@ -21,14 +19,12 @@ void PDMA2_IRQHandler(void)
 
     if(u32Status & 0x2)    /* done */
     {
-        if(PDMA_GET_TD_STS(PDMA2) & 0x4)
+        if(PDMA_GET_TD_STS(PDMA2) & (1 << AUDIO_PIPE_PDMA_CH))
         {
-            if(aPCMBuffer_Full[u8PCMBuffer_Playing ^ 1] != 1)
-                sysprintf("underflow!!\n");
-            aPCMBuffer_Full[u8PCMBuffer_Playing] = 0;       /* Set empty flag */
-            u8PCMBuffer_Playing ^= 1;
+            /* A period was played, underruns are counted by the pipeline */
+            audio_pipe_period_done();
         }
-        PDMA_CLR_TD_FLAG(PDMA2, PDMA_TDSTS_TDIF2_Msk);
+        PDMA_CLR_TD_FLAG(PDMA2, 1 << AUDIO_PIPE_PDMA_CH);
     }
     else if(u32Status & 0x400)     /* Timeout */
     {
@@ -19,10 +19,7 @@ void delay_ms(int msec);
 
 #define MAX_FILE_SIZE   0x800000
 
-DMA_DESC_T PDMA_TXDESC[2];
-
 uint8_t bAudioPlaying = 0;
-extern signed int aPCMBuffer[2][PCM_BUFFER_SIZE];
 
 FILINFO MyFinfo;
 
@@ -233,31 +230,6 @@ static int is_mp3_file(char *fname)
     return 0;
 }
 
-/* Configure PDMA to Scatter Gather mode */
-void PDMA_Init(void)
-{
-    DMA_DESC_T *DMA_TXDESC = nc_ptr(PDMA_TXDESC);
-
-    /* Tx description */
-    DMA_TXDESC[0].ctl = ((PCM_BUFFER_SIZE-1)<<PDMA_DSCT_CTL_TXCNT_Pos)|PDMA_WIDTH_32|PDMA_SAR_INC|PDMA_DAR_FIX|PDMA_REQ_SINGLE|PDMA_OP_SCATTER;
-    DMA_TXDESC[0].src = ptr_to_u32(&aPCMBuffer[0][0]);
-    DMA_TXDESC[0].dest = ptr_to_u32(&I2S0->TXFIFO);
-    DMA_TXDESC[0].offset = ptr_to_u32(&DMA_TXDESC[1]);
-
-    DMA_TXDESC[1].ctl = ((PCM_BUFFER_SIZE-1)<<PDMA_DSCT_CTL_TXCNT_Pos)|PDMA_WIDTH_32|PDMA_SAR_INC|PDMA_DAR_FIX|PDMA_REQ_SINGLE|PDMA_OP_SCATTER;
-    DMA_TXDESC[1].src = ptr_to_u32(&aPCMBuffer[1][0]);
-    DMA_TXDESC[1].dest = ptr_to_u32(&I2S0->TXFIFO);
-    DMA_TXDESC[1].offset = ptr_to_u32(&DMA_TXDESC[0]);   //link to first description
-
-    PDMA_Open(PDMA2, 1 << 2);
-    PDMA_SetTransferMode(PDMA2, 2, PDMA_I2S0_TX, 1, ptr_to_u32(&DMA_TXDESC[0]));
-
-    PDMA_EnableInt(PDMA2, 2, 0);
-
-    IRQ_SetHandler((IRQn_ID_t)PDMA2_IRQn, PDMA2_IRQHandler);
-    IRQ_Enable ((IRQn_ID_t)PDMA2_IRQn);
-}
-
 /* Init I2C interface */
 void I2C2_Init(void)
 {
@@ -298,6 +270,9 @@ int32_t main(void)
     /* Init I2C2 to access NAU8822 */
     I2C2_Init();
 
+    /* PDMA2 plays the PCM periods of audio_pipe.c */
+    IRQ_SetHandler((IRQn_ID_t)PDMA2_IRQn, PDMA2_IRQHandler);
+
     start_timer();
 
     if (USB_PHY_Init() != 0)
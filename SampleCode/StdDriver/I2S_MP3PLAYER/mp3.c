@@ -25,6 +25,8 @@
 #include "NuMicro.h"
 
 #include "config.h"
+#include "audio_pipe.h"
+#include "audio_dsp.h"
 #include "diskio.h"
 #include "ff.h"
 #include "mad.h"
@@ -48,16 +50,14 @@ struct mad_synth    Synth;
 
 FIL             mp3FileObject;
 FILINFO         Finfo;
-size_t          ReadSize;
-size_t          Remaining;
 size_t          ReturnSize;
 
-// I2S PCM buffer x2
-signed int aPCMBuffer[2][PCM_BUFFER_SIZE];
-// File IO buffer for MP3 library
-unsigned char MadInputBuffer[FILE_IO_BUFFER_SIZE + MAD_BUFFER_GUARD];
-// buffer full flag x2
-volatile uint8_t aPCMBuffer_Full[2] = {0, 0};
+// Decoder input, cacheable. The file is read through a non-cacheable staging
+// buffer because the USB disk may DMA straight into the f_read() buffer.
+static unsigned char MadInputBuffer[MP3_INPUT_SIZE + MAD_BUFFER_GUARD] __attribute__((aligned(64)));
+static unsigned char MadReadBuffer[FILE_IO_BUFFER_SIZE] __attribute__((aligned(64)));
+static uint32_t s_u32InputEnd;          // bytes of MadInputBuffer holding file data
+static int s_bInputEof;                 // the file is read up to its end, or failed
 // audio information structure
 struct AudioInfoObject audioInfo;
 
@@ -76,10 +76,10 @@ void MP3_ParseHeaderInfo(uint8_t *pFileName)
 
         while(1)
         {
-            res = f_read(&mp3FileObject, nc_ptr(&MadInputBuffer[0]), (UINT)FILE_IO_BUFFER_SIZE, (UINT*)&ReturnSize);
+            res = f_read(&mp3FileObject, nc_ptr(&MadReadBuffer[0]), (UINT)FILE_IO_BUFFER_SIZE, (UINT*)&ReturnSize);
 
             //parsing MP3 header
-            mp3CountV1L3Headers((unsigned char *)nc_ptr(&MadInputBuffer[0]), ReturnSize);
+            mp3CountV1L3Headers((unsigned char *)nc_ptr(&MadReadBuffer[0]), ReturnSize);
             if(audioInfo.mp3SampleRate != 0)
                 // Got the header and sampling rate
                 break;
@@ -110,11 +110,58 @@ void MP3_ParseHeaderInfo(uint8_t *pFileName)
     sysprintf("=====================\r\n");
 }
 
+// Append one file read to the decoder input and hand libmad what is left of
+// the stream. Returns 0 when the input is full or the file is over.
+static int MP3_FillInput(void)
+{
+    uint32_t u32Next = 0;
+
+    if(s_bInputEof)
+        return 0;
+
+    if(Stream.buffer != NULL)
+        u32Next = Stream.next_frame - MadInputBuffer;
+
+    // Move the unconsumed bytes to the front only when the tail is too short
+    if(MP3_INPUT_SIZE - s_u32InputEnd < FILE_IO_BUFFER_SIZE)
+    {
+        if(u32Next == 0)
+            return 0;
+        memmove(MadInputBuffer, MadInputBuffer + u32Next, s_u32InputEnd - u32Next);
+        s_u32InputEnd -= u32Next;
+        u32Next = 0;
+        if(MP3_INPUT_SIZE - s_u32InputEnd < FILE_IO_BUFFER_SIZE)
+            return 0;
+    }
+
+    if(f_read(&mp3FileObject, nc_ptr(MadReadBuffer), (UINT)FILE_IO_BUFFER_SIZE, (UINT*)&ReturnSize) != FR_OK)
+    {
+        sysprintf("Read error!!\n");
+        ReturnSize = 0;
+    }
+    memcpy(MadInputBuffer + s_u32InputEnd, nc_ptr(MadReadBuffer), ReturnSize);
+    s_u32InputEnd += ReturnSize;
+
+    // if the file is over, let libmad decode the last frame
+    if(ReturnSize < FILE_IO_BUFFER_SIZE)
+    {
+        memset(MadInputBuffer + s_u32InputEnd, 0, MAD_BUFFER_GUARD);
+        s_u32InputEnd += MAD_BUFFER_GUARD;
+        s_bInputEof = 1;
+    }
+
+    /* Pipe the new buffer content to libmad's stream decoder facility. */
+    mad_stream_buffer(&Stream, MadInputBuffer + u32Next, s_u32InputEnd - u32Next);
+    Stream.error = (enum  mad_error)0;
+
+    return 1;
+}
+
 // Enable I2S TX with PDMA function
 void StartPlay(void)
 {
     sysprintf("Start playing ...\n");
-    PDMA_Init();
+    audio_pipe_start();
     I2S_ENABLE_TXDMA(I2S0);
     I2S_ENABLE_TX(I2S0);
 
@@ -125,34 +172,65 @@ void StartPlay(void)
 // Disable I2S TX with PDMA function
 void StopPlay(void)
 {
+    AUDIO_PIPE_STAT_T sStat;
+
     I2S_DISABLE_TXDMA(I2S0);
     I2S_DISABLE_TX(I2S0);
 
-    PDMA_Close(PDMA2);
+    audio_pipe_stop();
 
     // disable sound output
     audioInfo.mp3Playing = 0;
     sysprintf("Stop ...\n");
+
+    audio_pipe_get_stat(&sStat);
+    if(sStat.u32Periods)
+        sysprintf("Played %d periods, %d underruns, at least %d periods ahead\r\n",
+                  sStat.u32Periods, sStat.u32Underruns, sStat.u32MinLead);
+}
+
+// Wait for room in the PCM pipeline: start playback once the latency is
+// buffered, and meanwhile read the file ahead of the decoder
+static void MP3_WaitOutput(void)
+{
+    if(!audio_pipe_running())
+        StartPlay();
+    else if(!MP3_FillInput())
+        disk_io_poll();
+}
+
+// Write 16-bit samples to the PCM pipeline as right | left << 16 words
+static void MP3_Output(struct mad_pcm *pcm)
+{
+    const short *pLeft = pcm->samples[0];
+    const short *pRight = pcm->samples[pcm->channels - 1];
+    uint32_t *pu32Pcm;
+    uint32_t u32Len, i;
+
+    for(i = 0; i < pcm->length; i += u32Len)
+    {
+        while((pu32Pcm = audio_pipe_get(&u32Len)) == NULL)
+            MP3_WaitOutput();
+
+        if(u32Len > pcm->length - i)
+            u32Len = pcm->length - i;
+
+        audio_dsp_interleave_s16((int16_t *)pu32Pcm, pRight + i, pLeft + i, u32Len);
+
+        audio_pipe_put(u32Len);
+    }
 }
 
 // MP3 decode player
 void MP3Player(uint8_t *pFileName)
 {
     FRESULT res;
-    uint8_t *ReadStart;
-    uint8_t *GuardPtr;
-    volatile uint8_t u8PCMBufferTargetIdx = 0;
-    volatile uint32_t pcmbuf_idx, i;
-    volatile unsigned int Mp3FileOffset = 0;
-    uint16_t sampleL, sampleR;
-    signed int *aPCMBuffer_NonCache = nc_ptr(aPCMBuffer);
-
-    pcmbuf_idx = 0;
-    u8PCMBuffer_Playing = 0;
+    uint64_t u64DecodeTicks = 0, t0;
+    uint32_t u32Frames = 0, u32Fps, u32Stalls = 0;
+
     memset((void *)&audioInfo, 0, sizeof(audioInfo));
-    memset((void *)nc_ptr(MadInputBuffer), 0, sizeof(MadInputBuffer));
-    memset((void *)aPCMBuffer, 0, sizeof(aPCMBuffer));
-    memset((void *)aPCMBuffer_Full, 0, sizeof(aPCMBuffer_Full));
+    s_u32InputEnd = 0;
+    s_bInputEof = 0;
 
     /* Parse MP3 header */
     MP3_ParseHeaderInfo((uint8_t *)pFileName);
@@ -208,58 +286,26 @@ void MP3Player(uint8_t *pFileName)
     NAU88L25_ConfigSampleRate(audioInfo.mp3SampleRate);
 #endif
 
+    /* Decoding runs ahead of playback by up to AUDIO_PIPE_LATENCY_MS */
+    audio_pipe_init(audioInfo.mp3SampleRate, AUDIO_PIPE_LATENCY_MS);
+
     while(1)
     {
         if(Stream.buffer == NULL || Stream.error == MAD_ERROR_BUFLEN)
         {
-            if(Stream.next_frame != NULL)
-            {
-                /* Get the remaining frame */
-                Remaining = Stream.bufend - Stream.next_frame;
-                memmove(nc_ptr(MadInputBuffer), Stream.next_frame, Remaining);
-                ReadStart = nc_ptr(MadInputBuffer) + Remaining;
-                ReadSize = FILE_IO_BUFFER_SIZE - Remaining;
-            }
-            else
-            {
-                ReadSize = FILE_IO_BUFFER_SIZE,
-                ReadStart = nc_ptr(MadInputBuffer),
-                Remaining = 0;
-            }
+            /* The input is normally topped up while waiting for the pipeline */
+            if(Stream.buffer != NULL && !s_bInputEof)
+                u32Stalls++;
 
-            /* read the file */
-            res = f_read(&mp3FileObject, nc_ptr(ReadStart), (UINT)ReadSize, (UINT*)&ReturnSize);
-            if(res != FR_OK)
-            {
-                sysprintf("Stop !(%x)\n\r", res);
+            if(!MP3_FillInput())
                 goto stop;
-            }
-
-            if(f_eof(&mp3FileObject))
-            {
-                if(ReturnSize == 0)
-                    goto stop;
-            }
-
-            /* if the file is over */
-            if(ReadSize > ReturnSize)
-            {
-                GuardPtr = nc_ptr(ReadStart) + ReturnSize;
-                memset(GuardPtr, 0, MAD_BUFFER_GUARD);
-                ReturnSize += MAD_BUFFER_GUARD;
-            }
-
-            Mp3FileOffset = Mp3FileOffset + ReturnSize;
-            /* Pipe the new buffer content to libmad's stream decoder
-                     * facility.
-            */
-            mad_stream_buffer(&Stream, nc_ptr(MadInputBuffer), ReturnSize + Remaining);
-            Stream.error = (enum  mad_error)0;
         }
 
         /* decode a frame from the mp3 stream data */
+        t0 = EL0_GetCurrentPhysicalValue();
         if(mad_frame_decode(&Frame, &Stream))
         {
+            u64DecodeTicks += EL0_GetCurrentPhysicalValue() - t0;
             if(MAD_RECOVERABLE(Stream.error))
             {
                 /*if(Stream.error!=MAD_ERROR_LOSTSYNC ||
@@ -290,56 +336,33 @@ void MP3Player(uint8_t *pFileName)
         * are reported by mad_synth_frame();
         */
         mad_synth_frame(&Synth, &Frame);
+        u64DecodeTicks += EL0_GetCurrentPhysicalValue() - t0;
+        u32Frames++;
 
-        //
-        // decode finished, try to copy pcm data to audio buffer
-        //
-
-        if(audioInfo.mp3Playing)
-        {
-            //if next buffer is still full (playing), wait until it's empty
-            if(aPCMBuffer_Full[u8PCMBufferTargetIdx] == 1)
-                while(aPCMBuffer_Full[u8PCMBufferTargetIdx]);
-        }
-        else
-        {
-
-            if((aPCMBuffer_Full[0] == 1) && (aPCMBuffer_Full[1] == 1))          //all buffers are full, wait
-            {
-                StartPlay();
-            }
-        }
-
-        for(i = 0; i < (int)Synth.pcm.length; i++)
-        {
-            /* Get the left/right samples */
-            sampleL = Synth.pcm.samples[0][i];
-            sampleR = Synth.pcm.samples[1][i];
-
-            /* Fill PCM data to I2S(PDMA) buffer */
-            //aPCMBuffer[u8PCMBufferTargetIdx][pcmbuf_idx++] = sampleR | (sampleL << 16);
-            *(aPCMBuffer_NonCache + (u8PCMBufferTargetIdx*PCM_BUFFER_SIZE) + pcmbuf_idx++) = sampleR | (sampleL << 16);
-
-
-            /* Need change buffer ? */
-            if(pcmbuf_idx == PCM_BUFFER_SIZE)
-            {
-                aPCMBuffer_Full[u8PCMBufferTargetIdx] = 1;      //set full flag
-                u8PCMBufferTargetIdx ^= 1;
-
-                pcmbuf_idx = 0;
-                //sysprintf("change to ==>%d ..\n", u8PCMBufferTargetIdx);
-                /* if next buffer is still full (playing), wait until it's empty */
-                if((aPCMBuffer_Full[u8PCMBufferTargetIdx] == 1) && (audioInfo.mp3Playing))
-                    while(aPCMBuffer_Full[u8PCMBufferTargetIdx]);
-            }
-        }
+        /* straight into the cacheable PDMA periods */
+        MP3_Output(&Synth.pcm);
     }
 
 stop:
 
     sysprintf("Exit MP3\r\n");
 
+    /* Play out what is decoded */
+    audio_pipe_drain();
+    if(audio_pipe_pending() && !audio_pipe_running())
+        StartPlay();
+    while(audio_pipe_pending())
+        disk_io_poll();
+
+    /* Decoder speed, decode and synthesis only (12 MHz timer) */
+    if(u64DecodeTicks && Synth.pcm.samplerate)
+    {
+        u32Fps = (uint32_t)((uint64_t)u32Frames * 12000000 / u64DecodeTicks);
+        sysprintf("Decoded %d frames in %d ms, %d frames/s, %d x real time\r\n", u32Frames,
+                  (uint32_t)(u64DecodeTicks / 12000), u32Fps, u32Fps * Synth.pcm.length / Synth.pcm.samplerate);
+    }
+    sysprintf("Input stalls %d\r\n", u32Stalls);
+
     mad_synth_finish(&Synth);
     mad_frame_finish(&Frame);
     mad_stream_finish(&Stream);
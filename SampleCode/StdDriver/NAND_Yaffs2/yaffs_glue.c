@@ -260,6 +260,7 @@ int cmd_yaffs_devconfig(char *_mp, int flash_dev,
     dev->drv.drv_erase_fn = nandmtd_EraseBlockInNAND;
     dev->drv.drv_initialise_fn = nandmtd_InitialiseNAND;
     dev->tagger.mark_bad_fn = nandmtd2_MarkNANDBlockBad;
+    dev->drv.drv_mark_bad_fn = nandmtd2_MarkNANDBlockBad;	/* checkpoint erase */
     dev->tagger.query_block_fn = nandmtd2_QueryNANDBlock;
 
 	yaffs_add_device(dev);
@@ -0,0 +1,289 @@
+/**************************************************************************//**
+ * @file     h264_pipe.c
+ *
+ * @brief    H264 playback pipeline: bit stream ring and display buffer queue.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#include <string.h>
+
+#include "NuMicro.h"
+#include "displib.h"
+#include "bitstream.h"
+#include "h264_pipe.h"
+
+#define RING_SIZE       (H264_STREAM_SEGS * H264_STREAM_SEG_SIZE)
+#define PREFIX_SIZE     H264_STREAM_MIN_AHEAD
+
+#if (H264_STREAM_SEG_SIZE % H264_STREAM_IO_SIZE) != 0
+#error "H264_STREAM_SEG_SIZE must be a multiple of H264_STREAM_IO_SIZE"
+#endif
+
+#if (RING_SIZE < 2 * H264_STREAM_MIN_AHEAD) || (H264_STREAM_SEGS < 2)
+#error "The bit stream ring must hold at least two segments and twice H264_STREAM_MIN_AHEAD"
+#endif
+
+#if (H264_DISP_BUFS < 2)
+#error "H264_DISP_BUFS must be at least 2"
+#endif
+
+/*
+ * The ring is preceded by room for the bytes the decoder has left at the end
+ * of the ring when it wraps. Stream offset o lives at PREFIX_SIZE + o % RING_SIZE,
+ * the decoder's offset at PREFIX_SIZE + (o - s_u32RunStart), which reaches into
+ * the prefix after a wrap.
+ */
+static uint8_t _StreamRing[PREFIX_SIZE + RING_SIZE] __attribute__((aligned(64)));
+
+static FIL      *s_pFile;
+static FRESULT  s_eErr;
+static int      s_bEof;             /* the file is read to its end */
+static uint32_t s_u32Wr;            /* stream bytes read from the file */
+static uint32_t s_u32Commit;        /* stream bytes of whole NAL units */
+static uint32_t s_u32Zeros;         /* zero bytes at s_u32Wr, the start of a start code */
+static uint32_t s_u32Rd;            /* stream bytes decoded */
+static uint32_t s_u32RunStart;      /* stream offset at the start of the ring for the decoder */
+static uint32_t s_u32SegFree;       /* segments the decoder is done with */
+static int      s_bWaiting;         /* the decoder is waiting for the file */
+
+/*
+ * Display buffers. Free running frame counters, each written by one side
+ * only: s_u32Queued by the decoder, the others by the vsync interrupt.
+ * Frame n is in buffer n % H264_DISP_BUFS; frame 0 is the one on screen
+ * at h264_pipe_frame_init().
+ */
+static uint32_t s_au32Frame[H264_DISP_BUFS];
+static volatile uint32_t s_u32Queued;   /* frames queued */
+static volatile uint32_t s_u32Flipped;  /* frames put on screen */
+static volatile uint32_t s_u32Retired;  /* frames off screen, their buffers are free */
+static uint32_t s_u32Latched;           /* s_u32Flipped at the previous vsync */
+static uint64_t s_u64Due;               /* timer value at which the next frame is due */
+static uint64_t s_u64Interval;          /* timer ticks per frame, 0 for no frame rate control */
+static uint32_t s_u32FlipBase;          /* s_u32Flipped at h264_pipe_frame_start() */
+static volatile int s_bEnd;             /* no more frames to come, none is missed */
+static volatile H264_PIPE_STAT_T s_sStat;
+
+static uint8_t *ring(void)
+{
+	return (uint8_t *)nc_ptr(_StreamRing);
+}
+
+/* Move s_u32Commit to the last start code in u32Len bytes read at stream offset s_u32Wr */
+static void scan_start_codes(const uint8_t *pu8Data, uint32_t u32Len)
+{
+	uint32_t i = 0, zeros = s_u32Zeros;
+
+	while ((i = bs_scan_start_code(pu8Data, i, u32Len, &zeros)) < u32Len)
+	{
+		/* the leading zero bytes go with the NAL unit that follows */
+		s_u32Commit = s_u32Wr + i - zeros;
+		i++;
+		zeros = 0;
+	}
+	s_u32Zeros = zeros;
+}
+
+/* Whether the segment at s_u32Wr still holds data the decoder has not finished */
+static int ring_full(void)
+{
+	return (s_u32Wr / H264_STREAM_SEG_SIZE) >= (s_u32SegFree + H264_STREAM_SEGS);
+}
+
+void h264_pipe_open(FIL *pFile)
+{
+	s_pFile = pFile;
+	s_eErr = FR_OK;
+	s_bEof = 0;
+	s_u32Wr = 0;
+	s_u32Commit = 0;
+	s_u32Zeros = 0;
+	s_u32Rd = 0;
+	s_u32RunStart = 0;
+	s_u32SegFree = 0;
+	s_bWaiting = 0;
+	s_sStat.u32Stalls = 0;
+	s_sStat.u32MinAhead = 0xFFFFFFFF;
+
+	/* The ring is accessed via the non-cacheable alias only. */
+	dcache_clean_invalidate_by_mva(_StreamRing, sizeof(_StreamRing));
+}
+
+uint32_t h264_pipe_fill(void)
+{
+	uint32_t u32Off, u32Len;
+	UINT     u32Read;
+	FRESULT  res;
+
+	if ((s_pFile == NULL) || s_bEof || ring_full())
+		return 0;
+
+	u32Off = s_u32Wr % RING_SIZE;
+	u32Len = H264_STREAM_IO_SIZE - (u32Off % H264_STREAM_IO_SIZE);
+
+	res = f_read(s_pFile, ring() + PREFIX_SIZE + u32Off, u32Len, &u32Read);
+	if (res != FR_OK)
+	{
+		s_eErr = res;
+		u32Read = 0;
+	}
+
+	scan_start_codes(ring() + PREFIX_SIZE + u32Off, u32Read);
+	s_u32Wr += u32Read;
+
+	if ((res != FR_OK) || (u32Read < u32Len))
+	{
+		s_bEof = 1;
+		s_u32Commit = s_u32Wr;
+	}
+	return u32Read;
+}
+
+uint8_t *h264_pipe_get(uint32_t *pu32Len)
+{
+	uint32_t u32Commit = s_u32Commit, u32End = s_u32RunStart + RING_SIZE, u32Left;
+
+	/* A NAL unit longer than the ring is handed over as far as it was read */
+	if (ring_full())
+		u32Commit = s_u32Wr;
+
+	if (!s_bEof && (u32Commit - s_u32Rd < H264_STREAM_MIN_AHEAD))
+	{
+		if (!s_bWaiting)
+			s_sStat.u32Stalls++;
+		s_bWaiting = 1;
+		return NULL;
+	}
+	s_bWaiting = 0;
+
+	/* Near the end of the ring with more data at its start: continue in front of the first segment */
+	if ((u32Commit > u32End) && (u32End - s_u32Rd < H264_STREAM_MIN_AHEAD))
+	{
+		u32Left = u32End - s_u32Rd;
+		memcpy(ring() + PREFIX_SIZE - u32Left, ring() + PREFIX_SIZE + RING_SIZE - u32Left, u32Left);
+		s_u32RunStart = u32End;
+		s_u32SegFree = u32End / H264_STREAM_SEG_SIZE;
+		u32End += RING_SIZE;
+	}
+
+	if (u32Commit > u32End)
+		u32Commit = u32End;
+	if (u32Commit == s_u32Rd)
+		return NULL;
+
+	if (!s_bEof && (u32Commit - s_u32Rd < s_sStat.u32MinAhead))
+		s_sStat.u32MinAhead = u32Commit - s_u32Rd;
+
+	*pu32Len = u32Commit - s_u32Rd;
+	return ring() + PREFIX_SIZE + (int32_t)(s_u32Rd - s_u32RunStart);
+}
+
+void h264_pipe_consume(uint32_t u32Len)
+{
+	s_u32Rd += u32Len;
+	/* past the last start code, into a NAL unit handed over from a full ring */
+	if (s_u32Commit < s_u32Rd)
+		s_u32Commit = s_u32Rd;
+	if (s_u32Rd / H264_STREAM_SEG_SIZE > s_u32SegFree)
+		s_u32SegFree = s_u32Rd / H264_STREAM_SEG_SIZE;
+}
+
+int h264_pipe_done(void)
+{
+	return s_bEof && (s_u32Rd == s_u32Wr);
+}
+
+FRESULT h264_pipe_error(void)
+{
+	return s_eErr;
+}
+
+void h264_pipe_close(void)
+{
+	s_pFile = NULL;
+}
+
+void h264_pipe_frame_init(const uint32_t au32Addr[H264_DISP_BUFS])
+{
+	uint32_t i;
+
+	for (i = 0; i < H264_DISP_BUFS; i++)
+		s_au32Frame[i] = au32Addr[i];
+
+	s_u64Interval = 0;
+	s_u32Retired = 0;
+	s_u32Latched = 1;
+	s_u32Flipped = 1;
+	s_u32Queued = 1;
+}
+
+void h264_pipe_frame_start(uint32_t u32Fps)
+{
+	IRQ_Disable((IRQn_ID_t)DISP_IRQn);
+	s_u64Due = EL0_GetCurrentPhysicalValue();
+	s_u64Interval = u32Fps ? (12000000 / u32Fps) : 0;
+	s_u32FlipBase = s_u32Flipped;
+	s_sStat.u32Repeats = 0;
+	s_bEnd = 0;
+	IRQ_Enable((IRQn_ID_t)DISP_IRQn);
+}
+
+void h264_pipe_frame_stop(void)
+{
+	s_bEnd = 1;
+}
+
+uint32_t h264_pipe_frame_get(void)
+{
+	if (s_u32Queued - s_u32Retired >= H264_DISP_BUFS)
+		return 0;
+	return s_au32Frame[s_u32Queued % H264_DISP_BUFS];
+}
+
+void h264_pipe_frame_put(void)
+{
+	s_u32Queued++;
+}
+
+uint32_t h264_pipe_frame_pending(void)
+{
+	return s_u32Queued - s_u32Flipped;
+}
+
+void h264_pipe_vsync(void)
+{
+	uint64_t u64Now = EL0_GetCurrentPhysicalValue();
+
+	/* The address written at the previous vsync has been latched, the frame before it is off screen */
+	s_u32Retired = s_u32Latched - 1;
+
+	if (s_u64Interval && (u64Now < s_u64Due))
+	{
+		s_u32Latched = s_u32Flipped;
+		return;
+	}
+
+	if (s_u32Queued != s_u32Flipped)
+	{
+		DISPLIB_SetFBAddr(s_au32Frame[s_u32Flipped % H264_DISP_BUFS]);
+		s_u32Flipped++;
+
+		/* keep the pace, or restart it from now if the frame came late */
+		s_u64Due += s_u64Interval;
+		if (s_u64Due <= u64Now)
+			s_u64Due = u64Now + s_u64Interval;
+	}
+	else if (s_u64Interval && !s_bEnd)
+	{
+		s_sStat.u32Repeats++;
+	}
+
+	s_u32Latched = s_u32Flipped;
+}
+
+void h264_pipe_get_stat(H264_PIPE_STAT_T *psStat)
+{
+	psStat->u32Frames = s_u32Flipped - s_u32FlipBase;
+	psStat->u32Repeats = s_sStat.u32Repeats;
+	psStat->u32Stalls = s_sStat.u32Stalls;
+	psStat->u32MinAhead = s_sStat.u32MinAhead;
+}
@@ -0,0 +1,103 @@
+/**************************************************************************//**
+ * @file     h264_pipe.h
+ *
+ * @brief    H264 playback pipeline: a ring of bit stream segments filled
+ *           from the file between decodes, and a queue of display buffers
+ *           flipped on vsync.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ ******************************************************************************/
+#ifndef __H264_PIPE_H__
+#define __H264_PIPE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "ff.h"
+
+#define H264_STREAM_SEG_SIZE    0x40000     /* bytes of a bit stream segment               */
+#define H264_STREAM_SEGS        4           /* segments of the bit stream ring             */
+#define H264_STREAM_IO_SIZE     0x10000     /* bytes read from the file by one I/O step    */
+#define H264_STREAM_MIN_AHEAD   (256 * 1024) /* bytes ahead of the decoder, the largest frame */
+#define H264_DISP_BUFS          3           /* display buffers, one on screen              */
+
+/*
+ * Bit stream: the file is read into a ring of H264_STREAM_SEGS segments by
+ * h264_pipe_fill(), one H264_STREAM_IO_SIZE piece per call, while the USB
+ * disk read-ahead of diskio.c keeps the next pieces in flight. The data is
+ * handed to the decoder up to the last start code read, whole NAL units
+ * only, and only once H264_STREAM_MIN_AHEAD bytes are there or the file is
+ * read to its end. When the decoder nears the end of the ring, the bytes
+ * it has left there are copied in front of the first segment so that its
+ * input is always contiguous; nothing else is ever moved.
+ *
+ * Display: H264_DISP_BUFS frame buffers used in turn. The decoder takes the
+ * next free one, has the post-processor write it and queues it; the vsync
+ * interrupt shows the queued frames in order at the frame rate and frees a
+ * buffer one vsync after it was replaced on screen, when the display
+ * controller has latched the new address.
+ *
+ * Bit stream offsets are 32 bits, files are up to 4 GB.
+ */
+
+typedef struct
+{
+	uint32_t u32Frames;         /* frames shown */
+	uint32_t u32Repeats;        /* vsyncs a frame was due and none was queued */
+	uint32_t u32Stalls;         /* times the decoder waited for the bit stream */
+	uint32_t u32MinAhead;       /* least bit stream bytes ahead of a decode */
+} H264_PIPE_STAT_T;
+
+/* Start a file at its current position, the FIL must stay valid until h264_pipe_close() */
+void h264_pipe_open(FIL *pFile);
+
+/* I/O step: read the next piece of the file into the ring. Return the bytes read. */
+uint32_t h264_pipe_fill(void);
+
+/* Decoder: *pu32Len contiguous bytes of whole NAL units, NULL while waiting for the file */
+uint8_t *h264_pipe_get(uint32_t *pu32Len);
+
+/* Decoder: u32Len bytes from h264_pipe_get() were decoded */
+void h264_pipe_consume(uint32_t u32Len);
+
+/* Whether the file is read to its end and decoded */
+int h264_pipe_done(void);
+
+/* Result of the last failed f_read(), FR_OK if none */
+FRESULT h264_pipe_error(void);
+
+void h264_pipe_close(void);
+
+/* Set the display buffers, au32Addr[0] is the one on screen */
+void h264_pipe_frame_init(const uint32_t au32Addr[H264_DISP_BUFS]);
+
+/* Show queued frames at u32Fps frames per second, 0 as soon as they are queued */
+void h264_pipe_frame_start(uint32_t u32Fps);
+
+/* End of the stream: the queued frames are still shown, no frame is due any more */
+void h264_pipe_frame_stop(void);
+
+/* Decoder: address of the next free display buffer, 0 while all are in use */
+uint32_t h264_pipe_frame_get(void);
+
+/* Decoder: the buffer from h264_pipe_frame_get() holds a frame, queue it for display */
+void h264_pipe_frame_put(void);
+
+/* Frames queued and not shown yet */
+uint32_t h264_pipe_frame_pending(void);
+
+/* Vsync interrupt of the display controller */
+void h264_pipe_vsync(void);
+
+void h264_pipe_get_stat(H264_PIPE_STAT_T *psStat);
+
+/* USB disk read-ahead of diskio.c, advanced while the CPU waits */
+extern void disk_io_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __H264_PIPE_H__ */
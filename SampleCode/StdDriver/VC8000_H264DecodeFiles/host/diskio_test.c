@@ -0,0 +1,328 @@
+/**************************************************************************//**
+ * @file     diskio_test.c
+ *
+ * @brief    Test of the USB disk read-ahead of the VC8000_H264DecodeFiles
+ *           diskio.c against a simulated drive.
+ *
+ * Checks the data every read returns and the commands the drive sees:
+ * the bit stream, read H264_STREAM_IO_SIZE at a time, is served by
+ * asynchronous read-ahead chunks while FAT and directory reads go around
+ * it, writes go straight to the medium and are never read stale, nothing
+ * read ahead outlives the medium, and a random mix of reads and writes
+ * matches a plain model of the disk.
+ *
+ * Run: ./diskio_test
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NuMicro.h"
+#include "ff.h"
+#include "diskio.h"
+#include "h264_pipe.h"
+#include "usbh_sim.h"
+
+#define SS			SIM_SECTOR_SIZE
+#define IO_SECTORS		(H264_STREAM_IO_SIZE / SS)
+#define DISK_SECTORS		8192
+#define FAT_SECTOR		40		/* somewhere away from the streams */
+#define POLLS_PER_READ		4		/* disk_io_poll() calls of the decoder between reads */
+
+/* As in ../diskio.c */
+#define DISK_RA_CHUNK_SECTORS	128
+#define DISK_RA_DEPTH		8
+
+static int s_fail;
+
+#define CHECK(c, ...)							\
+	do {								\
+		if (!(c)) {						\
+			printf("  FAIL %s:%d: ", __func__, __LINE__);	\
+			printf(__VA_ARGS__);				\
+			printf("\n");					\
+			s_fail++;					\
+			return;						\
+		}							\
+	} while (0)
+
+static BYTE s_model[DISK_SECTORS][SS];		/* what the disk must hold */
+
+static void setup(unsigned int latency)
+{
+	uint32_t s;
+
+	usbh_sim_destroy();
+	if (usbh_sim_create(DISK_SECTORS)) {
+		fprintf(stderr, "no memory\n");
+		exit(2);
+	}
+	usbh_sim_set_latency(latency);
+	for (s = 0; s < DISK_SECTORS; s++)
+		memcpy(s_model[s], usbh_sim_sector(s), SS);
+	/* Binds the cache to drive 0 and resets it */
+	disk_initialize(0);
+}
+
+static int same_as_model(const BYTE *buff, DWORD sector, UINT count)
+{
+	return memcmp(buff, s_model[sector], (size_t)count * SS) == 0;
+}
+
+static void fill(BYTE *buff, DWORD sector, UINT count, unsigned int seed)
+{
+	size_t i;
+
+	for (i = 0; i < (size_t)count * SS; i++)
+		buff[i] = (BYTE)(seed * 29 + sector * 3 + i * 5 + (i >> 9));
+}
+
+static DRESULT model_write(DWORD sector, UINT count, unsigned int seed)
+{
+	BYTE buff[16 * SS];
+
+	fill(buff, sector, count, seed);
+	memcpy(s_model[sector], buff, (size_t)count * SS);
+	return disk_write(0, buff, sector, count);
+}
+
+static void poll_some(void)
+{
+	int i;
+
+	for (i = 0; i < POLLS_PER_READ; i++)
+		disk_io_poll();
+}
+
+/* The bit stream read H264_STREAM_IO_SIZE at a time, the FAT now and then */
+static void test_stream(unsigned int latency)
+{
+	static BYTE buff[H264_STREAM_IO_SIZE];
+	DWORD sector, start = 1000, len = 4096;
+	struct usbh_sim_stats *st;
+
+	setup(latency);
+	st = usbh_sim_stats();
+	for (sector = start; sector < start + len; sector += IO_SECTORS) {
+		CHECK(disk_read(0, buff, sector, IO_SECTORS) == RES_OK, "read %lu", sector);
+		CHECK(same_as_model(buff, sector, IO_SECTORS), "data of sector %lu", sector);
+		if (((sector - start) % 512) == 0) {
+			CHECK(disk_read(0, buff, FAT_SECTOR, 1) == RES_OK, "FAT read");
+			CHECK(same_as_model(buff, FAT_SECTOR, 1), "FAT data");
+		}
+		poll_some();
+	}
+
+	printf("  latency %3u: %lu sectors by %lu sync reads, %lu by %lu read-ahead chunks\n",
+	       latency, st->sync_read_secs, st->sync_read_cmds, st->async_read_secs, st->async_read_cmds);
+	/* The first read and the FAT reads only */
+	CHECK(st->sync_read_cmds <= 1 + len / 512, "%lu synchronous reads", st->sync_read_cmds);
+	CHECK(st->async_read_secs >= len - IO_SECTORS, "read-ahead covered %lu of %lu sectors",
+	      st->async_read_secs, len);
+	/* Never more than the stream plus the ring ahead of it */
+	CHECK(st->async_read_secs <= len + DISK_RA_DEPTH * DISK_RA_CHUNK_SECTORS,
+	      "%lu sectors read ahead", st->async_read_secs);
+	CHECK(st->max_async_read == DISK_RA_CHUNK_SECTORS, "chunks of %lu sectors", st->max_async_read);
+	CHECK(st->bad_params == 0, "commands outside the disk");
+}
+
+/* FatFs reading a file through its sector window, one sector at a time */
+static void test_single_sectors(void)
+{
+	BYTE buff[SS];
+	DWORD sector;
+	struct usbh_sim_stats *st;
+
+	setup(2);
+	st = usbh_sim_stats();
+	for (sector = 3000; sector < 3000 + 1024; sector++) {
+		CHECK(disk_read(0, buff, sector, 1) == RES_OK, "read %lu", sector);
+		CHECK(same_as_model(buff, sector, 1), "data of sector %lu", sector);
+		disk_io_poll();
+	}
+	CHECK(st->sync_read_cmds == 1, "%lu synchronous reads", st->sync_read_cmds);
+}
+
+/* The stream runs into the last sector of the disk */
+static void test_disk_end(void)
+{
+	BYTE buff[3 * SS];
+	UINT cnt = 3;
+	DWORD sector;
+
+	setup(1);
+	for (sector = DISK_SECTORS - 700; sector + cnt <= DISK_SECTORS; sector += cnt) {
+		CHECK(disk_read(0, buff, sector, cnt) == RES_OK, "read %lu", sector);
+		CHECK(same_as_model(buff, sector, cnt), "data of sector %lu", sector);
+		poll_some();
+	}
+	CHECK(usbh_sim_stats()->bad_params == 0, "commands outside the disk");
+}
+
+/* Writes go straight to the medium and the ring never serves older data */
+static void test_write_through(void)
+{
+	static BYTE buff[H264_STREAM_IO_SIZE];
+	struct usbh_sim_stats *st;
+	DWORD sector, start = 2000;
+
+	setup(5);
+	st = usbh_sim_stats();
+	CHECK(disk_read(0, buff, start, IO_SECTORS) == RES_OK, "read %lu", start);
+	poll_some();
+
+	/* Ahead of the stream, in a chunk that is already read or in flight */
+	CHECK(model_write(start + IO_SECTORS + 6, 2, 1) == RES_OK, "write");
+	CHECK(st->sync_write_secs == 2 && st->async_write_secs == 0,
+	      "%lu sectors written, %lu behind", st->sync_write_secs, st->async_write_secs);
+	CHECK(memcmp(usbh_sim_sector(start + IO_SECTORS + 6), s_model[start + IO_SECTORS + 6], 2 * SS) == 0,
+	      "medium after the write");
+
+	for (sector = start + IO_SECTORS; sector < start + 8 * IO_SECTORS; sector += IO_SECTORS) {
+		CHECK(disk_read(0, buff, sector, IO_SECTORS) == RES_OK, "read %lu", sector);
+		CHECK(same_as_model(buff, sector, IO_SECTORS), "data of sector %lu after a write", sector);
+		poll_some();
+	}
+	CHECK(disk_ioctl(0, CTRL_SYNC, NULL) == RES_OK, "sync");
+}
+
+/* Another medium with every byte set to b, as the cache under test finds it */
+static void swap_medium(BYTE b)
+{
+	uint32_t s;
+
+	usbh_sim_destroy();
+	if (usbh_sim_create(DISK_SECTORS)) {
+		fprintf(stderr, "no memory\n");
+		exit(2);
+	}
+	usbh_sim_set_latency(20);
+	for (s = 0; s < DISK_SECTORS; s++)
+		memset(usbh_sim_sector(s), b, SS);
+}
+
+static int buff_is(const BYTE *buff, UINT count, BYTE b)
+{
+	UINT i;
+
+	for (i = 0; i < count * SS; i++)
+		if (buff[i] != b)
+			return 0;
+	return 1;
+}
+
+/* A stream read while the decoder idles: the whole ring is read ahead */
+static void start_stream(BYTE *buff, DWORD start)
+{
+	DWORD sector;
+	int i;
+
+	for (sector = start; sector < start + 2 * IO_SECTORS; sector += IO_SECTORS)
+		disk_read(0, buff, sector, IO_SECTORS);
+	for (i = 0; i < 1000; i++)
+		disk_io_poll();
+}
+
+/* Nothing read ahead from a removed or replaced medium is served */
+static void test_media_change(void)
+{
+	static BYTE buff[H264_STREAM_IO_SIZE];
+	DWORD next = 2000 + 2 * IO_SECTORS;
+
+	/* Replaced before FatFs noticed, then initialized again */
+	setup(20);
+	start_stream(buff, 2000);
+	swap_medium(0xA5);
+	CHECK(disk_initialize(0) == RES_OK, "initialize");
+	CHECK(disk_read(0, buff, next, IO_SECTORS) == RES_OK, "read");
+	CHECK(buff_is(buff, IO_SECTORS, 0xA5), "read-ahead of the old medium served after initialize");
+
+	/* Removed: the drive reports no disk, and reads fail until a medium is back */
+	setup(20);
+	start_stream(buff, 2000);
+	usbh_sim_destroy();
+	CHECK(disk_status(0) == STA_NODISK, "status without the drive");
+	CHECK(disk_read(0, buff, next, IO_SECTORS) == RES_NOTRDY, "read-ahead served without the drive");
+	swap_medium(0x5A);
+	CHECK(disk_initialize(0) == RES_OK, "initialize");
+	CHECK(disk_read(0, buff, next, IO_SECTORS) == RES_OK, "read");
+	CHECK(buff_is(buff, IO_SECTORS, 0x5A), "read-ahead of the removed medium served");
+
+	/* Removed while FatFs reads around the stream: the failed read drops the ring */
+	setup(20);
+	start_stream(buff, 2000);
+	usbh_sim_destroy();
+	CHECK(disk_read(0, buff, FAT_SECTOR, 1) == RES_NOTRDY, "FAT read without the drive");
+	swap_medium(0xC3);
+	CHECK(disk_read(0, buff, next, IO_SECTORS) == RES_OK, "read");
+	CHECK(buff_is(buff, IO_SECTORS, 0xC3), "read-ahead of the removed medium served");
+
+	/* The model follows the medium for the tests after this one */
+	setup(3);
+}
+
+/* Random reads and writes against the model */
+static void test_random(void)
+{
+	BYTE buff[16 * SS];
+	DWORD stream = 100, sector;
+	UINT count;
+	unsigned int i, r;
+
+	setup(4);
+	srand(44);
+	for (i = 0; i < 20000; i++) {
+		r = (unsigned int)rand() % 100;
+		count = 1 + (unsigned int)rand() % 16;
+		if (r < 70) {
+			/* Mostly the stream, which wraps */
+			if (stream + count > DISK_SECTORS)
+				stream = 100;
+			sector = stream;
+			stream += count;
+		} else {
+			sector = (unsigned int)rand() % (DISK_SECTORS - count);
+		}
+
+		if (r < 90) {
+			CHECK(disk_read(0, buff, sector, count) == RES_OK, "read %lu", sector);
+			CHECK(same_as_model(buff, sector, count), "step %u: data of %u sectors at %lu", i, count, sector);
+		} else if (r < 98) {
+			CHECK(model_write(sector, count, i) == RES_OK, "write %lu", sector);
+		} else {
+			CHECK(disk_ioctl(0, CTRL_SYNC, NULL) == RES_OK, "sync");
+		}
+		if (r & 1)
+			disk_io_poll();
+	}
+	for (sector = 0; sector < DISK_SECTORS; sector++)
+		CHECK(memcmp(usbh_sim_sector(sector), s_model[sector], SS) == 0, "medium sector %lu", sector);
+	CHECK(usbh_sim_stats()->bad_params == 0, "commands outside the disk");
+}
+
+int main(void)
+{
+	static const unsigned int latency[] = { 0, 1, 8, 64 };
+	unsigned int i;
+
+	printf("stream\n");
+	for (i = 0; i < sizeof(latency) / sizeof(latency[0]); i++)
+		test_stream(latency[i]);
+	printf("single sectors\n");
+	test_single_sectors();
+	printf("disk end\n");
+	test_disk_end();
+	printf("write through\n");
+	test_write_through();
+	printf("media change\n");
+	test_media_change();
+	printf("random\n");
+	test_random();
+
+	usbh_sim_destroy();
+	printf("%s\n", s_fail ? "FAIL" : "PASS");
+	return s_fail != 0;
+}
@@ -14,23 +14,22 @@
 #include "diskio.h"
 #include "displib.h"
 #include "vc8000_lib.h"
+#include "h264_pipe.h"
 
 #define LCD_WIDTH         1024
 #define LCD_HEIGHT        600
-#define DISP_BUFF_SIZE    (LCD_WIDTH * LCD_HEIGHT * 4 * 4)  /* 1024 x 600 RGB888 */
+#define DISP_BUFF_SIZE    (LCD_WIDTH * LCD_HEIGHT * 4)  /* 1024 x 600 RGB888 */
 
 #define jiffies           (EL0_GetCurrentPhysicalValue() / 12000)
 
 #define FRAME_RATE_CONTROL
 #define FRAME_RATE        30
-#define FRAME_INTERVAL    (1000 / FRAME_RATE)
 
-#define STREAM_BUFF_SIZE  0x100000
-#define MIN_REMAIN        (256 * 1024)
+#define DISK_IO_PRIME_US  200
 
-uint8_t  _DisplayBuff[DISP_BUFF_SIZE] __attribute__((aligned(32)));
+/* Frames are decoded into the display buffers in turn and flipped on vsync */
+uint8_t  _DisplayBuff[H264_DISP_BUFS][DISP_BUFF_SIZE] __attribute__((aligned(32)));
 uint8_t  _VC8000Buff[0x2000000] __attribute__((aligned(32)));  /* 32 MB */
-uint8_t  _StreamBuff[STREAM_BUFF_SIZE] __attribute__((aligned(32)));
 
 static int _h264_handle;
 static struct pp_params _pp;
@@ -205,6 +204,12 @@ DWORD get_fattime (void)
 	return tmr;
 }
 
+void DISP_IRQHandler(void)
+{
+	if (DISP_GetIntFlag())
+		h264_pipe_vsync();
+}
+
 static int is_h264_file(char *fname)
 {
 	int  slen = strlen(fname);
@@ -215,17 +220,37 @@ static int is_h264_file(char *fname)
 	return 0;
 }
 
+/* Wait for the display or the decoder while the file is read ahead */
+static void decode_wait(void)
+{
+	if (h264_pipe_fill() == 0)
+		disk_io_poll();
+}
+
+/*
+ * The USB disk advances a command stage by stage when polled only. Poll for
+ * a moment before a decode so that a command issued last gets past its CBW,
+ * its data stage then runs while the CPU is blocked in the decoder.
+ */
+static void disk_io_prime(void)
+{
+	uint64_t  t0 = EL0_GetCurrentPhysicalValue();
+
+	while (EL0_GetCurrentPhysicalValue() - t0 < DISK_IO_PRIME_US * 12)
+		disk_io_poll();
+}
+
 int do_h264_decode(char *fname, uint32_t fsize)
 {
 	FIL       hFile, *pFile = NULL;
-	int       remain, next_frame_offs, ret;
-	uint8_t   *stream_buff = nc_ptr(_StreamBuff);
-	int       frame_size, r;
+	int       ret;
+	uint8_t   *in;
+	uint32_t  in_len, r, frame_addr;
 	int       decode_cnt;
 	uint32_t  play_len;
-	uint64_t  start_time, next_frame_time;
 	int       last_decode_cnt = 0;
-	uint64_t  fps_check_jiffy = 0;
+	uint64_t  fps_check_jiffy = 0, t0, decode_ticks = 0;
+	H264_PIPE_STAT_T  stat;
 
 	pFile = nc_ptr(&hFile);   /* make FIL->buff be non-cache */
 
@@ -250,33 +275,57 @@ int do_h264_decode(char *fname, uint32_t fsize)
 		goto err_out;
 	}
 
-	ret = f_read(pFile, stream_buff, STREAM_BUFF_SIZE, &remain);
-	if (ret != 0)
-	{
-		sysprintf("Read file failed! (%d)\n", ret);
-		goto err_out;
-	}
+	h264_pipe_open(pFile);
+
+#ifdef FRAME_RATE_CONTROL
+	h264_pipe_frame_start(FRAME_RATE);
+#else
+	h264_pipe_frame_start(0);
+#endif
 
 	decode_cnt = 0;
 	play_len = 0;
-	next_frame_offs = 0;
-	start_time = jiffies;
-	while (1)
+	while (!h264_pipe_done())
 	{
-#ifdef FRAME_RATE_CONTROL
-		/* frame rate control */
-		while (jiffies - start_time < FRAME_INTERVAL * decode_cnt);
-#endif
+		/* A free display buffer, the vsync interrupt paces the decoder from here */
+		while ((frame_addr = h264_pipe_frame_get()) == 0)
+			decode_wait();
+
+		/* Whole NAL units, at least one frame of them unless the file ends */
+		while ((in = h264_pipe_get(&in_len)) == NULL)
+		{
+			if (h264_pipe_done())
+				break;
+			decode_wait();
+		}
+		if (in == NULL)
+			break;
+
+		_pp.pp_out_paddr = frame_addr;
+		ret = VC8000_H264_Update_PP(_h264_handle, &_pp);
+		if (ret < 0)
+		{
+			sysprintf("VC8000_H264_Update_PP failed! (%d)\n", ret);
+			break;
+		}
+
+		disk_io_prime();
 
 		r = 0;
-		ret = VC8000_H264_Decode_Run(_h264_handle, stream_buff + next_frame_offs, remain, NULL, &r);
-		if (ret != 0)
+		t0 = EL0_GetCurrentPhysicalValue();
+		ret = VC8000_H264_Decode_Run(_h264_handle, in, in_len, NULL, &r);
+		decode_ticks += EL0_GetCurrentPhysicalValue() - t0;
+		if ((ret != 0) || (r == in_len))
 			break;
 
+		h264_pipe_frame_put();
+		h264_pipe_consume(in_len - r);
+
 		decode_cnt++;
-		next_frame_offs += (remain - r);
-		play_len += (remain - r);
-		remain = r;
+		play_len += (in_len - r);
+
+		/* The next piece of the file while the frame waits for its vsync */
+		h264_pipe_fill();
 
 		if (jiffies - fps_check_jiffy >= 1000)
 		{
@@ -285,33 +334,31 @@ int do_h264_decode(char *fname, uint32_t fsize)
 			fps_check_jiffy = jiffies;
 		}
 
-		// sysprintf("Decode done: %d / %d\n", remain, data_len);
-
 		if (sysIsKbHit())
 		{
 			sysgetchar();
 			break;
 		}
+	}
 
-		if (remain == 0 && f_eof(pFile))
-			break;
+	/* Show what is queued */
+	h264_pipe_frame_stop();
+	while (h264_pipe_frame_pending())
+		;
 
-		if ((remain < MIN_REMAIN) && !f_eof(pFile))
-		{
-			if (remain > 0)
-				memcpy(stream_buff, stream_buff + next_frame_offs, remain);
-
-			ret = f_read(pFile, stream_buff + remain, STREAM_BUFF_SIZE - remain, &r);
-			if (ret != 0)
-			{
-				sysprintf("Read file error! (%d)\n", ret);
-				goto err_out;
-			}
-			remain += r;
-			next_frame_offs = 0;
-		}
-	}
+	if (h264_pipe_error() != FR_OK)
+		sysprintf("Read file error! (%d)\n", h264_pipe_error());
+
+	h264_pipe_get_stat(&stat);
+	sysprintf("%d frames decoded, %d us per frame; %d shown, %d vsyncs repeated a frame, "
+			  "%d waits for the file, least %d KB ahead\n",
+			  decode_cnt, decode_cnt ? (uint32_t)(decode_ticks / 12 / decode_cnt) : 0,
+			  stat.u32Frames, stat.u32Repeats, stat.u32Stalls,
+			  (stat.u32MinAhead == 0xFFFFFFFF) ? 0 : stat.u32MinAhead / 1024);
+
+	h264_pipe_close();
 	VC8000_H264_Close_Instance(_h264_handle);
+	_h264_handle = -1;
 	f_close(pFile);
 	return 0;
 
@@ -319,7 +366,8 @@ err_out:
 	if (pFile)
 		f_close(pFile);
 	if (_h264_handle != -1)
-		VC8000_JPEG_Close_Instance(_h264_handle);
+		VC8000_H264_Close_Instance(_h264_handle);
+	_h264_handle = -1;
 	return -1;
 }
 
@@ -377,6 +425,7 @@ int32_t main(void)
 	TCHAR     usb_path[] = { '0', ':', 0 };
 	DIR       dir;
 	int       i, ret;
+	uint32_t  disp_addr[H264_DISP_BUFS];
 
 	/* Unlock protected registers */
 	SYS_UnlockReg();
@@ -407,7 +456,7 @@ int32_t main(void)
 
 	/* Configure DISP Framebuffer settings  */
 	DISPLIB_SetFBConfig(eFBFmt_A8R8G8B8, LcdPanelInfo.u32ResolutionWidth,
-						LcdPanelInfo.u32ResolutionHeight, ptr_to_u32(_DisplayBuff));
+						LcdPanelInfo.u32ResolutionHeight, ptr_to_u32(_DisplayBuff[0]));
 
 	/* Start to display */
 	DISPLIB_EnableOutput(eLayer_Video);
@@ -447,14 +496,23 @@ int32_t main(void)
 	_pp.img_out_fmt = VC8000_PP_F_RGB888;
 	_pp.rotation = VC8000_PP_ROTATION_NONE;
 	_pp.pp_out_dst = VC8000_PP_OUT_DST_USER;
-	_pp.pp_out_paddr =  ptr_to_u32(_DisplayBuff);
+	_pp.pp_out_paddr =  ptr_to_u32(_DisplayBuff[0]);
     _pp.contrast = 8;
     _pp.brightness = 0;
     _pp.saturation = 32;
     _pp.alpha = 255;
     _pp.transparency = 0;
 
-	DISPLIB_SetFBAddr(ptr_to_u32(_DisplayBuff));
+	DISPLIB_SetFBAddr(ptr_to_u32(_DisplayBuff[0]));
+
+	for (i = 0; i < H264_DISP_BUFS; i++)
+		disp_addr[i] = ptr_to_u32(_DisplayBuff[i]);
+	h264_pipe_frame_init(disp_addr);
+
+	/* Flip to decoded frames on vsync */
+	IRQ_SetHandler((IRQn_ID_t)DISP_IRQn, DISP_IRQHandler);
+	IRQ_Enable((IRQn_ID_t)DISP_IRQn);
+	DISP_EnableInt();
 
 	IRQ_SetTarget(VDE_IRQn, IRQ_CPU_0);
 
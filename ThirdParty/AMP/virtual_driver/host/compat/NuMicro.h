@@ -0,0 +1,18 @@
+/**************************************************************************//**
+ * @file     NuMicro.h
+ *
+ * @brief    Stand-in for the BSP header, for the host build of shm_ring.c.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __NUMICRO_H__
+#define __NUMICRO_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* A full barrier, as DMB SY orders both loads and stores between the cores */
+#define __DMB()		__atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#endif /* __NUMICRO_H__ */
@@ -0,0 +1,13 @@
+/**************************************************************************//**
+ * @file     open_amp.h
+ *
+ * @brief    Stand-in for the OpenAMP header, for the host build of
+ *           shm_ring.c, which needs none of it.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __OPEN_AMP_H__
+#define __OPEN_AMP_H__
+
+#endif /* __OPEN_AMP_H__ */
@@ -0,0 +1,17 @@
+/**************************************************************************//**
+ * @file     openamp_conf.h
+ *
+ * @brief    Ring geometry of the Share_Memory_SRAM sample, for the host build
+ *           of shm_ring.c. The ring itself lives in a static buffer of
+ *           shm_ring_test.c, which is linked below 4 GB.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __OPENAMP_CONF_H__
+#define __OPENAMP_CONF_H__
+
+#define SHM_RING_SLOTS		8
+#define SHM_RING_SIZE		(0x780)
+
+#endif /* __OPENAMP_CONF_H__ */
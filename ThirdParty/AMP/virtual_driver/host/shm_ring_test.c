@@ -0,0 +1,347 @@
+/**************************************************************************//**
+ * @file     shm_ring_test.c
+ *
+ * @brief    Test of the shared memory message ring (shm_ring.c), for the
+ *           host build.
+ *
+ * Single threaded, the ring wraps its slots and its free running 32-bit
+ * counters, refuses a message when full and asks for a doorbell exactly
+ * on the empty to non-empty transition. Then a producer and a consumer
+ * thread, each with its own view of the ring as the A35 and the M4 have,
+ * stream messages through it; the consumer sleeps on the doorbell
+ * whenever it finds the ring empty, so a doorbell the producer fails to
+ * ring shows up as a timeout.
+ *
+ * Run: ./shm_ring_test [messages]
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "NuMicro.h"
+#include "shm_ring.h"
+
+#define DOORBELL_TIMEOUT	2	/* seconds */
+
+/* The ring as both cores see it, below 4 GB as the program is not PIE */
+static uint8_t s_shm[SHM_RING_SIZE] __attribute__((aligned(SHM_RING_LINE)));
+
+static int s_fail;
+
+static void check(int ok, const char *what, unsigned long v)
+{
+	if (!ok) {
+		printf("  FAIL: %s (%lu)\n", what, v);
+		s_fail++;
+	}
+}
+
+static uint32_t shm_phys(void)
+{
+	return (uint32_t)(uintptr_t)s_shm;
+}
+
+static uint32_t msg_len(uint32_t seq)
+{
+	return 1 + (seq * 37) % SHM_RING_SLOT_SIZE;
+}
+
+static void msg_fill(uint8_t *p, uint32_t seq)
+{
+	uint32_t i, len = msg_len(seq);
+
+	for (i = 0; i < len; i++)
+		p[i] = (uint8_t)(seq * 131 + i);
+}
+
+static int msg_ok(const uint8_t *p, uint32_t len, uint32_t seq)
+{
+	uint32_t i;
+
+	if (len != msg_len(seq))
+		return 0;
+	for (i = 0; i < len; i++)
+		if (p[i] != (uint8_t)(seq * 131 + i))
+			return 0;
+	return 1;
+}
+
+/* Producer and consumer views of a freshly reset ring */
+static void ring_setup(SHM_RING_T *tx, SHM_RING_T *rx, uint32_t u32Start)
+{
+	shm_ring_init(tx, shm_phys());
+	shm_ring_init(rx, shm_phys());
+	shm_ring_reset(tx);
+	tx->ctrl->u32Head = u32Start;
+	tx->ctrl->u32Tail = u32Start;
+}
+
+static int ring_send(SHM_RING_T *tx, uint32_t seq, int *pbDoorbell)
+{
+	void *p = shm_ring_alloc(tx);
+
+	if (p == NULL)
+		return 0;
+	msg_fill(p, seq);
+	*pbDoorbell = shm_ring_publish(tx, msg_len(seq));
+	return 1;
+}
+
+static int ring_recv(SHM_RING_T *rx, uint32_t seq)
+{
+	uint32_t len;
+	void *p = shm_ring_peek(rx, &len);
+	int ok;
+
+	if (p == NULL)
+		return 0;
+	ok = msg_ok(p, len, seq);
+	shm_ring_release(rx);
+	return ok ? 1 : -1;
+}
+
+/*---------------------------------------------------------------------------
+ *  Single threaded
+ *---------------------------------------------------------------------------*/
+
+/* Slots and counters wrap, with 0 to SHM_RING_SLOTS messages in flight */
+static void test_wrap(void)
+{
+	static const uint32_t starts[] = { 0, 0xFFFFFFFFu - 2 * SHM_RING_SLOTS };
+	SHM_RING_T tx, rx;
+	uint32_t s, sent, got, depth;
+	int bell, ret;
+
+	printf("Wrap ...\n");
+	for (s = 0; s < sizeof(starts) / sizeof(starts[0]); s++) {
+		ring_setup(&tx, &rx, starts[s]);
+		sent = got = 0;
+		for (depth = 0; depth <= SHM_RING_SLOTS; depth++) {
+			for (; sent - got < depth; sent++)
+				check(ring_send(&tx, sent, &bell), "send", sent);
+			while (got < sent) {
+				ret = ring_recv(&rx, got++);
+				check(ret == 1, "message intact", got - 1);
+				/* Keep the ring going round at every depth */
+				if ((got % 3) == 0 && (sent - got < depth)) {
+					check(ring_send(&tx, sent, &bell), "send", sent);
+					sent++;
+				}
+			}
+		}
+		check(sent > 4 * SHM_RING_SLOTS, "messages", sent);
+		check(shm_ring_count(&tx) == 0, "ring empty", shm_ring_count(&tx));
+		check(tx.ctrl->u32Head == starts[s] + sent, "head", tx.ctrl->u32Head);
+	}
+	check(tx.ctrl->u32Head < starts[1], "counters wrapped", tx.ctrl->u32Head);
+}
+
+/* A full ring refuses the next message until a slot comes back */
+static void test_full(void)
+{
+	SHM_RING_T tx, rx;
+	uint32_t i, len;
+	void *first, *p;
+	int bell;
+
+	printf("Full ring ...\n");
+	ring_setup(&tx, &rx, 5);
+	first = NULL;
+	for (i = 0; i < SHM_RING_SLOTS; i++) {
+		p = shm_ring_alloc(&tx);
+		check(p != NULL, "alloc below full", i);
+		if (p == NULL)
+			return;
+		if (i == 0)
+			first = p;
+		msg_fill(p, i);
+		shm_ring_publish(&tx, msg_len(i));
+	}
+	check(shm_ring_count(&tx) == SHM_RING_SLOTS, "count when full", shm_ring_count(&tx));
+	check(shm_ring_alloc(&tx) == NULL, "alloc when full", 0);
+	check(shm_ring_alloc(&tx) == NULL, "alloc when full, again", 0);
+
+	/* The oldest slot is the next one handed out */
+	p = shm_ring_peek(&rx, &len);
+	check(p == first, "oldest message first", 0);
+	check(shm_ring_peek_phys(&rx) == shm_phys() + SHM_RING_HDR_SIZE +
+	      (5 % SHM_RING_SLOTS) * SHM_RING_SLOT_SIZE, "physical slot address", 0);
+	check(msg_ok(p, len, 0), "oldest message intact", 0);
+	check(shm_ring_alloc(&tx) == NULL, "alloc before release", 0);
+	shm_ring_release(&rx);
+	check(shm_ring_alloc(&tx) == first, "alloc after release", 0);
+	msg_fill(first, SHM_RING_SLOTS);
+	bell = shm_ring_publish(&tx, msg_len(SHM_RING_SLOTS));
+	check(!bell, "no doorbell into a non-empty ring", 0);
+	for (i = 1; i <= SHM_RING_SLOTS; i++)
+		check(ring_recv(&rx, i) == 1, "drain", i);
+	check(ring_recv(&rx, 0) == 0, "empty after drain", 0);
+
+	/* A corrupt descriptor cannot make the consumer read past its slot */
+	check(ring_send(&tx, 0, &bell), "send", 0);
+	tx.ctrl->au32Len[tx.u32Idx % SHM_RING_SLOTS] = 0xFFFFFFFF;
+	p = shm_ring_peek(&rx, &len);
+	check(len == SHM_RING_SLOT_SIZE, "length clamped to the slot", len);
+	shm_ring_release(&rx);
+}
+
+/* Doorbells on the empty to non-empty transition only */
+static void test_doorbell(void)
+{
+	SHM_RING_T tx, rx;
+	uint32_t sent = 0, got = 0;
+	int bell;
+
+	printf("Doorbell ...\n");
+	ring_setup(&tx, &rx, 0);
+
+	ring_send(&tx, sent++, &bell);
+	check(bell, "doorbell into an empty ring", 0);
+	ring_send(&tx, sent++, &bell);
+	check(!bell, "no doorbell with one queued", 0);
+
+	/* One message still queued: the consumer has not caught up */
+	check(ring_recv(&rx, got) == 1, "recv", got);
+	got++;
+	ring_send(&tx, sent++, &bell);
+	check(!bell, "no doorbell while the consumer lags", 0);
+
+	/* Drained: the next message must wake the consumer */
+	for (; got < sent; got++)
+		check(ring_recv(&rx, got) == 1, "recv", got);
+	ring_send(&tx, sent++, &bell);
+	check(bell, "doorbell after the consumer emptied the ring", 0);
+
+	/* Peeked but not released yet still counts as queued */
+	check(shm_ring_peek(&rx, &(uint32_t){ 0 }) != NULL, "peek", 0);
+	ring_send(&tx, sent++, &bell);
+	check(!bell, "no doorbell while a message is being read", 0);
+	shm_ring_release(&rx);
+	got++;
+	for (; got < sent; got++)
+		check(ring_recv(&rx, got) == 1, "recv", got);
+}
+
+/*---------------------------------------------------------------------------
+ *  Producer and consumer threads
+ *---------------------------------------------------------------------------*/
+
+static struct {
+	uint32_t msgs;
+	sem_t doorbell;
+	unsigned long bells;		/* doorbells rung */
+	unsigned long full;		/* sends refused by a full ring */
+	unsigned long sleeps;		/* waits of the consumer */
+	int err;
+} s_run;
+
+static void *producer(void *arg)
+{
+	SHM_RING_T tx;
+	uint32_t seq = 0;
+	int bell;
+
+	(void)arg;
+	shm_ring_init(&tx, shm_phys());
+	while (seq < s_run.msgs) {
+		if (!ring_send(&tx, seq, &bell)) {
+			s_run.full++;
+			sched_yield();
+			continue;
+		}
+		seq++;
+		if (bell) {
+			s_run.bells++;
+			sem_post(&s_run.doorbell);
+		}
+	}
+	return NULL;
+}
+
+static void *consumer(void *arg)
+{
+	SHM_RING_T rx;
+	struct timespec ts;
+	uint32_t seq = 0;
+	int ret;
+
+	(void)arg;
+	shm_ring_init(&rx, shm_phys());
+	while (seq < s_run.msgs) {
+		ret = ring_recv(&rx, seq);
+		if (ret == 1) {
+			seq++;
+			continue;
+		}
+		if (ret < 0) {
+			printf("  message %u corrupt\n", seq);
+			s_run.err = 1;
+			return NULL;
+		}
+
+		/* Empty: sleep until the producer rings */
+		s_run.sleeps++;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += DOORBELL_TIMEOUT;
+		do
+			ret = sem_timedwait(&s_run.doorbell, &ts);
+		while ((ret != 0) && (errno == EINTR));
+		if ((ret != 0) && (shm_ring_count(&rx) != 0)) {
+			printf("  doorbell lost at message %u\n", seq);
+			s_run.err = 1;
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+static void test_threads(uint32_t msgs)
+{
+	SHM_RING_T tx, rx;
+	pthread_t tp, tc;
+	struct timespec t0, t1;
+	double dt;
+
+	printf("Producer and consumer threads, %u messages ...\n", msgs);
+	ring_setup(&tx, &rx, 0xFFFFFFFFu - 1000);
+	memset(&s_run, 0, sizeof(s_run));
+	s_run.msgs = msgs;
+	sem_init(&s_run.doorbell, 0, 0);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	pthread_create(&tc, NULL, consumer, NULL);
+	pthread_create(&tp, NULL, producer, NULL);
+	pthread_join(tp, NULL);
+	pthread_join(tc, NULL);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	dt = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+	check(!s_run.err, "stream", 0);
+	check(shm_ring_count(&tx) == 0, "ring empty at the end", shm_ring_count(&tx));
+	sem_destroy(&s_run.doorbell);
+
+	printf("  %.0f messages/s, %lu doorbells (%.3f per message), %lu consumer sleeps, "
+	       "%lu sends on a full ring\n", msgs / dt, s_run.bells,
+	       (double)s_run.bells / msgs, s_run.sleeps, s_run.full);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t msgs = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 2000000;
+
+	printf("Ring of %d slots of %d bytes\n", SHM_RING_SLOTS, (int)SHM_RING_SLOT_SIZE);
+	test_wrap();
+	test_full();
+	test_doorbell();
+	test_threads(msgs);
+
+	printf(s_fail ? "FAILED (%d failures)\n" : "PASSED (%d failures)\n", s_fail);
+	return s_fail ? 1 : 0;
+}
@@ -0,0 +1,103 @@
+/****************************************************************************
+ * @file     shm_ring.c
+ *
+ * @brief    Lock-free shared memory message ring.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+
+#include "NuMicro.h"
+#include "shm_ring.h"
+
+/* The A35 goes through the non-cacheable alias, the M4 has no data cache */
+#if defined(__aarch64__)
+#define SHM_RING_VA(phys)       ((void *)((uint64_t)(phys) | NON_CACHE))
+#else
+#define SHM_RING_VA(phys)       ((void *)(uintptr_t)(phys))
+#endif
+
+void shm_ring_init(SHM_RING_T *ring, uint32_t u32Phys)
+{
+    ring->u32Phys = u32Phys;
+    ring->ctrl = (SHM_RING_CTRL_T *)SHM_RING_VA(u32Phys);
+    ring->pu8Slot = (uint8_t *)SHM_RING_VA(u32Phys + SHM_RING_HDR_SIZE);
+}
+
+void shm_ring_reset(SHM_RING_T *ring)
+{
+    ring->ctrl->u32Head = 0;
+    ring->ctrl->u32Tail = 0;
+    ring->u32Idx = 0;
+    __DMB();
+}
+
+void *shm_ring_alloc(SHM_RING_T *ring)
+{
+    ring->u32Idx = ring->ctrl->u32Head;
+
+    if ((ring->u32Idx - ring->ctrl->u32Tail) >= SHM_RING_SLOTS)
+        return NULL;
+
+    /* The consumer is done with the slot before tail moves past it */
+    __DMB();
+
+    return ring->pu8Slot + (ring->u32Idx % SHM_RING_SLOTS) * SHM_RING_SLOT_SIZE;
+}
+
+int shm_ring_publish(SHM_RING_T *ring, uint32_t u32Len)
+{
+    uint32_t u32Head = ring->u32Idx;
+
+    ring->ctrl->au32Len[u32Head % SHM_RING_SLOTS] = u32Len;
+
+    /* Slot and descriptor are visible before the new head */
+    __DMB();
+    ring->ctrl->u32Head = u32Head + 1;
+
+    /*
+     * Store head, then load tail: either the consumer still sees the new
+     * head after releasing its last message, or this load sees the ring
+     * it had emptied and the consumer gets a doorbell.
+     */
+    __DMB();
+
+    return (ring->ctrl->u32Tail == u32Head);
+}
+
+void *shm_ring_peek(SHM_RING_T *ring, uint32_t *pu32Len)
+{
+    uint32_t u32Tail = ring->ctrl->u32Tail;
+
+    ring->u32Idx = u32Tail;
+    if (ring->ctrl->u32Head == u32Tail)
+        return NULL;
+
+    /* Slot and descriptor are read after the head that published them */
+    __DMB();
+
+    *pu32Len = ring->ctrl->au32Len[u32Tail % SHM_RING_SLOTS];
+    if (*pu32Len > SHM_RING_SLOT_SIZE)
+        *pu32Len = SHM_RING_SLOT_SIZE;
+
+    return ring->pu8Slot + (u32Tail % SHM_RING_SLOTS) * SHM_RING_SLOT_SIZE;
+}
+
+uint32_t shm_ring_peek_phys(SHM_RING_T *ring)
+{
+    return ring->u32Phys + SHM_RING_HDR_SIZE + (ring->u32Idx % SHM_RING_SLOTS) * SHM_RING_SLOT_SIZE;
+}
+
+void shm_ring_release(SHM_RING_T *ring)
+{
+    /* Reads of the slot complete before it is handed back */
+    __DMB();
+    ring->ctrl->u32Tail = ring->u32Idx + 1;
+
+    /* Pairs with the barrier after the head store in shm_ring_publish() */
+    __DMB();
+}
+
+uint32_t shm_ring_count(SHM_RING_T *ring)
+{
+    return ring->ctrl->u32Head - ring->ctrl->u32Tail;
+}
@@ -0,0 +1,94 @@
+/****************************************************************************
+ * @file     shm_ring.h
+ *
+ * @brief    Lock-free single producer / single consumer message ring in
+ *           shared memory, one per direction between A35 and RTP M4.
+ *
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+ *****************************************************************************/
+#ifndef __SHM_RING_H__
+#define __SHM_RING_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include "openamp/open_amp.h"
+#include "openamp_conf.h"
+
+/*
+ * Ring layout, at SHM_RING_TX_ADDRESS / SHM_RING_RX_ADDRESS:
+ *
+ *   +0                   head, written by the producer only
+ *   +SHM_RING_LINE       tail, written by the consumer only
+ *   +2*SHM_RING_LINE     descriptors: message length of every slot
+ *   +SHM_RING_HDR_SIZE   SHM_RING_SLOTS slots of SHM_RING_SLOT_SIZE bytes
+ *
+ * head and tail are free running message counters, the slot of message n
+ * is n % SHM_RING_SLOTS. They sit on cache lines of their own so each side
+ * only ever writes lines the other side reads.
+ *
+ * The producer fills the slot and its descriptor, then publishes head; the
+ * consumer reads the slot and then publishes tail. A doorbell is only due
+ * when the producer finds the consumer caught up with the message it just
+ * published, that is on the empty to non-empty transition; while messages
+ * are queued the consumer keeps draining without further mailbox traffic.
+ */
+
+#define SHM_RING_LINE           64
+#define SHM_RING_DESC_SIZE      (((SHM_RING_SLOTS * 4) + SHM_RING_LINE - 1) & ~(SHM_RING_LINE - 1))
+#define SHM_RING_HDR_SIZE       (2 * SHM_RING_LINE + SHM_RING_DESC_SIZE)
+#define SHM_RING_SLOT_SIZE      (((SHM_RING_SIZE - SHM_RING_HDR_SIZE) / SHM_RING_SLOTS) & ~(SHM_RING_LINE - 1))
+
+#if (SHM_RING_SLOTS & (SHM_RING_SLOTS - 1)) != 0
+#error "SHM_RING_SLOTS must be a power of 2"
+#endif
+
+typedef struct
+{
+    volatile uint32_t u32Head;
+    uint8_t  au8Pad0[SHM_RING_LINE - 4];
+    volatile uint32_t u32Tail;
+    uint8_t  au8Pad1[SHM_RING_LINE - 4];
+    volatile uint32_t au32Len[SHM_RING_DESC_SIZE / 4];
+} SHM_RING_CTRL_T;
+
+/* Local view of one ring, not shared */
+typedef struct
+{
+    SHM_RING_CTRL_T *ctrl;          /* control block, non-cacheable alias */
+    uint8_t  *pu8Slot;              /* first slot, non-cacheable alias */
+    uint32_t u32Phys;               /* physical address of the ring */
+    uint32_t u32Idx;                /* own index: head of a producer, tail of a consumer */
+} SHM_RING_T;
+
+/* Attach to the ring at u32Phys, picking up its current indices */
+void shm_ring_init(SHM_RING_T *ring, uint32_t u32Phys);
+
+/* Empty the ring, by the side that sets the rings up before they are used */
+void shm_ring_reset(SHM_RING_T *ring);
+
+/* Producer: next free slot, NULL when the ring is full */
+void *shm_ring_alloc(SHM_RING_T *ring);
+
+/* Producer: publish u32Len bytes in the allocated slot, returns 1 if a doorbell is due */
+int shm_ring_publish(SHM_RING_T *ring, uint32_t u32Len);
+
+/* Consumer: oldest message and its length, NULL when the ring is empty */
+void *shm_ring_peek(SHM_RING_T *ring, uint32_t *pu32Len);
+
+/* Consumer: physical address of the slot returned by shm_ring_peek() */
+uint32_t shm_ring_peek_phys(SHM_RING_T *ring);
+
+/* Consumer: hand the slot returned by shm_ring_peek() back to the producer */
+void shm_ring_release(SHM_RING_T *ring);
+
+/* Messages published and not consumed yet */
+uint32_t shm_ring_count(SHM_RING_T *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SHM_RING_H__ */
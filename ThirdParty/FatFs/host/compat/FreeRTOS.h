@@ -0,0 +1,33 @@
+/**************************************************************************//**
+ * @file     FreeRTOS.h
+ *
+ * @brief    Host stand-in for the FreeRTOS kernel pieces the FatFs
+ *           re-entrant profile uses, on POSIX threads.
+ *
+ * Only what ffconf.h and ffsystem.c use with FF_NVT_FREERTOS = 1 is
+ * provided: ticks are milliseconds, mutexes are pthread mutexes, the
+ * heap is the C library heap and a suspended scheduler is a mutex that
+ * every caller of vTaskSuspendAll() takes.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __HOST_FREERTOS_H__
+#define __HOST_FREERTOS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define pdFALSE			((BaseType_t)0)
+#define pdTRUE			((BaseType_t)1)
+#define pdMS_TO_TICKS(ms)	((TickType_t)(ms))
+#define portMAX_DELAY		((TickType_t)0xffffffffUL)
+
+void *pvPortMalloc(size_t size);
+void vPortFree(void *pv);
+
+#endif /* __HOST_FREERTOS_H__ */
@@ -0,0 +1,83 @@
+/**************************************************************************//**
+ * @file     freertos_host.c
+ *
+ * @brief    Host stand-in for the FreeRTOS kernel pieces the FatFs
+ *           re-entrant profile uses, on POSIX threads.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+struct host_mutex {
+	pthread_mutex_t m;
+};
+
+static pthread_mutex_t s_sched = PTHREAD_MUTEX_INITIALIZER;
+
+void *pvPortMalloc(size_t size)
+{
+	return malloc(size);
+}
+
+void vPortFree(void *pv)
+{
+	free(pv);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+	SemaphoreHandle_t sem = malloc(sizeof(*sem));
+
+	if (sem && pthread_mutex_init(&sem->m, NULL) != 0) {
+		free(sem);
+		sem = NULL;
+	}
+	return sem;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+	pthread_mutex_destroy(&sem->m);
+	free(sem);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+	struct timespec ts;
+
+	if (ticks == portMAX_DELAY)
+		return pthread_mutex_lock(&sem->m) == 0 ? pdTRUE : pdFALSE;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += ticks / 1000;
+	ts.tv_nsec += (long)(ticks % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	return pthread_mutex_timedlock(&sem->m, &ts) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+	return pthread_mutex_unlock(&sem->m) == 0 ? pdTRUE : pdFALSE;
+}
+
+void vTaskSuspendAll(void)
+{
+	pthread_mutex_lock(&s_sched);
+}
+
+BaseType_t xTaskResumeAll(void)
+{
+	pthread_mutex_unlock(&s_sched);
+	return pdFALSE;
+}
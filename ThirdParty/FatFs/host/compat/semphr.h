@@ -0,0 +1,22 @@
+/**************************************************************************//**
+ * @file     semphr.h
+ *
+ * @brief    Host stand-in for the FreeRTOS mutex API, on POSIX threads.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __HOST_SEMPHR_H__
+#define __HOST_SEMPHR_H__
+
+#include "FreeRTOS.h"
+
+typedef struct host_mutex *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+/* pdTRUE, or pdFALSE after ticks milliseconds */
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+
+#endif /* __HOST_SEMPHR_H__ */
@@ -0,0 +1,21 @@
+/**************************************************************************//**
+ * @file     task.h
+ *
+ * @brief    Host stand-in for the FreeRTOS scheduler suspension, on POSIX
+ *           threads.
+ *
+ * A suspended scheduler keeps every other task out; here it only keeps
+ * out the other threads that suspend it, which is what FatFs relies on.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __HOST_TASK_H__
+#define __HOST_TASK_H__
+
+#include "FreeRTOS.h"
+
+void vTaskSuspendAll(void);
+BaseType_t xTaskResumeAll(void);
+
+#endif /* __HOST_TASK_H__ */
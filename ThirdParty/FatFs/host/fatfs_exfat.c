@@ -0,0 +1,347 @@
+/**************************************************************************//**
+ * @file     fatfs_exfat.c
+ *
+ * @brief    Test of the exFAT/LFN build profile (FF_NVT_EXFAT_LFN) and of the
+ *           directory index on a RAM disk, with a name lookup benchmark, for
+ *           the host build.
+ *
+ * The volume is formatted exFAT with 4 KB clusters so that directories
+ * outgrow their first cluster after a few dozen long names. Sub-directories
+ * are created in a stretched directory and in directories whose clusters
+ * interleave with those of another one, then everything is removed again.
+ * After every step the volume is remounted and walked: each file is read
+ * back and the free cluster count must match what the files hold.
+ *
+ * The benchmark looks names up with f_stat() in a directory of
+ * BENCH_FILES entries, in the build it was compiled with; comparing the
+ * two builds of the Makefile shows what the index saves.
+ *
+ * Run: ./fatfs_exfat [lookups]
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ff.h"
+#include "ramdisk.h"
+
+#define AU			4096
+#define MANY_FILES		300
+#define BENCH_FILES		2000
+
+static FATFS s_fs;
+static BYTE s_work[64 * 1024];
+static DWORD s_sys;		/* Clusters of the bitmap, up-case table and root directory */
+static int s_fail;
+
+#define CHECK(cond, ...) do { \
+	if (!(cond)) { \
+		printf("  FAILED line %d: ", __LINE__); \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		s_fail = 1; \
+	} \
+} while (0)
+
+static unsigned char pattern(const char *name, unsigned int i)
+{
+	unsigned int h = 0;
+
+	while (*name)
+		h = h * 31 + (unsigned char)*name++;
+	return (unsigned char)(h + i * 7);
+}
+
+/* A file whose content follows from its name, len bytes */
+static FRESULT make_file(const char *name, unsigned int len)
+{
+	unsigned char buf[512];
+	FIL fil;
+	FRESULT res;
+	UINT bw, off, n, i;
+
+	res = f_open(&fil, name, FA_WRITE | FA_CREATE_NEW);
+	if (res != FR_OK)
+		return res;
+	for (off = 0; off < len && res == FR_OK; off += n) {
+		n = (len - off < sizeof(buf)) ? len - off : sizeof(buf);
+		for (i = 0; i < n; i++)
+			buf[i] = pattern(name, off + i);
+		res = f_write(&fil, buf, n, &bw);
+		if (res == FR_OK && bw != n)
+			res = FR_DENIED;
+	}
+	if (f_close(&fil) != FR_OK && res == FR_OK)
+		res = FR_INT_ERR;
+	return res;
+}
+
+static FRESULT check_file(const char *name, FSIZE_t len)
+{
+	unsigned char buf[512];
+	FIL fil;
+	FRESULT res;
+	UINT br, i;
+	FSIZE_t off;
+
+	res = f_open(&fil, name, FA_READ);
+	if (res != FR_OK)
+		return res;
+	for (off = 0; off < len && res == FR_OK; off += br) {
+		res = f_read(&fil, buf, sizeof(buf), &br);
+		if (res == FR_OK && br == 0)
+			res = FR_INT_ERR;
+		for (i = 0; res == FR_OK && i < br; i++)
+			if (buf[i] != pattern(name, (unsigned int)(off + i)))
+				res = FR_INT_ERR;
+	}
+	if (f_close(&fil) != FR_OK && res == FR_OK)
+		res = FR_INT_ERR;
+	return res;
+}
+
+/* Read back every file under path, count the clusters the tree takes */
+static FRESULT walk(char *path, DWORD *clusters)
+{
+	FILINFO fno;
+	DIR dir;
+	FRESULT res;
+	size_t len = strlen(path);
+	DWORD entries = 0;
+
+	res = f_opendir(&dir, path);
+	while (res == FR_OK) {
+		res = f_readdir(&dir, &fno);
+		if (res != FR_OK || fno.fname[0] == 0)
+			break;
+		entries += 2 + (DWORD)(strlen(fno.fname) + 14) / 15;	/* File, stream and name entries */
+		sprintf(path + len, "/%s", fno.fname);
+		if (fno.fattrib & AM_DIR) {
+			res = walk(path, clusters);
+		} else {
+			*clusters += (DWORD)((fno.fsize + AU - 1) / AU);
+			res = check_file(path, fno.fsize);
+			if (res != FR_OK)
+				printf("  %s: %d\n", path, res);
+		}
+		path[len] = 0;
+	}
+	f_closedir(&dir);
+
+	/* A sub-directory takes at least one cluster of 32 byte entries */
+	if (len > 2)
+		*clusters += (entries > 0) ? (entries * 32 + AU - 1) / AU : 1;
+	return res;
+}
+
+/* Remount and walk the volume, the free count must cover what the files leave */
+static void verify(const char *step, DWORD dir_slack)
+{
+	char path[300] = "0:";
+	DWORD used = 0, nfree, total;
+	FATFS *fs;
+	FRESULT res;
+
+	res = f_mount(NULL, "0:", 0);
+	if (res == FR_OK)
+		res = f_mount(&s_fs, "0:", 1);
+	CHECK(res == FR_OK, "%s: remount %d", step, res);
+	if (res != FR_OK)
+		return;
+
+	res = walk(path, &used);
+	CHECK(res == FR_OK, "%s: walk %d", step, res);
+
+	res = f_getfree("0:", &nfree, &fs);
+	CHECK(res == FR_OK, "%s: getfree %d", step, res);
+	used += s_sys;
+	total = fs->n_fatent - 2;
+	/* Directories may keep clusters their entries no longer fill */
+	CHECK(total - nfree >= used && total - nfree <= used + dir_slack,
+	      "%s: %lu clusters in use, the tree takes %lu", step,
+	      (unsigned long)(total - nfree), (unsigned long)used);
+}
+
+static void long_name(char *name, const char *dir, unsigned int n)
+{
+	sprintf(name, "%s/a file with a long name number %04u.txt", dir, n);
+}
+
+/* Sub-directory in a directory stretched past its first cluster */
+static void test_stretched(void)
+{
+	char name[300];
+	FRESULT res;
+	unsigned int i;
+
+	res = f_mkdir("0:/d");
+	CHECK(res == FR_OK, "mkdir /d %d", res);
+	for (i = 0; i < MANY_FILES && res == FR_OK; i++) {
+		long_name(name, "0:/d", i);
+		res = make_file(name, 100);
+	}
+	CHECK(res == FR_OK, "create %s %d", name, res);
+	res = f_mkdir("0:/d/sub");
+	CHECK(res == FR_OK, "mkdir /d/sub %d", res);
+	res = make_file("0:/d/sub/x.txt", 5000);
+	CHECK(res == FR_OK, "create /d/sub/x.txt %d", res);
+	verify("stretched", 8);
+
+	res = f_unlink("0:/d/sub/x.txt");
+	CHECK(res == FR_OK, "unlink /d/sub/x.txt %d", res);
+	res = f_unlink("0:/d/sub");
+	CHECK(res == FR_OK, "unlink /d/sub %d", res);
+	for (i = 0; i < MANY_FILES && res == FR_OK; i++) {
+		long_name(name, "0:/d", i);
+		res = f_unlink(name);
+	}
+	CHECK(res == FR_OK, "unlink %s %d", name, res);
+	res = f_unlink("0:/d");
+	CHECK(res == FR_OK, "unlink /d %d", res);
+	verify("stretched, removed", 0);
+}
+
+/* Sub-directories in two directories whose clusters interleave */
+static void test_fragmented(void)
+{
+	char name[300];
+	FRESULT res;
+	unsigned int i;
+
+	res = f_mkdir("0:/a");
+	if (res == FR_OK)
+		res = f_mkdir("0:/b");
+	CHECK(res == FR_OK, "mkdir /a /b %d", res);
+	for (i = 0; i < MANY_FILES && res == FR_OK; i++) {
+		/* Files of a cluster each between the directory clusters */
+		long_name(name, (i & 1) ? "0:/b" : "0:/a", i);
+		res = make_file(name, AU);
+	}
+	CHECK(res == FR_OK, "create %s %d", name, res);
+	res = f_mkdir("0:/a/sub");
+	if (res == FR_OK)
+		res = f_mkdir("0:/b/sub");
+	CHECK(res == FR_OK, "mkdir /a/sub /b/sub %d", res);
+	res = make_file("0:/a/sub/x.txt", 3 * AU + 1);
+	if (res == FR_OK)
+		res = make_file("0:/b/sub/x.txt", 3 * AU + 1);
+	CHECK(res == FR_OK, "create x.txt %d", res);
+	verify("fragmented", 8);
+
+	for (i = 0; i < MANY_FILES && res == FR_OK; i++) {
+		long_name(name, (i & 1) ? "0:/b" : "0:/a", i);
+		res = f_unlink(name);
+	}
+	CHECK(res == FR_OK, "unlink %s %d", name, res);
+	res = f_unlink("0:/a/sub/x.txt");
+	if (res == FR_OK)
+		res = f_unlink("0:/a/sub");
+	if (res == FR_OK)
+		res = f_unlink("0:/b/sub/x.txt");
+	if (res == FR_OK)
+		res = f_unlink("0:/b/sub");
+	CHECK(res == FR_OK, "unlink sub-directories %d", res);
+	res = f_unlink("0:/a");
+	if (res == FR_OK)
+		res = f_unlink("0:/b");
+	CHECK(res == FR_OK, "unlink /a /b %d", res);
+	verify("fragmented, removed", 0);
+}
+
+/* A renamed file is found by its new name only, in the index too */
+static void test_rename(void)
+{
+	FILINFO fno;
+	FRESULT res;
+
+	res = f_mkdir("0:/r");
+	if (res == FR_OK)
+		res = make_file("0:/r/Old Name.txt", 10);
+	CHECK(res == FR_OK, "create /r/Old Name.txt %d", res);
+	CHECK(f_stat("0:/r/old name.TXT", &fno) == FR_OK, "case insensitive lookup");
+	res = f_rename("0:/r/Old Name.txt", "0:/r/New Name.txt");
+	CHECK(res == FR_OK, "rename %d", res);
+	CHECK(f_stat("0:/r/Old Name.txt", &fno) == FR_NO_FILE, "old name still found");
+	CHECK(f_stat("0:/r/New Name.txt", &fno) == FR_OK, "new name not found");
+	f_unlink("0:/r/New Name.txt");
+	f_unlink("0:/r");
+	verify("rename", 0);
+}
+
+/* f_stat() of names spread over a large directory */
+static void bench_lookup(unsigned int lookups)
+{
+	char name[300];
+	struct timespec t0, t1;
+	unsigned long reads;
+	FILINFO fno;
+	FRESULT res = FR_OK;
+	unsigned int i;
+	double us;
+
+	f_mkdir("0:/bench");
+	for (i = 0; i < BENCH_FILES && res == FR_OK; i++) {
+		long_name(name, "0:/bench", i);
+		res = make_file(name, 0);
+	}
+	CHECK(res == FR_OK, "create %s %d", name, res);
+
+	/* Start cold: the index, if any, is built by the first lookup */
+	f_mount(NULL, "0:", 0);
+	f_mount(&s_fs, "0:", 1);
+
+	reads = ramdisk_reads(0);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 0; i < lookups && res == FR_OK; i++) {
+		long_name(name, "0:/bench", (i * 7919) % BENCH_FILES);
+		res = f_stat(name, &fno);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	reads = ramdisk_reads(0) - reads;
+	CHECK(res == FR_OK, "lookup %s %d", name, res);
+
+	us = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3;
+	printf("  index %s: %u lookups in %u entries, %.1f us and %.1f sectors read per lookup\n",
+	       FF_USE_DIRINDEX ? "on " : "off", lookups, BENCH_FILES, us / lookups, (double)reads / lookups);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int lookups = (argc > 1) ? (unsigned int)atoi(argv[1]) : 2000;
+	DWORD nfree;
+	FATFS *fs;
+	FRESULT res;
+
+	if (ramdisk_create(0)) {
+		fprintf(stderr, "no memory for the RAM disk\n");
+		return 2;
+	}
+	res = f_mkfs("0:", FM_EXFAT | FM_SFD, AU, s_work, sizeof(s_work));
+	if (res == FR_OK)
+		res = f_mount(&s_fs, "0:", 1);
+	if (res != FR_OK || s_fs.fs_type != FS_EXFAT) {
+		fprintf(stderr, "cannot format the RAM disk exFAT: %d\n", res);
+		return 2;
+	}
+	f_getfree("0:", &nfree, &fs);
+	s_sys = fs->n_fatent - 2 - nfree;
+
+	printf("stretched directory\n");
+	test_stretched();
+	printf("fragmented directory\n");
+	test_fragmented();
+	printf("rename\n");
+	test_rename();
+	printf("lookup benchmark\n");
+	bench_lookup(lookups);
+
+	f_mount(NULL, "0:", 0);
+	ramdisk_destroy(0);
+
+	printf("%s\n", s_fail ? "FAIL" : "PASS");
+	return s_fail;
+}
@@ -0,0 +1,325 @@
+/**************************************************************************//**
+ * @file     fatfs_stress.c
+ *
+ * @brief    Concurrency test of the re-entrant FatFs build (FF_NVT_FREERTOS)
+ *           on two RAM disk volumes, for the host build.
+ *
+ * Threads stand for tasks. Two of them mount the volumes at the same
+ * moment and create one shared file on each. Then all of them open,
+ * write, read back and close files of their own on both volumes while
+ * reading the shared files, which one of them at a time may open for
+ * writing. The file lock table is shared
+ * by all volumes, so every open and close goes through its mutex.
+ *
+ * Last, every thread keeps HOLD_FILES files open on both volumes at once,
+ * more than the table has entries for: an open that finds it full fails
+ * with FR_TOO_MANY_OPEN_FILES, never with FR_INT_ERR, whichever volume
+ * took the last entry.
+ *
+ * Run: ./fatfs_stress [threads] [iterations]
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ff.h"
+#include "ramdisk.h"
+
+#define MAX_THREADS		16
+#define FILE_BYTES		6000		/* not a whole number of sectors or clusters */
+#define SHARED_BYTES		4096
+#define HOLD_FILES		3		/* per thread, so 8 threads overflow FF_FS_LOCK */
+#define HOLD_BYTES		1500
+
+struct worker {
+	pthread_t tid;
+	unsigned int id;
+	unsigned int iters;
+	unsigned int locked;		/* shared file opens rejected by the lock table */
+	unsigned int full;		/* opens that found the lock table full */
+	int err;
+};
+
+static FATFS s_fs[RAMDISK_NUM];
+static pthread_barrier_t s_start;
+static unsigned int s_mount_fail;
+static pthread_mutex_t s_stat = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned char pattern(unsigned int seed, unsigned int i)
+{
+	return (unsigned char)(seed * 131 + i * 7 + (i >> 8));
+}
+
+static void fill(unsigned char *buf, unsigned int len, unsigned int seed)
+{
+	unsigned int i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = pattern(seed, i);
+}
+
+static int check(const unsigned char *buf, unsigned int len, unsigned int seed)
+{
+	unsigned int i;
+
+	for (i = 0; i < len; i++)
+		if (buf[i] != pattern(seed, i))
+			return -1;
+	return 0;
+}
+
+static void shared_name(char *name, unsigned int vol)
+{
+	sprintf(name, "%u:SHARED.BIN", vol);
+}
+
+static FRESULT write_file(const char *name, unsigned int len, unsigned int seed, BYTE mode)
+{
+	unsigned char buf[FILE_BYTES];
+	FIL fil;
+	FRESULT res;
+	UINT bw, off, n;
+
+	fill(buf, len, seed);
+	res = f_open(&fil, name, mode);
+	if (res != FR_OK)
+		return res;
+	/* Odd sized writes cross sector boundaries inside FatFs */
+	for (off = 0; off < len && res == FR_OK; off += n) {
+		n = (len - off < 1000) ? len - off : 1000;
+		res = f_write(&fil, buf + off, n, &bw);
+		if (res == FR_OK && bw != n)
+			res = FR_DENIED;
+	}
+	if (f_close(&fil) != FR_OK && res == FR_OK)
+		res = FR_INT_ERR;
+	return res;
+}
+
+static FRESULT read_file(const char *name, unsigned int len, unsigned int seed)
+{
+	unsigned char buf[FILE_BYTES];
+	FIL fil;
+	FRESULT res;
+	UINT br, off, n;
+
+	res = f_open(&fil, name, FA_READ);
+	if (res != FR_OK)
+		return res;
+	if (f_size(&fil) != len)
+		res = FR_INT_ERR;
+	for (off = 0; off < len && res == FR_OK; off += n) {
+		n = (len - off < 700) ? len - off : 700;
+		res = f_read(&fil, buf + off, n, &br);
+		if (res == FR_OK && br != n)
+			res = FR_INT_ERR;
+	}
+	if (f_close(&fil) != FR_OK && res == FR_OK)
+		res = FR_INT_ERR;
+	if (res == FR_OK && check(buf, len, seed))
+		res = FR_INT_ERR;
+	return res;
+}
+
+/*
+ * Create and write HOLD_FILES files of the thread, alternating volumes,
+ * keeping all of them open until the last one is written. Creating a
+ * file truncates it, disk I/O between the lock table check and the
+ * registration of the file.
+ */
+static FRESULT hold_files(struct worker *w, unsigned int i)
+{
+	unsigned char buf[HOLD_BYTES];
+	FIL fil[HOLD_FILES];
+	char name[32];
+	unsigned int k, n;
+	FRESULT res = FR_OK;
+	UINT bw;
+
+	fill(buf, HOLD_BYTES, w->id + i);
+	for (n = 0; n < HOLD_FILES; n++) {
+		sprintf(name, "%u:H%02u%u.BIN", (w->id + i + n) % RAMDISK_NUM, w->id, n);
+		res = f_open(&fil[n], name, FA_WRITE | FA_CREATE_ALWAYS);
+		if (res != FR_OK)
+			break;
+		res = f_write(&fil[n], buf, HOLD_BYTES, &bw);
+		if (res == FR_OK && bw != HOLD_BYTES)
+			res = FR_DENIED;
+		if (res != FR_OK) {
+			n++;
+			break;
+		}
+	}
+	for (k = 0; k < n; k++) {
+		if (f_close(&fil[k]) != FR_OK && res == FR_OK)
+			res = FR_INT_ERR;
+	}
+	return res;
+}
+
+static void *worker(void *arg)
+{
+	struct worker *w = arg;
+	char name[32];
+	unsigned int i, vol;
+	FRESULT res;
+
+	pthread_barrier_wait(&s_start);
+
+	/*
+	 * The first threads mount one volume each, all at once: the first
+	 * mount of any volume creates the mutex of the lock table. A volume
+	 * is never mounted while it is in use, by FatFs design.
+	 */
+	if (w->id < RAMDISK_NUM) {
+		sprintf(name, "%u:", w->id);
+		res = f_mount(&s_fs[w->id], name, 1);
+		shared_name(name, w->id);
+		if (res == FR_OK)
+			res = write_file(name, SHARED_BYTES, w->id, FA_WRITE | FA_CREATE_NEW);
+		if (res != FR_OK) {
+			pthread_mutex_lock(&s_stat);
+			s_mount_fail++;
+			pthread_mutex_unlock(&s_stat);
+		}
+	}
+	pthread_barrier_wait(&s_start);
+
+	for (i = 0; i < w->iters; i++) {
+		vol = (w->id + i) % RAMDISK_NUM;
+
+		sprintf(name, "%u:T%02u.BIN", vol, w->id);
+		res = write_file(name, FILE_BYTES - w->id, w->id + i, FA_WRITE | FA_CREATE_ALWAYS);
+		if (res == FR_OK)
+			res = read_file(name, FILE_BYTES - w->id, w->id + i);
+		if (res != FR_OK) {
+			fprintf(stderr, "thread %u iteration %u: %s: %d\n", w->id, i, name, res);
+			w->err = 1;
+			break;
+		}
+
+		shared_name(name, vol);
+		if ((i % 8) == (w->id % 8)) {
+			/* Same content again; readers only ever see it whole */
+			res = write_file(name, SHARED_BYTES, vol, FA_WRITE | FA_OPEN_EXISTING);
+		} else {
+			res = read_file(name, SHARED_BYTES, vol);
+		}
+		if (res == FR_LOCKED) {
+			w->locked++;
+		} else if (res != FR_OK) {
+			fprintf(stderr, "thread %u iteration %u: %s: %d\n", w->id, i, name, res);
+			w->err = 1;
+			break;
+		}
+	}
+
+	pthread_barrier_wait(&s_start);
+	for (i = 0; i < w->iters && !w->err; i++) {
+		res = hold_files(w, i);
+		if (res == FR_TOO_MANY_OPEN_FILES) {
+			w->full++;
+		} else if (res != FR_OK) {
+			fprintf(stderr, "thread %u holding files, iteration %u: %d\n", w->id, i, res);
+			w->err = 1;
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	struct worker w[MAX_THREADS];
+	unsigned int nthreads = (argc > 1) ? (unsigned int)atoi(argv[1]) : 8;
+	unsigned int iters = (argc > 2) ? (unsigned int)atoi(argv[2]) : 400;
+	unsigned int i, vol, locked = 0, full = 0;
+	char name[32];
+	int err = 0;
+	FIL fil;
+
+	if (nthreads < RAMDISK_NUM || nthreads > MAX_THREADS) {
+		fprintf(stderr, "threads must be %d to %d\n", RAMDISK_NUM, MAX_THREADS);
+		return 2;
+	}
+
+	for (vol = 0; vol < RAMDISK_NUM; vol++) {
+		if (ramdisk_create(vol)) {
+			fprintf(stderr, "no memory for RAM disk %u\n", vol);
+			return 2;
+		}
+	}
+
+	pthread_barrier_init(&s_start, NULL, nthreads);
+	for (i = 0; i < nthreads; i++) {
+		w[i].id = i;
+		w[i].iters = iters;
+		w[i].locked = 0;
+		w[i].full = 0;
+		w[i].err = 0;
+		pthread_create(&w[i].tid, NULL, worker, &w[i]);
+	}
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(w[i].tid, NULL);
+		err |= w[i].err;
+		locked += w[i].locked;
+		full += w[i].full;
+	}
+	pthread_barrier_destroy(&s_start);
+
+	if (s_mount_fail) {
+		fprintf(stderr, "%u of the concurrent mounts failed\n", s_mount_fail);
+		err = 1;
+	}
+
+	/* No lock table entry is left behind: exclusive opens succeed */
+	for (vol = 0; vol < RAMDISK_NUM && !err; vol++) {
+		shared_name(name, vol);
+		if (f_open(&fil, name, FA_WRITE | FA_OPEN_EXISTING) != FR_OK || f_close(&fil) != FR_OK) {
+			fprintf(stderr, "%s stays locked\n", name);
+			err = 1;
+		}
+	}
+
+	/* Everything is on the media: remount and read it all back */
+	for (vol = 0; vol < RAMDISK_NUM && !err; vol++) {
+		sprintf(name, "%u:", vol);
+		if (f_mount(NULL, name, 0) != FR_OK || f_mount(&s_fs[vol], name, 1) != FR_OK) {
+			fprintf(stderr, "cannot remount %s\n", name);
+			err = 1;
+		}
+	}
+	for (i = 0; i < nthreads && !err; i++) {
+		/* The last iteration of thread i wrote volume (i + iters - 1) */
+		vol = (i + iters - 1) % RAMDISK_NUM;
+		sprintf(name, "%u:T%02u.BIN", vol, i);
+		if (read_file(name, FILE_BYTES - i, i + iters - 1) != FR_OK) {
+			fprintf(stderr, "%s is corrupt after remount\n", name);
+			err = 1;
+		}
+	}
+	for (vol = 0; vol < RAMDISK_NUM && !err; vol++) {
+		shared_name(name, vol);
+		if (read_file(name, SHARED_BYTES, vol) != FR_OK) {
+			fprintf(stderr, "%s is corrupt after remount\n", name);
+			err = 1;
+		}
+	}
+
+	printf("%u threads x %u iterations on %d volumes, %u shared opens locked out, "
+	       "%u opens found the lock table full, %lu/%lu sectors read, %lu/%lu written\n",
+	       nthreads, iters, RAMDISK_NUM, locked, full,
+	       ramdisk_reads(0), ramdisk_reads(1), ramdisk_writes(0), ramdisk_writes(1));
+
+	for (vol = 0; vol < RAMDISK_NUM; vol++) {
+		sprintf(name, "%u:", vol);
+		f_mount(NULL, name, 0);
+		ramdisk_destroy(vol);
+	}
+
+	printf("%s\n", err ? "FAIL" : "PASS");
+	return err;
+}
@@ -0,0 +1,175 @@
+/**************************************************************************//**
+ * @file     ramdisk.c
+ *
+ * @brief    RAM disks behind the FatFs disk I/O interface, for the host
+ *           build.
+ *
+ * Every drive holds one FAT16 volume without a partition table, written
+ * here because the BSP configuration leaves f_mkfs() out. Accesses yield
+ * the CPU now and then so that threads interleave inside FatFs as tasks
+ * do on the target.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "ramdisk.h"
+
+#define SS			512
+#define SPC			4		/* sectors per cluster */
+#define RSVD			1
+#define NFATS			2
+#define ROOT_ENTS		512
+#define ROOT_SECS		(ROOT_ENTS * 32 / SS)
+
+struct ramdisk {
+	unsigned char *data;
+	unsigned long reads;
+	unsigned long writes;
+};
+
+static struct ramdisk s_disk[RAMDISK_NUM];
+
+static void st16(unsigned char *p, unsigned int v)
+{
+	p[0] = (unsigned char)v;
+	p[1] = (unsigned char)(v >> 8);
+}
+
+static void st32(unsigned char *p, unsigned long v)
+{
+	st16(p, v & 0xffff);
+	st16(p + 2, (v >> 16) & 0xffff);
+}
+
+int ramdisk_create(unsigned int pdrv)
+{
+	unsigned char *bs;
+	unsigned int fatsz, i;
+
+	if (pdrv >= RAMDISK_NUM)
+		return -1;
+	s_disk[pdrv].data = calloc(RAMDISK_SECTORS, SS);
+	if (!s_disk[pdrv].data)
+		return -1;
+	s_disk[pdrv].reads = s_disk[pdrv].writes = 0;
+
+	/* FAT size from the data area, as the FAT specification computes it */
+	fatsz = (RAMDISK_SECTORS - RSVD - ROOT_SECS + 256 * SPC + NFATS - 1) / (256 * SPC + NFATS);
+
+	bs = s_disk[pdrv].data;
+	memcpy(bs, "\xEB\x3C\x90" "MSDOS5.0", 11);
+	st16(bs + 11, SS);
+	bs[13] = SPC;
+	st16(bs + 14, RSVD);
+	bs[16] = NFATS;
+	st16(bs + 17, ROOT_ENTS);
+	st16(bs + 19, RAMDISK_SECTORS);
+	bs[21] = 0xF8;			/* fixed media */
+	st16(bs + 22, fatsz);
+	st16(bs + 24, 63);
+	st16(bs + 26, 255);
+	st32(bs + 28, 0);
+	st32(bs + 32, 0);
+	bs[36] = 0x80;
+	bs[38] = 0x29;
+	st32(bs + 39, 0x12345678 + pdrv);
+	memcpy(bs + 43, "NO NAME    FAT16   ", 19);
+	st16(bs + 510, 0xAA55);
+
+	for (i = 0; i < NFATS; i++) {
+		unsigned char *fat = s_disk[pdrv].data + (RSVD + i * fatsz) * SS;
+
+		st16(fat, 0xFFF8);
+		st16(fat + 2, 0xFFFF);
+	}
+	return 0;
+}
+
+void ramdisk_destroy(unsigned int pdrv)
+{
+	free(s_disk[pdrv].data);
+	s_disk[pdrv].data = NULL;
+}
+
+unsigned long ramdisk_reads(unsigned int pdrv)
+{
+	return s_disk[pdrv].reads;
+}
+
+unsigned long ramdisk_writes(unsigned int pdrv)
+{
+	return s_disk[pdrv].writes;
+}
+
+static void maybe_yield(void)
+{
+	static __thread unsigned int n;
+
+	if ((++n & 7) == 0)
+		sched_yield();
+}
+
+DSTATUS disk_initialize(BYTE pdrv)
+{
+	return disk_status(pdrv);
+}
+
+DSTATUS disk_status(BYTE pdrv)
+{
+	return (pdrv < RAMDISK_NUM && s_disk[pdrv].data) ? 0 : STA_NOINIT | STA_NODISK;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+	if (disk_status(pdrv) || sector + count > RAMDISK_SECTORS)
+		return RES_PARERR;
+	maybe_yield();
+	memcpy(buff, s_disk[pdrv].data + (size_t)sector * SS, (size_t)count * SS);
+	s_disk[pdrv].reads += count;
+	return RES_OK;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+	if (disk_status(pdrv) || sector + count > RAMDISK_SECTORS)
+		return RES_PARERR;
+	maybe_yield();
+	memcpy(s_disk[pdrv].data + (size_t)sector * SS, buff, (size_t)count * SS);
+	s_disk[pdrv].writes += count;
+	return RES_OK;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
+{
+	if (disk_status(pdrv))
+		return RES_NOTRDY;
+
+	switch (cmd) {
+	case CTRL_SYNC:
+		return RES_OK;
+	case GET_SECTOR_COUNT:
+		*(DWORD *)buff = RAMDISK_SECTORS;
+		return RES_OK;
+	case GET_SECTOR_SIZE:
+		*(WORD *)buff = SS;
+		return RES_OK;
+	case GET_BLOCK_SIZE:
+		*(DWORD *)buff = 1;
+		return RES_OK;
+	default:
+		return RES_PARERR;
+	}
+}
+
+DWORD get_fattime(void)
+{
+	/* 2023-01-01 00:00:00, the clock is not under test */
+	return ((DWORD)(2023 - 1980) << 25) | (1UL << 21) | (1UL << 16);
+}
@@ -0,0 +1,24 @@
+/**************************************************************************//**
+ * @file     ramdisk.h
+ *
+ * @brief    RAM disks behind the FatFs disk I/O interface, for the host
+ *           build.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __RAMDISK_H__
+#define __RAMDISK_H__
+
+#define RAMDISK_NUM		2
+#define RAMDISK_SECTORS		32768		/* 16 MiB of 512-byte sectors, FAT16 */
+
+/* Allocate and format physical drive pdrv with an empty FAT16 volume, 0 on success */
+int ramdisk_create(unsigned int pdrv);
+void ramdisk_destroy(unsigned int pdrv);
+
+/* Sectors read and written since creation */
+unsigned long ramdisk_reads(unsigned int pdrv);
+unsigned long ramdisk_writes(unsigned int pdrv);
+
+#endif /* __RAMDISK_H__ */
@@ -257,6 +257,19 @@ typedef struct {
 #endif
 
 
+/* Directory index */
+#if FF_USE_DIRINDEX
+#if !FF_USE_LFN
+#error LFN must be enabled when enable directory index
+#endif
+#if FF_DIRINDEX_NUM < 1
+#error Wrong setting of FF_DIRINDEX_NUM
+#endif
+#define DIX_EMPTY	0xFFFFFFFF	/* Unused pair in the hash table (no valid offset) */
+#define DIX_MINSZ	64			/* Initial number of pairs in the hash table */
+#endif
+
+
 /* SBCS up-case tables (\x80-\xFF) */
 #define TBL_CT437  {0x80,0x9A,0x45,0x41,0x8E,0x41,0x8F,0x80,0x45,0x45,0x45,0x49,0x49,0x49,0x8E,0x8F, \
 					0x90,0x92,0x92,0x4F,0x99,0x4F,0x55,0x55,0x59,0x99,0x9A,0x9B,0x9C,0x9D,0x9E,0x9F, \
@@ -435,6 +448,9 @@ static BYTE CurrVol;				/* Current drive */
 
 #if FF_FS_LOCK != 0
 static FILESEM Files[FF_FS_LOCK];	/* Open object lock semaphores */
+#if FF_FS_REENTRANT
+static FF_SYNC_t FilesSobj;			/* Sync object to guard Files[] shared by all volumes */
+#endif
 #endif
 
 
@@ -913,6 +929,21 @@ void unlock_fs (
 /*-----------------------------------------------------------------------*/
 /* File lock control functions                                           */
 /*-----------------------------------------------------------------------*/
+/* Files[] is shared by all volumes while the volume lock only excludes the
+/  access to the same volume. At the re-entrant configuration, every access
+/  to Files[], and to the mount ID counter Fsid, is done under FilesSobj.
+/  chk_lock(), enq_lock() and inc_lock() are called with FilesSobj held, so
+/  that f_open() keeps the entry it checked until it registers the file: a
+/  file opened on another volume in between could take the last entry.
+*/
+
+#if FF_FS_REENTRANT
+#define LOCK_FILES()	ff_req_grant(FilesSobj)
+#define UNLOCK_FILES()	ff_rel_grant(FilesSobj)
+#else
+#define LOCK_FILES()	1
+#define UNLOCK_FILES()
+#endif
 
 static
 FRESULT chk_lock (	/* Check if the file can be accessed */
@@ -921,6 +952,8 @@ FRESULT chk_lock (	/* Check if the file can be accessed */
 )
 {
 	UINT i, be;
+	FRESULT res;
+
 
 	/* Search open object table for the object */
 	be = 0;
@@ -934,11 +967,12 @@ FRESULT chk_lock (	/* Check if the file can be accessed */
 		}
 	}
 	if (i == FF_FS_LOCK) {	/* The object has not been opened */
-		return (!be && acc != 2) ? FR_TOO_MANY_OPEN_FILES : FR_OK;	/* Is there a blank entry for new object? */
+		res = (!be && acc != 2) ? FR_TOO_MANY_OPEN_FILES : FR_OK;	/* Is there a blank entry for new object? */
+	} else {
+		/* The object was opened. Reject any open against writing file and all write mode open */
+		res = (acc != 0 || Files[i].ctr == 0x100) ? FR_LOCKED : FR_OK;
 	}
-
-	/* The object was opened. Reject any open against writing file and all write mode open */
-	return (acc != 0 || Files[i].ctr == 0x100) ? FR_LOCKED : FR_OK;
+	return res;
 }
 
 
@@ -994,11 +1028,13 @@ FRESULT dec_lock (	/* Decrement object open counter */
 
 
 	if (--i < FF_FS_LOCK) {	/* Index number origin from 0 */
+		if (!LOCK_FILES()) return FR_INT_ERR;
 		n = Files[i].ctr;
 		if (n == 0x100) n = 0;		/* If write mode open, delete the entry */
 		if (n > 0) n--;				/* Decrement read mode open count */
 		Files[i].ctr = n;
 		if (n == 0) Files[i].fs = 0;	/* Delete the entry if open count gets zero */
+		UNLOCK_FILES();
 		res = FR_OK;
 	} else {
 		res = FR_INT_ERR;			/* Invalid index nunber */
@@ -1014,9 +1050,11 @@ void clear_lock (	/* Clear lock entries of the volume */
 {
 	UINT i;
 
+	if (!LOCK_FILES()) return;
 	for (i = 0; i < FF_FS_LOCK; i++) {
 		if (Files[i].fs == fs) Files[i].fs = 0;
 	}
+	UNLOCK_FILES();
 }
 
 #endif	/* FF_FS_LOCK != 0 */
@@ -2420,12 +2458,13 @@ FRESULT dir_read (
 
 
 /*-----------------------------------------------------------------------*/
-/* Directory handling - Find an object in the directory                  */
+/* Directory handling - Compare objects in the directory with the name   */
 /*-----------------------------------------------------------------------*/
 
 static
-FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
-	DIR* dp			/* Pointer to the directory object with the file name */
+FRESULT dir_match (	/* FR_OK(0):matched, FR_NO_FILE:not matched, !=0:error */
+	DIR* dp,		/* Pointer to the directory object with the file name */
+	int one			/* 0:Search to end of the directory, 1:Compare only the entry block at current position */
 )
 {
 	FRESULT res;
@@ -2435,8 +2474,6 @@ FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 	BYTE a, ord, sum;
 #endif
 
-	res = dir_sdi(dp, 0);			/* Rewind directory object */
-	if (res != FR_OK) return res;
 #if FF_FS_EXFAT
 	if (fs->fs_type == FS_EXFAT) {	/* On the exFAT volume */
 		BYTE nc;
@@ -2445,14 +2482,16 @@ FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 
 		while ((res = dir_read_file(dp)) == FR_OK) {	/* Read an item */
 #if FF_MAX_LFN < 255
-			if (fs->dirbuf[XDIR_NumName] > FF_MAX_LFN) continue;			/* Skip comparison if inaccessible object name */
+			if (fs->dirbuf[XDIR_NumName] <= FF_MAX_LFN)			/* Skip comparison if inaccessible object name */
 #endif
-			if (ld_word(fs->dirbuf + XDIR_NameHash) != hash) continue;	/* Skip comparison if hash mismatched */
-			for (nc = fs->dirbuf[XDIR_NumName], di = SZDIRE * 2, ni = 0; nc; nc--, di += 2, ni++) {	/* Compare the name */
-				if ((di % SZDIRE) == 0) di += 2;
-				if (ff_wtoupper(ld_word(fs->dirbuf + di)) != ff_wtoupper(fs->lfnbuf[ni])) break;
+			if (ld_word(fs->dirbuf + XDIR_NameHash) == hash) {	/* Skip comparison if hash mismatched */
+				for (nc = fs->dirbuf[XDIR_NumName], di = SZDIRE * 2, ni = 0; nc; nc--, di += 2, ni++) {	/* Compare the name */
+					if ((di % SZDIRE) == 0) di += 2;
+					if (ff_wtoupper(ld_word(fs->dirbuf + di)) != ff_wtoupper(fs->lfnbuf[ni])) break;
+				}
+				if (nc == 0 && !fs->lfnbuf[ni]) break;	/* Name matched? */
 			}
-			if (nc == 0 && !fs->lfnbuf[ni]) break;	/* Name matched? */
+			if (one) { res = FR_NO_FILE; break; }
 		}
 		return res;
 	}
@@ -2469,6 +2508,7 @@ FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 #if FF_USE_LFN		/* LFN configuration */
 		dp->obj.attr = a = dp->dir[DIR_Attr] & AM_MASK;
 		if (c == DDEM || ((a & AM_VOL) && a != AM_LFN)) {	/* An entry without valid data */
+			if (one) { res = FR_NO_FILE; break; }
 			ord = 0xFF; dp->blk_ofs = 0xFFFFFFFF;	/* Reset LFN sequence */
 		} else {
 			if (a == AM_LFN) {			/* An LFN entry is found */
@@ -2484,12 +2524,14 @@ FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 			} else {					/* An SFN entry is found */
 				if (ord == 0 && sum == sum_sfn(dp->dir)) break;	/* LFN matched? */
 				if (!(dp->fn[NSFLAG] & NS_LOSS) && !mem_cmp(dp->dir, dp->fn, 11)) break;	/* SFN matched? */
+				if (one) { res = FR_NO_FILE; break; }
 				ord = 0xFF; dp->blk_ofs = 0xFFFFFFFF;	/* Reset LFN sequence */
 			}
 		}
 #else		/* Non LFN configuration */
 		dp->obj.attr = dp->dir[DIR_Attr] & AM_MASK;
 		if (!(dp->dir[DIR_Attr] & AM_VOL) && !mem_cmp(dp->dir, dp->fn, 11)) break;	/* Is it a valid entry? */
+		if (one) { res = FR_NO_FILE; break; }
 #endif
 		res = dir_next(dp, 0);	/* Next entry */
 	} while (res == FR_OK);
@@ -2499,6 +2541,349 @@ FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 
 
 
+#if FF_USE_DIRINDEX
+/*-----------------------------------------------------------------------*/
+/* Directory index - Hash table of the entry blocks in a directory       */
+/*-----------------------------------------------------------------------*/
+/* A pair in the table maps a name key to the offset of an entry block
+/  which may have the name. Every entry block found via the table is compared
+/  with the name on the directory, so a pair left by a removed object costs
+/  a comparison but never a false match. Therefore the table is only added
+/  to when an object is registered and is not updated on removal.
+*/
+
+static
+DWORD dix_slot (	/* Get the first slot to probe for the key */
+	DWORD key
+)
+{
+	key ^= key >> 16; key *= 0x85EBCA6B; key ^= key >> 13;
+	return key;
+}
+
+
+static
+DWORD dix_lfc (		/* Add a character to the LFN key (FAT: order independent) */
+	DWORD key,		/* Current key value */
+	UINT i,			/* Position of the character in the name */
+	WCHAR wc		/* Character to be added */
+)
+{
+	return key + (ff_wtoupper(wc) + 1) * ((i + 1) * 0x9E3779B1 | 1);
+}
+
+
+static
+DWORD dix_lfn (		/* Get the LFN key of a name (FAT) */
+	const WCHAR* lfn
+)
+{
+	UINT i;
+	DWORD key = 0;
+
+
+	for (i = 0; lfn[i]; i++) key = dix_lfc(key, i, lfn[i]);
+	return key & ~1;
+}
+
+
+static
+DWORD dix_sfn (		/* Get the SFN key of a name (FAT) */
+	const BYTE* sfn
+)
+{
+	UINT i;
+	DWORD key = 0x811C9DC5;
+
+
+	for (i = 0; i < 11; i++) key = (key ^ sfn[i]) * 0x01000193;
+	return key | 1;
+}
+
+
+static
+void dix_free (		/* Discard a directory index */
+	FFDIRIDX* ix
+)
+{
+	if (ix->tbl) ff_memfree(ix->tbl);
+	ix->tbl = 0;
+}
+
+
+static
+int dix_put (		/* 1:Succeeded, 0:Not enough core */
+	FFDIRIDX* ix,	/* Directory index */
+	DWORD key,		/* Name key */
+	DWORD ofs		/* Offset of the entry block */
+)
+{
+	DWORD *tbl = ix->tbl, *ntbl, k, o;
+	UINT i, n, msk;
+
+
+	if ((ix->nent + 1) * 4 > ix->size * 3) {	/* Expand the table at 75% load */
+		ntbl = ff_memalloc(ix->size * 2 * 2 * sizeof (DWORD));
+		if (!ntbl) return 0;
+		msk = ix->size * 2 - 1;
+		for (i = 0; i <= msk; i++) ntbl[i * 2 + 1] = DIX_EMPTY;
+		for (n = 0; n < ix->size; n++) {	/* Move the pairs into new table */
+			k = tbl[n * 2]; o = tbl[n * 2 + 1];
+			if (o == DIX_EMPTY) continue;
+			for (i = dix_slot(k) & msk; ntbl[i * 2 + 1] != DIX_EMPTY; i = (i + 1) & msk) ;
+			ntbl[i * 2] = k; ntbl[i * 2 + 1] = o;
+		}
+		ff_memfree(tbl);
+		ix->tbl = tbl = ntbl;
+		ix->size *= 2;
+	}
+	msk = ix->size - 1;
+	for (i = dix_slot(key) & msk; tbl[i * 2 + 1] != DIX_EMPTY; i = (i + 1) & msk) {
+		if (tbl[i * 2] == key && tbl[i * 2 + 1] == ofs) return 1;	/* Already in the table */
+	}
+	tbl[i * 2] = key; tbl[i * 2 + 1] = ofs;
+	ix->nent++;
+	return 1;
+}
+
+
+static
+FRESULT dix_build (	/* FR_OK(0):succeeded, !=0:error */
+	DIR* dp,		/* Directory object to be indexed */
+	FFDIRIDX* ix	/* Directory index to be built */
+)
+{
+	FRESULT res;
+	FATFS *fs = dp->obj.fs;
+	DWORD key = 0, blk = DIX_EMPTY;
+	UINT i, s;
+	BYTE a, c, ord = 0xFF, sum = 0xFF;
+	WCHAR wc;
+
+
+	ix->tbl = ff_memalloc(DIX_MINSZ * 2 * sizeof (DWORD));
+	if (!ix->tbl) return FR_NOT_ENOUGH_CORE;
+	for (i = 0; i < DIX_MINSZ; i++) ix->tbl[i * 2 + 1] = DIX_EMPTY;
+	ix->size = DIX_MINSZ; ix->nent = 0;
+	ix->id = fs->id; ix->sclust = dp->obj.sclust;
+
+	res = dir_sdi(dp, 0);
+	while (res == FR_OK) {
+		res = move_window(fs, dp->sect);
+		if (res != FR_OK) break;
+		c = dp->dir[DIR_Name];
+		if (c == 0) break;		/* Reached to end of table */
+#if FF_FS_EXFAT
+		if (fs->fs_type == FS_EXFAT) {	/* On the exFAT volume */
+			if (c == 0x85) {			/* Start of the file entry block */
+				blk = dp->dptr;
+			} else {
+				if (c == 0xC0 && blk == dp->dptr - SZDIRE) {	/* Stream extension entry with the name hash */
+					if (!dix_put(ix, ld_word(dp->dir + XDIR_NameHash - SZDIRE), blk)) res = FR_NOT_ENOUGH_CORE;
+				}
+				blk = DIX_EMPTY;
+			}
+		} else
+#endif
+		{	/* On the FAT/FAT32 volume (in the same manner as dir_match) */
+			a = dp->dir[DIR_Attr] & AM_MASK;
+			if (c == DDEM || ((a & AM_VOL) && a != AM_LFN)) {	/* An entry without valid data */
+				ord = 0xFF;
+			} else {
+				if (a == AM_LFN) {			/* An LFN entry is found */
+					if (c & LLEF) {			/* Is it start of LFN sequence? */
+						sum = dp->dir[LDIR_Chksum];
+						c &= (BYTE)~LLEF; ord = c;
+						blk = dp->dptr; key = 0;
+					}
+					if (c == ord && sum == dp->dir[LDIR_Chksum]) {	/* Add the part of LFN to the key */
+						for (i = (ord - 1) * 13, s = 0; s < 13 && (wc = ld_word(dp->dir + LfnOfs[s])) != 0; s++) {
+							key = dix_lfc(key, i + s, wc);
+						}
+						ord--;
+					} else {
+						ord = 0xFF;
+					}
+				} else {					/* An SFN entry is found */
+					if (ord == 0 && sum == sum_sfn(dp->dir)) {	/* Has it a valid LFN? */
+						if (!dix_put(ix, key & ~1, blk)) res = FR_NOT_ENOUGH_CORE;
+					} else {
+						blk = dp->dptr;
+					}
+					if (!dix_put(ix, dix_sfn(dp->dir), blk)) res = FR_NOT_ENOUGH_CORE;
+					ord = 0xFF;
+				}
+			}
+		}
+		if (res == FR_OK) res = dir_next(dp, 0);	/* Next entry */
+	}
+
+	return (res == FR_NO_FILE) ? FR_OK : res;
+}
+
+
+static
+FFDIRIDX* dix_get (	/* Get the index of the directory (NULL:not indexed) */
+	DIR* dp,		/* Directory object */
+	int build		/* 0:Find an existing index, 1:Build the index if not exist */
+)
+{
+	FATFS *fs = dp->obj.fs;
+	FFDIRIDX *ix, *vx = 0;
+	UINT n;
+
+
+	for (n = 0; n < FF_DIRINDEX_NUM; n++) {
+		ix = &fs->dix[n];
+		if (ix->tbl && ix->id == fs->id && ix->sclust == dp->obj.sclust) {	/* Is the directory indexed? */
+			ix->lru = ++fs->dixlru;
+			return ix;
+		}
+		if (!vx || (vx->tbl && (!ix->tbl || ix->lru < vx->lru))) vx = ix;	/* Blank or least recently used index */
+	}
+	if (!build) return 0;
+
+	dix_free(vx);
+	if (dix_build(dp, vx) != FR_OK) {	/* Discard the index on error, dir_match will report it if any */
+		dix_free(vx);
+		return 0;
+	}
+	vx->lru = ++fs->dixlru;
+	return vx;
+}
+
+
+static
+FRESULT dix_cmp (	/* FR_OK(0):matched, FR_NO_FILE:not matched, !=0:error */
+	DIR* dp,		/* Directory object with the file name */
+	DWORD ofs		/* Offset of the entry block to be compared */
+)
+{
+	FRESULT res;
+
+
+	res = dir_sdi(dp, ofs);
+	if (res == FR_OK) res = move_window(dp->obj.fs, dp->sect);
+	if (res != FR_OK) return res;
+#if FF_FS_EXFAT
+	if (dp->obj.fs->fs_type == FS_EXFAT && dp->dir[XDIR_Type] != 0x85) return FR_NO_FILE;	/* Removed object */
+#endif
+	return dir_match(dp, 1);
+}
+
+
+static
+int dix_find (		/* 1:Result is returned in *rp, 0:The directory cannot be indexed */
+	DIR* dp,		/* Directory object with the file name */
+	FRESULT* rp		/* Result of the find */
+)
+{
+	FRESULT res;
+	FATFS *fs = dp->obj.fs;
+	FFDIRIDX *ix;
+	DWORD key[2], ofs, hit = DIX_EMPTY;
+	UINT nk = 0, k, i, msk;
+
+
+	ix = dix_get(dp, 1);
+	if (!ix) return 0;
+
+#if FF_FS_EXFAT
+	if (fs->fs_type == FS_EXFAT) {	/* On the exFAT volume */
+		key[nk++] = xname_sum(fs->lfnbuf);
+	} else
+#endif
+	{								/* On the FAT/FAT32 volume */
+		if (!(dp->fn[NSFLAG] & NS_NOLFN)) key[nk++] = dix_lfn(fs->lfnbuf);
+		if (!(dp->fn[NSFLAG] & NS_LOSS)) key[nk++] = dix_sfn(dp->fn);
+	}
+
+	/* Compare every candidate and take the first one in the directory as dir_match does */
+	msk = ix->size - 1;
+	for (k = 0; k < nk; k++) {
+		for (i = dix_slot(key[k]) & msk; (ofs = ix->tbl[i * 2 + 1]) != DIX_EMPTY; i = (i + 1) & msk) {
+			if (ix->tbl[i * 2] != key[k] || ofs >= hit) continue;
+			res = dix_cmp(dp, ofs);
+			if (res == FR_OK) {
+				hit = ofs;
+			} else {
+				if (res != FR_NO_FILE) { *rp = res; return 1; }
+			}
+		}
+	}
+	*rp = (hit != DIX_EMPTY) ? dix_cmp(dp, hit) : FR_NO_FILE;
+	return 1;
+}
+
+
+#if !FF_FS_READONLY
+static
+void dix_register (	/* Add a registered entry block to the index if the directory is indexed */
+	DIR* dp,		/* Directory object with the registered name */
+	DWORD blk		/* Offset of the registered entry block */
+)
+{
+	FATFS *fs = dp->obj.fs;
+	FFDIRIDX *ix;
+	int ok;
+
+
+	ix = dix_get(dp, 0);
+	if (!ix) return;
+#if FF_FS_EXFAT
+	if (fs->fs_type == FS_EXFAT) {	/* On the exFAT volume */
+		ok = dix_put(ix, xname_sum(fs->lfnbuf), blk);
+	} else
+#endif
+	{								/* On the FAT/FAT32 volume */
+		ok = dix_put(ix, dix_sfn(dp->fn), blk);
+		if (ok && (dp->fn[NSFLAG] & NS_LFN)) ok = dix_put(ix, dix_lfn(fs->lfnbuf), blk);
+	}
+	if (!ok) dix_free(ix);	/* Discard the index which is no longer complete */
+}
+#endif
+
+
+static
+void dix_discard (	/* Discard the index of a directory */
+	FATFS* fs,		/* Filesystem object */
+	DWORD sclust	/* Start cluster of the directory (0xFFFFFFFF:all directories) */
+)
+{
+	UINT n;
+
+
+	for (n = 0; n < FF_DIRINDEX_NUM; n++) {
+		if (sclust == 0xFFFFFFFF || fs->dix[n].sclust == sclust) dix_free(&fs->dix[n]);
+	}
+}
+
+#endif	/* FF_USE_DIRINDEX */
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Directory handling - Find an object in the directory                  */
+/*-----------------------------------------------------------------------*/
+
+static
+FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
+	DIR* dp			/* Pointer to the directory object with the file name */
+)
+{
+	FRESULT res;
+
+
+#if FF_USE_DIRINDEX
+	if (dix_find(dp, &res)) return res;	/* Find the object via the directory index */
+#endif
+	res = dir_sdi(dp, 0);			/* Rewind directory object */
+	if (res != FR_OK) return res;
+	return dir_match(dp, 0);
+}
+
+
+
 
 #if !FF_FS_READONLY
 /*-----------------------------------------------------------------------*/
@@ -2515,6 +2900,9 @@ FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too many S
 #if FF_USE_LFN		/* LFN configuration */
 	UINT n, nlen, nent;
 	BYTE sn[12], sum;
+#if FF_USE_DIRINDEX
+	DWORD blk;
+#endif
 
 
 	if (dp->fn[NSFLAG] & (NS_DOT | NS_NONAME)) return FR_INVALID_NAME;	/* Check name validity */
@@ -2548,6 +2936,9 @@ FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too many S
 		}
 
 		create_xdir(fs->dirbuf, fs->lfnbuf);	/* Create on-memory directory block to be written later */
+#if FF_USE_DIRINDEX
+		dix_register(dp, dp->blk_ofs);
+#endif
 		return FR_OK;
 	}
 #endif
@@ -2568,6 +2959,9 @@ FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too many S
 	/* Create an SFN with/without LFNs. */
 	nent = (sn[NSFLAG] & NS_LFN) ? (nlen + 12) / 13 + 1 : 1;	/* Number of entries to allocate */
 	res = dir_alloc(dp, nent);		/* Allocate entries */
+#if FF_USE_DIRINDEX
+	blk = dp->dptr - SZDIRE * (nent - 1);	/* Offset of the allocated entry block */
+#endif
 	if (res == FR_OK && --nent) {	/* Set LFN entry if needed */
 		res = dir_sdi(dp, dp->dptr - nent * SZDIRE);
 		if (res == FR_OK) {
@@ -2597,6 +2991,9 @@ FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too many S
 			dp->dir[DIR_NTres] = dp->fn[NSFLAG] & (NS_BODY | NS_EXT);	/* Put NT flag */
 #endif
 			fs->wflag = 1;
+#if FF_USE_DIRINDEX
+			dix_register(dp, blk);
+#endif
 		}
 	}
 
@@ -3263,6 +3660,9 @@ FRESULT find_volume (	/* FR_OK(0): successful, !=0: any error occurred */
 	/* Following code attempts to mount the volume. (analyze BPB and initialize the filesystem object) */
 
 	fs->fs_type = 0;					/* Clear the filesystem object */
+#if FF_USE_DIRINDEX
+	dix_discard(fs, 0xFFFFFFFF);		/* Directory indexes of the old medium or format are no longer complete */
+#endif
 	fs->pdrv = LD2PD(vol);				/* Bind the logical drive and a physical drive */
 	stat = disk_initialize(fs->pdrv);	/* Initialize the physical drive */
 	if (stat & STA_NOINIT) { 			/* Check if the initialization succeeded */
@@ -3421,8 +3821,14 @@ FRESULT find_volume (	/* FR_OK(0): successful, !=0: any error occurred */
 #endif	/* !FF_FS_READONLY */
 	}
 
-	fs->fs_type = fmt;		/* FAT sub-type */
+#if FF_FS_LOCK != 0
+	if (!LOCK_FILES()) return FR_TIMEOUT;	/* Fsid is shared by all volumes */
+	fs->id = ++Fsid;		/* Volume mount ID */
+	UNLOCK_FILES();
+#else
 	fs->id = ++Fsid;		/* Volume mount ID */
+#endif
+	fs->fs_type = fmt;		/* FAT sub-type */
 #if FF_USE_LFN == 1
 	fs->lfnbuf = LfnBuf;	/* Static LFN working buffer */
 #if FF_FS_EXFAT
@@ -3507,18 +3913,30 @@ FRESULT f_mount (
 	if (vol < 0) return FR_INVALID_DRIVE;
 	cfs = FatFs[vol];					/* Pointer to fs object */
 
+#if FF_FS_LOCK != 0 && FF_FS_REENTRANT
+	/* Sync object for the file lock table, created by the first f_mount() of any task */
+	if (!ff_cre_syncobj(FF_VOLUMES, &FilesSobj)) return FR_INT_ERR;
+#endif
+
 	if (cfs) {
 #if FF_FS_LOCK != 0
 		clear_lock(cfs);
 #endif
 #if FF_FS_REENTRANT						/* Discard sync object of the current volume */
 		if (!ff_del_syncobj(cfs->sobj)) return FR_INT_ERR;
+#endif
+#if FF_USE_DIRINDEX
+		dix_discard(cfs, 0xFFFFFFFF);	/* Discard directory indexes of the volume */
 #endif
 		cfs->fs_type = 0;				/* Clear old fs object */
 	}
 
 	if (fs) {
 		fs->fs_type = 0;				/* Clear new fs object */
+#if FF_USE_DIRINDEX
+		mem_set(fs->dix, 0, sizeof fs->dix);
+		fs->dixlru = 0;
+#endif
 #if FF_FS_REENTRANT						/* Create sync object for the new volume */
 		if (!ff_cre_syncobj((BYTE)vol, &fs->sobj)) return FR_INT_ERR;
 #endif
@@ -3550,6 +3968,9 @@ FRESULT f_open (
 #if !FF_FS_READONLY
 	DWORD dw, cl, bcs, clst, sc;
 	FSIZE_t ofs;
+#if FF_FS_LOCK != 0
+	int flk = 0;
+#endif
 #endif
 	DEF_NAMBUF
 
@@ -3564,6 +3985,13 @@ FRESULT f_open (
 		INIT_NAMBUF(fs);
 		res = follow_path(&dj, path);	/* Follow the file path */
 #if !FF_FS_READONLY	/* Read/Write configuration */
+#if FF_FS_LOCK != 0
+		if (LOCK_FILES()) {				/* Hold Files[] from the check to the registration */
+			flk = 1;
+		} else {
+			res = FR_INT_ERR;
+		}
+#endif
 		if (res == FR_OK) {
 			if (dj.fn[NSFLAG] & NS_NONAME) {	/* Origin directory itself? */
 				res = FR_INVALID_NAME;
@@ -3651,6 +4079,9 @@ FRESULT f_open (
 			if (fp->obj.lockid == 0) res = FR_INT_ERR;
 #endif
 		}
+#if FF_FS_LOCK != 0
+		if (flk) UNLOCK_FILES();
+#endif
 #else		/* R/O configuration */
 		if (res == FR_OK) {
 			if (dj.fn[NSFLAG] & NS_NONAME) {	/* Is it origin directory itself? */
@@ -4420,7 +4851,11 @@ FRESULT f_opendir (
 #if FF_FS_LOCK != 0
 				if (res == FR_OK) {
 					if (dp->obj.sclust != 0) {
-						dp->obj.lockid = inc_lock(dp, 0);	/* Lock the sub directory */
+						dp->obj.lockid = 0;
+						if (LOCK_FILES()) {
+							dp->obj.lockid = inc_lock(dp, 0);	/* Lock the sub directory */
+							UNLOCK_FILES();
+						}
 						if (!dp->obj.lockid) res = FR_TOO_MANY_OPEN_FILES;
 					} else {
 						dp->obj.lockid = 0;	/* Root directory need not to be locked */
@@ -4760,7 +5195,14 @@ FRESULT f_unlink (
 			res = FR_INVALID_NAME;			/* Cannot remove dot entry */
 		}
 #if FF_FS_LOCK != 0
-		if (res == FR_OK) res = chk_lock(&dj, 2);	/* Check if it is an open object */
+		if (res == FR_OK) {
+			if (LOCK_FILES()) {
+				res = chk_lock(&dj, 2);		/* Check if it is an open object */
+				UNLOCK_FILES();
+			} else {
+				res = FR_INT_ERR;
+			}
+		}
 #endif
 		if (res == FR_OK) {					/* The object is accessible */
 			if (dj.fn[NSFLAG] & NS_NONAME) {
@@ -4807,6 +5249,9 @@ FRESULT f_unlink (
 			}
 			if (res == FR_OK) {
 				res = dir_remove(&dj);			/* Remove the directory entry */
+#if FF_USE_DIRINDEX
+				if (res == FR_OK && (dj.obj.attr & AM_DIR)) dix_discard(fs, dclst);	/* Discard the index of removed directory */
+#endif
 				if (res == FR_OK && dclst != 0) {	/* Remove the cluster chain if exist */
 #if FF_FS_EXFAT
 					res = remove_chain(&obj, dclst, 0);
@@ -4836,6 +5281,7 @@ FRESULT f_mkdir (
 {
 	FRESULT res;
 	DIR dj;
+	FFOBJID sobj;
 	FATFS *fs;
 	BYTE *dir;
 	DWORD dcl, pcl, tm;
@@ -4853,8 +5299,8 @@ FRESULT f_mkdir (
 			res = FR_INVALID_NAME;
 		}
 		if (res == FR_NO_FILE) {				/* Can create a new directory */
-			dcl = create_chain(&dj.obj, 0);		/* Allocate a cluster for the new directory table */
-			dj.obj.objsize = (DWORD)fs->csize * SS(fs);
+			sobj.fs = fs;						/* New object id, the chain of the parent directory is left as it is */
+			dcl = create_chain(&sobj, 0);		/* Allocate a cluster for the new directory table */
 			res = FR_OK;
 			if (dcl == 0) res = FR_DENIED;		/* No space to allocate a new cluster */
 			if (dcl == 1) res = FR_INT_ERR;
@@ -4884,8 +5330,8 @@ FRESULT f_mkdir (
 				if (fs->fs_type == FS_EXFAT) {	/* Initialize directory entry block */
 					st_dword(fs->dirbuf + XDIR_ModTime, tm);	/* Created time */
 					st_dword(fs->dirbuf + XDIR_FstClus, dcl);	/* Table start cluster */
-					st_dword(fs->dirbuf + XDIR_FileSize, (DWORD)dj.obj.objsize);	/* File size needs to be valid */
-					st_dword(fs->dirbuf + XDIR_ValidFileSize, (DWORD)dj.obj.objsize);
+					st_dword(fs->dirbuf + XDIR_FileSize, (DWORD)fs->csize * SS(fs));	/* File size needs to be valid */
+					st_dword(fs->dirbuf + XDIR_ValidFileSize, (DWORD)fs->csize * SS(fs));
 					fs->dirbuf[XDIR_GenFlags] = 3;				/* Initialize the object flag */
 					fs->dirbuf[XDIR_Attr] = AM_DIR;				/* Attribute */
 					res = store_xdir(&dj);
@@ -4902,7 +5348,7 @@ FRESULT f_mkdir (
 					res = sync_fs(fs);
 				}
 			} else {
-				remove_chain(&dj.obj, dcl, 0);		/* Could not register, remove cluster chain */
+				remove_chain(&sobj, dcl, 0);		/* Could not register, remove cluster chain */
 			}
 		}
 		FREE_NAMBUF();
@@ -4940,7 +5386,12 @@ FRESULT f_rename (
 		if (res == FR_OK && (djo.fn[NSFLAG] & (NS_DOT | NS_NONAME))) res = FR_INVALID_NAME;	/* Check validity of name */
 #if FF_FS_LOCK != 0
 		if (res == FR_OK) {
-			res = chk_lock(&djo, 2);
+			if (LOCK_FILES()) {
+				res = chk_lock(&djo, 2);
+				UNLOCK_FILES();
+			} else {
+				res = FR_INT_ERR;
+			}
 		}
 #endif
 		if (res == FR_OK) {						/* Object to be renamed is found */
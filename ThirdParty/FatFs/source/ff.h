@@ -82,6 +82,21 @@ typedef DWORD FSIZE_t;
 
 
 
+/* Directory index structure (FFDIRIDX) */
+
+#if FF_USE_DIRINDEX
+typedef struct {
+	DWORD*	tbl;			/* Hash table of {key, entry block offset} pairs (NULL:unused) */
+	WORD	id;				/* Volume mount ID at the time of indexing */
+	DWORD	sclust;			/* Start cluster of the indexed directory (0:root) */
+	UINT	size;			/* Number of pairs in the table (power of 2) */
+	UINT	nent;			/* Number of used pairs */
+	DWORD	lru;			/* Last access stamp */
+} FFDIRIDX;
+#endif
+
+
+
 /* Filesystem object structure (FATFS) */
 
 typedef struct {
@@ -124,6 +139,10 @@ typedef struct {
 	DWORD	dirbase;		/* Root directory base sector/cluster */
 	DWORD	database;		/* Data base sector */
 	DWORD	winsect;		/* Current sector appearing in the win[] */
+#if FF_USE_DIRINDEX
+	DWORD	dixlru;			/* Directory index access counter */
+	FFDIRIDX	dix[FF_DIRINDEX_NUM];	/* Directory indexes */
+#endif
 	BYTE	win[FF_MAX_SS];	/* Disk access window for Directory, FAT (and file data at tiny cfg) */
 } FATFS;
 
@@ -306,7 +325,7 @@ WCHAR ff_oem2uni (WCHAR oem, WORD cp);	/* OEM code to Unicode conversion */
 WCHAR ff_uni2oem (DWORD uni, WORD cp);	/* Unicode to OEM code conversion */
 DWORD ff_wtoupper (DWORD uni);			/* Unicode upper-case conversion */
 #endif
-#if FF_USE_LFN == 3						/* Dynamic memory allocation */
+#if FF_USE_LFN == 3 || FF_USE_DIRINDEX	/* Dynamic memory allocation */
 void* ff_memalloc (UINT msize);			/* Allocate memory block */
 void ff_memfree (void* mblock);			/* Free memory block */
 #endif
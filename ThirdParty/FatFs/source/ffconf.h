@@ -4,6 +4,31 @@
 
 #define FFCONF_DEF 89352	/* Revision ID */
 
+/*---------------------------------------------------------------------------/
+/ Build Profile
+/---------------------------------------------------------------------------*/
+
+#ifndef FF_NVT_EXFAT_LFN
+#define FF_NVT_EXFAT_LFN	0
+#endif
+/* This option selects the exFAT/LFN build profile. (0:Disable or 1:Enable)
+/  The profile enables LFN with the working buffer on the heap, exFAT and the
+/  hashed directory index. It is needed to access SDXC cards formatted out of the
+/  box and files larger than 4 GB. It can be given on the compiler command line
+/  (-DFF_NVT_EXFAT_LFN=1). ffunicode.c and ffsystem.c need to be added to the
+/  project when the profile is enabled. */
+
+
+#ifndef FF_NVT_FREERTOS
+#define FF_NVT_FREERTOS		0
+#endif
+/* This option selects the FreeRTOS build profile. (0:Disable or 1:Enable)
+/  The profile enables re-entrancy with a FreeRTOS mutex per volume and the file
+/  lock function, so that tasks can access files on the same or different volumes
+/  concurrently. ffsystem.c needs to be added to the project and the FreeRTOS
+/  headers need to be in the include path when the profile is enabled. */
+
+
 /*---------------------------------------------------------------------------/
 / Function Configurations
 /---------------------------------------------------------------------------*/
@@ -38,7 +63,9 @@
 /  f_findnext(). (0:Disable, 1:Enable 2:Enable with matching altname[] too) */
 
 
+#ifndef FF_USE_MKFS
 #define FF_USE_MKFS		0
+#endif
 /* This option switches f_mkfs() function. (0:Disable or 1:Enable) */
 
 
@@ -97,7 +124,11 @@
 */
 
 
+#if FF_NVT_EXFAT_LFN
+#define FF_USE_LFN		3
+#else
 #define FF_USE_LFN		0
+#endif
 #define FF_MAX_LFN		255
 /* The FF_USE_LFN switches the support for LFN (long file name).
 /
@@ -224,12 +255,37 @@
 /  buffer in the filesystem object (FATFS) is used for the file data transfer. */
 
 
+#if FF_NVT_EXFAT_LFN
+#define FF_FS_EXFAT		1
+#else
 #define FF_FS_EXFAT		0
+#endif
 /* This option switches support for exFAT filesystem. (0:Disable or 1:Enable)
 /  When enable exFAT, also LFN needs to be enabled.
 /  Note that enabling exFAT discards ANSI C (C89) compatibility. */
 
 
+#ifndef FF_USE_DIRINDEX
+#if FF_NVT_EXFAT_LFN
+#define FF_USE_DIRINDEX	1
+#else
+#define FF_USE_DIRINDEX	0
+#endif
+#endif
+#define FF_DIRINDEX_NUM	4
+/* The option FF_USE_DIRINDEX switches the in-memory hashed directory index.
+/  (0:Disable or 1:Enable) When enabled, the first name lookup in a directory
+/  scans it once and builds a hash table of its entry blocks. Following lookups
+/  in the directory read only the entry blocks whose name hash matches, instead
+/  of scanning the whole directory. LFN needs to be enabled and the tables are
+/  allocated with ff_memalloc() in ffsystem.c. In a directory of 2000 files
+/  on exFAT, a lookup reads 6 sectors instead of 314 on average including the
+/  first scan (host/fatfs_exfat).
+/
+/  The FF_DIRINDEX_NUM defines the number of directories indexed at a time per
+/  volume. The least recently used index is discarded to index a new directory. */
+
+
 #define FF_FS_NORTC		0
 #define FF_NORTC_MON	1
 #define FF_NORTC_MDAY	1
@@ -244,7 +300,11 @@
 /  These options have no effect at read-only configuration (FF_FS_READONLY = 1). */
 
 
+#if FF_NVT_FREERTOS
+#define FF_FS_LOCK		16
+#else
 #define FF_FS_LOCK		0
+#endif
 /* The option FF_FS_LOCK switches file lock function to control duplicated file open
 /  and illegal operation to open objects. This option must be 0 when FF_FS_READONLY
 /  is 1.
@@ -253,12 +313,20 @@
 /      should avoid illegal open, remove and rename to the open objects.
 /  >0: Enable file lock function. The value defines how many files/sub-directories
 /      can be opened simultaneously under file lock control. Note that the file
-/      lock control is independent of re-entrancy. */
+/      lock control is independent of re-entrancy. At the re-entrant
+/      configuration, the lock table shared by all volumes is guarded by an
+/      additional sync object created by ff_cre_syncobj() with vol = FF_VOLUMES. */
 
 
+#if FF_NVT_FREERTOS
+#define FF_FS_REENTRANT	1
+#define FF_FS_TIMEOUT	pdMS_TO_TICKS(1000)
+#define FF_SYNC_t		SemaphoreHandle_t
+#else
 #define FF_FS_REENTRANT	0
 #define FF_FS_TIMEOUT	1000
 #define FF_SYNC_t		HANDLE
+#endif
 /* The option FF_FS_REENTRANT switches the re-entrancy (thread safe) of the FatFs
 /  module itself. Note that regardless of this option, file access to different
 /  volume is always re-entrant and volume control functions, f_mount(), f_mkfs()
@@ -268,8 +336,8 @@
 /   0: Disable re-entrancy. FF_FS_TIMEOUT and FF_SYNC_t have no effect.
 /   1: Enable re-entrancy. Also user provided synchronization handlers,
 /      ff_req_grant(), ff_rel_grant(), ff_del_syncobj() and ff_cre_syncobj()
-/      function, must be added to the project. Samples are available in
-/      option/syscall.c.
+/      function, must be added to the project. The FreeRTOS implementation
+/      is in ffsystem.c.
 /
 /  The FF_FS_TIMEOUT defines timeout period in unit of time tick.
 /  The FF_SYNC_t defines O/S dependent sync object type. e.g. HANDLE, ID, OS_EVENT*,
@@ -277,6 +345,11 @@
 /  included somewhere in the scope of ff.h. */
 
 /* #include <windows.h>	// O/S definitions  */
+#if FF_NVT_FREERTOS
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+#endif
 
 
 
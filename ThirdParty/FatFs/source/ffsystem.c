@@ -8,7 +8,10 @@
 
 
 
-#if FF_USE_LFN == 3	/* Dynamic memory allocation */
+#if FF_USE_LFN == 3 || FF_USE_DIRINDEX	/* Dynamic memory allocation */
+#if !FF_NVT_FREERTOS
+#include <stdlib.h>
+#endif
 
 /*------------------------------------------------------------------------*/
 /* Allocate a memory block                                                */
@@ -18,7 +21,11 @@ void* ff_memalloc (	/* Returns pointer to the allocated memory block (null on no
 	UINT msize		/* Number of bytes to allocate */
 )
 {
+#if FF_NVT_FREERTOS
+	return pvPortMalloc(msize);	/* Allocate a new memory block with FreeRTOS heap */
+#else
 	return malloc(msize);	/* Allocate a new memory block with POSIX API */
+#endif
 }
 
 
@@ -30,7 +37,11 @@ void ff_memfree (
 	void* mblock	/* Pointer to the memory block to free (nothing to do for null) */
 )
 {
+#if FF_NVT_FREERTOS
+	vPortFree(mblock);	/* Free the memory block with FreeRTOS heap */
+#else
 	free(mblock);	/* Free the memory block with POSIX API */
+#endif
 }
 
 #endif
@@ -45,6 +56,11 @@ void ff_memfree (
 /* This function is called in f_mount() function to create a new
 /  synchronization object for the volume, such as semaphore and mutex.
 /  When a 0 is returned, the f_mount() function fails with FR_INT_ERR.
+/  Each volume has its own mutex, so that tasks accessing different volumes
+/  never wait for each other. vol = FF_VOLUMES requests the object which
+/  guards the file lock table shared by all volumes. It is requested at every
+/  f_mount(), possibly by several tasks at once, and is created only while
+/  *sobj is still null; the check and the creation must be atomic.
 */
 
 //const osMutexDef_t Mutex[FF_VOLUMES];	/* CMSIS-RTOS */
@@ -55,9 +71,22 @@ int ff_cre_syncobj (	/* 1:Function succeeded, 0:Could not create the sync object
 	FF_SYNC_t *sobj		/* Pointer to return the created sync object */
 )
 {
+	/* FreeRTOS */
+	int ret;
+
+	if (vol < FF_VOLUMES) {
+		*sobj = xSemaphoreCreateMutex();
+		return (int)(*sobj != NULL);
+	}
+	vTaskSuspendAll();	/* No other task checks between the check and the creation */
+	if (*sobj == NULL) *sobj = xSemaphoreCreateMutex();
+	ret = (int)(*sobj != NULL);
+	(void)xTaskResumeAll();
+	return ret;
+
 	/* Win32 */
-	*sobj = CreateMutex(NULL, FALSE, NULL);
-	return (int)(*sobj != INVALID_HANDLE_VALUE);
+//	*sobj = CreateMutex(NULL, FALSE, NULL);
+//	return (int)(*sobj != INVALID_HANDLE_VALUE);
 
 	/* uITRON */
 //	T_CSEM csem = {TA_TPRI,1,1};
@@ -69,10 +98,6 @@ int ff_cre_syncobj (	/* 1:Function succeeded, 0:Could not create the sync object
 //	*sobj = OSMutexCreate(0, &err);
 //	return (int)(err == OS_NO_ERR);
 
-	/* FreeRTOS */
-//	*sobj = xSemaphoreCreateMutex();
-//	return (int)(*sobj != NULL);
-
 	/* CMSIS-RTOS */
 //	*sobj = osMutexCreate(Mutex + vol);
 //	return (int)(*sobj != NULL);
@@ -91,8 +116,12 @@ int ff_del_syncobj (	/* 1:Function succeeded, 0:Could not delete due to an error
 	FF_SYNC_t sobj		/* Sync object tied to the logical drive to be deleted */
 )
 {
+	/* FreeRTOS */
+	vSemaphoreDelete(sobj);
+	return 1;
+
 	/* Win32 */
-	return (int)CloseHandle(sobj);
+//	return (int)CloseHandle(sobj);
 
 	/* uITRON */
 //	return (int)(del_sem(sobj) == E_OK);
@@ -102,10 +131,6 @@ int ff_del_syncobj (	/* 1:Function succeeded, 0:Could not delete due to an error
 //	OSMutexDel(sobj, OS_DEL_ALWAYS, &err);
 //	return (int)(err == OS_NO_ERR);
 
-	/* FreeRTOS */
-//  vSemaphoreDelete(sobj);
-//	return 1;
-
 	/* CMSIS-RTOS */
 //	return (int)(osMutexDelete(sobj) == osOK);
 }
@@ -122,8 +147,11 @@ int ff_req_grant (	/* 1:Got a grant to access the volume, 0:Could not get a gran
 	FF_SYNC_t sobj	/* Sync object to wait */
 )
 {
+	/* FreeRTOS */
+	return (int)(xSemaphoreTake(sobj, FF_FS_TIMEOUT) == pdTRUE);
+
 	/* Win32 */
-	return (int)(WaitForSingleObject(sobj, FF_FS_TIMEOUT) == WAIT_OBJECT_0);
+//	return (int)(WaitForSingleObject(sobj, FF_FS_TIMEOUT) == WAIT_OBJECT_0);
 
 	/* uITRON */
 //	return (int)(wai_sem(sobj) == E_OK);
@@ -133,9 +161,6 @@ int ff_req_grant (	/* 1:Got a grant to access the volume, 0:Could not get a gran
 //	OSMutexPend(sobj, FF_FS_TIMEOUT, &err));
 //	return (int)(err == OS_NO_ERR);
 
-	/* FreeRTOS */
-//	return (int)(xSemaphoreTake(sobj, FF_FS_TIMEOUT) == pdTRUE);
-
 	/* CMSIS-RTOS */
 //	return (int)(osMutexWait(sobj, FF_FS_TIMEOUT) == osOK);
 }
@@ -151,8 +176,11 @@ void ff_rel_grant (
 	FF_SYNC_t sobj	/* Sync object to be signaled */
 )
 {
+	/* FreeRTOS */
+	xSemaphoreGive(sobj);
+
 	/* Win32 */
-	ReleaseMutex(sobj);
+//	ReleaseMutex(sobj);
 
 	/* uITRON */
 //	sig_sem(sobj);
@@ -160,9 +188,6 @@ void ff_rel_grant (
 	/* uC/OS-II */
 //	OSMutexPost(sobj);
 
-	/* FreeRTOS */
-//	xSemaphoreGive(sobj);
-
 	/* CMSIS-RTOS */
 //	osMutexRelease(sobj);
 }
@@ -0,0 +1,339 @@
+/**************************************************************************//**
+ * @file     mad_test.c
+ *
+ * @brief    Host conformance test and benchmark of the LibMAD fixed-point
+ *           configurations, FPM_AARCH64 with and without the NEON kernels
+ *           against the FPM_64BIT reference.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mad.h"
+#include "mp3_gen.h"
+
+/*
+ * LibMAD is built four times (see Makefile), each copy renamed with its
+ * own prefix:
+ *
+ *   neon_  FPM_AARCH64 with the NEON kernels, on the shared arm_neon.h
+ *          stand-in unless the host is AArch64
+ *   c64_   FPM_AARCH64, C only
+ *   ref_   FPM_64BIT, the reference
+ *   old_   FPM_DEFAULT OPT_SPEED, what I2S_MP3PLAYER used to build
+ *
+ *   mad_test [-b] [-t ms] [-w dir] [file.mp3 ...]
+ *
+ * Every file, or the generated corpus of mp3_gen.c when none is given, is
+ * decoded by each copy. neon_ must be bit-exact with c64_; c64_ must stay
+ * within MAD_TEST_TOL_LSB of ref_ on every 16-bit sample. old_ is only
+ * reported. -b adds a frames per second benchmark of each copy, for at
+ * least -t ms per stream, and -w writes the generated corpus to dir for
+ * the target.
+ */
+
+/*
+ * FPM_AARCH64 and FPM_64BIT truncate mad_f_mul() alike and differ where
+ * FPM_AARCH64 sums the products of a filter before scaling: a few 2^-28
+ * at most, one LSB of the 16-bit output at most. The reference is built
+ * without OPT_ACCURACY, whose rounding alone moves the stereo processing
+ * of some frames much further than that.
+ */
+#define MAD_TEST_TOL_LSB    1
+
+#define MAD_DECLARE(p)  \
+	void p##mad_stream_init(struct mad_stream *);  \
+	void p##mad_stream_buffer(struct mad_stream *, unsigned char const *, unsigned long);  \
+	void p##mad_stream_finish(struct mad_stream *);  \
+	void p##mad_frame_init(struct mad_frame *);  \
+	int  p##mad_frame_decode(struct mad_frame *, struct mad_stream *);  \
+	void p##mad_frame_finish(struct mad_frame *);  \
+	void p##mad_synth_init(struct mad_synth *);  \
+	void p##mad_synth_frame(struct mad_synth *, struct mad_frame const *);
+
+#define MAD_VARIANT(p, desc)  \
+	{ #p, desc, p##mad_stream_init, p##mad_stream_buffer, p##mad_stream_finish,  \
+	  p##mad_frame_init, p##mad_frame_decode, p##mad_frame_finish,  \
+	  p##mad_synth_init, p##mad_synth_frame }
+
+MAD_DECLARE(neon_)
+MAD_DECLARE(c64_)
+MAD_DECLARE(ref_)
+MAD_DECLARE(old_)
+
+typedef struct {
+	const char *name;
+	const char *desc;
+	void (*stream_init)(struct mad_stream *);
+	void (*stream_buffer)(struct mad_stream *, unsigned char const *, unsigned long);
+	void (*stream_finish)(struct mad_stream *);
+	void (*frame_init)(struct mad_frame *);
+	int  (*frame_decode)(struct mad_frame *, struct mad_stream *);
+	void (*frame_finish)(struct mad_frame *);
+	void (*synth_init)(struct mad_synth *);
+	void (*synth_frame)(struct mad_synth *, struct mad_frame const *);
+} variant_t;
+
+enum { V_NEON, V_C64, V_REF, V_OLD, V_NUM };
+
+static const variant_t s_var[V_NUM] = {
+	MAD_VARIANT(neon_, "FPM_AARCH64 + NEON"),
+	MAD_VARIANT(c64_,  "FPM_AARCH64"),
+	MAD_VARIANT(ref_,  "FPM_64BIT"),
+	MAD_VARIANT(old_,  "FPM_DEFAULT OPT_SPEED"),
+};
+
+typedef struct {
+	short *pcm;             /* interleaved by channel pairs, mono duplicated */
+	size_t samples;
+	int frames;             /* synthesized */
+	int errors;             /* recoverable errors, frames skipped */
+	unsigned int hz;
+	unsigned int spf;       /* samples per frame */
+} decoded_t;
+
+typedef struct {
+	long n;
+	long diff;
+	int maxdiff;
+	double err2, sig2;
+} cmp_t;
+
+static struct mad_stream s_stream;
+static struct mad_frame  s_frame;
+static struct mad_synth  s_synth;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Decode a whole stream, keeping the PCM unless only timing */
+static int decode(const variant_t *v, const uint8_t *buf, size_t len, decoded_t *out, int keep)
+{
+	size_t cap = 0;
+	unsigned int i, n;
+
+	memset(out, 0, sizeof(*out));
+
+	v->stream_init(&s_stream);
+	v->frame_init(&s_frame);
+	v->synth_init(&s_synth);
+	v->stream_buffer(&s_stream, buf, len);
+
+	for (;;) {
+		if (v->frame_decode(&s_frame, &s_stream)) {
+			if (MAD_RECOVERABLE(s_stream.error)) {
+				out->errors++;
+				continue;
+			}
+			if (s_stream.error == MAD_ERROR_BUFLEN)
+				break;
+			fprintf(stderr, "%s: unrecoverable error 0x%04x\n", v->name, s_stream.error);
+			return -1;
+		}
+
+		v->synth_frame(&s_synth, &s_frame);
+		out->frames++;
+		out->hz = s_synth.pcm.samplerate;
+		out->spf = s_synth.pcm.length;
+
+		if (!keep)
+			continue;
+
+		n = s_synth.pcm.length;
+		if (out->samples + 2 * n > cap) {
+			cap = (cap + 2 * n) * 2;
+			out->pcm = realloc(out->pcm, cap * sizeof(short));
+			if (!out->pcm)
+				return -1;
+		}
+		for (i = 0; i < n; i++) {
+			out->pcm[out->samples++] = s_synth.pcm.samples[0][i];
+			out->pcm[out->samples++] = s_synth.pcm.samples[s_synth.pcm.channels - 1][i];
+		}
+	}
+
+	v->frame_finish(&s_frame);
+	v->stream_finish(&s_stream);
+	return 0;
+}
+
+static void compare(const decoded_t *a, const decoded_t *ref, cmp_t *c)
+{
+	size_t i, n = (a->samples < ref->samples) ? a->samples : ref->samples;
+	int d;
+
+	memset(c, 0, sizeof(*c));
+	c->n = n;
+	for (i = 0; i < n; i++) {
+		d = a->pcm[i] - ref->pcm[i];
+		if (d) {
+			c->diff++;
+			if (abs(d) > c->maxdiff)
+				c->maxdiff = abs(d);
+		}
+		c->err2 += (double)d * d;
+		c->sig2 += (double)ref->pcm[i] * ref->pcm[i];
+	}
+	if (a->samples != ref->samples)
+		c->maxdiff = 0x10000;
+}
+
+static void print_cmp(const char *what, const cmp_t *c)
+{
+	printf("  %-14s %9ld/%-9ld differ, max %5d LSB", what, c->diff, c->n, c->maxdiff);
+	if (c->diff)
+		printf(", SNR %6.1f dB\n", 10.0 * log10(c->sig2 / c->err2));
+	else
+		printf("\n");
+}
+
+static void bench(const uint8_t *buf, size_t len, unsigned int ms)
+{
+	decoded_t d;
+	uint64_t t0, t;
+	long frames;
+	int v;
+
+	for (v = 0; v < V_NUM; v++) {
+		frames = 0;
+		t0 = now_ns();
+		do {
+			if (decode(&s_var[v], buf, len, &d, 0))
+				return;
+			frames += d.frames;
+			t = now_ns() - t0;
+		} while (t < (uint64_t)ms * 1000000u);
+
+		printf("  %-24s %9.1f frames/s %8.1f x real time\n", s_var[v].desc,
+		       frames * 1e9 / t, d.hz ? (frames * 1e9 / t) * d.spf / d.hz : 0.0);
+	}
+}
+
+static uint8_t *load(const char *path, size_t *len)
+{
+	FILE *f = fopen(path, "rb");
+	uint8_t *buf;
+	long n;
+
+	if (!f)
+		return NULL;
+	fseek(f, 0, SEEK_END);
+	n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	buf = calloc(1, n + MAD_BUFFER_GUARD);
+	if (buf && fread(buf, 1, n, f) != (size_t)n) {
+		free(buf);
+		buf = NULL;
+	}
+	fclose(f);
+	*len = n + MAD_BUFFER_GUARD;
+	return buf;
+}
+
+static int run(const char *name, const uint8_t *buf, size_t len, int do_bench, unsigned int ms)
+{
+	decoded_t d[V_NUM];
+	cmp_t c;
+	int v, fail = 0;
+
+	for (v = 0; v < V_NUM; v++)
+		if (decode(&s_var[v], buf, len, &d[v], 1))
+			return 1;
+
+	printf("%s: %d frames, %d skipped, %u Hz\n", name, d[V_REF].frames, d[V_REF].errors, d[V_REF].hz);
+
+	compare(&d[V_NEON], &d[V_C64], &c);
+	print_cmp("neon vs c64", &c);
+	if (c.diff || d[V_NEON].samples != d[V_C64].samples) {
+		printf("  FAIL: NEON kernels are not bit-exact\n");
+		fail = 1;
+	}
+
+	compare(&d[V_C64], &d[V_REF], &c);
+	print_cmp("c64 vs ref", &c);
+	if (c.maxdiff > MAD_TEST_TOL_LSB) {
+		printf("  FAIL: FPM_AARCH64 off the reference by more than %d LSB\n", MAD_TEST_TOL_LSB);
+		fail = 1;
+	}
+
+	compare(&d[V_OLD], &d[V_REF], &c);
+	print_cmp("old vs ref", &c);
+
+	if (do_bench)
+		bench(buf, len, ms);
+
+	for (v = 0; v < V_NUM; v++)
+		free(d[v].pcm);
+
+	return fail;
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t gen[2 * 1024 * 1024];
+	const char *wdir = NULL;
+	unsigned int ms = 500;
+	int opt, i, fail = 0, do_bench = 0;
+	uint8_t *buf;
+	size_t len;
+	char path[512];
+	FILE *f;
+
+	while ((opt = getopt(argc, argv, "bt:w:")) != -1) {
+		switch (opt) {
+		case 'b': do_bench = 1; break;
+		case 't': ms = strtoul(optarg, NULL, 0); break;
+		case 'w': wdir = optarg; break;
+		default:
+			fprintf(stderr, "usage: %s [-b] [-t ms] [-w dir] [file.mp3 ...]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	if (optind < argc) {
+		for (i = optind; i < argc; i++) {
+			buf = load(argv[i], &len);
+			if (!buf) {
+				fprintf(stderr, "%s: cannot read\n", argv[i]);
+				return 1;
+			}
+			fail |= run(argv[i], buf, len, do_bench, ms);
+			free(buf);
+		}
+	} else {
+		for (i = 0; i < mp3_gen_corpus_size; i++) {
+			memset(gen, 0, sizeof(gen));
+			len = mp3_gen(&mp3_gen_corpus[i], gen, sizeof(gen) - MAD_BUFFER_GUARD);
+			if (!len) {
+				fprintf(stderr, "%s: does not fit\n", mp3_gen_corpus[i].name);
+				return 1;
+			}
+			if (wdir) {
+				snprintf(path, sizeof(path), "%s/%s.mp3", wdir, mp3_gen_corpus[i].name);
+				f = fopen(path, "wb");
+				if (!f || fwrite(gen, 1, len, f) != len) {
+					fprintf(stderr, "%s: cannot write\n", path);
+					return 1;
+				}
+				fclose(f);
+			}
+			fail |= run(mp3_gen_corpus[i].name, gen, len + MAD_BUFFER_GUARD, do_bench, ms);
+		}
+	}
+
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
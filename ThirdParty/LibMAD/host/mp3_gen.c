@@ -0,0 +1,177 @@
+/**************************************************************************//**
+ * @file     mp3_gen.c
+ *
+ * @brief    Synthetic MPEG audio Layer III streams for the LibMAD host test.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+
+#include "mp3_gen.h"
+
+/*
+ * Every frame is self-contained (main_data_begin 0) and splits its main
+ * data evenly between the granules and channels. The bit reservoir is not
+ * exercised, the decoder state that spans frames (overlap, polyphase
+ * filter) is.
+ */
+
+const mp3_gen_cfg mp3_gen_corpus[] = {
+	{ "m1_44k_stereo_320",  0, 0, 14, 0, 300, 1 },
+	{ "m1_44k_joint_256",   0, 0, 13, 1, 300, 2 },
+	{ "m1_48k_joint_192",   0, 1, 11, 1, 300, 3 },
+	{ "m1_32k_dual_160",    0, 2, 10, 2, 300, 4 },
+	{ "m1_44k_mono_128",    0, 0,  9, 3, 300, 5 },
+	{ "m2_22k_joint_96",    1, 0, 10, 1, 300, 6 },
+	{ "m2_24k_stereo_160",  1, 1, 14, 0, 300, 7 },
+	{ "m2_16k_mono_64",     1, 2,  8, 3, 300, 8 },
+};
+const int mp3_gen_corpus_size = sizeof(mp3_gen_corpus) / sizeof(mp3_gen_corpus[0]);
+
+static const uint16_t s_kbps[2][15] = {
+	{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+	{ 0,  8, 16, 24, 32, 40, 48, 56,  64,  80,  96, 112, 128, 144, 160 },
+};
+
+static const uint32_t s_hz[2][3] = {
+	{ 44100, 48000, 32000 },
+	{ 22050, 24000, 16000 },
+};
+
+typedef struct {
+	uint8_t *p;
+	uint32_t bit;
+} bitw_t;
+
+static void put(bitw_t *w, uint32_t v, int n)
+{
+	while (n--) {
+		if (v & (1u << n))
+			w->p[w->bit >> 3] |= 0x80 >> (w->bit & 7);
+		w->bit++;
+	}
+}
+
+static uint32_t rnd(uint32_t *s)
+{
+	/* xorshift32 */
+	*s ^= *s << 13;
+	*s ^= *s >> 17;
+	*s ^= *s << 5;
+	return *s;
+}
+
+static uint32_t table_select(uint32_t *s)
+{
+	uint32_t t;
+
+	/* Mostly the short tables, a linbits table now and then; 4 and 14 do not exist */
+	do {
+		t = (rnd(s) & 7) ? rnd(s) % 14 : 15 + rnd(s) % 17;
+	} while (t == 4 || t == 14);
+
+	return t;
+}
+
+static void granule(bitw_t *w, uint32_t *s, int lsf, uint32_t part23)
+{
+	uint32_t wsf, bt;
+
+	put(w, part23, 12);
+	/* roughly what fits in part23, sometimes more to hit the error paths */
+	put(w, (rnd(s) & 15) ? rnd(s) % (part23 / 16 + 1) : rnd(s) % 289, 9);
+	put(w, 80 + rnd(s) % 60, 8);                       /* global_gain */
+	put(w, rnd(s) % (lsf ? 512 : 16), lsf ? 9 : 4);     /* scalefac_compress */
+
+	wsf = (rnd(s) & 3) == 0;
+	put(w, wsf, 1);
+	if (wsf) {
+		bt = 1 + rnd(s) % 3;
+		put(w, bt, 2);
+		put(w, bt == 2 ? (rnd(s) & 1) : 0, 1);           /* mixed_block_flag */
+		put(w, table_select(s), 5);
+		put(w, table_select(s), 5);
+		put(w, rnd(s) & 7, 3);                           /* subblock_gain */
+		put(w, rnd(s) & 7, 3);
+		put(w, rnd(s) & 7, 3);
+	} else {
+		put(w, table_select(s), 5);
+		put(w, table_select(s), 5);
+		put(w, table_select(s), 5);
+		put(w, rnd(s) & 15, 4);                          /* region0_count */
+		put(w, rnd(s) & 7, 3);                           /* region1_count */
+	}
+
+	if (!lsf)
+		put(w, rnd(s) & 1, 1);                           /* preflag */
+	put(w, rnd(s) & 1, 1);                               /* scalefac_scale */
+	put(w, rnd(s) & 1, 1);                               /* count1table_select */
+}
+
+size_t mp3_gen(const mp3_gen_cfg *cfg, uint8_t *buf, size_t size)
+{
+	uint32_t s = cfg->seed * 2654435761u + 1;
+	uint32_t len, side, main_bits, part23;
+	int nch = (cfg->mode == 3) ? 1 : 2;
+	int ngr = cfg->lsf ? 1 : 2;
+	int f, gr, ch, i;
+	size_t used = 0;
+	bitw_t w;
+
+	len = (cfg->lsf ? 72 : 144) * 1000 * s_kbps[cfg->lsf][cfg->brIndex] /
+	      s_hz[cfg->lsf][cfg->srIndex];
+	if (cfg->lsf)
+		side = (nch == 1) ? 9 : 17;
+	else
+		side = (nch == 1) ? 17 : 32;
+
+	main_bits = (len - 4 - side) * 8;
+	part23 = main_bits / (ngr * nch);
+	if (part23 > 4095)
+		part23 = 4095;
+
+	for (f = 0; f < cfg->frames; f++) {
+		if (used + len > size)
+			return 0;
+
+		memset(buf + used, 0, len);
+		w.p = buf + used;
+		w.bit = 0;
+
+		/* header */
+		put(&w, 0x7ff, 11);
+		put(&w, cfg->lsf ? 2 : 3, 2);                    /* MPEG-2 / MPEG-1 */
+		put(&w, 1, 2);                                   /* Layer III */
+		put(&w, 1, 1);                                   /* no CRC */
+		put(&w, cfg->brIndex, 4);
+		put(&w, cfg->srIndex, 2);
+		put(&w, 0, 1);                                   /* padding */
+		put(&w, 0, 1);                                   /* private */
+		put(&w, cfg->mode, 2);
+		put(&w, (cfg->mode == 1) ? (rnd(&s) & 3) : 0, 2); /* mode_extension */
+		put(&w, 0, 4);                                   /* copyright, original, emphasis */
+
+		/* side information */
+		if (cfg->lsf) {
+			put(&w, 0, 8);                               /* main_data_begin */
+			put(&w, 0, nch == 1 ? 1 : 2);
+		} else {
+			put(&w, 0, 9);
+			put(&w, 0, nch == 1 ? 5 : 3);
+			for (ch = 0; ch < nch; ch++)
+				put(&w, rnd(&s) & 15, 4);                /* scfsi */
+		}
+		for (gr = 0; gr < ngr; gr++)
+			for (ch = 0; ch < nch; ch++)
+				granule(&w, &s, cfg->lsf, part23);
+
+		/* main data */
+		for (i = 4 + side; i < (int)len; i++)
+			buf[used + i] = (uint8_t)rnd(&s);
+
+		used += len;
+	}
+
+	return used;
+}
@@ -0,0 +1,38 @@
+/**************************************************************************//**
+ * @file     mp3_gen.h
+ *
+ * @brief    Synthetic MPEG audio Layer III streams for the LibMAD host test.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __MP3_GEN_H__
+#define __MP3_GEN_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+	const char *name;
+	int lsf;                /* 0: MPEG-1, 1: MPEG-2 low sampling frequencies */
+	int srIndex;            /* sampling frequency index of the header */
+	int brIndex;            /* bitrate index of the header */
+	int mode;               /* 0 stereo, 1 joint stereo, 2 dual channel, 3 mono */
+	int frames;
+	uint32_t seed;
+} mp3_gen_cfg;
+
+/* The streams mad_test decodes when it is given no files */
+extern const mp3_gen_cfg mp3_gen_corpus[];
+extern const int mp3_gen_corpus_size;
+
+/*
+ * Write cfg->frames frames of syntactically valid Layer III into buf and
+ * return the number of bytes used, 0 if size is too small. Side information
+ * (block types, Huffman tables, gains, stereo modes) and main data are
+ * random, so the output is noise that reaches every decoder path rather
+ * than music; some frames carry Huffman data the decoder rejects.
+ */
+size_t mp3_gen(const mp3_gen_cfg *cfg, uint8_t *buf, size_t size);
+
+#endif /* __MP3_GEN_H__ */
@@ -22,7 +22,13 @@
 # ifndef LIBMAD_FIXED_H
 # define LIBMAD_FIXED_H
 
-# if SIZEOF_INT >= 4
+# if defined(FPM_AARCH64)
+typedef   signed int mad_fixed_t;
+
+/* the whole 64-bit accumulator lives in lo, hi is unused */
+typedef   signed int mad_fixed64hi_t;
+typedef   signed long long mad_fixed64lo_t;
+# elif SIZEOF_INT >= 4
 typedef   signed int mad_fixed_t;
 
 typedef   signed int mad_fixed64hi_t;
@@ -135,6 +141,37 @@ typedef mad_fixed_t mad_sample_t;
 
 #  define MAD_F_SCALEBITS  MAD_F_FRACBITS
 
+/* --- AArch64 ------------------------------------------------------------- */
+
+# elif defined(FPM_AARCH64)
+
+/*
+ * AArch64 has a 32x32->64-bit multiply-accumulate (smaddl), so
+ * the accumulator is kept as one 64-bit value and scaled once at the end of
+ * the sum, as the other accurate ports do, rather than after every product
+ * as FPM_64BIT does. mad_f_mul() compiles to smull/asr.
+ *
+ * mad_fixed64lo_t is 64-bit here; hi is never read.
+ */
+#  if defined(OPT_ACCURACY)
+#   define mad_f_scale64(hi, lo)  \
+    ((void) (hi), (mad_fixed_t)  \
+     (((lo) + (1LL << (MAD_F_SCALEBITS - 1))) >> MAD_F_SCALEBITS))
+#  else
+#   define mad_f_scale64(hi, lo)  \
+    ((void) (hi), (mad_fixed_t) ((lo) >> MAD_F_SCALEBITS))
+#  endif
+
+#  define mad_f_mul(x, y)  \
+    mad_f_scale64(0, (mad_fixed64_t) (x) * (y))
+
+#  define MAD_F_ML0(hi, lo, x, y)	((lo)  = (mad_fixed64_t) (x) * (y))
+#  define MAD_F_MLA(hi, lo, x, y)	((lo) += (mad_fixed64_t) (x) * (y))
+#  define MAD_F_MLN(hi, lo)		((lo)  = -(lo))
+#  define MAD_F_MLZ(hi, lo)		mad_f_scale64((hi), (lo))
+
+#  define MAD_F_SCALEBITS  MAD_F_FRACBITS
+
 /* --- Intel --------------------------------------------------------------- */
 
 # elif defined(FPM_INTEL)
@@ -42,6 +42,12 @@
 #  define OPT_SSO
 # endif
 
+/* NEON kernels in synth.c and layer3.c, see fixed.h for FPM_AARCH64 */
+
+# if defined(FPM_AARCH64) && defined(__ARM_NEON) && !defined(ASO_NEON)
+#  define ASO_NEON
+# endif
+
 # if defined(HAVE_UNISTD_H) && defined(HAVE_WAITPID) &&  \
     defined(HAVE_FCNTL) && defined(HAVE_PIPE) && defined(HAVE_FORK)
 #  define USE_ASYNC
@@ -28,7 +28,11 @@ extern "C" {
 // #define malloc malloc_dbg
 // #define calloc calloc_dbg
 
-#ifndef __WINS__       // This only works on target machine
+#if defined(FPM_AARCH64) || defined(FPM_64BIT) || defined(FPM_DEFAULT)
+                       // picked by the build
+#elif defined(__aarch64__)
+# define FPM_AARCH64   // 64-bit accumulators, see fixed.h
+#elif !defined(__WINS__) // This only works on target machine
 # define FPM_ARM
 //# define OPT_SPEED
 //# define FPM_DEFAULT
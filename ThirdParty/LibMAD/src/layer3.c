@@ -46,6 +46,10 @@
 # include "huffman.h"
 # include "layer3.h"
 
+# if defined(ASO_NEON)
+#  include <arm_neon.h>
+# endif
+
 /* --- Layer III ----------------------------------------------------------- */
 
 enum {
@@ -1534,6 +1538,105 @@ enum mad_error III_stereo(mad_fixed_t xr[2][576],
   return MAD_ERROR_NONE;
 }
 
+# if defined(ASO_NEON)
+/*
+ * NEON helpers. Products are accumulated in 64-bit lanes exactly as
+ * MAD_F_MLA does and scaled by the narrowing shift, so every kernel built
+ * on them gives the same bits as its C counterpart.
+ */
+#  if defined(OPT_ACCURACY)
+#   define NEON_MLZ(acc)	vrshrn_n_s64((acc), MAD_F_SCALEBITS)
+#  else
+#   define NEON_MLZ(acc)	vshrn_n_s64((acc), MAD_F_SCALEBITS)
+#  endif
+
+static inline
+int32x4_t neon_rev(int32x4_t x)
+{
+  x = vrev64q_s32(x);
+  return vextq_s32(x, x, 2);
+}
+
+/*
+ * NAME:	neon_mla2()
+ * DESCRIPTION:	x[i] * c[i] + y[i] * s[i] for 4 entries
+ */
+static inline
+int32x4_t neon_mla2(int32x4_t x, int32x4_t c, int32x4_t y, int32x4_t s)
+{
+  int64x2_t lo, hi;
+
+  lo = vmull_s32(vget_low_s32(x), vget_low_s32(c));
+  lo = vmlal_s32(lo, vget_low_s32(y), vget_low_s32(s));
+  hi = vmull_high_s32(x, c);
+  hi = vmlal_high_s32(hi, y, s);
+
+  return vcombine_s32(NEON_MLZ(lo), NEON_MLZ(hi));
+}
+
+/*
+ * NAME:	neon_mul()
+ * DESCRIPTION:	z[i] = mad_f_mul(x[i], w[i]) for n entries
+ */
+static
+void neon_mul(mad_fixed_t *z, mad_fixed_t const *x,
+	      mad_fixed_t const *w, unsigned int n)
+{
+  int32x4_t a, b;
+
+  for (; n >= 4; n -= 4, z += 4, x += 4, w += 4) {
+    a = vld1q_s32(x);
+    b = vld1q_s32(w);
+    vst1q_s32(z, vcombine_s32(NEON_MLZ(vmull_s32(vget_low_s32(a),
+						   vget_low_s32(b))),
+			      NEON_MLZ(vmull_high_s32(a, b))));
+  }
+  if (n >= 2) {
+    vst1_s32(z, NEON_MLZ(vmull_s32(vld1_s32(x), vld1_s32(w))));
+    n -= 2, z += 2, x += 2, w += 2;
+  }
+  if (n)
+    *z = mad_f_mul(*x, *w);
+}
+
+/*
+ * NAME:	neon_mul2x6()
+ * DESCRIPTION:	z[i] = x0[i] * w0[i] + x1[i] * w1[i] for 6 entries
+ */
+static
+void neon_mul2x6(mad_fixed_t z[6],
+		 mad_fixed_t const x0[6], mad_fixed_t const w0[6],
+		 mad_fixed_t const x1[6], mad_fixed_t const w1[6])
+{
+  int64x2_t tl;
+
+  vst1q_s32(z, neon_mla2(vld1q_s32(x0), vld1q_s32(w0),
+			 vld1q_s32(x1), vld1q_s32(w1)));
+
+  tl = vmull_s32(vld1_s32(x0 + 4), vld1_s32(w0 + 4));
+  tl = vmlal_s32(tl, vld1_s32(x1 + 4), vld1_s32(w1 + 4));
+  vst1_s32(z + 4, NEON_MLZ(tl));
+}
+
+/*
+ * NAME:	neon_dot6()
+ * DESCRIPTION:	6-tap dot product of x (x0, x1) with s[6]
+ */
+static inline
+mad_fixed_t neon_dot6(mad_fixed_t const s[6], int32x4_t x0, int32x2_t x1)
+{
+  int32x4_t c;
+  int64x2_t acc;
+
+  c   = vld1q_s32(s);
+  acc = vmull_s32(vget_low_s32(x0), vget_low_s32(c));
+  acc = vmlal_high_s32(acc, x0, c);
+  acc = vmlal_s32(acc, x1, vld1_s32(s + 4));
+
+  return mad_f_scale64(0, vaddvq_s64(acc));
+}
+# endif  /* ASO_NEON */
+
 /*
  * NAME:	III_aliasreduce()
  * DESCRIPTION:	perform frequency line alias reduction
@@ -1542,6 +1645,35 @@ static
 void III_aliasreduce(mad_fixed_t xr[576], int lines)
 {
   mad_fixed_t const *bound;
+# if defined(ASO_NEON)
+  int32x4_t cs0, cs1, ca0, ca1;
+  int32x4_t a0, a1, b0, b1;
+
+  /*
+   * The eight butterflies of a subband boundary at once: a[] are the lines
+   * below the boundary read downwards, b[] the lines above it.
+   */
+  cs0 = vld1q_s32(&cs[0]);
+  cs1 = vld1q_s32(&cs[4]);
+  ca0 = vld1q_s32(&ca[0]);
+  ca1 = vld1q_s32(&ca[4]);
+
+  bound = &xr[lines];
+  for (xr += 18; xr < bound; xr += 18) {
+    a0 = neon_rev(vld1q_s32(&xr[-4]));
+    a1 = neon_rev(vld1q_s32(&xr[-8]));
+    b0 = vld1q_s32(&xr[0]);
+    b1 = vld1q_s32(&xr[4]);
+
+    /* a * cs - b * ca, with b negated first as the C version does */
+    vst1q_s32(&xr[-4], neon_rev(neon_mla2(a0, cs0, vnegq_s32(b0), ca0)));
+    vst1q_s32(&xr[-8], neon_rev(neon_mla2(a1, cs1, vnegq_s32(b1), ca1)));
+
+    /* b * cs + a * ca */
+    vst1q_s32(&xr[0], neon_mla2(b0, cs0, a0, ca0));
+    vst1q_s32(&xr[4], neon_mla2(b1, cs1, a1, ca1));
+  }
+# else
   int i;
 
   bound = &xr[lines];
@@ -1571,6 +1703,7 @@ void III_aliasreduce(mad_fixed_t xr[576], int lines)
 # endif
     }
   }
+# endif
 }
 
 # if defined(ASO_IMDCT)
@@ -1714,11 +1847,15 @@ void dctIV(mad_fixed_t const y[18], mad_fixed_t X[18])
 
   /* scaling */
 
+# if defined(ASO_NEON)
+  neon_mul(tmp, y, scale, 18);
+# else
   for (i = 0; i < 18; i += 3) {
     tmp[i + 0] = mad_f_mul(y[i + 0], scale[i + 0]);
     tmp[i + 1] = mad_f_mul(y[i + 1], scale[i + 1]);
     tmp[i + 2] = mad_f_mul(y[i + 2], scale[i + 2]);
   }
+# endif
 
   /* SDCT-II */
 
@@ -2071,7 +2208,7 @@ void imdct36(mad_fixed_t const X[18], mad_fixed_t x[36])
  * NAME:	III_imdct_l()
  * DESCRIPTION:	perform IMDCT and windowing for long blocks
  */
-#  ifndef __WINS__
+#  if !defined(__WINS__) && !defined(FPM_AARCH64)
 void III_imdct_l(mad_fixed_t const X[18], mad_fixed_t z[36], unsigned int block_type);
 #  else
 static
@@ -2088,7 +2225,9 @@ void III_imdct_l(mad_fixed_t const X[18], mad_fixed_t z[36],
 
   switch (block_type) {
   case 0:  /* normal window */
-# if defined(ASO_INTERLEAVE1)
+# if defined(ASO_NEON)
+    neon_mul(z, z, window_l, 36);
+# elif defined(ASO_INTERLEAVE1)
     {
       register mad_fixed_t tmp1, tmp2;
 
@@ -2133,6 +2272,10 @@ void III_imdct_l(mad_fixed_t const X[18], mad_fixed_t z[36],
     break;
 
   case 1:  /* start block */
+# if defined(ASO_NEON)
+    neon_mul(&z[0], &z[0], &window_l[0], 18);
+    neon_mul(&z[24], &z[24], &window_s[6], 6);
+# else
     for (i =  0; i < 18; i += 3) {
       z[i + 0] = mad_f_mul(z[i + 0], window_l[i + 0]);
       z[i + 1] = mad_f_mul(z[i + 1], window_l[i + 1]);
@@ -2140,11 +2283,16 @@ void III_imdct_l(mad_fixed_t const X[18], mad_fixed_t z[36],
     }
     /*  (i = 18; i < 24; ++i) z[i] unchanged */
     for (i = 24; i < 30; ++i) z[i] = mad_f_mul(z[i], window_s[i - 18]);
+# endif
     for (i = 30; i < 36; ++i) z[i] = 0;
     break;
 
   case 3:  /* stop block */
     for (i =  0; i <  6; ++i) z[i] = 0;
+# if defined(ASO_NEON)
+    neon_mul(&z[6], &z[6], &window_s[0], 6);
+    neon_mul(&z[18], &z[18], &window_l[18], 18);
+# else
     for (i =  6; i < 12; ++i) z[i] = mad_f_mul(z[i], window_s[i - 6]);
     /*  (i = 12; i < 18; ++i) z[i] unchanged */
     for (i = 18; i < 36; i += 3) {
@@ -2152,12 +2300,59 @@ void III_imdct_l(mad_fixed_t const X[18], mad_fixed_t z[36],
       z[i + 1] = mad_f_mul(z[i + 1], window_l[i + 1]);
       z[i + 2] = mad_f_mul(z[i + 2], window_l[i + 2]);
     }
+# endif
     break;
   }
 }
 #  endif
 # endif  /* ASO_IMDCT */
 
+# if defined(ASO_NEON)
+/*
+ * NAME:	III_imdct_s()
+ * DESCRIPTION:	perform IMDCT and windowing for short blocks
+ */
+static
+void III_imdct_s(mad_fixed_t const X[18], mad_fixed_t z[36])
+{
+  mad_fixed_t y[36], *yptr;
+  int32x4_t x0;
+  int32x2_t x1;
+  int w, i;
+
+  /* IMDCT, each output is a 6-tap dot product of a window with imdct_s[] */
+
+  yptr = &y[0];
+
+  for (w = 0; w < 3; ++w) {
+    x0 = vld1q_s32(&X[0]);
+    x1 = vld1_s32(&X[4]);
+
+    for (i = 0; i < 3; ++i) {
+      yptr[i + 0] = neon_dot6(imdct_s[2 * i + 0], x0, x1);
+      yptr[5 - i] = -yptr[i + 0];
+
+      yptr[ i + 6] = neon_dot6(imdct_s[2 * i + 1], x0, x1);
+      yptr[11 - i] = yptr[i + 6];
+    }
+
+    yptr += 12;
+    X    += 6;
+  }
+
+  /* windowing, overlapping and concatenation */
+
+  for (i = 0; i < 6; ++i) {
+    z[i +  0] = 0;
+    z[i + 30] = 0;
+  }
+
+  neon_mul(&z[6], &y[0], &window_s[0], 6);
+  neon_mul2x6(&z[12], &y[ 6], &window_s[6], &y[12], &window_s[0]);
+  neon_mul2x6(&z[18], &y[18], &window_s[6], &y[24], &window_s[0]);
+  neon_mul(&z[24], &y[30], &window_s[6], 6);
+}
+# else
 /*
  * NAME:	III_imdct_s()
  * DESCRIPTION:	perform IMDCT and windowing for short blocks
@@ -2236,6 +2431,7 @@ void III_imdct_s(mad_fixed_t const X[18], mad_fixed_t z[36])
     ++wptr;
   }
 }
+# endif
 
 /*
  * NAME:	III_overlap()
@@ -31,6 +31,10 @@
 # include "frame.h"
 # include "synth.h"
 
+# if defined(ASO_NEON) && !defined(OPT_SSO)
+#  include <arm_neon.h>
+# endif
+
 /*
  * The following utility routine performs simple rounding, clipping, and
  * scaling of MAD's high-resolution samples down to 16 bits. It does not
@@ -575,6 +579,182 @@ mad_fixed_t const D[17][32] = {
 # if defined(ASO_SYNTH)
 void synth_full(struct mad_synth *, struct mad_frame const *,
 		unsigned int, unsigned int);
+# elif defined(ASO_NEON) && !defined(OPT_SSO)
+/*
+ * The taps of one output are every other entry of a D[] row. Rows are read
+ * in ascending order with vld2q_s32, and the filter outputs are permuted
+ * once per subband to match instead:
+ *
+ *   f[0] D[p] + f[1] D[p + 14] + ... + f[7] D[p + 2]
+ *     == (f[0], f[7], f[6], ..., f[1]) . (D[p], D[p + 2], ..., D[p + 14])
+ *
+ * The products are summed in 64-bit lanes; that sum does not depend on the
+ * order, so the PCM is bit-exact with the C version below.
+ */
+
+typedef struct {
+  int32x4_t lo, hi;
+} synth_vec;
+
+static inline
+synth_vec synth_load(mad_fixed_t const f[8])
+{
+  synth_vec v;
+
+  v.lo = vld1q_s32(&f[0]);
+  v.hi = vld1q_s32(&f[4]);
+
+  return v;
+}
+
+/* D[p], D[p + 2], ..., D[p + 14] */
+static inline
+synth_vec synth_taps(mad_fixed_t const *ptr)
+{
+  synth_vec v;
+
+  v.lo = vld2q_s32(&ptr[0]).val[0];
+  v.hi = vld2q_s32(&ptr[8]).val[0];
+
+  return v;
+}
+
+/* f[0], f[7], f[6], ..., f[1] */
+static inline
+synth_vec synth_perm(synth_vec f)
+{
+  synth_vec v;
+  int32x4_t rlo, rhi;
+
+  rlo = vrev64q_s32(f.lo);
+  rlo = vextq_s32(rlo, rlo, 2);
+  rhi = vrev64q_s32(f.hi);
+  rhi = vextq_s32(rhi, rhi, 2);
+
+  v.lo = vextq_s32(rlo, rhi, 3);
+  v.hi = vextq_s32(rhi, rlo, 3);
+
+  return v;
+}
+
+static inline
+int64x2_t synth_mla(int64x2_t acc, synth_vec f, synth_vec d)
+{
+  acc = vmlal_s32(acc, vget_low_s32(f.lo), vget_low_s32(d.lo));
+  acc = vmlal_high_s32(acc, f.lo, d.lo);
+  acc = vmlal_s32(acc, vget_low_s32(f.hi), vget_low_s32(d.hi));
+  acc = vmlal_high_s32(acc, f.hi, d.hi);
+
+  return acc;
+}
+
+static inline
+int64x2_t synth_mls(int64x2_t acc, synth_vec f, synth_vec d)
+{
+  acc = vmlsl_s32(acc, vget_low_s32(f.lo), vget_low_s32(d.lo));
+  acc = vmlsl_high_s32(acc, f.lo, d.lo);
+  acc = vmlsl_s32(acc, vget_low_s32(f.hi), vget_low_s32(d.hi));
+  acc = vmlsl_high_s32(acc, f.hi, d.hi);
+
+  return acc;
+}
+
+static inline
+mad_fixed_t synth_mlz(int64x2_t acc)
+{
+  register mad_fixed64hi_t hi = 0;
+  register mad_fixed64lo_t lo;
+
+  lo = vaddvq_s64(acc);
+
+  return MLZ(hi, lo);
+}
+
+/*
+ * NAME:	synth->full()
+ * DESCRIPTION:	perform full frequency PCM synthesis
+ */
+static
+void synth_full(struct mad_synth *synth, struct mad_frame const *frame,
+		unsigned int nch, unsigned int ns)
+{
+  unsigned int phase, ch, s, sb, pe, po;
+  short *pcm1, *pcm2;
+  mad_fixed_t (*filter)[2][2][16][8];
+  mad_fixed_t const (*sbsample)[36][32];
+  mad_fixed_t (*fe)[8], (*fx)[8], (*fo)[8];
+  mad_fixed_t const (*Dptr)[32];
+  synth_vec ve, vo, pve, pvo;
+  int64x2_t acc;
+
+  for (ch = 0; ch < nch; ++ch) {
+    sbsample = &frame->sbsample[ch];
+    filter   = &synth->filter[ch];
+    phase    = synth->phase;
+    pcm1     = synth->pcm.samples[ch];
+
+    for (s = 0; s < ns; ++s) {
+      dct32((*sbsample)[s], phase >> 1,
+	    (*filter)[0][phase & 1], (*filter)[1][phase & 1]);
+
+      pe = phase & ~1;
+      po = ((phase - 1) & 0xf) | 1;
+
+      /* calculate 32 samples */
+
+      fe = &(*filter)[0][ phase & 1][0];
+      fx = &(*filter)[0][~phase & 1][0];
+      fo = &(*filter)[1][~phase & 1][0];
+
+      Dptr = &D[0];
+
+      pve = synth_perm(synth_load(*fe));
+      acc = vdupq_n_s64(0);
+      acc = synth_mls(acc, synth_perm(synth_load(*fx)), synth_taps(*Dptr + po));
+      acc = synth_mla(acc, pve, synth_taps(*Dptr + pe));
+
+      *pcm1++ = (short) scale(SHIFT(synth_mlz(acc)));
+
+      pcm2 = pcm1 + 30;
+
+      for (sb = 1; sb < 16; ++sb) {
+	++fe;
+	++Dptr;
+
+	/* D[32 - sb][i] == -D[sb][31 - i] */
+
+	ve  = synth_load(*fe);
+	vo  = synth_load(*fo);
+	pve = synth_perm(ve);
+	pvo = synth_perm(vo);
+
+	acc = vdupq_n_s64(0);
+	acc = synth_mls(acc, pvo, synth_taps(*Dptr + po));
+	acc = synth_mla(acc, pve, synth_taps(*Dptr + pe));
+
+	*pcm1++ = (short) scale(SHIFT(synth_mlz(acc)));
+
+	acc = vdupq_n_s64(0);
+	acc = synth_mla(acc, ve, synth_taps(*Dptr + 15 - pe));
+	acc = synth_mla(acc, vo, synth_taps(*Dptr + 15 - po));
+
+	*pcm2-- = (short) scale(SHIFT(synth_mlz(acc)));
+
+	++fo;
+      }
+
+      ++Dptr;
+
+      acc = vdupq_n_s64(0);
+      acc = synth_mla(acc, synth_perm(synth_load(*fo)), synth_taps(*Dptr + po));
+
+      *pcm1 = (short) scale(SHIFT(-synth_mlz(acc)));
+      pcm1 += 16;
+
+      phase = (phase + 1) % 16;
+    }
+  }
+}
 # else
 /*
  * NAME:	synth->full()
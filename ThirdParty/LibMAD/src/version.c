@@ -48,6 +48,8 @@ char const mad_build[] = ""
 
 # if defined(FPM_64BIT)
   "FPM_64BIT "
+# elif defined(FPM_AARCH64)
+  "FPM_AARCH64 "
 # elif defined(FPM_INTEL)
   "FPM_INTEL "
 # elif defined(FPM_ARM)
@@ -0,0 +1,11 @@
+/*
+ * Minimal <sys/types.h> for the freestanding host build of yaffs2. The
+ * u-boot headers in this tree provide the rest of the POSIX types.
+ */
+#ifndef __YHOST_SYS_TYPES_H__
+#define __YHOST_SYS_TYPES_H__
+
+typedef unsigned long dev_t;
+typedef unsigned int mode_t;
+
+#endif /* __YHOST_SYS_TYPES_H__ */
@@ -0,0 +1,384 @@
+/**************************************************************************//**
+ * @file     nandsim.c
+ *
+ * @brief    Host-side NAND flash simulator used to run yaffs2 on a PC.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nandsim.h"
+
+#define NANDSIM_ECC_STEP	512
+#define NANDSIM_MAX_STEPS	(8192 / NANDSIM_ECC_STEP)
+
+/* Page state */
+#define PAGE_ERASED		0
+#define PAGE_PROGRAMMED		1
+
+struct nandsim {
+	struct nandsim_cfg cfg;
+	unsigned int n_pages;
+	unsigned int raw_size;		/* page + oob */
+	unsigned int ecc_t;		/* correctable bits per step */
+	unsigned char *array;
+	unsigned char *state;		/* per page */
+	unsigned char *errs;		/* persistent bit errors per page */
+	unsigned short *next_page;	/* per block, program order check */
+	unsigned int *erase_count;	/* per block */
+	unsigned long long rng;
+	struct nandsim_stats st;
+};
+
+/* BCH parity bytes, rows: 2K/4K/8K page, columns: none/T8/T12/T24 */
+static const unsigned int nandsim_parity[3][4] = {
+	{ 0,  60,   92,   90  },
+	{ 0,  120,  184,  180 },
+	{ 0,  240,  368,  360 },
+};
+
+/* Correctable bits per step for the same columns */
+static const unsigned int nandsim_bch_t[4] = { 0, 8, 12, 24 };
+
+static int nandsim_ecc_algo(unsigned int strength)
+{
+	if (strength == 0)
+		return 0;
+	if (strength <= 8)
+		return 1;
+	if (strength <= 12)
+		return 2;
+	return 3;
+}
+
+static unsigned long long nandsim_rand(struct nandsim *sim)
+{
+	/* xorshift64* */
+	sim->rng ^= sim->rng >> 12;
+	sim->rng ^= sim->rng << 25;
+	sim->rng ^= sim->rng >> 27;
+	return sim->rng * 0x2545F4914F6CDD1DULL;
+}
+
+static int nandsim_chance(struct nandsim *sim, unsigned int ppm)
+{
+	if (!ppm)
+		return 0;
+	return (nandsim_rand(sim) % 1000000) < ppm;
+}
+
+static unsigned char *nandsim_page(struct nandsim *sim, unsigned int page)
+{
+	return sim->array + (size_t)page * sim->raw_size;
+}
+
+static void nandsim_flip_bits(struct nandsim *sim, unsigned char *buf,
+			      unsigned int len, unsigned int nbits)
+{
+	unsigned int bit;
+
+	while (nbits--) {
+		bit = nandsim_rand(sim) % (len * 8);
+		buf[bit >> 3] ^= 1 << (bit & 7);
+	}
+}
+
+void nandsim_default_cfg(struct nandsim_cfg *cfg)
+{
+	memset(cfg, 0, sizeof(*cfg));
+
+	/* 128 MiB SLC, 2K page, BCH T8 as configured by nfi_nand.c */
+	cfg->page_size = 2048;
+	cfg->oob_size = 64;
+	cfg->pages_per_block = 64;
+	cfg->n_blocks = 1024;
+	cfg->ecc_strength = 8;
+	cfg->flip_max = 4;
+	cfg->seed = 1;
+
+	cfg->t_read = 25000;
+	cfg->t_prog = 250000;
+	cfg->t_erase = 2000000;
+	cfg->t_byte = 25;		/* 40 MB/s */
+}
+
+unsigned int nandsim_parity_bytes(const struct nandsim_cfg *cfg)
+{
+	return nandsim_parity[cfg->page_size >> 12][nandsim_ecc_algo(cfg->ecc_strength)];
+}
+
+struct nandsim *nandsim_create(const struct nandsim_cfg *cfg)
+{
+	struct nandsim *sim;
+	unsigned int i, blk;
+	size_t size;
+
+	if (cfg->page_size != 2048 && cfg->page_size != 4096 &&
+	    cfg->page_size != 8192)
+		return NULL;
+	if (cfg->ecc_strength > 24 || !cfg->pages_per_block ||
+	    cfg->pages_per_block > 0xffff || cfg->n_blocks < 2 ||
+	    cfg->bad_blocks >= cfg->n_blocks - 1)
+		return NULL;
+	if (cfg->oob_size < nandsim_parity_bytes(cfg) + 4)
+		return NULL;
+
+	sim = calloc(1, sizeof(*sim));
+	if (!sim)
+		return NULL;
+
+	sim->cfg = *cfg;
+	sim->n_pages = cfg->n_blocks * cfg->pages_per_block;
+	sim->raw_size = cfg->page_size + cfg->oob_size;
+	sim->ecc_t = nandsim_bch_t[nandsim_ecc_algo(cfg->ecc_strength)];
+	sim->rng = 0x9E3779B97F4A7C15ULL ^ cfg->seed;
+	if (!sim->rng)
+		sim->rng = 1;
+
+	size = (size_t)sim->n_pages * sim->raw_size;
+	sim->array = malloc(size);
+	sim->state = calloc(sim->n_pages, 1);
+	sim->errs = calloc(sim->n_pages, 1);
+	sim->next_page = calloc(cfg->n_blocks, sizeof(*sim->next_page));
+	sim->erase_count = calloc(cfg->n_blocks, sizeof(*sim->erase_count));
+	if (!sim->array || !sim->state || !sim->errs || !sim->next_page ||
+	    !sim->erase_count) {
+		nandsim_destroy(sim);
+		return NULL;
+	}
+	memset(sim->array, 0xff, size);
+
+	/* Factory bad blocks carry a non-0xFF marker in the first OOB byte. */
+	for (i = 0; i < cfg->bad_blocks; ) {
+		blk = 1 + nandsim_rand(sim) % (cfg->n_blocks - 1);
+		if (nandsim_is_bad(sim, blk))
+			continue;
+		nandsim_page(sim, blk * cfg->pages_per_block)[cfg->page_size] = 0x00;
+		i++;
+	}
+
+	return sim;
+}
+
+void nandsim_destroy(struct nandsim *sim)
+{
+	if (!sim)
+		return;
+	free(sim->array);
+	free(sim->state);
+	free(sim->errs);
+	free(sim->next_page);
+	free(sim->erase_count);
+	free(sim);
+}
+
+const struct nandsim_cfg *nandsim_get_cfg(const struct nandsim *sim)
+{
+	return &sim->cfg;
+}
+
+int nandsim_read_page(struct nandsim *sim, unsigned int page,
+		      unsigned char *data, unsigned char *oob)
+{
+	unsigned int steps, nerr, i, step;
+	unsigned char per_step[NANDSIM_MAX_STEPS];
+	unsigned char *p;
+	int max_flips = 0, failed = 0;
+
+	if (page >= sim->n_pages)
+		return -EINVAL;
+
+	p = nandsim_page(sim, page);
+	sim->st.n_reads++;
+	sim->st.busy_ns += sim->cfg.t_read +
+		(unsigned long long)sim->cfg.t_byte *
+		((data ? sim->cfg.page_size : 0) + (oob ? sim->cfg.oob_size : 0));
+
+	if (data)
+		memcpy(data, p, sim->cfg.page_size);
+	if (oob)
+		memcpy(oob, p + sim->cfg.page_size, sim->cfg.oob_size);
+
+	/* The controller reports erased pages as clean. */
+	if (sim->state[page] == PAGE_ERASED)
+		return 0;
+
+	nerr = sim->errs[page];
+	if (nandsim_chance(sim, sim->cfg.flip_ppm)) {
+		sim->st.n_flip_events++;
+		nerr += 1 + nandsim_rand(sim) % (sim->cfg.flip_max ? sim->cfg.flip_max : 1);
+	}
+	if (!nerr)
+		return 0;
+
+	if (!sim->ecc_t) {
+		if (data)
+			nandsim_flip_bits(sim, data, sim->cfg.page_size, nerr);
+		return 0;
+	}
+
+	steps = sim->cfg.page_size / NANDSIM_ECC_STEP;
+	memset(per_step, 0, sizeof(per_step));
+	for (i = 0; i < nerr; i++) {
+		step = nandsim_rand(sim) % steps;
+		if (per_step[step] < 0xff)
+			per_step[step]++;
+	}
+
+	for (i = 0; i < steps; i++) {
+		if (per_step[i] <= sim->ecc_t) {
+			sim->st.n_corrected += per_step[i];
+			if (per_step[i] > max_flips)
+				max_flips = per_step[i];
+		} else {
+			sim->st.n_uncorrectable++;
+			failed = 1;
+			if (data)
+				nandsim_flip_bits(sim, data + i * NANDSIM_ECC_STEP,
+						  NANDSIM_ECC_STEP, per_step[i]);
+		}
+	}
+
+	return failed ? -EBADMSG : max_flips;
+}
+
+int nandsim_prog_page(struct nandsim *sim, unsigned int page,
+		      const unsigned char *data, const unsigned char *oob)
+{
+	unsigned int blk, idx, i;
+	unsigned char *p;
+
+	if (page >= sim->n_pages)
+		return -EINVAL;
+
+	blk = page / sim->cfg.pages_per_block;
+	idx = page % sim->cfg.pages_per_block;
+	p = nandsim_page(sim, page);
+
+	sim->st.n_progs++;
+	sim->st.busy_ns += sim->cfg.t_prog +
+		(unsigned long long)sim->cfg.t_byte * sim->raw_size;
+
+	if (sim->state[page] != PAGE_ERASED)
+		sim->st.n_reprogram++;
+	if (idx < sim->next_page[blk])
+		sim->st.n_out_of_order++;
+	sim->next_page[blk] = idx + 1;
+	sim->state[page] = PAGE_PROGRAMMED;
+
+	/* Programming can only clear bits. */
+	if (data)
+		for (i = 0; i < sim->cfg.page_size; i++)
+			p[i] &= data[i];
+	if (oob)
+		for (i = 0; i < sim->cfg.oob_size; i++)
+			p[sim->cfg.page_size + i] &= oob[i];
+
+	if (nandsim_chance(sim, sim->cfg.prog_fail_ppm)) {
+		sim->st.n_prog_fail++;
+		return -EIO;
+	}
+	return 0;
+}
+
+int nandsim_erase_block(struct nandsim *sim, unsigned int block)
+{
+	unsigned int first;
+
+	if (block >= sim->cfg.n_blocks)
+		return -EINVAL;
+
+	sim->st.n_erases++;
+	sim->st.busy_ns += sim->cfg.t_erase;
+	sim->erase_count[block]++;
+
+	if (nandsim_chance(sim, sim->cfg.erase_fail_ppm)) {
+		sim->st.n_erase_fail++;
+		return -EIO;
+	}
+
+	first = block * sim->cfg.pages_per_block;
+	memset(nandsim_page(sim, first), 0xff,
+	       (size_t)sim->cfg.pages_per_block * sim->raw_size);
+	memset(sim->state + first, PAGE_ERASED, sim->cfg.pages_per_block);
+	memset(sim->errs + first, 0, sim->cfg.pages_per_block);
+	sim->next_page[block] = 0;
+	return 0;
+}
+
+int nandsim_is_bad(struct nandsim *sim, unsigned int block)
+{
+	unsigned int page;
+
+	if (block >= sim->cfg.n_blocks)
+		return -EINVAL;
+
+	/* Marker in the first OOB byte of the first or second page */
+	page = block * sim->cfg.pages_per_block;
+	if (nandsim_page(sim, page)[sim->cfg.page_size] != 0xff)
+		return 1;
+	if (sim->cfg.pages_per_block > 1 &&
+	    nandsim_page(sim, page + 1)[sim->cfg.page_size] != 0xff)
+		return 1;
+	return 0;
+}
+
+int nandsim_mark_bad(struct nandsim *sim, unsigned int block)
+{
+	unsigned int page;
+
+	if (block >= sim->cfg.n_blocks)
+		return -EINVAL;
+
+	page = block * sim->cfg.pages_per_block;
+	nandsim_page(sim, page)[sim->cfg.page_size] = 0x00;
+	if (sim->cfg.pages_per_block > 1)
+		nandsim_page(sim, page + 1)[sim->cfg.page_size] = 0x00;
+
+	sim->st.n_markbad++;
+	sim->st.busy_ns += sim->cfg.t_prog;
+	return 0;
+}
+
+void nandsim_inject_flips(struct nandsim *sim, unsigned int page,
+			  unsigned int nbits)
+{
+	unsigned int n;
+
+	if (page >= sim->n_pages)
+		return;
+	n = sim->errs[page] + nbits;
+	sim->errs[page] = n > 0xff ? 0xff : n;
+}
+
+void nandsim_get_stats(const struct nandsim *sim, struct nandsim_stats *st)
+{
+	*st = sim->st;
+}
+
+void nandsim_reset_stats(struct nandsim *sim)
+{
+	memset(&sim->st, 0, sizeof(sim->st));
+}
+
+void nandsim_wear(const struct nandsim *sim, unsigned int *min_erase,
+		  unsigned int *max_erase, double *avg_erase)
+{
+	unsigned long long sum = 0;
+	unsigned int i, lo = ~0u, hi = 0;
+
+	for (i = 0; i < sim->cfg.n_blocks; i++) {
+		if (sim->erase_count[i] < lo)
+			lo = sim->erase_count[i];
+		if (sim->erase_count[i] > hi)
+			hi = sim->erase_count[i];
+		sum += sim->erase_count[i];
+	}
+
+	*min_erase = lo;
+	*max_erase = hi;
+	*avg_erase = (double)sum / sim->cfg.n_blocks;
+}
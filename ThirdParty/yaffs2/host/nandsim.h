@@ -0,0 +1,99 @@
+/**************************************************************************//**
+ * @file     nandsim.h
+ *
+ * @brief    Host-side NAND flash simulator used to run yaffs2 on a PC.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __NANDSIM_H__
+#define __NANDSIM_H__
+
+/*
+ * The simulator keeps the whole array (data + OOB) in host memory and models
+ * what the NFI/BCH pair does on the board: page program only on erased pages,
+ * bad block markers in the first OOB bytes, and BCH correction per 512 byte
+ * step. Transient bit flips can be injected on every page read, persistent
+ * ones (retention errors) on individual pages.
+ *
+ * This header only uses plain C types so it can be included both by the
+ * host benchmark (built against the C library headers) and by the mtd_info
+ * binding (built against the u-boot headers of the yaffs2 tree).
+ */
+
+struct mtd_info;
+struct nandsim;
+
+struct nandsim_cfg {
+	unsigned int page_size;		/* 2048, 4096 or 8192 */
+	unsigned int oob_size;		/* spare bytes per page */
+	unsigned int pages_per_block;
+	unsigned int n_blocks;
+	unsigned int ecc_strength;	/* BCH T per 512 bytes, 0/8/12/24 */
+
+	unsigned int bad_blocks;	/* factory bad blocks, never block 0 */
+	unsigned int flip_ppm;		/* chance per page read of a flip event */
+	unsigned int flip_max;		/* max bits flipped in one event */
+	unsigned int prog_fail_ppm;	/* chance a page program reports fail */
+	unsigned int erase_fail_ppm;	/* chance a block erase reports fail */
+	unsigned int seed;
+
+	/* Timing model, in ns, used for the simulated flash busy time. */
+	unsigned int t_read;		/* tR, array to page register */
+	unsigned int t_prog;		/* tPROG */
+	unsigned int t_erase;		/* tBERS */
+	unsigned int t_byte;		/* bus time per byte moved */
+};
+
+struct nandsim_stats {
+	unsigned long long n_reads;
+	unsigned long long n_progs;
+	unsigned long long n_erases;
+	unsigned long long n_flip_events;
+	unsigned long long n_corrected;		/* bits fixed by ECC */
+	unsigned long long n_uncorrectable;	/* ECC steps beyond T */
+	unsigned long long n_prog_fail;
+	unsigned long long n_erase_fail;
+	unsigned long long n_markbad;
+	unsigned long long n_reprogram;		/* program of a non-erased page */
+	unsigned long long n_out_of_order;	/* program below last page */
+	unsigned long long busy_ns;		/* simulated flash busy time */
+};
+
+void nandsim_default_cfg(struct nandsim_cfg *cfg);
+
+struct nandsim *nandsim_create(const struct nandsim_cfg *cfg);
+void nandsim_destroy(struct nandsim *sim);
+const struct nandsim_cfg *nandsim_get_cfg(const struct nandsim *sim);
+
+/* BCH parity bytes per page, same table as the NFI driver uses. */
+unsigned int nandsim_parity_bytes(const struct nandsim_cfg *cfg);
+
+/*
+ * Page/block access. Read returns the worst bit flip count corrected in one
+ * ECC step (>= 0), -EBADMSG when a step could not be corrected (the data is
+ * still returned, corrupted) or -EINVAL. Program and erase return 0 or -EIO.
+ * data/oob may be NULL to skip that part of the page.
+ */
+int nandsim_read_page(struct nandsim *sim, unsigned int page,
+		      unsigned char *data, unsigned char *oob);
+int nandsim_prog_page(struct nandsim *sim, unsigned int page,
+		      const unsigned char *data, const unsigned char *oob);
+int nandsim_erase_block(struct nandsim *sim, unsigned int block);
+int nandsim_is_bad(struct nandsim *sim, unsigned int block);
+int nandsim_mark_bad(struct nandsim *sim, unsigned int block);
+
+/* Add nbits persistent bit errors to a page, cleared by the next erase. */
+void nandsim_inject_flips(struct nandsim *sim, unsigned int page,
+			  unsigned int nbits);
+
+void nandsim_get_stats(const struct nandsim *sim, struct nandsim_stats *st);
+void nandsim_reset_stats(struct nandsim *sim);
+void nandsim_wear(const struct nandsim *sim, unsigned int *min_erase,
+		  unsigned int *max_erase, double *avg_erase);
+
+/* mtd_info binding, see nandsim_mtd.c */
+struct mtd_info *nandsim_mtd_create(struct nandsim *sim, const char *name);
+void nandsim_mtd_destroy(struct mtd_info *mtd);
+
+#endif /* __NANDSIM_H__ */
@@ -0,0 +1,323 @@
+/**************************************************************************//**
+ * @file     nandsim_mtd.c
+ *
+ * @brief    mtd_info binding of the host NAND simulator.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <string.h>
+#include <common.h>
+#include <linux/errno.h>
+#include <linux/mtd/mtd.h>
+
+#include "nandsim.h"
+
+/*
+ * Presents the simulator through the same mtd_info entry points that
+ * nand_base.c sets up on top of nfi_nand.c, so yaffs_mtdif2.c and the
+ * mtd_*() wrappers in mtdcore.c run unchanged. The OOB layout follows
+ * nuvoton_layout_oob_table(): 4 bytes for the bad block marker, then the
+ * free bytes, then the BCH parity at the end of the spare area.
+ */
+
+#define NANDSIM_OOB_FREE_OFFSET		4
+
+/*
+ * Host C library allocator. The u-boot <malloc.h> pulled in by common.h
+ * declares malloc()/free() with hidden visibility, so bind to the libc
+ * symbols under other names.
+ */
+extern void *host_malloc(size_t size) __asm__("malloc");
+extern void host_free(void *ptr) __asm__("free");
+
+struct nandsim_mtd {
+	struct mtd_info mtd;
+	struct nandsim *sim;
+	u8 *page_buf;
+	u8 *oob_buf;
+	char name[32];
+};
+
+static struct nandsim_mtd *to_nandsim_mtd(struct mtd_info *mtd)
+{
+	return (struct nandsim_mtd *)mtd->priv;
+}
+
+static size_t nandsim_mtd_oob_copy(struct mtd_info *mtd, int mode,
+				   u8 *dst, const u8 *src, size_t len,
+				   u32 ooboffs, int to_oob)
+{
+	u32 base, avail;
+
+	if (mode == MTD_OPS_AUTO_OOB) {
+		base = NANDSIM_OOB_FREE_OFFSET;
+		avail = mtd->oobavail;
+	} else {
+		base = 0;
+		avail = mtd->oobsize;
+	}
+
+	if (ooboffs >= avail)
+		return 0;
+	if (len > avail - ooboffs)
+		len = avail - ooboffs;
+
+	if (to_oob)
+		memcpy(dst + base + ooboffs, src, len);
+	else
+		memcpy(dst, src + base + ooboffs, len);
+	return len;
+}
+
+static int nandsim_mtd_read_oob(struct mtd_info *mtd, loff_t from,
+				struct mtd_oob_ops *ops)
+{
+	struct nandsim_mtd *nsm = to_nandsim_mtd(mtd);
+	u32 page = (u32)(from >> mtd->writesize_shift);
+	u32 col = (u32)(from & mtd->writesize_mask);
+	size_t dleft = ops->datbuf ? ops->len : 0;
+	size_t oleft = ops->oobbuf ? ops->ooblen : 0;
+	u8 *dbuf = ops->datbuf;
+	u8 *obuf = ops->oobbuf;
+	u32 ooboffs = ops->ooboffs;
+	unsigned int max_bitflips = 0;
+	int ecc_failed = 0;
+	size_t n;
+	int ret;
+
+	while (dleft || oleft) {
+		ret = nandsim_read_page(nsm->sim, page,
+					dleft ? nsm->page_buf : NULL,
+					oleft ? nsm->oob_buf : NULL);
+		if (ret == -EBADMSG) {
+			mtd->ecc_stats.failed++;
+			ecc_failed = 1;
+		} else if (ret < 0) {
+			return ret;
+		} else {
+			mtd->ecc_stats.corrected += ret;
+			max_bitflips = max_t(unsigned int, max_bitflips, ret);
+		}
+
+		if (dleft) {
+			n = min_t(size_t, dleft, mtd->writesize - col);
+			memcpy(dbuf, nsm->page_buf + col, n);
+			dbuf += n;
+			dleft -= n;
+			ops->retlen += n;
+			col = 0;
+		}
+
+		if (oleft) {
+			n = nandsim_mtd_oob_copy(mtd, ops->mode, obuf,
+						 nsm->oob_buf, oleft, ooboffs, 0);
+			if (!n)
+				return -EINVAL;
+			obuf += n;
+			oleft -= n;
+			ops->oobretlen += n;
+			ooboffs = 0;
+		}
+
+		page++;
+	}
+
+	return ecc_failed ? -EBADMSG : (int)max_bitflips;
+}
+
+static int nandsim_mtd_write_oob(struct mtd_info *mtd, loff_t to,
+				 struct mtd_oob_ops *ops)
+{
+	struct nandsim_mtd *nsm = to_nandsim_mtd(mtd);
+	u32 page = (u32)(to >> mtd->writesize_shift);
+	size_t dleft = ops->datbuf ? ops->len : 0;
+	size_t oleft = ops->oobbuf ? ops->ooblen : 0;
+	const u8 *dbuf = ops->datbuf;
+	const u8 *obuf = ops->oobbuf;
+	u32 ooboffs = ops->ooboffs;
+	size_t n;
+	int ret;
+
+	/* NAND_NO_SUBPAGE_WRITE, same as the NFI driver */
+	if (to & mtd->writesize_mask)
+		return -EINVAL;
+
+	while (dleft || oleft) {
+		memset(nsm->page_buf, 0xff, mtd->writesize);
+		memset(nsm->oob_buf, 0xff, mtd->oobsize);
+
+		if (dleft) {
+			n = min_t(size_t, dleft, mtd->writesize);
+			memcpy(nsm->page_buf, dbuf, n);
+			dbuf += n;
+			dleft -= n;
+			ops->retlen += n;
+		}
+
+		if (oleft) {
+			n = nandsim_mtd_oob_copy(mtd, ops->mode, nsm->oob_buf,
+						 obuf, oleft, ooboffs, 1);
+			if (!n)
+				return -EINVAL;
+			obuf += n;
+			oleft -= n;
+			ops->oobretlen += n;
+			ooboffs = 0;
+		}
+
+		ret = nandsim_prog_page(nsm->sim, page, nsm->page_buf,
+					nsm->oob_buf);
+		if (ret)
+			return -EIO;
+
+		page++;
+	}
+
+	return 0;
+}
+
+static int nandsim_mtd_read(struct mtd_info *mtd, loff_t from, size_t len,
+			    size_t *retlen, u_char *buf)
+{
+	struct mtd_oob_ops ops;
+	int ret;
+
+	memset(&ops, 0, sizeof(ops));
+	ops.len = len;
+	ops.datbuf = buf;
+	ops.mode = MTD_OPS_PLACE_OOB;
+	ret = nandsim_mtd_read_oob(mtd, from, &ops);
+	*retlen = ops.retlen;
+	return ret;
+}
+
+static int nandsim_mtd_write(struct mtd_info *mtd, loff_t to, size_t len,
+			     size_t *retlen, const u_char *buf)
+{
+	struct mtd_oob_ops ops;
+	int ret;
+
+	memset(&ops, 0, sizeof(ops));
+	ops.len = len;
+	ops.datbuf = (u8 *)buf;
+	ops.mode = MTD_OPS_PLACE_OOB;
+	ret = nandsim_mtd_write_oob(mtd, to, &ops);
+	*retlen = ops.retlen;
+	return ret;
+}
+
+static int nandsim_mtd_erase(struct mtd_info *mtd, struct erase_info *instr)
+{
+	struct nandsim_mtd *nsm = to_nandsim_mtd(mtd);
+	uint64_t addr, end;
+	u32 block;
+
+	if ((instr->addr % mtd->erasesize) || (instr->len % mtd->erasesize))
+		return -EINVAL;
+
+	end = instr->addr + instr->len;
+	for (addr = instr->addr; addr < end; addr += mtd->erasesize) {
+		block = (u32)(addr / mtd->erasesize);
+
+		/* nand_erase_nand() refuses to erase bad blocks */
+		if (nandsim_is_bad(nsm->sim, block) ||
+		    nandsim_erase_block(nsm->sim, block)) {
+			instr->state = MTD_ERASE_FAILED;
+			instr->fail_addr = addr;
+			return -EIO;
+		}
+	}
+
+	instr->state = MTD_ERASE_DONE;
+	mtd_erase_callback(instr);
+	return 0;
+}
+
+static int nandsim_mtd_block_isbad(struct mtd_info *mtd, loff_t ofs)
+{
+	return nandsim_is_bad(to_nandsim_mtd(mtd)->sim,
+			      (u32)(ofs / mtd->erasesize));
+}
+
+static int nandsim_mtd_block_markbad(struct mtd_info *mtd, loff_t ofs)
+{
+	int ret;
+
+	ret = nandsim_mark_bad(to_nandsim_mtd(mtd)->sim,
+			       (u32)(ofs / mtd->erasesize));
+	if (!ret)
+		mtd->ecc_stats.badblocks++;
+	return ret;
+}
+
+struct mtd_info *nandsim_mtd_create(struct nandsim *sim, const char *name)
+{
+	const struct nandsim_cfg *cfg = nandsim_get_cfg(sim);
+	struct nandsim_mtd *nsm;
+	struct mtd_info *mtd;
+	size_t len;
+
+	nsm = host_malloc(sizeof(*nsm));
+	if (!nsm)
+		return NULL;
+	memset(nsm, 0, sizeof(*nsm));
+
+	nsm->sim = sim;
+	nsm->page_buf = host_malloc(cfg->page_size);
+	nsm->oob_buf = host_malloc(cfg->oob_size);
+	if (!nsm->page_buf || !nsm->oob_buf) {
+		host_free(nsm->page_buf);
+		host_free(nsm->oob_buf);
+		host_free(nsm);
+		return NULL;
+	}
+	len = strlen(name);
+	if (len >= sizeof(nsm->name))
+		len = sizeof(nsm->name) - 1;
+	memcpy(nsm->name, name, len);
+
+	mtd = &nsm->mtd;
+	mtd->priv = nsm;
+	mtd->name = nsm->name;
+	mtd->type = MTD_NANDFLASH;
+	mtd->flags = MTD_CAP_NANDFLASH;
+	mtd->writesize = cfg->page_size;
+	mtd->writebufsize = cfg->page_size;
+	mtd->erasesize = cfg->page_size * cfg->pages_per_block;
+	mtd->size = (uint64_t)mtd->erasesize * cfg->n_blocks;
+	mtd->oobsize = cfg->oob_size;
+	mtd->oobavail = cfg->oob_size - NANDSIM_OOB_FREE_OFFSET -
+			nandsim_parity_bytes(cfg);
+	mtd->writesize_shift = __builtin_ctz(mtd->writesize);
+	mtd->writesize_mask = mtd->writesize - 1;
+	if (!(mtd->erasesize & (mtd->erasesize - 1))) {
+		mtd->erasesize_shift = __builtin_ctz(mtd->erasesize);
+		mtd->erasesize_mask = mtd->erasesize - 1;
+	}
+	mtd->ecc_step_size = 512;
+	mtd->ecc_strength = cfg->ecc_strength;
+	mtd->bitflip_threshold = DIV_ROUND_UP(mtd->ecc_strength * 3, 4);
+
+	mtd->_read = nandsim_mtd_read;
+	mtd->_write = nandsim_mtd_write;
+	mtd->_read_oob = nandsim_mtd_read_oob;
+	mtd->_write_oob = nandsim_mtd_write_oob;
+	mtd->_erase = nandsim_mtd_erase;
+	mtd->_block_isbad = nandsim_mtd_block_isbad;
+	mtd->_block_markbad = nandsim_mtd_block_markbad;
+
+	return mtd;
+}
+
+void nandsim_mtd_destroy(struct mtd_info *mtd)
+{
+	struct nandsim_mtd *nsm;
+
+	if (!mtd)
+		return;
+	nsm = to_nandsim_mtd(mtd);
+	host_free(nsm->page_buf);
+	host_free(nsm->oob_buf);
+	host_free(nsm);
+}
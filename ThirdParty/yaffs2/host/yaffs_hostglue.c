@@ -0,0 +1,385 @@
+/**************************************************************************//**
+ * @file     yaffs_hostglue.c
+ *
+ * @brief    yaffs2 OS glue and device setup for the host build.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <common.h>
+#include <stdarg.h>
+#include <linux/mtd/mtd.h>
+
+#include "yaffscfg.h"
+#include "yaffsfs.h"
+#include "yaffs_guts.h"
+#include "yaffs_packedtags2.h"
+#include "yaffs_mtdif.h"
+#include "yaffs_mtdif2.h"
+#include "yaffs_malloc.h"
+
+#include "yaffs_hostglue.h"
+
+/*
+ * Same callbacks as SampleCode/StdDriver/NAND_Yaffs2/yaffs_glue.c, except
+ * that yaffs_malloc() sits on the host heap and keeps count of what yaffs2
+ * holds, which is how the benchmark reports RAM usage.
+ */
+
+#define YHOST_MAX_DEVICES	8
+
+struct yhost_mhdr {
+	size_t size;
+	size_t pad;		/* keep the payload 16 byte aligned */
+};
+
+struct yhost_device {
+	char *mp;
+	struct yaffs_dev *dev;
+};
+
+/*
+ * Host C library. The u-boot <malloc.h> pulled in by common.h declares
+ * malloc()/free() with hidden visibility, so bind to the libc symbols
+ * under other names.
+ */
+extern void *host_malloc(size_t size) __asm__("malloc");
+extern void host_free(void *ptr) __asm__("free");
+extern int vprintf(const char *fmt, va_list ap);
+
+/* yaffsfs.c, not exported by yaffsfs.h */
+extern void yaffs_remove_device(struct yaffs_dev *dev);
+
+unsigned int yaffs_trace_mask = 0x0;	/* Disable logging */
+static int yaffs_errno;
+static struct yhost_device yhost_devices[YHOST_MAX_DEVICES];
+static struct yhost_mem_stats yhost_mem;
+
+void sysprintf(char *pcStr, ...)
+{
+	va_list ap;
+
+	va_start(ap, pcStr);
+	vprintf(pcStr, ap);
+	va_end(ap);
+}
+
+void yaffs_bug_fn(const char *fn, int n)
+{
+	sysprintf("yaffs bug at %s:%d\n", fn, n);
+}
+
+void *yaffs_malloc(size_t size)
+{
+	struct yhost_mhdr *h;
+
+	h = host_malloc(sizeof(*h) + size);
+	if (!h)
+		return NULL;
+
+	h->size = size;
+	yhost_mem.cur_bytes += size;
+	yhost_mem.n_allocs++;
+	yhost_mem.n_live++;
+	if (yhost_mem.cur_bytes > yhost_mem.peak_bytes)
+		yhost_mem.peak_bytes = yhost_mem.cur_bytes;
+	return h + 1;
+}
+
+void yaffs_free(void *ptr)
+{
+	struct yhost_mhdr *h;
+
+	if (!ptr)
+		return;
+
+	h = (struct yhost_mhdr *)ptr - 1;
+	yhost_mem.cur_bytes -= h->size;
+	yhost_mem.n_live--;
+	host_free(h);
+}
+
+void *yaffsfs_malloc(size_t x)
+{
+	return yaffs_malloc(x);
+}
+
+void yaffsfs_free(void *x)
+{
+	yaffs_free(x);
+}
+
+void yaffsfs_SetError(int err)
+{
+	yaffs_errno = err;
+}
+
+int yaffsfs_GetLastError(void)
+{
+	return yaffs_errno;
+}
+
+int yaffsfs_GetError(void)
+{
+	return yaffs_errno;
+}
+
+void yaffsfs_Lock(void)
+{
+}
+
+void yaffsfs_Unlock(void)
+{
+}
+
+u32 yaffsfs_CurrentTime(void)
+{
+	return 0;
+}
+
+void yaffsfs_LocalInitialisation(void)
+{
+	/* No locking used */
+}
+
+int yaffsfs_CheckMemRegion(const void *addr, size_t size, int write_request)
+{
+	(void) size;
+	(void) write_request;
+
+	if (!addr)
+		return -1;
+	return 0;
+}
+
+static struct yhost_device *yhost_find(const char *mp)
+{
+	int i;
+
+	for (i = 0; i < YHOST_MAX_DEVICES; i++)
+		if (yhost_devices[i].dev && strcmp(yhost_devices[i].mp, mp) == 0)
+			return &yhost_devices[i];
+	return NULL;
+}
+
+static void yhost_apply_opts(struct yaffs_dev *dev, struct mtd_info *mtd,
+			     const struct yhost_dev_opts *opts)
+{
+	if (opts->inband_tags < 0)
+		dev->param.inband_tags =
+			mtd->oobavail <= sizeof(struct yaffs_packed_tags2);
+	else
+		dev->param.inband_tags = opts->inband_tags;
+	dev->param.n_caches = opts->n_caches;
+	dev->param.n_reserved_blocks = opts->n_reserved_blocks;
+	dev->param.disable_summary = opts->disable_summary;
+	dev->param.skip_checkpt_rd = opts->skip_checkpt_rd;
+	dev->param.skip_checkpt_wr = opts->skip_checkpt_wr;
+}
+
+void yhost_default_opts(struct yhost_dev_opts *opts)
+{
+	/* Values used by cmd_yaffs_devconfig() on the board */
+	opts->inband_tags = -1;
+	opts->n_caches = 10;
+	opts->n_reserved_blocks = 5;
+	opts->disable_summary = 0;
+	opts->skip_checkpt_rd = 0;
+	opts->skip_checkpt_wr = 0;
+}
+
+int yhost_add_device(const char *mp, struct mtd_info *mtd,
+		     int start_block, int end_block,
+		     const struct yhost_dev_opts *opts)
+{
+	struct yhost_device *slot = NULL;
+	struct yaffs_dev *dev;
+	char *name;
+	int i;
+
+	if (yhost_find(mp))
+		return -1;
+	for (i = 0; i < YHOST_MAX_DEVICES; i++)
+		if (!yhost_devices[i].dev) {
+			slot = &yhost_devices[i];
+			break;
+		}
+	if (!slot)
+		return -1;
+
+	if (end_block == 0)
+		end_block = (int)(mtd->size / mtd->erasesize) - 1;
+	if (end_block < start_block)
+		return -1;
+
+	dev = yaffs_malloc(sizeof(*dev));
+	name = yaffs_malloc(strlen(mp) + 1);
+	if (!dev || !name) {
+		yaffs_free(dev);
+		yaffs_free(name);
+		return -1;
+	}
+	memset(dev, 0, sizeof(*dev));
+	strcpy(name, mp);
+
+	dev->param.name = name;
+	dev->driver_context = mtd;
+	dev->param.start_block = start_block;
+	dev->param.end_block = end_block;
+	dev->param.chunks_per_block = mtd->erasesize / mtd->writesize;
+	dev->param.total_bytes_per_chunk = mtd->writesize;
+	dev->param.is_yaffs2 = 1;
+	dev->param.use_nand_ecc = 1;
+	yhost_apply_opts(dev, mtd, opts);
+	dev->tagger.write_chunk_tags_fn = nandmtd2_write_chunk_tags;
+	dev->tagger.read_chunk_tags_fn = nandmtd2_read_chunk_tags;
+	dev->drv.drv_erase_fn = nandmtd_EraseBlockInNAND;
+	dev->drv.drv_initialise_fn = nandmtd_InitialiseNAND;
+	dev->tagger.mark_bad_fn = nandmtd2_MarkNANDBlockBad;
+	/* yaffs2_checkpt_open() refuses to run without it */
+	dev->drv.drv_mark_bad_fn = nandmtd2_MarkNANDBlockBad;
+	dev->tagger.query_block_fn = nandmtd2_QueryNANDBlock;
+
+	yaffs_add_device(dev);
+
+	slot->mp = name;
+	slot->dev = dev;
+	return 0;
+}
+
+int yhost_remove_device(const char *mp)
+{
+	struct yhost_device *d = yhost_find(mp);
+
+	if (!d)
+		return -1;
+	if (d->dev->is_mounted)
+		yaffs_unmount2(mp, 1);
+
+	yaffs_remove_device(d->dev);
+	yaffs_free(d->dev);
+	yaffs_free(d->mp);
+	d->dev = NULL;
+	d->mp = NULL;
+	return 0;
+}
+
+int yhost_set_opts(const char *mp, const struct yhost_dev_opts *opts)
+{
+	struct yhost_device *d = yhost_find(mp);
+
+	if (!d || d->dev->is_mounted)
+		return -1;
+	yhost_apply_opts(d->dev, (struct mtd_info *)d->dev->driver_context, opts);
+	return 0;
+}
+
+int yhost_get_stats(const char *mp, struct yhost_dev_stats *st)
+{
+	struct yhost_device *d = yhost_find(mp);
+	struct yaffs_dev *dev;
+
+	if (!d)
+		return -1;
+	dev = d->dev;
+
+	st->n_page_writes = dev->n_page_writes;
+	st->n_page_reads = dev->n_page_reads;
+	st->n_erasures = dev->n_erasures;
+	st->n_erase_failures = dev->n_erase_failures;
+	st->n_bad_markings = dev->n_bad_markings;
+	st->n_gc_copies = dev->n_gc_copies;
+	st->n_gc_blocks = dev->n_gc_blocks;
+	st->all_gcs = dev->all_gcs;
+	st->passive_gc_count = dev->passive_gc_count;
+	st->oldest_dirty_gc_count = dev->oldest_dirty_gc_count;
+	st->n_retried_writes = dev->n_retried_writes;
+	st->n_retired_blocks = dev->n_retired_blocks;
+	st->n_ecc_fixed = dev->n_ecc_fixed;
+	st->n_ecc_unfixed = dev->n_ecc_unfixed;
+	st->summary_used = dev->summary_used;
+	st->n_obj = dev->n_obj;
+	st->n_tnodes = dev->n_tnodes;
+	st->n_free_chunks = dev->n_free_chunks;
+	st->n_erased_blocks = dev->n_erased_blocks;
+	st->blocks_in_checkpt = dev->blocks_in_checkpt;
+	st->is_checkpointed = dev->is_checkpointed;
+	st->inband_tags = dev->param.inband_tags;
+	st->data_bytes_per_chunk = dev->data_bytes_per_chunk;
+	return 0;
+}
+
+void yhost_get_mem(struct yhost_mem_stats *mem)
+{
+	*mem = yhost_mem;
+}
+
+void yhost_reset_mem_peak(void)
+{
+	yhost_mem.peak_bytes = yhost_mem.cur_bytes;
+}
+
+void yhost_set_trace(unsigned int mask)
+{
+	yaffs_trace_mask = mask;
+}
+
+int yhost_mount(const char *mp)
+{
+	return yaffs_mount(mp);
+}
+
+int yhost_unmount(const char *mp)
+{
+	return yaffs_unmount(mp);
+}
+
+int yhost_sync(const char *mp)
+{
+	return yaffs_sync(mp);
+}
+
+int yhost_create(const char *path)
+{
+	return yaffs_open(path, O_CREAT | O_TRUNC | O_RDWR, S_IREAD | S_IWRITE);
+}
+
+int yhost_open_read(const char *path)
+{
+	return yaffs_open(path, O_RDONLY, 0);
+}
+
+int yhost_write(int fd, const void *buf, unsigned int nbyte)
+{
+	return yaffs_write(fd, buf, nbyte);
+}
+
+int yhost_read(int fd, void *buf, unsigned int nbyte)
+{
+	return yaffs_read(fd, buf, nbyte);
+}
+
+int yhost_close(int fd)
+{
+	return yaffs_close(fd);
+}
+
+int yhost_unlink(const char *path)
+{
+	return yaffs_unlink(path);
+}
+
+int yhost_mkdir(const char *path)
+{
+	return yaffs_mkdir(path, S_IREAD | S_IWRITE | S_IEXEC);
+}
+
+long long yhost_freespace(const char *mp)
+{
+	return yaffs_freespace(mp);
+}
+
+int yhost_error(void)
+{
+	return yaffs_errno;
+}
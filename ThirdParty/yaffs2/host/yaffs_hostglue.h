@@ -0,0 +1,88 @@
+/**************************************************************************//**
+ * @file     yaffs_hostglue.h
+ *
+ * @brief    yaffs2 OS glue and device setup for the host build.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#ifndef __YAFFS_HOSTGLUE_H__
+#define __YAFFS_HOSTGLUE_H__
+
+/*
+ * yaffs2 is built against the u-boot style headers of this tree, which do
+ * not mix with the host C library headers. Everything the benchmark needs
+ * from yaffs2 is therefore exported here with plain C types only.
+ */
+
+struct mtd_info;
+
+struct yhost_dev_opts {
+	int inband_tags;	/* -1: decide from oobavail like cmd_yaffs_devconfig() */
+	int n_caches;
+	int n_reserved_blocks;
+	int disable_summary;
+	int skip_checkpt_rd;
+	int skip_checkpt_wr;
+};
+
+struct yhost_dev_stats {
+	unsigned int n_page_writes;
+	unsigned int n_page_reads;
+	unsigned int n_erasures;
+	unsigned int n_erase_failures;
+	unsigned int n_bad_markings;
+	unsigned int n_gc_copies;
+	unsigned int n_gc_blocks;
+	unsigned int all_gcs;
+	unsigned int passive_gc_count;
+	unsigned int oldest_dirty_gc_count;
+	unsigned int n_retried_writes;
+	unsigned int n_retired_blocks;
+	unsigned int n_ecc_fixed;
+	unsigned int n_ecc_unfixed;
+	unsigned int summary_used;
+	int n_obj;
+	int n_tnodes;
+	int n_free_chunks;
+	int n_erased_blocks;
+	int blocks_in_checkpt;
+	int is_checkpointed;
+	int inband_tags;
+	int data_bytes_per_chunk;
+};
+
+struct yhost_mem_stats {
+	unsigned long long cur_bytes;	/* live bytes handed out by yaffs_malloc() */
+	unsigned long long peak_bytes;
+	unsigned long long n_allocs;
+	unsigned long long n_live;
+};
+
+void yhost_default_opts(struct yhost_dev_opts *opts);
+int yhost_add_device(const char *mp, struct mtd_info *mtd,
+		     int start_block, int end_block,
+		     const struct yhost_dev_opts *opts);
+int yhost_remove_device(const char *mp);
+int yhost_set_opts(const char *mp, const struct yhost_dev_opts *opts);
+int yhost_get_stats(const char *mp, struct yhost_dev_stats *st);
+
+void yhost_get_mem(struct yhost_mem_stats *mem);
+void yhost_reset_mem_peak(void);
+void yhost_set_trace(unsigned int mask);
+
+/* Thin wrappers around the yaffsfs.h API */
+int yhost_mount(const char *mp);
+int yhost_unmount(const char *mp);
+int yhost_sync(const char *mp);
+int yhost_create(const char *path);
+int yhost_open_read(const char *path);
+int yhost_write(int fd, const void *buf, unsigned int nbyte);
+int yhost_read(int fd, void *buf, unsigned int nbyte);
+int yhost_close(int fd);
+int yhost_unlink(const char *path);
+int yhost_mkdir(const char *path);
+long long yhost_freespace(const char *mp);
+int yhost_error(void);
+
+#endif /* __YAFFS_HOSTGLUE_H__ */
@@ -0,0 +1,596 @@
+/**************************************************************************//**
+ * @file     ybench.c
+ *
+ * @brief    yaffs2 mount time, garbage collection and RAM benchmarks on the
+ *           host NAND simulator.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
+*****************************************************************************/
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nandsim.h"
+#include "yaffs_hostglue.h"
+
+/*
+ * Two clocks are reported for every measurement:
+ *  - host: CPU time spent in yaffs2 on this PC, an indication of the code
+ *    path length only;
+ *  - flash: busy time of the simulated chip from the nandsim timing model
+ *    (tR/tPROG/tBERS plus bus transfer), which dominates on the board.
+ */
+
+#define BENCH_MP		"/flash"
+#define BENCH_MAX_FILES		65536
+#define BENCH_PATH_LEN		32
+
+struct bench_args {
+	struct nandsim_cfg cfg;
+	unsigned int fill_pct;
+	unsigned int file_size;
+	unsigned int write_size;
+	unsigned int gc_ops;
+	unsigned int repeats;
+	unsigned int trace;
+};
+
+struct bench {
+	struct nandsim *sim;
+	struct mtd_info *mtd;
+	unsigned int n_files;
+	unsigned int *gen;		/* content generation per file */
+	unsigned char *buf;
+	unsigned char *vbuf;
+};
+
+struct sample_set {
+	unsigned long long *v;
+	size_t n;
+	size_t cap;
+};
+
+struct lat_samples {
+	struct sample_set flash;	/* every call */
+	struct sample_set flash_gc;	/* calls that ran a GC */
+	struct sample_set host;
+};
+
+static struct bench_args args;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned long long flash_ns(struct bench *b)
+{
+	struct nandsim_stats st;
+
+	nandsim_get_stats(b->sim, &st);
+	return st.busy_ns;
+}
+
+static unsigned long long flash_reads(struct bench *b)
+{
+	struct nandsim_stats st;
+
+	nandsim_get_stats(b->sim, &st);
+	return st.n_reads;
+}
+
+static void samples_add(struct sample_set *s, unsigned long long v)
+{
+	if (s->n == s->cap) {
+		s->cap = s->cap ? s->cap * 2 : 1024;
+		s->v = realloc(s->v, s->cap * sizeof(*s->v));
+		if (!s->v) {
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	s->v[s->n++] = v;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static unsigned long long samples_pct(struct sample_set *s, double pct)
+{
+	if (!s->n)
+		return 0;
+	return s->v[(size_t)(pct / 100.0 * (s->n - 1) + 0.5)];
+}
+
+static void samples_print(const char *name, struct sample_set *s)
+{
+	if (!s->n) {
+		printf("  %-22s no samples\n", name);
+		return;
+	}
+	qsort(s->v, s->n, sizeof(*s->v), cmp_u64);
+	printf("  %-22s n=%-7zu p50 %8.1f  p90 %8.1f  p99 %8.1f  p99.9 %8.1f  max %8.1f us\n",
+	       name, s->n,
+	       samples_pct(s, 50) / 1000.0, samples_pct(s, 90) / 1000.0,
+	       samples_pct(s, 99) / 1000.0, samples_pct(s, 99.9) / 1000.0,
+	       s->v[s->n - 1] / 1000.0);
+}
+
+static void samples_free(struct sample_set *s)
+{
+	free(s->v);
+	memset(s, 0, sizeof(*s));
+}
+
+static void file_path(char *path, unsigned int idx)
+{
+	snprintf(path, BENCH_PATH_LEN, BENCH_MP "/f%05u", idx);
+}
+
+/* Deterministic content so every file can be verified after a remount. */
+static void file_pattern(unsigned char *buf, unsigned int len,
+			 unsigned int idx, unsigned int gen, unsigned int offs)
+{
+	unsigned int i, x;
+
+	for (i = 0; i < len; i++) {
+		x = (idx * 2654435761u) ^ (gen * 40503u) ^ ((offs + i) * 97u);
+		buf[i] = (unsigned char)(x ^ (x >> 11));
+	}
+}
+
+static int bench_setup(struct bench *b, const struct nandsim_cfg *cfg,
+		       const struct yhost_dev_opts *opts)
+{
+	memset(b, 0, sizeof(*b));
+
+	b->sim = nandsim_create(cfg);
+	if (!b->sim) {
+		fprintf(stderr, "nandsim: invalid geometry\n");
+		return -1;
+	}
+	b->mtd = nandsim_mtd_create(b->sim, "nand0");
+	b->gen = calloc(BENCH_MAX_FILES, sizeof(*b->gen));
+	b->buf = malloc(args.file_size);
+	b->vbuf = malloc(args.file_size);
+	if (!b->mtd || !b->gen || !b->buf || !b->vbuf ||
+	    yhost_add_device(BENCH_MP, b->mtd, 0, 0, opts)) {
+		fprintf(stderr, "cannot set up %s\n", BENCH_MP);
+		return -1;
+	}
+	yhost_set_trace(args.trace);
+	return 0;
+}
+
+static void bench_teardown(struct bench *b)
+{
+	yhost_remove_device(BENCH_MP);
+	nandsim_mtd_destroy(b->mtd);
+	nandsim_destroy(b->sim);
+	free(b->gen);
+	free(b->buf);
+	free(b->vbuf);
+	memset(b, 0, sizeof(*b));
+}
+
+/* Write one whole file, optionally recording the latency of every call. */
+static int write_file(struct bench *b, unsigned int idx,
+		      struct lat_samples *ls)
+{
+	struct yhost_dev_stats st;
+	unsigned long long h0 = 0, f0 = 0, lat;
+	unsigned int offs, n, gcs = 0;
+	char path[BENCH_PATH_LEN];
+	int fd, ret;
+
+	file_path(path, idx);
+	b->gen[idx]++;
+	file_pattern(b->buf, args.file_size, idx, b->gen[idx], 0);
+
+	fd = yhost_create(path);
+	if (fd < 0)
+		return -1;
+
+	for (offs = 0; offs <= args.file_size; offs += n) {
+		if (ls) {
+			yhost_get_stats(BENCH_MP, &st);
+			gcs = st.all_gcs;
+			h0 = now_ns();
+			f0 = flash_ns(b);
+		}
+
+		/* The last step is close(), which flushes the cache. */
+		if (offs == args.file_size) {
+			n = 1;
+			ret = yhost_close(fd);
+		} else {
+			n = args.file_size - offs;
+			if (n > args.write_size)
+				n = args.write_size;
+			ret = yhost_write(fd, b->buf + offs, n) == (int)n ? 0 : -1;
+		}
+
+		if (ls) {
+			samples_add(&ls->host, now_ns() - h0);
+			lat = flash_ns(b) - f0;
+			samples_add(&ls->flash, lat);
+			yhost_get_stats(BENCH_MP, &st);
+			if (st.all_gcs != gcs)
+				samples_add(&ls->flash_gc, lat);
+		}
+
+		if (ret) {
+			if (offs != args.file_size)
+				yhost_close(fd);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int verify_files(struct bench *b)
+{
+	char path[BENCH_PATH_LEN];
+	unsigned int i;
+	int fd, bad = 0;
+
+	for (i = 0; i < b->n_files; i++) {
+		file_path(path, i);
+		fd = yhost_open_read(path);
+		if (fd < 0 ||
+		    yhost_read(fd, b->vbuf, args.file_size) != (int)args.file_size) {
+			bad++;
+		} else {
+			file_pattern(b->buf, args.file_size, i, b->gen[i], 0);
+			if (memcmp(b->buf, b->vbuf, args.file_size))
+				bad++;
+		}
+		if (fd >= 0)
+			yhost_close(fd);
+	}
+	return bad;
+}
+
+/* Fill the mounted device to fill_pct of its free space at mount time. */
+static int fill(struct bench *b)
+{
+	long long target = yhost_freespace(BENCH_MP) * args.fill_pct / 100;
+	long long written = 0;
+
+	while (written + args.file_size <= target && b->n_files < BENCH_MAX_FILES) {
+		if (write_file(b, b->n_files, NULL))
+			break;
+		b->n_files++;
+		written += args.file_size;
+	}
+	return b->n_files ? 0 : -1;
+}
+
+static unsigned int rnd(unsigned int *seed)
+{
+	*seed = *seed * 1103515245u + 12345u;
+	return *seed >> 8;
+}
+
+static void print_geometry(const struct nandsim_cfg *cfg)
+{
+	unsigned long long size = (unsigned long long)cfg->page_size *
+				  cfg->pages_per_block * cfg->n_blocks;
+
+	printf("NAND: %llu MiB, page %u+%u, %u pages/block, %u blocks, BCH T%u, "
+	       "%u bad blocks, flips %u ppm\n",
+	       size >> 20, cfg->page_size, cfg->oob_size, cfg->pages_per_block,
+	       cfg->n_blocks, cfg->ecc_strength, cfg->bad_blocks, cfg->flip_ppm);
+	printf("Timing: tR %u us, tPROG %u us, tBERS %u us, %u ns/byte\n\n",
+	       cfg->t_read / 1000, cfg->t_prog / 1000, cfg->t_erase / 1000,
+	       cfg->t_byte);
+}
+
+/*
+ * Mount time: the same fill is written once with and once without block
+ * summaries, then each image is mounted from its checkpoint and by a full
+ * scan (checkpoint read skipped).
+ */
+static int bench_mount(void)
+{
+	static const char *const mode_name[2] = { "checkpoint", "scan" };
+	struct yhost_dev_opts opts;
+	struct yhost_dev_stats st;
+	struct yhost_mem_stats mem;
+	struct bench b;
+	unsigned long long h[2][16], f[2][16], rd[2][16], heap[2];
+	unsigned int summary, mode, r, i, seed;
+	int fallback[2];
+
+	printf("== mount: %u%% full, %u byte files, median of %u ==\n",
+	       args.fill_pct, args.file_size, args.repeats);
+	printf("  %-10s %-10s %10s %10s %11s %10s\n", "image", "mount",
+	       "host ms", "flash ms", "page reads", "heap KiB");
+
+	for (summary = 0; summary < 2; summary++) {
+		yhost_default_opts(&opts);
+		opts.disable_summary = summary;
+		if (bench_setup(&b, &args.cfg, &opts) || yhost_mount(BENCH_MP) < 0 ||
+		    fill(&b))
+			return -1;
+
+		/* Rewrite a tenth of the files so the image has dirty blocks. */
+		seed = args.cfg.seed;
+		for (i = 0; i < b.n_files / 10; i++)
+			write_file(&b, rnd(&seed) % b.n_files, NULL);
+		yhost_unmount(BENCH_MP);
+
+		memset(fallback, 0, sizeof(fallback));
+		for (r = 0; r < args.repeats; r++) {
+			for (mode = 0; mode < 2; mode++) {
+				opts.skip_checkpt_rd = mode;
+				yhost_set_opts(BENCH_MP, &opts);
+
+				nandsim_reset_stats(b.sim);
+				h[mode][r] = now_ns();
+				if (yhost_mount(BENCH_MP) < 0)
+					return -1;
+				h[mode][r] = now_ns() - h[mode][r];
+				f[mode][r] = flash_ns(&b);
+				rd[mode][r] = flash_reads(&b);
+
+				yhost_get_stats(BENCH_MP, &st);
+				yhost_get_mem(&mem);
+				heap[mode] = mem.cur_bytes;
+				if (mode == 0 && !st.is_checkpointed)
+					fallback[mode] = 1;
+
+				/* Leaves a fresh checkpoint for the next round */
+				yhost_unmount(BENCH_MP);
+			}
+		}
+
+		for (mode = 0; mode < 2; mode++) {
+			qsort(h[mode], args.repeats, sizeof(h[mode][0]), cmp_u64);
+			qsort(f[mode], args.repeats, sizeof(f[mode][0]), cmp_u64);
+			qsort(rd[mode], args.repeats, sizeof(rd[mode][0]), cmp_u64);
+			printf("  %-10s %-10s %10.2f %10.2f %11llu %10llu%s\n",
+			       summary ? "no-summary" : "summary", mode_name[mode],
+			       h[mode][args.repeats / 2] / 1e6,
+			       f[mode][args.repeats / 2] / 1e6,
+			       rd[mode][args.repeats / 2], heap[mode] >> 10,
+			       fallback[mode] ? "  (no checkpoint, scanned)" : "");
+		}
+
+		bench_teardown(&b);
+	}
+	printf("\n");
+	return 0;
+}
+
+/*
+ * GC latency: fill, then keep rewriting random files. Every write() and
+ * the final close() of each rewrite is one sample; samples during which
+ * yaffs2 ran a garbage collection are also reported on their own.
+ */
+static int bench_gc(void)
+{
+	struct yhost_dev_opts opts;
+	struct yhost_dev_stats s0, s1;
+	struct nandsim_stats n0, n1;
+	struct lat_samples ls;
+	struct bench b;
+	unsigned long long user_bytes, h0;
+	unsigned int i, seed, wmin, wmax;
+	double wavg;
+	int bad;
+
+	printf("== gc: %u%% full, %u rewrites of %u byte files, %u byte writes ==\n",
+	       args.fill_pct, args.gc_ops, args.file_size, args.write_size);
+
+	memset(&ls, 0, sizeof(ls));
+	yhost_default_opts(&opts);
+	if (bench_setup(&b, &args.cfg, &opts) || yhost_mount(BENCH_MP) < 0 ||
+	    fill(&b))
+		return -1;
+
+	yhost_get_stats(BENCH_MP, &s0);
+	nandsim_get_stats(b.sim, &n0);
+	seed = args.cfg.seed;
+	h0 = now_ns();
+	for (i = 0; i < args.gc_ops; i++) {
+		if (write_file(&b, rnd(&seed) % b.n_files, &ls)) {
+			printf("  write failed after %u rewrites, error %d\n",
+			       i, yhost_error());
+			break;
+		}
+	}
+	h0 = now_ns() - h0;
+	yhost_get_stats(BENCH_MP, &s1);
+	nandsim_get_stats(b.sim, &n1);
+	user_bytes = (unsigned long long)i * args.file_size;
+
+	printf("  latency per write()/close() call:\n");
+	samples_print("flash, all calls", &ls.flash);
+	samples_print("flash, calls with GC", &ls.flash_gc);
+	samples_print("host, all calls", &ls.host);
+	printf("  host time %.1f ms, flash busy %.1f ms for %.1f MiB of user data\n",
+	       h0 / 1e6, (n1.busy_ns - n0.busy_ns) / 1e6, user_bytes / 1048576.0);
+	printf("  write amplification %.2f (page programs x page size / user bytes)\n",
+	       user_bytes ? (double)(n1.n_progs - n0.n_progs) *
+	       args.cfg.page_size / user_bytes : 0.0);
+	printf("  gc: %u runs, %u blocks collected, %u chunks copied, %llu erases\n",
+	       s1.all_gcs - s0.all_gcs, s1.n_gc_blocks - s0.n_gc_blocks,
+	       s1.n_gc_copies - s0.n_gc_copies, n1.n_erases - n0.n_erases);
+
+	nandsim_wear(b.sim, &wmin, &wmax, &wavg);
+	printf("  wear: erase count min %u avg %.1f max %u\n", wmin, wavg, wmax);
+	printf("  ecc: %llu bits corrected, %llu uncorrectable steps, "
+	       "yaffs fixed %u unfixed %u, blocks retired %u\n",
+	       n1.n_corrected, n1.n_uncorrectable, s1.n_ecc_fixed,
+	       s1.n_ecc_unfixed, s1.n_retired_blocks);
+	if (n1.n_reprogram || n1.n_out_of_order)
+		printf("  WARNING: %llu pages programmed twice, %llu out of order\n",
+		       n1.n_reprogram, n1.n_out_of_order);
+
+	yhost_unmount(BENCH_MP);
+	if (yhost_mount(BENCH_MP) < 0)
+		return -1;
+	bad = verify_files(&b);
+	printf("  verify after remount: %u files, %d bad\n\n", b.n_files, bad);
+
+	samples_free(&ls.flash);
+	samples_free(&ls.flash_gc);
+	samples_free(&ls.host);
+	bench_teardown(&b);
+	return bad ? -1 : 0;
+}
+
+/* RAM held by yaffs2 per MiB of flash, for a range of device sizes. */
+static int bench_ram(void)
+{
+	static const unsigned int scale[] = { 1, 2, 4, 8 };
+	struct nandsim_cfg cfg = args.cfg;
+	struct yhost_dev_opts opts;
+	struct yhost_dev_stats st;
+	struct yhost_mem_stats mem;
+	struct bench b;
+	unsigned long long empty, full, remount;
+	double mib;
+	unsigned int i;
+
+	printf("== ram: bytes held by yaffs2 (dev struct, block info, "
+	       "objects, tnodes, caches) ==\n");
+	printf("  %8s %10s %12s %12s %12s %12s %8s %8s\n", "MiB",
+	       "files", "empty B/MiB", "full B/MiB", "remnt B/MiB", "peak KiB",
+	       "objects", "tnodes");
+
+	yhost_default_opts(&opts);
+	for (i = 0; i < sizeof(scale) / sizeof(scale[0]); i++) {
+		cfg.n_blocks = args.cfg.n_blocks * scale[i] / 4;
+		if (cfg.n_blocks < 64)
+			continue;
+		mib = (double)cfg.page_size * cfg.pages_per_block *
+		      cfg.n_blocks / 1048576.0;
+
+		if (bench_setup(&b, &cfg, &opts) || yhost_mount(BENCH_MP) < 0)
+			return -1;
+		yhost_reset_mem_peak();
+		yhost_get_mem(&mem);
+		empty = mem.cur_bytes;
+
+		if (fill(&b))
+			return -1;
+		yhost_get_mem(&mem);
+		full = mem.cur_bytes;
+		yhost_get_stats(BENCH_MP, &st);
+
+		yhost_unmount(BENCH_MP);
+		if (yhost_mount(BENCH_MP) < 0)
+			return -1;
+		yhost_get_mem(&mem);
+		remount = mem.cur_bytes;
+
+		printf("  %8.0f %10u %12.0f %12.0f %12.0f %12llu %8d %8d\n",
+		       mib, b.n_files, empty / mib, full / mib, remount / mib,
+		       mem.peak_bytes >> 10, st.n_obj, st.n_tnodes);
+		bench_teardown(&b);
+	}
+	printf("\n");
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	printf("usage: %s [options] <mount|gc|ram|all>\n"
+	       "  -p bytes   page size (%u)\n"
+	       "  -o bytes   OOB size (%u)\n"
+	       "  -k pages   pages per block (%u)\n"
+	       "  -n blocks  number of blocks (%u)\n"
+	       "  -e T       BCH strength, 0/8/12/24 (%u)\n"
+	       "  -B count   factory bad blocks\n"
+	       "  -x ppm     bit flip events per million page reads\n"
+	       "  -X bits    max bits flipped per event (%u)\n"
+	       "  -P ppm     page program failures per million\n"
+	       "  -E ppm     block erase failures per million\n"
+	       "  -f pct     fill level (%u)\n"
+	       "  -s bytes   file size (%u)\n"
+	       "  -w bytes   write() size (%u)\n"
+	       "  -i count   rewrites for the gc benchmark (%u)\n"
+	       "  -r count   repeats for the mount benchmark (%u)\n"
+	       "  -S seed    random seed\n"
+	       "  -t mask    yaffs trace mask\n",
+	       prog, args.cfg.page_size, args.cfg.oob_size,
+	       args.cfg.pages_per_block, args.cfg.n_blocks,
+	       args.cfg.ecc_strength, args.cfg.flip_max, args.fill_pct,
+	       args.file_size, args.write_size, args.gc_ops, args.repeats);
+}
+
+int main(int argc, char **argv)
+{
+	const char *which;
+	int c, ret = 0;
+
+	/* Results and yaffs traces stay in order when piped to a file */
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	nandsim_default_cfg(&args.cfg);
+	args.fill_pct = 80;
+	args.file_size = 64 * 1024;
+	args.write_size = 2048;
+	args.gc_ops = 2000;
+	args.repeats = 3;
+
+	while ((c = getopt(argc, argv, "p:o:k:n:e:B:x:X:P:E:f:s:w:i:r:S:t:h")) != -1) {
+		unsigned int v = (unsigned int)strtoul(optarg ? optarg : "0", NULL, 0);
+
+		switch (c) {
+		case 'p': args.cfg.page_size = v; break;
+		case 'o': args.cfg.oob_size = v; break;
+		case 'k': args.cfg.pages_per_block = v; break;
+		case 'n': args.cfg.n_blocks = v; break;
+		case 'e': args.cfg.ecc_strength = v; break;
+		case 'B': args.cfg.bad_blocks = v; break;
+		case 'x': args.cfg.flip_ppm = v; break;
+		case 'X': args.cfg.flip_max = v; break;
+		case 'P': args.cfg.prog_fail_ppm = v; break;
+		case 'E': args.cfg.erase_fail_ppm = v; break;
+		case 'f': args.fill_pct = v; break;
+		case 's': args.file_size = v; break;
+		case 'w': args.write_size = v; break;
+		case 'i': args.gc_ops = v; break;
+		case 'r': args.repeats = v; break;
+		case 'S': args.cfg.seed = v; break;
+		case 't': args.trace = v; break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind >= argc || !args.file_size || !args.write_size ||
+	    args.fill_pct > 100 || !args.repeats || args.repeats > 16) {
+		usage(argv[0]);
+		return 1;
+	}
+	which = argv[optind];
+
+	print_geometry(&args.cfg);
+
+	if (!strcmp(which, "mount") || !strcmp(which, "all"))
+		ret |= bench_mount();
+	if (!strcmp(which, "gc") || !strcmp(which, "all"))
+		ret |= bench_gc();
+	if (!strcmp(which, "ram") || !strcmp(which, "all"))
+		ret |= bench_ram();
+
+	if (ret)
+		fprintf(stderr, "benchmark failed\n");
+	return ret ? 1 : 0;
+}
@@ -284,6 +284,12 @@ enum nand_ecc_algo {
 /* ONFI subfeature parameters length */
 #define ONFI_SUBFEATURE_PARAM_LEN	4
 
+/* ONFI optional commands PROGRAM PAGE CACHE supported? */
+#define ONFI_OPT_CMD_PROG_CACHE		(1 << 0)
+
+/* ONFI optional commands READ CACHE supported? */
+#define ONFI_OPT_CMD_READ_CACHE		(1 << 1)
+
 /* ONFI optional commands SET/GET FEATURES supported? */
 #define ONFI_OPT_CMD_SET_GET_FEATURES	(1 << 2)
 
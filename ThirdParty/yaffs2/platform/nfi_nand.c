@@ -7,6 +7,7 @@
  * @copyright (C) 2023 Nuvoton Technology Corp. All rights reserved.
 *****************************************************************************/
 #include <stdlib.h>
+#include <string.h>
 #include "ma35d1.h"
 #include "stdio.h"
 #include "nand.h"
@@ -29,6 +30,16 @@
 #define READYBUSY   (0x01 << 18)
 #define ENDADDR     (0x80000000)
 
+/* Use READ CACHE SEQUENTIAL for consecutive page reads if ONFI parameters allow it */
+#ifndef NAND_USE_CACHE_READ
+#define NAND_USE_CACHE_READ     1
+#endif
+
+#define NAND_CMD_READCACHESEQ   0x31
+#define NAND_CMD_READCACHEEND   0x3f
+
+#define NAND_DMA_TIMEOUT        3000    /* ms */
+
 /*-----------------------------------------------------------------------------
  * Define some constants for BCH
  *---------------------------------------------------------------------------*/
@@ -51,6 +62,14 @@ struct nuvoton_nand_info {
     struct nand_chip        chip;
     int                     eBCHAlgo;
     int                     m_i32SMRASize;
+    int                     bCacheRead;         /* chip supports READ CACHE SEQUENTIAL */
+    int                     i32CachePage;       /* page available for data output, -1 if none */
+    int                     bCacheBusy;         /* next page is loading in cache read mode */
+    int                     i32LastReadPage;    /* last page read, for sequential detection */
+    struct mtd_info         *pDmaMtd;           /* mtd of the DMA transfer in progress */
+    unsigned long           u32DmaAddr;         /* buffer of the DMA read in progress */
+    volatile int            i32DmaDone;         /* set by IRQ handler on DMA completion */
+    volatile int            i32DmaResult;       /* max bitflips or -EBADMSG of DMA read */
 };
 struct nuvoton_nand_info g_nuvoton_nand;
 struct nuvoton_nand_info *nuvoton_nand;
@@ -140,10 +159,26 @@ static int nuvoton_waitfunc(struct mtd_info *mtd, struct nand_chip *chip)
 	return status;
 }
 
+/* Leave the read cache mode, the chip is ready for any command afterwards */
+static void nuvoton_nand_cache_end(struct mtd_info *mtd)
+{
+	struct nuvoton_nand_info *nand = nuvoton_nand;
+
+	if (nand->bCacheBusy) {
+		NFI->NANDINTSTS = 0x400;
+		NFI->NANDCMD = NAND_CMD_READCACHEEND;
+		nuvoton_waitfunc(mtd, mtd->priv);
+		nand->bCacheBusy = 0;
+	}
+	nand->i32CachePage = -1;
+}
+
 static void nuvoton_nand_command(struct mtd_info *mtd, unsigned int command, int column, int page_addr)
 {
     register struct nand_chip *chip = mtd->priv;
 
+	nuvoton_nand_cache_end(mtd);
+
 	NFI->NANDINTSTS = 0x400;
 
 	if (command == NAND_CMD_READOOB) {
@@ -216,6 +251,71 @@ static void nuvoton_nand_command(struct mtd_info *mtd, unsigned int command, int
 	}
 }
 
+/*
+ * nuvoton_nand_change_column - move data output of the page register to another column
+ * @mtd: MTD device structure
+ * @column: column address
+ */
+static void nuvoton_nand_change_column(struct mtd_info *mtd, int column)
+{
+	NFI->NANDCMD = NAND_CMD_RNDOUT;
+	NFI->NANDADDR = column & 0xff;
+	NFI->NANDADDR = ((column >> 8) & 0xff)|ENDADDR;
+	NFI->NANDCMD = NAND_CMD_RNDOUTSTART;
+
+	/* tCCS: a few register accesses before the first data cycle */
+	(void)NFI->NANDINTSTS;
+	(void)NFI->NANDINTSTS;
+	(void)NFI->NANDINTSTS;
+}
+
+/*
+ * nuvoton_nand_read_page_op - make a page available for data output at column
+ * @mtd: MTD device structure
+ * @column: column address
+ * @page: page address
+ *
+ * A page already in the page register is not read again. From the second
+ * consecutive page of a block on, pages are streamed with READ CACHE
+ * SEQUENTIAL: the next page is loaded from the array while the current one
+ * is transferred, so scans and checkpoint reads hide tR.
+ */
+static void nuvoton_nand_read_page_op(struct mtd_info *mtd, int column, int page)
+{
+	struct nuvoton_nand_info *nand = nuvoton_nand;
+	struct nand_chip *chip = mtd->priv;
+	int last_in_block = (1 << (chip->phys_erase_shift - chip->page_shift)) - 1;
+
+	if (page == nand->i32CachePage) {
+		nuvoton_nand_change_column(mtd, column);
+	} else if (nand->bCacheBusy && (page == nand->i32CachePage + 1)) {
+		/* Next page was loading, move it to the cache register */
+		NFI->NANDINTSTS = 0x400;
+		if ((page & last_in_block) == last_in_block) {
+			NFI->NANDCMD = NAND_CMD_READCACHEEND;
+			nand->bCacheBusy = 0;
+		} else
+			NFI->NANDCMD = NAND_CMD_READCACHESEQ;
+		nuvoton_waitfunc(mtd, chip);
+		nand->i32CachePage = page;
+		nuvoton_nand_change_column(mtd, column);
+	} else {
+		nuvoton_nand_command(mtd, NAND_CMD_READ0, column, page);
+		nand->i32CachePage = page;
+
+		if (nand->bCacheRead && (page == nand->i32LastReadPage + 1) &&
+		    ((page & last_in_block) != last_in_block)) {
+			/* Sequential access, start loading the next page */
+			NFI->NANDINTSTS = 0x400;
+			NFI->NANDCMD = NAND_CMD_READCACHESEQ;
+			nuvoton_waitfunc(mtd, chip);
+			nand->bCacheBusy = 1;
+			nuvoton_nand_change_column(mtd, column);
+		}
+	}
+	nand->i32LastReadPage = page;
+}
+
 /*
  * nuvoton_nand_read_byte - read a byte from NAND controller into buffer
  * @mtd: MTD device structure
@@ -460,10 +560,39 @@ int nuvoton_CorrectData(struct mtd_info *mtd, unsigned long uDAddr)
 }
 
 
+/*
+ * NAND controller interrupt: BCH field errors are corrected while the DMA
+ * is held, completion is reported to the waiting transfer.
+ */
+static void nuvoton_nand_irq_handler(void)
+{
+    struct nuvoton_nand_info *nand = nuvoton_nand;
+    uint32_t u32Sts = NFI->NANDINTSTS;
+    int cnt;
+
+    if ((u32Sts & NFI_NANDINTSTS_ECCFLDIF_Msk) && (nand->i32DmaResult >= 0)) {
+        cnt = nuvoton_CorrectData(nand->pDmaMtd, nand->u32DmaAddr);
+        NFI->NANDINTSTS = NFI_NANDINTSTS_ECCFLDIF_Msk;
+        if (cnt < 0) {
+            nand->i32DmaResult = cnt;
+            NFI->DMACTL = 0x3;          // reset DMAC
+            NFI->NANDCTL |= 0x1;
+            nand->i32DmaDone = 1;
+            return;
+        }
+        nand->i32DmaResult = max_t(int, nand->i32DmaResult, cnt);
+    }
+
+    if (u32Sts & NFI_NANDINTSTS_DMAIF_Msk) {
+        NFI->NANDINTSTS = NFI_NANDINTSTS_DMAIF_Msk;
+        nand->i32DmaDone = 1;
+    }
+}
+
 static inline int nuvoton_nand_dma_transfer(struct mtd_info *mtd, const u_char *addr, unsigned int len, int is_write)
 {
     struct nuvoton_nand_info *nand = nuvoton_nand;
-    int cnt = 0;
+    unsigned long time;
 
     // For save, wait DMAC to ready
     while (NFI->DMACTL & 0x200);
@@ -472,8 +601,12 @@ static inline int nuvoton_nand_dma_transfer(struct mtd_info *mtd, const u_char *
     NFI->DMACTL |= 0x3;
     while (NFI->DMACTL & 0x2);
 
-    // Fill dma_addr
-    dcache_clean_invalidate_by_mva(addr, len);
+    // Write: DMA reads memory, dirty lines must reach it.
+    // Read: no dirty line may be evicted over DMA data later.
+    if (is_write)
+        dcache_clean_by_mva(addr, len);
+    else
+        dcache_clean_invalidate_by_mva(addr, len);
     NFI->DMASA = (unsigned long)addr;
 
     NFI->NANDRACTL = nand->m_i32SMRASize;
@@ -482,6 +615,11 @@ static inline int nuvoton_nand_dma_transfer(struct mtd_info *mtd, const u_char *
     NFI->NANDCTL = (NFI->NANDCTL & (~0x06000000)) | 0x04000000;
     /* setup and start DMA using dma_addr */
 
+    nand->pDmaMtd = mtd;
+    nand->u32DmaAddr = (unsigned long)addr;
+    nand->i32DmaResult = 0;
+    nand->i32DmaDone = 0;
+
     if (is_write) {
         register char *ptr = (char *)(NAND_BASE+0xA00);
         // To mark this page as dirty.
@@ -491,38 +629,31 @@ static inline int nuvoton_nand_dma_transfer(struct mtd_info *mtd, const u_char *
         	*(ptr+2) = 0;
 
         NFI->NANDCTL |= 0x4;
-        while (!(NFI->NANDINTSTS & 0x1));
-
     } else {
-        // Blocking for reading
         // Enable DMA Read
     	NFI->NANDCTL |= 0x2;
+    }
 
-        if (NFI->NANDCTL & 0x80) {
-            do {
-                int stat=0;
-
-                cnt = nuvoton_CorrectData(mtd, (unsigned long)addr);
-                if (cnt < 0) {
-                    NFI->NANDINTSTS = 0x4;
-                    NFI->DMACTL = 0x3;          // reset DMAC
-                    NFI->NANDCTL |= 0x1;
-                    break;
-                }
-                else {
-                	NFI->NANDINTSTS = 0x4;
-                }
-
-            } while (!(NFI->NANDINTSTS & 0x1) || (NFI->NANDINTSTS & 0x4));
-        } else
-            while (!(NFI->NANDINTSTS & 0x1));
+    time = msTicks0;
+    while (!nand->i32DmaDone) {
+        if ((msTicks0 - time) > NAND_DMA_TIMEOUT) {
+            NFI->DMACTL = 0x3;          // reset DMAC
+            NFI->NANDCTL |= 0x1;
+            nand->i32DmaResult = -EIO;
+            break;
+        }
     }
-    dcache_clean_invalidate_by_mva(addr, len);
 
-    // Clear DMA finished flag
-    NFI->NANDINTSTS |= 0x1;
+    // Drop lines fetched speculatively during the transfer.
+    // Corrected fields were written through the cache and must be kept.
+    if (!is_write) {
+        if (nand->i32DmaResult > 0)
+            dcache_clean_invalidate_by_mva(addr, len);
+        else
+            dcache_invalidate_by_mva(addr, len);
+    }
 
-    return cnt;
+    return is_write ? 0 : nand->i32DmaResult;
 }
 
 /**
@@ -588,7 +719,7 @@ static int nuvoton_nand_write_page_hwecc(struct mtd_info *mtd, struct nand_chip
 static int nuvoton_nand_read_page_raw(struct mtd_info *mtd, struct nand_chip *chip, uint8_t *buf, int oob_required, int page)
 {
 	// read data from nand
-	nuvoton_nand_command(mtd, NAND_CMD_READ0, 0, page);
+	nuvoton_nand_read_page_op(mtd, 0, page);
 	nuvoton_nand_read_buf(mtd, buf, mtd->writesize);
 
 	return 0;
@@ -608,7 +739,7 @@ static int nuvoton_nand_read_page_hwecc_oob_first(struct mtd_info *mtd, struct n
     int bitflips = 0;
 
     /* At first, read the OOB area  */
-    nuvoton_nand_command(mtd, NAND_CMD_READOOB, 0, page);
+    nuvoton_nand_read_page_op(mtd, mtd->writesize, page);
     nuvoton_nand_read_buf(mtd, chip->oob_poi, mtd->oobsize);
 
     // Second, copy OOB data to SMRA for page read
@@ -617,8 +748,8 @@ static int nuvoton_nand_read_page_hwecc_oob_first(struct mtd_info *mtd, struct n
 	if ((*(ptr+2) != 0) && (*(ptr+3) != 0))
 		memset((void *)p, 0xff, mtd->writesize);
 	else {
-		// Third, read data from nand
-		nuvoton_nand_command(mtd, NAND_CMD_READ0, 0, page);
+		// Third, read data from the page register, no need to load the page again
+		nuvoton_nand_change_column(mtd, 0);
 		bitflips = nuvoton_nand_dma_transfer(mtd, p, mtd->writesize, 0x0);
 
 		// Fourth, restore OOB data from SMRA
@@ -640,7 +771,7 @@ static int nuvoton_nand_read_oob_hwecc(struct mtd_info *mtd, struct nand_chip *c
     char * ptr = (char *)(NAND_BASE+0xA00);
 
     /* At first, read the OOB area  */
-    nuvoton_nand_command(mtd, NAND_CMD_READOOB, 0, page);
+    nuvoton_nand_read_page_op(mtd, mtd->writesize, page);
     nuvoton_nand_read_buf(mtd, chip->oob_poi, mtd->oobsize);
 
     // Second, copy OOB data to SMRA for page read
@@ -662,12 +793,55 @@ static int nuvoton_nand_write_oob(struct mtd_info *mtd, struct nand_chip *chip,
 	return 0;
 }
 
+#if NAND_USE_CACHE_READ
+/*
+ * Optional commands supported by the chip, from the ONFI parameter page.
+ * nand_scan() fills it only when built with CONFIG_SYS_NAND_ONFI_DETECTION,
+ * otherwise the first copy of the parameter page is read and CRC checked here.
+ */
+static int nuvoton_nand_onfi_opt_cmd(struct mtd_info *mtd, struct nand_chip *chip)
+{
+    u8 param[256];
+    u16 crc = 0x4F4E;
+    int i, j;
+
+    if (chip->onfi_version)
+        return chip->onfi_params.opt_cmd;
+
+    chip->select_chip(mtd, 0);
+
+    nuvoton_nand_command(mtd, NAND_CMD_READID, 0x20, -1);
+    for (i = 0; i < 4; i++)
+        param[i] = nuvoton_nand_read_byte(mtd);
+    if (memcmp(param, "ONFI", 4)) {
+        chip->select_chip(mtd, -1);
+        return 0;
+    }
+
+    nuvoton_nand_command(mtd, NAND_CMD_PARAM, 0, -1);
+    nuvoton_nand_read_buf(mtd, param, sizeof(param));
+    chip->select_chip(mtd, -1);
+
+    for (i = 0; i < 254; i++) {
+        crc ^= param[i] << 8;
+        for (j = 0; j < 8; j++)
+            crc = (crc << 1) ^ ((crc & 0x8000) ? 0x8005 : 0);
+    }
+    if ((memcmp(param, "ONFI", 4)) || (crc != (param[254] | (param[255] << 8))))
+        return 0;
+
+    return param[8] | (param[9] << 8);  /* opt_cmd */
+}
+#endif
+
 int board_nand_init(struct nand_chip *nand)
 {
     struct mtd_info *mtd;
 
     nuvoton_nand = &g_nuvoton_nand;
     memset((void*)nuvoton_nand, 0, sizeof(struct nuvoton_nand_info));
+    nuvoton_nand->i32CachePage = -1;
+    nuvoton_nand->i32LastReadPage = -2;
 
     if (!nuvoton_nand)
         return -1;
@@ -787,6 +961,17 @@ int board_nand_init(struct nand_chip *nand)
     // Enable H/W ECC, ECC parity check enable bit during read page
     NFI->NANDCTL |= 0x00800080;
 
+#if NAND_USE_CACHE_READ
+    if (nuvoton_nand_onfi_opt_cmd(mtd, nand) & ONFI_OPT_CMD_READ_CACHE)
+        nuvoton_nand->bCacheRead = 1;
+#endif
+
+    // DMA completion and BCH field errors are handled by interrupt
+    NFI->NANDINTSTS = NFI_NANDINTSTS_DMAIF_Msk | NFI_NANDINTSTS_ECCFLDIF_Msk;
+    IRQ_SetHandler((IRQn_ID_t)NAND_IRQn, nuvoton_nand_irq_handler);
+    IRQ_Enable((IRQn_ID_t)NAND_IRQn);
+    NFI->NANDINTEN |= (NFI_NANDINTEN_DMAIE_Msk | NFI_NANDINTEN_ECCFLDIE_Msk);
+
     return 0;
 }
 
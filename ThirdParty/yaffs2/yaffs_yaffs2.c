@@ -1113,7 +1113,8 @@ static inline int yaffs2_scan_chunk(struct yaffs_dev *dev,
 		int *found_chunks,
 		u8 *chunk_data,
 		struct list_head *hard_list,
-		int summary_available)
+		int summary_available,
+		struct yaffs_ext_tags *pre_tags)
 {
 	struct yaffs_obj_hdr *oh;
 	struct yaffs_obj *in;
@@ -1136,7 +1137,12 @@ static inline int yaffs2_scan_chunk(struct yaffs_dev *dev,
 	}
 
 	if (!summary_available || tags.obj_id == 0) {
-		result = yaffs_rd_chunk_tags_nand(dev, chunk, NULL, &tags);
+		if (pre_tags) {
+			tags = *pre_tags;
+			result = YAFFS_OK;
+		} else {
+			result = yaffs_rd_chunk_tags_nand(dev, chunk, NULL, &tags);
+		}
 		dev->tags_used++;
 	} else {
 		dev->summary_used++;
@@ -1524,6 +1530,25 @@ static inline int yaffs2_scan_chunk(struct yaffs_dev *dev,
 	return alloc_failed ? YAFFS_FAIL : YAFFS_OK;
 }
 
+/*
+ * Read the tags of all chunks of a block in ascending order.
+ * The backwards scan then works on these instead of reading the chunks
+ * in descending order, so the flash sees one sequential page stream.
+ */
+static int yaffs2_scan_read_block_tags(struct yaffs_dev *dev, int blk,
+					struct yaffs_ext_tags *blk_tags)
+{
+	int c;
+	int chunk = blk * dev->param.chunks_per_block;
+
+	for (c = 0; c < dev->param.chunks_per_block; c++) {
+		if (yaffs_rd_chunk_tags_nand(dev, chunk + c, NULL,
+					     &blk_tags[c]) != YAFFS_OK)
+			return 0;
+	}
+	return 1;
+}
+
 int yaffs2_scan_backwards(struct yaffs_dev *dev)
 {
 	u32 blk;
@@ -1543,6 +1568,8 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 	struct yaffs_block_index *block_index = NULL;
 	int alt_block_index = 0;
 	int summary_available;
+	struct yaffs_ext_tags *blk_tags;
+	int tags_available;
 
 	yaffs_trace(YAFFS_TRACE_SCAN,
 		"yaffs2_scan_backwards starts  intstartblk %d intendblk %d...",
@@ -1570,6 +1597,10 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	chunk_data = yaffs_get_temp_buffer(dev);
 
+	/* Optional, blocks are scanned chunk by chunk without it */
+	blk_tags = yaffs_malloc(dev->param.chunks_per_block *
+				sizeof(struct yaffs_ext_tags));
+
 	/* Scan all the blocks to determine their state */
 	bi = dev->block_info;
 	for (blk = dev->internal_start_block; blk <= dev->internal_end_block;
@@ -1653,6 +1684,13 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 		summary_available = yaffs_summary_read(dev, dev->sum_tags, blk);
 
+		tags_available = 0;
+		if (!summary_available && blk_tags &&
+		    (bi->block_state == YAFFS_BLOCK_STATE_NEEDS_SCAN ||
+		     bi->block_state == YAFFS_BLOCK_STATE_ALLOCATING))
+			tags_available =
+				yaffs2_scan_read_block_tags(dev, blk, blk_tags);
+
 		/* For each chunk in each block that needs scanning.... */
 		found_chunks = 0;
 		if (summary_available)
@@ -1670,7 +1708,8 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 			 */
 			if (yaffs2_scan_chunk(dev, bi, blk, c,
 					&found_chunks, chunk_data,
-					&hard_list, summary_available) ==
+					&hard_list, summary_available,
+					tags_available ? &blk_tags[c] : NULL) ==
 					YAFFS_FAIL)
 				alloc_failed = 1;
 		}
@@ -1691,6 +1730,9 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	yaffs_skip_rest_of_block(dev);
 
+	if (blk_tags)
+		yaffs_free(blk_tags);
+
 	if (alt_block_index)
 		//vfree(block_index);
 		yaffs_free(block_index);